@@ -0,0 +1,436 @@
+# Decoder and traffic analysis for I2C bus captures of the BlockBox main bus, recorded with i2ccapture (capture file) or as a raw I2CDriver
+# capture stream (--raw). Transactions are decoded into module and register names using the firmware headers (i2c_defines_*.h register maps
+# and sizes via the system simulator's register_maps.py, module addresses from system_bbv2.cpp, CRC use from the interface headers), and checked:
+#  - CRC-8 framing of the module register protocol (module_interface_i2c.cpp), per register of multi-register reads and writes
+#  - CRC-32 of the EEPROM settings storage (eeprom_interface.cpp), whenever the header is read or written and the storage data is known
+# Reports per-register traffic (accesses, bytes, bus time, access intervals, write-to-readback latency), CRC errors and NAKs, and bus utilisation.
+# Times are host arrival times of the capture chunks (the I2CDriver stream is not timestamped), so they are only as precise as the USB serial
+# latency timer; bus time is calculated from the bit rate (--bitrate). Raw streams have no times at all: intervals and utilisation are then
+# based on bus time only (back-to-back transactions).
+#
+# usage: python i2c_analyze.py [-v] [--raw] [--bitrate HZ] <capture file | ->
+# live: ./i2ccapture /dev/ttyUSB0 -o - | python i2c_analyze.py -
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "..", "design_simulations", "system_sim_python"))
+from register_maps import defines, maps, firmware_root
+
+
+capture_magic = b"I2CCAP1\n"
+
+_interface_inc = os.path.join(firmware_root, "BlockBoxController", "ModuleInterface", "Inc")
+defines.load(os.path.join(firmware_root, "BlockBoxController", "Core", "Src", "system_bbv2.cpp"))
+for _header in ("dap_interface.h", "hifidac_interface.h", "rtc_interface.h", "charger_interface.h"):
+  defines.load(os.path.join(_interface_inc, _header))
+
+#bus modules: name, address define, CRC use define, register map (None: EEPROM, 16-bit memory addresses)
+_modules = [
+  ("EEPROM", "BBV2_EEPROM_I2C_ADDR", "IF_EEPROM_USE_CRC", None),
+  ("DAP", "BBV2_DAP_I2C_ADDR", "IF_DAP_USE_CRC", "dap"),
+  ("HiFiDAC", "BBV2_HIFIDAC_I2C_ADDR", "IF_HIFIDAC_USE_CRC", "dac"),
+  ("PowerAmp", "BBV2_POWERAMP_I2C_ADDR", "IF_POWERAMP_USE_CRC", "amp"),
+  ("RTC", "BBV2_RTC_I2C_ADDR", "IF_RTC_USE_CRC", "rtc"),
+  ("Charger", "BBV2_CHG_I2C_ADDR", "IF_CHG_USE_CRC", "chg"),
+]
+
+eeprom_header_crc = defines["IF_EEPROM_HEADER_CRC"]
+eeprom_header_version = defines["IF_EEPROM_HEADER_VERSION"]
+eeprom_storage_start = defines["IF_EEPROM_STORAGE_START"]
+eeprom_size_total = defines["IF_EEPROM_SIZE_TOTAL"]
+
+
+class Module:
+  def __init__(self, name, address, use_crc, regmap):
+    self.name = name
+    self.address = address
+    self.use_crc = use_crc
+    self.regmap = regmap
+    self.reg_names = register_names(regmap) if regmap is not None else {}
+
+  def reg_name(self, reg):
+    if self.regmap is None:
+      if reg < eeprom_storage_start:
+        return "header+0x%02X" % reg
+      return "storage+0x%03X" % (reg - eeprom_storage_start)
+    return self.reg_names.get(reg, "0x%02X" % reg)
+
+  def reg_size(self, reg):
+    if self.regmap is None or reg >= len(self.regmap.sizes):
+      return None
+    return self.regmap.sizes[reg]
+
+
+def register_names(regmap):
+  #reverse lookup of register addresses: all prefixed defines with an address of an existing register, without bit field/enum
+  #definitions (names extending another register name) - for register arrays (e.g. BIQUAD_COEFFS_CH1/CH2) each keeps its own name
+  candidates = {}
+  for name, value in defines.raw.items():
+    if not name.startswith(regmap.prefix) or name.endswith("_Pos") or name.endswith("_Msk") or name.endswith("REG_SIZES"):
+      continue
+    try:
+      reg = defines[name]
+    except Exception:
+      continue
+    if isinstance(reg, int) and 0 <= reg < len(regmap.sizes) and regmap.sizes[reg] > 0:
+      candidates[name[len(regmap.prefix):]] = reg
+  names = {}
+  for short, reg in candidates.items():
+    parts = short.split("_")
+    if any("_".join(parts[:i]) in candidates for i in range(1, len(parts))):
+      continue
+    if reg not in names or len(short) < len(names[reg]):
+      names[reg] = short
+  return names
+
+
+def load_modules():
+  modules = {}
+  for name, addr_define, crc_define, map_key in _modules:
+    use_crc = defines.raw[crc_define].strip() == "true"
+    modules[defines[addr_define]] = Module(name, defines[addr_define], use_crc, maps[map_key] if map_key else None)
+  return modules
+
+
+def crc8(data, state=0):
+  #module register protocol CRC: polynomial 0x7F, initial state 0, no reflection (same as the _i2c_crc_table of module_interface_i2c.cpp)
+  for byte in data:
+    state ^= byte
+    for _ in range(8):
+      state = ((state << 1) ^ 0x7F) & 0xFF if state & 0x80 else (state << 1) & 0xFF
+  return state
+
+
+_crc32_table = []
+for _i in range(256):
+  _c = _i << 24
+  for _ in range(8):
+    _c = ((_c << 1) ^ 0x32C00699) & 0xFFFFFFFF if _c & 0x80000000 else (_c << 1) & 0xFFFFFFFF
+  _crc32_table.append(_c)
+
+def crc32(data, crc=0):
+  #EEPROM storage CRC: polynomial 0x32C00699, MSB first (same as _EEPROM_CRC_Accumulate)
+  for byte in data:
+    crc = ((crc << 8) & 0xFFFFFFFF) ^ _crc32_table[byte ^ (crc >> 24)]
+  return crc
+
+
+def read_chunks(f, raw):
+  #yields (host time in s or None, chunk bytes)
+  if raw:
+    while True:
+      data = f.read(4096)
+      if not data:
+        return
+      yield None, data
+  if f.read(len(capture_magic)) != capture_magic:
+    raise ValueError("not an i2ccapture file (use --raw for raw capture streams)")
+  while True:
+    header = f.read(12)
+    if len(header) < 12:
+      return
+    time_us, length = struct.unpack("<QI", header)
+    data = f.read(length)
+    yield time_us * 1e-6, data
+
+
+def decode_events(chunks):
+  #capture symbols (see i2c_capture in i2cdriver.c) to bus events: ("S", t), ("P", t), ("B", t, byte, ack)
+  nbits, bits = 0, 0
+  for t, data in chunks:
+    for byte in data:
+      for symbol in (byte >> 4, byte & 0xF):
+        if symbol == 1:
+          nbits, bits = 0, 0
+          yield ("S", t)
+        elif symbol == 2:
+          nbits, bits = 0, 0
+          yield ("P", t)
+        elif symbol >= 8:
+          bits = (bits << 3) | (symbol & 7)
+          nbits += 3
+          if nbits == 9:
+            yield ("B", t, bits >> 1, not (bits & 1))
+            nbits, bits = 0, 0
+
+
+class Transaction:
+  def __init__(self):
+    self.segments = []   #per (repeated) START: [address byte, address ack, [(byte, ack), ...]]
+    self.time = None
+    self.starts = 0
+    self.stopped = False
+
+  def bytes_on_bus(self):
+    return sum(1 + len(segment[2]) for segment in self.segments if segment is not None)
+
+  def bus_bits(self):
+    #9 clocks per byte, plus roughly one bit time each for START and STOP conditions
+    return 9 * self.bytes_on_bus() + self.starts + (1 if self.stopped else 0)
+
+
+def decode_transactions(events):
+  current = None
+  for event in events:
+    if event[0] == "S":
+      if current is None:
+        current = Transaction()
+      current.starts += 1
+      current.segments.append(None)
+    elif event[0] == "P":
+      if current is not None:
+        current.stopped = True
+        current.time = event[1]
+        yield current
+      current = None
+    elif current is not None:
+      _, t, byte, ack = event
+      if current.segments[-1] is None:
+        current.segments[-1] = [byte, ack, []]
+      else:
+        current.segments[-1][2].append((byte, ack))
+  if current is not None and current.segments and current.segments[0] is not None:
+    yield current
+
+
+class RegisterStats:
+  def __init__(self):
+    self.reads = 0
+    self.writes = 0
+    self.bytes = 0
+    self.bus_time = 0.0
+    self.times = []
+    self.last_write = None
+    self.readback = []
+    self.crc_errors = 0
+    self.naks = 0
+
+
+class Analyzer:
+  def __init__(self, modules, bitrate, verbose):
+    self.modules = modules
+    self.bitrate = bitrate
+    self.verbose = verbose
+    self.registers = {}
+    self.unknown = {}
+    self.transactions = 0
+    self.bus_time = 0.0
+    self.first_time = None
+    self.last_time = None
+    self.framing_errors = 0
+    self.address_naks = 0
+    self.eeprom_image = bytearray(eeprom_size_total)
+    self.eeprom_known = bytearray(eeprom_size_total)
+    self.eeprom_loaded = False
+    self.eeprom_results = []
+
+  def stats(self, module, reg):
+    key = (module.name, reg)
+    if key not in self.registers:
+      self.registers[key] = RegisterStats()
+    return self.registers[key]
+
+  def transaction(self, trans):
+    self.transactions += 1
+    bus_time = trans.bus_bits() / self.bitrate
+    self.bus_time += bus_time
+    #raw streams: no host time, use the accumulated bus time (back-to-back transactions)
+    t = trans.time if trans.time is not None else self.bus_time
+    if self.first_time is None:
+      self.first_time = t
+    self.last_time = t
+
+    first = trans.segments[0]
+    if first is None:
+      self.framing_errors += 1
+      return
+    address = first[0] >> 1
+    module = self.modules.get(address)
+    if module is None:
+      self.unknown[address] = self.unknown.get(address, 0) + 1
+      self.log(t, "unknown device 0x%02X: %s" % (address, self.dump(trans)))
+      return
+    if not first[1]:
+      self.address_naks += 1
+      self.stats(module, None).naks += 1
+      self.log(t, "%s: address NAK" % module.name)
+      return
+
+    reg_bytes = 2 if module.regmap is None else 1
+    if (first[0] & 1) or len(first[2]) < reg_bytes or len(trans.segments) > 2:
+      self.framing_errors += 1
+      self.log(t, "%s: unexpected transaction %s" % (module.name, self.dump(trans)))
+      return
+    reg = first[2][0][0] if reg_bytes == 1 else (first[2][0][0] << 8) | first[2][1][0]
+    prefix = [first[0]] + [b for b, _ in first[2][:reg_bytes]]
+    if len(trans.segments) == 2:
+      second = trans.segments[1]
+      if second is None or not (second[0] & 1) or len(first[2]) != reg_bytes:
+        self.framing_errors += 1
+        self.log(t, "%s: unexpected transaction %s" % (module.name, self.dump(trans)))
+        return
+      write = False
+      prefix.append(second[0])
+      data = [b for b, _ in second[2]]
+      naks = 0 if second[1] else 1
+    else:
+      write = True
+      data = [b for b, _ in first[2][reg_bytes:]]
+      naks = sum(1 for _, ack in first[2] if not ack)
+
+    if module.regmap is None:
+      parts = [(reg, data, True)]
+      self.eeprom_access(t, reg, data, write)
+    else:
+      parts = self.split_registers(module, reg, prefix, data)
+    overhead = trans.bytes_on_bus() - sum(len(d) + (1 if module.use_crc else 0) for _, d, _ in parts)
+    for index, (part_reg, part_data, crc_ok) in enumerate(parts):
+      stats = self.stats(module, part_reg)
+      part_bytes = len(part_data) + (1 if module.use_crc else 0) + (overhead if index == 0 else 0)
+      stats.bytes += part_bytes
+      stats.bus_time += bus_time * part_bytes / trans.bytes_on_bus()
+      stats.times.append(t)
+      if write:
+        stats.writes += 1
+        stats.last_write = t
+      else:
+        stats.reads += 1
+        if stats.last_write is not None:
+          stats.readback.append(t - stats.last_write)
+          stats.last_write = None
+      if not crc_ok:
+        stats.crc_errors += 1
+      if index == 0:
+        stats.naks += naks
+      self.log(t, "%s %-5s %-22s %s%s" % (module.name, "write" if write else "read", module.reg_name(part_reg),
+                                          " ".join("%02X" % b for b in part_data[:16]) + (" ..." if len(part_data) > 16 else ""),
+                                          "" if crc_ok else "  CRC ERROR"))
+    if naks:
+      self.log(t, "%s: %d data NAK(s)" % (module.name, naks))
+
+  def split_registers(self, module, reg, prefix, data):
+    #split transferred data into registers by the register sizes (consecutive addresses), checking CRCs like module_interface_i2c.cpp
+    crc_bytes = 1 if module.use_crc else 0
+    parts = []
+    offset = 0
+    current = reg
+    while offset < len(data):
+      size = module.reg_size(current)
+      if size is None or offset + size + crc_bytes > len(data):
+        break
+      parts.append((current, data[offset:offset + size + crc_bytes]))
+      offset += size + crc_bytes
+      current += 1
+    if offset != len(data) or not parts:
+      #doesn't match the register sizes (partial access): treat everything as one access of the first register
+      parts = [(reg, data)]
+
+    result = []
+    for index, (part_reg, part) in enumerate(parts):
+      if not module.use_crc:
+        result.append((part_reg, part, True))
+        continue
+      #the first register's CRC includes the address and register bytes, the following ones only cover their own data
+      crc = crc8(prefix) if index == 0 else 0
+      result.append((part_reg, part[:-1], len(part) > 0 and crc8(part, crc) == 0))
+    return result
+
+  def eeprom_access(self, t, address, data, write):
+    if address + len(data) > eeprom_size_total:
+      self.framing_errors += 1
+      return
+    self.eeprom_image[address:address + len(data)] = bytes(data)
+    if address >= eeprom_storage_start:
+      if not write and address == eeprom_storage_start:
+        #first section read of a full load (EEPROMInterface::ReadAllSections): the storage contents are known from here on
+        self.eeprom_known = bytearray(eeprom_size_total)
+        self.eeprom_loaded = True
+      for i in range(address, address + len(data)):
+        self.eeprom_known[i] = 1
+    if address == 0 and len(data) >= eeprom_storage_start:
+      self.eeprom_check(t, write)
+
+  def eeprom_check(self, t, write):
+    #header CRC over header (excluding CRC), then all storage section data in order - section padding is never transferred
+    crc = crc32(self.eeprom_image[eeprom_header_version:eeprom_storage_start])
+    known = [i for i in range(eeprom_storage_start, eeprom_size_total) if self.eeprom_known[i]]
+    crc = crc32(bytes(self.eeprom_image[i] for i in known), crc)
+    crc = crc32(self.eeprom_image[eeprom_header_crc:eeprom_header_crc + 4], crc)
+    version = struct.unpack("<I", bytes(self.eeprom_image[eeprom_header_version:eeprom_header_version + 4]))[0]
+    if crc == 0:
+      result = "ok"
+    elif not self.eeprom_loaded:
+      result = "incomplete (storage contents not fully captured)"
+    else:
+      result = "MISMATCH"
+    self.eeprom_results.append((t, write, version, len(known), result))
+    self.log(t, "EEPROM header %s: version %d, CRC-32 over %d storage bytes %s" % ("write" if write else "read", version, len(known), result))
+
+  def log(self, t, text):
+    if self.verbose:
+      print("%10.4f  %s" % (t, text))
+
+  def dump(self, trans):
+    return " ".join(("[S %02X%s]" % (s[0], "" if s[1] else " NAK") + "".join(" %02X" % b for b, _ in s[2])) if s is not None else "[S]"
+                    for s in trans.segments)
+
+
+def report(analyzer, timed):
+  duration = (analyzer.last_time - analyzer.first_time) if analyzer.transactions > 1 else 0.0
+  print("%d transactions in %.3f s%s, bit rate %.1f kHz" % (analyzer.transactions, duration, "" if timed else " of bus time (raw stream, untimed)",
+                                                            analyzer.bitrate / 1e3))
+  if timed and duration > 0.0:
+    print("bus utilisation %.2f %% (%.3f s bus time)" % (100 * analyzer.bus_time / duration, analyzer.bus_time))
+  print("framing errors %d, address NAKs %d" % (analyzer.framing_errors, analyzer.address_naks))
+  for address, count in sorted(analyzer.unknown.items()):
+    print("unknown device 0x%02X: %d transactions" % (address, count))
+  print()
+
+  print("%-9s %-22s %7s %6s %6s %8s %8s %6s %9s %9s %9s %4s %4s" % ("module", "register", "access", "reads", "writes", "bytes", "B/s", "bus %",
+                                                                     "mean int", "max int", "readback", "CRC", "NAK"))
+  rows = sorted(analyzer.registers.items(), key=lambda item: -item[1].bus_time)
+  modules = {module.name: module for module in analyzer.modules.values()}
+  for (name, reg), stats in rows:
+    intervals = [b - a for a, b in zip(stats.times, stats.times[1:])]
+    reg_name = modules[name].reg_name(reg) if reg is not None else "(address)"
+    print("%-9s %-22s %7d %6d %6d %8d %8.1f %6.2f %9s %9s %9s %4d %4d" % (
+      name, reg_name, stats.reads + stats.writes, stats.reads, stats.writes, stats.bytes,
+      stats.bytes / duration if duration > 0.0 else 0.0, 100 * stats.bus_time / duration if duration > 0.0 else 0.0,
+      "%.1f ms" % (1e3 * sum(intervals) / len(intervals)) if intervals else "-", "%.1f ms" % (1e3 * max(intervals)) if intervals else "-",
+      "%.1f ms" % (1e3 * sum(stats.readback) / len(stats.readback)) if stats.readback else "-", stats.crc_errors, stats.naks))
+
+  if analyzer.eeprom_results:
+    print()
+    print("EEPROM header accesses:")
+    for t, write, version, known, result in analyzer.eeprom_results:
+      print("  %10.4f  %-5s version %d, CRC-32 over header and %d storage bytes: %s" % (t, "write" if write else "read", version, known, result))
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Decode and analyse I2C captures of the BlockBox main bus")
+  parser.add_argument("capture", help="capture file from i2ccapture, or - for stdin")
+  parser.add_argument("--raw", action="store_true", help="input is a raw I2CDriver capture stream without timestamps")
+  parser.add_argument("--bitrate", type=float, default=100e3, help="I2C bit rate in Hz, for bus time (default 100 kHz)")
+  parser.add_argument("-v", "--verbose", action="store_true", help="print every decoded transaction")
+  args = parser.parse_args()
+
+  analyzer = Analyzer(load_modules(), args.bitrate, args.verbose)
+  f = sys.stdin.buffer if args.capture == "-" else open(args.capture, "rb")
+  try:
+    for trans in decode_transactions(decode_events(read_chunks(f, args.raw))):
+      analyzer.transaction(trans)
+  except KeyboardInterrupt:
+    pass
+  finally:
+    if f is not sys.stdin.buffer:
+      f.close()
+  if analyzer.verbose:
+    print()
+  report(analyzer, not args.raw)
+
+
+if __name__ == "__main__":
+  main()
@@ -0,0 +1,175 @@
+// Linux command-line I2C bus capture using the I2CDriver capture mode.
+// Records the raw capture symbol stream (see i2c_capture in i2cdriver.c) into a capture file, with a host timestamp per received chunk,
+// for decoding and analysis with i2c_analyze.py (also offline).
+//
+// Capture file format: magic "I2CCAP1\n", followed by records of
+//   uint64 little-endian: host time of the chunk's arrival in us, relative to the capture start
+//   uint32 little-endian: chunk length in bytes
+//   chunk bytes: raw capture symbols, two per byte (high nibble first)
+//
+// The I2CDriver does not timestamp the capture stream, so the time resolution is limited by the USB serial latency timer
+// (default 16 ms on FTDI devices; set /sys/bus/usb-serial/devices/ttyUSBx/latency_timer to 1 for 1 ms).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "i2cdriver.h"
+
+#define CAPTURE_MAGIC "I2CCAP1\n"
+#define CAPTURE_CHUNK_SIZE 4096
+#define CAPTURE_POLL_MS 100
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static int write_record(FILE* f, uint64_t time_us, const uint8_t* data, uint32_t length)
+{
+    uint8_t header[12];
+    int i;
+    for (i = 0; i < 8; i++)
+        header[i] = (uint8_t)(time_us >> (8 * i));
+    for (i = 0; i < 4; i++)
+        header[8 + i] = (uint8_t)(length >> (8 * i));
+    if (fwrite(header, 1, sizeof(header), f) != sizeof(header))
+        return -1;
+    if (fwrite(data, 1, length, f) != length)
+        return -1;
+    return 0;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s <port> [-o <file>|-] [-t <seconds>]\n"
+        "  <port>        I2CDriver serial port, e.g. /dev/ttyUSB0\n"
+        "  -o <file>     capture file to write (default: capture.i2ccap, '-' for stdout)\n"
+        "  -t <seconds>  stop after the given time (default: until Ctrl+C)\n",
+        name);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* port = NULL;
+    const char* out_name = "capture.i2ccap";
+    double duration = 0.0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_name = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && port == NULL) {
+            port = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (port == NULL) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    I2CDriver sd;
+    i2c_connect(&sd, port);
+    if (!sd.connected) {
+        fprintf(stderr, "Could not connect to I2CDriver on %s\n", port);
+        return 1;
+    }
+    fprintf(stderr, "Connected to %s (serial %s), I2C speed %u kHz, SDA %u SCL %u\n", sd.model, sd.serial, sd.speed, sd.sda, sd.scl);
+
+    FILE* out = (strcmp(out_name, "-") == 0) ? stdout : fopen(out_name, "wb");
+    if (out == NULL) {
+        perror(out_name);
+        i2c_disconnect(&sd);
+        return 1;
+    }
+    fwrite(CAPTURE_MAGIC, 1, strlen(CAPTURE_MAGIC), out);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    //capture until stopped, recording every chunk with its arrival time
+    uint8_t chunk[CAPTURE_CHUNK_SIZE];
+    uint64_t total_bytes = 0, chunks = 0;
+    int error = 0;
+    i2c_capture_start(&sd);
+    uint64_t start_us = monotonic_us();
+    uint64_t end_us = start_us + (uint64_t)(duration * 1e6);
+
+    while (!stop_requested) {
+        uint64_t now_us = monotonic_us();
+        if (duration > 0.0 && now_us >= end_us)
+            break;
+
+        struct pollfd pfd = { .fd = sd.port, .events = POLLIN };
+        int ready = poll(&pfd, 1, CAPTURE_POLL_MS);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            error = 1;
+            break;
+        }
+        if (ready == 0)
+            continue;
+
+        ssize_t n = read(sd.port, chunk, sizeof(chunk));
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            perror("read");
+            error = 1;
+            break;
+        }
+        if (n == 0)
+            continue;
+
+        if (write_record(out, monotonic_us() - start_us, chunk, (uint32_t)n) != 0) {
+            perror("write");
+            error = 1;
+            break;
+        }
+        total_bytes += (uint64_t)n;
+        chunks++;
+    }
+
+    //leave capture mode, so the device accepts commands again
+    uint8_t leave = '@';
+    write(sd.port, &leave, 1);
+    double elapsed = (double)(monotonic_us() - start_us) * 1e-6;
+
+    if (out != stdout)
+        fclose(out);
+    else
+        fflush(out);
+    i2c_disconnect(&sd);
+
+    fprintf(stderr, "Captured %.1f s: %" PRIu64 " bytes (%" PRIu64 " symbols) in %" PRIu64 " chunks, %.1f kB/s\n",
+        elapsed, total_bytes, 2 * total_bytes, chunks, elapsed > 0.0 ? (double)total_bytes / elapsed / 1e3 : 0.0);
+    return error;
+}
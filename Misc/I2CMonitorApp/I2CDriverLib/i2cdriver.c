@@ -163,7 +163,7 @@ int readFromSerialPort(int fd, uint8_t* b, size_t s)
     ssize_t n, t;
     t = 0;
     while (t < s) {
-        n = read(fd, b + t, s);
+        n = read(fd, b + t, s - t);
         if (n > 0)
             t += n;
     }
@@ -401,10 +401,16 @@ void i2c_monitor(I2CDriver* sd, int enable)
     charCommand(sd, enable ? 'm' : '@');
 }
 
+// Enter capture mode: the device then streams the raw capture symbols (4 bits each, see i2c_capture) until '@' is sent
+void i2c_capture_start(I2CDriver* sd)
+{
+    charCommand(sd, 'c');
+}
+
 void i2c_capture(I2CDriver* sd)
 {
     printf("Capture started\n");
-    charCommand(sd, 'c');
+    i2c_capture_start(sd);
     uint8_t bytes[1];
 
     int starting = 0;
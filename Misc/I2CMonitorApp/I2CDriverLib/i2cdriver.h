@@ -2,11 +2,15 @@
 
 #include <stdint.h>
 
+#if defined(WIN32)
 #ifdef I2CDRIVERLIB_EXPORTS
 #define I2CDRVLIB_API __declspec(dllexport)
 #else
 #define I2CDRVLIB_API __declspec(dllimport)
 #endif
+#else
+#define I2CDRVLIB_API
+#endif
 
 #if defined(WIN32)
 #include <windows.h>
@@ -48,6 +52,7 @@ I2CDRVLIB_API void i2c_regrd(I2CDriver* sd, uint8_t dev, uint8_t reg, uint8_t by
 
 I2CDRVLIB_API void i2c_monitor(I2CDriver* sd, int enable);
 I2CDRVLIB_API void i2c_capture(I2CDriver* sd);
+I2CDRVLIB_API void i2c_capture_start(I2CDriver* sd);
 
 I2CDRVLIB_API void i2c_pullups(I2CDriver* sd, uint8_t pullups);
 
@@ -8,6 +8,8 @@
 #define PCH_H
 
 // add headers that you want to pre-compile here
+#if defined(WIN32)
 #include "framework.h"
+#endif
 
 #endif //PCH_H
@@ -0,0 +1,111 @@
+# Generates the evenly-spaced lookup tables in bat_calculations.c (BatteryMonitor_Controller) from the B-spline fits of volt_to_chg.py and volt_to_eng.py.
+# Tables: voltage-to-charge, voltage-to-energy (linear interpolation), and charge-to-OCV with per-interval slope (for the SoC Kalman filter).
+# Prints the C table definitions and the worst-case interpolation error against the spline.
+
+import matplotlib.pyplot as plt
+
+
+# spline fits (knots, control points, degree 3), as output by volt_to_chg.py and volt_to_eng.py
+chg_t = [3.0, 3.0, 3.0, 3.0, 3.15, 3.29, 3.33, 3.37, 3.44, 3.51, 3.58, 3.66, 3.73, 3.87, 3.94, 4.01, 4.15, 4.15, 4.15, 4.15]
+chg_c = [-0.00355509, 0.02089707, 0.00316649, 0.1122161, 0.31671303, 0.37414911, 0.51521049, 0.7574718, 1.21999862, 1.53247019, 1.75656568,
+         2.0588198, 2.38977397, 2.56745534, 2.85180031, 2.86877747]
+eng_t = [3.0, 3.0, 3.0, 3.0, 3.15, 3.22, 3.26, 3.29, 3.44, 3.51, 3.58, 3.62, 3.66, 3.73, 3.8, 3.87, 3.94, 4.01, 4.08, 4.12, 4.15, 4.15, 4.15, 4.15]
+eng_c = [-2.87436676e-03, 1.81383671e-02, 5.72841288e-02, 1.91419519e-01, 3.76504645e-01, 1.05089374e+00, 1.28755469e+00, 2.51121639e+00,
+         3.87105895e+00, 4.65901708e+00, 5.38827784e+00, 5.97712740e+00, 6.62516653e+00, 7.65197748e+00, 8.52844471e+00, 9.11782949e+00,
+         9.92152850e+00, 1.03378326e+01, 1.04702242e+01, 1.05222716e+01]
+degree = 3
+
+cell_charge_max = 2.874
+
+voltage_min = 3.0
+voltage_max = 4.15
+voltage_points = 47       # 25 mV steps
+charge_points = 33
+
+
+def de_boor(x, t, c, p):
+  #same evaluation as the former firmware implementation (clipped to range, negative results clipped to 0)
+  if x <= t[0]:
+    x = t[0]
+    k = p
+  elif x >= t[-1]:
+    x = t[-1]
+    k = len(t) - p - 2
+  else:
+    k = p
+    while k < len(t) - p - 2 and x > t[k + 1]:
+      k += 1
+  d = [c[j + k - p] for j in range(p + 1)]
+  for r in range(1, p + 1):
+    for j in range(p, r - 1, -1):
+      alpha = (x - t[j + k - p]) / (t[j + 1 + k - r] - t[j + k - p])
+      d[j] = (1.0 - alpha) * d[j - 1] + alpha * d[j]
+  return max(d[p], 0.0)
+
+
+def lookup(x, table, x_min, x_step):
+  pos = (x - x_min) / x_step
+  if pos <= 0.0:
+    return table[0]
+  if pos >= len(table) - 1:
+    return table[-1]
+  i = int(pos)
+  return table[i] + (pos - i) * (table[i + 1] - table[i])
+
+
+def print_table(name, values, per_line=8):
+  print("static const float %s[%d] = {" % (name, len(values)))
+  for i in range(0, len(values), per_line):
+    print("    " + ", ".join("%.6ff" % v for v in values[i:i + per_line]) + ("," if i + per_line < len(values) else ""))
+  print("};")
+
+
+voltage_step = (voltage_max - voltage_min) / (voltage_points - 1)
+volts = [voltage_min + i * voltage_step for i in range(voltage_points)]
+chg_table = [de_boor(v, chg_t, chg_c, degree) for v in volts]
+eng_table = [de_boor(v, eng_t, eng_c, degree) for v in volts]
+
+#charge-to-OCV: invert the (monotonised) voltage-to-charge spline on a fine voltage grid
+fine_volts = [voltage_min + i * (voltage_max - voltage_min) / 10000 for i in range(10001)]
+fine_chg = []
+for v in fine_volts:
+  q = de_boor(v, chg_t, chg_c, degree)
+  fine_chg.append(max(q, fine_chg[-1] if fine_chg else 0.0))
+
+def charge_to_ocv(q):
+  for i in range(1, len(fine_chg)):
+    if fine_chg[i] >= q and fine_chg[i] > fine_chg[i - 1]:
+      frac = (q - fine_chg[i - 1]) / (fine_chg[i] - fine_chg[i - 1])
+      return fine_volts[i - 1] + max(min(frac, 1.0), 0.0) * (fine_volts[i] - fine_volts[i - 1])
+  return voltage_max
+
+charge_step = cell_charge_max / (charge_points - 1)
+charges = [i * charge_step for i in range(charge_points)]
+ocv_table = [charge_to_ocv(q) for q in charges]
+ocv_slopes = [(ocv_table[i + 1] - ocv_table[i]) / charge_step for i in range(charge_points - 1)]
+
+
+if __name__ == "__main__":
+  #interpolation errors against the spline
+  test_volts = [voltage_min + i * (voltage_max - voltage_min) / 2000 for i in range(2001)]
+  chg_err = max(abs(lookup(v, chg_table, voltage_min, voltage_step) - de_boor(v, chg_t, chg_c, degree)) for v in test_volts)
+  eng_err = max(abs(lookup(v, eng_table, voltage_min, voltage_step) - de_boor(v, eng_t, eng_c, degree)) for v in test_volts)
+  test_charges = [i * cell_charge_max / 2000 for i in range(2001)]
+  ocv_err = max(abs(lookup(q, ocv_table, 0.0, charge_step) - charge_to_ocv(q)) for q in test_charges)
+  #error outside of the steep knee at the very bottom (first table interval, below ~3.2V), where the filter relies on the charge counter anyway
+  ocv_err_main = max(abs(lookup(q, ocv_table, 0.0, charge_step) - charge_to_ocv(q)) for q in test_charges if q >= charge_step)
+
+  print("//max interpolation errors: voltage-to-charge %.2f mAh, voltage-to-energy %.2f mWh, charge-to-OCV %.2f mV (%.2f mV above first interval)" %
+        (chg_err * 1e3, eng_err * 1e3, ocv_err * 1e3, ocv_err_main * 1e3))
+  print_table("bat_voltageToCharge_table", chg_table)
+  print_table("bat_voltageToEnergy_table", eng_table)
+  print_table("bat_chargeToOCV_table", ocv_table)
+  print_table("bat_chargeToOCV_slope_table", ocv_slopes)
+
+
+  plt.plot(charges, ocv_table, marker=".", label="charge-to-OCV table")
+  plt.plot([de_boor(v, chg_t, chg_c, degree) for v in test_volts], test_volts, label="voltage-to-charge spline")
+  plt.xlabel("charge [Ah]")
+  plt.ylabel("voltage [V]")
+  plt.legend()
+  plt.show()
@@ -0,0 +1,177 @@
+# Simulation of the BMS state-of-charge estimation (BatteryMonitor_Controller bms.c) on synthetic discharge profiles.
+# Compares the former approach (EMA-smoothed voltage reference points at low current, then pure charge counting) with the Kalman filter
+# (charge counter prediction, corrected by the current-compensated cell voltage through the charge-to-OCV table).
+# The simulated cell has a different resistance and an additional RC polarisation stage, the charge counter has gain and offset errors.
+
+import math
+import random
+import matplotlib.pyplot as plt
+from ocv_lut import lookup, charge_to_ocv, chg_table, ocv_table, ocv_slopes, voltage_min, voltage_step, charge_step, cell_charge_max
+
+
+dt = 1.0                       # measurement period (BMS_LOOP_PERIOD_MEASUREMENTS)
+
+# simulated cell
+cell_r0 = 0.06
+cell_r1 = 0.03
+cell_tau1 = 60.0
+voltage_noise = 0.003
+counter_gain_error = 0.005
+counter_offset = 0.002         # A
+
+# firmware parameters (bat_calculations.c, bms.h)
+curves_current = -0.2
+model_r0 = 0.05
+valid_current = 0.2
+smoothing_alpha = 0.03
+current_init_factor = 1.4
+old_charge_difference_max = 0.15
+kf_init_stddev = 0.3
+kf_counter_gain_error = 0.01
+kf_counter_offset = 0.0002
+kf_voltage_stddev = 0.01
+kf_voltage_stddev_per_amp = 1.0
+kf_converged_stddev = 0.1
+
+
+def voltage_to_charge(v):
+  return lookup(v, chg_table, voltage_min, voltage_step)
+
+def charge_to_ocv_table(q):
+  pos = max(min(q / charge_step, len(ocv_table) - 1), 0.0)
+  i = min(int(pos), len(ocv_table) - 2)
+  return ocv_table[i] + (pos - i) * (ocv_table[i + 1] - ocv_table[i]), ocv_slopes[i]
+
+
+class Cell:
+  def __init__(self, charge, rng):
+    self.charge = charge
+    self.v_rc = 0.0
+    self.counter = 0.0
+    self.rng = rng
+
+  def step(self, current):
+    self.charge = max(min(self.charge + current * dt / 3600.0, cell_charge_max), 0.0)
+    self.v_rc += (current * cell_r1 - self.v_rc) * (1.0 - math.exp(-dt / cell_tau1))
+    self.counter += (current * (1.0 + counter_gain_error) + counter_offset) * dt / 3600.0
+    #curves were recorded at the reference current, so the true OCV is above the curve by the reference drop
+    ocv = charge_to_ocv(self.charge) - curves_current * cell_r0
+    voltage = ocv + current * cell_r0 + self.v_rc + self.rng.gauss(0.0, voltage_noise)
+    return round(voltage * 1000.0) / 1000.0, current + self.rng.gauss(0.0, 0.005), self.counter
+
+
+class OldEstimator:
+  def __init__(self):
+    self.current_smoothed = None
+    self.voltage_smoothed = None
+    self.level = 0
+    self.reference = 0.0
+    self.counter_base = 0.0
+
+  def step(self, voltage, current, counter):
+    if self.current_smoothed is None:
+      self.current_smoothed = (1.0 if current > 0 else -1.0) * valid_current * current_init_factor
+      self.voltage_smoothed = voltage
+    else:
+      self.current_smoothed = smoothing_alpha * current + (1.0 - smoothing_alpha) * self.current_smoothed
+      self.voltage_smoothed = smoothing_alpha * voltage + (1.0 - smoothing_alpha) * self.voltage_smoothed
+    if abs(self.current_smoothed) <= valid_current:
+      estimated = voltage_to_charge(self.voltage_smoothed)
+      if self.level == 0 or abs(self.reference + counter - self.counter_base - estimated) > old_charge_difference_max:
+        self.reference = estimated
+        self.counter_base = counter
+        self.level = 1
+    if self.level == 0:
+      return voltage_to_charge(voltage) if abs(current) <= valid_current else None
+    return self.reference + counter - self.counter_base
+
+
+class KalmanEstimator:
+  def __init__(self):
+    self.charge = None
+    self.variance = 0.0
+    self.prev_counter = 0.0
+
+  def step(self, voltage, current, counter):
+    if self.charge is None:
+      self.charge = voltage_to_charge(voltage - (current - curves_current) * model_r0)
+      self.variance = kf_init_stddev ** 2
+      self.prev_counter = counter
+      return self.charge
+    delta = counter - self.prev_counter
+    self.prev_counter = counter
+    self.charge += delta
+    self.variance += (kf_counter_gain_error * delta) ** 2 + kf_counter_offset ** 2
+    expected, slope = charge_to_ocv_table(self.charge)
+    expected += (current - curves_current) * model_r0
+    stddev = kf_voltage_stddev + kf_voltage_stddev_per_amp * abs(current)
+    gain = self.variance * slope / (slope * slope * self.variance + stddev * stddev)
+    self.charge += gain * (voltage - expected)
+    self.variance *= 1.0 - gain * slope
+    self.charge = max(min(self.charge, cell_charge_max), 0.0)
+    return self.charge
+
+
+# per-cell current profiles (negative = discharge), one value per second
+def profile_constant(rng):
+  return [-1.0] * 7200
+
+def profile_music(rng):
+  currents = []
+  while len(currents) < 9000:
+    level = rng.choice([0.0, -0.3, -0.8, -1.5])
+    for k in range(int(rng.uniform(60, 600))):
+      currents.append(level * rng.uniform(0.3, 1.7))
+  return currents[:9000]
+
+def profile_load_change(rng):
+  return [-0.05] * 600 + [-2.0] * 1800 + [-0.05] * 1800 + [-1.0] * 1800
+
+profiles = [
+  ("constant 1A discharge from 90%", 0.9, profile_constant),
+  ("music-like discharge from 70%", 0.7, profile_music),
+  ("rest / 2A load / rest / 1A load from 60%", 0.6, profile_load_change),
+]
+
+
+fig, axes = plt.subplots(len(profiles), 1)
+for (name, start, profile), ax in zip(profiles, axes):
+  rng = random.Random(2)
+  currents = profile(rng)
+  cell = Cell(start * cell_charge_max, rng)
+  old = OldEstimator()
+  kf = KalmanEstimator()
+  true_trace, old_trace, kf_trace = [], [], []
+  for current in currents:
+    voltage, measured_current, counter = cell.step(current)
+    true_trace.append(cell.charge)
+    old_trace.append(old.step(voltage, measured_current, counter))
+    kf_trace.append(kf.step(voltage, measured_current, counter))
+
+  def stats(trace):
+    errors = [abs(e - t) for e, t in zip(trace, true_trace) if e is not None]
+    unknown = sum(1 for e in trace if e is None)
+    if len(errors) == 0:
+      return "no estimate"
+    #settling: first time after which the error stays within 50 mAh
+    settled = len(trace)
+    while settled > 0 and trace[settled - 1] is not None and abs(trace[settled - 1] - true_trace[settled - 1]) <= 0.05:
+      settled -= 1
+    return "mean error %5.1f mAh, max error %6.1f mAh, %4d s without estimate, within 50 mAh after %s" % (
+      1e3 * sum(errors) / len(errors), 1e3 * max(errors), unknown, ("%d s" % settled) if settled < len(trace) else "never")
+
+  print("%s:" % name)
+  print("  former estimator: " + stats(old_trace))
+  print("  Kalman filter:    " + stats(kf_trace))
+
+  t = [k * dt / 60.0 for k in range(len(currents))]
+  ax.plot(t, true_trace, label="true charge")
+  ax.plot(t, [e if e is not None else float("nan") for e in old_trace], label="former estimator")
+  ax.plot(t, kf_trace, label="Kalman filter")
+  ax.set_title(name)
+  ax.set_ylabel("charge [Ah]")
+  ax.legend()
+
+axes[-1].set_xlabel("time [min]")
+plt.tight_layout()
+plt.show()
@@ -0,0 +1,204 @@
+# Host-side replay of the BlockBox battery runtime estimation (PowerManager battery time estimation) on synthetic discharge traces.
+# Traces are per-second battery discharge power (BMS stack voltage x current) of music playback: a base load plus amplifier power that follows
+# the music envelope, song loudness, song gaps and volume, with pauses, volume changes and PVDD target changes. Compares:
+#  - former: 60 s EMA of the discharge power, estimate only shown while the EMA is within 1.5x of the latest measurement
+#  - load history: decaying histogram of 1-minute average discharge power (multi-timescale: 1 s samples, 60 s EMA for the first minutes,
+#    ~20 min history), with faster fading of the history on large volume or PVDD target changes; the estimate uses the histogram mean,
+#    the confidence bounds the 10th/90th percentile of the 1-minute averages
+# Reports how often an estimate is shown, how often the displayed value (rounded down to 10 min, like the power settings screen) changes,
+# the error against the true remaining time of the trace, and how often the true time is within the bounds.
+
+import math
+import random
+
+
+# former estimation constants (power_manager.cpp)
+ema_1malpha = 0.999833       # per 10 ms main loop cycle
+max_pwr_ratio = 1.5
+reinit_pwr_ratio = 3.0
+
+# load history constants
+hist_bins = 16
+hist_min_W = 1.0             # lower edge of bin 1, bins spaced by sqrt(2) (bin 0: everything below)
+hist_tau_min = 20.0          # history time constant, in 1-minute samples
+hist_regime_weight = 0.25    # history weight kept on a large volume/PVDD target change
+regime_volume_dB = 3.0
+regime_pvdd_V = 2.0
+hist_min_samples = 3.0       # minimum history weight for a histogram estimate, in 1-minute samples
+fast_min_s = 60              # minimum discharge time for any estimate (60 s EMA), in s
+fast_bounds = 0.5            # relative bounds of the fast estimate before the histogram is ready
+percentile_low = 0.1
+percentile_high = 0.9
+min_bounds = 0.1             # minimum relative bounds (SoC energy uncertainty, load changes within a histogram bin)
+
+
+def make_trace(rng, kind, battery_Wh):
+  #returns per-second (power W, volume dB, PVDD target V) until the battery energy is used up
+  base_W = 3.5
+  trace = []
+  energy = battery_Wh * 3600.0
+  volume = { "party": -12.0, "background": -30.0, "volume step": -24.0, "pauses": -18.0 }[kind]
+  t = 0
+  song_left, song_gain, gap_left = 0, 1.0, 0
+  pause_left = 0
+  envelope = 1.0
+  while energy > 0.0:
+    if kind == "volume step" and t == 45 * 60:
+      volume = -8.0
+    if kind == "party" and t > 0 and t % (25 * 60) == 0:
+      volume = min(max(volume + rng.choice((-3.0, 3.0)), -15.0), -9.0)
+    if kind == "pauses" and pause_left == 0 and rng.random() < 1.0 / (40 * 60):
+      pause_left = rng.randint(5 * 60, 20 * 60)
+
+    if song_left == 0 and gap_left == 0:
+      song_left = rng.randint(150, 300)
+      song_gain = rng.uniform(0.5, 1.5)
+      gap_left = rng.randint(1, 4)
+    playing = pause_left == 0 and song_left > 0
+    if pause_left > 0:
+      pause_left -= 1
+    elif song_left > 0:
+      song_left -= 1
+    else:
+      gap_left -= 1
+
+    #music envelope: slowly varying loudness with per-second fluctuation (beats, sections)
+    envelope = 0.95 * envelope + 0.05 * rng.lognormvariate(0.0, 0.6)
+    amp_W = 60.0 * 10 ** (volume / 10.0) * song_gain * envelope * rng.lognormvariate(0.0, 0.5) if playing else 0.0
+    #PVDD tracking: target follows the volume, idle amplifier losses scale with it
+    pvdd = min(max(12.0 + 0.8 * (volume + 30.0), 12.0), 36.0)
+    power = base_W + 0.04 * pvdd + amp_W
+    trace.append((power, volume, pvdd))
+    energy -= power
+    t += 1
+  return trace
+
+
+def true_remaining(trace):
+  remaining = [0.0] * len(trace)
+  for t in range(len(trace) - 1, -1, -1):
+    remaining[t] = (remaining[t + 1] if t + 1 < len(trace) else 0.0) + 1.0
+  return remaining
+
+
+class Former:
+  def __init__(self):
+    self.inst = 0.0
+    self.avg = 0.0
+
+  def sample(self, power, volume, pvdd):
+    self.inst = power
+    ratio = power / self.avg if self.avg > 0.0 else math.nan
+    if math.isnan(ratio) or ratio > reinit_pwr_ratio or ratio < 1.0 / reinit_pwr_ratio:
+      self.avg = power
+    #one sample lasts 100 main loop cycles
+    self.avg = power + (self.avg - power) * ema_1malpha ** 100
+
+  def estimate(self, energy_J):
+    ratio = self.avg / self.inst if self.inst > 0.0 else math.nan
+    if math.isnan(ratio) or ratio > max_pwr_ratio or ratio < 1.0 / max_pwr_ratio:
+      return None
+    time = energy_J / self.avg
+    return (time, time, time)
+
+
+class LoadHistory:
+  def __init__(self):
+    self.weights = [0.0] * hist_bins
+    self.energies = [0.0] * hist_bins
+    self.fast = 0.0
+    self.seconds = 0
+    self.minute_sum = 0.0
+    self.minute_count = 0
+    self.last_volume = None
+    self.last_pvdd = None
+    self.decay = math.exp(-1.0 / hist_tau_min)
+
+  def bin_of(self, power):
+    if power < hist_min_W:
+      return 0
+    return min(1 + int(2.0 * math.log2(power / hist_min_W)), hist_bins - 1)
+
+  def sample(self, power, volume, pvdd):
+    self.seconds += 1
+    self.fast = power if self.seconds == 1 else power + (self.fast - power) * ema_1malpha ** 100
+
+    #large volume or PVDD target changes: the history no longer represents the coming load, fade it
+    if self.last_volume is not None and (abs(volume - self.last_volume) >= regime_volume_dB or abs(pvdd - self.last_pvdd) >= regime_pvdd_V):
+      self.weights = [w * hist_regime_weight for w in self.weights]
+      self.energies = [e * hist_regime_weight for e in self.energies]
+      self.last_volume, self.last_pvdd = volume, pvdd
+    elif self.last_volume is None:
+      self.last_volume, self.last_pvdd = volume, pvdd
+
+    self.minute_sum += power
+    self.minute_count += 1
+    if self.minute_count == 60:
+      average = self.minute_sum / 60.0
+      self.weights = [w * self.decay for w in self.weights]
+      self.energies = [e * self.decay for e in self.energies]
+      index = self.bin_of(average)
+      self.weights[index] += 1.0
+      self.energies[index] += average
+      self.minute_sum, self.minute_count = 0.0, 0
+
+  def percentile(self, fraction, total):
+    target = fraction * total
+    cumulative = 0.0
+    for w, e in zip(self.weights, self.energies):
+      if w > 0.0 and cumulative + w >= target:
+        return e / w
+      cumulative += w
+    return self.energies[-1] / self.weights[-1]
+
+  def estimate(self, energy_J):
+    if self.seconds < fast_min_s:
+      return None
+    total = sum(self.weights)
+    if total < hist_min_samples:
+      time = energy_J / self.fast
+      return (time, time * (1.0 - fast_bounds), time * (1.0 + fast_bounds))
+    time = energy_J * total / sum(self.energies)
+    return (time, min(energy_J / self.percentile(percentile_high, total), time * (1.0 - min_bounds)),
+            max(energy_J / self.percentile(percentile_low, total), time * (1.0 + min_bounds)))
+
+
+def replay(trace, estimator, battery_Wh):
+  remaining = true_remaining(trace)
+  energy = battery_Wh * 3600.0
+  shown, changes, errors, covered, samples = 0, 0, [], 0, 0
+  last_display = None
+  for t, (power, volume, pvdd) in enumerate(trace):
+    energy -= power
+    estimator.sample(power, volume, pvdd)
+    if t % 10 != 0 or remaining[t] < 1800.0:
+      continue
+    samples += 1
+    estimate = estimator.estimate(energy)
+    #power settings screen: shown if 60 s <= time <= 99 h, rounded down to 10 min
+    display = None
+    if estimate is not None and 60.0 <= estimate[0] < 100 * 3600.0:
+      display = int(estimate[0] // 600)
+      shown += 1
+      errors.append(abs(estimate[0] - remaining[t]) / remaining[t])
+      if estimate[1] <= remaining[t] <= estimate[2]:
+        covered += 1
+    if display != last_display:
+      changes += 1
+    last_display = display
+  hours = len(trace) / 3600.0
+  return shown / samples, changes / hours, sum(errors) / max(len(errors), 1), covered / max(shown, 1)
+
+
+battery_Wh = 90.0
+runs = 10
+for kind in ("party", "background", "volume step", "pauses"):
+  print("%s:" % kind)
+  for name, factory in (("former", Former), ("load history", LoadHistory)):
+    totals = [0.0, 0.0, 0.0, 0.0]
+    for k in range(runs):
+      trace = make_trace(random.Random(k), kind, battery_Wh)
+      for i, value in enumerate(replay(trace, factory(), battery_Wh)):
+        totals[i] += value / runs
+    print("  %-13s estimate shown %5.1f %% of the time, display changes %5.1f /h, mean error %5.1f %%, true time within bounds %5.1f %%" % (
+      name + ":", 100 * totals[0], totals[1], 100 * totals[2], 100 * totals[3]))
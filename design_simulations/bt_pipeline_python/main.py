@@ -0,0 +1,97 @@
+# Host-side model of the Bluetooth module command scheduling in the BluetoothReceiver controller (bt_driver.c), without hardware.
+# Compares the former serial scheduling (one command in flight, BT_CMD_DELAY after each completion) with pipelined scheduling
+# (up to BT_CMD_PIPELINE_DEPTH pipelinable commands in flight, BT_CMD_PIPELINE_DELAY between them).
+# The module is modelled as processing received commands one after another, answering each after a per-command processing time.
+# Reports the init time (CONFIG, SET per changed config entry, WRITE) and the connection-to-audio latency (status reads after OPEN_OK).
+# Rough model only: response lines, the main loop period and the module reset after WRITE are not modelled. The driver itself is
+# tested against a simulated module in firmware/HostTest/BluetoothReceiver/test_bt_pipeline.c, which reports the durations to go by.
+
+import random
+
+
+# driver timing (bt_driver.h)
+cmd_delay = 0.150
+pipeline_depth = 4
+pipeline_delay = 0.010
+uart_baud = 9600   # huart6 (main.c, UART_CONFIG in bt_config.h)
+
+# module processing time per command type in s (min, max) - rough values from UART logs
+processing_time = {
+  "CONFIG": (0.080, 0.120),
+  "SET": (0.010, 0.030),
+  "WRITE": (0.150, 0.250),
+  "STATUS": (0.020, 0.040),
+  "NAME": (0.200, 0.800),     # requires a remote name request over the air
+  "RSSI": (0.005, 0.015),
+  "QUALITY": (0.005, 0.015),
+  "VOLUME": (0.005, 0.015),
+  "VOLUME_GET": (0.005, 0.015),
+}
+
+pipelinable = { "SET", "VOLUME", "RSSI", "QUALITY", "VOLUME_GET" }
+data_response = { "RSSI", "QUALITY", "VOLUME_GET" }
+
+
+def tx_time(command):
+  #approximate command length: keyword plus arguments (12-digit address or config entry)
+  return (len(command) + 16) * 10.0 / uart_baud
+
+
+def run(commands, pipelined, rng):
+  #returns the time at which the last command completed
+  t = 0.0
+  next_cmd = 0.0
+  module_free = 0.0
+  in_flight = []   # (command, completion time), oldest first
+  queue = list(commands)
+  while queue or in_flight:
+    #complete all commands that are done by now
+    while in_flight and in_flight[0][1] <= t:
+      in_flight.pop(0)
+      if not in_flight:
+        next_cmd = t + cmd_delay
+    can_send = False
+    if queue:
+      command = queue[0]
+      if not in_flight:
+        can_send = t >= next_cmd
+      elif pipelined and len(in_flight) < pipeline_depth and command in pipelinable and in_flight[0][0] in pipelinable:
+        can_send = t >= next_cmd and not (command in data_response and any(c == command for c, _ in in_flight))
+    if can_send:
+      queue.pop(0)
+      arrival = t + tx_time(command)
+      start = max(arrival, module_free)
+      module_free = start + rng.uniform(*processing_time[command])
+      in_flight.append((command, module_free))
+      next_cmd = t + (pipeline_delay if pipelined else 0.0)
+    #advance to the next event (1 ms resolution, like the driver loop)
+    t += 0.001
+  return t
+
+
+def make_init(changed_entries):
+  return ["CONFIG"] + ["SET"] * changed_entries + (["WRITE"] if changed_entries > 0 else [])
+
+def make_connect(name_known):
+  return ["STATUS"] + ([] if name_known else ["NAME"]) + ["RSSI", "QUALITY", "VOLUME_GET"]
+
+
+scenarios = [
+  ("init, config unchanged", make_init(0)),
+  ("init, 5 config entries changed", make_init(5)),
+  ("init, all 22 config entries changed (fresh module)", make_init(22)),
+  ("connect, device name known", make_connect(True)),
+  ("connect, device name unknown", make_connect(False)),
+  ("volume changes during playback (8 steps)", ["VOLUME"] * 8 + ["VOLUME_GET"]),
+]
+
+runs = 200
+for name, commands in scenarios:
+  results = []
+  for pipelined in (False, True):
+    rng = random.Random(1)
+    times = [run(commands, pipelined, rng) for k in range(runs)]
+    results.append((sum(times) / runs, max(times)))
+  print("%s (%d commands):" % (name, len(commands)))
+  print("  serial:    mean %6.0f ms, max %6.0f ms" % (results[0][0] * 1e3, results[0][1] * 1e3))
+  print("  pipelined: mean %6.0f ms, max %6.0f ms" % (results[1][0] * 1e3, results[1][1] * 1e3))
@@ -0,0 +1,88 @@
+# Host-side model of BlockBox controller event dispatch (event_source.cpp), without hardware.
+# Compares the former dispatch (scan of all registrations of the event source, mask test per registration) with the indexed dispatch
+# (one callback list per event bit, only matching registrations are visited).
+# Subscribers are the registrations in the current tree (GUI screens, managers, system), event rates are rough steady-state values
+# while powered on with output peak and SRC stats monitoring active. Larger subscriber sets are modelled by duplicating the registrations.
+# Reports registrations visited and callbacks called per second, and estimated CPU cycles per second for dispatch overhead.
+
+# cycles per visited registration (load, mask test, branch) and per list link (load registration index and next), rough Cortex-M7 values
+cycles_scan_visit = 8
+cycles_index_visit = 10
+cycles_call = 40      # std::function call and try/catch setup, excluding the callback body
+
+# registrations per event source: list of event masks (event names)
+subscribers = {
+  "dap_if": [
+    { "STATUS", "INPUTS", "RESET" },                                # AudioPathManager
+    { "OUTPUT_PEAKS" },                                             # AmpManager
+    { "STATUS", "INPUTS", "INPUT_RATE" },                           # MainScreen
+    { "SRC_STATS" },                                                # SettingsScreenAudio
+  ],
+  "dac_if": [
+    { "RESET" },                                                    # AudioPathManager
+    { "STATUS" },                                                   # system
+  ],
+  "amp_if": [
+    { "RESET", "STATUS", "SAFETY", "SPEAKER" },                     # AmpManager
+    { "PVDD", "MEASUREMENT" },                                      # SettingsScreenAudio
+    { "STATUS", "SAFETY", "PVDD", "MEASUREMENT" },                  # system
+  ],
+  "rtc_if": [
+    { "SECOND" },                                                   # SettingsScreenDisplay
+    { "MINUTE" },                                                   # PowerOffScreen
+    { "MINUTE" },                                                   # MainScreen
+  ],
+  "btrx_if": [
+    { "DEVICE" },                                                   # BlockBoxV2Screen
+    { "STATUS", "MEDIA_META", "DEVICE", "CONN_STATS", "CODEC" },    # MainScreen
+    { "STATUS", "VOLUME", "RESET" },                                # AudioPathManager
+    { "STATUS", "VOLUME", "MEDIA_META", "DEVICE", "CONN_STATS", "CODEC" },  # system
+  ],
+  "bat_if": [
+    { "PRESENCE", "SOC", "SHUTDOWN" },                              # BlockBoxV2Screen
+    { "PRESENCE", "VOLTAGE", "CURRENT", "SOC", "HEALTH" },          # SettingsScreenPower
+    { "PRESENCE", "STATUS", "VOLTAGE", "CURRENT", "SOC", "HEALTH", "TEMP", "SAFETY", "SHUTDOWN" },  # system
+  ],
+  "chg_if": [
+    { "PRESENCE" },                                                 # BlockBoxV2Screen
+    { "PRESENCE" },                                                 # SettingsScreenPower
+    { "PRESENCE", "LEARN" },                                        # system
+  ],
+  "audio_mgr": [
+    { "INPUT" },                                                    # BlockBoxV2Screen
+    { "INPUT", "VOLUME", "MUTE" },                                  # MainScreen
+    { "VOLUME" },                                                   # AmpManager
+  ],
+}
+
+# events per second per event source
+event_rates = {
+  "dap_if": { "REGISTER_UPDATE": 16, "STATUS": 2, "OUTPUT_PEAKS": 10, "SRC_STATS": 4, "INTERRUPT": 0.5 },
+  "dac_if": { "REGISTER_UPDATE": 2, "STATUS": 2 },
+  "amp_if": { "REGISTER_UPDATE": 30, "MEASUREMENT": 10, "PVDD": 10, "STATUS": 2, "SAFETY": 2, "SPEAKER": 1 },
+  "rtc_if": { "REGISTER_UPDATE": 1, "SECOND": 1, "MINUTE": 1 / 60 },
+  "btrx_if": { "REGISTER_UPDATE": 6, "STATUS": 2, "CONN_STATS": 1, "VOLUME": 0.2 },
+  "bat_if": { "REGISTER_UPDATE": 8, "VOLTAGE": 2, "CURRENT": 2, "SOC": 0.2, "HEALTH": 0.1 },
+  "chg_if": { "REGISTER_UPDATE": 2, "PRESENCE": 0.01 },
+  "audio_mgr": { "VOLUME": 0.5, "INPUT": 0.01 },
+}
+
+
+def dispatch_costs(scale):
+  scan_visits = index_visits = calls = 0.0
+  for source, rates in event_rates.items():
+    regs = subscribers.get(source, []) * scale
+    for event, rate in rates.items():
+      matching = sum(1 for mask in regs if event in mask)
+      scan_visits += rate * len(regs)
+      index_visits += rate * matching
+      calls += rate * matching
+  return scan_visits, index_visits, calls
+
+
+print("%-22s %14s %14s %12s %16s %16s" % ("subscriber set", "scan visits/s", "index visits/s", "calls/s", "scan cycles/s", "index cycles/s"))
+for scale in (1, 2, 4, 8):
+  scan, index, calls = dispatch_costs(scale)
+  registrations = sum(len(r) for r in subscribers.values()) * scale
+  print("%-22s %14.0f %14.0f %12.0f %16.0f %16.0f" % ("%d registrations" % registrations, scan, index, calls,
+    scan * cycles_scan_visit + calls * cycles_call, index * cycles_index_visit + calls * cycles_call))
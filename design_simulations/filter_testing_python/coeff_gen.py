@@ -0,0 +1,428 @@
+# Coefficient table generation for the DAP sample rate converter FIR filters and the BlockBox controller's DAP EQ biquads, from the parameter
+# files in filter_specs/ (one table per file). Each filter is designed, quantised to q31 and verified against its spec (passband ripple,
+# stopband attenuation, q31 quantisation error, coefficient range, stability), then written as the C table include file in the layout
+# its kernel consumes:
+#  - interpolator (arm_fir_interpolate_q31): prototype coefficients in time-reversed order, in a single line
+#  - polyphase (FFIR, fractional_fir.c): one row per phase, each row the phase's coefficients in time-reversed order (CMSIS FIR order)
+#  - biquad (DAP BIQUAD_COEFFS registers, arm_biquad_cascade_df1_q31): b0 b1 b2 -a1 -a2 per stage, scaled down by the post-shift,
+#    optionally padded with unity stages up to the register size
+# The table size defines in the firmware source are checked against the parameter file and updated when a table is written.
+# The former tables came from the MATLAB scripts in matlab_filter_design (equiripple designs, srcDesign.mlx/asrcDesign.mlx) and hand-tuned
+# EQ biquads; the parameter files reproduce those designs and specs.
+#
+# usage: python coeff_gen.py [--check] [spec files...]
+#   no spec files: all parameter files in filter_specs/
+#   --check: verify the current tables against their specs, without designing or writing anything
+
+import argparse
+import glob
+import json
+import os
+import re
+import sys
+
+import numpy as np
+import scipy.linalg
+import scipy.signal
+
+
+repo_root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+spec_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "filter_specs")
+
+response_points = 1 << 19       # frequency grid of the FIR response checks
+remez_grid_densities = (16, 8, 4, 32)
+lawson_grid_density = 8         # grid points per tap of the least squares fallback design
+lawson_iterations = 30
+eq_check_band_hz = (20.0, 20000.0)
+ripple_tolerance_db = 1e-5     # numerical tolerance of the passband ripple check (the former designs are at the spec limit)
+
+
+class SpecError(Exception):
+    pass
+
+
+def repo_path(path):
+    return os.path.normpath(os.path.join(repo_root, path))
+
+
+def quantise_q31(values):
+    scaled = np.round(np.asarray(values, dtype=np.float64) * 2.0 ** 31)
+    if np.any(scaled > 2 ** 31 - 1) or np.any(scaled < -2 ** 31):
+        raise SpecError("coefficients out of q31 range (max magnitude %.4f)" % np.max(np.abs(values)))
+    return scaled.astype(np.int64)
+
+
+def read_c_define(path, name):
+    with open(repo_path(path)) as f:
+        match = re.search(r"^#define\s+%s\s+(-?\d+)\s*$" % re.escape(name), f.read(), re.MULTILINE)
+    if match is None:
+        raise SpecError("define %s not found in %s" % (name, path))
+    return int(match.group(1))
+
+
+def write_c_define(path, name, value):
+    with open(repo_path(path)) as f:
+        text = f.read()
+    text = re.sub(r"^(#define\s+%s\s+)-?\d+(\s*)$" % re.escape(name), r"\g<1>%d\g<2>" % value, text, flags=re.MULTILINE)
+    with open(repo_path(path), "w", newline="") as f:
+        f.write(text)
+
+
+def read_int_table(path):
+    with open(repo_path(path)) as f:
+        return np.array([int(v, 0) for v in f.read().replace("\n", ",").split(",") if v.strip()], dtype=np.int64)
+
+
+# ********************************* FIR *********************************
+
+class FIRSpec:
+    def __init__(self, spec):
+        self.name = spec["name"]
+        self.layout = spec["layout"]
+        self.phases = spec["phases"]
+        self.phase_length = spec["phase_length"]
+        self.taps = self.phases * self.phase_length
+        self.rate = self.phases * spec["input_rate_hz"]   #rate of the upsampled signal, i.e. the prototype filter's sampling rate
+        self.passband = spec["passband_hz"] / self.rate
+        self.stopband = spec["stopband_hz"] / self.rate
+        self.ripple_db = spec["passband_ripple_db"]
+        self.attenuation_db = spec["stopband_attenuation_db"]
+        self.output = spec["output"]
+        self.defines = spec.get("defines", {})
+        self.headroom = spec.get("headroom")   #shift define giving the input headroom of the filter: {"file", "define"}
+        if self.layout not in ("interpolator", "polyphase"):
+            raise SpecError("unknown FIR layout %s" % self.layout)
+
+
+def fir_to_table(spec, h_q31):
+    #prototype filter to the table layout of the kernel, as a list of rows
+    if spec.layout == "interpolator":
+        return [h_q31[::-1]]
+    #phase p uses prototype taps p, p + phases, p + 2 * phases, ...
+    return [h_q31[p::spec.phases][::-1] for p in range(spec.phases)]
+
+
+def table_to_fir(spec, table):
+    if spec.layout == "interpolator":
+        return table[::-1]
+    rows = table.reshape(spec.phases, spec.phase_length)[:, ::-1]
+    return rows.T.reshape(-1)
+
+
+def fir_response(spec, h):
+    w, H = scipy.signal.freqz(h, worN=response_points)
+    return w / (2 * np.pi), np.abs(H) / spec.phases
+
+
+def fir_measure(spec, h):
+    f, A = fir_response(spec, h)
+    passband = A[f <= spec.passband]
+    stopband = A[f >= spec.stopband]
+    ripple = 20 * np.log10(passband.max() / passband.min())
+    attenuation = -20 * np.log10(max(stopband.max(), 1e-20))
+    phase_gains = [np.sum(np.abs(h[p::spec.phases])) for p in range(spec.phases)]
+    return ripple, attenuation, max(phase_gains)
+
+
+def fir_deviations(spec):
+    #allowed passband and stopband deviations, absolute (the passband gain is the number of phases)
+    ripple_lin = 10 ** (spec.ripple_db / 20)
+    return spec.phases * (ripple_lin - 1) / (ripple_lin + 1), spec.phases * 10 ** (-spec.attenuation_db / 20)
+
+
+def fir_meets_spec(spec, h):
+    ripple, attenuation, _ = fir_measure(spec, h)
+    return ripple <= spec.ripple_db + ripple_tolerance_db and attenuation >= spec.attenuation_db, ripple, attenuation
+
+
+def fir_design_remez(spec):
+    #equiripple design, stopband weighted by the ratio of the allowed deviations
+    deviation_pass, deviation_stop = fir_deviations(spec)
+    failures = []
+    for grid_density in remez_grid_densities:
+        try:
+            h = scipy.signal.remez(spec.taps, [0, spec.passband, spec.stopband, 0.5], [spec.phases, 0],
+                                   weight=[1, deviation_pass / deviation_stop], grid_density=grid_density, maxiter=100)
+        except ValueError:
+            failures.append("remez grid density %d: no convergence" % grid_density)
+            continue
+        met, ripple, attenuation = fir_meets_spec(spec, quantise_q31(h) / 2.0 ** 31)
+        if met:
+            return h, failures
+        failures.append("remez grid density %d: ripple %.4f dB, attenuation %.1f dB" % (grid_density, ripple, attenuation))
+    return None, failures
+
+
+def _cosine_sums(weights, w, count):
+    #sum over the grid of weights * cos(m * w), for m = 0..count-1
+    sums = np.empty(count)
+    for start in range(0, count, 256):
+        m = np.arange(start, min(start + 256, count))
+        sums[start:start + len(m)] = np.cos(np.outer(m, w)) @ weights
+    return sums
+
+
+def fir_design_lawson(spec):
+    #near-equiripple design by iteratively reweighted least squares (Lawson), for long filters where remez doesn't converge (even length only):
+    #linear-phase response sum(c_k cos((k + 1/2) w)) on a dense grid, errors normalised to the allowed deviations; the weighted normal
+    #equations are Toeplitz plus Hankel in the cosine sums of the weights, so they are set up in O(taps * grid) instead of O(taps^2 * grid)
+    if spec.taps % 2 != 0:
+        return None, ["lawson: odd length not supported"]
+    half = spec.taps // 2
+    k = np.arange(half) + 0.5
+    deviation_pass, deviation_stop = fir_deviations(spec)
+    pass_count = max(int(lawson_grid_density * spec.taps * spec.passband), 64)
+    stop_count = int(lawson_grid_density * spec.taps * (0.5 - spec.stopband))
+    w_pass = np.linspace(0, 2 * np.pi * spec.passband, pass_count)
+    w = np.concatenate([w_pass, np.linspace(2 * np.pi * spec.stopband, np.pi, stop_count)])
+    desired = np.concatenate([np.full(pass_count, float(spec.phases)), np.zeros(stop_count)])
+    normalise = np.concatenate([np.full(pass_count, 1 / deviation_pass), np.full(stop_count, 1 / deviation_stop)])
+    weights = normalise ** 2 / len(w)
+    index = np.arange(half)
+    best = None
+    for iteration in range(lawson_iterations):
+        sums = _cosine_sums(weights, w, 2 * half + 1)
+        matrix = 0.5 * (sums[np.abs(index[:, None] - index[None, :])] + sums[index[:, None] + index[None, :] + 1])
+        c = scipy.linalg.solve(matrix, np.cos(np.outer(k, w_pass)) @ (weights[:pass_count] * spec.phases), assume_a="pos")
+        response = np.concatenate([np.cos(np.outer(w[s:s + 4096], k)) @ c for s in range(0, len(w), 4096)])
+        error = np.abs(response - desired) * normalise
+        h = np.concatenate([c[::-1], c]) / 2
+        if best is None or error.max() < best[0]:
+            best = (error.max(), h)
+        #stop as soon as the quantised filter meets the spec - later iterations only get closer to equiripple, and lose accuracy
+        if error.max() <= 1.0 and fir_meets_spec(spec, quantise_q31(h) / 2.0 ** 31)[0]:
+            return h, []
+        weights = weights * error
+        weights /= weights.sum()
+    _, ripple, attenuation = fir_meets_spec(spec, quantise_q31(best[1]) / 2.0 ** 31)
+    return None, ["lawson: ripple %.4f dB, attenuation %.1f dB" % (ripple, attenuation)]
+
+
+def fir_design(spec):
+    h, failures = fir_design_remez(spec)
+    if h is None:
+        h, lawson_failures = fir_design_lawson(spec)
+        failures += lawson_failures
+    if h is None:
+        raise SpecError("design does not meet the spec - " + "; ".join(failures))
+    return h, quantise_q31(h)
+
+
+def fir_verify(spec, h_q31, h_float=None):
+    h = h_q31 / 2.0 ** 31
+    ripple, attenuation, worst_gain = fir_measure(spec, h)
+    lines = ["%d taps (%d phases x %d), passband %.0f Hz, stopband %.0f Hz at %.0f Hz" % (
+        spec.taps, spec.phases, spec.phase_length, spec.passband * spec.rate, spec.stopband * spec.rate, spec.rate)]
+    errors = []
+    lines.append("passband ripple %.5f dB (spec %.5f dB)" % (ripple, spec.ripple_db))
+    if ripple > spec.ripple_db + ripple_tolerance_db:
+        errors.append("passband ripple")
+    lines.append("stopband attenuation %.1f dB (spec %.1f dB)" % (attenuation, spec.attenuation_db))
+    if attenuation < spec.attenuation_db:
+        errors.append("stopband attenuation")
+    if h_float is not None:
+        #quantisation error: coefficient error and the level of the error filter's response, relative to the passband gain
+        f, A_err = fir_response(spec, h - h_float)
+        error_level = -20 * np.log10(max(A_err.max(), 1e-20))
+        lines.append("q31 quantisation: max coefficient error %.2f LSB, error response %.1f dB below passband" % (
+            np.max(np.abs(h_q31 - h_float * 2.0 ** 31)), error_level))
+        if error_level < spec.attenuation_db:
+            errors.append("quantisation error above the stopband spec")
+    if spec.headroom is not None:
+        shift = read_c_define(spec.headroom["file"], spec.headroom["define"])
+        lines.append("worst-case phase gain %.3f (headroom %.1f with %s = %d)" % (worst_gain, 2.0 ** -shift, spec.headroom["define"], shift))
+        if worst_gain > 2.0 ** -shift:
+            errors.append("worst-case gain exceeds the headroom")
+    return lines, errors
+
+
+def fir_check_defines(spec, update):
+    #table size defines in the firmware source must match the parameter file
+    mismatches = []
+    for key, value in (("phase_count", spec.phases), ("phase_length", spec.phase_length)):
+        if key not in spec.defines:
+            continue
+        name = spec.defines[key]
+        current = read_c_define(spec.defines["file"], name)
+        if current != value:
+            if update:
+                write_c_define(spec.defines["file"], name, value)
+                mismatches.append("updated %s: %d -> %d" % (name, current, value))
+            else:
+                mismatches.append("%s is %d, spec has %d" % (name, current, value))
+    return mismatches
+
+
+def fir_write(spec, h_q31):
+    rows = fir_to_table(spec, h_q31)
+    with open(repo_path(spec.output), "w", newline="") as f:
+        if spec.layout == "interpolator":
+            f.write(",".join("%d" % v for v in rows[0]) + "\n")
+        else:
+            for row in rows:
+                f.write(",".join("%d" % v for v in row) + ",\n")
+
+
+def process_fir(spec_json, check):
+    spec = FIRSpec(spec_json)
+    if check:
+        table = read_int_table(spec.output)
+        if len(table) != spec.taps:
+            raise SpecError("table has %d coefficients, spec %d" % (len(table), spec.taps))
+        lines, errors = fir_verify(spec, table_to_fir(spec, table))
+        mismatches = fir_check_defines(spec, False)
+        errors += mismatches
+        return lines + mismatches, errors
+    h, h_q31 = fir_design(spec)
+    lines, errors = fir_verify(spec, h_q31, h)
+    if not errors:
+        fir_write(spec, h_q31)
+        lines += fir_check_defines(spec, True)
+        lines.append("written %s" % spec.output)
+    return lines, errors
+
+
+# ******************************** Biquad *******************************
+
+def biquad_stage(stage, rate):
+    #RBJ audio EQ cookbook biquads, normalised to a0 = 1: returns (b0, b1, b2, a1, a2)
+    kind = stage["type"]
+    w0 = 2 * np.pi * stage["f"] / rate
+    cos_w0 = np.cos(w0)
+    alpha = np.sin(w0) / (2 * stage["q"])
+    A = 10 ** (stage.get("gain_db", 0.0) / 40)
+    if kind == "peak":
+        b = [1 + alpha * A, -2 * cos_w0, 1 - alpha * A]
+        a = [1 + alpha / A, -2 * cos_w0, 1 - alpha / A]
+    elif kind == "lowpass":
+        b = [(1 - cos_w0) / 2, 1 - cos_w0, (1 - cos_w0) / 2]
+        a = [1 + alpha, -2 * cos_w0, 1 - alpha]
+    elif kind == "highpass":
+        b = [(1 + cos_w0) / 2, -(1 + cos_w0), (1 + cos_w0) / 2]
+        a = [1 + alpha, -2 * cos_w0, 1 - alpha]
+    elif kind in ("lowshelf", "highshelf"):
+        sign = 1 if kind == "lowshelf" else -1
+        s = 2 * np.sqrt(A) * alpha
+        b = [A * ((A + 1) - sign * (A - 1) * cos_w0 + s), sign * 2 * A * ((A - 1) - sign * (A + 1) * cos_w0), A * ((A + 1) - sign * (A - 1) * cos_w0 - s)]
+        a = [(A + 1) + sign * (A - 1) * cos_w0 + s, -sign * 2 * ((A - 1) + sign * (A + 1) * cos_w0), (A + 1) + sign * (A - 1) * cos_w0 - s]
+    else:
+        raise SpecError("unknown biquad type %s" % kind)
+    return np.array([b[0], b[1], b[2], a[1], a[2]]) / a[0]
+
+
+def biquad_response(sections, rate, freqs):
+    H = np.ones(len(freqs), dtype=complex)
+    for b0, b1, b2, a1, a2 in sections:
+        _, h = scipy.signal.freqz([b0, b1, b2], [1, a1, a2], worN=freqs, fs=rate)
+        H *= h
+    return H
+
+
+def biquad_to_q31(sections, post_shift):
+    #CMSIS df1 q31 coefficient order: b0 b1 b2 -a1 -a2, all scaled down by 2^post_shift
+    rows = [[b0, b1, b2, -a1, -a2] for b0, b1, b2, a1, a2 in sections]
+    return quantise_q31(np.array(rows) / 2.0 ** post_shift)
+
+
+def q31_to_biquad(rows, post_shift):
+    values = rows / 2.0 ** 31 * 2.0 ** post_shift
+    return [(b0, b1, b2, -na1, -na2) for b0, b1, b2, na1, na2 in values]
+
+
+def biquad_verify(spec, rows_q31, sections):
+    rate = spec["sample_rate_hz"]
+    post_shift = spec["post_shift"]
+    quantised = q31_to_biquad(rows_q31, post_shift)
+    errors = []
+    lines = ["%d stages at %.0f Hz, post-shift %d" % (len(quantised), rate, post_shift)]
+    radius = max(max(np.abs(np.roots([1, a1, a2]))) for _, _, _, a1, a2 in quantised)
+    lines.append("max pole radius %.6f" % radius)
+    if radius >= 1.0:
+        errors.append("unstable stage")
+    freqs = np.geomspace(eq_check_band_hz[0], eq_check_band_hz[1], 4000)
+    H_q = biquad_response(quantised, rate, freqs)
+    gain = 20 * np.log10(np.abs(H_q))
+    lines.append("response %.2f to %.2f dB in %.0f-%.0f Hz" % (gain.min(), gain.max(), eq_check_band_hz[0], eq_check_band_hz[1]))
+    if sections is not None:
+        #quantisation error: level of the response difference relative to full scale (a relative dB deviation is meaningless in stopbands)
+        H_f = biquad_response(sections, rate, freqs)
+        error_level = 20 * np.log10(max(np.max(np.abs(H_q - H_f)), 1e-20))
+        lines.append("q31 quantisation: error response %.1f dB (spec %.1f dB)" % (error_level, spec["max_quantisation_error_db"]))
+        if error_level > spec["max_quantisation_error_db"]:
+            errors.append("quantisation error")
+    for point in spec.get("response_checks", []):
+        actual = 20 * np.log10(np.abs(biquad_response(quantised, rate, [point["f"]])[0]))
+        lines.append("%.0f Hz: %.2f dB (spec %.2f +- %.2f dB)" % (point["f"], actual, point["gain_db"], point["tolerance_db"]))
+        if abs(actual - point["gain_db"]) > point["tolerance_db"]:
+            errors.append("response at %.0f Hz" % point["f"])
+    return lines, errors
+
+
+def biquad_pad(spec, rows_q31):
+    #unity stages (b0 = 1 after the post-shift) up to the given stage count, so unused register stages pass the signal unchanged
+    pad_stages = spec.get("pad_stages", len(rows_q31))
+    if len(rows_q31) > pad_stages:
+        raise SpecError("%d stages, at most %d allowed" % (len(rows_q31), pad_stages))
+    unity = quantise_q31([2.0 ** -spec["post_shift"], 0, 0, 0, 0])
+    return np.vstack([rows_q31] + [unity] * (pad_stages - len(rows_q31)))
+
+
+def biquad_write(spec, rows_q31):
+    with open(repo_path(spec["output"]), "w", newline="") as f:
+        f.write(",\n".join(", ".join("0x%08X" % (v & 0xFFFFFFFF) for v in row) for row in rows_q31))
+
+
+def process_biquad(spec, check):
+    stage_count = len(spec["stages"])
+    if check:
+        rows = read_int_table(spec["output"])
+        rows = np.where(rows >= 2 ** 31, rows - 2 ** 32, rows).reshape(-1, 5)
+        #designed stages, then unity padding
+        sections = [biquad_stage(stage, spec["sample_rate_hz"]) for stage in spec["stages"]]
+        lines, errors = biquad_verify(spec, rows[:stage_count], sections)
+        expected = biquad_pad(spec, biquad_to_q31(sections, spec["post_shift"]))
+        if expected.shape != rows.shape:
+            errors.append("table has %d stages, spec %d" % (len(rows), len(expected)))
+        else:
+            lines.append("table vs. design: max difference %d LSB" % np.max(np.abs(expected - rows)))
+        return lines, errors
+    sections = [biquad_stage(stage, spec["sample_rate_hz"]) for stage in spec["stages"]]
+    rows_q31 = biquad_to_q31(sections, spec["post_shift"])
+    lines, errors = biquad_verify(spec, rows_q31, sections)
+    if not errors:
+        biquad_write(spec, biquad_pad(spec, rows_q31))
+        lines.append("written %s" % spec["output"])
+    return lines, errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Design, verify and write the firmware filter coefficient tables")
+    parser.add_argument("specs", nargs="*", help="parameter files (default: all in filter_specs/)")
+    parser.add_argument("--check", action="store_true", help="only verify the current tables against their specs")
+    args = parser.parse_args()
+
+    spec_files = args.specs or sorted(glob.glob(os.path.join(spec_dir, "*.json")))
+    failed = 0
+    for spec_file in spec_files:
+        with open(spec_file) as f:
+            spec = json.load(f)
+        print("%s (%s):" % (spec["name"], os.path.basename(spec_file)))
+        try:
+            if spec["type"] == "fir":
+                lines, errors = process_fir(spec, args.check)
+            elif spec["type"] == "biquad":
+                lines, errors = process_biquad(spec, args.check)
+            else:
+                raise SpecError("unknown filter type %s" % spec["type"])
+        except SpecError as e:
+            lines, errors = [], [str(e)]
+        for line in lines:
+            print("  " + line)
+        if errors:
+            failed += 1
+            print("  FAILED: " + ", ".join(errors))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,170 @@
+# Host-side model of a BlockBox volume change across the HiFiDAC and DAP modules (AudioPathManager::PlanVolumeGains/ApplyGainPlan), without hardware.
+# Compares the former ordered application (smaller gain change first, each device written and read back before the other one starts)
+# with the gain planner (same-direction changes written concurrently, DAC decrease + DAP increase written concurrently with the DAP
+# increase delayed via VOLUME_GAINS_DELAYED, DAC increase + DAP decrease still ordered).
+# Both modules share the main I2C bus, transfers of the DAP interface are started first when both are queued (registration order).
+# The DAP applies written gains at the start of its next output batch (1 ms), the DAC module at the end of its next main loop cycle (10 ms).
+# Reports per volume step: time until the operation completes (manager unlocked), time until the final total gain is audible,
+# and how often, how much and how long the total gain transiently exceeds both the old and new total gain.
+
+import random
+
+
+i2c_byte_time = 9 / 100e3        # main bus I2C timing 0x2000090E: ~100 kHz, 9 clocks per byte
+transfer_overhead = 30e-6        # transfer start, interrupt and callback handling per transfer
+dap_batch_period = 96 / 96000    # SP_BATCH_CHANNEL_SAMPLES at 96 kHz output rate
+dac_loop_period = 0.010          # HiFiDAC MAIN_LOOP_PERIOD_MS
+dac_spi_time = 50e-6             # DAC shadow register flush
+dap_delay_batches = 15           # AUDIO_DAP_GAIN_DELAY_BATCHES
+other_rate = 400                 # other main bus transfers (power amp, status and peak level reads), per s - started after DAP/DAC transfers
+other_time = 0.0004              # duration of one other transfer, in s
+
+# transfer lengths in bytes: address + register + data + CRC (DAP only), reads with repeated start and second address byte
+transfers = {
+  ("DAP", "write"): 2 + 8 + 1,
+  ("DAP", "write_delayed"): 2 + 12 + 1,
+  ("DAP", "read"): 3 + 8 + 1,
+  ("DAP", "read_delayed"): 3 + 12 + 1,
+  ("DAC", "write"): 2 + 2,
+  ("DAC", "read"): 3 + 2,
+}
+
+
+def transfer_time(device, kind):
+  return transfers[(device, kind)] * i2c_byte_time + transfer_overhead
+
+
+def run_bus(rng, chains, start):
+  #chains: list of transfer chains (each a list of (device, kind)), each chain runs its transfers one after another
+  #returns the completion time of each transfer, per chain
+  t = start
+  heads = [0] * len(chains)
+  ready = [start] * len(chains)
+  done = [[] for _ in chains]
+  #other transfers: one may be running at the start, further ones arrive randomly
+  other_busy_until = start + rng.uniform(0, other_time) if rng.random() < other_rate * other_time else start
+  next_other = start + rng.expovariate(other_rate)
+  other_pending = 0
+  while any(heads[i] < len(chains[i]) for i in range(len(chains))):
+    candidates = [i for i in range(len(chains)) if heads[i] < len(chains[i])]
+    t = max(t, other_busy_until)
+    ready_now = [i for i in candidates if ready[i] <= t]
+    while next_other <= t:
+      other_pending += 1
+      next_other += rng.expovariate(other_rate)
+    if not ready_now:
+      #bus idle until the next chain transfer is ready: other transfers may run in between
+      next_ready = min(ready[i] for i in candidates)
+      if other_pending > 0:
+        other_pending -= 1
+        other_busy_until = t + other_time
+      elif next_other < next_ready:
+        t = next_other
+      else:
+        t = next_ready
+      continue
+    #start the first ready transfer, DAP interface first
+    ready_now.sort(key=lambda i: 0 if chains[i][heads[i]][0] == "DAP" else 1)
+    i = ready_now[0]
+    t += transfer_time(*chains[i][heads[i]])
+    done[i].append(t)
+    heads[i] += 1
+    #next transfer of the chain is queued from the completion callback
+    ready[i] = t + transfer_overhead
+  return done
+
+
+def apply_times(rng, dap_write_done, dap_delay, dac_write_done):
+  #time at which each device applies its new gains, given the time its write was received
+  dap_phase = rng.uniform(0, dap_batch_period)
+  dac_phase = rng.uniform(0, dac_loop_period)
+  dap_apply = dac_apply = None
+  if dap_write_done is not None:
+    batches = int((dap_write_done - dap_phase) // dap_batch_period) + 1 + dap_delay
+    dap_apply = dap_phase + batches * dap_batch_period
+  if dac_write_done is not None:
+    loops = int((dac_write_done - dac_phase) // dac_loop_period) + 1
+    dac_apply = dac_phase + loops * dac_loop_period + dac_spi_time
+  return dap_apply, dac_apply
+
+
+def run(rng, mode, dac_delta, dap_delta):
+  start = 0.0
+  dap_delay = 0
+  dap_write_done = dac_write_done = None
+
+  if mode == "ordered":
+    #former behaviour: smaller change first, second device after the first one's readback
+    devices = [d for d, delta in (("DAC", dac_delta), ("DAP", dap_delta)) if delta != 0]
+    if len(devices) == 2 and dac_delta > dap_delta:
+      devices = ["DAP", "DAC"]
+    chain = [t for d in devices for t in ((d, "write"), (d, "read"))]
+    done = run_bus(rng, [chain], start)[0]
+    for k, d in enumerate(devices):
+      if d == "DAP":
+        dap_write_done = done[2 * k]
+      else:
+        dac_write_done = done[2 * k]
+    finish = done[-1]
+  else:
+    if dac_delta > 0 and dap_delta < 0:
+      #DAP first, then DAC (ordered fallback)
+      done = run_bus(rng, [[("DAP", "write"), ("DAP", "read"), ("DAC", "write"), ("DAC", "read")]], start)[0]
+      dap_write_done, dac_write_done, finish = done[0], done[2], done[3]
+    else:
+      delayed = dac_delta < 0 and dap_delta > 0
+      chains, names = [], []
+      if dap_delta != 0:
+        chains.append([("DAP", "write_delayed"), ("DAP", "read_delayed")] if delayed else [("DAP", "write"), ("DAP", "read")])
+        names.append("DAP")
+      if dac_delta != 0:
+        chains.append([("DAC", "write"), ("DAC", "read")])
+        names.append("DAC")
+      done = run_bus(rng, chains, start)
+      for name, d in zip(names, done):
+        if name == "DAP":
+          dap_write_done = d[0]
+        else:
+          dac_write_done = d[0]
+      finish = max(d[-1] for d in done)
+      if delayed:
+        dap_delay = dap_delay_batches
+
+  dap_apply, dac_apply = apply_times(rng, dap_write_done, dap_delay, dac_write_done)
+
+  #total gain over time, relative to the old total gain
+  events = sorted([(t, delta) for t, delta in ((dap_apply, dap_delta), (dac_apply, dac_delta)) if t is not None])
+  limit = max(0.0, dac_delta + dap_delta)
+  total, over_gain, over_time = 0.0, 0.0, 0.0
+  for k, (t, delta) in enumerate(events):
+    total += delta
+    if total > limit and k + 1 < len(events):
+      over_gain = max(over_gain, total - limit)
+      over_time += events[k + 1][0] - t
+  settled = events[-1][0] if events else start
+  return finish, settled, over_gain, over_time
+
+
+scenarios = [
+  ("volume step +2 dB (DAP only)", 0.0, 2.0),
+  ("volume step -2 dB (DAP only)", 0.0, -2.0),
+  ("max volume -10 -> -14 dB, loudness tracks max volume (DAC -4, DAP +4)", -4.0, 4.0),
+  ("max volume -14 -> -10 dB, loudness tracks max volume (DAC +4, DAP -4)", 4.0, -4.0),
+  ("max volume lowered below current volume (DAC -4, DAP -1)", -4.0, -1.0),
+]
+
+runs = 2000
+for name, dac_delta, dap_delta in scenarios:
+  print("%s:" % name)
+  for mode in ("ordered", "planner"):
+    rng = random.Random(1)
+    finish, settled, over, over_times = [], [], [], []
+    for k in range(runs):
+      f, s, o, ot = run(rng, mode, dac_delta, dap_delta)
+      finish.append(f)
+      settled.append(s)
+      over.append(o)
+      over_times.append(ot)
+    over_runs = sum(1 for o in over if o > 0)
+    print("  %-8s operation done: mean %5.2f ms, max %5.2f ms; final gain audible: mean %5.2f ms, max %5.2f ms; over-gain in %5.1f %% of changes, max %3.1f dB for %4.1f ms" % (
+      mode + ":", 1e3 * sum(finish) / runs, 1e3 * max(finish), 1e3 * sum(settled) / runs, 1e3 * max(settled), 100 * over_runs / runs, max(over), 1e3 * max(over_times)))
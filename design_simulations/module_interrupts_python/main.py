@@ -0,0 +1,124 @@
+# Host-side model of interrupt-driven module register refreshes (IntRegI2CModuleInterface refresh groups and watchdog), without hardware.
+# Mock HiFiDAC, DAP and PowerAmp modules raise state changes at random times; each change sets interrupt flags and asserts the module's
+# interrupt line, like the modules' I2C_TriggerInterrupt. The controller is modelled with its 10 ms main loop and one shared I2C bus:
+#  - former: fixed status polling (DAC/DAP status 500 ms, PowerAmp status + safety 500 ms, PVDD 1 s), per-module interrupt handlers,
+#    and no interrupt for DAP streaming/USB connection changes
+#  - refresh groups: interrupt flags read and cleared, then only the flagged register groups read; fixed polling reduced to a watchdog
+#    (DAC/DAP 2 s, PowerAmp 1 s) reading all groups, adjacent groups merged; the DAP signals streaming/USB changes with INT_STATUS
+# Reports I2C transfers per second (idle and with events) and the time from a module state change to the controller seeing it.
+
+import heapq
+import itertools
+import random
+
+
+loop_period = 0.010          # MAIN_LOOP_PERIOD_MS
+transfer_time = 6 * 9 / 100e3 # typical short register transfer in s: address, register, read address, 2 data bytes, CRC at ~100 kHz (main bus timing 0x2000090E)
+sim_time = 600.0
+
+
+class Module:
+  def __init__(self, name, groups, former_polls, watchdog, events):
+    self.name = name
+    self.groups = groups                #list of (interrupt flag name or None, register group name) - None: no interrupt for changes
+    self.former_polls = former_polls    #list of (period in s, register groups read)
+    self.watchdog = watchdog            #watchdog period in s
+    self.events = events                #list of (kind, group, mean interval in s)
+
+
+modules = [
+  Module("HiFiDAC", [("status", "STATUS")], [(0.5, ["STATUS"])], 2.0,
+         [("lock/automute", "STATUS", 20.0)]),
+  Module("DAP", [("src_ready|status", "STATUS"), ("inputs", "INPUT_ACTIVE"), ("inputs", "INPUTS_AVAILABLE"), ("rate", "SRC_INPUT_RATE")],
+         [(0.5, ["STATUS"])], 2.0,
+         [("streaming/USB change", "STATUS", 15.0), ("input change", "INPUT_ACTIVE", 30.0), ("input rate change", "SRC_INPUT_RATE", 30.0)]),
+  Module("PowerAmp", [("any", "STATUS"), ("serr", "SAFETY"), ("swarn", "SWARN_SOURCE"), ("pvdd", "PVDD")],
+         [(0.5, ["STATUS"]), (0.5, ["SAFETY+SWARN"]), (1.0, ["PVDD"])], 1.0,
+         [("safety warning", "SWARN_SOURCE", 10.0), ("amp fault", "STATUS", 60.0)]),
+]
+# watchdog reads after merging adjacent groups (table order and address)
+watchdog_reads = { "HiFiDAC": 1, "DAP": 3, "PowerAmp": 3 }
+
+
+class Bus:
+  def __init__(self):
+    self.free_at = 0.0
+    self.transfers = 0
+
+  def transfer(self, start, count=1):
+    t = max(start, self.free_at)
+    for _ in range(count):
+      t += transfer_time
+    self.free_at = t
+    self.transfers += count
+    return t
+
+def next_loop(t):
+  return (int(t / loop_period) + 1) * loop_period
+
+
+def run(mode, with_events, rng):
+  bus = Bus()
+  latencies = {}
+  #generate events
+  events = []
+  if with_events:
+    for module in modules:
+      for kind, group, interval in module.events:
+        t = rng.expovariate(1.0 / interval)
+        while t < sim_time:
+          events.append((t, module, kind, group))
+          t += rng.expovariate(1.0 / interval)
+  events.sort(key=lambda e: e[0])
+
+  #actions in time order: (time, order, kind, data) - periodic reads per main loop cycle, module events, interrupt handling steps
+  order = itertools.count()
+  actions = []
+  cycles = int(sim_time / loop_period)
+  for k in range(cycles):
+    t = k * loop_period
+    for module in modules:
+      if mode == "former":
+        for period, groups in module.former_polls:
+          if k % int(round(period / loop_period)) == 0:
+            actions.append((t, next(order), "poll", (module.name, groups)))
+      elif k % int(round(module.watchdog / loop_period)) == 0:
+        actions.append((t, next(order), "poll", (module.name, ["*"] * watchdog_reads[module.name])))
+  for t, module, kind, group in events:
+    actions.append((t, next(order), "event", (module, kind, group)))
+  heapq.heapify(actions)
+
+  pending_status = {}   #former: DAP status changes without interrupt, waiting for the next status poll - kind -> list of event times
+  while actions:
+    t, _, action, data = heapq.heappop(actions)
+    if action == "poll":
+      name, groups = data
+      done = bus.transfer(t, len(groups))
+      if name == "DAP" and "STATUS" in groups:
+        for event_t in pending_status.pop("DAP streaming/USB change", []):
+          latencies.setdefault("DAP streaming/USB change", []).append(done - event_t)
+    elif action == "event":
+      module, kind, group = data
+      name = "%s %s" % (module.name, kind)
+      if mode == "former" and name == "DAP streaming/USB change":
+        #no interrupt: only seen at the next status poll
+        pending_status.setdefault(name, []).append(t)
+      else:
+        #EXTI: flags read queued right away, its callback (next loop cycle) clears the flags and reads the flagged group(s)
+        flags_done = bus.transfer(t)
+        heapq.heappush(actions, (next_loop(flags_done), next(order), "handle", (name, t)))
+    else:
+      name, event_t = data
+      seen = bus.transfer(t, 2)
+      latencies.setdefault(name, []).append(seen - event_t)
+
+  return bus.transfers / sim_time, latencies
+
+
+for mode in ("former", "refresh groups"):
+  idle_rate, _ = run(mode, False, random.Random(1))
+  rate, latencies = run(mode, True, random.Random(1))
+  print("%s: %.1f transfers/s idle, %.1f transfers/s with events" % (mode, idle_rate, rate))
+  for name in sorted(latencies):
+    values = latencies[name]
+    print("  %-36s mean %5.1f ms, max %5.1f ms (%d events)" % (name + ":", 1e3 * sum(values) / len(values), 1e3 * max(values), len(values)))
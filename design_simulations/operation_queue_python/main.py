@@ -0,0 +1,110 @@
+# Host-side model of the BlockBox controller manager operation queue (operation_queue.cpp, AudioPathManager volume changes), without hardware.
+# Replays bursts of UI volume events and compares:
+#  - former, not queued: events arriving while an operation runs fail (GUI volume buttons used to do this)
+#  - former, queued: every event is queued with a target computed from the current (not yet updated) volume, one queued operation
+#    is started per 10 ms main loop cycle after unlock (an event arriving between unlock and the next loop cycle overtakes the queued ones)
+#  - coalescing queue: a queued volume operation is superseded by newer ones, relative steps accumulate onto the pending target,
+#    and the next operation is started directly on unlock
+# Reports the time from the last UI event to the final volume being applied, the final volume error, and the number of gain sequences.
+
+import random
+
+
+loop_period = 0.010          # MAIN_LOOP_PERIOD_MS
+volume_min = -60.0
+volume_max = 0.0
+# duration of one volume gain application (DAC volume + DAP gain writes over I2C, incl. waits for other transfers), in s (min, max)
+gain_sequence_time = (0.012, 0.030)
+
+
+def run(events, mode, rng, start_volume):
+  #events: list of (time, kind, value) - kind "step" (relative, dB) or "set" (absolute, dB)
+  t = 0.0
+  current = start_volume
+  target = None                # pending target volume (coalescing mode)
+  running = None               # (completion time, volume being applied)
+  queue = []                   # queued absolute volumes
+  next_loop = 0.0
+  sequences = 0
+  last_change = 0.0
+  pending_events = list(events)
+
+  def start(volume, now):
+    nonlocal running, sequences
+    running = (now + rng.uniform(*gain_sequence_time), min(max(volume, volume_min), volume_max))
+    sequences += 1
+
+  while pending_events or running or queue:
+    #UI events
+    while pending_events and pending_events[0][0] <= t:
+      _, kind, value = pending_events.pop(0)
+      if mode == "coalescing":
+        base = current if target is None else min(max(target, volume_min), volume_max)
+        volume = base + value if kind == "step" else value
+        target = volume
+        if running:
+          queue = [volume]           #supersede queued volume operation
+        else:
+          start(volume, t)
+      else:
+        volume = current + value if kind == "step" else value
+        if running:
+          if mode == "queued":
+            queue.append(volume)
+          #not queued: event fails
+        else:
+          start(volume, t)
+
+    #operation completion
+    if running and running[0] <= t:
+      current = running[1]
+      applied = running[1]
+      running = None
+      last_change = t
+      if mode == "coalescing":
+        if target == applied:
+          target = None
+        if queue:
+          #unlock: start next operation directly
+          start(queue.pop(0), t)
+
+    #main loop: start one queued operation per cycle
+    if t >= next_loop:
+      next_loop += loop_period
+      if running is None and queue:
+        start(queue.pop(0), t)
+
+    t += 0.0005
+  return current, last_change, sequences
+
+
+def encoder_spin(steps, interval, step_dB):
+  return [(k * interval, "step", step_dB) for k in range(steps)]
+
+def slider_drag(start, end, count, interval):
+  return [(k * interval, "set", start + (end - start) * (k + 1) / count) for k in range(count)]
+
+
+scenarios = [
+  ("volume button held (long-press ticks), 10 x +2 dB every 100 ms", encoder_spin(10, 0.100, 2.0), -40.0),
+  ("fast volume taps, 15 x +2 dB every 15 ms", encoder_spin(15, 0.015, 2.0), -40.0),
+  ("phone volume slider drag (Bluetooth absolute volume), 40 events every 20 ms", slider_drag(-50.0, -10.0, 40, 0.020), -50.0),
+]
+
+runs = 100
+for name, events, start_volume in scenarios:
+  intended = start_volume
+  for _, kind, value in events:
+    intended = min(max(intended + value if kind == "step" else value, volume_min), volume_max)
+  last_event = events[-1][0]
+  print("%s:" % name)
+  for mode in ("not queued", "queued", "coalescing"):
+    rng = random.Random(1)
+    latencies, errors, sequences = [], [], []
+    for k in range(runs):
+      final, last_change, count = run(events, mode, rng, start_volume)
+      latencies.append(max(last_change - last_event, 0.0))
+      errors.append(abs(final - intended))
+      sequences.append(count)
+    print("  %-11s final state after last event: mean %4.0f ms, max %4.0f ms; final volume error mean %4.1f dB; %5.1f gain sequences" % (
+      mode + ":", 1e3 * sum(latencies) / runs, 1e3 * max(latencies), sum(errors) / runs, sum(sequences) / runs))
@@ -0,0 +1,112 @@
+# Simulation of overcurrent detection latency in the power amp controller.
+# Compares the batch path (RMS of each 512-sample ADC batch checked against the instantaneous RMS limit after processing)
+# with the analog watchdog fast path (every current sample compared against the peak limit in hardware, shutdown in the ADC interrupt).
+# Fault onsets are placed randomly within the batch period, latency is measured from fault onset to shutdown.
+
+import math
+import random
+import matplotlib.pyplot as plt
+
+
+# ADC timing (adc.h): two scan channels, 61.5 + 12.5 cycles each at 18 MHz
+f_adc = 18e6
+sample_period = 2 * (61.5 + 12.5) / f_adc
+batch_size = 512
+batch_period = batch_size * sample_period
+batch_processing_time = 0.3e-3    # time from batch end to SAFETY_CheckADCInstValues (DMA interrupt latency + processing)
+awd_interrupt_latency = 1e-6      # ADC interrupt entry + shutdown pin write
+
+# limits (safety.h)
+rms_limit_inst = 15.0
+peak_limit = 25.0
+adc_full_scale = 2.0 * 3.555 / 0.1 * 0.5   # largest measurable current magnitude
+
+trials = 2000
+
+
+# fault current waveforms, t = time since fault onset (negative = before fault), phase = random signal phase
+def music_current(t, phase):
+  return 3.0 * math.sin(2 * math.pi * 200.0 * t + phase)
+
+def output_short(t, phase):
+  if t < 0:
+    return music_current(t, phase)
+  #current ramps up with PVDD / L of the output filter until the amp's own cycle-by-cycle limit
+  return min(48.0 / 10e-6 * t, 40.0)
+
+def low_impedance_load(t, phase):
+  if t < 0:
+    return music_current(t, phase)
+  return 30.0 * math.sin(2 * math.pi * 1000.0 * t + phase)
+
+def moderate_overload(t, phase):
+  if t < 0:
+    return music_current(t, phase)
+  return 22.0 * math.sin(2 * math.pi * 1000.0 * t + phase)
+
+scenarios = [
+  ("output short", output_short),
+  ("2 ohm load, 30 A peak", low_impedance_load),
+  ("overload, 22 A peak", moderate_overload),
+]
+
+
+def measure(current_func, onset, phase, max_batches=8):
+  batch_latency = None
+  awd_latency = None
+
+  for b in range(max_batches):
+    sum_squares = 0.0
+    for n in range(batch_size):
+      #sample taken at the end of its conversion
+      t_sample = (b * batch_size + n + 1) * sample_period
+      i = current_func(t_sample - onset, phase)
+      i = max(-adc_full_scale, min(adc_full_scale, i))
+      sum_squares += i * i
+      if awd_latency is None and abs(i) > peak_limit and t_sample >= onset:
+        awd_latency = t_sample + awd_interrupt_latency - onset
+
+    rms = math.sqrt(sum_squares / batch_size)
+    if batch_latency is None and rms > rms_limit_inst:
+      batch_latency = (b + 1) * batch_period + batch_processing_time - onset
+
+    if batch_latency is not None and awd_latency is not None:
+      break
+
+  return batch_latency, awd_latency
+
+
+random.seed(1)
+fig, axes = plt.subplots(len(scenarios), 1)
+
+for (name, func), ax in zip(scenarios, axes):
+  batch_results = []
+  awd_results = []
+  for k in range(trials):
+    onset = random.uniform(0.0, batch_period)
+    phase = random.uniform(0.0, 2 * math.pi)
+    batch_latency, awd_latency = measure(func, onset, phase)
+    if batch_latency is not None:
+      batch_results.append(batch_latency * 1e6)
+    if awd_latency is not None:
+      awd_results.append(awd_latency * 1e6)
+
+  def stats(results):
+    if len(results) == 0:
+      return "never"
+    return "min %8.1f us, mean %8.1f us, max %8.1f us (%d/%d detected)" % (min(results), sum(results) / len(results), max(results), len(results), trials)
+
+  print("%s:" % name)
+  print("  batch RMS path:      " + stats(batch_results))
+  print("  analog watchdog path: " + stats(awd_results))
+
+  if len(batch_results) > 0:
+    ax.hist(batch_results, bins=50, alpha=0.6, label="batch RMS")
+  if len(awd_results) > 0:
+    ax.hist(awd_results, bins=50, alpha=0.6, label="analog watchdog")
+  ax.set_title(name)
+  ax.set_xlabel("detection latency [us]")
+  ax.legend()
+
+plt.tight_layout()
+plt.show()
@@ -0,0 +1,219 @@
+# Simulation of power amp supply (PVDD) target selection in the BlockBox controller.
+# Compares the volume-based target (PVDD set from the volume setting alone) with envelope tracking
+# (PVDD additionally lowered to follow the DAP output levels, raised immediately on louder signals, released slowly).
+# Envelope tracking is simulated with the DAP look-ahead envelope (peak of the audio in the DAP output delay line, read on the
+# envelope interrupt and periodically) and, for comparison, with a plain output peak-hold read periodically (no look-ahead).
+# Reports the relative supply-dependent amplifier losses and the headroom violations (samples needing more PVDD than available).
+
+import math
+import random
+import matplotlib.pyplot as plt
+
+
+# PVDD limits and behaviour (pvdd_control.h, power_amp_interface.h)
+pvdd_min = 18.7
+pvdd_max = 53.5
+pvdd_rise_rate = (pvdd_max - pvdd_min) / 0.2   # supply rises from min to max in ~200ms
+pvdd_reduction_factor = 0.97                   # gradual reduction: 3% steps...
+pvdd_reduction_step_time = 0.1                 # ...each after ~100ms of settling
+
+# controller configuration (amp_manager.cpp)
+max_volume_dB = -2.0          # volume at which full-scale DAP output needs max PVDD
+lowering_hyst = 1.2
+lowering_lock_time = 0.5
+peak_read_period = 0.1        # DAP output level read period (dap_interface.h)
+envelope_margin = 1.1         # required PVDD headroom over the measured peak
+envelope_raise_headroom = 1.15
+envelope_release = 0.95       # per peak read
+envelope_floor = 0.7          # minimum envelope-based PVDD, as fraction of the volume-based PVDD (limits the worst case on sudden loud onsets)
+
+# DAP look-ahead (signal_processing.h) and envelope interrupt handling
+lookahead_time = 0.048        # output path delay covered by the envelope
+envelope_int_rise = 1.122     # envelope interrupt on a rise of this factor over the last read envelope...
+envelope_int_min = 0.001      # ...if at least this level
+# envelope interrupt to new PVDD target: up to one main loop cycle (10ms) until the interrupt is handled, INT_FLAGS + OUTPUT_PEAKS reads
+# at ~100kHz (2 + 17 bytes plus addressing, ~2.5ms), PVDD target write to the amp module (~1ms)
+envelope_int_latency = 0.0135
+
+# simulation setup
+dt = 1e-3
+duration = 60.0
+volumes_dB = [-2.0, -5.0, -8.0]
+violation_tolerance = 1.0     # volts of missing headroom tolerated (short clipping of the amp output stage is soft due to PFFB)
+
+
+# synthetic music (as full-scale fraction per 1ms step): sections of different loudness (with quiet gaps), each with a beat of transients on top of a sustained level
+def make_music(seed, volume_dB):
+  rng = random.Random(seed)
+  peaks = []
+  t = 0.0
+  while t < duration:
+    section_length = rng.uniform(4.0, 12.0)
+    section_level = rng.choice([0.0, 0.05, 0.15, 0.3, 0.5, 0.7])
+    beat_period = 60.0 / rng.uniform(80.0, 140.0)
+    n = int(section_length / dt)
+    for k in range(n):
+      tk = k * dt
+      level = section_level * rng.uniform(0.6, 1.0)
+      #transients: short decaying hits on each beat, up to full scale
+      beat_phase = math.fmod(tk, beat_period)
+      level += section_level * 0.8 * math.exp(-beat_phase / 0.03)
+      peaks.append(min(level, 1.0))
+    t += section_length
+  #apply DAP volume: peaks are post-volume output levels
+  volume_gain = 10.0 ** (volume_dB / 20.0)
+  return [p * volume_gain for p in peaks[:int(duration / dt)]]
+
+
+def required_pvdd(peak):
+  #PVDD needed to reproduce a DAP output sample of the given magnitude (at the DAP volume, post-volume level)
+  return pvdd_max * peak * 10.0 ** (-max_volume_dB / 20.0)
+
+
+def volume_pvdd(volume_dB):
+  return min(max(pvdd_max * 10.0 ** ((volume_dB - max_volume_dB) / 20.0), pvdd_min), pvdd_max)
+
+
+class Supply:
+  def __init__(self, voltage):
+    self.voltage = voltage
+    self.target = voltage
+    self.reduction_timer = 0.0
+
+  def set_target(self, target):
+    self.target = target
+    self.reduction_timer = 0.0
+
+  def step(self):
+    if self.voltage < self.target:
+      self.voltage = min(self.voltage + pvdd_rise_rate * dt, self.target)
+    elif self.voltage > self.target:
+      #gradual reduction, one step at a time
+      self.reduction_timer += dt
+      if self.reduction_timer >= pvdd_reduction_step_time:
+        self.reduction_timer = 0.0
+        self.voltage = max(self.voltage * pvdd_reduction_factor, self.target)
+
+
+class Controller:
+  def __init__(self, supply, volume_dB, mode):
+    self.supply = supply
+    self.volume_dB = volume_dB
+    self.mode = mode
+    self.envelope = pvdd_max
+    self.lock_timer = 0.0
+    self.peak_hold = 0.0
+    self.read_timer = 0.0
+    self.int_timer = -1.0
+    self.envelope_read = 0.0
+
+  def apply(self, pvdd):
+    current = self.supply.target
+    if current < pvdd:
+      self.supply.set_target(pvdd)
+    elif current / pvdd > lowering_hyst and self.lock_timer <= 0.0:
+      self.supply.set_target(pvdd)
+      self.lock_timer = lowering_lock_time
+
+  def update(self):
+    desired = volume_pvdd(self.volume_dB)
+    if self.mode != "volume":
+      desired = min(desired, max(self.envelope, desired * envelope_floor, pvdd_min))
+    self.apply(desired)
+
+  def read_levels(self, level):
+    required = required_pvdd(level) * envelope_margin
+    if required > self.envelope:
+      #attack: raise immediately, with some extra headroom to avoid frequent small increases
+      self.envelope = required * envelope_raise_headroom
+    else:
+      #release: decay slowly towards the required level
+      self.envelope = max(required, self.envelope * envelope_release)
+    self.update()
+
+  #peak: output peak of this step, dap_envelope: DAP look-ahead envelope after this step (peak of the upcoming delayed output)
+  def step(self, peak, dap_envelope):
+    self.peak_hold = max(self.peak_hold, peak)
+
+    if self.lock_timer > 0.0:
+      self.lock_timer -= dt
+      if self.lock_timer <= 0.0:
+        self.update()
+
+    if self.mode == "lookahead":
+      #DAP side: interrupt on envelope rise
+      if self.int_timer < 0.0 and dap_envelope >= envelope_int_min and dap_envelope > self.envelope_read * envelope_int_rise:
+        self.envelope_read = dap_envelope
+        self.int_timer = envelope_int_latency
+      if self.int_timer >= 0.0:
+        self.int_timer -= dt
+        if self.int_timer < 0.0:
+          self.envelope_read = dap_envelope
+          self.read_levels(dap_envelope)
+
+    if self.mode != "volume":
+      self.read_timer += dt
+      if self.read_timer >= peak_read_period:
+        self.read_timer = 0.0
+        if self.mode == "lookahead":
+          self.envelope_read = dap_envelope
+          self.read_levels(dap_envelope)
+        else:
+          self.read_levels(self.peak_hold)
+          self.peak_hold = 0.0
+
+
+def run(peaks, volume_dB, mode):
+  supply = Supply(volume_pvdd(volume_dB))
+  controller = Controller(supply, volume_dB, mode)
+  controller.update()
+  #DAP look-ahead envelope: maximum over the delay line contents, i.e. the output peaks of the following lookahead_time
+  lookahead_steps = int(round(lookahead_time / dt))
+  dap_envelopes = [max(peaks[k + 1:k + 1 + lookahead_steps], default=0.0) for k in range(len(peaks))]
+  trace = []
+  loss = 0.0
+  violations = 0
+  worst = 0.0
+  for peak, dap_envelope in zip(peaks, dap_envelopes):
+    controller.step(peak, dap_envelope)
+    supply.step()
+    trace.append(supply.voltage)
+    #supply-dependent losses (switching and output filter ripple) scale roughly with PVDD squared
+    loss += supply.voltage ** 2 * dt
+    missing = required_pvdd(peak) - supply.voltage
+    if missing > violation_tolerance:
+      violations += 1
+    worst = max(worst, missing)
+  return trace, loss, violations, worst
+
+
+trials = 5
+plot_data = None
+for volume_dB in volumes_dB:
+  print("volume %.1f dB:" % volume_dB)
+  for seed in range(trials):
+    peaks = make_music(seed, volume_dB)
+    trace_vol, loss_vol, viol_vol, worst_vol = run(peaks, volume_dB, "volume")
+    trace_hold, loss_hold, viol_hold, worst_hold = run(peaks, volume_dB, "peak_hold")
+    trace_env, loss_env, viol_env, worst_env = run(peaks, volume_dB, "lookahead")
+    if plot_data is None:
+      plot_data = (peaks, trace_vol, trace_hold, trace_env)
+    print("  music %d:" % seed)
+    print("    volume-based:         mean PVDD %5.1f V, %5d ms headroom violations (worst %5.1f V)" % (sum(trace_vol) / len(trace_vol), viol_vol, max(worst_vol, 0.0)))
+    print("    peak-hold tracking:   mean PVDD %5.1f V, %5d ms headroom violations (worst %5.1f V), supply-dependent losses %5.1f%% lower" %
+          (sum(trace_hold) / len(trace_hold), viol_hold, max(worst_hold, 0.0), 100.0 * (1.0 - loss_hold / loss_vol)))
+    print("    look-ahead envelope:  mean PVDD %5.1f V, %5d ms headroom violations (worst %5.1f V), supply-dependent losses %5.1f%% lower" %
+          (sum(trace_env) / len(trace_env), viol_env, max(worst_env, 0.0), 100.0 * (1.0 - loss_env / loss_vol)))
+
+
+peaks, trace_vol, trace_hold, trace_env = plot_data
+t = [k * dt for k in range(len(peaks))]
+plt.plot(t, [required_pvdd(p) for p in peaks], label="required PVDD", alpha=0.5)
+plt.plot(t, trace_vol, label="volume-based PVDD")
+plt.plot(t, trace_hold, label="peak-hold tracking PVDD")
+plt.plot(t, trace_env, label="look-ahead envelope PVDD")
+plt.xlabel("time [s]")
+plt.ylabel("voltage [V]")
+plt.legend()
+plt.tight_layout()
+plt.show()
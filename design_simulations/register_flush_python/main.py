@@ -0,0 +1,115 @@
+# Host-side traffic model of staged register writes (RegisterSet valid/dirty tracking, RegI2CModuleInterface::FlushRegistersAsync), without hardware.
+# Counts the I2C transfers and bytes of the HiFiDAC setup in AudioPathManager::InitDACSetup, and the time it takes to complete, comparing:
+#  - former: one setter per register, each a single-register write followed by a readback, chained one after the other
+#  - staged: changed registers are staged, runs of consecutive dirty registers are merged into one multi-register write + readback each,
+#    all runs are queued at once, and registers already known to hold the desired value are skipped
+# Transfer completion callbacks run in the main loop (ModuleInterface::LoopTasks), so every chained step waits for the next loop cycle.
+# Also replays DAP preset (mixer/EQ) re-selection after a DAP module reset, where the former plain cache comparison skipped needed writes.
+
+import math
+
+
+loop_period = 0.010          # MAIN_LOOP_PERIOD_MS
+bus_bit_time = 1.0 / 100e3   # main bus I2C timing 0x2000090E: ~100 kHz
+byte_bits = 9                # 8 data bits + ACK
+
+# HiFiDAC register sizes (I2CDEF_HIFIDAC_REG_SIZES, relevant subset)
+dac_sizes = { 0x08: 1, 0x22: 1, 0x23: 1, 0x25: 1, 0x26: 2, 0x30: 1, 0x31: 4, 0x32: 4 }
+# registers written by InitDACSetup after CONTROL (0x08)
+dac_setup_regs = [0x22, 0x23, 0x25, 0x26, 0x30, 0x31, 0x32]
+
+
+def transfer_bytes(sizes, read):
+  #address + register address, each register followed by its CRC byte; reads add a repeated start with address
+  return 2 + (1 if read else 0) + sum(size + 1 for size in sizes)
+
+def runs_of(regs):
+  runs = []
+  for reg in sorted(regs):
+    if runs and runs[-1][-1] + 1 == reg:
+      runs[-1].append(reg)
+    else:
+      runs.append([reg])
+  return runs
+
+
+class Bus:
+  def __init__(self):
+    self.t = 0.0
+    self.transfers = 0
+    self.bytes = 0
+
+  def transfer(self, sizes, read, start):
+    #bus serves transfers one after the other
+    count = transfer_bytes(sizes, read)
+    self.t = max(self.t, start) + count * byte_bits * bus_bit_time
+    self.transfers += 1
+    self.bytes += count
+    return self.t
+
+def next_loop(t):
+  return math.floor(t / loop_period + 1e-9) * loop_period + loop_period
+
+
+def former_setup(regs, bus, start):
+  #each setter: write, then (next loop cycle) readback, then (next loop cycle) the next setter
+  t = start
+  for reg in regs:
+    done = bus.transfer([dac_sizes[reg]], False, t)
+    done = bus.transfer([dac_sizes[reg]], True, next_loop(done))
+    t = next_loop(done)
+  return t
+
+def staged_setup(regs, valid, bus, start):
+  #skip registers known to hold the desired value, merge the rest into runs - all runs queued at once, readbacks queued from their callbacks
+  dirty = [reg for reg in regs if reg not in valid]
+  if not dirty:
+    return start
+  writes = [bus.transfer([dac_sizes[reg] for reg in run], False, start) for run in runs_of(dirty)]
+  end = start
+  for run, done in zip(runs_of(dirty), writes):
+    end = bus.transfer([dac_sizes[reg] for reg in run], True, next_loop(done))
+  for reg in dirty:
+    valid.add(reg)
+  return next_loop(end)
+
+
+print("HiFiDAC setup (InitDACSetup, CONTROL + 7 setup registers):")
+print("  %-56s %9s %7s %9s %9s" % ("", "transfers", "bytes", "bus time", "duration"))
+for name, valid in (("cold init / after module reset (cache invalid)", set()), ("re-applied, module state known", set(dac_setup_regs))):
+  for mode in ("former", "staged"):
+    bus = Bus()
+    done = bus.transfer([1], False, 0.0)
+    done = bus.transfer([1], True, next_loop(done))
+    t = next_loop(done)
+    if mode == "former":
+      t = former_setup(dac_setup_regs, bus, t)
+    else:
+      t = staged_setup(dac_setup_regs, set(valid), bus, t)
+    print("  %-56s %9d %7d %6.2f ms %6.0f ms" % ("%s, %s:" % (name, mode), bus.transfers, bus.bytes, 1e3 * bus.bytes * byte_bits * bus_bit_time, 1e3 * t))
+print("  staged runs: %s" % ", ".join("0x%02X-0x%02X" % (run[0], run[-1]) if len(run) > 1 else "0x%02X" % run[0] for run in runs_of(dac_setup_regs)))
+print()
+
+
+# DAP preset re-application after a DAP module reset (UpdateMixerAndEQParams during re-initialisation): mixer (0x40), biquad setup (0x48),
+# biquad coefficients ch1/ch2 (0x50/0x51) - the module returns to its defaults, while the controller's register cache still holds preset A
+dap_regs = [0x40, 0x48, 0x50, 0x51]
+preset_a = { reg: "A" for reg in dap_regs }
+
+print("DAP preset re-application after a DAP module reset:")
+for mode in ("former", "staged"):
+  cache = dict(preset_a)
+  valid = set(dap_regs)
+  #module reset: registers back to defaults; the staged mode sees the reset flag and invalidates the register set
+  module = { reg: "default" for reg in dap_regs }
+  if mode == "staged":
+    valid = set()
+  written = 0
+  for reg in dap_regs:
+    skip = cache[reg] == preset_a[reg] and (mode == "former" or reg in valid)
+    if not skip:
+      module[reg] = cache[reg] = preset_a[reg]
+      valid.add(reg)
+      written += 1
+  wrong = sum(1 for reg in dap_regs if module[reg] != preset_a[reg])
+  print("  %-7s %d of %d registers written, %d left on module defaults" % (mode + ":", written, len(dap_regs), wrong))
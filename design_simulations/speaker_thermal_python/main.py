@@ -0,0 +1,125 @@
+# Simulation of the speaker voice coil thermal model in the power amp controller (speaker_model.c), with the gain reduction loop through the BlockBox controller.
+# Drives the two-time-constant model with a power trace (one value per ADC batch) and reports the modelled temperature rise with and without gain reduction.
+# Usage: main.py [trace.csv] - optional recorded trace, one average real power value in W per line (e.g. logged PowerAmp MON_PAVG values, resampled to the batch time).
+# Without a trace, synthetic sine and music power traces are used.
+
+import math
+import random
+import sys
+import matplotlib.pyplot as plt
+
+
+# model timing and limit behaviour (speaker_model.h)
+batch_time = 512 * 2.0 * (61.5 + 12.5) / 18e6
+limit_knee = 0.8
+gain_red_at_max_dB = -6.0
+gain_red_limit_dB = -20.0
+
+# controller behaviour (power_amp_interface.cpp, amp_manager.cpp)
+poll_period = 0.2            # speaker model output read period
+reduction_step_dB = 0.5
+
+# model parameters (amp_manager.cpp): woofer and tweeter
+speakers = {
+  "woofer": { "rth_coil": 0.6, "tau_coil": 10.0, "rth_magnet": 0.9, "tau_magnet": 600.0, "max_rise": 150.0, "rated_power": 100.0 },
+  "tweeter": { "rth_coil": 1.2, "tau_coil": 5.0, "rth_magnet": 1.8, "tau_magnet": 400.0, "max_rise": 150.0, "rated_power": 50.0 },
+}
+
+duration = 1800.0
+
+
+class SpeakerModel:
+  def __init__(self, p):
+    self.p = p
+    self.alpha_coil = 1.0 - math.exp(-batch_time / p["tau_coil"])
+    self.alpha_magnet = 1.0 - math.exp(-batch_time / p["tau_magnet"])
+    self.temp_coil = 0.0
+    self.temp_magnet = 0.0
+
+  def process_batch(self, power):
+    self.temp_coil += self.alpha_coil * (power * self.p["rth_coil"] - self.temp_coil)
+    self.temp_magnet += self.alpha_magnet * (power * self.p["rth_magnet"] - self.temp_magnet)
+    return self.temp_coil + self.temp_magnet
+
+  def gain_reduction(self):
+    max_rise = self.p["max_rise"]
+    knee = max_rise * limit_knee
+    rise = self.temp_coil + self.temp_magnet
+    if rise <= knee:
+      return 0.0
+    return max(gain_red_at_max_dB * (rise - knee) / (max_rise - knee), gain_red_limit_dB)
+
+
+def run(trace, p, limiting):
+  model = SpeakerModel(p)
+  applied_dB = 0.0
+  poll_timer = 0.0
+  temps = []
+  reductions = []
+  limited_time = 0.0
+  for power in trace:
+    #applied gain reduction scales the output power
+    temps.append(model.process_batch(power * 10.0 ** (applied_dB / 10.0)))
+    poll_timer += batch_time
+    if limiting and poll_timer >= poll_period:
+      poll_timer = 0.0
+      applied_dB = math.floor(model.gain_reduction() / reduction_step_dB) * reduction_step_dB
+    reductions.append(applied_dB)
+    if applied_dB < 0.0:
+      limited_time += batch_time
+  return temps, reductions, limited_time
+
+
+# synthetic traces: continuous sine at rated power (worst case), and music with loud sections at up to twice rated (program) power
+def make_sine(p):
+  return [p["rated_power"] * 1.5] * int(duration / batch_time)
+
+def make_music(p, seed):
+  rng = random.Random(seed)
+  trace = []
+  while len(trace) * batch_time < duration:
+    section_length = rng.uniform(20.0, 120.0)
+    section_level = rng.choice([0.05, 0.3, 0.6, 1.0, 2.0])
+    for k in range(int(section_length / batch_time)):
+      #crest factor variation within the section
+      trace.append(p["rated_power"] * section_level * rng.uniform(0.3, 1.0))
+  return trace[:int(duration / batch_time)]
+
+def load_trace(path):
+  with open(path) as f:
+    return [abs(float(line.split(",")[0])) for line in f if line.strip() and not line.startswith("#")]
+
+
+traces = []
+if len(sys.argv) > 1:
+  recorded = load_trace(sys.argv[1])
+  for name, p in speakers.items():
+    traces.append(("%s, recorded trace" % name, p, recorded))
+else:
+  for name, p in speakers.items():
+    traces.append(("%s, 1.5x rated sine" % name, p, make_sine(p)))
+    traces.append(("%s, music" % name, p, make_music(p, 1)))
+
+fig, axes = plt.subplots(len(traces), 1)
+if len(traces) == 1:
+  axes = [axes]
+
+for (name, p, trace), ax in zip(traces, axes):
+  temps_free, _, _ = run(trace, p, False)
+  temps_lim, reductions, limited_time = run(trace, p, True)
+  print("%s:" % name)
+  print("  no limiting:   max temperature rise %6.1f K (limit %5.1f K)" % (max(temps_free), p["max_rise"]))
+  print("  with limiting: max temperature rise %6.1f K, limited %5.1f%% of the time, max reduction %5.1f dB" %
+        (max(temps_lim), 100.0 * limited_time / (len(trace) * batch_time), min(reductions)))
+
+  t = [k * batch_time for k in range(len(trace))]
+  ax.plot(t, temps_free, label="no limiting")
+  ax.plot(t, temps_lim, label="with limiting")
+  ax.axhline(p["max_rise"], color="k", linestyle="--")
+  ax.set_title(name)
+  ax.set_ylabel("temperature rise [K]")
+  ax.legend()
+
+axes[-1].set_xlabel("time [s]")
+plt.tight_layout()
+plt.show()
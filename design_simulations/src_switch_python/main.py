@@ -0,0 +1,255 @@
+# Simulation of DAP input switching through the SRC's adaptive resampling loop (sample_rate_conv.c), batch by batch.
+# Input A is active for a while, then the active input is switched to input B, whose clock has a different error against the output clock.
+# Input samples arrive in whole receive batches (I2S: 96 samples), output batches of 96 samples at 96 kHz are taken by the SAI.
+# Compares:
+#  - former: same input rate keeps the buffer and the averaging histories of input A (the loop follows B through its long averaging windows),
+#    a different input rate resets the SRC cold (rate error averaging restarts at 8 batches, 1:1 initial ratio)
+#  - warm switch: old signal faded out over SRC_FADE_BATCHES, SRC reset, rate error history pre-filled with B's rate error as tracked by the
+#    inputs module (samples counted over a window of output batches while B was idle), new signal faded in
+# Reports the output gap (batches without full-gain output - the former switch cuts and splices hard, the warm switch fades), the time until
+# the loop has settled on B's rate (100 ms average ratio within the loop's own steady-state jitter of 500 ppm, averaged fill error within
+# 48 samples, for the rest of the run - resolution is the 100 ms window), the maximum ratio excursion of 10 ms averages in the first 10 s
+# (audible as pitch shift), and underruns.
+# The host test dap_test_src_switch (firmware/HostTest/DigitalAudioProcessor) runs the warm and cold switch through the firmware's own
+# sample_rate_conv.c and checks the output gap, settling and ratio excursion; this model also covers the former switch behaviour.
+
+import math
+import random
+
+
+# firmware parameters (sample_rate_conv.h, inputs.h)
+batch = 96
+phase_min, phase_max = batch - 2, batch + 2
+critical = phase_max + 1
+ideal = 5 * batch
+buf_total = 9 * batch
+rate_avg_initial, rate_avg = 8, 6144
+fill_avg = 8192
+coeff_p, coeff_d = 1.0 / 4096.0, 2.0
+fade_batches = 2
+track_min, track_max = 8192, 131072
+
+out_rate = 96000
+rx_batch = 96                # input samples per receive batch
+
+pre_switch_s = 60.0
+post_switch_s = 30.0
+
+
+class Source:
+  def __init__(self, rate, ppm, phase):
+    self.rate = rate
+    self.ppm = ppm
+    self.phase = phase         # in receive batches
+    self.fract = 0.0           # fractional converted samples (44.1k -> 96k)
+    self.counted = 0           # received samples, for rate tracking
+
+  def receive(self, t0, t1):
+    #receive batches arriving between t0 and t1 (seconds of output clock), returned as samples at the SRC buffer rate
+    period = rx_batch / (self.rate * (1.0 + self.ppm * 1e-6))
+    count = int(t1 / period + self.phase) - int(t0 / period + self.phase)
+    chunks = []
+    for _ in range(count):
+      self.counted += rx_batch
+      self.fract += rx_batch * out_rate / self.rate
+      converted = int(self.fract)
+      self.fract -= converted
+      chunks.append(converted)
+    return chunks
+
+
+class SRC:
+  def __init__(self, fades):
+    self.fades = fades
+    self.rate = None
+    self.seed = None
+    self.ready = False
+    self.pending = False
+    self.fade = 0
+    self.reset()
+    self.reset_averaging()
+
+  def reset(self):
+    self.ready = False
+    self.pending = False
+    self.fill = 0.0            # buffered samples (read position fractional)
+    self.since_output = 0
+
+  def reset_averaging(self):
+    if self.seed is not None:
+      error = self.seed * batch
+      sums = [math.floor((k + 1) * error + 0.5) for k in range(rate_avg)]
+      self.rate_hist = [value - (sums[k - 1] if k > 0 else 0) for k, value in enumerate(sums)]
+      self.rate_len = rate_avg
+      self.rate_sum = sum(self.rate_hist)
+    else:
+      self.rate_hist = [0] * rate_avg
+      self.rate_len = rate_avg_initial
+      self.rate_sum = 0
+    self.rate_pos = 0
+    self.fill_hist = [0] * fill_avg
+    self.fill_sum = 0
+    self.fill_pos = 0
+    self.last_fill_avg = 0.0
+
+  def configure(self, rate):
+    self.rate = rate
+    self.seed = None
+    self.reset()
+
+  def switch(self, rate, seed):
+    self.rate = rate
+    self.seed = seed
+    if self.ready:
+      self.pending = True
+    else:
+      self.reset()
+
+  def write(self, samples):
+    if self.pending:
+      return
+    free = buf_total - 1 - int(self.fill)
+    if free < samples:
+      self.fill -= samples - free
+    self.fill += samples
+    self.since_output += samples
+    if not self.ready and int(self.fill) > ideal:
+      self.reset_averaging()
+      self.fade = 0 if self.fades else fade_batches * batch
+      self.ready = True
+
+  def output(self):
+    #returns (phase step, output gain at the end of the batch), or None if no output
+    if not self.ready:
+      self.since_output = 0
+      return None
+    available = int(self.fill)
+    if available < critical:
+      if self.pending:
+        self.reset()
+        return None
+      self.ready = False
+      self.since_output = 0
+      return "underrun"
+
+    error = self.since_output - batch
+    self.since_output = 0
+    if self.rate_len >= rate_avg:
+      self.rate_len = rate_avg
+      self.rate_sum -= self.rate_hist[self.rate_pos]
+    else:
+      self.rate_len += 1
+    self.rate_sum += error
+    self.rate_hist[self.rate_pos] = error
+    fill_error = available - ideal
+    self.fill_sum += fill_error - self.fill_hist[self.fill_pos]
+    self.fill_hist[self.fill_pos] = fill_error
+    self.rate_pos = (self.rate_pos + 1) % rate_avg
+    self.fill_pos = (self.fill_pos + 1) % fill_avg
+
+    fill_avg_error = self.fill_sum / fill_avg
+    step = batch + self.rate_sum / self.rate_len + coeff_p * fill_avg_error + coeff_d * (fill_avg_error - self.last_fill_avg)
+    self.last_fill_avg = fill_avg_error
+    step = min(max(step, phase_min), phase_max)
+    self.fill -= step
+
+    if self.pending:
+      self.fade = max(self.fade - batch, 0)
+      if self.fade == 0:
+        self.reset()
+    else:
+      self.fade = min(self.fade + batch, fade_batches * batch)
+    return step, self.fade / (fade_batches * batch)
+
+
+class Tracker:
+  #inputs module rate tracking of an (idle) input: received samples over a window of output batches
+  def __init__(self, source):
+    self.source = source
+    self.start_batch = 0
+    self.start_samples = 0
+    self.error = None
+
+  def update(self, n):
+    batches = n - self.start_batch
+    samples = self.source.counted - self.start_samples
+    if batches >= track_min:
+      self.error = (samples * out_rate // self.source.rate - batches * batch) / (batches * batch)
+    if batches >= track_max:
+      self.start_batch, self.start_samples = n, self.source.counted
+
+
+def run(rate_a, ppm_a, rate_b, ppm_b, warm, seed):
+  rng = random.Random(seed)
+  a = Source(rate_a, ppm_a, rng.random())
+  b = Source(rate_b, ppm_b, rng.random())
+  tracker = Tracker(b)
+  src = SRC(warm)
+  src.configure(rate_a)
+  active = a
+
+  switch_batch = int(pre_switch_s * 1000)
+  total = int((pre_switch_s + post_switch_s) * 1000)
+  true_step = batch * (1.0 + ppm_b * 1e-6)
+  steps, fills = [], []
+  gap = 0
+  underruns = 0
+  for n in range(total):
+    t0, t1 = n * batch / out_rate, (n + 1) * batch / out_rate
+    for source in (a, b):
+      chunks = source.receive(t0, t1)
+      if source is active:
+        for chunk in chunks:
+          src.write(chunk)
+    if n % 10 == 0:
+      #main loop
+      tracker.update(n)
+
+    if n == switch_batch:
+      active = b
+      if warm:
+        src.switch(rate_b, tracker.error)
+      elif rate_b != src.rate:
+        src.configure(rate_b)
+
+    result = src.output()
+    if result == "underrun":
+      underruns += 1
+      result = None
+    if n >= switch_batch:
+      steps.append(result[0] if result else None)
+      fills.append(src.fill_sum / fill_avg if result else None)
+      if n < switch_batch + 100 and (result is None or result[1] < 1.0):
+        gap += 1
+
+  #settling: from the end backwards, last time the 100 ms average ratio error or the averaged fill error was out of bounds
+  settled = 0
+  window = 100
+  for k in range(len(steps) - window, -1, -10):
+    segment = steps[k:k + window]
+    if None in segment or abs(sum(segment) / window - true_step) / batch * 1e6 > 500.0 or abs(fills[k + window - 1]) > 48.0:
+      settled = k + window
+      break
+  excursion = 0.0
+  for k in range(0, 10000, 10):
+    segment = steps[k:k + 10]
+    if None not in segment:
+      excursion = max(excursion, abs(sum(segment) / 10 - true_step) / batch * 1e6)
+  return gap, settled, excursion, underruns
+
+
+scenarios = [
+  ("I2S 48k +40 ppm -> I2S 48k -60 ppm", (48000, 40.0, 48000, -60.0)),
+  ("I2S 48k +40 ppm -> I2S 44.1k -25 ppm", (48000, 40.0, 44100, -25.0)),
+  ("I2S 44.1k +10 ppm -> I2S 96k +80 ppm", (44100, 10.0, 96000, 80.0)),
+]
+runs = 3
+for name, params in scenarios:
+  print("%s:" % name)
+  for label, warm in (("former", False), ("warm switch", True)):
+    totals = [0.0, 0.0, 0.0, 0.0]
+    for seed in range(runs):
+      for i, value in enumerate(run(*params, warm, seed)):
+        totals[i] += value / runs
+    print("  %-12s output gap %4.1f ms, settled after %7.1f ms, max ratio excursion %6.0f ppm, underruns %.1f" % (
+      label + ":", totals[0], totals[1], totals[2], totals[3]))
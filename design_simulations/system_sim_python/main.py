@@ -0,0 +1,197 @@
+# Host-side system simulator for the BlockBox controller and its modules (see system_model.py, register_maps.py), without hardware.
+# NOTE: this is a secondary, behavioural model of the controller firmware. The primary system simulation builds the real controller
+# firmware on the host against the HAL shim, with timed buses and module stand-ins (firmware/HostTest/BlockBoxController/SystemSim,
+# test bbc_test_system_sim) - where the two disagree, that one is authoritative, and this model has to be kept in step by hand.
+# The I2C buses (I2C5 main bus with EEPROM, DAP, HiFiDAC, PowerAmp and RTC, I2C3 with the charger) are timed bit by bit from the TIMINGR value and
+# I2C kernel clock, the battery monitor and Bluetooth receiver UARTs by their baud rates and framing. Module stand-ins hold the registers of
+# the real register maps and raise interrupts like the module firmware; the controller side models the main loop, interface transfer queues,
+# interrupt flag handling and refresh groups. Scripted scenarios report:
+#  - bus load with the periodic reads of the interfaces, idle and with monitoring enabled (GUI status/monitor screens)
+#  - latency of volume changes, DAP input switching, module status interrupts and UART change notifications
+#  - duration of register flushes (DAP preset, HiFiDAC signal chain) and EEPROM settings saves, and how they delay a volume change
+# Run "python register_maps.py" to list the parsed register maps and refresh groups.
+
+import random
+
+from register_maps import defines, maps
+from system_model import BlockBoxSystem, i2c_bit_rate, loop_period
+
+
+sim_time = 60.0
+event_period = 0.75          # spacing of scripted events, in s (random phase within the first half)
+eeprom_page_size = defines["IF_EEPROM_PAGE_SIZE"]
+eeprom_write_delay = 0.004   # HAL_Delay(4) between page writes in EEPROMInterface::WriteNextSectionPageIfDirty
+
+
+def stats(values):
+  values = sorted(values)
+  return "mean %6.1f ms, 90%% %6.1f ms, max %6.1f ms" % (1e3 * sum(values) / len(values), 1e3 * values[int(0.9 * (len(values) - 1))], 1e3 * values[-1])
+
+
+class Watches:
+  #one-shot manager reactions to register updates seen in the main loop
+  def __init__(self, iface):
+    self.pending = []
+    iface.listeners.append(self.update)
+
+  def add(self, reg, predicate, action):
+    self.pending.append((reg, predicate, action))
+
+  def update(self, reg, value):
+    for watch in list(self.pending):
+      if watch[0] == reg and watch[1](value):
+        self.pending.remove(watch)
+        watch[2]()
+
+
+def ui_event(system, t, action):
+  #UI/GUI input is handled in the main loop: the action runs in the first loop cycle after the event
+  def queue():
+    system.controller.loop_tasks.insert(0, once)
+  def once(cycle):
+    system.controller.loop_tasks.remove(once)
+    action()
+  system.sim.at(t, queue)
+
+
+def volume_change(system, value, done):
+  #AudioPathManager volume: HiFiDAC volume and DAP volume gains written concurrently, each read back (gain planner)
+  dac, dap = maps["dac"], maps["dap"]
+  remaining = [2]
+  def part(_):
+    remaining[0] -= 1
+    if remaining[0] == 0:
+      done()
+  system.dac.write(dac["VOLUME"], value, lambda _: system.dac.read(dac["VOLUME"], 1, part))
+  system.dap.write(dap["VOLUME_GAINS"], value, lambda _: system.dap.read(dap["VOLUME_GAINS"], 1, part))
+
+
+def flush(iface, runs, done):
+  #RegI2CModuleInterface::FlushRegistersAsync: all runs of dirty registers written, then read back, queued at once
+  remaining = [len(runs)]
+  def run_done(_):
+    remaining[0] -= 1
+    if remaining[0] == 0:
+      done()
+  for first, count in runs:
+    iface.write(first, [1] * count, lambda _, first=first, count=count: iface.read(first, count, run_done))
+
+
+def eeprom_save(system, pages, done):
+  #EEPROMInterface: dirty pages written one after the other from the write callbacks, with a blocking delay between pages
+  def write_page(index):
+    def written(_):
+      if index + 1 < pages:
+        system.controller.block(eeprom_write_delay)
+        write_page(index + 1)
+      else:
+        done()
+    system.eeprom.write_raw(defines["IF_EEPROM_STORAGE_START"] + eeprom_page_size * index, eeprom_page_size, written)
+  write_page(0)
+
+
+def scripted(monitors, seed, script):
+  #runs the given script once per event slot, returns the measured latencies
+  system = BlockBoxSystem(monitors)
+  rng = random.Random(seed)
+  latencies = []
+  t = 1.0
+  while t < sim_time - 1.0:
+    start = t + rng.uniform(0.0, event_period / 2)
+    script(system, start, lambda start=start: latencies.append(system.sim.t - start))
+    t += event_period
+  system.sim.run_until(sim_time)
+  return latencies
+
+
+def script_volume(system, start, record):
+  ui_event(system, start, lambda: volume_change(system, random.randrange(0x100), record))
+
+def script_input_switch(system, start, record):
+  dap = maps["dap"]
+  watches = system.__dict__.setdefault("dap_watches", Watches(system.dap))
+  def switch():
+    target = 1 + (system.dap.module.values[dap["INPUT_ACTIVE"]] % 5)
+    watches.add(dap["INPUT_ACTIVE"], lambda value: value == target, record)
+    system.dap.write(dap["INPUT_ACTIVE"], target, lambda _: system.dap.read(dap["INPUT_ACTIVE"]))
+  ui_event(system, start, switch)
+
+def module_change(iface_name, reg_name, flag_name):
+  def script(system, start, record):
+    iface = getattr(system, iface_name)
+    regmap = iface.regmap
+    watches = system.__dict__.setdefault(iface_name + "_watches", Watches(iface))
+    def change():
+      value = (iface.module.values[regmap[reg_name]] + 1) & 0xFF
+      watches.add(regmap[reg_name], lambda v: v == value, record)
+      iface.module.change(reg_name, value, flag_name)
+    system.sim.at(start, change)
+  return script
+
+def uart_change(iface_name, reg_name, then=None):
+  def script(system, start, record):
+    iface = getattr(system, iface_name)
+    watches = system.__dict__.setdefault(iface_name + "_watches", Watches(iface))
+    def change():
+      value = (iface.module.values[iface.regmap[reg_name]] + 1) & 0xFF
+      watches.add(iface.regmap[reg_name], lambda v: v == value, (lambda: then(system, value, record)) if then else record)
+      iface.module.change(reg_name, value)
+    system.sim.at(start, change)
+  return script
+
+def script_during(background, foreground):
+  #foreground event (volume change) started a few ms after a long background operation
+  def script(system, start, record):
+    system.sim.at(start, lambda: background(system, lambda: None))
+    ui_event(system, start + 0.005, lambda: foreground(system, record))
+  return script
+
+
+dap_preset_runs = [(maps["dap"]["MIXER_GAINS"], 1), (maps["dap"]["BIQUAD_SETUP"], 1), (maps["dap"]["BIQUAD_COEFFS_CH1"], 2)]
+dac_setup_runs = [(maps["dac"]["PATH"], 2), (maps["dac"]["TDM_SLOT_NUM"], 2), (maps["dac"]["FILTER_SHAPE"], 3)]
+eeprom_save_pages = 8
+
+
+print("I2C bit rate %.1f kHz (TIMINGR 0x2000090E, 8 MHz kernel clock), main loop %.0f ms" % (i2c_bit_rate / 1e3, loop_period * 1e3))
+print()
+
+print("bus load with periodic interface reads, %.0f s:" % sim_time)
+for monitors in (False, True):
+  system = BlockBoxSystem(monitors)
+  system.sim.run_until(1.0)
+  system.reset_stats()
+  system.sim.run_until(1.0 + sim_time)
+  print("  %s:" % ("monitoring enabled" if monitors else "idle"))
+  for link in system.links():
+    uart = link in (system.bms_uart.stats, system.btrx_uart.stats)
+    print("    %-15s %6.1f %-12s %7.1f B/s, %5.2f %% busy%s" % (link.name, link.transfers / sim_time, "frames/s," if uart else "transfers/s,", link.bytes / sim_time,
+                                                               100 * link.busy / sim_time, " (both directions)" if uart else ""))
+print()
+
+print("latencies (event to controller seeing / completing it):")
+scenarios = [
+  ("volume change (DAC + DAP gains, with readback)", script_volume),
+  ("DAP input switch until active input seen", script_input_switch),
+  ("DAP streaming status change (INT_STATUS)", module_change("dap", "STATUS", "INT_STATUS")),
+  ("HiFiDAC lock change", module_change("dac", "STATUS", "INT_LOCK")),
+  ("PowerAmp safety warning source", module_change("amp", "SWARN_SOURCE", "INT_SWARN")),
+  ("BMS state-of-charge notification (UART4)", uart_change("bms", "SOC_FRACTION")),
+  ("Bluetooth absolute volume to volume applied", uart_change("btrx", "VOLUME", volume_change)),
+]
+for name, script in scenarios:
+  for monitors in (False, True):
+    latencies = scripted(monitors, 1, script)
+    print("  %-48s %-10s %s" % (name + ":" if not monitors else "", "monitoring" if monitors else "idle", stats(latencies)))
+print()
+
+print("long operations (duration, and volume change started 5 ms after the operation starts):")
+long_operations = [
+  ("DAP preset flush (mixer, biquad setup, coefficients)", lambda system, done: flush(system.dap, dap_preset_runs, done)),
+  ("HiFiDAC signal chain flush", lambda system, done: flush(system.dac, dac_setup_runs, done)),
+  ("EEPROM settings save, %d pages" % eeprom_save_pages, lambda system, done: eeprom_save(system, eeprom_save_pages, done)),
+]
+for name, operation in long_operations:
+  durations = scripted(False, 2, lambda system, start, record: system.sim.at(start, lambda: operation(system, record)))
+  volume = scripted(False, 2, script_during(operation, lambda system, done: volume_change(system, 0x80, done)))
+  print("  %-54s duration %s" % (name + ":", stats(durations)))
+  print("  %-54s volume   %s" % ("", stats(volume)))
@@ -0,0 +1,120 @@
+# Register maps for the system simulator, read directly from the firmware headers (i2c_defines_*.h, uart_defines_*.h, module_interface_i2c.h)
+# and the refresh group tables of the BlockBox module interfaces, so the simulation follows the real register layout and sizes.
+
+import os
+import re
+
+
+firmware_root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "firmware")
+
+_define_re = re.compile(r"^\s*#define\s+(\w+)[ \t]+([^\n]*?)\s*(?://.*)?$", re.MULTILINE)
+_ident_re = re.compile(r"\b[A-Za-z_]\w*\b")
+_int_suffix_re = re.compile(r"\b(0x[0-9A-Fa-f]+|\d+)[uUlL]+\b")
+
+
+class Defines:
+  def __init__(self):
+    self.raw = {}
+    self.cache = {}
+
+  def load(self, path):
+    with open(path) as f:
+      text = f.read()
+    #join continued lines, so multi-line defines (register size tables) are read as a whole
+    text = text.replace("\\\n", " ")
+    for name, value in _define_re.findall(text):
+      self.raw.setdefault(name, value)
+    return text
+
+  def value(self, expr):
+    #evaluate a C integer expression made of literals, operators and (recursively) other defines
+    expr = _int_suffix_re.sub(r"\1", expr.strip())
+    expr = expr.replace("/", "//")
+    def resolve(match):
+      name = match.group(0)
+      if name.startswith("0x"):
+        return name
+      return "(%d)" % self[name]
+    return eval(_ident_re.sub(resolve, expr), {"__builtins__": {}})
+
+  def __getitem__(self, name):
+    if name not in self.cache:
+      if name not in self.raw:
+        raise KeyError("undefined macro %s" % name)
+      self.cache[name] = self.value(self.raw[name])
+    return self.cache[name]
+
+  def table(self, name):
+    #brace-enclosed integer table, like the *_REG_SIZES definitions
+    body = self.raw[name].strip()
+    if not (body.startswith("{") and body.endswith("}")):
+      raise ValueError("%s is not a table" % name)
+    return [self.value(v) for v in body[1:-1].split(",") if v.strip()]
+
+
+class RegisterMap:
+  def __init__(self, name, defines, prefix, sizes):
+    self.name = name
+    self.defines = defines
+    self.prefix = prefix
+    self.sizes = sizes
+
+  def __getitem__(self, reg_name):
+    return self.defines[self.prefix + reg_name]
+
+  def size(self, reg):
+    return self.sizes[reg if isinstance(reg, int) else self[reg]]
+
+  def flag(self, flag_name):
+    #interrupt flag mask by short name, e.g. "INT_ACTIVE_INPUT"
+    return self.defines[self.prefix + "INT_FLAGS_" + flag_name + "_Msk"]
+
+  def registers(self):
+    return [reg for reg, size in enumerate(self.sizes) if size > 0]
+
+
+def _path(*parts):
+  return os.path.join(firmware_root, *parts)
+
+
+defines = Defines()
+defines.load(_path("BlockBoxController", "Core", "Inc", "cpp_main.h"))
+defines.load(_path("BlockBoxController", "ModuleInterface", "Inc", "module_interface_i2c.h"))
+defines.load(_path("BlockBoxController", "ModuleInterface", "Inc", "power_amp_interface.h"))
+defines.load(_path("BlockBoxController", "ModuleInterface", "Inc", "eeprom_interface.h"))
+
+_map_sources = {
+  "dap": ("DigitalAudioProcessor/Core/Inc/i2c_defines_dap.h", "I2CDEF_DAP_"),
+  "dac": ("HiFiDAC_Controller/Core/Inc/i2c_defines_hifidac.h", "I2CDEF_HIFIDAC_"),
+  "amp": ("PowerAmpController/Core/Inc/i2c_defines_poweramp.h", "I2CDEF_POWERAMP_"),
+  "chg": ("BlockBoxController/ModuleInterface/Inc/i2c_defines_charger.h", "I2CDEF_CHG_"),
+  "rtc": ("BlockBoxController/ModuleInterface/Inc/i2c_defines_rtc.h", "I2CDEF_RTC_"),
+  "bms": ("BatteryMonitor_Controller/Core/Inc/uart_defines_bms.h", "UARTDEF_BMS_"),
+  "btrx": ("BluetoothReceiver_Controller/Core/Inc/uart_defines_btrx.h", "UARTDEF_BTRX_"),
+}
+
+maps = {}
+for _key, (_file, _prefix) in _map_sources.items():
+  defines.load(_path(*_file.split("/")))
+  maps[_key] = RegisterMap(_key, defines, _prefix, defines.table(_prefix + "REG_SIZES"))
+
+
+_group_table_re = re.compile(r"static const IntRegI2CRefreshGroup (\w+)\[\] = \{(.*?)\n\};", re.DOTALL)
+_group_entry_re = re.compile(r"\{\s*([^{}]+?),\s*(\w+),\s*(\d+)\s*\}")
+
+def refresh_groups(source_file):
+  #parse the IntRegI2CRefreshGroup table of an interface source: list of (int_flags, reg_addr_first, reg_count)
+  with open(_path("BlockBoxController", "ModuleInterface", "Src", source_file)) as f:
+    text = f.read()
+  match = _group_table_re.search(text)
+  if match is None:
+    raise ValueError("no refresh group table in %s" % source_file)
+  body = re.sub(r"//[^\n]*", "", match.group(2))
+  return [(defines.value(flags) & 0xFFFF, defines[reg], int(count)) for flags, reg, count in _group_entry_re.findall(body)]
+
+
+if __name__ == "__main__":
+  for key, regmap in maps.items():
+    print("%-5s %3d registers, %5d data bytes" % (key, len(regmap.registers()), sum(regmap.sizes)))
+  for source in ("dap_interface.cpp", "hifidac_interface.cpp", "power_amp_interface.cpp"):
+    print(source, ["0x%04X -> 0x%02X x%d" % group for group in refresh_groups(source)])
@@ -0,0 +1,479 @@
+# Discrete-event model of the BlockBox controller's module communication: main loop, async transfer queues, I2C hardware interfaces with
+# registration-order priority, UART module links, and behavioural module stand-ins built on the real register maps (register_maps.py).
+# Timing follows the controller code: transfers start as soon as the bus is free (from the completion interrupt), while transfer callbacks,
+# interrupt flag handling and manager reactions run in the 10 ms main loop (ModuleInterface::LoopTasks).
+
+import collections
+import heapq
+import itertools
+
+from register_maps import defines, maps, refresh_groups
+
+
+loop_period = defines["MAIN_LOOP_PERIOD_MS"] / 1000
+int_handling_timeout = defines["MODIF_I2C_INT_HANDLING_TIMEOUT"]
+refresh_group_max_size = defines["MODIF_I2C_REFRESH_GROUP_MAX_SIZE"]
+
+# I2C kernel clock (PLL3 R output for I2C1/2/3/5, see the .ioc) and TIMINGR of I2C5 (main bus) and I2C3 (charger bus)
+i2c_kernel_clock = 8e6
+i2c_timing = 0x2000090E
+
+# UART baud rates (MX_UART4_Init, MX_USART1_UART_Init) and frame bytes
+uart_frame_bits = 10                  # 8N1
+uart_start_byte = defines["UARTDEF_BMS_START_BYTE"]
+uart_end_byte = defines["UARTDEF_BMS_END_BYTE"]
+uart_escape_byte = defines["UARTDEF_BMS_ESCAPE_BYTE"]
+
+# module-side processing time between receiving a UART command and starting the response (module main loop), in s (assumed)
+uart_module_response_time = 0.001
+
+
+def i2c_scl_frequency(timing, kernel_clock):
+  presc = (timing >> 28) & 0xF
+  sclh = (timing >> 8) & 0xFF
+  scll = timing & 0xFF
+  t_presc = (presc + 1) / kernel_clock
+  #SCL low and high periods, plus clock synchronisation (about 2 kernel clock cycles per edge) - rise/fall times neglected
+  return 1.0 / ((scll + 1 + sclh + 1) * t_presc + 4 / kernel_clock)
+
+i2c_bit_rate = i2c_scl_frequency(i2c_timing, i2c_kernel_clock)
+
+
+def i2c_transfer_bits(read, reg_addr_size, data_bytes):
+  #start, address byte, register address byte(s), (reads: repeated start + address byte), data incl. CRCs, stop, bus free time -
+  #every byte takes 9 bit times including the ACK
+  bits = 1 + 9 * (1 + reg_addr_size) + 9 * data_bytes + 1 + 1
+  if read:
+    bits += 1 + 9
+  return bits
+
+def uart_frame_bytes(payload, crc=True):
+  #start and end bytes, escaped payload, 16-bit CRC (escaping of CRC bytes neglected)
+  escapes = sum(1 for b in payload if b in (uart_start_byte, uart_end_byte, uart_escape_byte))
+  return 2 + len(payload) + escapes + (2 if crc else 0)
+
+
+class Sim:
+  def __init__(self):
+    self.t = 0.0
+    self.events = []
+    self.order = itertools.count()
+
+  def at(self, t, action):
+    heapq.heappush(self.events, (t, next(self.order), action))
+
+  def after(self, delay, action):
+    self.at(self.t + delay, action)
+
+  def run_until(self, t_end):
+    while self.events and self.events[0][0] <= t_end:
+      t, _, action = heapq.heappop(self.events)
+      self.t = max(self.t, t)
+      action()
+    self.t = max(self.t, t_end)
+
+
+class LinkStats:
+  def __init__(self, name):
+    self.name = name
+    self.reset(0.0)
+
+  def reset(self, t):
+    self.start = t
+    self.busy = 0.0
+    self.transfers = 0
+    self.bytes = 0
+
+  def add(self, duration, byte_count):
+    self.busy += duration
+    self.transfers += 1
+    self.bytes += byte_count
+
+
+# ----------------------------------------------------------------------------------------------------------------------------------------
+# controller side
+
+class Transfer:
+  def __init__(self, iface, read, reg, count, values, length, callback):
+    self.iface = iface
+    self.read = read
+    self.reg = reg
+    self.count = count          #number of registers (multi-register transfer if > 1)
+    self.values = values        #write: list of register values
+    self.length = length        #raw length in bytes for interfaces without register map (EEPROM)
+    self.callback = callback
+
+
+class Controller:
+  #main loop: interface LoopTasks in registration order, then manager tasks; a loop cycle may run late if the previous one was blocked
+  def __init__(self, sim):
+    self.sim = sim
+    self.interfaces = []
+    self.loop_tasks = []
+    self.cycle = 0
+    self.blocked = 0.0
+    sim.at(0.0, self.loop)
+
+  def block(self, duration):
+    #blocking delay inside the main loop (HAL_Delay)
+    self.blocked += duration
+
+  def loop(self):
+    for iface in self.interfaces:
+      iface.loop_tasks(self.cycle)
+    for task in self.loop_tasks:
+      task(self.cycle)
+    self.cycle += 1
+    next_start = self.cycle * loop_period
+    self.sim.at(max(next_start, self.sim.t + self.blocked), self.loop)
+    self.blocked = 0.0
+
+
+class ModuleInterface:
+  def __init__(self, controller, name, regmap):
+    self.controller = controller
+    self.sim = controller.sim
+    self.name = name
+    self.regmap = regmap
+    self.registers = {}                     #register cache (RegisterSet)
+    self.listeners = []                     #manager reactions to register updates, run in the main loop: fn(reg, value)
+    self.done = collections.deque()         #finished transfers, whose callbacks run in the next LoopTasks
+    self.queue = collections.deque()
+    controller.interfaces.append(self)
+
+  def loop_tasks(self, cycle):
+    #transfer completion callbacks, run in ModuleInterface::LoopTasks
+    for _ in range(len(self.done)):
+      transfer, result = self.done.popleft()
+      if transfer.read and transfer.count > 0:
+        for listener in self.listeners:
+          for i, value in enumerate(result):
+            listener(transfer.reg + i, value)
+      if transfer.callback:
+        transfer.callback(result)
+
+  def finish(self, transfer, result):
+    #data update in the register cache happens on completion (interrupt), the callback in the main loop
+    if transfer.count > 0:
+      if transfer.read:
+        for i, value in enumerate(result):
+          self.registers[transfer.reg + i] = value
+      else:
+        for i, value in enumerate(transfer.values):
+          self.registers[transfer.reg + i] = value
+    self.done.append((transfer, result))
+
+  def read(self, reg, count=1, callback=None):
+    self.enqueue(Transfer(self, True, reg, count, None, 0, callback))
+
+  def write(self, reg, values, callback=None):
+    if not isinstance(values, list):
+      values = [values]
+    self.enqueue(Transfer(self, False, reg, len(values), values, 0, callback))
+
+
+class I2CBus:
+  #I2CHardwareInterface: one transfer at a time, next one taken from the interfaces in registration order
+  def __init__(self, sim, name, bit_rate=i2c_bit_rate):
+    self.sim = sim
+    self.bit_rate = bit_rate
+    self.interfaces = []
+    self.active = None
+    self.stats = LinkStats(name)
+
+  def start_next(self):
+    if self.active is not None:
+      return
+    for iface in self.interfaces:
+      if iface.queue:
+        self.active = iface.queue.popleft()
+        break
+    else:
+      return
+
+    iface = self.active.iface
+    data_bytes = iface.transfer_data_bytes(self.active)
+    duration = i2c_transfer_bits(self.active.read, iface.reg_addr_size, data_bytes) / self.bit_rate
+    self.stats.add(duration, 1 + iface.reg_addr_size + data_bytes + (1 if self.active.read else 0))
+    self.sim.after(duration, self.complete)
+
+  def complete(self):
+    transfer = self.active
+    self.active = None
+    transfer.iface.finish(transfer, transfer.iface.module.access(transfer))
+    self.start_next()
+
+
+class I2CModuleInterface(ModuleInterface):
+  def __init__(self, controller, bus, name, regmap, module, use_crc=True, reg_addr_size=1):
+    super().__init__(controller, name, regmap)
+    self.bus = bus
+    self.module = module
+    self.use_crc = use_crc
+    self.reg_addr_size = reg_addr_size
+    module.iface = self
+    bus.interfaces.append(self)
+
+  def transfer_data_bytes(self, transfer):
+    if transfer.count == 0:
+      return transfer.length
+    sizes = [self.regmap.size(transfer.reg + i) for i in range(transfer.count)]
+    return sum(sizes) + (transfer.count if self.use_crc else 0)
+
+  def enqueue(self, transfer):
+    self.queue.append(transfer)
+    self.bus.start_next()
+
+  def read_raw(self, address, length, callback=None):
+    self.enqueue(Transfer(self, True, address, 0, None, length, callback))
+
+  def write_raw(self, address, length, callback=None):
+    self.enqueue(Transfer(self, False, address, 0, None, length, callback))
+
+
+class IntRegI2CModuleInterface(I2CModuleInterface):
+  #interrupt flag handling and refresh groups with watchdog (IntRegI2CModuleInterface)
+  def __init__(self, controller, bus, name, regmap, module, groups, watchdog_period, use_crc=True):
+    super().__init__(controller, bus, name, regmap, module, use_crc)
+    self.groups = groups
+    self.watchdog_period = watchdog_period
+    self.watchdog_timer = 0
+    self.interrupt_timer = 0
+    self.int_flags_reg = defines["MODIF_I2C_INT_FLAGS_REG"]
+
+  def exti(self):
+    #falling edge of the interrupt line (EXTI interrupt)
+    if self.interrupt_timer > 0:
+      return
+    self.interrupt_timer = int_handling_timeout
+    self.read(self.int_flags_reg, 1, self.handle_flags)
+
+  def handle_flags(self, result):
+    flags = result[0]
+    def cleared(_):
+      self.interrupt_timer = 0
+    self.write(self.int_flags_reg, (~flags) & ((1 << (8 * self.regmap.size(self.int_flags_reg))) - 1), cleared)
+    self.on_interrupt(flags)
+
+  def on_interrupt(self, flags):
+    if flags & defines["MODIF_I2C_INT_RESET_FLAG"]:
+      return
+    self.refresh_groups(flags)
+
+  def range_size(self, first, count):
+    return sum(self.regmap.size(first + i) for i in range(count))
+
+  def refresh_groups(self, flags):
+    run_first, run_count = 0, 0
+    for group in self.groups + [None]:
+      if group is not None and (group[0] & flags) == 0:
+        continue
+      if group is not None and run_count > 0 and group[1] == run_first + run_count and \
+          self.range_size(run_first, run_count + group[2]) <= refresh_group_max_size:
+        run_count += group[2]
+        continue
+      if run_count > 0:
+        self.read(run_first, run_count)
+      if group is not None:
+        run_first, run_count = group[1], group[2]
+
+  def loop_tasks(self, cycle):
+    if self.interrupt_timer > 0:
+      self.interrupt_timer -= 1
+    elif self.module.int_flags != 0:
+      #undetected interrupt condition (line still low)
+      self.exti()
+    super().loop_tasks(cycle)
+    self.watchdog_timer += 1
+    if self.watchdog_timer >= self.watchdog_period:
+      self.watchdog_timer = 0
+      self.refresh_groups(0xFFFF)
+
+
+class UARTLink:
+  #one UART: separate controller -> module (tx) and module -> controller (rx) lines
+  def __init__(self, sim, name, baud_rate):
+    self.sim = sim
+    self.baud_rate = baud_rate
+    self.free_at = { "tx": 0.0, "rx": 0.0 }
+    self.stats = LinkStats(name)
+
+  def send(self, direction, payload, deliver):
+    frame = uart_frame_bytes(payload)
+    duration = frame * uart_frame_bits / self.baud_rate
+    start = max(self.sim.t, self.free_at[direction])
+    self.free_at[direction] = start + duration
+    self.stats.add(duration, frame)
+    self.sim.at(start + duration, deliver)
+
+
+class UARTModuleInterface(ModuleInterface):
+  #one command outstanding at a time, answered by read data or a write acknowledgement; change notifications arrive at any time
+  def __init__(self, controller, link, name, regmap, module):
+    super().__init__(controller, name, regmap)
+    self.link = link
+    self.module = module
+    self.active = None
+    module.iface = self
+
+  def enqueue(self, transfer):
+    self.queue.append(transfer)
+    self.start_next()
+
+  def start_next(self):
+    if self.active is not None or not self.queue:
+      return
+    transfer = self.active = self.queue.popleft()
+    if transfer.read:
+      payload = [0x00, transfer.reg]
+    else:
+      payload = [0x01, transfer.reg] + self.module.encode(transfer.reg, transfer.values[0])
+    self.link.send("tx", payload, lambda: self.sim.after(uart_module_response_time, lambda: self.module.command(transfer)))
+
+  def response(self, transfer, result):
+    self.active = None
+    self.finish(transfer, result)
+    self.start_next()
+
+  def notification(self, reg, value):
+    #change notification: register cache and listeners updated like a read
+    self.finish(Transfer(self, True, reg, 1, None, 0, None), [value])
+
+
+# ----------------------------------------------------------------------------------------------------------------------------------------
+# module stand-ins
+
+class RegisterModule:
+  #generic register module: values by register address, interrupt flags register with active-low interrupt line
+  def __init__(self, sim, regmap):
+    self.sim = sim
+    self.regmap = regmap
+    self.values = { reg: 0 for reg in regmap.registers() } if regmap else {}
+    self.int_flags = 0
+    self.iface = None
+
+  def access(self, transfer):
+    if transfer.count == 0:
+      return []
+    regs = [transfer.reg + i for i in range(transfer.count)]
+    if transfer.read:
+      return [self.int_flags if reg == defines["MODIF_I2C_INT_FLAGS_REG"] else self.values.get(reg, 0) for reg in regs]
+    for reg, value in zip(regs, transfer.values):
+      self.write(reg, value)
+    return []
+
+  def write(self, reg, value):
+    if reg == defines["MODIF_I2C_INT_FLAGS_REG"]:
+      self.int_flags &= value
+    else:
+      self.values[reg] = value
+      self.on_write(reg, value)
+
+  def on_write(self, reg, value):
+    pass
+
+  def change(self, reg_name, value, flag_name):
+    #state change inside the module, signalled with the given interrupt flag
+    self.values[self.regmap[reg_name]] = value
+    self.raise_interrupt(self.regmap.flag(flag_name))
+
+  def raise_interrupt(self, flags):
+    previous = self.int_flags
+    self.int_flags |= flags
+    if previous == 0 and self.int_flags != 0 and isinstance(self.iface, IntRegI2CModuleInterface):
+      self.iface.exti()
+
+
+class DAPModule(RegisterModule):
+  #input switching takes effect after the module's own switch-over (SRC/input reconfiguration), then raises the active input interrupt
+  input_switch_time = 0.005           # in s (assumed)
+
+  def on_write(self, reg, value):
+    if reg == self.regmap["INPUT_ACTIVE"]:
+      self.values[reg] = 0
+      self.sim.after(self.input_switch_time, lambda: self.change("INPUT_ACTIVE", value, "INT_ACTIVE_INPUT"))
+
+
+class UARTModule:
+  #UART register module stand-in (battery monitor, Bluetooth receiver): answers commands, sends change notifications
+  def __init__(self, sim, regmap, link):
+    self.sim = sim
+    self.regmap = regmap
+    self.link = link
+    self.values = { reg: 0 for reg in regmap.registers() }
+    self.iface = None
+
+  def encode(self, reg, value):
+    size = self.regmap.size(reg)
+    return [(value >> (8 * i)) & 0xFF for i in range(size)]
+
+  def command(self, transfer):
+    if transfer.read:
+      value = self.values[transfer.reg]
+      payload = [0x02, transfer.reg] + self.encode(transfer.reg, value)
+      self.link.send("rx", payload, lambda: self.iface.response(transfer, [value]))
+    else:
+      self.values[transfer.reg] = transfer.values[0]
+      #write acknowledgement event
+      self.link.send("rx", [0x00, 0x01], lambda: self.iface.response(transfer, []))
+
+  def change(self, reg_name, value):
+    reg = self.regmap[reg_name]
+    self.values[reg] = value
+    self.link.send("rx", [0x01, reg] + self.encode(reg, value), lambda: self.iface.notification(reg, value))
+
+
+# ----------------------------------------------------------------------------------------------------------------------------------------
+# BlockBox v2 system (SystemBBV2): interfaces in the same order as in the system constructor
+
+class BlockBoxSystem:
+  def __init__(self, monitors=False):
+    self.sim = Sim()
+    sim = self.sim
+    self.controller = Controller(sim)
+    self.main_i2c = I2CBus(sim, "I2C5 (main)")
+    self.chg_i2c = I2CBus(sim, "I2C3 (charger)")
+    self.bms_uart = UARTLink(sim, "UART4 (BMS)", 57600)
+    self.btrx_uart = UARTLink(sim, "USART1 (BTRX)", 115200)
+
+    self.eeprom = I2CModuleInterface(self.controller, self.main_i2c, "eeprom", None, RegisterModule(sim, None), use_crc=False, reg_addr_size=2)
+    self.dap = IntRegI2CModuleInterface(self.controller, self.main_i2c, "dap", maps["dap"], DAPModule(sim, maps["dap"]),
+                                        refresh_groups("dap_interface.cpp"), defines["MODIF_I2C_REFRESH_WATCHDOG_PERIOD"])
+    self.dac = IntRegI2CModuleInterface(self.controller, self.main_i2c, "dac", maps["dac"], RegisterModule(sim, maps["dac"]),
+                                        refresh_groups("hifidac_interface.cpp"), defines["MODIF_I2C_REFRESH_WATCHDOG_PERIOD"])
+    self.amp = IntRegI2CModuleInterface(self.controller, self.main_i2c, "amp", maps["amp"], RegisterModule(sim, maps["amp"]),
+                                        refresh_groups("power_amp_interface.cpp"), defines["IF_POWERAMP_REFRESH_PERIOD"])
+    self.rtc = I2CModuleInterface(self.controller, self.main_i2c, "rtc", maps["rtc"], RegisterModule(sim, maps["rtc"]), use_crc=False)
+    self.chg = I2CModuleInterface(self.controller, self.chg_i2c, "chg", maps["chg"], RegisterModule(sim, maps["chg"]), use_crc=False)
+    self.btrx = UARTModuleInterface(self.controller, self.btrx_uart, "btrx", maps["btrx"], UARTModule(sim, maps["btrx"], self.btrx_uart))
+    self.bms = UARTModuleInterface(self.controller, self.bms_uart, "bms", maps["bms"], UARTModule(sim, maps["bms"], self.bms_uart))
+
+    self.monitors = monitors
+    self.controller.loop_tasks.append(self.periodic_reads)
+
+  def periodic_reads(self, cycle):
+    #periodic reads of the interface LoopTasks (refresh watchdogs are part of IntRegI2CModuleInterface above)
+    dap, amp = maps["dap"], maps["amp"]
+    if self.monitors:
+      if cycle % 50 == 0:
+        self.dap.read(dap["SRC_RATE_ERROR"], 2)
+      if cycle % 10 == 0:
+        self.dap.read(dap["OUTPUT_PEAKS"])
+      if cycle % 100 == 10:
+        self.amp.read(amp["MON_VRMS_FAST_A"], 32)
+      if cycle % 20 == 15:
+        self.amp.read(amp["SPK_TEMP_A"], 8)
+    if cycle % 100 == 0:
+      self.rtc.read(maps["rtc"]["STATUS_CTL"])
+      self.rtc.read(maps["rtc"]["SECONDS"], 7)
+      self.chg.read(maps["chg"]["CHG_OPTION"])
+    if cycle % 50 == 0:
+      self.bms.read(maps["bms"]["STATUS"])
+      self.btrx.read(maps["btrx"]["STATUS"])
+
+  def links(self):
+    return [self.main_i2c.stats, self.chg_i2c.stats, self.bms_uart.stats, self.btrx_uart.stats]
+
+  def reset_stats(self):
+    for stats in self.links():
+      stats.reset(self.sim.t)
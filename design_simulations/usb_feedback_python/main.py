@@ -0,0 +1,116 @@
+# Simulation of the DAP's USB asynchronous feedback loop (usbd_audio.c SOF handler) together with the SRC buffer.
+# The host sends samples at the rate given by the feedback value, the SAI output consumes them at its own clock rate,
+# and the feedback is derived from the measured output clock plus a slow correction of the averaged SRC buffer fill error.
+# Shows whether the fill level stays within the fixed-ratio limits (so the adaptive resampler can be bypassed).
+
+import matplotlib.pyplot as plt
+
+
+sim_time_ms = 300000
+host_rate = 44100         # host sample rate
+out_rate_nominal = 96000  # SAI output / SRC buffer rate
+out_clock_ppm = 35.0      # output clock error relative to the host's SOF clock
+host_fb_refresh_ms = 4    # host reads the feedback every 2^SOF_RATE ms
+
+# firmware parameters (usbd_audio.c, sample_rate_conv.h)
+meas_window_sofs = 1024
+meas_filter_shift = 2
+fill_correction_time_ms = 32768.0
+lock_max_fill_error = 24.0
+unlock_min_fill_error = 96.0
+fill_error_avg_batches = 8192
+fixed_ratio_max_fill_error = 192
+
+fb_one = 1 << 22  # 10.22 format: samples per ms
+
+out_frames_per_ms = out_rate_nominal / 1000.0 * (1.0 + out_clock_ppm * 1e-6)
+
+# state
+buffer_fill_error = 0.0       # instantaneous, in output-rate samples
+out_phase = 0.0               # fractional output frames not yet counted by the DMA position
+host_phase = 0.0              # fractional host samples not yet sent
+fill_history = [0.0] * fill_error_avg_batches
+fill_sum = 0.0
+fill_pos = 0
+batch_phase = 0.0
+meas_frames = 0
+meas_sofs = 0
+meas_out_rate = 0
+meas_valid = False
+fb_nom = (host_rate << 22) // 1000
+fb_value = fb_nom
+fb_host = fb_nom
+locked = False
+
+t_log, fill_log, fill_avg_log, fb_log, lock_log = [], [], [], [], []
+max_abs_fill_locked = 0.0
+
+for t in range(sim_time_ms):
+  # output clock: count whole frames consumed during this ms (what the DMA position difference shows)
+  out_phase += out_frames_per_ms
+  frames = int(out_phase)
+  out_phase -= frames
+  meas_frames += frames
+  meas_sofs += 1
+  if meas_sofs >= meas_window_sofs:
+    rate = (meas_frames << 22) // meas_window_sofs
+    if meas_valid:
+      meas_out_rate += (rate - meas_out_rate) >> meas_filter_shift
+    else:
+      meas_out_rate = rate
+      meas_valid = True
+    meas_frames = 0
+    meas_sofs = 0
+
+  # host sends samples according to the last feedback it read, converted to output-rate samples by the fixed-ratio SRC stages
+  host_phase += fb_host / fb_one
+  sent = int(host_phase)
+  host_phase -= sent
+  buffer_fill_error += sent * out_rate_nominal / host_rate - frames
+
+  # SRC output batches (96 frames each) update the averaged fill error
+  batch_phase += frames / 96.0
+  while batch_phase >= 1.0:
+    batch_phase -= 1.0
+    fill_sum += buffer_fill_error - fill_history[fill_pos]
+    fill_history[fill_pos] = buffer_fill_error
+    fill_pos = (fill_pos + 1) % fill_error_avg_batches
+  fill_avg = fill_sum / fill_error_avg_batches
+
+  # feedback calculation (SOF handler)
+  if meas_valid:
+    fb_new = (meas_out_rate * host_rate) // out_rate_nominal
+    fb_new -= int(fill_avg * (host_rate * fb_one / (out_rate_nominal * fill_correction_time_ms)))
+    fb_value = max(fb_nom - fb_one, min(fb_nom + fb_one, fb_new))
+    if locked:
+      locked = abs(fill_avg) < unlock_min_fill_error
+    else:
+      locked = abs(fill_avg) < lock_max_fill_error
+  if t % host_fb_refresh_ms == 0:
+    fb_host = fb_value
+
+  if locked:
+    max_abs_fill_locked = max(max_abs_fill_locked, abs(buffer_fill_error))
+
+  if t % 100 == 0:
+    t_log.append(t / 1000.0)
+    fill_log.append(buffer_fill_error)
+    fill_avg_log.append(fill_avg)
+    fb_log.append((fb_value / fb_one) * 1000.0 - host_rate)
+    lock_log.append(1 if locked else 0)
+
+print(f"Max instantaneous fill error while locked: {max_abs_fill_locked:.1f} samples (fixed-ratio limit {fixed_ratio_max_fill_error})")
+print(f"Final fill error: {buffer_fill_error:.1f} samples, averaged {fill_avg:.1f}")
+print(f"Final feedback: {fb_value / fb_one * 1000.0:.4f} Hz (ideal {host_rate * (1.0 + out_clock_ppm * 1e-6):.4f} Hz)")
+
+fig, axs = plt.subplots(3, 1, sharex=True)
+axs[0].plot(t_log, fill_log, label="instantaneous")
+axs[0].plot(t_log, fill_avg_log, label="averaged")
+axs[0].set_ylabel("Fill error [samples]")
+axs[0].legend()
+axs[1].plot(t_log, fb_log)
+axs[1].set_ylabel("Feedback - nominal [Hz]")
+axs[2].plot(t_log, lock_log)
+axs[2].set_ylabel("Locked")
+axs[2].set_xlabel("Time [s]")
+plt.show()
@@ -20,6 +20,10 @@ extern const float bat_calc_cellEnergy_max;
 extern const float bat_calc_voltageToCharge_max_valid_current;
 //maximum per-cell current in A for which the voltage-to-energy approximation is valid
 extern const float bat_calc_voltageToEnergy_max_valid_current;
+//per-cell current in A at which the voltage curves were recorded (negative = discharging)
+extern const float bat_calc_voltageCurves_current;
+//approximate per-cell internal resistance in ohms (including interconnects), for current compensation of OCV estimations
+extern const float bat_calc_cellResistance;
 
 
 //Estimate energy of a single cell in Wh, given its charge in Ah and the battery health fraction
@@ -31,5 +35,9 @@ float BAT_CALC_CellVoltageToCharge(float cell_voltage_v, float battery_health);
 //Approximately estimate energy of a single cell in Wh, given its voltage in V and the battery health fraction - valid up to bat_calc_voltageToEnergy_max_valid_current
 float BAT_CALC_CellVoltageToEnergy(float cell_voltage_v, float battery_health);
 
+//Estimate the open-circuit voltage (as recorded at bat_calc_voltageCurves_current) of a single cell in V, given its charge in Ah and the battery health fraction
+//Also returns the OCV slope (derivative with respect to charge) in V/Ah in slope, if non-null
+float BAT_CALC_CellChargeToOCV(float cell_charge_ah, float battery_health, float* slope);
+
 
 #endif /* INC_BAT_CALCULATIONS_H_ */
@@ -56,6 +56,10 @@
 #define BMS_LOOP_PERIOD_STATUS (100 / MAIN_LOOP_PERIOD_MS)
 //period of measurement updates, in main loop cycles
 #define BMS_LOOP_PERIOD_MEASUREMENTS (1000 / MAIN_LOOP_PERIOD_MS)
+//measurement block read: consecutive direct command registers from cell 1 voltage up to stack voltage, or up to the TS measurement when including temperatures (gap 0x1E-0x21 is read as padding)
+#define BMS_MEAS_BLOCK_OFFSET(cmd) ((cmd) - DIRCMD_CELL1_VOLTAGE)
+#define BMS_MEAS_BLOCK_LENGTH (BMS_MEAS_BLOCK_OFFSET(DIRCMD_STACK_VOLTAGE) + 2)
+#define BMS_MEAS_BLOCK_LENGTH_TEMPS (BMS_MEAS_BLOCK_OFFSET(DIRCMD_TS_MEASUREMENT) + 2)
 //period of temperature measurement updates, in main loop cycles - must be a multiple of BMS_LOOP_PERIOD_MEASUREMENTS!
 #define BMS_LOOP_PERIOD_TEMPERATURES (2 * BMS_LOOP_PERIOD_MEASUREMENTS)
 
@@ -65,13 +69,24 @@
 #define BMS_SOC_CELL_VOLTAGE_MAX 4.25f
 //voltage above which a cell is considered "fully charged"
 #define BMS_SOC_CELL_FULL_CHARGE_VOLTAGE_MIN 4.15f
-//cell current and voltage smoothing parameter - approx 30s time constant, given measurements once per second
+//cell current smoothing parameter for full charge detection - approx 30s time constant, given measurements once per second
 #define BMS_SOC_SMOOTHING_ALPHA 0.03f
 #define BMS_SOC_SMOOTHING_1MALPHA (1.0f - BMS_SOC_SMOOTHING_ALPHA)
-//current initialisation factor for start delay before allowing reference point setting - 1.4 with alpha 0.03 results in approx. 10 measurement cycles of delay
+//current initialisation factor for start delay before allowing full charge detection - 1.4 with alpha 0.03 results in approx. 10 measurement cycles of delay
 #define BMS_SOC_CURRENT_INIT_FACTOR 1.4f
-//maximum allowable difference between tracked charge and estimated charge, in Ah
-#define BMS_SOC_CHARGE_DIFFERENCE_MAX 0.15f
+//Kalman filter parameters (see design_simulations/battery_calculations/soc_kalman_sim.py)
+//initial charge standard deviation in Ah, when initialising from voltage
+#define BMS_SOC_KF_INIT_STDDEV 0.3f
+//charge counter uncertainty: relative gain error, and absolute error per update in Ah (offset, self-discharge)
+#define BMS_SOC_KF_COUNTER_GAIN_ERROR 0.01f
+#define BMS_SOC_KF_COUNTER_OFFSET 0.0002f
+//cell voltage uncertainty in V: base value, and additional value per A of cell current (resistance mismatch, polarisation - voltage mostly ignored under load)
+#define BMS_SOC_KF_VOLTAGE_STDDEV 0.01f
+#define BMS_SOC_KF_VOLTAGE_STDDEV_PER_AMP 1.0f
+//charge standard deviation in Ah at/below which the estimate is considered precise (SOC_CHARGE_ESTIMATED)
+#define BMS_SOC_KF_CONVERGED_STDDEV 0.1f
+//charge standard deviation in Ah after a full charge has been detected
+#define BMS_SOC_KF_FULL_STDDEV 0.02f
 
 //cell balancing configuration
 //minimum voltage difference between two cells to be considered "unbalanced", in mV
@@ -237,7 +252,7 @@ void BMS_ResetTimedShutdownState();
 //get whether the BMS is trying to be in deepsleep
 bool BMS_GetDeepSleepDesiredState();
 
-//interrupt handler for BMS alert pin falling edge
+//interrupt handler for BMS alert pin falling edge - only marks the alert as pending, it's handled in the next loop update
 void BMS_AlertInterrupt();
 
 //standard initialisation and loop update functions
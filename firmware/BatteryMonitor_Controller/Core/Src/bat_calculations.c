@@ -8,6 +8,7 @@
 
 #include "bat_calculations.h"
 #include <math.h>
+#include <stddef.h>
 
 
 /********************************************************/
@@ -19,33 +20,42 @@ static const float bat_chargeToEnergy_coeffs[3] = { -0.02124167f, 3.2197858f, 0.
 //correction coefficients for charge-to-energy approximation, depending on battery health fraction (linear, quadratic)
 static const float bat_chargeToEnergy_healthCorrectionCoeffs[2] = { 0.3f, 0.1f };
 
-//B-spline knots, knot count, control points, and degree for voltage-to-charge estimation
-static const float bat_voltageToCharge_t[] = {
-    3.0f, 3.0f, 3.0f, 3.0f, 3.15f, 3.29f, 3.33f, 3.37f, 3.44f, 3.51f,
-    3.58f, 3.66f, 3.73f, 3.87f, 3.94f, 4.01f, 4.15f, 4.15f, 4.15f, 4.15f
+//evenly spaced lookup tables for voltage-to-charge and voltage-to-energy estimation, at 100% health (generated by design_simulations/battery_calculations/ocv_lut.py)
+#define BAT_VOLTAGE_TABLE_MIN 3.0f
+#define BAT_VOLTAGE_TABLE_STEP_INV 40.0f //inverse of 25mV step
+#define BAT_VOLTAGE_TABLE_COUNT 47
+static const float bat_voltageToCharge_table[BAT_VOLTAGE_TABLE_COUNT] = {
+    0.000000f, 0.006165f, 0.012060f, 0.015906f, 0.019483f, 0.024567f, 0.032937f, 0.046296f,
+    0.066042f, 0.093501f, 0.129997f, 0.176855f, 0.235131f, 0.295457f, 0.339050f, 0.376692f,
+    0.425520f, 0.486401f, 0.558070f, 0.642111f, 0.743812f, 0.867968f, 1.008216f, 1.149611f,
+    1.278306f, 1.390185f, 1.485497f, 1.564780f, 1.632597f, 1.696605f, 1.763827f, 1.835995f,
+    1.912467f, 1.992594f, 2.075723f, 2.161196f, 2.246875f, 2.327315f, 2.396795f, 2.456108f,
+    2.514513f, 2.581187f, 2.655602f, 2.729759f, 2.795468f, 2.844538f, 2.868777f
 };
-static const uint8_t bat_voltageToCharge_t_count = 20;
-static const float bat_voltageToCharge_c[] = {
-    -0.00355509f, 0.02089707f, 0.00316649f, 0.1122161f, 0.31671303f, 0.37414911f,
-    0.51521049f, 0.7574718f, 1.21999862f, 1.53247019f, 1.75656568f, 2.0588198f,
-    2.38977397f, 2.56745534f, 2.85180031f, 2.86877747f
+static const float bat_voltageToEnergy_table[BAT_VOLTAGE_TABLE_COUNT] = {
+    0.000000f, 0.008239f, 0.021101f, 0.036514f, 0.055280f, 0.078203f, 0.106084f, 0.140885f,
+    0.189204f, 0.258844f, 0.367058f, 0.546580f, 0.750466f, 0.921599f, 1.071908f, 1.218048f,
+    1.376673f, 1.564438f, 1.797948f, 2.091870f, 2.458353f, 2.906789f, 3.407836f, 3.902333f,
+    4.338671f, 4.726655f, 5.086692f, 5.402922f, 5.675915f, 5.922833f, 6.161388f, 6.410200f,
+    6.688295f, 7.007515f, 7.350944f, 7.694503f, 8.019164f, 8.317175f, 8.582681f, 8.824412f,
+    9.070045f, 9.346255f, 9.645802f, 9.935333f, 10.183349f, 10.377041f, 10.522272f
 };
-static const uint8_t bat_voltageToCharge_p = 3;
 
-//B-spline knots, knot count, control points, and degree for voltage-to-energy estimation
-static const float bat_voltageToEnergy_t[] = {
-    3.0f, 3.0f, 3.0f, 3.0f, 3.15f, 3.22f, 3.26f, 3.29f, 3.44f, 3.51f, 3.58f, 3.62f,
-    3.66f, 3.73f, 3.8f, 3.87f, 3.94f, 4.01f, 4.08f, 4.12f, 4.15f, 4.15f, 4.15f, 4.15f
+//evenly spaced lookup table for charge-to-OCV estimation (0 to max charge), with per-interval slope in V/Ah, at 100% health (generated by ocv_lut.py)
+#define BAT_CHARGE_TABLE_COUNT 33
+static const float bat_chargeToOCV_table[BAT_CHARGE_TABLE_COUNT] = {
+    3.007705f, 3.222047f, 3.276312f, 3.313738f, 3.363958f, 3.410235f, 3.443650f, 3.471299f,
+    3.494234f, 3.513559f, 3.530531f, 3.546460f, 3.562154f, 3.578301f, 3.595700f, 3.614944f,
+    3.636743f, 3.662433f, 3.693873f, 3.728781f, 3.761431f, 3.791513f, 3.819867f, 3.847023f,
+    3.873350f, 3.899536f, 3.927594f, 3.961550f, 4.000097f, 4.033011f, 4.062886f, 4.095320f,
+    4.150000f
 };
-static const uint8_t bat_voltageToEnergy_t_count = 24;
-static const float bat_voltageToEnergy_c[] = {
-    -2.87436676e-03f, 1.81383671e-02f, 5.72841288e-02f, 1.91419519e-01f,
-    3.76504645e-01f, 1.05089374e+00f, 1.28755469e+00f, 2.51121639e+00f,
-    3.87105895e+00f, 4.65901708e+00f, 5.38827784e+00f, 5.97712740e+00f,
-    6.62516653e+00f, 7.65197748e+00f, 8.52844471e+00f, 9.11782949e+00f,
-    9.92152850e+00f, 1.03378326e+01f, 1.04702242e+01f, 1.05222716e+01f
+static const float bat_chargeToOCV_slope_table[BAT_CHARGE_TABLE_COUNT - 1] = {
+    2.386549f, 0.604202f, 0.416713f, 0.559164f, 0.515259f, 0.372062f, 0.307844f, 0.255372f,
+    0.215171f, 0.188974f, 0.177356f, 0.174736f, 0.179791f, 0.193728f, 0.214260f, 0.242717f,
+    0.286040f, 0.350063f, 0.388681f, 0.363537f, 0.334934f, 0.315705f, 0.302366f, 0.293134f,
+    0.291557f, 0.312410f, 0.378083f, 0.429184f, 0.366482f, 0.332636f, 0.361133f, 0.608819f
 };
-static const uint8_t bat_voltageToEnergy_p = 3;
 
 //maximum charge per cell in Ah at 100% health 100% charge
 const float bat_calc_cellCharge_max = 2.874f;
@@ -55,45 +65,26 @@ const float bat_calc_cellEnergy_max = 10.52f;
 const float bat_calc_voltageToCharge_max_valid_current = 0.2f;
 //maximum per-cell current in A for which the voltage-to-energy approximation is valid
 const float bat_calc_voltageToEnergy_max_valid_current = 0.2f;
+//per-cell current in A at which the voltage curves were recorded (negative = discharging)
+const float bat_calc_voltageCurves_current = -0.2f;
+//approximate per-cell internal resistance in ohms (including interconnects), for current compensation of OCV estimations
+const float bat_calc_cellResistance = 0.05f;
 
 
 /***************/
 /*  FUNCTIONS  */
 /***************/
 
-//De Boor's algorithm to calculate value of B-spline with t_count knots given in t, control points given in c, and degree p, at position x
-//see also https://en.wikipedia.org/wiki/De_Boor%27s_algorithm
-static float _BAT_CALC_DeBoor(float x, const float* t, uint8_t t_count, const float* c, uint8_t p) {
-  float d[p + 1];
-  int i, j;
-  uint8_t k; //index of knot interval that contains x
-
-  if (x <= t[0]) { //at or before range start: clip to range start
-    x = t[0];
-    k = p; //first "real" knot interval that's not in padding
-  } else if (x >= t[t_count - 1]) { //at or after range end: clip to range end
-    x = t[t_count - 1];
-    k = t_count - p - 2; //last "real" knot interval that's not in padding
-  } else { //within range: keep x unchanged, find knot interval index k that contains x
-    for (k = p; k < t_count - p - 2; k++) {
-      if (x <= t[k + 1]) break;
-    }
-  }
-
-  //initialise intermediates
-  for (i = 0; i <= p; i++) d[i] = c[i + k - p];
+//linear interpolation in the given evenly spaced table with count entries, starting at x_min, with inverse step size x_step_inv - clipped to table range
+static float _BAT_CALC_TableLookup(float x, const float* table, uint8_t count, float x_min, float x_step_inv) {
+  float pos = (x - x_min) * x_step_inv;
 
-  //main algorithm loop - see wikipedia or other article for explanation
-  for (i = 1; i <= p; i++) {
-    for (j = p; j >= i; j--) {
-      float alpha = (x - t[j + k - p]) / (t[j + 1 + k - i] - t[j + k - p]);
-      d[j] = (1.0f - alpha) * d[j - 1] + alpha * d[j];
-    }
-  }
+  if (isnanf(pos) || pos <= 0.0f) return table[0];
+  if (pos >= (float)(count - 1)) return table[count - 1];
 
-  //return result, clipped to positive numbers
-  if (d[p] < 0.0f) return 0.0f;
-  else return d[p];
+  uint8_t i = (uint8_t)pos;
+  float frac = pos - (float)i;
+  return table[i] + frac * (table[i + 1] - table[i]);
 }
 
 
@@ -125,8 +116,8 @@ float BAT_CALC_CellVoltageToCharge(float cell_voltage_v, float battery_health) {
   if (isnanf(battery_health) || battery_health <= 0.0f) return 0.0f;
   else if (battery_health > 1.0f) battery_health = 1.0f;
 
-  //calculate and return B-spline approximation, scaled by battery health
-  return battery_health * _BAT_CALC_DeBoor(cell_voltage_v, bat_voltageToCharge_t, bat_voltageToCharge_t_count, bat_voltageToCharge_c, bat_voltageToCharge_p);
+  //calculate and return table approximation, scaled by battery health
+  return battery_health * _BAT_CALC_TableLookup(cell_voltage_v, bat_voltageToCharge_table, BAT_VOLTAGE_TABLE_COUNT, BAT_VOLTAGE_TABLE_MIN, BAT_VOLTAGE_TABLE_STEP_INV);
 }
 
 //Approximately estimate energy of a single cell in Wh, given its voltage in V and the battery health fraction - valid up to bat_calc_voltageToEnergy_max_valid_current
@@ -135,6 +126,36 @@ float BAT_CALC_CellVoltageToEnergy(float cell_voltage_v, float battery_health) {
   if (isnanf(battery_health) || battery_health <= 0.0f) return 0.0f;
   else if (battery_health > 1.0f) battery_health = 1.0f;
 
-  //calculate and return B-spline approximation, scaled by battery health
-  return battery_health * _BAT_CALC_DeBoor(cell_voltage_v, bat_voltageToEnergy_t, bat_voltageToEnergy_t_count, bat_voltageToEnergy_c, bat_voltageToEnergy_p);
+  //calculate and return table approximation, scaled by battery health
+  return battery_health * _BAT_CALC_TableLookup(cell_voltage_v, bat_voltageToEnergy_table, BAT_VOLTAGE_TABLE_COUNT, BAT_VOLTAGE_TABLE_MIN, BAT_VOLTAGE_TABLE_STEP_INV);
+}
+
+//Estimate the open-circuit voltage (as recorded at bat_calc_voltageCurves_current) of a single cell in V, given its charge in Ah and the battery health fraction
+//Also returns the OCV slope (derivative with respect to charge) in V/Ah in slope, if non-null
+float BAT_CALC_CellChargeToOCV(float cell_charge_ah, float battery_health, float* slope) {
+  //clamp battery health between 0.1 and 1 (lower health is not useful here)
+  if (isnanf(battery_health) || battery_health < 0.1f) battery_health = 0.1f;
+  else if (battery_health > 1.0f) battery_health = 1.0f;
+
+  //scale charge to 100% health table, find interval
+  float charge_step = bat_calc_cellCharge_max / (float)(BAT_CHARGE_TABLE_COUNT - 1);
+  float pos = cell_charge_ah / (battery_health * charge_step);
+  uint8_t i;
+  if (isnanf(pos) || pos <= 0.0f) {
+    i = 0;
+    pos = 0.0f;
+  } else if (pos >= (float)(BAT_CHARGE_TABLE_COUNT - 1)) {
+    i = BAT_CHARGE_TABLE_COUNT - 2;
+    pos = (float)(BAT_CHARGE_TABLE_COUNT - 1);
+  } else {
+    i = (uint8_t)pos;
+  }
+
+  //slope of the interval, scaled back to actual health
+  if (slope != NULL) {
+    *slope = bat_chargeToOCV_slope_table[i] / battery_health;
+  }
+
+  //linear interpolation within the interval
+  return bat_chargeToOCV_table[i] + (pos - (float)i) * (bat_chargeToOCV_table[i + 1] - bat_chargeToOCV_table[i]);
 }
@@ -23,6 +23,8 @@ bool bms_should_deepsleep = false;
 //true should_deepsleep state after internal logic
 static bool _bms_should_deepsleep_internal = false;
 
+//set by the alert pin interrupt, alert is handled from the main loop (I2C transfers can't be waited for in interrupt context)
+static volatile bool _bms_alert_pending = false;
 //set to true when an init-complete alert is detected
 static bool _bms_detected_initcomp = false;
 //set to true when a shutdown voltage fault is detected (cell or stack voltage below shutdown threshold)
@@ -35,22 +37,51 @@ static bool _bms_timed_shutdown_triggered = false;
 //whether the host has requested a shutdown (to see whether to cancel end-of-discharge shutdown or not)
 static bool _bms_shutdown_requested_by_host = false;
 
-//charge reference point in Ah (actual charge of a single cell when BMS charge register is zero), for SOC_CHARGE_ESTIMATED and SOC_CHARGE_FULL modes
-static float _bms_soc_charge_reference = 0.0f;
+//state-of-charge Kalman filter state: estimated charge of the weakest cell in Ah (NaN = uninitialised), and its variance in Ah^2
+static float _bms_soc_charge = NAN;
+static float _bms_soc_charge_variance = 0.0f;
+//BMS charge register value at the last filter update, in mAs
+static int64_t _bms_soc_prev_accumulated_charge = 0;
 
 //bit mask of which cells are currently balancing
 static uint8_t _bms_bal_active_cells = 0;
 
 
+//read and clear alarm status, flag detected events
+static void _BMS_HandleAlert() {
+  _bms_alert_pending = false;
+
+  uint16_t alarm_status;
+  if (BMS_I2C_DirectCommandRead(DIRCMD_ALARM_STATUS, (uint8_t*)&alarm_status, 2, BMS_COMM_MAX_TRIES) != HAL_OK) return;
+
+  //INITCOMP bit (init complete after powerup, deepsleep exit, or cfgupdate exit)
+  if ((alarm_status & 0x0004) != 0) {
+    _bms_detected_initcomp = true;
+  }
+
+  //SHUTV bit (shutdown voltage threshold crossed (cell or stack)
+  if ((alarm_status & 0x0200) != 0) {
+    _bms_detected_shutdown_voltage = true;
+  }
+
+  //safety status or alert bits
+  if ((alarm_status & 0xF000) != 0) {
+    _bms_detected_safety_event = true;
+  }
+
+  //clear alarm flags
+  BMS_I2C_DirectCommandWrite(DIRCMD_ALARM_STATUS, (uint8_t*)&alarm_status, 2, BMS_COMM_MAX_TRIES);
+}
+
 //wait for init-complete alert to occur, up to configured maximum wait time
 static void _BMS_WaitForInitComp() {
   if (_bms_detected_initcomp) return;
 
   int i;
   for (i = 0; i < BMS_INITCOMP_WAIT_MAX; i++) {
-    //re-run alert check if alert pin is low
-    if (HAL_GPIO_ReadPin(BMS_ALERT_N_GPIO_Port, BMS_ALERT_N_Pin) == GPIO_PIN_RESET) {
-      BMS_AlertInterrupt();
+    //run alert check if pending or alert pin is low
+    if (_bms_alert_pending || HAL_GPIO_ReadPin(BMS_ALERT_N_GPIO_Port, BMS_ALERT_N_Pin) == GPIO_PIN_RESET) {
+      _BMS_HandleAlert();
     }
 
     if (_bms_detected_initcomp) return;
@@ -128,8 +159,8 @@ static int16_t _BMS_GetThermistorTemp(int16_t adc_value) {
 
 //enter CFGUPDATE mode
 static HAL_StatusTypeDef _BMS_EnterCFGUPDATE() {
-  //reset state-of-charge calculation to voltage-only mode, due to CFGUPDATE resetting integrated charge
-  bms_measurements.soc_precisionlevel = SOC_VOLTAGE_ONLY;
+  //CFGUPDATE resets the integrated charge: rebase state-of-charge charge tracking
+  _bms_soc_prev_accumulated_charge = 0;
 
   //disable all cell balancing
   _bms_bal_active_cells = 0;
@@ -158,8 +189,8 @@ static HAL_StatusTypeDef _BMS_EnterCFGUPDATE() {
 
 //exit CFGUPDATE mode
 static HAL_StatusTypeDef _BMS_ExitCFGUPDATE() {
-  //reset state-of-charge calculation to voltage-only mode, due to CFGUPDATE resetting integrated charge
-  bms_measurements.soc_precisionlevel = SOC_VOLTAGE_ONLY;
+  //CFGUPDATE resets the integrated charge: rebase state-of-charge charge tracking
+  _bms_soc_prev_accumulated_charge = 0;
 
   //send actual command
   _bms_detected_initcomp = false;
@@ -292,136 +323,116 @@ static HAL_StatusTypeDef _BMS_CheckAndApplyConfig() {
 }
 
 //state-of-charge calculation update - TODO: automatic battery health detection? here or separately?
+//single-state extended Kalman filter on the weakest cell's charge: predicted using the BMS charge counter, corrected using the current-compensated cell voltage
 static void _BMS_UpdateSoC() {
-  //smoothed current (in A) and cell voltage (in V) values - initially NaN meaning "uninitialised"
+  //smoothed current (in A) for full charge detection - initially NaN meaning "uninitialised"
   static float current_smoothed = NAN;
-  static float voltages_smoothed[BMS_CELLS_SERIES];
 
   int i;
   float min_voltage;
-  float charge;
   float cell_energy;
 
   //convert integer measurements to floats in corresponding units
+  bool current_valid = (bms_measurements.current != BMS_ERROR_CURRENT);
   float current = (float)bms_measurements.current / 1000.0f / (float)BMS_CELLS_PARALLEL; //mA total -> A per cell
-  float voltages[BMS_CELLS_SERIES];
-  for (i = 0; i < BMS_CELLS_SERIES; i++) voltages[i] = (float)bms_measurements.voltage_cells[i] / 1000.0f; //mV -> V
-  float charge_delta = (float)bms_measurements.accumulated_charge / 3600000.0f / (float)BMS_CELLS_PARALLEL; //mAs total -> Ah per cell
+  bool voltages_valid = true;
+  min_voltage = INFINITY;
+  for (i = 0; i < BMS_CELLS_SERIES; i++) {
+    if (bms_measurements.voltage_cells[i] <= 0) voltages_valid = false;
+    float voltage = (float)bms_measurements.voltage_cells[i] / 1000.0f; //mV -> V
+    if (voltage < min_voltage) min_voltage = voltage;
+  }
+  //weakest cell voltage is only usable if within the acceptable range
+  bool voltage_usable = current_valid && voltages_valid && min_voltage >= BMS_SOC_CELL_VOLTAGE_MIN && min_voltage <= BMS_SOC_CELL_VOLTAGE_MAX;
 
-  //calculate smoothed current and cell voltages
+  //calculate smoothed current
   if (isnanf(current_smoothed)) {
     //initialise from first measurement, if valid
-    if (bms_measurements.current != BMS_ERROR_CURRENT && bms_measurements.voltage_cells[0] > 0 && bms_measurements.voltage_cells[1] > 0 &&
-        bms_measurements.voltage_cells[2] > 0 && bms_measurements.voltage_cells[3] > 0 && bms_measurements.voltage_cells[4] > 0) {
-      //current initially set to "too much" for reference point setting, to ensure some settling time at the start
+    if (current_valid) {
+      //current initially set to "too much" for full charge detection, to ensure some settling time at the start
       current_smoothed = (bms_measurements.current > 0 ? 1.0f : -1.0f) * bat_calc_voltageToCharge_max_valid_current * BMS_SOC_CURRENT_INIT_FACTOR;
-      //cell voltages initialised correctly
-      for (i = 0; i < BMS_CELLS_SERIES; i++) voltages_smoothed[i] = voltages[i];
     }
-  } else {
+  } else if (current_valid) {
     //apply exponential smoothing
     current_smoothed = BMS_SOC_SMOOTHING_ALPHA * current + BMS_SOC_SMOOTHING_1MALPHA * current_smoothed;
-    for (i = 0; i < BMS_CELLS_SERIES; i++) {
-      voltages_smoothed[i] = BMS_SOC_SMOOTHING_ALPHA * voltages[i] + BMS_SOC_SMOOTHING_1MALPHA * voltages_smoothed[i];
-    }
   }
 
   //if battery health is invalid or unreasonably bad (<10%), reset to default 100% health
   if (isnanf(*bms_soc_battery_health_ptr) || *bms_soc_battery_health_ptr < 0.1f || *bms_soc_battery_health_ptr > 1.0f) {
     BMS_SetBatteryHealth(1.0f);
   }
-
-  //run voltage-based charge estimation if smoothed current is small enough
-  float estimated_charge = NAN;
-  if (fabsf(current_smoothed) <= bat_calc_voltageToCharge_max_valid_current) {
-    //determine lowest smoothed cell voltage
-    min_voltage = voltages_smoothed[0];
-    for (i = 1; i < BMS_CELLS_SERIES; i++) {
-      if (voltages_smoothed[i] < min_voltage) min_voltage = voltages_smoothed[i];
+  float health = *bms_soc_battery_health_ptr;
+  float max_charge = bat_calc_cellCharge_max * health;
+
+  if (isnanf(_bms_soc_charge)) {
+    //filter uninitialised: initialise from current-compensated weakest cell voltage, if possible
+    if (voltage_usable && bms_measurements.accumulated_charge != BMS_ERROR_CHARGE) {
+      float ocv = min_voltage - (current - bat_calc_voltageCurves_current) * bat_calc_cellResistance;
+      _bms_soc_charge = BAT_CALC_CellVoltageToCharge(ocv, health);
+      _bms_soc_charge_variance = BMS_SOC_KF_INIT_STDDEV * BMS_SOC_KF_INIT_STDDEV;
+      _bms_soc_prev_accumulated_charge = bms_measurements.accumulated_charge;
+      bms_measurements.soc_precisionlevel = SOC_VOLTAGE_ONLY;
+    }
+  } else {
+    //prediction: apply charge counted by the BMS since the last update
+    if (bms_measurements.accumulated_charge != BMS_ERROR_CHARGE) {
+      float charge_delta = (float)(bms_measurements.accumulated_charge - _bms_soc_prev_accumulated_charge) / 3600000.0f / (float)BMS_CELLS_PARALLEL; //mAs total -> Ah per cell
+      _bms_soc_prev_accumulated_charge = bms_measurements.accumulated_charge;
+      _bms_soc_charge += charge_delta;
+      _bms_soc_charge_variance += BMS_SOC_KF_COUNTER_GAIN_ERROR * BMS_SOC_KF_COUNTER_GAIN_ERROR * charge_delta * charge_delta + BMS_SOC_KF_COUNTER_OFFSET * BMS_SOC_KF_COUNTER_OFFSET;
     }
 
-    //check if lowest smoothed voltage is acceptable
-    if (min_voltage >= BMS_SOC_CELL_VOLTAGE_MIN && min_voltage <= BMS_SOC_CELL_VOLTAGE_MAX) {
-      //check if the battery is fully charged, reset BMS charge measurement if so
-      if (min_voltage >= BMS_SOC_CELL_FULL_CHARGE_VOLTAGE_MIN && BMS_I2C_SubcommandOnly(SUBCMD_RESET_PASSQ, BMS_COMM_MAX_TRIES) == HAL_OK) {
-        //fully charged: set charge reference point to full and go to SOC_CHARGE_FULL mode
-        _bms_soc_charge_reference = bat_calc_cellCharge_max * (*bms_soc_battery_health_ptr);
-        charge_delta = 0.0f;
-        bms_measurements.soc_precisionlevel = SOC_CHARGE_FULL;
-      } else {
-        //not full (normal operation): estimate charge of weakest cell
-        estimated_charge = BAT_CALC_CellVoltageToCharge(min_voltage, *bms_soc_battery_health_ptr);
-
-        //save as new charge reference or check existing charge reference
-        switch (bms_measurements.soc_precisionlevel) {
-          case SOC_CHARGE_ESTIMATED:
-          case SOC_CHARGE_FULL:
-            //check integrated charge
-            charge = _bms_soc_charge_reference + charge_delta;
-            if (fabsf(charge - estimated_charge) <= BMS_SOC_CHARGE_DIFFERENCE_MAX) {
-              //close enough to estimated charge: continue with existing reference
-              break;
-            }
-            //too far away from estimated charge: fall through to next case, resetting it
-          default:
-            //reset BMS charge measurement, then set estimated charge reference point and go to SOC_CHARGE_ESTIMATED mode
-            if (BMS_I2C_SubcommandOnly(SUBCMD_RESET_PASSQ, BMS_COMM_MAX_TRIES) == HAL_OK) {
-              _bms_soc_charge_reference = estimated_charge;
-              charge_delta = 0.0f;
-              bms_measurements.soc_precisionlevel = SOC_CHARGE_ESTIMATED;
-            } else {
-              //fall back to voltage-only if reset command fails somehow
-              bms_measurements.soc_precisionlevel = SOC_VOLTAGE_ONLY;
-            }
-            break;
-        }
-      }
+    //correction: compare weakest cell voltage to the voltage expected at the estimated charge
+    if (voltage_usable) {
+      float ocv_slope;
+      float expected_voltage = BAT_CALC_CellChargeToOCV(_bms_soc_charge, health, &ocv_slope) + (current - bat_calc_voltageCurves_current) * bat_calc_cellResistance;
+      //voltage uncertainty increases with current (polarisation not covered by the resistance model)
+      float voltage_stddev = BMS_SOC_KF_VOLTAGE_STDDEV + BMS_SOC_KF_VOLTAGE_STDDEV_PER_AMP * fabsf(current);
+      float gain = _bms_soc_charge_variance * ocv_slope / (ocv_slope * ocv_slope * _bms_soc_charge_variance + voltage_stddev * voltage_stddev);
+      _bms_soc_charge += gain * (min_voltage - expected_voltage);
+      _bms_soc_charge_variance *= 1.0f - gain * ocv_slope;
     }
-  }
 
-  //calculate estimated cell energy, depending on the mode
-  switch (bms_measurements.soc_precisionlevel) {
-    default:
-      //invalid mode: default to voltage only, fall through to that case
-      DEBUG_PRINTF("WARNING: BMS SoC estimation encountered invalid mode %u\n", (uint8_t)bms_measurements.soc_precisionlevel);
+    //clamp to valid charge range
+    if (_bms_soc_charge < 0.0f) _bms_soc_charge = 0.0f;
+    else if (_bms_soc_charge > max_charge) _bms_soc_charge = max_charge;
+
+    //full charge detection: at low current, weakest cell above full charge threshold
+    if (voltage_usable && fabsf(current_smoothed) <= bat_calc_voltageToCharge_max_valid_current && min_voltage >= BMS_SOC_CELL_FULL_CHARGE_VOLTAGE_MIN) {
+      //fully charged: set charge to full with low uncertainty and go to SOC_CHARGE_FULL mode
+      _bms_soc_charge = max_charge;
+      _bms_soc_charge_variance = BMS_SOC_KF_FULL_STDDEV * BMS_SOC_KF_FULL_STDDEV;
+      bms_measurements.soc_precisionlevel = SOC_CHARGE_FULL;
+    } else if (_bms_soc_charge_variance > BMS_SOC_KF_CONVERGED_STDDEV * BMS_SOC_KF_CONVERGED_STDDEV) {
+      //uncertainty too high: report as voltage-based estimate
       bms_measurements.soc_precisionlevel = SOC_VOLTAGE_ONLY;
-    case SOC_VOLTAGE_ONLY:
-      if (fabsf(current) > bat_calc_voltageToEnergy_max_valid_current) {
-        //current too high for valid voltage-to-energy estimation: report unknown energy and fraction (NaN)
-        bms_measurements.soc_energy = NAN;
-        bms_measurements.soc_fraction = NAN;
-        return;
-      } else {
-        //determine lowest cell voltage
-        min_voltage = voltages[0];
-        for (i = 1; i < BMS_CELLS_SERIES; i++) {
-          if (voltages[i] < min_voltage) min_voltage = voltages[i];
-        }
-
-        if (min_voltage < BMS_SOC_CELL_VOLTAGE_MIN || min_voltage > BMS_SOC_CELL_VOLTAGE_MAX) {
-          //unacceptable voltage: something went wrong, no estimation possible
-          bms_measurements.soc_energy = NAN;
-          bms_measurements.soc_fraction = NAN;
-          return;
-        }
+    } else if (bms_measurements.soc_precisionlevel != SOC_CHARGE_FULL) {
+      //converged (without full charge reference)
+      bms_measurements.soc_precisionlevel = SOC_CHARGE_ESTIMATED;
+    }
+  }
 
-        //estimate energy of weakest cell
-        cell_energy = BAT_CALC_CellVoltageToEnergy(min_voltage, *bms_soc_battery_health_ptr);
-      }
-      break;
-    case SOC_CHARGE_ESTIMATED:
-    case SOC_CHARGE_FULL:
-      //calculate integrated charge per cell
-      charge = _bms_soc_charge_reference + charge_delta;
-      //estimate energy of single cell
-      cell_energy = BAT_CALC_CellChargeToEnergy(charge, *bms_soc_battery_health_ptr);
-      break;
+  //calculate estimated cell energy
+  if (isnanf(_bms_soc_charge)) {
+    //filter uninitialised: direct voltage-based estimation, only possible at low current
+    bms_measurements.soc_precisionlevel = SOC_VOLTAGE_ONLY;
+    if (!voltage_usable || fabsf(current) > bat_calc_voltageToEnergy_max_valid_current) {
+      //no valid estimation possible: report unknown energy and fraction (NaN)
+      bms_measurements.soc_energy = NAN;
+      bms_measurements.soc_fraction = NAN;
+      return;
+    }
+    //estimate energy of weakest cell
+    cell_energy = BAT_CALC_CellVoltageToEnergy(min_voltage, health);
+  } else {
+    //estimate energy of weakest cell from filtered charge
+    cell_energy = BAT_CALC_CellChargeToEnergy(_bms_soc_charge, health);
   }
 
   //multiply single cell energy by cell count to get total energy
   bms_measurements.soc_energy = BMS_CELLS_TOTAL * cell_energy;
   //calculate fraction from cell energy and battery health, and clamp to [0, 1]
-  bms_measurements.soc_fraction = cell_energy / (bat_calc_cellEnergy_max * (*bms_soc_battery_health_ptr));
+  bms_measurements.soc_fraction = cell_energy / (bat_calc_cellEnergy_max * health);
   if (bms_measurements.soc_fraction < 0.0f) bms_measurements.soc_fraction = 0.0f;
   else if (bms_measurements.soc_fraction > 1.0f) bms_measurements.soc_fraction = 1.0f;
 }
@@ -528,52 +539,27 @@ HAL_StatusTypeDef BMS_UpdateStatus() {
   bms_status.dsg_state = ((status_read & 0x0004) != 0);
   bms_status.chg_state = ((status_read & 0x0008) != 0);
 
-  //check whether we have any safety alerts - if yes, read which ones, otherwise set alert status to zero
-  uint8_t safety_read;
-  if ((status_read & 0x2000) > 0) {
-    //read and populate actual status
-    if (BMS_I2C_DirectCommandRead(DIRCMD_SAFETY_ALERT_A, &safety_read, 1, BMS_COMM_MAX_TRIES) == HAL_OK) {
-      bms_status.safety_alerts._a = safety_read;
-    } else {
-      //read failed: assume "all alerts"
-      DEBUG_PRINTF("ERROR: BMS Status update: Safety alerts A read failed\n");
-      bms_status.safety_alerts._a = 0xFF;
-      res = HAL_ERROR;
-    }
-    if (BMS_I2C_DirectCommandRead(DIRCMD_SAFETY_ALERT_B, &safety_read, 1, BMS_COMM_MAX_TRIES) == HAL_OK) {
-      bms_status.safety_alerts._b = safety_read;
+  //check whether we have any safety alerts or faults - if yes, read which ones (all four registers in one transfer), otherwise set them to zero
+  bool has_alerts = ((status_read & 0x2000) > 0);
+  bool has_faults = ((status_read & 0x1000) > 0);
+  if (has_alerts || has_faults) {
+    //register order: alert A, status A, alert B, status B
+    uint8_t safety_read[4];
+    if (BMS_I2C_DirectCommandRead(DIRCMD_SAFETY_ALERT_A, safety_read, 4, BMS_COMM_MAX_TRIES) == HAL_OK) {
+      bms_status.safety_alerts._a = has_alerts ? safety_read[0] : 0;
+      bms_status.safety_alerts._b = has_alerts ? safety_read[2] : 0;
+      bms_status.safety_faults._a = has_faults ? safety_read[1] : 0;
+      bms_status.safety_faults._b = has_faults ? safety_read[3] : 0;
     } else {
-      //read failed: assume "all alerts"
-      DEBUG_PRINTF("ERROR: BMS Status update: Safety alerts B read failed\n");
-      bms_status.safety_alerts._b = 0xFF;
+      //read failed: assume "all alerts/faults" where indicated
+      DEBUG_PRINTF("ERROR: BMS Status update: Safety alerts/faults read failed\n");
+      bms_status.safety_alerts._a = bms_status.safety_alerts._b = has_alerts ? 0xFF : 0;
+      bms_status.safety_faults._a = bms_status.safety_faults._b = has_faults ? 0xFF : 0;
       res = HAL_ERROR;
     }
   } else {
-    //no alerts
+    //no alerts or faults
     bms_status.safety_alerts._a = bms_status.safety_alerts._b = 0;
-  }
-
-  //handling of faults equivalent to alerts above
-  if ((status_read & 0x1000) > 0) {
-    //read and populate actual faults
-    if (BMS_I2C_DirectCommandRead(DIRCMD_SAFETY_STATUS_A, &safety_read, 1, BMS_COMM_MAX_TRIES) == HAL_OK) {
-      bms_status.safety_faults._a = safety_read;
-    } else {
-      //read failed: assume "all faults"
-      DEBUG_PRINTF("ERROR: BMS Status update: Safety faults A read failed\n");
-      bms_status.safety_faults._a = 0xFF;
-      res = HAL_ERROR;
-    }
-    if (BMS_I2C_DirectCommandRead(DIRCMD_SAFETY_STATUS_B, &safety_read, 1, BMS_COMM_MAX_TRIES) == HAL_OK) {
-      bms_status.safety_faults._b = safety_read;
-    } else {
-      //read failed: assume "all faults"
-      DEBUG_PRINTF("ERROR: BMS Status update: Safety faults B read failed\n");
-      bms_status.safety_faults._b = 0xFF;
-      res = HAL_ERROR;
-    }
-  } else {
-    //no faults
     bms_status.safety_faults._a = bms_status.safety_faults._b = 0;
   }
 
@@ -581,34 +567,34 @@ HAL_StatusTypeDef BMS_UpdateStatus() {
 }
 
 HAL_StatusTypeDef BMS_UpdateMeasurements(bool include_temps) {
-  //byte read buffer, aligned for up to int64 reads
-  uint8_t read_buffer_u8[12] __attribute__((aligned (8))) = { 0 };
+  //byte read buffer, aligned for up to int64 reads - large enough for the whole measurement block
+  uint8_t read_buffer_u8[BMS_MEAS_BLOCK_LENGTH_TEMPS] __attribute__((aligned (8))) = { 0 };
   //pointer for easy signed 16-bit reads
   int16_t* read_buffer_s16 = (int16_t*)read_buffer_u8;
 
   HAL_StatusTypeDef res = HAL_OK;
 
-  //read cell voltages
-  if (BMS_I2C_DirectCommandRead(DIRCMD_CELL1_VOLTAGE, read_buffer_u8, 10, BMS_COMM_MAX_TRIES) == HAL_OK) {
+  //read cell voltages, stack voltage, and optionally temperatures in one block transfer (consecutive direct command registers)
+  if (BMS_I2C_DirectCommandRead(DIRCMD_CELL1_VOLTAGE, read_buffer_u8, include_temps ? BMS_MEAS_BLOCK_LENGTH_TEMPS : BMS_MEAS_BLOCK_LENGTH, BMS_COMM_MAX_TRIES) == HAL_OK) {
     memcpy(bms_measurements.voltage_cells, read_buffer_s16, 10);
+    bms_measurements.voltage_stack = *(uint16_t*)(read_buffer_u8 + BMS_MEAS_BLOCK_OFFSET(DIRCMD_STACK_VOLTAGE));
+    if (include_temps) {
+      bms_measurements.bat_temp = _BMS_GetThermistorTemp(*(int16_t*)(read_buffer_u8 + BMS_MEAS_BLOCK_OFFSET(DIRCMD_TS_MEASUREMENT)));
+      bms_measurements.internal_temp = *(int16_t*)(read_buffer_u8 + BMS_MEAS_BLOCK_OFFSET(DIRCMD_INT_TEMP));
+    }
   } else {
-    //read failed: default to error voltage
-    DEBUG_PRINTF("ERROR: BMS measurement update: Cell voltage read failed\n");
+    //read failed: default to error values
+    DEBUG_PRINTF("ERROR: BMS measurement update: Voltage/temperature block read failed\n");
     bms_measurements.voltage_cells[0] = BMS_ERROR_VOLTAGE;
     bms_measurements.voltage_cells[1] = BMS_ERROR_VOLTAGE;
     bms_measurements.voltage_cells[2] = BMS_ERROR_VOLTAGE;
     bms_measurements.voltage_cells[3] = BMS_ERROR_VOLTAGE;
     bms_measurements.voltage_cells[4] = BMS_ERROR_VOLTAGE;
-    res = HAL_ERROR;
-  }
-
-  //read stack voltage
-  if (BMS_I2C_DirectCommandRead(DIRCMD_STACK_VOLTAGE, read_buffer_u8, 2, BMS_COMM_MAX_TRIES) == HAL_OK) {
-    bms_measurements.voltage_stack = *(uint16_t*)read_buffer_u8;
-  } else {
-    //read failed: default to error stack voltage
-    DEBUG_PRINTF("ERROR: BMS measurement update: Stack voltage read failed\n");
     bms_measurements.voltage_stack = BMS_ERROR_STACKVOLTAGE;
+    if (include_temps) {
+      bms_measurements.bat_temp = BMS_ERROR_TEMPERATURE;
+      bms_measurements.internal_temp = BMS_ERROR_TEMPERATURE;
+    }
     res = HAL_ERROR;
   }
 
@@ -640,28 +626,6 @@ HAL_StatusTypeDef BMS_UpdateMeasurements(bool include_temps) {
     _BMS_UpdateSoC();
   }
 
-  if (include_temps) {
-    //read battery temp
-    if (BMS_I2C_DirectCommandRead(DIRCMD_TS_MEASUREMENT, read_buffer_u8, 2, BMS_COMM_MAX_TRIES) == HAL_OK) {
-      bms_measurements.bat_temp = _BMS_GetThermistorTemp(read_buffer_s16[0]);
-    } else {
-      //read failed: default to error temp
-      DEBUG_PRINTF("ERROR: BMS measurement update: Thermistor read failed\n");
-      bms_measurements.bat_temp = BMS_ERROR_TEMPERATURE;
-      res = HAL_ERROR;
-    }
-
-    //read internal temp
-    if (BMS_I2C_DirectCommandRead(DIRCMD_INT_TEMP, read_buffer_u8, 2, BMS_COMM_MAX_TRIES) == HAL_OK) {
-      bms_measurements.internal_temp = read_buffer_s16[0];
-    } else {
-      //read failed: default to error temp
-      DEBUG_PRINTF("ERROR: BMS measurement update: Internal temp read failed\n");
-      bms_measurements.internal_temp = BMS_ERROR_TEMPERATURE;
-      res = HAL_ERROR;
-    }
-  }
-
   return res;
 }
 
@@ -860,26 +824,7 @@ bool BMS_GetDeepSleepDesiredState() {
 
 
 void BMS_AlertInterrupt() {
-  uint16_t alarm_status;
-  if (BMS_I2C_DirectCommandRead(DIRCMD_ALARM_STATUS, (uint8_t*)&alarm_status, 2, BMS_COMM_MAX_TRIES) != HAL_OK) return;
-
-  //INITCOMP bit (init complete after powerup, deepsleep exit, or cfgupdate exit)
-  if ((alarm_status & 0x0004) != 0) {
-    _bms_detected_initcomp = true;
-  }
-
-  //SHUTV bit (shutdown voltage threshold crossed (cell or stack)
-  if ((alarm_status & 0x0200) != 0) {
-    _bms_detected_shutdown_voltage = true;
-  }
-
-  //safety status or alert bits
-  if ((alarm_status & 0xF000) != 0) {
-    _bms_detected_safety_event = true;
-  }
-
-  //clear alarm flags
-  BMS_I2C_DirectCommandWrite(DIRCMD_ALARM_STATUS, (uint8_t*)&alarm_status, 2, BMS_COMM_MAX_TRIES);
+  _bms_alert_pending = true;
 }
 
 
@@ -897,6 +842,7 @@ static HAL_StatusTypeDef _BMS_InitAttempt() {
   bms_measurements.soc_precisionlevel = SOC_VOLTAGE_ONLY;
   bms_measurements.soc_energy = NAN;
   bms_measurements.soc_fraction = NAN;
+  _bms_soc_charge = NAN;
 
   //if battery health is invalid or unreasonably bad (<10%), reset to default 100% health
   if (isnanf(*bms_soc_battery_health_ptr) || *bms_soc_battery_health_ptr < 0.1f || *bms_soc_battery_health_ptr > 1.0f) {
@@ -1004,9 +950,9 @@ void BMS_LoopUpdate(uint32_t loop_count) {
   //calculate internal desired deepsleep state
   _bms_should_deepsleep_internal = bms_should_deepsleep || _bms_timed_shutdown_triggered;
 
-  //update alerts if interrupt was somehow missed
-  if (HAL_GPIO_ReadPin(BMS_ALERT_N_GPIO_Port, BMS_ALERT_N_Pin) == GPIO_PIN_RESET) {
-    BMS_AlertInterrupt();
+  //handle pending alerts, or update them if interrupt was somehow missed
+  if (_bms_alert_pending || HAL_GPIO_ReadPin(BMS_ALERT_N_GPIO_Port, BMS_ALERT_N_Pin) == GPIO_PIN_RESET) {
+    _BMS_HandleAlert();
   }
 
   //alert/fault handling
@@ -38,22 +38,81 @@ bool bms_i2c_suppress_error_notifs = false;
 
 static uint8_t bms_i2c_buffer[BMS_I2C_BUFSIZE] = { 0 };
 
+//state of the current DMA transfer, set by the HAL callbacks
+static volatile bool bms_i2c_transfer_done = true;
+static volatile bool bms_i2c_transfer_error = false;
 
-/*void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) {
 
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  if (hi2c == &hi2c3) {
+    bms_i2c_transfer_done = true;
+  }
 }
 
 void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
-
-}*/
+  if (hi2c == &hi2c3) {
+    bms_i2c_transfer_done = true;
+  }
+}
 
 void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
   if (hi2c == &hi2c3) {
-    SET_BIT(hi2c3.Instance->ICR, I2C_ICR_BERRCF); //workaround for STM32L07xxx device errata, 2.14.4 (spurious bus error detection in master mode) - shouldn't matter since interrupt disabled
+    //spurious bus errors (device errata) are already cleared in the IRQ handler, so this is a real error (NACK, arbitration loss etc)
+    bms_i2c_transfer_error = true;
+    bms_i2c_transfer_done = true;
   }
 }
 
 
+//wait for the current transfer to finish, sleeping until the next interrupt in between
+static HAL_StatusTypeDef _BMS_I2C_WaitForTransfer() {
+  uint32_t start_tick = HAL_GetTick();
+
+  while (!bms_i2c_transfer_done) {
+    if ((HAL_GetTick() - start_tick) > BMS_I2C_TIMEOUT) {
+      //timed out: reset the peripheral to abort the transfer
+      DEBUG_PRINTF("ERROR: BMS I2C transfer timed out\n");
+      HAL_I2C_DeInit(&hi2c3);
+      HAL_I2C_Init(&hi2c3);
+      bms_i2c_transfer_done = true;
+      return HAL_TIMEOUT;
+    }
+    //completion between the check and WFI only delays wakeup until the next systick, which is fine
+    __WFI();
+  }
+
+  return bms_i2c_transfer_error ? HAL_ERROR : HAL_OK;
+}
+
+//DMA-driven register read, blocks (in sleep) until done
+static HAL_StatusTypeDef _BMS_I2C_MemRead(uint8_t reg, uint8_t* buffer, uint16_t length) {
+  bms_i2c_transfer_done = false;
+  bms_i2c_transfer_error = false;
+
+  HAL_StatusTypeDef res = HAL_I2C_Mem_Read_DMA(&hi2c3, BMS_I2C_ADDR, reg, 1, buffer, length);
+  if (res != HAL_OK) {
+    bms_i2c_transfer_done = true;
+    return res;
+  }
+
+  return _BMS_I2C_WaitForTransfer();
+}
+
+//DMA-driven register write, blocks (in sleep) until done
+static HAL_StatusTypeDef _BMS_I2C_MemWrite(uint8_t reg, uint8_t* data, uint16_t length) {
+  bms_i2c_transfer_done = false;
+  bms_i2c_transfer_error = false;
+
+  HAL_StatusTypeDef res = HAL_I2C_Mem_Write_DMA(&hi2c3, BMS_I2C_ADDR, reg, 1, data, length);
+  if (res != HAL_OK) {
+    bms_i2c_transfer_done = true;
+    return res;
+  }
+
+  return _BMS_I2C_WaitForTransfer();
+}
+
+
 HAL_StatusTypeDef BMS_I2C_DirectCommandRead(BMS_I2C_DirectCommand command, uint8_t* buffer, uint8_t length, uint8_t max_tries) {
   if (length < 1 || length > (BMS_I2C_BUFSIZE / 2)) return HAL_ERROR;
 
@@ -63,7 +122,7 @@ HAL_StatusTypeDef BMS_I2C_DirectCommandRead(BMS_I2C_DirectCommand command, uint8
   //retry loop
   int try;
   for (try = 0; try < max_tries; try++) {
-    res = HAL_I2C_Mem_Read(&hi2c3, BMS_I2C_ADDR, command, 1, bms_i2c_buffer, data_size, BMS_I2C_TIMEOUT);
+    res = _BMS_I2C_MemRead(command, bms_i2c_buffer, data_size);
     if (res != HAL_OK) continue;
 
     if (bms_i2c_crc_active) {
@@ -134,7 +193,7 @@ HAL_StatusTypeDef BMS_I2C_DirectCommandWrite(BMS_I2C_DirectCommand command, cons
   //retry loop
   int try;
   for (try = 0; try < max_tries; try++) {
-    res = HAL_I2C_Mem_Write(&hi2c3, BMS_I2C_ADDR, command, 1, bms_i2c_buffer, data_size, BMS_I2C_TIMEOUT);
+    res = _BMS_I2C_MemWrite(command, bms_i2c_buffer, data_size);
     if (res == HAL_OK) return HAL_OK;
   }
 
@@ -155,7 +214,10 @@ HAL_StatusTypeDef BMS_I2C_SubcommandOnly(BMS_I2C_SubCommand command, uint8_t max
 HAL_StatusTypeDef BMS_I2C_SubcommandRead(BMS_I2C_SubCommand command, uint8_t* buffer, uint8_t length, uint8_t max_tries) {
   if (length < 1) return HAL_ERROR;
 
+  //response chunk: subcommand readback and data (0x3E-0x5F), checksum and length (0x60-0x61)
   uint8_t read_buffer[36] = { 0 };
+  //whether to always read full chunks - needed if the response turns out to be longer than the requested length, to verify the checksum
+  bool full_chunks = false;
 
   HAL_StatusTypeDef res;
 
@@ -169,8 +231,17 @@ HAL_StatusTypeDef BMS_I2C_SubcommandRead(BMS_I2C_SubCommand command, uint8_t* bu
     //read chunks of 32 bytes
     int i, j;
     for (i = 0; i < length; i += 32) {
-      //read back subcommand, data, checksum, and length (which also causes auto-increment)
-      res = BMS_I2C_DirectCommandRead((BMS_I2C_DirectCommand)BMS_I2C_REG_SUBCOMMAND, read_buffer, 36, 1);
+      uint8_t chunk_wanted = MIN(length - i, 32);
+      if (full_chunks || chunk_wanted == 32) {
+        //read back subcommand, data, checksum, and length (which also causes auto-increment) in one go
+        res = BMS_I2C_DirectCommandRead((BMS_I2C_DirectCommand)BMS_I2C_REG_SUBCOMMAND, read_buffer, 36, 1);
+      } else {
+        //partial chunk: only transfer subcommand readback and the requested data, then checksum and length - much shorter for small responses
+        res = BMS_I2C_DirectCommandRead((BMS_I2C_DirectCommand)BMS_I2C_REG_SUBCOMMAND, read_buffer, chunk_wanted + 2, 1);
+        if (res == HAL_OK) {
+          res = BMS_I2C_DirectCommandRead((BMS_I2C_DirectCommand)BMS_I2C_REG_CHECKSUM, read_buffer + 34, 2, 1);
+        }
+      }
       if (res != HAL_OK) break;
 
       //check that the command is correct
@@ -189,6 +260,14 @@ HAL_StatusTypeDef BMS_I2C_SubcommandRead(BMS_I2C_SubCommand command, uint8_t* bu
         break;
       }
 
+      //response longer than the partial read: checksum can't be verified, restart with full chunks (doesn't count as a failed try)
+      if (!full_chunks && chunk_wanted < 32 && chunk_length > chunk_wanted + 4) {
+        full_chunks = true;
+        try--;
+        res = HAL_ERROR;
+        break;
+      }
+
       //calculate checksum and compare with received checksum
       uint8_t checksum = 0;
       for (j = 0; j < chunk_length - 2; j++) {
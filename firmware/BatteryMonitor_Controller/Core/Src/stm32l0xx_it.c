@@ -55,6 +55,9 @@
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_i2c3_rx;
+extern DMA_HandleTypeDef hdma_i2c3_tx;
+extern I2C_HandleTypeDef hi2c3;
 extern UART_HandleTypeDef huart1;
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
@@ -156,6 +159,42 @@ void EXTI4_15_IRQHandler(void)
   /* USER CODE END EXTI4_15_IRQn 1 */
 }
 
+/**
+  * @brief This function handles DMA1 channel 2 and channel 3 interrupts.
+  */
+void DMA1_Channel2_3_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel2_3_IRQn 0 */
+
+  /* USER CODE END DMA1_Channel2_3_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_i2c3_tx);
+  HAL_DMA_IRQHandler(&hdma_i2c3_rx);
+  /* USER CODE BEGIN DMA1_Channel2_3_IRQn 1 */
+
+  /* USER CODE END DMA1_Channel2_3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles I2C3 event global interrupt / I2C3 error global interrupt / I2C3 wake-up interrupt through EXTI line 24.
+  */
+void I2C3_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C3_IRQn 0 */
+  //workaround for STM32L07xxx device errata, 2.14.4 (spurious bus error detection in master mode): clear flag before HAL error handling, transfer continues normally
+  if (__HAL_I2C_GET_FLAG(&hi2c3, I2C_FLAG_BERR)) {
+    __HAL_I2C_CLEAR_FLAG(&hi2c3, I2C_FLAG_BERR);
+  }
+  /* USER CODE END I2C3_IRQn 0 */
+  if (hi2c3.Instance->ISR & (I2C_FLAG_BERR | I2C_FLAG_ARLO | I2C_FLAG_OVR)) {
+    HAL_I2C_ER_IRQHandler(&hi2c3);
+  } else {
+    HAL_I2C_EV_IRQHandler(&hi2c3);
+  }
+  /* USER CODE BEGIN I2C3_IRQn 1 */
+
+  /* USER CODE END I2C3_IRQn 1 */
+}
+
 /**
   * @brief This function handles USART1 global interrupt / USART1 wake-up interrupt through EXTI line 25.
   */
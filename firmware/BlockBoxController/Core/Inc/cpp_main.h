@@ -49,8 +49,8 @@ int cpp_main();
 //simple success-or-failure callback
 typedef std::function<void(bool)> SuccessCallback;
 
-//parameterless operation for queueing
-typedef std::function<void()> QueuedOperation;
+//operation for queueing, reporting its result to the given callback
+typedef std::function<void(SuccessCallback&&)> QueuedOperation;
 
 
 typedef enum {
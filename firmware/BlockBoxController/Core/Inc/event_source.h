@@ -12,9 +12,17 @@
 #include "cpp_main.h"
 
 
-#ifdef __cplusplus
+//maximum number of event callback registrations, across all event sources
+#define EVENT_MAX_REGISTRATIONS 80
+//maximum number of links between registrations and per-event callback lists, across all event sources (one link per event bit of each registration)
+#define EVENT_MAX_LINKS 192
+//maximum number of pending deferred event deliveries
+#define EVENT_DEFERRED_QUEUE_SIZE 32
+//registration/link index meaning "none" (end of list)
+#define EVENT_INDEX_NONE 0xFFFF
+
 
-#include <vector>
+#ifdef __cplusplus
 
 extern "C" {
 #endif
@@ -32,21 +40,47 @@ typedef std::function<void(EventSource*, uint32_t)> EventCallback;
 
 typedef struct {
   EventCallback func;
-  uint32_t event_mask;
+  EventSource* source;
   uint64_t identifier;
+  uint32_t event_mask;
+  //incremented whenever the registration slot is reused, to detect outdated deferred deliveries
+  uint16_t generation;
+  bool used;
+  //whether the callback is called from the main loop (`DeliverDeferredEvents`) instead of directly when the event occurs
+  bool deferred;
+  //unregistered/registered while callbacks of the source were running: freed/activated once they're done
+  bool removed;
+  bool added;
 } EventCallbackRegistration;
 
 
 class EventSource {
 public:
-  void RegisterCallback(EventCallback&& cb, uint32_t event_mask, uint64_t identifier = 0);
+  void RegisterCallback(EventCallback&& cb, uint32_t event_mask, uint64_t identifier = 0, bool deferred = false);
   void UnregisterCallback(uint64_t identifier);
   void ClearCallbacks() noexcept;
 
+  //delivers pending deferred events (of all event sources) - to be called once per main loop cycle
+  static void DeliverDeferredEvents() noexcept;
+
+  EventSource();
+  virtual ~EventSource();
+
 protected:
-  std::vector<EventCallbackRegistration> registered_callbacks;
+  //first link of the callback list of each event bit
+  uint16_t event_list_heads[32];
+  //number of currently running callback executions of this source (nested or interrupted) - registration changes are delayed until it's zero
+  uint16_t dispatch_depth;
+  bool dispatch_cleanup_pending;
 
   void ExecuteCallbacks(uint32_t event) noexcept;
+
+private:
+  void LinkRegistration(uint16_t index, uint32_t bits) noexcept;
+  void UnlinkRegistration(uint16_t index, uint32_t bits) noexcept;
+  void RemoveRegistration(uint16_t index) noexcept;
+  void BeginDispatch() noexcept;
+  void EndDispatch() noexcept;
 };
 
 
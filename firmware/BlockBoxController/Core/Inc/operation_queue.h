@@ -0,0 +1,73 @@
+/*
+ * operation_queue.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ */
+
+#ifndef INC_OPERATION_QUEUE_H_
+#define INC_OPERATION_QUEUE_H_
+
+
+#include "cpp_main.h"
+
+
+//operation kind that is never coalesced
+#define OP_KIND_NONE 0
+
+
+#ifdef __cplusplus
+
+#include <deque>
+
+
+//kind of a queued operation, for coalescing: a queued operation is superseded by a newer one of the same (non-zero) kind
+typedef uint32_t OperationKind;
+
+
+typedef struct {
+  OperationKind kind;
+  QueuedOperation operation;
+  SuccessCallback callback;
+} QueuedOperationEntry;
+
+
+//lock and queue for multi-step (async) operations of a manager: only one operation runs at a time, others are queued until it finishes
+class OperationQueue {
+public:
+  OperationQueue(const char* name);
+
+  //tries to lock out further operations for the given number of main loop cycles (timeout) - returns false if already locked
+  bool TryLock(uint32_t timeout_cycles) noexcept;
+  //unlocks after an operation is finished, and directly starts the next queued operation (if any)
+  void Unlock() noexcept;
+  //unlocks after an operation is finished, calls its completion callback (if any) with the given result, and only then starts the next queued operation
+  void Unlock(const SuccessCallback& callback, bool success);
+  //resets the lock without starting queued operations (for (re-)initialisation)
+  void ResetLock() noexcept;
+  bool IsLocked() const noexcept;
+
+  //queues the given operation for execution after the current one - if an operation of the same (non-zero) kind is already queued, it's superseded:
+  //the new operation takes its place in the queue, and its callback receives the result of the new operation as well
+  void Push(OperationKind kind, QueuedOperation&& operation, SuccessCallback&& callback);
+
+  //lock timeout handling, and starting of queued operations (fallback, normally started on unlock) - to be called once per main loop cycle
+  void LoopTasks() noexcept;
+
+protected:
+  const char* const name;
+
+  uint32_t lock_timer;
+  bool starting;
+  std::deque<QueuedOperationEntry> queue;
+
+  void StartNext() noexcept;
+  //reports a failed start to the operation's callback (if any)
+  void FailCallback(const SuccessCallback& callback) noexcept;
+};
+
+
+#endif
+
+
+#endif /* INC_OPERATION_QUEUE_H_ */
@@ -10,29 +10,168 @@
 #include "system.h"
 
 
+//link between a registration and the callback list of one event bit
+typedef struct {
+  uint16_t registration;
+  uint16_t next;
+} EventCallbackLink;
+
+//pending deferred event delivery
+typedef struct {
+  uint16_t registration;
+  uint16_t generation;
+  uint32_t event;
+} EventDeferredDelivery;
+
+
+//static storage for registrations and links of all event sources - unused links form a free list
+static EventCallbackRegistration _event_registrations[EVENT_MAX_REGISTRATIONS];
+static EventCallbackLink _event_links[EVENT_MAX_LINKS];
+static uint16_t _event_free_link_head = EVENT_INDEX_NONE;
+static uint16_t _event_free_link_count = 0;
+static bool _event_links_initialised = false;
+
+//ring buffer of pending deferred event deliveries
+static EventDeferredDelivery _event_deferred_queue[EVENT_DEFERRED_QUEUE_SIZE];
+static uint16_t _event_deferred_read = 0;
+static uint16_t _event_deferred_count = 0;
+
+
+//sets up the free link list - assumes disabled interrupts
+static void _EventSource_InitLinks() {
+  if (_event_links_initialised) {
+    return;
+  }
+
+  for (uint16_t i = 0; i < EVENT_MAX_LINKS; i++) {
+    _event_links[i].registration = EVENT_INDEX_NONE;
+    _event_links[i].next = (i + 1 < EVENT_MAX_LINKS) ? i + 1 : EVENT_INDEX_NONE;
+  }
+  _event_free_link_head = 0;
+  _event_free_link_count = EVENT_MAX_LINKS;
+  _event_links_initialised = true;
+}
+
+//queues a deferred delivery, unless the same one is already pending - assumes disabled interrupts
+static void _EventSource_QueueDeferred(uint16_t registration, uint32_t event) {
+  uint16_t generation = _event_registrations[registration].generation;
+
+  for (uint16_t i = 0; i < _event_deferred_count; i++) {
+    EventDeferredDelivery& item = _event_deferred_queue[(_event_deferred_read + i) % EVENT_DEFERRED_QUEUE_SIZE];
+    if (item.registration == registration && item.generation == generation && item.event == event) {
+      //already pending: nothing to do
+      return;
+    }
+  }
+
+  if (_event_deferred_count >= EVENT_DEFERRED_QUEUE_SIZE) {
+    DEBUG_LOG(DEBUG_WARNING, "EventSource deferred queue full, dropping event 0x%08lX", event);
+    return;
+  }
+
+  EventDeferredDelivery& item = _event_deferred_queue[(_event_deferred_read + _event_deferred_count) % EVENT_DEFERRED_QUEUE_SIZE];
+  item.registration = registration;
+  item.generation = generation;
+  item.event = event;
+  _event_deferred_count++;
+}
+
+//calls the given registration's callback (in exception-safe way)
+static void _EventSource_Call(EventCallbackRegistration& reg, EventSource* source, uint32_t event) {
+  try {
+    reg.func(source, event);
+  } catch (const std::exception& err) {
+    DEBUG_LOG(DEBUG_ERROR, "EventSource callback exception: %s", err.what());
+  } catch (...) {
+    DEBUG_LOG(DEBUG_ERROR, "Unknown EventSource callback exception");
+  }
+}
+
+
 //registers the given callback with the given event mask and identifier. identifier 0 is "unidentifiable". if the given (non-zero) identifier already exists, the old callback is replaced.
-void EventSource::RegisterCallback(EventCallback&& cb, uint32_t event_mask, uint64_t identifier) {
+//deferred callbacks are called from the main loop (coalesced per event), to avoid long synchronous callback chains - others are called directly when the event occurs.
+void EventSource::RegisterCallback(EventCallback&& cb, uint32_t event_mask, uint64_t identifier, bool deferred) {
   if (!cb || event_mask == 0) {
     throw std::invalid_argument("EventSource RegisterCallback requires a non-empty function and a non-zero event mask");
   }
 
-  //iterate through existing registrations to see if this identifier is already registered
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  _EventSource_InitLinks();
+
+  //find existing registration with this identifier, if any
+  uint16_t existing = EVENT_INDEX_NONE;
   if (identifier != 0) {
-    for (auto& reg : this->registered_callbacks) {
-      if (reg.identifier == identifier) {
-        //function already registered: replace old callback and event mask with new ones
-        reg.func = std::move(cb);
-        reg.event_mask = event_mask;
-        return;
+    for (uint16_t i = 0; i < EVENT_MAX_REGISTRATIONS; i++) {
+      EventCallbackRegistration& reg = _event_registrations[i];
+      if (reg.used && !reg.removed && reg.source == this && reg.identifier == identifier) {
+        existing = i;
+        break;
       }
     }
   }
 
-  //new function: add registration for it
-  auto& new_reg = this->registered_callbacks.emplace_back();
-  new_reg.func = std::move(cb);
-  new_reg.event_mask = event_mask;
-  new_reg.identifier = identifier;
+  if (existing != EVENT_INDEX_NONE && this->dispatch_depth == 0) {
+    //identifier already registered and no callbacks running: replace old callback and event mask in place (keeping the call order)
+    EventCallbackRegistration& reg = _event_registrations[existing];
+    if (reg.event_mask != event_mask) {
+      //only relink the changed bits, so the registration keeps its place in the lists of the bits it keeps
+      uint32_t removed_bits = reg.event_mask & ~event_mask;
+      uint32_t added_bits = event_mask & ~reg.event_mask;
+      if (_event_free_link_count + (uint32_t)__builtin_popcount(removed_bits) < (uint32_t)__builtin_popcount(added_bits)) {
+        __set_PRIMASK(primask);
+        throw std::runtime_error("EventSource RegisterCallback ran out of callback links");
+      }
+      this->UnlinkRegistration(existing, removed_bits);
+      this->LinkRegistration(existing, added_bits);
+      reg.event_mask = event_mask;
+    }
+    reg.func = std::move(cb);
+    reg.deferred = deferred;
+    reg.generation++;
+    __set_PRIMASK(primask);
+    return;
+  }
+
+  //new registration needed: find free slot, and check for enough free links
+  uint16_t index = EVENT_INDEX_NONE;
+  for (uint16_t i = 0; i < EVENT_MAX_REGISTRATIONS; i++) {
+    if (!_event_registrations[i].used) {
+      index = i;
+      break;
+    }
+  }
+  if (index == EVENT_INDEX_NONE) {
+    __set_PRIMASK(primask);
+    throw std::runtime_error("EventSource RegisterCallback ran out of registration slots");
+  }
+  if (_event_free_link_count < (uint32_t)__builtin_popcount(event_mask)) {
+    __set_PRIMASK(primask);
+    throw std::runtime_error("EventSource RegisterCallback ran out of callback links");
+  }
+
+  EventCallbackRegistration& reg = _event_registrations[index];
+  reg.func = std::move(cb);
+  reg.source = this;
+  reg.identifier = identifier;
+  reg.event_mask = event_mask;
+  reg.generation++;
+  reg.used = true;
+  reg.deferred = deferred;
+  reg.removed = false;
+  //if callbacks are running: only activate the new registration once they're done
+  reg.added = (this->dispatch_depth > 0);
+  if (reg.added) {
+    this->dispatch_cleanup_pending = true;
+  }
+  this->LinkRegistration(index, event_mask);
+
+  //replacing a registration while callbacks are running: remove old one (delayed until they're done)
+  if (existing != EVENT_INDEX_NONE) {
+    this->RemoveRegistration(existing);
+  }
+
+  __set_PRIMASK(primask);
 }
 
 void EventSource::UnregisterCallback(uint64_t identifier) {
@@ -40,36 +179,201 @@ void EventSource::UnregisterCallback(uint64_t identifier) {
     throw std::invalid_argument("EventSource UnregisterCallback only works for nonzero identifiers");
   }
 
-  //iterate through existing registrations to find the function with the given identifier
-  for (auto i = this->registered_callbacks.begin(); i < this->registered_callbacks.end(); i++) {
-    auto& reg = *i;
-    if (reg.identifier == identifier) {
-      //found: remove callback registration and return
-      this->registered_callbacks.erase(i);
-      return;
+  //find the registration with the given identifier, and remove it
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint16_t i = 0; i < EVENT_MAX_REGISTRATIONS; i++) {
+    EventCallbackRegistration& reg = _event_registrations[i];
+    if (reg.used && !reg.removed && reg.source == this && reg.identifier == identifier) {
+      this->RemoveRegistration(i);
+      break;
     }
   }
+  __set_PRIMASK(primask);
 }
 
 void EventSource::ClearCallbacks() noexcept {
-  this->registered_callbacks.clear();
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint16_t i = 0; i < EVENT_MAX_REGISTRATIONS; i++) {
+    EventCallbackRegistration& reg = _event_registrations[i];
+    if (reg.used && !reg.removed && reg.source == this) {
+      this->RemoveRegistration(i);
+    }
+  }
+  __set_PRIMASK(primask);
+}
+
+
+void EventSource::DeliverDeferredEvents() noexcept {
+  //only deliver events that are pending now - events queued by the delivered callbacks are handled in the next cycle
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint16_t count = _event_deferred_count;
+  __set_PRIMASK(primask);
+
+  for (uint16_t i = 0; i < count; i++) {
+    __disable_irq();
+    if (_event_deferred_count == 0) {
+      __set_PRIMASK(primask);
+      break;
+    }
+    EventDeferredDelivery item = _event_deferred_queue[_event_deferred_read];
+    _event_deferred_read = (_event_deferred_read + 1) % EVENT_DEFERRED_QUEUE_SIZE;
+    _event_deferred_count--;
+
+    //skip delivery if the registration was removed or replaced in the meantime
+    EventCallbackRegistration& reg = _event_registrations[item.registration];
+    if (!reg.used || reg.removed || reg.generation != item.generation) {
+      __set_PRIMASK(primask);
+      continue;
+    }
+    EventSource* source = reg.source;
+    source->dispatch_depth++;
+    __set_PRIMASK(primask);
+
+    _EventSource_Call(reg, source, item.event);
+
+    source->EndDispatch();
+  }
+}
+
+
+EventSource::EventSource() : dispatch_depth(0), dispatch_cleanup_pending(false) {
+  for (int i = 0; i < 32; i++) {
+    this->event_list_heads[i] = EVENT_INDEX_NONE;
+  }
+}
+
+EventSource::~EventSource() {
+  this->ClearCallbacks();
 }
 
 
 void EventSource::ExecuteCallbacks(uint32_t event) noexcept {
-  //iterate through callback registrations to find all that match the given event
-  for (auto i = this->registered_callbacks.begin(); i < this->registered_callbacks.end(); i++) {
-    auto& reg = *i;
-    if ((reg.event_mask & event) != 0) {
-      //event mask matches: call function (in exception-safe way)
-      try {
-        reg.func(this, event);
-      } catch (const std::exception& err) {
-        DEBUG_LOG(DEBUG_ERROR, "EventSource callback exception: %s", err.what());
-      } catch (...) {
-        DEBUG_LOG(DEBUG_ERROR, "Unknown EventSource callback exception");
+  this->BeginDispatch();
+
+  //go through the callback lists of all bits of the given event
+  uint32_t remaining_bits = event;
+  while (remaining_bits != 0) {
+    int bit = __builtin_ctz(remaining_bits);
+    remaining_bits &= ~(1u << bit);
+
+    //links are only removed once all callbacks are done, and new ones are added at the end, so the list can be followed safely
+    for (uint16_t link = this->event_list_heads[bit]; link != EVENT_INDEX_NONE; link = _event_links[link].next) {
+      uint16_t index = _event_links[link].registration;
+      EventCallbackRegistration& reg = _event_registrations[index];
+      //skip registrations changed during this execution, and ones that already matched a lower bit of the event (to call each one only once)
+      if (reg.removed || reg.added || (reg.event_mask & event & ((1u << bit) - 1)) != 0) {
+        continue;
+      }
+
+      if (reg.deferred) {
+        //deferred: queue for delivery from the main loop
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        _EventSource_QueueDeferred(index, event);
+        __set_PRIMASK(primask);
+      } else {
+        _EventSource_Call(reg, this, event);
       }
     }
   }
+
+  this->EndDispatch();
 }
 
+
+//adds the given registration to the end of the callback list of each of the given event bits - assumes disabled interrupts and enough free links
+void EventSource::LinkRegistration(uint16_t index, uint32_t bits) noexcept {
+  uint32_t remaining_bits = bits;
+  while (remaining_bits != 0) {
+    int bit = __builtin_ctz(remaining_bits);
+    remaining_bits &= ~(1u << bit);
+
+    //take link from free list
+    uint16_t link = _event_free_link_head;
+    _event_free_link_head = _event_links[link].next;
+    _event_free_link_count--;
+    _event_links[link].registration = index;
+    _event_links[link].next = EVENT_INDEX_NONE;
+
+    //append to callback list
+    uint16_t* next_p = this->event_list_heads + bit;
+    while (*next_p != EVENT_INDEX_NONE) {
+      next_p = &_event_links[*next_p].next;
+    }
+    *next_p = link;
+  }
+}
+
+//removes the given registration from the callback lists of the given event bits - assumes disabled interrupts and no running callbacks
+void EventSource::UnlinkRegistration(uint16_t index, uint32_t bits) noexcept {
+  uint32_t remaining_bits = bits;
+  while (remaining_bits != 0) {
+    int bit = __builtin_ctz(remaining_bits);
+    remaining_bits &= ~(1u << bit);
+
+    //find link in callback list, and move it back to the free list
+    uint16_t* next_p = this->event_list_heads + bit;
+    while (*next_p != EVENT_INDEX_NONE) {
+      uint16_t link = *next_p;
+      if (_event_links[link].registration == index) {
+        *next_p = _event_links[link].next;
+        _event_links[link].registration = EVENT_INDEX_NONE;
+        _event_links[link].next = _event_free_link_head;
+        _event_free_link_head = link;
+        _event_free_link_count++;
+        break;
+      }
+      next_p = &_event_links[link].next;
+    }
+  }
+}
+
+//removes the given registration right away, or once running callbacks are done - assumes disabled interrupts
+void EventSource::RemoveRegistration(uint16_t index) noexcept {
+  EventCallbackRegistration& reg = _event_registrations[index];
+
+  if (this->dispatch_depth > 0) {
+    //callbacks running (possibly this one): only mark for removal
+    reg.removed = true;
+    this->dispatch_cleanup_pending = true;
+    return;
+  }
+
+  this->UnlinkRegistration(index, reg.event_mask);
+  reg.func = EventCallback();
+  reg.source = NULL;
+  reg.used = false;
+  reg.removed = false;
+  reg.added = false;
+}
+
+void EventSource::BeginDispatch() noexcept {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  this->dispatch_depth++;
+  __set_PRIMASK(primask);
+}
+
+//finishes a callback execution - once none are running anymore, applies registration changes made in the meantime
+void EventSource::EndDispatch() noexcept {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (--this->dispatch_depth == 0 && this->dispatch_cleanup_pending) {
+    this->dispatch_cleanup_pending = false;
+    for (uint16_t i = 0; i < EVENT_MAX_REGISTRATIONS; i++) {
+      EventCallbackRegistration& reg = _event_registrations[i];
+      if (!reg.used || reg.source != this) {
+        continue;
+      }
+      if (reg.removed) {
+        this->RemoveRegistration(i);
+      } else {
+        reg.added = false;
+      }
+    }
+  }
+  __set_PRIMASK(primask);
+}
@@ -0,0 +1,165 @@
+/*
+ * operation_queue.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ */
+
+
+#include "operation_queue.h"
+#include "system.h"
+
+
+//combines two callbacks into one, which calls both with the same result
+static SuccessCallback _OperationQueue_ChainCallbacks(SuccessCallback&& first, SuccessCallback&& second) {
+  if (!first) {
+    return std::move(second);
+  } else if (!second) {
+    return std::move(first);
+  }
+
+  return [first = std::move(first), second = std::move(second)](bool success) {
+    first(success);
+    second(success);
+  };
+}
+
+
+OperationQueue::OperationQueue(const char* name) : name(name), lock_timer(0), starting(false) {}
+
+
+bool OperationQueue::TryLock(uint32_t timeout_cycles) noexcept {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (this->lock_timer > 0) {
+    __set_PRIMASK(primask);
+    return false;
+  }
+
+  this->lock_timer = timeout_cycles;
+  __set_PRIMASK(primask);
+  return true;
+}
+
+void OperationQueue::Unlock() noexcept {
+  this->lock_timer = 0;
+
+  //start next operation right away, instead of waiting for the next loop cycle
+  this->StartNext();
+}
+
+void OperationQueue::Unlock(const SuccessCallback& callback, bool success) {
+  this->lock_timer = 0;
+
+  //completion first, so its reaction to the result (and any follow-up operation it starts) comes before the next queued operation
+  if (callback) {
+    try {
+      callback(success);
+    } catch (...) {
+      //still start the next operation, then propagate to the caller
+      this->StartNext();
+      throw;
+    }
+  }
+
+  this->StartNext();
+}
+
+void OperationQueue::ResetLock() noexcept {
+  this->lock_timer = 0;
+}
+
+bool OperationQueue::IsLocked() const noexcept {
+  return this->lock_timer > 0;
+}
+
+
+void OperationQueue::Push(OperationKind kind, QueuedOperation&& operation, SuccessCallback&& callback) {
+  if (!operation) {
+    throw std::invalid_argument("OperationQueue Push requires a non-empty operation");
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (kind != OP_KIND_NONE) {
+    //supersede queued operation of the same kind, if any (there can be at most one), taking over its callback
+    for (auto i = this->queue.begin(); i < this->queue.end(); i++) {
+      if (i->kind == kind) {
+        //replaced in place, so the superseding operation keeps the queue position of the superseded one
+        i->callback = _OperationQueue_ChainCallbacks(std::move(i->callback), std::move(callback));
+        i->operation = std::move(operation);
+        __set_PRIMASK(primask);
+        return;
+      }
+    }
+  }
+
+  this->queue.push_back({ kind, std::move(operation), std::move(callback) });
+  __set_PRIMASK(primask);
+}
+
+
+void OperationQueue::LoopTasks() noexcept {
+  //decrement lock timer, under disabled interrupts
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (this->lock_timer > 0) {
+    if (--this->lock_timer == 0) {
+      //shouldn't really ever happen, it means an unlock somewhere was missed or delayed excessively
+      DEBUG_LOG(DEBUG_WARNING, "%s lock timed out!", this->name);
+    }
+  }
+  __set_PRIMASK(primask);
+
+  this->StartNext();
+}
+
+
+void OperationQueue::StartNext() noexcept {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (this->starting) {
+    //already starting operations further up the call stack (operation finished synchronously): next one is started there
+    __set_PRIMASK(primask);
+    return;
+  }
+  this->starting = true;
+
+  //start queued operations until one keeps the lock (i.e. runs asynchronously) or the queue is empty
+  while (this->lock_timer == 0 && !this->queue.empty()) {
+    QueuedOperationEntry entry = std::move(this->queue.front());
+    this->queue.pop_front();
+
+    //start operation outside of the critical section - it takes the lock itself, and is re-queued if something else took it in the meantime
+    __set_PRIMASK(primask);
+    //the operation gets a copy of the callback, so the entry's callback is still intact to report a start failure
+    try {
+      entry.operation(SuccessCallback(entry.callback));
+    } catch (const std::exception& err) {
+      DEBUG_LOG(DEBUG_ERROR, "%s queued operation failed to start: %s", this->name, err.what());
+      this->FailCallback(entry.callback);
+    } catch (...) {
+      DEBUG_LOG(DEBUG_ERROR, "%s queued operation failed to start", this->name);
+      this->FailCallback(entry.callback);
+    }
+    __disable_irq();
+  }
+
+  this->starting = false;
+  __set_PRIMASK(primask);
+}
+
+
+void OperationQueue::FailCallback(const SuccessCallback& callback) noexcept {
+  if (!callback) {
+    return;
+  }
+
+  try {
+    callback(false);
+  } catch (const std::exception& err) {
+    DEBUG_LOG(DEBUG_ERROR, "%s queued operation failure callback threw: %s", this->name, err.what());
+  } catch (...) {
+    DEBUG_LOG(DEBUG_ERROR, "%s queued operation failure callback threw", this->name);
+  }
+}
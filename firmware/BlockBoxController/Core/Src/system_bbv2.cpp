@@ -467,6 +467,8 @@ void BlockBoxV2System::LoopTasks() {
   this->power_mgr.LoopTasks();
   this->led_mgr.LoopTasks();
 
+  EventSource::DeliverDeferredEvents();
+
   this->gui_mgr.Update();
 }
 
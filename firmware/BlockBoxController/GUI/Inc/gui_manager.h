@@ -63,6 +63,7 @@ public:
 
   const GUITouchState& GetTouchState() const noexcept;
 
+  GUIScreen* GetCurrentScreen() const noexcept;
   void SetScreen(GUIScreen* screen);
 
   void SendCmdTransferWhenNotBusy(const uint32_t* data, uint32_t length_words);
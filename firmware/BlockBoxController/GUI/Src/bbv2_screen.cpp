@@ -299,7 +299,8 @@ void BlockBoxV2Screen::DrawPopupOverlay() {
       strncpy(popup_title, "Amplifier Safety Error", 63);
       strncpy(popup_info, "Tap to return to standby", 63);
       PowerAmpErrWarnSource source = this->bbv2_manager.system.amp_if.GetSafetyErrorSource();
-      snprintf(popup_detail, 63, "Type:%s%s%s%s%s%s%s%s%s, Source:%s%s%s%s%s",
+      snprintf(popup_detail, 63, "Type:%s%s%s%s%s%s%s%s%s%s, Source:%s%s%s%s%s",
+               source.current_peak ? " Ip" : "",
                source.current_rms_instantaneous ? " Ii" : "",
                source.current_rms_fast ? " If" : "",
                source.current_rms_slow ? " Is" : "",
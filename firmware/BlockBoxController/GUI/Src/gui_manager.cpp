@@ -254,6 +254,11 @@ const GUITouchState& GUIManager::GetTouchState() const noexcept {
 }
 
 
+GUIScreen* GUIManager::GetCurrentScreen() const noexcept {
+  return this->current_screen;
+}
+
+
 void GUIManager::SetScreen(GUIScreen* screen) {
   if (screen == NULL) {
     throw std::invalid_argument("GUIManager SetScreen given null pointer");
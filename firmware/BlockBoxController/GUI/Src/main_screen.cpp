@@ -173,13 +173,13 @@ void MainScreen::HandleTouch(const GUITouchState& state) noexcept {
           }
           break;
         case SCREEN_MAIN_TAG_VOL_DOWN:
-          //step volume down, if not muted and not long pressed
+          //step volume down (queued if busy), if not muted and not long pressed
           if (!audio_mute && !state.long_press) {
             this->bbv2_manager.system.audio_mgr.StepCurrentVolumeDB(false, [](bool success) {
               if (!success) {
                 DEBUG_LOG(DEBUG_WARNING, "MainScreen volume decrease failed");
               }
-            });
+            }, true);
           }
           break;
         case SCREEN_MAIN_TAG_MUTE_UNMUTE:
@@ -191,13 +191,13 @@ void MainScreen::HandleTouch(const GUITouchState& state) noexcept {
           });
           break;
         case SCREEN_MAIN_TAG_VOL_UP:
-          //step volume up, if not muted and not long pressed
+          //step volume up (queued if busy), if not muted and not long pressed
           if (!audio_mute && !state.long_press) {
             this->bbv2_manager.system.audio_mgr.StepCurrentVolumeDB(true, [](bool success) {
               if (!success) {
                 DEBUG_LOG(DEBUG_WARNING, "MainScreen volume increase failed");
               }
-            });
+            }, true);
           }
           break;
         case SCREEN_MAIN_TAG_BLUETOOTH:
@@ -265,7 +265,7 @@ void MainScreen::HandleTouch(const GUITouchState& state) noexcept {
           if (!success) {
             DEBUG_LOG(DEBUG_WARNING, "MainScreen volume hold decrease failed");
           }
-        });
+        }, true);
         break;
       case SCREEN_MAIN_TAG_VOL_UP:
         //step volume up
@@ -273,7 +273,7 @@ void MainScreen::HandleTouch(const GUITouchState& state) noexcept {
           if (!success) {
             DEBUG_LOG(DEBUG_WARNING, "MainScreen volume hold increase failed");
           }
-        });
+        }, true);
         break;
       default:
         break;
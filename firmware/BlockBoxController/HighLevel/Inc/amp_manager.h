@@ -11,6 +11,7 @@
 
 #include "cpp_main.h"
 #include "event_source.h"
+#include "operation_queue.h"
 #include "power_amp_interface.h"
 
 
@@ -41,7 +42,10 @@
 #ifdef __cplusplus
 
 
-#include <deque>
+//queued operation kinds, for coalescing (only the latest queued operation of each kind is executed)
+typedef enum {
+  AMP_OP_WARNING_LIMIT_FACTOR = 1
+} AmpOperationKind;
 
 
 class BlockBoxV2System;
@@ -66,14 +70,16 @@ public:
 protected:
   bool initialised;
   bool callbacks_registered;
-  uint32_t lock_timer;
-  std::deque<QueuedOperation> queued_operations;
+  OperationQueue operations;
 
   uint32_t pvdd_lock_timer;
   uint32_t clip_lock_timer;
   uint32_t otw_lock_timer;
   uint32_t warn_lock_timer;
 
+  //PVDD envelope (PVDD required by the DAP output envelope, slowly released), in volts
+  float pvdd_envelope;
+
   float warning_limit_factor;
   PowerAmpThresholdSet warning_limits_irms;
   PowerAmpThresholdSet warning_limits_pavg;
@@ -85,9 +91,12 @@ protected:
 
   void ApplyNewPVDDTarget(float pvdd_volts, SuccessCallback&& callback);
   void UpdatePVDDForVolume(float volume_dB, SuccessCallback&& callback);
+  void UpdatePVDDEnvelope(float output_peak);
 
   void UpdateWarningLimits(float factor, SuccessCallback&& callback);
 
+  void UpdateSpeakerProtection();
+
   void HandleClipping(SuccessCallback&& callback);
   void ReduceVolume(SuccessCallback&& callback);
 
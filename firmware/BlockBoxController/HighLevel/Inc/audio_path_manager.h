@@ -11,6 +11,7 @@
 
 #include "cpp_main.h"
 #include "event_source.h"
+#include "operation_queue.h"
 #include "storage.h"
 #include "dap_interface.h"
 #include "math.h"
@@ -31,6 +32,7 @@
 #define AUDIO_LIMIT_VOLUME_STEP_MAX 5.0f
 #define AUDIO_LIMIT_LOUDNESS_GAIN_MIN_ACTIVE -30.0f
 #define AUDIO_LIMIT_LOUDNESS_GAIN_MAX IF_DAP_LOUDNESS_GAIN_MAX
+#define AUDIO_LIMIT_PROTECTION_REDUCTION_MIN -20.0f
 
 //audio path setting lock timeout, in main loop cycles
 #define AUDIO_LOCK_TIMEOUT_CYCLES (500 / MAIN_LOOP_PERIOD_MS)
@@ -44,9 +46,6 @@
 #ifdef __cplusplus
 
 
-#include <deque>
-
-
 typedef enum {
   AUDIO_INPUT_NONE = IF_DAP_INPUT_NONE,
   AUDIO_INPUT_BLUETOOTH = IF_DAP_INPUT_I2S1,
@@ -71,6 +70,50 @@ typedef enum {
 } AudioPathCalibrationMode;
 
 
+//queued operation kinds, for coalescing (only the latest queued operation of each kind is executed)
+typedef enum {
+  AUDIO_OP_ACTIVE_INPUT = 1,
+  AUDIO_OP_VOLUME,
+  AUDIO_OP_MIN_VOLUME,
+  AUDIO_OP_MAX_VOLUME,
+  AUDIO_OP_VOLUME_STEP,
+  AUDIO_OP_POSITIVE_GAIN,
+  AUDIO_OP_MUTE,
+  AUDIO_OP_LOUDNESS_GAIN,
+  AUDIO_OP_LOUDNESS_TRACKING,
+  AUDIO_OP_MIXER_MODE,
+  AUDIO_OP_EQ_MODE,
+  AUDIO_OP_CALIBRATION_MODE,
+  AUDIO_OP_PROTECTION_REDUCTION
+} AudioPathOperationKind;
+
+
+//how the DAC and DAP gains of a volume change are applied, based on the directions of their changes
+typedef enum {
+  //DAC and DAP gains are already correct: nothing to do
+  AUDIO_GAIN_PLAN_NONE,
+  //only one of them changes, or both change in the same direction: write both at once (any intermediate total gain is between old and new)
+  AUDIO_GAIN_PLAN_CONCURRENT,
+  //DAC decreases, DAP increases: write both at once, with the DAP change delayed until the DAC change is surely applied
+  AUDIO_GAIN_PLAN_DAP_DELAYED,
+  //DAC increases, DAP decreases: DAC changes can't be delayed, so write DAP first, then DAC
+  AUDIO_GAIN_PLAN_DAP_FIRST
+} AudioGainPlanMode;
+
+//planned DAC and DAP gains of a volume change, along with the previous gains (for restoring after failures)
+typedef struct {
+  AudioGainPlanMode mode;
+  bool dac_change;
+  bool dap_change;
+  float dac_gain_ch1;
+  float dac_gain_ch2;
+  DAPGains dap_gains;
+  float prev_dac_gain_ch1;
+  float prev_dac_gain_ch2;
+  DAPGains prev_dap_gains;
+} AudioGainPlan;
+
+
 class BlockBoxV2System;
 
 
@@ -135,14 +178,18 @@ public:
   void SetEQMode(AudioPathEQMode mode, SuccessCallback&& callback, bool queue_if_busy = false);
   void SetCalibrationMode(AudioPathCalibrationMode mode, SuccessCallback&& callback, bool queue_if_busy = false);
 
+  //speaker protection gain reduction functions (per DAP channel, 0 or negative, applied on top of the volume)
+  DAPGains GetProtectionGainReduction() const;
+
+  void SetProtectionGainReduction(DAPGains reduction_dB, SuccessCallback&& callback, bool queue_if_busy = false);
+
   //TODO if desired: bass/treble
 
 protected:
   StorageSection non_volatile_config;
 
   bool initialised;
-  uint32_t lock_timer;
-  std::deque<QueuedOperation> queued_operations;
+  OperationQueue operations;
 
   uint32_t bluetooth_volume_lock_timer;
   bool bluetooth_previously_connected;
@@ -150,6 +197,10 @@ protected:
   AudioPathInput persistent_active_input;
 
   float current_volume_dB;
+  //most recently requested volume while a volume change is running or queued (NaN otherwise) - base for relative volume changes
+  float target_volume_dB;
+
+  DAPGains protection_gain_reduction;
 
   float min_volume_dB;
   float max_volume_dB;
@@ -167,6 +218,8 @@ protected:
   void CheckAndFixVolumeLimits();
   void CheckAndFixVolumeStep();
   void ClampAndApplyVolumeGain(float desired_gain_dB, SuccessCallback&& callback);
+  AudioGainPlan PlanVolumeGains(float volume_gain_dB) const;
+  void ApplyGainPlan(const AudioGainPlan& plan, SuccessCallback&& callback);
 
   void UpdateBluetoothVolume();
   void UpdateVolumeFromBluetooth();
@@ -11,6 +11,7 @@
 
 #include "cpp_main.h"
 #include "event_source.h"
+#include "operation_queue.h"
 #include "storage.h"
 #include "charger_interface.h"
 
@@ -36,6 +37,9 @@
 #define PWR_ASD_DELAY_MS_MIN 60000u
 #define PWR_ASD_DELAY_MS_MAX HAL_MAX_DELAY
 
+//number of bins of the battery time estimation load history (discharge power histogram)
+#define PWR_BAT_TIME_HIST_BINS 16
+
 
 //charging target state-of-charge steps (approximate percentages)
 typedef enum {
@@ -49,11 +53,23 @@ typedef enum {
   _PWR_CHG_TARGET_COUNT
 } PowerChargingTargetState;
 
+//battery time estimate: expected remaining time and its confidence bounds, in seconds - all 0 if no estimate is available
+typedef struct {
+  uint32_t time_sec;
+  uint32_t time_min_sec;
+  uint32_t time_max_sec;
+} PowerBatteryTimeEstimate;
+
 
 #ifdef __cplusplus
 
 
-#include <deque>
+//queued operation kinds, for coalescing (only the latest queued operation of each kind is executed)
+typedef enum {
+  PWR_OP_ADAPTER_CURRENT = 1,
+  PWR_OP_CHARGING_TARGET_STATE,
+  PWR_OP_CHARGING_TARGET_CURRENT
+} PowerOperationKind;
 
 
 class BlockBoxV2System;
@@ -90,6 +106,7 @@ public:
   void ResetAutoShutdownTimer();
 
   //battery time estimation functions
+  PowerBatteryTimeEstimate GetBatteryTimeEstimate() const;
   uint32_t GetEstimatedBatteryTimeSeconds() const;
 
   //TODO: battery learn mode?
@@ -98,8 +115,7 @@ protected:
   StorageSection non_volatile_config;
 
   bool initialised;
-  uint32_t lock_timer;
-  std::deque<QueuedOperation> queued_operations;
+  OperationQueue operations;
 
   uint32_t asd_lock_timer;
 
@@ -108,8 +124,18 @@ protected:
 
   uint32_t auto_shutdown_last_reset;
 
-  float inst_discharge_power_W;
-  float avg_discharge_power_W;
+  //battery time estimation: fast average (60s EMA) and load history (decaying histogram of 1-minute average discharge power)
+  float fast_discharge_power_W;
+  uint32_t discharge_cycles;
+  //main loop cycles with charge current since the last discharge, for the reset on sustained charging
+  uint32_t charge_cycles;
+  float hist_entry_power_sum;
+  uint32_t hist_entry_cycles;
+  float hist_weights[PWR_BAT_TIME_HIST_BINS];
+  float hist_power_sums[PWR_BAT_TIME_HIST_BINS];
+  //volume and PVDD target the load history currently applies to
+  float hist_volume_dB;
+  float hist_pvdd_V;
 
 
   static void LoadNonVolatileConfigDefaults(StorageSection& section);
@@ -118,6 +144,10 @@ protected:
 
   uint16_t GetChargingTargetCurrentMA() const;
 
+  void ResetBatteryTimeEstimation();
+  void UpdateBatteryTimeEstimation(float power_W);
+  float GetLoadHistoryPercentile(float fraction, float total_weight) const;
+
   //void HandleEvent(EventSource* source, uint32_t event);
 };
 
@@ -21,6 +21,19 @@
 #define AMP_PVDD_LOWERING_HYST 1.2f
 //PVDD clipping increase factor: multiply PVDD target by this factor when detecting clipping
 #define AMP_PVDD_CLIPPING_INCREASE 1.1f
+//PVDD envelope tracking: lower PVDD below the volume-based target when the DAP look-ahead output envelope allows it (see design_simulations/pvdd_tracking_python)
+//the envelope covers the audio in the DAP output delay, and its rises are read on interrupt, so PVDD rises ahead of the louder audio
+//headroom factor of the envelope-based PVDD over the PVDD required by the output envelope
+#define AMP_PVDD_ENVELOPE_MARGIN 1.1f
+//extra headroom factor when raising the envelope, to avoid frequent small increases (each one locks out the module's PVDD fail checks for a while)
+#define AMP_PVDD_ENVELOPE_RAISE_HEADROOM 1.15f
+//envelope release factor per output level update - slow release, the actual lowering is further limited by the lowering hysteresis and lock
+#define AMP_PVDD_ENVELOPE_RELEASE 0.95f
+//minimum envelope-based PVDD target, as fraction of the volume-based target - limits the headroom deficit on sudden loud onsets
+#define AMP_PVDD_ENVELOPE_FLOOR 0.7f
+
+//speaker protection: granularity of the forwarded gain reduction in dB, to avoid excessive volume updates
+#define AMP_SPEAKER_REDUCTION_STEP_DB 0.5f
 
 //default warning limit factor
 #define AMP_WARNING_FACTOR_DEFAULT 0.8f
@@ -60,9 +73,21 @@ static const PowerAmpThresholdSet _amp_warning_base_limits_papp = { //apparent p
   { INFINITY, INFINITY, INFINITY, INFINITY, INFINITY }, //slow (1s)
 };
 
+//Speaker thermal model configuration (A/B = woofer, C/D = tweeter); estimated from typical driver data, to be calibrated with voice coil resistance measurements
+static const PowerAmpSpeakerModelParams _amp_speaker_model_params = {
+  { 0.6f, 0.6f, 1.2f, 1.2f }, //voice coil thermal resistance (K/W)
+  { 10.0f, 10.0f, 5.0f, 5.0f }, //voice coil time constant (s)
+  { 0.9f, 0.9f, 1.8f, 1.8f }, //magnet/frame thermal resistance (K/W)
+  { 600.0f, 600.0f, 400.0f, 400.0f }, //magnet/frame time constant (s)
+  { 150.0f, 150.0f, 150.0f, 150.0f }, //maximum voice coil temperature rise (K)
+};
+
 
 static_assert(AMP_PVDD_LOWERING_HYST > 1.0f);
 static_assert(AMP_PVDD_CLIPPING_INCREASE > 1.0f);
+static_assert(AMP_PVDD_ENVELOPE_MARGIN >= 1.0f && AMP_PVDD_ENVELOPE_RAISE_HEADROOM >= 1.0f);
+static_assert(AMP_PVDD_ENVELOPE_RELEASE > 0.0f && AMP_PVDD_ENVELOPE_RELEASE < 1.0f);
+static_assert(AMP_PVDD_ENVELOPE_FLOOR > 0.0f && AMP_PVDD_ENVELOPE_FLOOR <= 1.0f);
 static_assert(AMP_WARNING_FACTOR_DEFAULT >= AMP_WARNING_FACTOR_MIN && AMP_WARNING_FACTOR_DEFAULT <= AMP_WARNING_FACTOR_MAX);
 
 
@@ -71,17 +96,18 @@ static_assert(AMP_WARNING_FACTOR_DEFAULT >= AMP_WARNING_FACTOR_MIN && AMP_WARNIN
 /******************************************************/
 
 AmpManager::AmpManager(BlockBoxV2System& system) :
-    system(system), initialised(false), callbacks_registered(false), lock_timer(0), pvdd_lock_timer(0), clip_lock_timer(0), otw_lock_timer(0), warn_lock_timer(0),
-    warning_limit_factor(AMP_WARNING_FACTOR_DEFAULT), prev_amp_fault(false), prev_pvdd_fault(false), prev_safety_error(0) {}
+    system(system), initialised(false), callbacks_registered(false), operations("AmpManager"), pvdd_lock_timer(0), clip_lock_timer(0), otw_lock_timer(0), warn_lock_timer(0),
+    pvdd_envelope(IF_POWERAMP_PVDD_TARGET_MAX), warning_limit_factor(AMP_WARNING_FACTOR_DEFAULT), prev_amp_fault(false), prev_pvdd_fault(false), prev_safety_error(0) {}
 
 
 void AmpManager::Init(SuccessCallback&& callback) {
   this->initialised = false;
-  this->lock_timer = 0;
+  this->operations.ResetLock();
   this->pvdd_lock_timer = 0;
   this->clip_lock_timer = 0;
   this->otw_lock_timer = 0;
   this->warn_lock_timer = 0;
+  this->pvdd_envelope = IF_POWERAMP_PVDD_TARGET_MAX;
   this->warning_limit_factor = AMP_WARNING_FACTOR_DEFAULT;
   this->prev_amp_fault = false;
   this->prev_pvdd_fault = false;
@@ -142,28 +168,47 @@ void AmpManager::Init(SuccessCallback&& callback) {
               return;
             }
 
-            //write safety warning limits - RMS current and average power, scaled according to default factor
-            this->UpdateWarningLimits(AMP_WARNING_FACTOR_DEFAULT, [this, callback = std::move(callback)](bool success) {
-              if (success) {
-                if (!this->callbacks_registered) {
-                  //register event callbacks
-                  this->system.amp_if.RegisterCallback(std::bind(&AmpManager::HandleEvent, this, std::placeholders::_1, std::placeholders::_2),
-                                                       MODIF_EVENT_MODULE_RESET | MODIF_POWERAMP_EVENT_STATUS_UPDATE | MODIF_POWERAMP_EVENT_SAFETY_UPDATE);
-                  this->system.audio_mgr.RegisterCallback(std::bind(&AmpManager::HandleEvent, this, std::placeholders::_1, std::placeholders::_2),
-                                                          AUDIO_EVENT_VOLUME_UPDATE);
-                  this->callbacks_registered = true;
+            //write speaker thermal model parameters
+            this->system.amp_if.SetSpeakerModelParams(&_amp_speaker_model_params, [this, callback = std::move(callback)](bool success) {
+              if (!success) {
+                //propagate failure to external callback
+                DEBUG_LOG(DEBUG_ERROR, "AmpManager Init failed to set speaker model parameters");
+                if (callback) {
+                  callback(false);
                 }
-
-                //init done
-                this->initialised = true;
-              } else {
-                DEBUG_LOG(DEBUG_ERROR, "AmpManager Init failed to set initial Irms and Pavg warning thresholds");
+                return;
               }
 
-              //propagate success to external callback
-              if (callback) {
-                callback(success);
-              }
+              //write safety warning limits - RMS current and average power, scaled according to default factor
+              this->UpdateWarningLimits(AMP_WARNING_FACTOR_DEFAULT, [this, callback = std::move(callback)](bool success) {
+                if (success) {
+                  if (!this->callbacks_registered) {
+                    //register event callbacks
+                    this->system.amp_if.RegisterCallback(std::bind(&AmpManager::HandleEvent, this, std::placeholders::_1, std::placeholders::_2),
+                                                         MODIF_EVENT_MODULE_RESET | MODIF_POWERAMP_EVENT_STATUS_UPDATE | MODIF_POWERAMP_EVENT_SAFETY_UPDATE |
+                                                         MODIF_POWERAMP_EVENT_SPEAKER_UPDATE);
+                    this->system.audio_mgr.RegisterCallback(std::bind(&AmpManager::HandleEvent, this, std::placeholders::_1, std::placeholders::_2),
+                                                            AUDIO_EVENT_VOLUME_UPDATE);
+                    this->system.dap_if.RegisterCallback(std::bind(&AmpManager::HandleEvent, this, std::placeholders::_1, std::placeholders::_2),
+                                                         MODIF_DAP_EVENT_OUTPUT_PEAKS_UPDATE);
+                    this->callbacks_registered = true;
+                  }
+
+                  //start output level monitoring for PVDD envelope tracking, and speaker model monitoring for speaker protection
+                  this->system.dap_if.monitor_output_peaks = true;
+                  this->system.amp_if.monitor_speaker_model = true;
+
+                  //init done
+                  this->initialised = true;
+                } else {
+                  DEBUG_LOG(DEBUG_ERROR, "AmpManager Init failed to set initial Irms and Pavg warning thresholds");
+                }
+
+                //propagate success to external callback
+                if (callback) {
+                  callback(success);
+                }
+              });
             });
           });
         });
@@ -205,42 +250,25 @@ void AmpManager::LoopTasks() {
   if (this->warn_lock_timer > 0) {
     this->warn_lock_timer--;
   }
-
-  if (this->lock_timer > 0) {
-    if (--this->lock_timer == 0) {
-      //shouldn't really ever happen, it means an unlock somewhere was missed or delayed excessively
-      DEBUG_LOG(DEBUG_WARNING, "AmpManager lock timed out!");
-    }
-  }
-
-  //if not locked, check for queued operations
-  if (this->lock_timer == 0 && !this->queued_operations.empty()) {
-    //have queued operation: remove from queue, lock again
-    QueuedOperation op = std::move(this->queued_operations.front());
-    this->queued_operations.pop_front();
-    //begin operation under disabled interrupts
-    if (op) {
-      op();
-    }
-  }
   __set_PRIMASK(primask);
+
+  //operation lock timeout, and start of queued operations if not started on unlock
+  this->operations.LoopTasks();
 }
 
 
 void AmpManager::HandlePowerStateChange(bool on, SuccessCallback&& callback) {
   uint32_t primask = __get_PRIMASK();
   __disable_irq();
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AMP_LOCK_TIMEOUT_CYCLES)) {
     //locked out: queue for later execution
-    this->queued_operations.push_back([this, on, callback = std::move(callback)]() mutable {
+    this->operations.Push(OP_KIND_NONE, [this, on](SuccessCallback&& callback) {
       this->HandlePowerStateChange(on, std::move(callback));
-    });
+    }, std::move(callback));
     __set_PRIMASK(primask);
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AMP_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   //set amp manual shutdown according to state
@@ -256,10 +284,7 @@ void AmpManager::HandlePowerStateChange(bool on, SuccessCallback&& callback) {
       }
 
       //once done: unlock operations and propagate success (true = all succeeded, false otherwise) to external callback
-      this->lock_timer = 0;
-      if (callback) {
-        callback(prev_success && success);
-      }
+      this->operations.Unlock(callback, prev_success && success);
     };
 
     //continue regardless of success: set PVDD according to state
@@ -302,6 +327,13 @@ void AmpManager::HandleEvent(EventSource* source, uint32_t event) {
   if (source == &this->system.audio_mgr) {
     //handle volume change event: update PVDD target
     this->UpdatePVDDForVolume(this->system.audio_mgr.GetCurrentVolumeDB(), SuccessCallback());
+  } else if (source == &this->system.dap_if) {
+    //handle output level update: update PVDD envelope from the DAP look-ahead envelope, then PVDD target
+    DAPLevels envelope = this->system.dap_if.GetOutputEnvelopeLevels();
+    this->UpdatePVDDEnvelope(MAX(envelope.ch1, envelope.ch2));
+    if (this->system.IsPoweredOn()) {
+      this->UpdatePVDDForVolume(this->system.audio_mgr.GetCurrentVolumeDB(), SuccessCallback());
+    }
   } else {
     //handle amp module events
     switch (event) {
@@ -400,6 +432,10 @@ void AmpManager::HandleEvent(EventSource* source, uint32_t event) {
         }
         break;
       }
+      case MODIF_POWERAMP_EVENT_SPEAKER_UPDATE:
+        //speaker model update: forward gain reduction requests to the audio path
+        this->UpdateSpeakerProtection();
+        break;
       case MODIF_POWERAMP_EVENT_SAFETY_UPDATE:
       {
         //safety update: just check for safety error shutdown (warnings handled in status update above)
@@ -425,6 +461,43 @@ void AmpManager::HandleEvent(EventSource* source, uint32_t event) {
 }
 
 
+/******************************************************/
+/*               Speaker Protection                   */
+/******************************************************/
+
+void AmpManager::UpdateSpeakerProtection() {
+  if (!this->system.IsPoweredOn()) {
+    return;
+  }
+
+  //gain reduction per DAP channel: strongest request of the corresponding amp channels (DAP ch1 = tweeter = C/D, ch2 = woofer = A/B)
+  PowerAmpChannelValues amp_reduction = this->system.amp_if.GetSpeakerGainReduction();
+  DAPGains reduction;
+  reduction.ch1 = MIN(amp_reduction.ch_c, amp_reduction.ch_d);
+  reduction.ch2 = MIN(amp_reduction.ch_a, amp_reduction.ch_b);
+  if (isnanf(reduction.ch1) || isnanf(reduction.ch2)) {
+    return;
+  }
+
+  //quantise to reduction steps, rounding towards stronger reduction
+  reduction.ch1 = floorf(reduction.ch1 / AMP_SPEAKER_REDUCTION_STEP_DB) * AMP_SPEAKER_REDUCTION_STEP_DB;
+  reduction.ch2 = floorf(reduction.ch2 / AMP_SPEAKER_REDUCTION_STEP_DB) * AMP_SPEAKER_REDUCTION_STEP_DB;
+
+  //only forward changes
+  DAPGains current_reduction = this->system.audio_mgr.GetProtectionGainReduction();
+  if (reduction.ch1 == current_reduction.ch1 && reduction.ch2 == current_reduction.ch2) {
+    return;
+  }
+
+  //not queued if busy: the next speaker model update retries anyway
+  this->system.audio_mgr.SetProtectionGainReduction(reduction, [reduction](bool success) {
+    if (success) {
+      DEBUG_LOG(DEBUG_INFO, "AmpManager speaker protection gain reduction now %.1f / %.1f dB", reduction.ch1, reduction.ch2);
+    }
+  });
+}
+
+
 /******************************************************/
 /*                  PVDD Handling                     */
 /******************************************************/
@@ -463,6 +536,11 @@ void AmpManager::UpdatePVDDForVolume(float volume_dB, SuccessCallback&& callback
 
   //calculate desired PVDD voltage, based on difference between volume and max-pvdd threshold (accounting for dB scale)
   float desired_pvdd = IF_POWERAMP_PVDD_TARGET_MAX * powf(10.0f, (volume_dB - AMP_PVDD_MAX_VOLUME_DB) / 20.0f);
+  //envelope tracking: go lower if the recent output peaks allow it, down to the envelope floor
+  float envelope_pvdd = MAX(this->pvdd_envelope, desired_pvdd * AMP_PVDD_ENVELOPE_FLOOR);
+  if (envelope_pvdd < desired_pvdd) {
+    desired_pvdd = envelope_pvdd;
+  }
   //clamp to valid PVDD target range
   if (desired_pvdd < IF_POWERAMP_PVDD_TARGET_MIN) {
     desired_pvdd = IF_POWERAMP_PVDD_TARGET_MIN;
@@ -474,6 +552,28 @@ void AmpManager::UpdatePVDDForVolume(float volume_dB, SuccessCallback&& callback
   this->ApplyNewPVDDTarget(desired_pvdd, std::move(callback));
 }
 
+void AmpManager::UpdatePVDDEnvelope(float output_peak) {
+  if (isnanf(output_peak) || output_peak < 0.0f) {
+    return;
+  }
+
+  //PVDD required for the given peak/envelope (post-volume output level, so max-pvdd threshold applies directly) plus margin
+  float required_pvdd = IF_POWERAMP_PVDD_TARGET_MAX * output_peak * powf(10.0f, -AMP_PVDD_MAX_VOLUME_DB / 20.0f) * AMP_PVDD_ENVELOPE_MARGIN;
+
+  if (required_pvdd > this->pvdd_envelope) {
+    //attack: raise immediately, with extra headroom
+    this->pvdd_envelope = required_pvdd * AMP_PVDD_ENVELOPE_RAISE_HEADROOM;
+  } else {
+    //release: decay slowly towards the required level
+    this->pvdd_envelope = MAX(required_pvdd, this->pvdd_envelope * AMP_PVDD_ENVELOPE_RELEASE);
+  }
+
+  //envelope above max target is meaningless - limit to keep release time bounded
+  if (this->pvdd_envelope > IF_POWERAMP_PVDD_TARGET_MAX) {
+    this->pvdd_envelope = IF_POWERAMP_PVDD_TARGET_MAX;
+  }
+}
+
 
 /******************************************************/
 /*              Limit & Safety Handling               */
@@ -550,12 +650,12 @@ void AmpManager::SetWarningLimitFactor(float limit_factor, SuccessCallback&& cal
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AMP_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, limit_factor, callback = std::move(callback)]() mutable {
-        this->SetWarningLimitFactor(limit_factor, std::move(callback), false);
-      });
+      this->operations.Push(AMP_OP_WARNING_LIMIT_FACTOR, [this, limit_factor](SuccessCallback&& callback) {
+        this->SetWarningLimitFactor(limit_factor, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -566,16 +666,11 @@ void AmpManager::SetWarningLimitFactor(float limit_factor, SuccessCallback&& cal
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AMP_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (this->warning_limit_factor == limit_factor) {
     //already in desired state: unlock operations and propagate success to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //shut down amplifier first
     bool amp_was_on = !this->system.amp_if.IsManualShutdownActive();
@@ -583,10 +678,7 @@ void AmpManager::SetWarningLimitFactor(float limit_factor, SuccessCallback&& cal
       if (!success) {
         //propagate failure to external callback
         DEBUG_LOG(DEBUG_ERROR, "AmpManager SetWarningLimitFactor failed to set manual amp shutdown");
-        this->lock_timer = 0;
-        if (callback) {
-          callback(false);
-        }
+        this->operations.Unlock(callback, false);
         return;
       }
 
@@ -595,10 +687,7 @@ void AmpManager::SetWarningLimitFactor(float limit_factor, SuccessCallback&& cal
         if (!success) {
           //propagate failure to external callback
           DEBUG_LOG(DEBUG_ERROR, "AmpManager SetWarningLimitFactor failed to apply new limits");
-          this->lock_timer = 0;
-          if (callback) {
-            callback(false);
-          }
+          this->operations.Unlock(callback, false);
           return;
         }
 
@@ -610,17 +699,11 @@ void AmpManager::SetWarningLimitFactor(float limit_factor, SuccessCallback&& cal
             }
 
             //once done: unlock operations and propagate success to external callback
-            this->lock_timer = 0;
-            if (callback) {
-              callback(success);
-            }
+            this->operations.Unlock(callback, success);
           });
         } else {
           //no need to restart: done, unlock operations and propagate success to external callback
-          this->lock_timer = 0;
-          if (callback) {
-            callback(success);
-          }
+          this->operations.Unlock(callback, success);
         }
       });
     });
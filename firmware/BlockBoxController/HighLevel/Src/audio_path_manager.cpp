@@ -8,6 +8,7 @@
 
 #include "audio_path_manager.h"
 #include "system.h"
+#include <memory>
 
 
 /******************************************************/
@@ -41,6 +42,10 @@
 #define AUDIO_GAIN_OFFSET_DAP_CH1 0.0f
 #define AUDIO_GAIN_OFFSET_DAP_CH2 0.0f
 
+//delay of DAP gain increases that accompany a DAC gain decrease, in DAP output batches (1ms each at 96kHz)
+//covers the DAC module applying its new volume in its next main loop cycle (10ms), including the SPI transfer
+#define AUDIO_DAP_GAIN_DELAY_BATCHES 15
+
 //Bluetooth absolute volume offset (value) for non-muted min volume (in 0-127 range)
 #define AUDIO_BLUETOOTH_VOL_OFFSET 7
 //Bluetooth absolute volume margin (steps within 0-127 range) - volume changes of this size or more are sent to the device
@@ -115,7 +120,7 @@ static const DAPFIRSetup _audio_dap_fir_setup = { 0, 0 };
 
 
 //check validity of audio limits in accordance with DAP limits
-static_assert(AUDIO_LIMIT_MIN_VOLUME_MIN + MIN(AUDIO_GAIN_OFFSET_DAP_CH1, AUDIO_GAIN_OFFSET_DAP_CH2) >= IF_DAP_VOLUME_GAIN_MIN);
+static_assert(AUDIO_LIMIT_MIN_VOLUME_MIN + MIN(AUDIO_GAIN_OFFSET_DAP_CH1, AUDIO_GAIN_OFFSET_DAP_CH2) + AUDIO_LIMIT_PROTECTION_REDUCTION_MIN >= IF_DAP_VOLUME_GAIN_MIN);
 static_assert(AUDIO_LIMIT_MAX_VOLUME_MAX + MAX(AUDIO_GAIN_OFFSET_DAP_CH1, AUDIO_GAIN_OFFSET_DAP_CH2) <= IF_DAP_VOLUME_GAIN_MAX);
 //check that sufficient min-max range is always achievable with the given limits
 static_assert(AUDIO_LIMIT_MAX_VOLUME_MIN - AUDIO_LIMIT_MIN_VOLUME_MIN >= AUDIO_LIMIT_VOLUME_RANGE_MIN);
@@ -135,9 +140,9 @@ static_assert(roundf(AUDIO_DEFAULT_VOLUME_STEP_DB) == AUDIO_DEFAULT_VOLUME_STEP_
 /******************************************************/
 
 AudioPathManager::AudioPathManager(BlockBoxV2System& system) :
-    system(system), non_volatile_config(system.eeprom_if, AUDIO_NVM_TOTAL_BYTES, AudioPathManager::LoadNonVolatileConfigDefaults), initialised(false), lock_timer(0),
-    bluetooth_volume_lock_timer(0), bluetooth_previously_connected(false), persistent_active_input(AUDIO_INPUT_NONE), current_volume_dB(AUDIO_DEFAULT_VOLUME_DB),
-    min_volume_dB(AUDIO_DEFAULT_MIN_VOLUME_DB), max_volume_dB(AUDIO_DEFAULT_MAX_VOLUME_DB), eq_mode(AUDIO_EQ_HIFI), calibration_mode(AUDIO_CAL_NONE) {}
+    system(system), non_volatile_config(system.eeprom_if, AUDIO_NVM_TOTAL_BYTES, AudioPathManager::LoadNonVolatileConfigDefaults), initialised(false), operations("AudioPathManager"),
+    bluetooth_volume_lock_timer(0), bluetooth_previously_connected(false), persistent_active_input(AUDIO_INPUT_NONE), current_volume_dB(AUDIO_DEFAULT_VOLUME_DB), target_volume_dB(NAN),
+    protection_gain_reduction({ 0.0f, 0.0f }), min_volume_dB(AUDIO_DEFAULT_MIN_VOLUME_DB), max_volume_dB(AUDIO_DEFAULT_MAX_VOLUME_DB), eq_mode(AUDIO_EQ_HIFI), calibration_mode(AUDIO_CAL_NONE) {}
 
 
 void AudioPathManager::InitDACSetup(SuccessCallback&& callback) {
@@ -156,97 +161,33 @@ void AudioPathManager::InitDACSetup(SuccessCallback&& callback) {
       return;
     }
 
-    //set up signal path
-    HiFiDACSignalPathSetup setup;
-    setup.automute_ch1 = setup.automute_ch2 = AUDIO_DAC_ENABLE_AUTOMUTE;
-    setup.invert_ch1 = AUDIO_DAC_INVERT_CH1;
-    setup.invert_ch2 = AUDIO_DAC_INVERT_CH2;
-    setup.gain4x_ch1 = AUDIO_DAC_4XGAIN_CH1;
-    setup.gain4x_ch2 = AUDIO_DAC_4XGAIN_CH2;
-    setup.mute_gnd_ramp = AUDIO_DAC_ENABLE_MUTE_GND_RAMP;
-    this->system.dac_if.SetSignalPathSetup(setup, [this, callback = std::move(callback)](bool success) {
+    //set up signal path, clocking, TDM slots, filter and harmonic correction - only changed registers are written, merged into few transfers
+    HiFiDACSignalChainSetup setup;
+    setup.path_setup.value = 0;
+    setup.path_setup.automute_ch1 = setup.path_setup.automute_ch2 = AUDIO_DAC_ENABLE_AUTOMUTE;
+    setup.path_setup.invert_ch1 = AUDIO_DAC_INVERT_CH1;
+    setup.path_setup.invert_ch2 = AUDIO_DAC_INVERT_CH2;
+    setup.path_setup.gain4x_ch1 = AUDIO_DAC_4XGAIN_CH1;
+    setup.path_setup.gain4x_ch2 = AUDIO_DAC_4XGAIN_CH2;
+    setup.path_setup.mute_gnd_ramp = AUDIO_DAC_ENABLE_MUTE_GND_RAMP;
+    setup.clock_config.value = AUDIO_DAC_INTERNAL_CLOCK_CFG;
+    setup.tdm_slot_count = AUDIO_DAC_TDM_SLOT_COUNT;
+    setup.tdm_slot_ch1 = AUDIO_DAC_TDM_SLOT_CH1;
+    setup.tdm_slot_ch2 = AUDIO_DAC_TDM_SLOT_CH2;
+    setup.filter_shape = AUDIO_DAC_FILTER_SHAPE;
+    setup.thd_c2_ch1 = AUDIO_DAC_THD_C2_CH1;
+    setup.thd_c2_ch2 = AUDIO_DAC_THD_C2_CH2;
+    setup.thd_c3_ch1 = AUDIO_DAC_THD_C3_CH1;
+    setup.thd_c3_ch2 = AUDIO_DAC_THD_C3_CH2;
+    this->system.dac_if.SetSignalChainSetup(setup, [callback = std::move(callback)](bool success) {
       if (!success) {
-        //propagate failure to external callback
-        DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to set up signal path");
-        if (callback) {
-          callback(false);
-        }
-        return;
+        DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to configure signal chain");
       }
 
-      //configure internal clock
-      HiFiDACInternalClockConfig clock_cfg;
-      clock_cfg.value = AUDIO_DAC_INTERNAL_CLOCK_CFG;
-      this->system.dac_if.SetInternalClockConfig(clock_cfg, [this, callback = std::move(callback)](bool success) {
-        if (!success) {
-          //propagate failure to external callback
-          DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to configure internal clock");
-          if (callback) {
-            callback(false);
-          }
-          return;
-        }
-
-        //configure TDM slot count
-        this->system.dac_if.SetTDMSlotCount(AUDIO_DAC_TDM_SLOT_COUNT, [this, callback = std::move(callback)](bool success) {
-          if (!success) {
-            //propagate failure to external callback
-            DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to configure TDM slot count");
-            if (callback) {
-              callback(false);
-            }
-            return;
-          }
-
-          //configure channel TDM slots
-          this->system.dac_if.SetChannelTDMSlots(AUDIO_DAC_TDM_SLOT_CH1, AUDIO_DAC_TDM_SLOT_CH2, [this, callback = std::move(callback)](bool success) {
-            if (!success) {
-              //propagate failure to external callback
-              DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to configure channel TDM slots");
-              if (callback) {
-                callback(false);
-              }
-              return;
-            }
-
-            //configure filter shape
-            this->system.dac_if.SetInterpolationFilterShape(AUDIO_DAC_FILTER_SHAPE, [this, callback = std::move(callback)](bool success) {
-              if (!success) {
-                //propagate failure to external callback
-                DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to configure filter shape");
-                if (callback) {
-                  callback(false);
-                }
-                return;
-              }
-
-              //configure second harmonic correction
-              this->system.dac_if.SetSecondHarmonicCorrectionCoefficients(AUDIO_DAC_THD_C2_CH1, AUDIO_DAC_THD_C2_CH2, [this, callback = std::move(callback)](bool success) {
-                if (!success) {
-                  //propagate failure to external callback
-                  DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to configure second harmonic correction");
-                  if (callback) {
-                    callback(false);
-                  }
-                  return;
-                }
-
-                //configure third harmonic correction
-                this->system.dac_if.SetThirdHarmonicCorrectionCoefficients(AUDIO_DAC_THD_C3_CH1, AUDIO_DAC_THD_C3_CH2, [this, callback = std::move(callback)](bool success) {
-                  if (!success) {
-                    DEBUG_LOG(DEBUG_ERROR, "AudioPathManager InitDACSetup failed to configure third harmonic correction");
-                  }
-
-                  //propagate success to external callback
-                  if (callback) {
-                    callback(success);
-                  }
-                });
-              });
-            });
-          });
-        });
-      });
+      //propagate success to external callback
+      if (callback) {
+        callback(success);
+      }
     });
   });
 }
@@ -358,8 +299,9 @@ void AudioPathManager::InitDAPSetup(SuccessCallback&& callback) {
 
 void AudioPathManager::Init(SuccessCallback&& callback) {
   this->initialised = false;
-  this->lock_timer = 0;
+  this->operations.ResetLock();
   this->bluetooth_volume_lock_timer = 0;
+  this->target_volume_dB = NAN;
 
   this->eq_mode = AUDIO_EQ_HIFI;
   this->calibration_mode = AUDIO_CAL_NONE;
@@ -430,28 +372,13 @@ void AudioPathManager::LoopTasks() {
       this->UpdateBluetoothVolume();
     }
   }
-
-  if (this->lock_timer > 0) {
-    if (--this->lock_timer == 0) {
-      //shouldn't really ever happen, it means an unlock somewhere was missed or delayed excessively
-      DEBUG_LOG(DEBUG_WARNING, "AudioPathManager lock timed out!");
-    }
-  }
-
-  //if not locked, check for queued operations
-  if (this->lock_timer == 0 && !this->queued_operations.empty()) {
-    //have queued operation: remove from queue, lock again
-    QueuedOperation op = std::move(this->queued_operations.front());
-    this->queued_operations.pop_front();
-    //begin operation under disabled interrupts
-    if (op) {
-      op();
-    }
-  }
   __set_PRIMASK(primask);
 
+  //operation lock timeout, and start of queued operations if not started on unlock
+  this->operations.LoopTasks();
+
   //if not locked, periodically check active input and Bluetooth connection state
-  if (this->lock_timer == 0 && loop_count++ % 50 == 0) {
+  if (!this->operations.IsLocked() && loop_count++ % 50 == 0) {
     primask = __get_PRIMASK();
     __disable_irq();
     AudioPathInput determined_input = this->DetermineActiveInput();
@@ -486,18 +413,17 @@ void AudioPathManager::LoopTasks() {
 void AudioPathManager::HandlePowerStateChange(bool on, SuccessCallback&& callback) {
   uint32_t primask = __get_PRIMASK();
   __disable_irq();
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: queue for later execution
-    this->queued_operations.push_back([this, on, callback = std::move(callback)]() mutable {
+    this->operations.Push(OP_KIND_NONE, [this, on](SuccessCallback&& callback) {
       this->HandlePowerStateChange(on, std::move(callback));
-    });
+    }, std::move(callback));
     __set_PRIMASK(primask);
     return;
   }
 
-  //lock out further operations, and Bluetooth updates
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
+  //lock out Bluetooth updates
   this->bluetooth_volume_lock_timer = AUDIO_BLUETOOTH_LOCK_TIMEOUT_CYCLES;
 
   //first thing in all cases: mute DAC
@@ -506,9 +432,10 @@ void AudioPathManager::HandlePowerStateChange(bool on, SuccessCallback&& callbac
       DEBUG_LOG(DEBUG_ERROR, "AudioPathManager HandlePowerStateChange failed to mute DAC");
     }
 
-    //continue regardless of success: reset min/max and current volume to safe defaults
+    //continue regardless of success: reset min/max and current volume to safe defaults, clear protection gain reduction
     this->min_volume_dB = AUDIO_DEFAULT_MIN_VOLUME_DB;
     this->max_volume_dB = AUDIO_DEFAULT_MAX_VOLUME_DB;
+    this->protection_gain_reduction = { 0.0f, 0.0f };
     this->ClampAndApplyVolumeGain(AUDIO_DEFAULT_VOLUME_DB, [this, on, callback = std::move(callback), prev_success = success](bool success) {
       if (!success) {
         DEBUG_LOG(DEBUG_ERROR, "AudioPathManager HandlePowerStateChange failed to apply default volume");
@@ -531,10 +458,7 @@ void AudioPathManager::HandlePowerStateChange(bool on, SuccessCallback&& callbac
             }
 
             //once done: unlock operations and propagate success (true = all succeeded, false otherwise) to external callback
-            this->lock_timer = 0;
-            if (callback) {
-              callback(prev_success && success);
-            }
+            this->operations.Unlock(callback, prev_success && success);
           });
         } else {
           //turning off: cut and disable bluetooth connections
@@ -544,10 +468,7 @@ void AudioPathManager::HandlePowerStateChange(bool on, SuccessCallback&& callbac
             }
 
             //once done: unlock operations and propagate success (true = all succeeded, false otherwise) to external callback
-            this->lock_timer = 0;
-            if (callback) {
-              callback(prev_success && success);
-            }
+            this->operations.Unlock(callback, prev_success && success);
           });
         }
       });
@@ -559,17 +480,15 @@ void AudioPathManager::HandlePowerStateChange(bool on, SuccessCallback&& callbac
 void AudioPathManager::HandleDACDAPReset(bool dac) {
   uint32_t primask = __get_PRIMASK();
   __disable_irq();
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_LONG_TIMEOUT_CYCLES)) {
     //locked out: queue for later execution
-    this->queued_operations.push_back([this, dac]() mutable {
+    this->operations.Push(OP_KIND_NONE, [this, dac](SuccessCallback&&) {
       this->HandleDACDAPReset(dac);
-    });
+    }, SuccessCallback());
     __set_PRIMASK(primask);
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_LONG_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   //DAC/DAP module reset: start by muting DAC
@@ -591,7 +510,8 @@ void AudioPathManager::HandleDACDAPReset(bool dac) {
     //continue regardless of success: re-init the corresponding module's setup
     if (dac) {
       this->InitDACSetup([this, cb = std::move(post_reinit_cb)](bool success) {
-        this->lock_timer = 0;
+        //unlock without starting queued operations: the power state reconfiguration goes first
+        this->operations.ResetLock();
         if (success) {
           cb();
         } else {
@@ -600,7 +520,8 @@ void AudioPathManager::HandleDACDAPReset(bool dac) {
       });
     } else {
       this->InitDAPSetup([this, cb = std::move(post_reinit_cb)](bool success) {
-        this->lock_timer = 0;
+        //unlock without starting queued operations: the power state reconfiguration goes first
+        this->operations.ResetLock();
         if (success) {
           cb();
         } else {
@@ -749,12 +670,12 @@ void AudioPathManager::SetActiveInput(AudioPathInput input, SuccessCallback&& ca
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, input, callback = std::move(callback)]() mutable {
-        this->SetActiveInput(input, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_ACTIVE_INPUT, [this, input](SuccessCallback&& callback) {
+        this->SetActiveInput(input, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -765,17 +686,12 @@ void AudioPathManager::SetActiveInput(AudioPathInput input, SuccessCallback&& ca
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   //check for input availability
   if (!this->IsInputAvailable(input)) {
     //unavailable: unlock operations and propagate failure to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(false);
-    }
+    this->operations.Unlock(callback, false);
   }
 
   auto update_cb = [this, callback = std::move(callback), input](bool success) {
@@ -786,10 +702,7 @@ void AudioPathManager::SetActiveInput(AudioPathInput input, SuccessCallback&& ca
     }
 
     //unlock operations and propagate success to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(success);
-    }
+    this->operations.Unlock(callback, success);
   };
 
   DAPInput dap_active_input = this->system.dap_if.GetActiveInput();
@@ -873,30 +786,6 @@ void AudioPathManager::ClampAndApplyVolumeGain(float desired_gain_dB, SuccessCal
     clamped_gain = desired_gain_dB;
   }
 
-  //split gain into DAC and DAP gains
-  float dac_gain, dap_gain;
-  if (this->IsLoudnessTrackingMaxVolume()) {
-    //loudness tracks max volume: apply max volume limit (if <0dB) in DAC, remaining gain in DAP
-    dac_gain = MIN(this->max_volume_dB, 0.0f);
-    dap_gain = clamped_gain - dac_gain;
-  } else {
-    //loudness doesn't track max volume: set DAC gain to 0dB, apply all gain in DAP
-    dac_gain = 0.0f;
-    dap_gain = clamped_gain;
-  }
-
-  //calculate target gains (per channel)
-  float new_dac_gain_ch1 = dac_gain + AUDIO_GAIN_OFFSET_DAC_CH1;
-  float new_dac_gain_ch2 = dac_gain + AUDIO_GAIN_OFFSET_DAC_CH2;
-  DAPGains new_dap_gains;
-  new_dap_gains.ch1 = dap_gain + AUDIO_GAIN_OFFSET_DAP_CH1;
-  new_dap_gains.ch2 = dap_gain + AUDIO_GAIN_OFFSET_DAP_CH2;
-
-  //get current gains (per channel)
-  float current_dac_gain_ch1, current_dac_gain_ch2;
-  this->system.dac_if.GetVolumesAsGains(current_dac_gain_ch1, current_dac_gain_ch2);
-  DAPGains current_dap_gains = this->system.dap_if.GetVolumeGains();
-
   //completion callback (for after adjustments)
   auto completion_cb = [this, callback = std::move(callback), clamped_gain](bool success) {
     //if successful and gain is different from saved: update and notify event handlers
@@ -912,91 +801,200 @@ void AudioPathManager::ClampAndApplyVolumeGain(float desired_gain_dB, SuccessCal
     }
   };
 
-  //check if DAC or DAP already have the right gains
-  if (new_dac_gain_ch1 == current_dac_gain_ch1 && new_dac_gain_ch2 == current_dac_gain_ch2) {
-    //DAC is already correct: check DAP too, maybe we don't need to do anything
-    if (new_dap_gains.ch1 == current_dap_gains.ch1 && new_dap_gains.ch2 == current_dap_gains.ch2) {
-      //both DAC and DAP already correct: nothing to do, go to completion callback
-      completion_cb(true);
-      return;
-    }
+  this->ApplyGainPlan(this->PlanVolumeGains(clamped_gain), std::move(completion_cb));
+}
 
-    //DAP needs adjustment: send new gains, then go to completion callback
-    //DEBUG_PRINTF("Changing DAP gains to %.1f %.1f\n", new_dap_gains.ch1, new_dap_gains.ch2);
-    this->system.dap_if.SetVolumeGains(new_dap_gains, std::move(completion_cb));
-  } else if (new_dap_gains.ch1 == current_dap_gains.ch1 && new_dap_gains.ch2 == current_dap_gains.ch2) {
-    //DAP is already correct: only adjust DAC, then go to completion callback
-    //DEBUG_PRINTF("Changing DAC gains to %.1f %.1f\n", new_dac_gain_ch1, new_dac_gain_ch2);
-    this->system.dac_if.SetVolumesFromGains(new_dac_gain_ch1, new_dac_gain_ch2, std::move(completion_cb));
+//calculates DAC and DAP target gains for the given (already clamped) volume, and how to apply them without transient over-gain
+AudioGainPlan AudioPathManager::PlanVolumeGains(float volume_gain_dB) const {
+  AudioGainPlan plan;
+
+  //split gain into DAC and DAP gains
+  float dac_gain, dap_gain;
+  if (this->IsLoudnessTrackingMaxVolume()) {
+    //loudness tracks max volume: apply max volume limit (if <0dB) in DAC, remaining gain in DAP
+    dac_gain = MIN(this->max_volume_dB, 0.0f);
+    dap_gain = volume_gain_dB - dac_gain;
   } else {
-    //we need to adjust both DAC and DAP: calculate max gain differences for each, to apply smallest ("least positive") change first
-    float dac_gain_diff = MAX(new_dac_gain_ch1 - current_dac_gain_ch1, new_dac_gain_ch2 - current_dac_gain_ch2);
-    float dap_gain_diff = MAX(new_dap_gains.ch1 - current_dap_gains.ch1, new_dap_gains.ch2 - current_dap_gains.ch2);
-
-    if (dac_gain_diff > dap_gain_diff) {
-      //DAC difference is larger, so apply DAP first
-      //DEBUG_PRINTF("Changing DAP gains to %.1f %.1f\n", new_dap_gains.ch1, new_dap_gains.ch2);
-      this->system.dap_if.SetVolumeGains(new_dap_gains, [this, completion_cb = std::move(completion_cb), new_dac_gain_ch1, new_dac_gain_ch2, current_dap_gains](bool success) {
+    //loudness doesn't track max volume: set DAC gain to 0dB, apply all gain in DAP
+    dac_gain = 0.0f;
+    dap_gain = volume_gain_dB;
+  }
+
+  //calculate target gains (per channel)
+  plan.dac_gain_ch1 = dac_gain + AUDIO_GAIN_OFFSET_DAC_CH1;
+  plan.dac_gain_ch2 = dac_gain + AUDIO_GAIN_OFFSET_DAC_CH2;
+  plan.dap_gains.ch1 = dap_gain + AUDIO_GAIN_OFFSET_DAP_CH1 + this->protection_gain_reduction.ch1;
+  plan.dap_gains.ch2 = dap_gain + AUDIO_GAIN_OFFSET_DAP_CH2 + this->protection_gain_reduction.ch2;
+
+  //get current gains (per channel)
+  this->system.dac_if.GetVolumesAsGains(plan.prev_dac_gain_ch1, plan.prev_dac_gain_ch2);
+  plan.prev_dap_gains = this->system.dap_if.GetVolumeGains();
+
+  //determine change directions
+  bool dac_up = plan.dac_gain_ch1 > plan.prev_dac_gain_ch1 || plan.dac_gain_ch2 > plan.prev_dac_gain_ch2;
+  bool dac_down = plan.dac_gain_ch1 < plan.prev_dac_gain_ch1 || plan.dac_gain_ch2 < plan.prev_dac_gain_ch2;
+  bool dap_up = plan.dap_gains.ch1 > plan.prev_dap_gains.ch1 || plan.dap_gains.ch2 > plan.prev_dap_gains.ch2;
+  bool dap_down = plan.dap_gains.ch1 < plan.prev_dap_gains.ch1 || plan.dap_gains.ch2 < plan.prev_dap_gains.ch2;
+  plan.dac_change = dac_up || dac_down;
+  plan.dap_change = dap_up || dap_down;
+
+  if (!plan.dac_change && !plan.dap_change) {
+    plan.mode = AUDIO_GAIN_PLAN_NONE;
+  } else if (dac_up && dap_down) {
+    plan.mode = AUDIO_GAIN_PLAN_DAP_FIRST;
+  } else if (dac_down && dap_up) {
+    plan.mode = AUDIO_GAIN_PLAN_DAP_DELAYED;
+  } else {
+    plan.mode = AUDIO_GAIN_PLAN_CONCURRENT;
+  }
+
+  return plan;
+}
+
+//results of concurrent DAC and DAP gain writes, collected until both are done
+typedef struct {
+  AudioGainPlan plan;
+  SuccessCallback callback;
+  uint8_t pending;
+  bool dac_success;
+  bool dap_success;
+} _AudioGainPlanResults;
+
+//applies the given gain plan, restoring the previous gains of one device if the other one fails
+void AudioPathManager::ApplyGainPlan(const AudioGainPlan& plan, SuccessCallback&& callback) {
+  switch (plan.mode) {
+    case AUDIO_GAIN_PLAN_NONE:
+      //both DAC and DAP already correct: nothing to do, go to callback
+      if (callback) {
+        callback(true);
+      }
+      return;
+    case AUDIO_GAIN_PLAN_DAP_FIRST:
+      //DAP decrease first
+      //DEBUG_PRINTF("Changing DAP gains to %.1f %.1f\n", plan.dap_gains.ch1, plan.dap_gains.ch2);
+      this->system.dap_if.SetVolumeGains(plan.dap_gains, [this, callback = std::move(callback), plan](bool success) {
         if (!success) {
-          //propagate failure to completion callback
-          DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ClampAndApplyVolumeGain DAP-DAC write failed at DAP");
-          completion_cb(false);
+          //propagate failure to callback
+          DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ApplyGainPlan DAP-DAC write failed at DAP");
+          if (callback) {
+            callback(false);
+          }
           return;
         }
 
-        //apply DAC afterwards
-        //DEBUG_PRINTF("Changing DAC gains to %.1f %.1f\n", new_dac_gain_ch1, new_dac_gain_ch2);
-        this->system.dac_if.SetVolumesFromGains(new_dac_gain_ch1, new_dac_gain_ch2, [this, completion_cb = std::move(completion_cb), current_dap_gains](bool success) {
+        //apply DAC increase afterwards
+        //DEBUG_PRINTF("Changing DAC gains to %.1f %.1f\n", plan.dac_gain_ch1, plan.dac_gain_ch2);
+        this->system.dac_if.SetVolumesFromGains(plan.dac_gain_ch1, plan.dac_gain_ch2, [this, callback = std::move(callback), plan](bool success) {
           if (success) {
-            //all good: propagate success to completion callback
-            completion_cb(true);
-          } else {
-            //DAP gain application succeeded, but DAC application failed: attempt to reset DAP gains to what they were
-            DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ClampAndApplyVolumeGain DAP-DAC write failed at DAC, attempting DAP restore");
-            this->system.dap_if.SetVolumeGains(current_dap_gains, [this, completion_cb = std::move(completion_cb)](bool success) {
-              if (!success) {
-                DEBUG_LOG(DEBUG_CRITICAL, "AudioPathManager ClampAndApplyVolumeGain DAP-DAC write failed to restore DAP after DAC write failure!");
-              }
-
-              //report failure to completion callback (regardless of restore success)
-              completion_cb(false);
-            });
+            //all good: propagate success to callback
+            if (callback) {
+              callback(true);
+            }
+            return;
           }
+
+          //DAP gain application succeeded, but DAC application failed: attempt to reset DAP gains to what they were
+          DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ApplyGainPlan DAP-DAC write failed at DAC, attempting DAP restore");
+          this->system.dap_if.SetVolumeGains(plan.prev_dap_gains, [callback = std::move(callback)](bool success) {
+            if (!success) {
+              DEBUG_LOG(DEBUG_CRITICAL, "AudioPathManager ApplyGainPlan DAP-DAC write failed to restore DAP after DAC write failure!");
+            }
+
+            //report failure to callback (regardless of restore success)
+            if (callback) {
+              callback(false);
+            }
+          });
         });
       });
-    } else {
-      //DAP difference is larger (or equal), so apply DAC first
-      //DEBUG_PRINTF("Changing DAC gains to %.1f %.1f\n", new_dac_gain_ch1, new_dac_gain_ch2);
-      this->system.dac_if.SetVolumesFromGains(new_dac_gain_ch1, new_dac_gain_ch2, [this, completion_cb = std::move(completion_cb), new_dap_gains, current_dac_gain_ch1, current_dac_gain_ch2](bool success) {
+      return;
+    default:
+      break;
+  }
+
+  //concurrent plans with only one device changing: just write that one
+  if (!plan.dap_change) {
+    //DEBUG_PRINTF("Changing DAC gains to %.1f %.1f\n", plan.dac_gain_ch1, plan.dac_gain_ch2);
+    this->system.dac_if.SetVolumesFromGains(plan.dac_gain_ch1, plan.dac_gain_ch2, std::move(callback));
+    return;
+  } else if (!plan.dac_change) {
+    //DEBUG_PRINTF("Changing DAP gains to %.1f %.1f\n", plan.dap_gains.ch1, plan.dap_gains.ch2);
+    this->system.dap_if.SetVolumeGains(plan.dap_gains, std::move(callback));
+    return;
+  }
+
+  //both devices changing: start both writes at once, and handle the results once both are done
+  //(result callbacks run from the I2C interrupt with further interrupts disabled, so the pending count doesn't need extra protection)
+  auto results = std::make_shared<_AudioGainPlanResults>();
+  results->plan = plan;
+  results->callback = std::move(callback);
+  results->pending = 2;
+  results->dac_success = false;
+  results->dap_success = false;
+
+  auto result_cb = [this, results]() {
+    if (--results->pending > 0) {
+      //still waiting for the other device
+      return;
+    }
+
+    if (results->dac_success && results->dap_success) {
+      //all good: propagate success to callback
+      if (results->callback) {
+        results->callback(true);
+      }
+    } else if (results->dac_success) {
+      //DAP application failed: attempt to reset DAC gains to what they were
+      DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ApplyGainPlan concurrent write failed at DAP, attempting DAC restore");
+      this->system.dac_if.SetVolumesFromGains(results->plan.prev_dac_gain_ch1, results->plan.prev_dac_gain_ch2, [results](bool success) {
         if (!success) {
-          //propagate failure to completion callback
-          DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ClampAndApplyVolumeGain DAC-DAP write failed at DAC");
-          completion_cb(false);
-          return;
+          DEBUG_LOG(DEBUG_CRITICAL, "AudioPathManager ApplyGainPlan concurrent write failed to restore DAC after DAP write failure!");
         }
 
-        //apply DAP afterwards
-        //DEBUG_PRINTF("Changing DAP gains to %.1f %.1f\n", new_dap_gains.ch1, new_dap_gains.ch2);
-        this->system.dap_if.SetVolumeGains(new_dap_gains, [this, completion_cb = std::move(completion_cb), current_dac_gain_ch1, current_dac_gain_ch2](bool success) {
-          if (success) {
-            //all good: propagate success to completion callback
-            completion_cb(true);
-          } else {
-            //DAC gain application succeeded, but DAP application failed: attempt to reset DAC gains to what they were
-            DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ClampAndApplyVolumeGain DAC-DAP write failed at DAP, attempting DAC restore");
-            this->system.dac_if.SetVolumesFromGains(current_dac_gain_ch1, current_dac_gain_ch2, [this, completion_cb = std::move(completion_cb)](bool success) {
-              if (!success) {
-                DEBUG_LOG(DEBUG_CRITICAL, "AudioPathManager ClampAndApplyVolumeGain DAC-DAP write failed to restore DAC after DAP write failure!");
-              }
+        //report failure to callback (regardless of restore success)
+        if (results->callback) {
+          results->callback(false);
+        }
+      });
+    } else if (results->dap_success) {
+      //DAC application failed: attempt to reset DAP gains to what they were (also cancels delayed gains, if they're not applied yet)
+      DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ApplyGainPlan concurrent write failed at DAC, attempting DAP restore");
+      this->system.dap_if.SetVolumeGains(results->plan.prev_dap_gains, [results](bool success) {
+        if (!success) {
+          DEBUG_LOG(DEBUG_CRITICAL, "AudioPathManager ApplyGainPlan concurrent write failed to restore DAP after DAC write failure!");
+        }
 
-              //report failure to completion callback (regardless of restore success)
-              completion_cb(false);
-            });
-          }
-        });
+        //report failure to callback (regardless of restore success)
+        if (results->callback) {
+          results->callback(false);
+        }
       });
+    } else {
+      //both failed: nothing to restore, report failure
+      DEBUG_LOG(DEBUG_ERROR, "AudioPathManager ApplyGainPlan concurrent write failed at both DAC and DAP");
+      if (results->callback) {
+        results->callback(false);
+      }
     }
+  };
+
+  //DEBUG_PRINTF("Changing DAC gains to %.1f %.1f and DAP gains to %.1f %.1f\n", plan.dac_gain_ch1, plan.dac_gain_ch2, plan.dap_gains.ch1, plan.dap_gains.ch2);
+  if (plan.mode == AUDIO_GAIN_PLAN_DAP_DELAYED) {
+    //DAP increase: delay it until after the DAC decrease, to avoid transient over-gain
+    this->system.dap_if.SetVolumeGainsDelayed(plan.dap_gains, AUDIO_DAP_GAIN_DELAY_BATCHES, [results, result_cb](bool success) {
+      results->dap_success = success;
+      result_cb();
+    });
+  } else {
+    this->system.dap_if.SetVolumeGains(plan.dap_gains, [results, result_cb](bool success) {
+      results->dap_success = success;
+      result_cb();
+    });
   }
+  this->system.dac_if.SetVolumesFromGains(plan.dac_gain_ch1, plan.dac_gain_ch2, [results, result_cb](bool success) {
+    results->dac_success = success;
+    result_cb();
+  });
 }
 
 void AudioPathManager::SetCurrentVolumeDB(float volume_dB, SuccessCallback&& callback, bool queue_if_busy) {
@@ -1015,12 +1013,13 @@ void AudioPathManager::SetCurrentVolumeDB(float volume_dB, SuccessCallback&& cal
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, volume_dB, callback = std::move(callback)]() mutable {
-        this->SetCurrentVolumeDB(volume_dB, std::move(callback), false);
-      });
+      this->target_volume_dB = volume_dB;
+      this->operations.Push(AUDIO_OP_VOLUME, [this, volume_dB](SuccessCallback&& callback) {
+        this->SetCurrentVolumeDB(volume_dB, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1031,8 +1030,7 @@ void AudioPathManager::SetCurrentVolumeDB(float volume_dB, SuccessCallback&& cal
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
+  this->target_volume_dB = volume_dB;
   __set_PRIMASK(primask);
 
   //round volume to nearest step
@@ -1041,12 +1039,14 @@ void AudioPathManager::SetCurrentVolumeDB(float volume_dB, SuccessCallback&& cal
   float rounded_volume = roundf(volume_dB / vol_step) * vol_step;
 
   //clamp and apply volume gain to DAC and DAP
-  this->ClampAndApplyVolumeGain(rounded_volume, [this, callback = std::move(callback)](bool success) {
-    //once done: unlock operations and propagate success to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(success);
+  this->ClampAndApplyVolumeGain(rounded_volume, [this, volume_dB, callback = std::move(callback)](bool success) {
+    //target reached, unless a newer volume change was queued in the meantime
+    if (this->target_volume_dB == volume_dB) {
+      this->target_volume_dB = NAN;
     }
+
+    //once done: unlock operations and propagate success to external callback
+    this->operations.Unlock(callback, success);
   });
 }
 
@@ -1055,7 +1055,17 @@ void AudioPathManager::ChangeCurrentVolumeDB(float volume_change_dB, SuccessCall
     throw std::invalid_argument("AudioPathManager ChangeCurrentVolumeDB given NaN volume change");
   }
 
-  this->SetCurrentVolumeDB(this->current_volume_dB + volume_change_dB, std::move(callback), queue_if_busy);
+  //change relative to the pending target volume, if any (so quick successive changes accumulate instead of being lost), otherwise the current volume
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  float base_volume_dB = this->current_volume_dB;
+  if (!isnanf(this->target_volume_dB)) {
+    this->CheckAndFixVolumeLimits();
+    base_volume_dB = fminf(fmaxf(this->target_volume_dB, this->min_volume_dB), this->max_volume_dB);
+  }
+  __set_PRIMASK(primask);
+
+  this->SetCurrentVolumeDB(base_volume_dB + volume_change_dB, std::move(callback), queue_if_busy);
 }
 
 void AudioPathManager::StepCurrentVolumeDB(bool up, SuccessCallback&& callback, bool queue_if_busy) {
@@ -1136,12 +1146,12 @@ void AudioPathManager::SetMinVolumeDB(float min_volume_dB, SuccessCallback&& cal
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, min_volume_dB, callback = std::move(callback)]() mutable {
-        this->SetMinVolumeDB(min_volume_dB, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_MIN_VOLUME, [this, min_volume_dB](SuccessCallback&& callback) {
+        this->SetMinVolumeDB(min_volume_dB, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1152,8 +1162,6 @@ void AudioPathManager::SetMinVolumeDB(float min_volume_dB, SuccessCallback&& cal
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   this->CheckAndFixVolumeLimits();
@@ -1168,10 +1176,7 @@ void AudioPathManager::SetMinVolumeDB(float min_volume_dB, SuccessCallback&& cal
 
   if (clamped_min_volume == this->min_volume_dB) {
     //already at desired min volume: nothing to do, unlock operations and report to callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //apply new min volume and refresh current volume gain (to ensure it's within the new range)
     this->min_volume_dB = clamped_min_volume;
@@ -1184,10 +1189,7 @@ void AudioPathManager::SetMinVolumeDB(float min_volume_dB, SuccessCallback&& cal
       this->UpdateBluetoothVolume();
 
       //once done: unlock operations and report to external callback (min volume application is successful, regardless of current volume re-application success)
-      this->lock_timer = 0;
-      if (callback) {
-        callback(true);
-      }
+      this->operations.Unlock(callback, true);
     });
   }
 }
@@ -1208,12 +1210,12 @@ void AudioPathManager::SetMaxVolumeDB(float max_volume_dB, SuccessCallback&& cal
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, max_volume_dB, callback = std::move(callback)]() mutable {
-        this->SetMaxVolumeDB(max_volume_dB, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_MAX_VOLUME, [this, max_volume_dB](SuccessCallback&& callback) {
+        this->SetMaxVolumeDB(max_volume_dB, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1224,8 +1226,6 @@ void AudioPathManager::SetMaxVolumeDB(float max_volume_dB, SuccessCallback&& cal
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   this->CheckAndFixVolumeLimits();
@@ -1240,10 +1240,7 @@ void AudioPathManager::SetMaxVolumeDB(float max_volume_dB, SuccessCallback&& cal
 
   if (clamped_max_volume == this->max_volume_dB) {
     //already at desired max volume: nothing to do, unlock operations and report to callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //decrease min volume if the new max volume would result in an insufficient min-max range
     if (clamped_max_volume - this->min_volume_dB < AUDIO_LIMIT_VOLUME_RANGE_MIN) {
@@ -1261,10 +1258,7 @@ void AudioPathManager::SetMaxVolumeDB(float max_volume_dB, SuccessCallback&& cal
       this->UpdateBluetoothVolume();
 
       //once done: unlock operations and report to external callback (max volume application is successful, regardless of current volume re-application success)
-      this->lock_timer = 0;
-      if (callback) {
-        callback(true);
-      }
+      this->operations.Unlock(callback, true);
     });
   }
 }
@@ -1285,12 +1279,12 @@ void AudioPathManager::SetVolumeStepDB(float volume_step_dB, SuccessCallback&& c
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, volume_step_dB, callback = std::move(callback)]() mutable {
-        this->SetVolumeStepDB(volume_step_dB, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_VOLUME_STEP, [this, volume_step_dB](SuccessCallback&& callback) {
+        this->SetVolumeStepDB(volume_step_dB, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1301,8 +1295,6 @@ void AudioPathManager::SetVolumeStepDB(float volume_step_dB, SuccessCallback&& c
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   this->CheckAndFixVolumeStep();
@@ -1312,10 +1304,7 @@ void AudioPathManager::SetVolumeStepDB(float volume_step_dB, SuccessCallback&& c
 
   if (rounded_step == this->GetVolumeStepDB()) {
     //already at desired volume step: nothing to do, unlock operations and report to callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //apply new volume step
     this->non_volatile_config.SetValue32(AUDIO_NVM_VOLUME_STEP, *(uint32_t*)&rounded_step);
@@ -1326,10 +1315,7 @@ void AudioPathManager::SetVolumeStepDB(float volume_step_dB, SuccessCallback&& c
     this->CheckAndFixVolumeLimits();
     if (this->current_volume_dB == aligned_volume || this->current_volume_dB == this->min_volume_dB || this->current_volume_dB == this->max_volume_dB) {
       //already aligned, or at either volume limit: nothing more to do, unlock operations and report to callback
-      this->lock_timer = 0;
-      if (callback) {
-        callback(true);
-      }
+      this->operations.Unlock(callback, true);
     } else {
       //not aligned and not at limit: apply new aligned volume
       this->ClampAndApplyVolumeGain(aligned_volume, [this, callback = std::move(callback)](bool success) {
@@ -1338,10 +1324,7 @@ void AudioPathManager::SetVolumeStepDB(float volume_step_dB, SuccessCallback&& c
         }
 
         //once done: unlock operations and report to external callback (volume step application is successful, regardless of current volume re-application success)
-        this->lock_timer = 0;
-        if (callback) {
-          callback(true);
-        }
+        this->operations.Unlock(callback, true);
       });
     }
   }
@@ -1359,12 +1342,12 @@ void AudioPathManager::SetPositiveGainAllowed(bool pos_gain_allowed, SuccessCall
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, pos_gain_allowed, callback = std::move(callback)]() mutable {
-        this->SetPositiveGainAllowed(pos_gain_allowed, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_POSITIVE_GAIN, [this, pos_gain_allowed](SuccessCallback&& callback) {
+        this->SetPositiveGainAllowed(pos_gain_allowed, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1375,8 +1358,6 @@ void AudioPathManager::SetPositiveGainAllowed(bool pos_gain_allowed, SuccessCall
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   //get current DAP config (mainly: whether positive gain is currently allowed)
@@ -1385,20 +1366,14 @@ void AudioPathManager::SetPositiveGainAllowed(bool pos_gain_allowed, SuccessCall
 
   if (pos_gain_allowed == pos_gain_currently_allowed) {
     //already in desired state: nothing to do, unlock operations and report to callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     this->CheckAndFixVolumeLimits();
     if (pos_gain_allowed || this->max_volume_dB <= 0.0f) {
       //want to allow, or disallow with the maximum volume already non-positive: just set the corresponding DAP config
       this->system.dap_if.SetConfig(sp_enabled, pos_gain_allowed, [this, callback = std::move(callback)](bool success) {
         //once done: unlock operations and report success to callback
-        this->lock_timer = 0;
-        if (callback) {
-          callback(success);
-        }
+        this->operations.Unlock(callback, success);
       });
     } else {
       //want to disallow, but maximum volume is positive: lower maximum volume to 0dB and re-apply volume gain
@@ -1415,10 +1390,7 @@ void AudioPathManager::SetPositiveGainAllowed(bool pos_gain_allowed, SuccessCall
         //afterwards, set the corresponding DAP config (regardless of current volume re-application success)
         this->system.dap_if.SetConfig(sp_enabled, pos_gain_allowed, [this, callback = std::move(callback)](bool success) {
           //once done: unlock operations and report success to callback
-          this->lock_timer = 0;
-          if (callback) {
-            callback(success);
-          }
+          this->operations.Unlock(callback, success);
         });
       });
     }
@@ -1426,6 +1398,56 @@ void AudioPathManager::SetPositiveGainAllowed(bool pos_gain_allowed, SuccessCall
 }
 
 
+DAPGains AudioPathManager::GetProtectionGainReduction() const {
+  return this->protection_gain_reduction;
+}
+
+void AudioPathManager::SetProtectionGainReduction(DAPGains reduction_dB, SuccessCallback&& callback, bool queue_if_busy) {
+  if (isnanf(reduction_dB.ch1) || isnanf(reduction_dB.ch2)) {
+    throw std::invalid_argument("AudioPathManager SetProtectionGainReduction given invalid reduction");
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (!this->initialised) {
+    //uninitialised: failure, propagate to callback
+    __set_PRIMASK(primask);
+    if (callback) {
+      callback(false);
+    }
+    return;
+  }
+
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
+    //locked out: failure, queue or propagate to callback
+    if (queue_if_busy) {
+      this->operations.Push(AUDIO_OP_PROTECTION_REDUCTION, [this, reduction_dB](SuccessCallback&& callback) {
+        this->SetProtectionGainReduction(reduction_dB, std::move(callback), true);
+      }, std::move(callback));
+      __set_PRIMASK(primask);
+    } else {
+      __set_PRIMASK(primask);
+      if (callback) {
+        callback(false);
+      }
+    }
+    return;
+  }
+
+  __set_PRIMASK(primask);
+
+  //clamp reductions to valid range and save them
+  this->protection_gain_reduction.ch1 = MAX(MIN(reduction_dB.ch1, 0.0f), AUDIO_LIMIT_PROTECTION_REDUCTION_MIN);
+  this->protection_gain_reduction.ch2 = MAX(MIN(reduction_dB.ch2, 0.0f), AUDIO_LIMIT_PROTECTION_REDUCTION_MIN);
+
+  //re-apply current volume gain, which includes the new reductions
+  this->ClampAndApplyVolumeGain(this->current_volume_dB, [this, callback = std::move(callback)](bool success) {
+    //once done: unlock operations and propagate success to external callback
+    this->operations.Unlock(callback, success);
+  });
+}
+
+
 void AudioPathManager::UpdateBluetoothVolume() {
   //skip update if locked out
   if (this->bluetooth_volume_lock_timer > 0) {
@@ -1559,12 +1581,12 @@ void AudioPathManager::SetMute(bool mute, SuccessCallback&& callback, bool queue
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, mute, callback = std::move(callback)]() mutable {
-        this->SetMute(mute, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_MUTE, [this, mute](SuccessCallback&& callback) {
+        this->SetMute(mute, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1575,16 +1597,11 @@ void AudioPathManager::SetMute(bool mute, SuccessCallback&& callback, bool queue
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (mute == this->IsMute()) {
     //already in desired state: nothing to do, unlock operations and report to callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //write new mute state to DAC
     this->system.dac_if.SetMutes(mute, mute, [this, callback = std::move(callback)](bool success) {
@@ -1595,10 +1612,7 @@ void AudioPathManager::SetMute(bool mute, SuccessCallback&& callback, bool queue
       }
 
       //unlock operations and report success to callback
-      this->lock_timer = 0;
-      if (callback) {
-        callback(success);
-      }
+      this->operations.Unlock(callback, success);
     });
   }
 }
@@ -1635,12 +1649,12 @@ void AudioPathManager::SetLoudnessGainDB(float loudness_gain_dB, SuccessCallback
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, loudness_gain_dB, callback = std::move(callback)]() mutable {
-        this->SetLoudnessGainDB(loudness_gain_dB, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_LOUDNESS_GAIN, [this, loudness_gain_dB](SuccessCallback&& callback) {
+        this->SetLoudnessGainDB(loudness_gain_dB, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1651,8 +1665,6 @@ void AudioPathManager::SetLoudnessGainDB(float loudness_gain_dB, SuccessCallback
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   DAPGains new_loudness_gains;
@@ -1669,10 +1681,7 @@ void AudioPathManager::SetLoudnessGainDB(float loudness_gain_dB, SuccessCallback
 
   if (new_loudness_gains.ch1 == current_loudness_gains.ch1 && new_loudness_gains.ch2 == current_loudness_gains.ch2) {
     //already have the desired loudness settings: nothing to do, unlock operations and report to callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //write new loudness gains to the DAP
     this->system.dap_if.SetLoudnessGains(new_loudness_gains, [this, callback = std::move(callback), new_gain = new_loudness_gains.ch1](bool success) {
@@ -1682,10 +1691,7 @@ void AudioPathManager::SetLoudnessGainDB(float loudness_gain_dB, SuccessCallback
       }
 
       //once done: unlock operations and propagate success to external callback
-      this->lock_timer = 0;
-      if (callback) {
-        callback(success);
-      }
+      this->operations.Unlock(callback, success);
     });
   }
 }
@@ -1702,12 +1708,12 @@ void AudioPathManager::SetLoudnessTrackingMaxVolume(bool track_max_volume, Succe
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, track_max_volume, callback = std::move(callback)]() mutable {
-        this->SetLoudnessTrackingMaxVolume(track_max_volume, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_LOUDNESS_TRACKING, [this, track_max_volume](SuccessCallback&& callback) {
+        this->SetLoudnessTrackingMaxVolume(track_max_volume, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1718,16 +1724,11 @@ void AudioPathManager::SetLoudnessTrackingMaxVolume(bool track_max_volume, Succe
     return;
   }
 
-  //lock out further operations (even if we don't do any async operations, still want to avoid concurrent modifications)
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (track_max_volume == this->IsLoudnessTrackingMaxVolume()) {
     //already in desired state: nothing to do, unlock operations and report to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //set new tracking state and refresh current volume (to ensure correct gain split)
     this->non_volatile_config.SetValue8(AUDIO_NVM_LOUDNESS_TRACK_MAX_VOL, track_max_volume ? 1 : 0);
@@ -1737,10 +1738,7 @@ void AudioPathManager::SetLoudnessTrackingMaxVolume(bool track_max_volume, Succe
       }
 
       //once done: unlock operations and report to external callback (tracking state application is successful, regardless of current volume re-application success)
-      this->lock_timer = 0;
-      if (callback) {
-        callback(true);
-      }
+      this->operations.Unlock(callback, true);
     });
   }
 }
@@ -1856,9 +1854,8 @@ void AudioPathManager::UpdateMixerAndEQParams(AudioPathMixerMode mixer, AudioPat
             });
           };
 
-          //compare biquad setup against existing setup
-          DAPBiquadSetup current_setup = this->system.dap_if.GetBiquadSetup();
-          if (!success || !prev_success || memcmp(&current_setup, &update_params.biquad_setup, sizeof(DAPBiquadSetup)) == 0) {
+          //compare biquad setup against existing setup (only trusted if known to be valid)
+          if (!success || !prev_success || this->system.dap_if.registers.Matches(I2CDEF_DAP_BIQUAD_SETUP, &update_params.biquad_setup)) {
             //previously failed, or already configured correctly: skip to next step
             post_setup_cb(true);
           } else {
@@ -1867,9 +1864,8 @@ void AudioPathManager::UpdateMixerAndEQParams(AudioPathMixerMode mixer, AudioPat
           }
         };
 
-        //compare biquad ch2 coefficients against existing coefficients
-        const q31_t* current_ch2 = this->system.dap_if.GetBiquadCoefficients(IF_DAP_CH2);
-        if (!success || !prev_success || memcmp(current_ch2, update_params.biquad_coeffs_ch2, I2CDEF_DAP_REG_SIZE_SP_BIQUAD) == 0) {
+        //compare biquad ch2 coefficients against existing coefficients (only trusted if known to be valid)
+        if (!success || !prev_success || this->system.dap_if.registers.Matches(I2CDEF_DAP_BIQUAD_COEFFS_CH2, update_params.biquad_coeffs_ch2)) {
           //previously failed, or already configured correctly: skip to next step
           post_ch2_cb(true);
         } else {
@@ -1878,9 +1874,8 @@ void AudioPathManager::UpdateMixerAndEQParams(AudioPathMixerMode mixer, AudioPat
         }
       };
 
-      //compare biquad ch1 coefficients against existing coefficients
-      const q31_t* current_ch1 = this->system.dap_if.GetBiquadCoefficients(IF_DAP_CH1);
-      if (!success || memcmp(current_ch1, update_params.biquad_coeffs_ch1, I2CDEF_DAP_REG_SIZE_SP_BIQUAD) == 0) {
+      //compare biquad ch1 coefficients against existing coefficients (only trusted if known to be valid)
+      if (!success || this->system.dap_if.registers.Matches(I2CDEF_DAP_BIQUAD_COEFFS_CH1, update_params.biquad_coeffs_ch1)) {
         //previously failed, or already configured correctly: skip to next step
         post_ch1_cb(true);
       } else {
@@ -1889,9 +1884,8 @@ void AudioPathManager::UpdateMixerAndEQParams(AudioPathMixerMode mixer, AudioPat
       }
     };
 
-    //compare mixer against existing mixer
-    DAPMixerConfig current_mixer = this->system.dap_if.GetMixerConfig();
-    if (memcmp(&current_mixer, &update_params.mixer_cfg, sizeof(DAPMixerConfig)) == 0) {
+    //compare mixer against existing mixer (only trusted if known to be valid)
+    if (this->system.dap_if.registers.Matches(I2CDEF_DAP_MIXER_GAINS, &update_params.mixer_cfg)) {
       //already configured correctly: skip to next step
       post_mixer_cb(true);
     } else {
@@ -1918,12 +1912,12 @@ void AudioPathManager::SetMixerMode(AudioPathMixerMode mode, SuccessCallback&& c
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, mode, callback = std::move(callback)]() mutable {
-        this->SetMixerMode(mode, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_MIXER_MODE, [this, mode](SuccessCallback&& callback) {
+        this->SetMixerMode(mode, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1934,24 +1928,16 @@ void AudioPathManager::SetMixerMode(AudioPathMixerMode mode, SuccessCallback&& c
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (mode == this->GetMixerMode()) {
     //already in desired state: nothing to do, unlock operations and report to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //set new mixer mode and update EQ parameters
     this->UpdateMixerAndEQParams(mode, this->eq_mode, this->calibration_mode, [this, callback = std::move(callback)](bool success) {
       //once done: unlock operations and propagate success to external callback
-      this->lock_timer = 0;
-      if (callback) {
-        callback(success);
-      }
+      this->operations.Unlock(callback, success);
     });
   }
 }
@@ -1972,12 +1958,12 @@ void AudioPathManager::SetEQMode(AudioPathEQMode mode, SuccessCallback&& callbac
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, mode, callback = std::move(callback)]() mutable {
-        this->SetEQMode(mode, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_EQ_MODE, [this, mode](SuccessCallback&& callback) {
+        this->SetEQMode(mode, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -1988,24 +1974,16 @@ void AudioPathManager::SetEQMode(AudioPathEQMode mode, SuccessCallback&& callbac
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (mode == this->eq_mode) {
     //already in desired state: nothing to do, unlock operations and report to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //set new EQ mode and update EQ parameters
     this->UpdateMixerAndEQParams(this->GetMixerMode(), mode, this->calibration_mode, [this, callback = std::move(callback)](bool success) {
       //once done: unlock operations and propagate success to external callback
-      this->lock_timer = 0;
-      if (callback) {
-        callback(success);
-      }
+      this->operations.Unlock(callback, success);
     });
   }
 }
@@ -2026,12 +2004,12 @@ void AudioPathManager::SetCalibrationMode(AudioPathCalibrationMode mode, Success
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(AUDIO_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, mode, callback = std::move(callback)]() mutable {
-        this->SetCalibrationMode(mode, std::move(callback), false);
-      });
+      this->operations.Push(AUDIO_OP_CALIBRATION_MODE, [this, mode](SuccessCallback&& callback) {
+        this->SetCalibrationMode(mode, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -2042,24 +2020,16 @@ void AudioPathManager::SetCalibrationMode(AudioPathCalibrationMode mode, Success
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = AUDIO_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (mode == this->calibration_mode) {
     //already in desired state: nothing to do, unlock operations and report to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //set new calibration mode and update EQ parameters
     this->UpdateMixerAndEQParams(this->GetMixerMode(), this->eq_mode, mode, [this, callback = std::move(callback)](bool success) {
       //once done: unlock operations and propagate success to external callback
-      this->lock_timer = 0;
-      if (callback) {
-        callback(success);
-      }
+      this->operations.Unlock(callback, success);
     });
   }
 }
@@ -51,13 +51,34 @@
 #define PWR_CHG_LED_CHARGING_REG PWR_CHG_LED_TIMER.Instance->CCR1
 #define PWR_CHG_LED_IDLE_REG PWR_CHG_LED_TIMER.Instance->CCR2
 
-//battery time estimation exponential moving average coefficients - currently selected for 60s time constant given 10ms main loop period
+//battery time estimation fast exponential moving average coefficients - currently selected for 60s time constant given 10ms main loop period
 #define PWR_BAT_TIME_EMA_1MALPHA 0.999833f
 #define PWR_BAT_TIME_EMA_ALPHA (1.0f - PWR_BAT_TIME_EMA_1MALPHA)
-//maximum relative ratio between instantaneous and average power for valid estimate
-#define PWR_BAT_TIME_MAX_PWR_RATIO 1.5f
-//minimum relative ratio between instantaneous and average power for EMA re-init
-#define PWR_BAT_TIME_REINIT_PWR_RATIO 3.0f
+//minimum continuous discharge time before any estimate is given, in main loop cycles
+#define PWR_BAT_TIME_MIN_CYCLES (60000 / MAIN_LOOP_PERIOD_MS)
+//relative confidence bounds of the fast (EMA-based) estimate, used while the load history is too short
+#define PWR_BAT_TIME_FAST_BOUNDS 0.5f
+//load history: one histogram entry per averaging period, in main loop cycles
+#define PWR_BAT_TIME_HIST_ENTRY_CYCLES (60000 / MAIN_LOOP_PERIOD_MS)
+//lower power limit of histogram bin 1 in watts - bins are spaced by factors of sqrt(2), bin 0 takes everything below
+#define PWR_BAT_TIME_HIST_MIN_W 1.0f
+//histogram decay factor per entry - currently selected for 20 entry (20min) time constant
+#define PWR_BAT_TIME_HIST_DECAY 0.951229f
+//minimum total histogram weight (in entries) for a histogram-based estimate
+#define PWR_BAT_TIME_HIST_MIN_WEIGHT 3.0f
+//load percentiles used for the confidence bounds of the histogram-based estimate
+#define PWR_BAT_TIME_HIST_PERCENTILE_LOW 0.1f
+#define PWR_BAT_TIME_HIST_PERCENTILE_HIGH 0.9f
+//minimum relative confidence bounds of the histogram-based estimate (SoC energy uncertainty, spread within a bin)
+#define PWR_BAT_TIME_MIN_BOUNDS 0.1f
+//volume and PVDD target changes that make the load history unrepresentative, and the history weight kept when they happen
+#define PWR_BAT_TIME_REGIME_VOLUME_DB 3.0f
+#define PWR_BAT_TIME_REGIME_PVDD_V 2.0f
+#define PWR_BAT_TIME_REGIME_WEIGHT 0.25f
+//charging that resets the estimation: minimum charge current in amps (below it, current samples are treated as noise), and the
+//time it has to be sustained, in main loop cycles - shorter charge current (regeneration, measurement noise) only pauses the estimation
+#define PWR_BAT_TIME_CHARGE_MIN_A 0.05f
+#define PWR_BAT_TIME_CHARGE_RESET_CYCLES (60000 / MAIN_LOOP_PERIOD_MS)
 
 
 static_assert(PWR_ADAPTER_CURRENT_A_DEFAULT >= PWR_ADAPTER_CURRENT_A_MIN && PWR_ADAPTER_CURRENT_A_DEFAULT <= PWR_ADAPTER_CURRENT_A_MAX);
@@ -83,19 +104,20 @@ static const float _power_charge_cell_voltage_targets[_PWR_CHG_TARGET_COUNT] = {
 /******************************************************/
 
 PowerManager::PowerManager(BlockBoxV2System& system) :
-    system(system), non_volatile_config(system.eeprom_if, PWR_NVM_TOTAL_BYTES, PowerManager::LoadNonVolatileConfigDefaults), initialised(false), lock_timer(0), asd_lock_timer(0),
-    charging_active(false), charging_end_condition_cycles(0), auto_shutdown_last_reset(0), inst_discharge_power_W(0.0f), avg_discharge_power_W(0.0f) {}
+    system(system), non_volatile_config(system.eeprom_if, PWR_NVM_TOTAL_BYTES, PowerManager::LoadNonVolatileConfigDefaults), initialised(false), operations("PowerManager"), asd_lock_timer(0),
+    charging_active(false), charging_end_condition_cycles(0), auto_shutdown_last_reset(0) {
+  this->ResetBatteryTimeEstimation();
+}
 
 
 void PowerManager::Init(SuccessCallback&& callback) {
   this->initialised = false;
-  this->lock_timer = 0;
+  this->operations.ResetLock();
   this->asd_lock_timer = 0;
   this->charging_active = false;
   this->charging_end_condition_cycles = 0;
   this->auto_shutdown_last_reset = HAL_GetTick();
-  this->inst_discharge_power_W = 0.0f;
-  this->avg_discharge_power_W = 0.0f;
+  this->ResetBatteryTimeEstimation();
 
   //set up status LED timer
   if (HAL_TIM_Base_Start(&PWR_CHG_LED_TIMER) != HAL_OK) {
@@ -176,26 +198,11 @@ void PowerManager::LoopTasks() {
   if (this->asd_lock_timer > 0) {
     this->asd_lock_timer--;
   }
-
-  if (this->lock_timer > 0) {
-    if (--this->lock_timer == 0) {
-      //shouldn't really ever happen, it means an unlock somewhere was missed or delayed excessively
-      DEBUG_LOG(DEBUG_WARNING, "PowerManager lock timed out!");
-    }
-  }
-
-  //if not locked, check for queued operations
-  if (this->lock_timer == 0 && !this->queued_operations.empty()) {
-    //have queued operation: remove from queue, lock again
-    QueuedOperation op = std::move(this->queued_operations.front());
-    this->queued_operations.pop_front();
-    //begin operation under disabled interrupts
-    if (op) {
-      op();
-    }
-  }
   __set_PRIMASK(primask);
 
+  //operation lock timeout, and start of queued operations if not started on unlock
+  this->operations.LoopTasks();
+
   bool adapter_present = this->system.chg_if.IsAdapterPresent();
   bool battery_present = this->system.bat_if.IsBatteryPresent();
   bool charge_fault = battery_present ? this->system.bat_if.GetStatus().chg_fault : false;
@@ -203,9 +210,7 @@ void PowerManager::LoopTasks() {
   //handle adapter logic, if not locked out
   primask = __get_PRIMASK();
   __disable_irq();
-  if (this->lock_timer == 0) {
-      //lock out
-      this->lock_timer = PWR_LOCK_TIMEOUT_CYCLES;
+  if (this->operations.TryLock(PWR_LOCK_TIMEOUT_CYCLES)) {
       __set_PRIMASK(primask);
 
       //ensure adapter is configured for correct max input current if present
@@ -222,10 +227,10 @@ void PowerManager::LoopTasks() {
             }
             //DEBUG_PRINTF("PowerManager wrote max adapter current after detecting setting difference: %.3f\n", actual_max_current);
           }
-          this->lock_timer = 0;
+          this->operations.Unlock();
         });
       } else {
-        this->lock_timer = 0;
+        this->operations.Unlock();
       }
   } else {
     __set_PRIMASK(primask);
@@ -234,9 +239,7 @@ void PowerManager::LoopTasks() {
   //handle charging logic, if not locked out
   primask = __get_PRIMASK();
   __disable_irq();
-  if (this->lock_timer == 0) {
-    //lock out
-    this->lock_timer = PWR_LOCK_TIMEOUT_CYCLES;
+  if (this->operations.TryLock(PWR_LOCK_TIMEOUT_CYCLES)) {
     __set_PRIMASK(primask);
 
     if (this->charging_active) {
@@ -244,7 +247,7 @@ void PowerManager::LoopTasks() {
       if (!adapter_present) {
         //adapter disconnected: just mark as inactive
         this->charging_active = false;
-        this->lock_timer = 0;
+        this->operations.Unlock();
         this->ExecuteCallbacks(PWR_EVENT_CHARGING_ACTIVE_CHANGE);
       } else if (!battery_present || this->GetChargingTargetCurrentMA() < 128 || charge_fault) {
         //battery disconnected, current target below minimum, or charge fault latched: mark as inactive and explicitly disable charger
@@ -253,7 +256,7 @@ void PowerManager::LoopTasks() {
           if (!success) {
             DEBUG_LOG(DEBUG_ERROR, "PowerManager failed to disable charger after battery removal, manual disable, or charge fault");
           }
-          this->lock_timer = 0;
+          this->operations.Unlock();
         });
         this->ExecuteCallbacks(PWR_EVENT_CHARGING_ACTIVE_CHANGE);
       } else {
@@ -274,10 +277,10 @@ void PowerManager::LoopTasks() {
                 this->charging_active = false;
                 this->ExecuteCallbacks(PWR_EVENT_CHARGING_ACTIVE_CHANGE);
               }
-              this->lock_timer = 0;
+              this->operations.Unlock();
             });
           } else {
-            this->lock_timer = 0;
+            this->operations.Unlock();
           }
         } else {
           //end conditions not met: reset counter
@@ -291,10 +294,10 @@ void PowerManager::LoopTasks() {
               } /*else {
                 DEBUG_PRINTF("PowerManager refreshed charging current: %u\n", this->GetChargingTargetCurrentMA());
               }*/
-              this->lock_timer = 0;
+              this->operations.Unlock();
             });
           } else {
-            this->lock_timer = 0;
+            this->operations.Unlock();
           }
         }
       }
@@ -311,7 +314,7 @@ void PowerManager::LoopTasks() {
           this->system.chg_if.SetChargeEndVoltageMV(target_voltage_mV, [this, target_voltage_mV](bool success) {
             if (!success) {
               DEBUG_LOG(DEBUG_ERROR, "PowerManager failed to write voltage on charge start");
-              this->lock_timer = 0;
+              this->operations.Unlock();
             } else {
               //DEBUG_PRINTF("PowerManager wrote voltage on charge start: %u\n", target_voltage_mV);
               //write charge current
@@ -326,15 +329,15 @@ void PowerManager::LoopTasks() {
                   this->charging_active = true;
                   this->ExecuteCallbacks(PWR_EVENT_CHARGING_ACTIVE_CHANGE);
                 }
-                this->lock_timer = 0;
+                this->operations.Unlock();
               });
             }
           });
         } else {
-          this->lock_timer = 0;
+          this->operations.Unlock();
         }
       } else {
-        this->lock_timer = 0;
+        this->operations.Unlock();
       }
     }
   } else {
@@ -412,9 +415,7 @@ void PowerManager::LoopTasks() {
   //if not locked: automatically clear battery charge faults (if present) when charger is removed
   primask = __get_PRIMASK();
   __disable_irq();
-  if (this->lock_timer == 0) {
-    //lock out
-    this->lock_timer = PWR_LOCK_TIMEOUT_CYCLES;
+  if (this->operations.TryLock(PWR_LOCK_TIMEOUT_CYCLES)) {
     __set_PRIMASK(primask);
 
     if (battery_present && !adapter_present && charge_fault) {
@@ -424,10 +425,10 @@ void PowerManager::LoopTasks() {
         } else {
           DEBUG_LOG(DEBUG_ERROR, "PowerManager failed to clear battery charge faults upon adapter removal");
         }
-        this->lock_timer = 0;
+        this->operations.Unlock();
       });
     } else {
-      this->lock_timer = 0;
+      this->operations.Unlock();
     }
   } else {
     __set_PRIMASK(primask);
@@ -466,33 +467,24 @@ void PowerManager::LoopTasks() {
     this->system.gui_mgr.DeactivatePopups(GUI_POPUP_CHG_FAULT | GUI_POPUP_AUTO_SHUTDOWN | GUI_POPUP_EOD_SHUTDOWN | GUI_POPUP_FULL_SHUTDOWN);
   }
 
-  //update average battery power
+  //update battery time estimation with the current discharge power
   if (battery_present) {
     float discharge_current_A = (float)this->system.bat_if.GetCurrentMA() / -1000.0f; //negated to get (positive) discharge current
     if (discharge_current_A >= 0.0f) {
+      this->charge_cycles = 0;
       float voltage_V = (float)this->system.bat_if.GetStackVoltageMV() / 1000.0f;
       float power_W = voltage_V * discharge_current_A;
       if (!isnanf(power_W) && power_W >= 0.0f && power_W < 1000.0f) {
         //power is within reasonable limits: update
-        this->inst_discharge_power_W = power_W;
-
-        float ratio = power_W / this->avg_discharge_power_W;
-        if (isnanf(ratio) || ratio > PWR_BAT_TIME_REINIT_PWR_RATIO || ratio < (1.0f / PWR_BAT_TIME_REINIT_PWR_RATIO)) {
-          //measurement very far off of average: re-init EMA
-          this->avg_discharge_power_W = power_W;
-        } else {
-          //within reasonable range: update EMA
-          this->avg_discharge_power_W = PWR_BAT_TIME_EMA_ALPHA * power_W + PWR_BAT_TIME_EMA_1MALPHA * this->avg_discharge_power_W;
-        }
+        this->UpdateBatteryTimeEstimation(power_W);
       }
-    } else {
-      //not discharging
-      this->inst_discharge_power_W = 0.0f;
-      this->avg_discharge_power_W = 0.0f;
+    } else if (discharge_current_A <= -PWR_BAT_TIME_CHARGE_MIN_A && ++this->charge_cycles >= PWR_BAT_TIME_CHARGE_RESET_CYCLES) {
+      //sustained charging: the load history doesn't apply to the next discharge anymore
+      this->ResetBatteryTimeEstimation();
     }
+    //otherwise, briefly or barely charging: hold the estimation as it is
   } else {
-    this->inst_discharge_power_W = 0.0f;
-    this->avg_discharge_power_W = 0.0f;
+    this->ResetBatteryTimeEstimation();
   }
 }
 
@@ -549,12 +541,12 @@ void PowerManager::SetAdapterMaxCurrentA(float current_A, SuccessCallback&& call
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(PWR_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, current_A, callback = std::move(callback)]() mutable {
-        this->SetAdapterMaxCurrentA(current_A, std::move(callback), false);
-      });
+      this->operations.Push(PWR_OP_ADAPTER_CURRENT, [this, current_A](SuccessCallback&& callback) {
+        this->SetAdapterMaxCurrentA(current_A, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -565,16 +557,11 @@ void PowerManager::SetAdapterMaxCurrentA(float current_A, SuccessCallback&& call
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = PWR_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (this->GetAdapterMaxCurrentA() == current_A) {
     //already in desired state: unlock operations and propagate success to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //apply new state
     if (this->system.chg_if.IsAdapterPresent()) {
@@ -590,18 +577,12 @@ void PowerManager::SetAdapterMaxCurrentA(float current_A, SuccessCallback&& call
         }
 
         //unlock and propagate success to external callback
-        this->lock_timer = 0;
-        if (callback) {
-          callback(success);
-        }
+        this->operations.Unlock(callback, success);
       });
     } else {
       //adapter not present: just save and unlock
       this->non_volatile_config.SetValue32(PWR_NVM_MAX_ADAPTER_CURRENT, *(uint32_t*)&current_A);
-      this->lock_timer = 0;
-      if (callback) {
-        callback(true);
-      }
+      this->operations.Unlock(callback, true);
     }
   }
 }
@@ -665,12 +646,12 @@ void PowerManager::SetChargingTargetState(PowerChargingTargetState target, Succe
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(PWR_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, target, callback = std::move(callback)]() mutable {
-        this->SetChargingTargetState(target, std::move(callback), false);
-      });
+      this->operations.Push(PWR_OP_CHARGING_TARGET_STATE, [this, target](SuccessCallback&& callback) {
+        this->SetChargingTargetState(target, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -681,16 +662,11 @@ void PowerManager::SetChargingTargetState(PowerChargingTargetState target, Succe
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = PWR_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   if (this->GetChargingTargetState() == target) {
     //already in desired state: unlock operations and propagate success to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //apply new state
     if (this->system.chg_if.IsAdapterPresent() && this->system.bat_if.IsBatteryPresent()) {
@@ -699,10 +675,7 @@ void PowerManager::SetChargingTargetState(PowerChargingTargetState target, Succe
       if (target_voltage_mV < 10000) {
         //shouldn't be possible - abort
         DEBUG_LOG(DEBUG_ERROR, "PowerManager SetChargingTargetState encountered invalid internal target voltage");
-        this->lock_timer = 0;
-        if (callback) {
-          callback(false);
-        }
+        this->operations.Unlock(callback, false);
         return;
       }
 
@@ -716,18 +689,12 @@ void PowerManager::SetChargingTargetState(PowerChargingTargetState target, Succe
         }
 
         //unlock and propagate success to external callback
-        this->lock_timer = 0;
-        if (callback) {
-          callback(success);
-        }
+        this->operations.Unlock(callback, success);
       });
     } else {
       //adapter or battery not present: just save and unlock
       this->non_volatile_config.SetValue8(PWR_NVM_CHARGE_TARGET_STATE, (uint8_t)target);
-      this->lock_timer = 0;
-      if (callback) {
-        callback(true);
-      }
+      this->operations.Unlock(callback, true);
     }
   }
 }
@@ -748,12 +715,12 @@ void PowerManager::SetChargingTargetCurrentA(float current_A, SuccessCallback&&
     return;
   }
 
-  if (this->lock_timer > 0) {
+  if (!this->operations.TryLock(PWR_LOCK_TIMEOUT_CYCLES)) {
     //locked out: failure, queue or propagate to callback
     if (queue_if_busy) {
-      this->queued_operations.push_back([this, current_A, callback = std::move(callback)]() mutable {
-        this->SetChargingTargetCurrentA(current_A, std::move(callback), false);
-      });
+      this->operations.Push(PWR_OP_CHARGING_TARGET_CURRENT, [this, current_A](SuccessCallback&& callback) {
+        this->SetChargingTargetCurrentA(current_A, std::move(callback), true);
+      }, std::move(callback));
       __set_PRIMASK(primask);
     } else {
       __set_PRIMASK(primask);
@@ -764,8 +731,6 @@ void PowerManager::SetChargingTargetCurrentA(float current_A, SuccessCallback&&
     return;
   }
 
-  //lock out further operations
-  this->lock_timer = PWR_LOCK_TIMEOUT_CYCLES;
   __set_PRIMASK(primask);
 
   //calculate target current in mA
@@ -785,10 +750,7 @@ void PowerManager::SetChargingTargetCurrentA(float current_A, SuccessCallback&&
 
   if (this->GetChargingTargetCurrentMA() == target_current_mA) {
     //already in desired state: unlock operations and propagate success to external callback
-    this->lock_timer = 0;
-    if (callback) {
-      callback(true);
-    }
+    this->operations.Unlock(callback, true);
   } else {
     //apply new current
     if (this->charging_active && this->system.chg_if.IsAdapterPresent() && this->system.bat_if.IsBatteryPresent()) {
@@ -805,18 +767,12 @@ void PowerManager::SetChargingTargetCurrentA(float current_A, SuccessCallback&&
         }
 
         //unlock and propagate success to external callback
-        this->lock_timer = 0;
-        if (callback) {
-          callback(success);
-        }
+        this->operations.Unlock(callback, success);
       });
     } else {
       //adapter or battery not present, or not chargng: just save and unlock
       this->non_volatile_config.SetValue16(PWR_NVM_CHARGE_CURRENT, target_current_mA);
-      this->lock_timer = 0;
-      if (callback) {
-        callback(true);
-      }
+      this->operations.Unlock(callback, true);
     }
   }
 }
@@ -852,18 +808,9 @@ void PowerManager::ResetAutoShutdownTimer() {
 /*               Battery Time Estimation              */
 /******************************************************/
 
-uint32_t PowerManager::GetEstimatedBatteryTimeSeconds() const {
-  if (!this->system.bat_if.IsBatteryPresent() || this->system.bat_if.GetSoCConfidenceLevel() == IF_BMS_SOCLVL_INVALID) {
-    return 0;
-  }
-
-  float ratio = this->avg_discharge_power_W / this->inst_discharge_power_W;
-  if (isnanf(ratio) || ratio > PWR_BAT_TIME_MAX_PWR_RATIO || ratio < (1.0f / PWR_BAT_TIME_MAX_PWR_RATIO)) {
-    //average too far from last measurement: invalid estimate
-    return 0;
-  }
-
-  float time_sec = roundf(3600.0f * this->system.bat_if.GetSoCEnergyWh() / this->avg_discharge_power_W);
+//converts a time estimate in seconds to an integer number of seconds, saturating
+static uint32_t _Power_TimeToSeconds(float time_sec) {
+  time_sec = roundf(time_sec);
 
   if (isnanf(time_sec) || time_sec > (float)UINT32_MAX) {
     return UINT32_MAX;
@@ -874,3 +821,124 @@ uint32_t PowerManager::GetEstimatedBatteryTimeSeconds() const {
   }
 }
 
+
+PowerBatteryTimeEstimate PowerManager::GetBatteryTimeEstimate() const {
+  PowerBatteryTimeEstimate estimate = { 0, 0, 0 };
+
+  if (!this->system.bat_if.IsBatteryPresent() || this->system.bat_if.GetSoCConfidenceLevel() == IF_BMS_SOCLVL_INVALID ||
+      this->discharge_cycles < PWR_BAT_TIME_MIN_CYCLES) {
+    return estimate;
+  }
+
+  float energy_Ws = 3600.0f * this->system.bat_if.GetSoCEnergyWh();
+
+  float total_weight = 0.0f;
+  float total_power = 0.0f;
+  for (uint32_t i = 0; i < PWR_BAT_TIME_HIST_BINS; i++) {
+    total_weight += this->hist_weights[i];
+    total_power += this->hist_power_sums[i];
+  }
+
+  float time_sec, time_min_sec, time_max_sec;
+  if (total_weight < PWR_BAT_TIME_HIST_MIN_WEIGHT || total_power <= 0.0f) {
+    //load history still too short: use fast average, with wide bounds
+    if (this->fast_discharge_power_W <= 0.0f) {
+      return estimate;
+    }
+    time_sec = energy_Ws / this->fast_discharge_power_W;
+    time_min_sec = time_sec * (1.0f - PWR_BAT_TIME_FAST_BOUNDS);
+    time_max_sec = time_sec * (1.0f + PWR_BAT_TIME_FAST_BOUNDS);
+  } else {
+    //expected time from the mean power of the load history, bounds from its high and low percentiles
+    time_sec = energy_Ws * total_weight / total_power;
+    time_min_sec = MIN(energy_Ws / this->GetLoadHistoryPercentile(PWR_BAT_TIME_HIST_PERCENTILE_HIGH, total_weight), time_sec * (1.0f - PWR_BAT_TIME_MIN_BOUNDS));
+    time_max_sec = MAX(energy_Ws / this->GetLoadHistoryPercentile(PWR_BAT_TIME_HIST_PERCENTILE_LOW, total_weight), time_sec * (1.0f + PWR_BAT_TIME_MIN_BOUNDS));
+  }
+
+  estimate.time_sec = _Power_TimeToSeconds(time_sec);
+  estimate.time_min_sec = _Power_TimeToSeconds(time_min_sec);
+  estimate.time_max_sec = _Power_TimeToSeconds(time_max_sec);
+  return estimate;
+}
+
+uint32_t PowerManager::GetEstimatedBatteryTimeSeconds() const {
+  return this->GetBatteryTimeEstimate().time_sec;
+}
+
+
+void PowerManager::ResetBatteryTimeEstimation() {
+  this->fast_discharge_power_W = 0.0f;
+  this->discharge_cycles = 0;
+  this->charge_cycles = 0;
+  this->hist_entry_power_sum = 0.0f;
+  this->hist_entry_cycles = 0;
+  memset(this->hist_weights, 0, sizeof(this->hist_weights));
+  memset(this->hist_power_sums, 0, sizeof(this->hist_power_sums));
+  this->hist_volume_dB = NAN;
+  this->hist_pvdd_V = NAN;
+}
+
+void PowerManager::UpdateBatteryTimeEstimation(float power_W) {
+  //fast average, started from the first measurement
+  if (this->discharge_cycles++ == 0) {
+    this->fast_discharge_power_W = power_W;
+  } else {
+    this->fast_discharge_power_W = PWR_BAT_TIME_EMA_ALPHA * power_W + PWR_BAT_TIME_EMA_1MALPHA * this->fast_discharge_power_W;
+  }
+
+  //large volume or PVDD target changes: the load history doesn't represent the coming load anymore, so let new entries take over faster
+  float volume_dB = this->system.audio_mgr.GetCurrentVolumeDB();
+  float pvdd_V = this->system.amp_if.GetPVDDTargetVoltage();
+  if (isnanf(this->hist_volume_dB) || isnanf(this->hist_pvdd_V)) {
+    this->hist_volume_dB = volume_dB;
+    this->hist_pvdd_V = pvdd_V;
+  } else if (fabsf(volume_dB - this->hist_volume_dB) >= PWR_BAT_TIME_REGIME_VOLUME_DB || fabsf(pvdd_V - this->hist_pvdd_V) >= PWR_BAT_TIME_REGIME_PVDD_V) {
+    for (uint32_t i = 0; i < PWR_BAT_TIME_HIST_BINS; i++) {
+      this->hist_weights[i] *= PWR_BAT_TIME_REGIME_WEIGHT;
+      this->hist_power_sums[i] *= PWR_BAT_TIME_REGIME_WEIGHT;
+    }
+    this->hist_volume_dB = volume_dB;
+    this->hist_pvdd_V = pvdd_V;
+  }
+
+  //accumulate average power over the current entry period
+  this->hist_entry_power_sum += power_W;
+  if (++this->hist_entry_cycles < PWR_BAT_TIME_HIST_ENTRY_CYCLES) {
+    return;
+  }
+
+  float avg_power_W = this->hist_entry_power_sum / (float)this->hist_entry_cycles;
+  this->hist_entry_power_sum = 0.0f;
+  this->hist_entry_cycles = 0;
+
+  //age existing entries, then add the new one to its logarithmic bin
+  uint32_t bin = 0;
+  if (avg_power_W >= PWR_BAT_TIME_HIST_MIN_W) {
+    bin = 1 + (uint32_t)(2.0f * log2f(avg_power_W / PWR_BAT_TIME_HIST_MIN_W));
+    bin = MIN(bin, PWR_BAT_TIME_HIST_BINS - 1);
+  }
+  for (uint32_t i = 0; i < PWR_BAT_TIME_HIST_BINS; i++) {
+    this->hist_weights[i] *= PWR_BAT_TIME_HIST_DECAY;
+    this->hist_power_sums[i] *= PWR_BAT_TIME_HIST_DECAY;
+  }
+  this->hist_weights[bin] += 1.0f;
+  this->hist_power_sums[bin] += avg_power_W;
+}
+
+float PowerManager::GetLoadHistoryPercentile(float fraction, float total_weight) const {
+  //mean power of the bin containing the given fraction of the total weight
+  float target_weight = fraction * total_weight;
+  float cumulative_weight = 0.0f;
+  float power_W = 0.0f;
+  for (uint32_t i = 0; i < PWR_BAT_TIME_HIST_BINS; i++) {
+    if (this->hist_weights[i] <= 0.0f) {
+      continue;
+    }
+    power_W = this->hist_power_sums[i] / this->hist_weights[i];
+    cumulative_weight += this->hist_weights[i];
+    if (cumulative_weight >= target_weight) {
+      break;
+    }
+  }
+  return power_W;
+}
@@ -23,14 +23,20 @@
 #define MODIF_DAP_EVENT_INPUTS_UPDATE (1u << 9)
 #define MODIF_DAP_EVENT_INPUT_RATE_UPDATE (1u << 10)
 #define MODIF_DAP_EVENT_SRC_STATS_UPDATE (1u << 11)
+#define MODIF_DAP_EVENT_OUTPUT_PEAKS_UPDATE (1u << 12)
 
 //reset timeout, in main loop cycles
 #define IF_DAP_RESET_TIMEOUT (1000 / MAIN_LOOP_PERIOD_MS)
 
+//output level monitoring read period, in main loop cycles - envelope rises are read on interrupt, this period mainly serves envelope releases
+#define IF_DAP_OUTPUT_PEAKS_PERIOD (100 / MAIN_LOOP_PERIOD_MS)
+
 //minimum/maximum volume and loudness gains
 #define IF_DAP_VOLUME_GAIN_MIN -120.0f
 #define IF_DAP_VOLUME_GAIN_MAX 20.0f
 #define IF_DAP_LOUDNESS_GAIN_MAX 0.0f
+//maximum delay of delayed volume gains, in output batches (96 samples each)
+#define IF_DAP_VOLUME_GAIN_DELAY_MAX 1000
 
 
 //DAP status
@@ -89,6 +95,18 @@ typedef struct {
   float ch2;
 } DAPGains;
 
+//DAP delayed volume gains: gains and delay in output batches
+typedef struct {
+  DAPGains gains;
+  uint32_t delay_batches;
+} DAPDelayedGains;
+
+//DAP signal levels, as fraction of full scale
+typedef struct {
+  float ch1;
+  float ch2;
+} DAPLevels;
+
 //DAP channel
 typedef enum {
   IF_DAP_CH1 = 1,
@@ -112,6 +130,8 @@ typedef struct {
 
 static_assert(sizeof(DAPMixerConfig) == 16);
 static_assert(sizeof(DAPGains) == 8);
+static_assert(sizeof(DAPDelayedGains) == 12);
+static_assert(sizeof(DAPLevels) == 8);
 static_assert(sizeof(DAPBiquadSetup) == 4);
 static_assert(sizeof(DAPFIRSetup) == 4);
 
@@ -129,6 +149,8 @@ class DAPInterface : public IntRegI2CModuleInterface {
 public:
   //whether SRC stats (input rate error and buffer fill error) are continuously monitored or not - may be changed at any time
   bool monitor_src_stats;
+  //whether output levels (envelope and peaks) are continuously monitored or not - may be changed at any time
+  bool monitor_output_peaks;
 
   DAPStatus GetStatus() const;
 
@@ -148,6 +170,11 @@ public:
   DAPGains GetVolumeGains() const;
   DAPGains GetLoudnessGains() const;
 
+  //look-ahead output envelope: upper bound of the output peaks within the DAP output delay (48ms), i.e. of the audio that is about to be output
+  DAPLevels GetOutputEnvelopeLevels() const;
+  //output peak levels since the last peak reset
+  DAPLevels GetOutputPeakLevels() const;
+
   const q31_t* GetBiquadCoefficients(DAPChannel channel) const;
   DAPBiquadSetup GetBiquadSetup() const;
 
@@ -165,8 +192,14 @@ public:
 
   void SetMixerConfig(DAPMixerConfig config, SuccessCallback&& callback);
   void SetVolumeGains(DAPGains gains, SuccessCallback&& callback);
+  //schedules the given volume gains to be applied after the given number of output batches, for synchronisation with other gain changes
+  //success means the gains are scheduled - the locally known volume gains are updated to the scheduled ones right away
+  void SetVolumeGainsDelayed(DAPGains gains, uint32_t delay_batches, SuccessCallback&& callback);
   void SetLoudnessGains(DAPGains gains, SuccessCallback&& callback);
 
+  //resets the module's output peak levels of both channels
+  void ResetOutputPeakLevels(SuccessCallback&& callback);
+
   void SetBiquadCoefficients(DAPChannel channel, const q31_t* coeff_buffer, SuccessCallback&& callback);
   void SetBiquadSetup(DAPBiquadSetup setup, SuccessCallback&& callback);
 
@@ -91,6 +91,20 @@ typedef enum {
   IF_HIFIDAC_FILTER_MIN_PHASE_SRO_LD = 7
 } HiFiDACFilterShape;
 
+//HiFiDAC static signal chain configuration, applied together through staged register writes
+typedef struct {
+  HiFiDACSignalPathSetup path_setup;
+  HiFiDACInternalClockConfig clock_config;
+  uint8_t tdm_slot_count;
+  uint8_t tdm_slot_ch1;
+  uint8_t tdm_slot_ch2;
+  HiFiDACFilterShape filter_shape;
+  int16_t thd_c2_ch1;
+  int16_t thd_c2_ch2;
+  int16_t thd_c3_ch1;
+  int16_t thd_c3_ch2;
+} HiFiDACSignalChainSetup;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -146,6 +160,9 @@ public:
   void SetSecondHarmonicCorrectionCoefficients(int16_t thd_c2_ch1, int16_t thd_c2_ch2, SuccessCallback&& callback);
   void SetThirdHarmonicCorrectionCoefficients(int16_t thd_c3_ch1, int16_t thd_c3_ch2, SuccessCallback&& callback);
 
+  //applies the whole signal chain setup, only writing registers that differ from the known module state, merged into multi-register writes
+  void SetSignalChainSetup(const HiFiDACSignalChainSetup& setup, SuccessCallback&& callback);
+
 
   void InitModule(SuccessCallback&& callback);
   void LoopTasks() override;
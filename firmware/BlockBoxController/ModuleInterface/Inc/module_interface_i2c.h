@@ -23,6 +23,19 @@
 //timeout for interrupt handling, in main loop cycles
 #define MODIF_I2C_INT_HANDLING_TIMEOUT (200 / MAIN_LOOP_PERIOD_MS)
 
+//default period of the fallback refresh of all interrupt refresh groups, in main loop cycles - normally, groups are refreshed by interrupts
+#define MODIF_I2C_REFRESH_WATCHDOG_PERIOD (2000 / MAIN_LOOP_PERIOD_MS)
+//maximum total size of a refresh group in bytes
+#define MODIF_I2C_REFRESH_GROUP_MAX_SIZE 64
+
+
+//group of consecutive registers of an interrupt-enabled module, which is re-read when any of the given interrupt flags is raised
+typedef struct {
+  uint16_t int_flags;
+  uint8_t reg_addr_first;
+  uint8_t reg_count;
+} IntRegI2CRefreshGroup;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -146,6 +159,13 @@ public:
   void WriteMultiRegister(uint8_t reg_addr_first, const uint8_t* buf, uint8_t count);
   void WriteMultiRegisterAsync(uint8_t reg_addr_first, const uint8_t* buf, uint8_t count, ModuleTransferCallback&& callback);
 
+  //stages the given value (of register size) as the register's desired value, to be written by the next flush - skipped if the module is already
+  //known to hold that value. Returns whether the register is dirty (i.e. needs to be written) afterwards
+  bool StageRegister(uint8_t reg_addr, const uint8_t* buf);
+  //writes all dirty registers, merging runs of consecutive ones into multi-register writes, and reads them back for confirmation.
+  //callback reports whether all of them were confirmed (success right away if nothing is dirty); unconfirmed registers stay dirty
+  void FlushRegistersAsync(SuccessCallback&& callback);
+
   RegI2CModuleInterface(I2CHardwareInterface& hw_interface, uint8_t i2c_address, const uint16_t* reg_sizes, bool use_crc = true);
   RegI2CModuleInterface(I2CHardwareInterface& hw_interface, uint8_t i2c_address, std::initializer_list<uint16_t> reg_sizes, bool use_crc = true);
 
@@ -181,6 +201,21 @@ protected:
   uint8_t int_reg_size; //size of interrupt mask/flags registers: 1 = one byte, 2 = two bytes
   uint32_t current_interrupt_timer;
 
+  //invalidates all stored register values if the given interrupt flags indicate a module reset
+  void HandleResetFlag(uint16_t interrupt_flags) noexcept;
+
+  //register groups to refresh on interrupts (static storage, not copied)
+  const IntRegI2CRefreshGroup* refresh_groups;
+  uint8_t refresh_group_count;
+  uint32_t refresh_watchdog_period;
+  uint32_t refresh_watchdog_timer;
+
+  void SetRefreshGroups(const IntRegI2CRefreshGroup* groups, uint8_t count, uint32_t watchdog_period = MODIF_I2C_REFRESH_WATCHDOG_PERIOD);
+  //reads all refresh groups matching any of the given interrupt flags
+  void RefreshGroups(uint16_t interrupt_flags);
+  //fallback refresh of all groups every watchdog period, for missed changes or ones without interrupt - to be called in LoopTasks while the module is initialised
+  void RefreshWatchdogTasks();
+
   void CheckInterruptRegisterDefinitions();
 
   virtual void OnI2CInterrupt(uint16_t interrupt_flags);
@@ -22,10 +22,15 @@
 #define MODIF_POWERAMP_EVENT_SAFETY_UPDATE (1u << 9)
 #define MODIF_POWERAMP_EVENT_PVDD_UPDATE (1u << 10)
 #define MODIF_POWERAMP_EVENT_MEASUREMENT_UPDATE (1u << 11)
+#define MODIF_POWERAMP_EVENT_SPEAKER_UPDATE (1u << 12)
 
 //reset timeout, in main loop cycles
 #define IF_POWERAMP_RESET_TIMEOUT (1000 / MAIN_LOOP_PERIOD_MS)
 
+//fallback refresh period of interrupt-driven registers, in main loop cycles - kept at the former PVDD polling rate, since the measured PVDD
+//voltage and some status bits change without interrupt
+#define IF_POWERAMP_REFRESH_PERIOD (1000 / MAIN_LOOP_PERIOD_MS)
+
 //minimum and maximum requestable PVDD targets
 #define IF_POWERAMP_PVDD_TARGET_MIN 18.7f
 #define IF_POWERAMP_PVDD_TARGET_MAX 53.5f
@@ -44,7 +49,8 @@ typedef union {
     bool safety_warning : 1;
     bool clip_detected : 1;
     bool otw_detected : 1;
-    int : 5;
+    bool speaker_limit : 1;
+    int : 4;
     bool i2c_error : 1;
   };
   uint16_t value;
@@ -66,6 +72,15 @@ typedef struct {
   PowerAmpChannelValues power_apparent;
 } PowerAmpMeasurements;
 
+//Power amp speaker thermal model parameters
+typedef struct {
+  PowerAmpChannelValues rth_coil;
+  PowerAmpChannelValues tau_coil;
+  PowerAmpChannelValues rth_magnet;
+  PowerAmpChannelValues tau_magnet;
+  PowerAmpChannelValues max_temp_rise;
+} PowerAmpSpeakerModelParams;
+
 //Power amp per-channel and sum thresholds
 typedef struct {
   float ch_a;
@@ -109,7 +124,8 @@ typedef union {
     bool current_rms_slow : 1;
     bool current_rms_fast : 1;
     bool current_rms_instantaneous : 1;
-    int : 2;
+    bool current_peak : 1;
+    int : 1;
   };
   uint16_t value;
 } PowerAmpErrWarnSource;
@@ -117,6 +133,7 @@ typedef union {
 
 static_assert(sizeof(PowerAmpMeasurements) == 16 * sizeof(float));
 static_assert(sizeof(PowerAmpThresholdSet) == 15 * sizeof(float));
+static_assert(sizeof(PowerAmpSpeakerModelParams) == 20 * sizeof(float));
 
 
 #ifdef __cplusplus
@@ -132,6 +149,8 @@ class PowerAmpInterface : public IntRegI2CModuleInterface {
 public:
   //whether output measurements (voltage, current, power) are continuously monitored or not - may be changed at any time
   bool monitor_measurements;
+  //whether speaker model outputs (temperature rise, gain reduction) are continuously monitored or not - may be changed at any time
+  bool monitor_speaker_model;
 
   PowerAmpStatus GetStatus() const;
 
@@ -150,6 +169,12 @@ public:
 
   PowerAmpThresholdSet GetSafetyThresholds(PowerAmpThresholdType type) const;
 
+  //modelled voice coil temperature rise in K
+  PowerAmpChannelValues GetSpeakerTemperatureRise() const;
+  //requested gain reduction in dB (0 or negative)
+  PowerAmpChannelValues GetSpeakerGainReduction() const;
+  PowerAmpSpeakerModelParams GetSpeakerModelParams() const;
+
 
   void SetManualShutdownActive(bool manual_shutdown, SuccessCallback&& callback);
 
@@ -159,6 +184,9 @@ public:
 
   void SetSafetyThresholds(PowerAmpThresholdType type, const PowerAmpThresholdSet* thresholds, SuccessCallback&& callback);
 
+  //only permitted during manual shutdown
+  void SetSpeakerModelParams(const PowerAmpSpeakerModelParams* params, SuccessCallback&& callback);
+
 
   void InitModule(SuccessCallback&& callback);
   void LoopTasks() override;
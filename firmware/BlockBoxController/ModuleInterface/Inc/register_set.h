@@ -41,14 +41,36 @@ public:
   uint32_t& Reg32(uint8_t reg_addr);
   uint32_t Reg32(uint8_t reg_addr) const;
 
+  //valid = stored value is known to reflect the module state (set on data updates, cleared e.g. on module reset)
+  bool IsValid(uint8_t reg_addr) const noexcept;
+  void SetValid(uint8_t reg_addr, bool valid) noexcept;
+  void InvalidateAll() noexcept;
+
+  //dirty = a desired value has been staged for the register, which hasn't been confirmed on the module yet
+  bool IsDirty(uint8_t reg_addr) const noexcept;
+  void SetDirty(uint8_t reg_addr, bool dirty) noexcept;
+  bool AnyDirty() const noexcept;
+
+  //desired-value shadow of the given register, same size as the register itself (allocated on first access)
+  uint8_t* Desired(uint8_t reg_addr);
+  const uint8_t* Desired(uint8_t reg_addr) const;
+
+  //whether the register is valid and its stored value equals the given value (of register size)
+  bool Matches(uint8_t reg_addr, const void* value) const;
+
   RegisterSet(const uint16_t* reg_sizes);
   RegisterSet(std::initializer_list<uint16_t> reg_sizes);
 
 protected:
   std::vector<uint8_t> data;
+  std::vector<uint8_t> desired;
   uint16_t data_offsets[256];
   uint16_t _reg_sizes[256];
 
+  //per-register flag bitmaps
+  uint32_t valid_flags[8];
+  uint32_t dirty_flags[8];
+
   void Init(const uint16_t* reg_sizes);
 };
 
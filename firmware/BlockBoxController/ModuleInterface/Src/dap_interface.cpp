@@ -17,11 +17,21 @@ static_assert(MODIF_I2C_INT_RESET_FLAG == I2CDEF_DAP_INT_FLAGS_INT_RESET_Msk);
 //write buffers for larger structures - TODO make something more flexible if overlapping writes become a problem
 static DAPMixerConfig mixer_write_buf;
 static DAPGains volume_write_buf;
+static DAPDelayedGains volume_delayed_write_buf;
 static DAPGains loudness_write_buf;
 
 //scratch space for register discard-reads
 static uint8_t dap_scratch[1200];
 
+//register groups refreshed on interrupts
+static const IntRegI2CRefreshGroup dap_refresh_groups[] = {
+  { I2CDEF_DAP_INT_FLAGS_INT_SRC_READY_Msk | I2CDEF_DAP_INT_FLAGS_INT_STATUS_Msk, I2CDEF_DAP_STATUS, 1 },
+  { I2CDEF_DAP_INT_FLAGS_INT_ACTIVE_INPUT_Msk, I2CDEF_DAP_INPUT_ACTIVE, 1 },
+  { I2CDEF_DAP_INT_FLAGS_INT_INPUT_AVAILABLE_Msk, I2CDEF_DAP_INPUTS_AVAILABLE, 1 },
+  { I2CDEF_DAP_INT_FLAGS_INT_INPUT_RATE_Msk, I2CDEF_DAP_SRC_INPUT_RATE, 1 },
+  { I2CDEF_DAP_INT_FLAGS_INT_OUTPUT_ENVELOPE_Msk, I2CDEF_DAP_OUTPUT_PEAKS, 1 }
+};
+
 
 DAPStatus DAPInterface::GetStatus() const {
   DAPStatus status;
@@ -113,6 +123,19 @@ DAPGains DAPInterface::GetLoudnessGains() const {
 }
 
 
+DAPLevels DAPInterface::GetOutputEnvelopeLevels() const {
+  DAPLevels levels;
+  memcpy(&levels, this->registers[I2CDEF_DAP_OUTPUT_PEAKS], sizeof(DAPLevels));
+  return levels;
+}
+
+DAPLevels DAPInterface::GetOutputPeakLevels() const {
+  DAPLevels levels;
+  memcpy(&levels, this->registers[I2CDEF_DAP_OUTPUT_PEAKS] + sizeof(DAPLevels), sizeof(DAPLevels));
+  return levels;
+}
+
+
 const q31_t* DAPInterface::GetBiquadCoefficients(DAPChannel channel) const {
   switch (channel) {
     case IF_DAP_CH1:
@@ -257,6 +280,38 @@ void DAPInterface::SetVolumeGains(DAPGains gains, SuccessCallback&& callback) {
   });
 }
 
+void DAPInterface::SetVolumeGainsDelayed(DAPGains gains, uint32_t delay_batches, SuccessCallback&& callback) {
+  bool sp_enabled, pos_gain_allowed;
+  this->GetConfig(sp_enabled, pos_gain_allowed);
+  if (isnanf(gains.ch1) || gains.ch1 < IF_DAP_VOLUME_GAIN_MIN || gains.ch1 > (pos_gain_allowed ? IF_DAP_VOLUME_GAIN_MAX : 0.0f) ||
+      isnanf(gains.ch2) || gains.ch2 < IF_DAP_VOLUME_GAIN_MIN || gains.ch2 > (pos_gain_allowed ? IF_DAP_VOLUME_GAIN_MAX : 0.0f)) {
+    throw std::invalid_argument("DAPInterface SetVolumeGainsDelayed given invalid gains - must be in range [-120, 0] or [-120, 20] if positive gain is allowed");
+  }
+  if (delay_batches > IF_DAP_VOLUME_GAIN_DELAY_MAX) {
+    throw std::invalid_argument("DAPInterface SetVolumeGainsDelayed given invalid delay - must be 1000 batches or less");
+  }
+
+  volume_delayed_write_buf.gains = gains;
+  volume_delayed_write_buf.delay_batches = delay_batches;
+
+  //write desired gains and delay
+  this->WriteRegisterAsync(I2CDEF_DAP_VOLUME_GAINS_DELAYED, (const uint8_t*)&volume_delayed_write_buf, [this, callback = std::move(callback), gains](bool, uint32_t, uint16_t) {
+    //read back to ensure correctness - gives the gains that are active after the delay, regardless of whether they're applied already
+    this->ReadRegisterAsync(I2CDEF_DAP_VOLUME_GAINS_DELAYED, dap_scratch, [this, callback = std::move(callback), gains](bool success, uint32_t, uint16_t) {
+      bool correct = success && memcmp(this->registers[I2CDEF_DAP_VOLUME_GAINS_DELAYED], &gains, sizeof(DAPGains)) == 0;
+      if (correct) {
+        //gains are scheduled: update known volume gains already, so subsequent changes are based on them
+        memcpy(this->_registers[I2CDEF_DAP_VOLUME_GAINS], &gains, sizeof(DAPGains));
+      }
+
+      //report result (and gain correctness) to external callback
+      if (callback) {
+        callback(correct);
+      }
+    });
+  });
+}
+
 void DAPInterface::SetLoudnessGains(DAPGains gains, SuccessCallback&& callback) {
   if (isnanf(gains.ch1) || gains.ch1 > IF_DAP_LOUDNESS_GAIN_MAX ||
       isnanf(gains.ch2) || gains.ch2 > IF_DAP_LOUDNESS_GAIN_MAX) {
@@ -276,6 +331,14 @@ void DAPInterface::SetLoudnessGains(DAPGains gains, SuccessCallback&& callback)
 }
 
 
+void DAPInterface::ResetOutputPeakLevels(SuccessCallback&& callback) {
+  //write reset for both channels - write-only register, so no readback
+  this->WriteRegister8Async(I2CDEF_DAP_OUTPUT_PEAKS_RESET, 0x03, callback ? [callback = std::move(callback)](bool success, uint32_t, uint16_t) {
+    callback(success);
+  } : ModuleTransferCallback());
+}
+
+
 static inline void _DAPInterface_EnsureSignalProcessorDisabled(const DAPInterface* dap_if) {
   bool sp_enabled, pos_gain_allowed;
   dap_if->GetConfig(sp_enabled, pos_gain_allowed);
@@ -403,7 +466,7 @@ void DAPInterface::InitModule(SuccessCallback&& callback) {
     }
 
     //write interrupt mask (enable all interrupts)
-    this->SetInterruptMask(0xF, [this, callback = std::move(callback)](bool success) {
+    this->SetInterruptMask(0x3F, [this, callback = std::move(callback)](bool success) {
       if (!success) {
         //report failure to external callback
         if (callback) {
@@ -444,15 +507,21 @@ void DAPInterface::InitModule(SuccessCallback&& callback) {
 void DAPInterface::LoopTasks() {
   static uint32_t loop_count = 0;
 
-  if (this->initialised && loop_count++ % 50 == 0) {
-    //every 50 cycles (500ms), read status - no callback needed, we're only reading to update the register
-    this->ReadRegister8Async(I2CDEF_DAP_STATUS, ModuleTransferCallback());
+  if (this->initialised) {
+    //status, inputs and input rate are read on interrupts - only refresh them rarely, as a fallback
+    this->RefreshWatchdogTasks();
 
-    //if SRC stats monitoring is requested, read the corresponding registers periodically too
-    if (this->monitor_src_stats) {
-      this->ReadRegister32Async(I2CDEF_DAP_SRC_RATE_ERROR, ModuleTransferCallback());
-      this->ReadRegister32Async(I2CDEF_DAP_SRC_BUFFER_ERROR, ModuleTransferCallback());
+    if (this->monitor_src_stats && loop_count % 50 == 0) {
+      //if SRC stats monitoring is requested, read the corresponding registers every 50 cycles (500ms) - they change continuously, without interrupt
+      this->ReadMultiRegisterAsync(I2CDEF_DAP_SRC_RATE_ERROR, dap_scratch, 2, ModuleTransferCallback());
     }
+
+    if (this->monitor_output_peaks && loop_count % IF_DAP_OUTPUT_PEAKS_PERIOD == 0) {
+      //if output level monitoring is requested, read the levels more frequently (envelope rises are also read on interrupt, this catches the releases)
+      this->ReadRegisterAsync(I2CDEF_DAP_OUTPUT_PEAKS, dap_scratch, ModuleTransferCallback());
+    }
+
+    loop_count++;
   }
 
   //allow base handling
@@ -478,7 +547,9 @@ void DAPInterface::LoopTasks() {
 
 
 DAPInterface::DAPInterface(I2CHardwareInterface& hw_interface, uint8_t i2c_address, GPIO_TypeDef* int_port, uint16_t int_pin) :
-    IntRegI2CModuleInterface(hw_interface, i2c_address, I2CDEF_DAP_REG_SIZES, int_port, int_pin, IF_DAP_USE_CRC), monitor_src_stats(false), initialised(false), reset_wait_timer(0) {}
+    IntRegI2CModuleInterface(hw_interface, i2c_address, I2CDEF_DAP_REG_SIZES, int_port, int_pin, IF_DAP_USE_CRC), monitor_src_stats(false), monitor_output_peaks(false), initialised(false), reset_wait_timer(0) {
+  this->SetRefreshGroups(dap_refresh_groups, sizeof(dap_refresh_groups) / sizeof(IntRegI2CRefreshGroup));
+}
 
 
 
@@ -504,6 +575,9 @@ void DAPInterface::OnRegisterUpdate(uint8_t address) {
     case I2CDEF_DAP_SRC_BUFFER_ERROR:
       event = MODIF_DAP_EVENT_SRC_STATS_UPDATE;
       break;
+    case I2CDEF_DAP_OUTPUT_PEAKS:
+      event = MODIF_DAP_EVENT_OUTPUT_PEAKS_UPDATE;
+      break;
     default:
       return;
   }
@@ -534,25 +608,5 @@ void DAPInterface::OnI2CInterrupt(uint16_t interrupt_flags) {
     }
     return;
   }
-
-  if ((interrupt_flags & I2CDEF_DAP_INT_FLAGS_INT_SRC_READY_Msk) != 0) {
-    //SRC ready state changed: read status
-    this->ReadRegister8Async(I2CDEF_DAP_STATUS, ModuleTransferCallback());
-  }
-
-  if ((interrupt_flags & I2CDEF_DAP_INT_FLAGS_INT_ACTIVE_INPUT_Msk) != 0) {
-    //active input changed: read active input
-    this->ReadRegister8Async(I2CDEF_DAP_INPUT_ACTIVE, ModuleTransferCallback());
-  }
-
-  if ((interrupt_flags & I2CDEF_DAP_INT_FLAGS_INT_INPUT_AVAILABLE_Msk) != 0) {
-    //available inputs changed: read available inputs
-    this->ReadRegister8Async(I2CDEF_DAP_INPUTS_AVAILABLE, ModuleTransferCallback());
-  }
-
-  if ((interrupt_flags & I2CDEF_DAP_INT_FLAGS_INT_INPUT_RATE_Msk) != 0) {
-    //input rate changed: read input rate
-    this->ReadRegister32Async(I2CDEF_DAP_SRC_INPUT_RATE, ModuleTransferCallback());
-  }
 }
 
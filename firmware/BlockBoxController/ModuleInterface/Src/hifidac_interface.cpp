@@ -15,6 +15,12 @@ static_assert(MODIF_I2C_INT_RESET_FLAG == I2CDEF_HIFIDAC_INT_FLAGS_INT_RESET_Msk
 
 static uint8_t hifidac_scratch[16];
 
+//register groups refreshed on interrupts: all DAC interrupts just affect the status register
+static const IntRegI2CRefreshGroup hifidac_refresh_groups[] = {
+  { I2CDEF_HIFIDAC_INT_FLAGS_INT_LOCK_Msk | I2CDEF_HIFIDAC_INT_FLAGS_INT_AUTOMUTE_Msk | I2CDEF_HIFIDAC_INT_FLAGS_INT_RAMP_Msk | I2CDEF_HIFIDAC_INT_FLAGS_INT_MONITOR_Msk,
+    I2CDEF_HIFIDAC_STATUS, 1 }
+};
+
 
 HiFiDACStatus HiFiDACInterface::GetStatus() const {
   HiFiDACStatus status;
@@ -294,6 +300,43 @@ void HiFiDACInterface::SetThirdHarmonicCorrectionCoefficients(int16_t thd_c3_ch1
 
 
 
+void HiFiDACInterface::SetSignalChainSetup(const HiFiDACSignalChainSetup& setup, SuccessCallback&& callback) {
+  if (setup.tdm_slot_count < 1 || setup.tdm_slot_count > 32) {
+    throw std::invalid_argument("HiFiDACInterface SetSignalChainSetup given invalid slot count - must be in range [1, 32]");
+  }
+  if (setup.tdm_slot_ch1 >= setup.tdm_slot_count || setup.tdm_slot_ch2 >= setup.tdm_slot_count) {
+    throw std::invalid_argument("HiFiDACInterface SetSignalChainSetup given invalid slots - must be in range [0, slot_count - 1]");
+  }
+  if ((uint8_t)setup.filter_shape > 7) {
+    throw std::invalid_argument("HiFiDACInterface SetSignalChainSetup given invalid filter shape");
+  }
+
+  //stage register values, encoded like in the individual setters
+  uint8_t path_val = setup.path_setup.value & 0x7F;
+  this->StageRegister(I2CDEF_HIFIDAC_PATH, &path_val);
+
+  this->StageRegister(I2CDEF_HIFIDAC_CLK_CFG, &setup.clock_config.value);
+
+  uint8_t count_val = setup.tdm_slot_count - 1;
+  this->StageRegister(I2CDEF_HIFIDAC_TDM_SLOT_NUM, &count_val);
+
+  uint8_t slots_val[2] = { setup.tdm_slot_ch1, setup.tdm_slot_ch2 };
+  this->StageRegister(I2CDEF_HIFIDAC_CH_SLOTS, slots_val);
+
+  uint8_t filter_val = (uint8_t)setup.filter_shape;
+  this->StageRegister(I2CDEF_HIFIDAC_FILTER_SHAPE, &filter_val);
+
+  int16_t thd_c2_val[2] = { setup.thd_c2_ch1, setup.thd_c2_ch2 };
+  this->StageRegister(I2CDEF_HIFIDAC_THD_C2, (const uint8_t*)thd_c2_val);
+
+  int16_t thd_c3_val[2] = { setup.thd_c3_ch1, setup.thd_c3_ch2 };
+  this->StageRegister(I2CDEF_HIFIDAC_THD_C3, (const uint8_t*)thd_c3_val);
+
+  //write all changed registers and confirm them
+  this->FlushRegistersAsync(std::move(callback));
+}
+
+
 void HiFiDACInterface::InitModule(SuccessCallback&& callback) {
   this->initialised = false;
 
@@ -358,11 +401,9 @@ void HiFiDACInterface::InitModule(SuccessCallback&& callback) {
 }
 
 void HiFiDACInterface::LoopTasks() {
-  static uint32_t loop_count = 0;
-
-  if (this->initialised && loop_count++ % 50 == 0) {
-    //every 50 cycles (500ms), read status - no callback needed, we're only reading to update the register
-    this->ReadRegister8Async(I2CDEF_HIFIDAC_STATUS, ModuleTransferCallback());
+  if (this->initialised) {
+    //status is read on interrupts, only refresh it rarely as a fallback
+    this->RefreshWatchdogTasks();
   }
 
   //allow base handling
@@ -388,7 +429,9 @@ void HiFiDACInterface::LoopTasks() {
 
 
 HiFiDACInterface::HiFiDACInterface(I2CHardwareInterface& hw_interface, uint8_t i2c_address, GPIO_TypeDef* int_port, uint16_t int_pin) :
-        IntRegI2CModuleInterface(hw_interface, i2c_address, I2CDEF_HIFIDAC_REG_SIZES, int_port, int_pin, IF_HIFIDAC_USE_CRC), initialised(false), reset_wait_timer(0) {}
+        IntRegI2CModuleInterface(hw_interface, i2c_address, I2CDEF_HIFIDAC_REG_SIZES, int_port, int_pin, IF_HIFIDAC_USE_CRC), initialised(false), reset_wait_timer(0) {
+  this->SetRefreshGroups(hifidac_refresh_groups, sizeof(hifidac_refresh_groups) / sizeof(IntRegI2CRefreshGroup));
+}
 
 
 void HiFiDACInterface::OnRegisterUpdate(uint8_t address) {
@@ -422,9 +465,6 @@ void HiFiDACInterface::OnI2CInterrupt(uint16_t interrupt_flags) {
       });
     }
     return;
-  } else if (interrupt_flags != 0) {
-    //all other DAC interrupts just affect the status register, so read that
-    this->ReadRegister8Async(I2CDEF_HIFIDAC_STATUS, ModuleTransferCallback());
   }
 }
 
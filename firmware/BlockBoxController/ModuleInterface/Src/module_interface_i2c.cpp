@@ -8,6 +8,7 @@
 
 #include "module_interface_i2c.h"
 #include "system.h"
+#include <memory>
 
 
 //timeouts for clock extension and low clock, in units of 2048 I2CCLK cycles (not to be confused with SCL cycles!)
@@ -1181,6 +1182,166 @@ void RegI2CModuleInterface::WriteMultiRegisterAsync(uint8_t reg_addr_first, cons
 }
 
 
+/*********************************************************/
+/*      Reg I2C Module Interface - Staged Writes         */
+/*********************************************************/
+
+//shared state of a register flush, across all of its transfers
+typedef struct {
+  SuccessCallback callback;
+  uint32_t pending_runs;
+  bool success;
+} _RegI2C_FlushState;
+
+//finishes one run of a register flush, reporting the overall result once all runs are done
+static void _RegI2C_FinishFlushRun(const std::shared_ptr<_RegI2C_FlushState>& state, bool success) {
+  if (!success) {
+    state->success = false;
+  }
+
+  if (state->pending_runs > 0 && --state->pending_runs == 0 && state->callback) {
+    state->callback(state->success);
+  }
+}
+
+
+bool RegI2CModuleInterface::StageRegister(uint8_t reg_addr, const uint8_t* buf) {
+  uint16_t length = this->GetRegisterSize(reg_addr);
+
+  if (buf == NULL) {
+    throw std::invalid_argument("RegI2CModuleInterface StageRegister requires a non-null buffer");
+  }
+
+  //get desired-value shadow first (may allocate)
+  uint8_t* desired = this->_registers.Desired(reg_addr);
+
+  //compare and stage under disabled interrupts, since register updates happen in the interrupt context
+  bool dirty;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (this->_registers.Matches(reg_addr, buf)) {
+    //module already holds the given value: nothing to write (drops any different value staged before)
+    this->_registers.SetDirty(reg_addr, false);
+    dirty = false;
+  } else {
+    memcpy(desired, buf, length);
+    this->_registers.SetDirty(reg_addr, true);
+    dirty = true;
+  }
+  __set_PRIMASK(primask);
+
+  return dirty;
+}
+
+
+void RegI2CModuleInterface::FlushRegistersAsync(SuccessCallback&& callback) {
+  //collect runs of consecutive dirty registers (register 255 can't be part of a multi-transfer, total length limited to 16 bits)
+  uint8_t run_first[128];
+  uint8_t run_count[128];
+  uint32_t runs = 0;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t run_length = 0;
+  for (int reg = 1; reg < 256; reg++) {
+    if (!this->_registers.IsDirty(reg)) {
+      continue;
+    }
+
+    uint16_t size = this->_registers.reg_sizes[reg];
+    if (runs > 0 && run_first[runs - 1] + run_count[runs - 1] == reg && reg < 255 && run_length + size <= UINT16_MAX) {
+      //continue current run
+      run_count[runs - 1]++;
+      run_length += size;
+    } else {
+      //start new run
+      run_first[runs] = (uint8_t)reg;
+      run_count[runs] = 1;
+      run_length = size;
+      runs++;
+    }
+  }
+  __set_PRIMASK(primask);
+
+  if (runs == 0) {
+    //nothing to write
+    if (callback) {
+      callback(true);
+    }
+    return;
+  }
+
+  auto state = std::make_shared<_RegI2C_FlushState>();
+  state->callback = std::move(callback);
+  state->pending_runs = runs;
+  state->success = true;
+
+  for (uint32_t r = 0; r < runs; r++) {
+    uint8_t first = run_first[r];
+    uint8_t count = run_count[r];
+
+    //snapshot desired values of the run (written first, followed by space for the readback), so later staging can't alter a transfer in progress
+    uint32_t length = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      length += this->_registers.reg_sizes[first + i];
+    }
+    std::shared_ptr<uint8_t[]> buffer;
+    try {
+      buffer = std::shared_ptr<uint8_t[]>(new uint8_t[2 * length]);
+    } catch (...) {
+      //can't start the remaining runs: make sure the callback is only reported once the started ones are done, then rethrow
+      state->pending_runs -= runs - r - 1;
+      _RegI2C_FinishFlushRun(state, false);
+      throw;
+    }
+    uint8_t* desired = buffer.get();
+    uint8_t* readback = buffer.get() + length;
+    primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(desired, this->_registers.Desired(first), length);
+    __set_PRIMASK(primask);
+
+    //checks readback against the snapshot: confirmed registers are clean, unless a different value was staged in the meantime
+    auto verify = [this, state, buffer, first, count](bool success, uint32_t, uint16_t) {
+      const uint8_t* desired = buffer.get();
+      uint32_t offset = 0;
+      bool all_confirmed = success;
+      for (uint8_t i = 0; i < count; i++) {
+        uint8_t reg = first + i;
+        uint16_t size = this->_registers.reg_sizes[reg];
+        if (success && this->_registers.Matches(reg, desired + offset)) {
+          if (memcmp(this->_registers.Desired(reg), desired + offset, size) == 0) {
+            this->_registers.SetDirty(reg, false);
+          }
+        } else {
+          all_confirmed = false;
+        }
+        offset += size;
+      }
+
+      _RegI2C_FinishFlushRun(state, all_confirmed);
+    };
+
+    //write run, then read it back - single-register transfers for runs of one register
+    try {
+      if (count == 1) {
+        this->WriteRegisterAsync(first, desired, [this, first, readback, verify = std::move(verify)](bool, uint32_t, uint16_t) mutable {
+          this->ReadRegisterAsync(first, readback, std::move(verify));
+        });
+      } else {
+        this->WriteMultiRegisterAsync(first, desired, count, [this, first, count, readback, verify = std::move(verify)](bool, uint32_t, uint16_t) mutable {
+          this->ReadMultiRegisterAsync(first, readback, count, std::move(verify));
+        });
+      }
+    } catch (...) {
+      state->pending_runs -= runs - r - 1;
+      _RegI2C_FinishFlushRun(state, false);
+      throw;
+    }
+  }
+}
+
+
 /*********************************************************/
 /*     Reg I2C Module Interface - Register Handling      */
 /*********************************************************/
@@ -1200,8 +1361,9 @@ void RegI2CModuleInterface::HandleDataUpdate(uint16_t reg_addr, const uint8_t* b
 
   //ensure that the register is valid and the length matches
   if (this->_registers.reg_sizes[reg_addr_8] > 0 && length == this->_registers.reg_sizes[reg_addr_8]) {
-    //copy notification data to the corresponding register
+    //copy notification data to the corresponding register, which now reflects the module state
     memcpy(this->_registers[reg_addr_8], buf, length);
+    this->_registers.SetValid(reg_addr_8, true);
     this->OnRegisterUpdate(reg_addr_8);
   } else {
     //invalid register or length mismatch
@@ -1289,6 +1451,7 @@ void IntRegI2CModuleInterface::HandleInterrupt(ModuleInterfaceInterruptType type
 
             //clear given flags in register
             uint8_t flags = (uint8_t)value;
+            this->HandleResetFlag(flags);
             this->WriteRegister8Async(MODIF_I2C_INT_FLAGS_REG, ~flags, [this](bool, uint32_t, uint16_t) {
               //after clear, interrupt handling will be complete
               this->current_interrupt_timer = 0;
@@ -1309,6 +1472,7 @@ void IntRegI2CModuleInterface::HandleInterrupt(ModuleInterfaceInterruptType type
 
             //clear given flags in register
             uint16_t flags = (uint16_t)value;
+            this->HandleResetFlag(flags);
             this->WriteRegister16Async(MODIF_I2C_INT_FLAGS_REG, ~flags, [this](bool, uint32_t, uint16_t) {
               //after clear, interrupt handling will be complete
               this->current_interrupt_timer = 0;
@@ -1358,6 +1522,92 @@ void IntRegI2CModuleInterface::LoopTasks() {
 }
 
 
+//returns the total size of the given register range in bytes
+static uint32_t _IntRegI2C_GetRangeSize(const RegisterSet& registers, uint8_t reg_addr_first, uint8_t reg_count) {
+  uint32_t size = 0;
+  for (uint8_t i = 0; i < reg_count; i++) {
+    size += registers.reg_sizes[reg_addr_first + i];
+  }
+  return size;
+}
+
+void IntRegI2CModuleInterface::SetRefreshGroups(const IntRegI2CRefreshGroup* groups, uint8_t count, uint32_t watchdog_period) {
+  if ((groups == NULL && count > 0) || watchdog_period == 0) {
+    throw std::invalid_argument("IntRegI2CModuleInterface SetRefreshGroups requires non-null groups and a nonzero watchdog period");
+  }
+
+  //check that all groups are valid and fit into the scratch buffer
+  for (uint8_t i = 0; i < count; i++) {
+    this->GetMultiRegisterSizes(groups[i].reg_addr_first, groups[i].reg_count);
+    if (_IntRegI2C_GetRangeSize(this->registers, groups[i].reg_addr_first, groups[i].reg_count) > MODIF_I2C_REFRESH_GROUP_MAX_SIZE) {
+      throw std::invalid_argument("IntRegI2CModuleInterface refresh groups must not exceed MODIF_I2C_REFRESH_GROUP_MAX_SIZE bytes");
+    }
+  }
+
+  this->refresh_groups = groups;
+  this->refresh_group_count = count;
+  this->refresh_watchdog_period = watchdog_period;
+}
+
+void IntRegI2CModuleInterface::RefreshGroups(uint16_t interrupt_flags) {
+  //read target only - the data reaches the register set through the data update
+  static uint8_t refresh_scratch[MODIF_I2C_REFRESH_GROUP_MAX_SIZE];
+
+  //matching groups that directly follow each other (in table order and address) are merged into one read, as long as they fit the scratch buffer
+  uint8_t run_first = 0;
+  uint8_t run_count = 0;
+  for (uint16_t i = 0; i <= this->refresh_group_count; i++) {
+    const IntRegI2CRefreshGroup* group = (i < this->refresh_group_count) ? &this->refresh_groups[i] : NULL;
+    if (group != NULL && (group->int_flags & interrupt_flags) == 0) {
+      continue;
+    }
+
+    if (group != NULL && run_count > 0 && group->reg_addr_first == run_first + run_count &&
+        _IntRegI2C_GetRangeSize(this->registers, run_first, run_count + group->reg_count) <= MODIF_I2C_REFRESH_GROUP_MAX_SIZE) {
+      //extend current run
+      run_count += group->reg_count;
+      continue;
+    }
+
+    //read current run, if any
+    if (run_count == 1) {
+      this->ReadRegisterAsync(run_first, refresh_scratch, ModuleTransferCallback());
+    } else if (run_count > 1) {
+      this->ReadMultiRegisterAsync(run_first, refresh_scratch, run_count, ModuleTransferCallback());
+    }
+
+    //start new run
+    if (group != NULL) {
+      run_first = group->reg_addr_first;
+      run_count = group->reg_count;
+    }
+  }
+}
+
+void IntRegI2CModuleInterface::RefreshWatchdogTasks() {
+  if (++this->refresh_watchdog_timer < this->refresh_watchdog_period) {
+    return;
+  }
+  this->refresh_watchdog_timer = 0;
+
+  //refresh everything, regardless of flags
+  this->RefreshGroups(0xFFFF);
+}
+
+
+void IntRegI2CModuleInterface::HandleResetFlag(uint16_t interrupt_flags) noexcept {
+  if ((interrupt_flags & MODIF_I2C_INT_RESET_FLAG) == 0) {
+    return;
+  }
+
+  //module was reset: none of the stored register values can be trusted anymore
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  this->_registers.InvalidateAll();
+  __set_PRIMASK(primask);
+}
+
+
 void IntRegI2CModuleInterface::CheckInterruptRegisterDefinitions() {
   //check that both interrupt registers are either 1 or 2 bytes long (and equal)
   if (this->_registers.reg_sizes[MODIF_I2C_INT_MASK_REG] == 1 && this->_registers.reg_sizes[MODIF_I2C_INT_FLAGS_REG] == 1) {
@@ -1371,18 +1621,25 @@ void IntRegI2CModuleInterface::CheckInterruptRegisterDefinitions() {
 }
 
 IntRegI2CModuleInterface::IntRegI2CModuleInterface(I2CHardwareInterface& hw_interface, uint8_t i2c_address, const uint16_t* reg_sizes, GPIO_TypeDef* int_port, uint16_t int_pin, bool use_crc) :
-    RegI2CModuleInterface(hw_interface, i2c_address, reg_sizes, use_crc), int_port(int_port), int_pin(int_pin), current_interrupt_timer(0) {
+    RegI2CModuleInterface(hw_interface, i2c_address, reg_sizes, use_crc), int_port(int_port), int_pin(int_pin), current_interrupt_timer(0), refresh_groups(NULL),
+    refresh_group_count(0), refresh_watchdog_period(MODIF_I2C_REFRESH_WATCHDOG_PERIOD), refresh_watchdog_timer(0) {
   this->CheckInterruptRegisterDefinitions();
 }
 
 IntRegI2CModuleInterface::IntRegI2CModuleInterface(I2CHardwareInterface& hw_interface, uint8_t i2c_address, std::initializer_list<uint16_t> reg_sizes, GPIO_TypeDef* int_port, uint16_t int_pin, bool use_crc) :
-    RegI2CModuleInterface(hw_interface, i2c_address, reg_sizes, use_crc), int_port(int_port), int_pin(int_pin), current_interrupt_timer(0) {
+    RegI2CModuleInterface(hw_interface, i2c_address, reg_sizes, use_crc), int_port(int_port), int_pin(int_pin), current_interrupt_timer(0), refresh_groups(NULL),
+    refresh_group_count(0), refresh_watchdog_period(MODIF_I2C_REFRESH_WATCHDOG_PERIOD), refresh_watchdog_timer(0) {
   this->CheckInterruptRegisterDefinitions();
 }
 
 
 void IntRegI2CModuleInterface::OnI2CInterrupt(uint16_t interrupt_flags) {
-  //nothing to do in base implementation
-  UNUSED(interrupt_flags);
+  if ((interrupt_flags & MODIF_I2C_INT_RESET_FLAG) != 0) {
+    //reset: module re-initialisation takes care of everything
+    return;
+  }
+
+  //read only the register groups affected by the raised interrupts
+  this->RefreshGroups(interrupt_flags);
 }
 
@@ -16,6 +16,15 @@ static_assert(MODIF_I2C_INT_RESET_FLAG == I2CDEF_POWERAMP_INT_FLAGS_INT_RESET_Ms
 
 static uint8_t poweramp_scratch[128];
 
+//register groups refreshed on interrupts
+static const IntRegI2CRefreshGroup poweramp_refresh_groups[] = {
+  //all interrupts indicate a status update
+  { 0xFF & ~MODIF_I2C_INT_RESET_FLAG, I2CDEF_POWERAMP_STATUS, 1 },
+  { I2CDEF_POWERAMP_INT_FLAGS_INT_SERR_Msk, I2CDEF_POWERAMP_SAFETY_STATUS, 2 },
+  { I2CDEF_POWERAMP_INT_FLAGS_INT_SWARN_Msk, I2CDEF_POWERAMP_SWARN_SOURCE, 1 },
+  { I2CDEF_POWERAMP_INT_FLAGS_INT_PVDD_ERR_Msk | I2CDEF_POWERAMP_INT_FLAGS_INT_PVDD_REDDONE_Msk, I2CDEF_POWERAMP_PVDD_TARGET, 3 }
+};
+
 
 PowerAmpStatus PowerAmpInterface::GetStatus() const {
   PowerAmpStatus status;
@@ -106,6 +115,25 @@ PowerAmpThresholdSet PowerAmpInterface::GetSafetyThresholds(PowerAmpThresholdTyp
 }
 
 
+PowerAmpChannelValues PowerAmpInterface::GetSpeakerTemperatureRise() const {
+  PowerAmpChannelValues values;
+  memcpy(&values, this->registers[I2CDEF_POWERAMP_SPK_TEMP_A], sizeof(PowerAmpChannelValues));
+  return values;
+}
+
+PowerAmpChannelValues PowerAmpInterface::GetSpeakerGainReduction() const {
+  PowerAmpChannelValues values;
+  memcpy(&values, this->registers[I2CDEF_POWERAMP_SPK_GRED_A], sizeof(PowerAmpChannelValues));
+  return values;
+}
+
+PowerAmpSpeakerModelParams PowerAmpInterface::GetSpeakerModelParams() const {
+  PowerAmpSpeakerModelParams params;
+  memcpy(&params, this->registers[I2CDEF_POWERAMP_SPK_RTH_COIL_A], sizeof(PowerAmpSpeakerModelParams));
+  return params;
+}
+
+
 
 void PowerAmpInterface::SetManualShutdownActive(bool manual_shutdown, SuccessCallback&& callback) {
   uint8_t config_val =
@@ -193,6 +221,22 @@ void PowerAmpInterface::SetSafetyThresholds(PowerAmpThresholdType type, const Po
 }
 
 
+void PowerAmpInterface::SetSpeakerModelParams(const PowerAmpSpeakerModelParams* params, SuccessCallback&& callback) {
+  if (params == NULL) {
+    throw std::invalid_argument("PowerAmpInterface SetSpeakerModelParams given null pointer");
+  }
+
+  //write desired parameters
+  this->WriteMultiRegisterAsync(I2CDEF_POWERAMP_SPK_RTH_COIL_A, (const uint8_t*)params, 20, [this, callback = std::move(callback), params](bool, uint32_t, uint16_t) {
+    //read back parameters to ensure correctness and up-to-date register state
+    this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SPK_RTH_COIL_A, poweramp_scratch, 20, callback ? [this, callback = std::move(callback), params](bool success, uint32_t, uint16_t) {
+      //report result (and parameter correctness) to external callback
+      callback(success && memcmp(params, this->registers[I2CDEF_POWERAMP_SPK_RTH_COIL_A], sizeof(PowerAmpSpeakerModelParams)) == 0);
+    } : ModuleTransferCallback());
+  });
+}
+
+
 
 void PowerAmpInterface::InitModule(SuccessCallback&& callback) {
   this->initialised = false;
@@ -248,6 +292,7 @@ void PowerAmpInterface::InitModule(SuccessCallback&& callback) {
         this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SWARN_IRMS_INST_A, poweramp_scratch, 15, ModuleTransferCallback());
         this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SWARN_PAVG_INST_A, poweramp_scratch, 15, ModuleTransferCallback());
         this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SWARN_PAPP_INST_A, poweramp_scratch, 15, ModuleTransferCallback());
+        this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SPK_TEMP_A, poweramp_scratch, 28, ModuleTransferCallback());
         this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SAFETY_STATUS, poweramp_scratch, 3, [this, callback = std::move(callback)](bool, uint32_t, uint16_t) {
           //after last read is done: init completed successfully (even if read failed - that's non-critical)
           this->initialised = true;
@@ -264,22 +309,21 @@ void PowerAmpInterface::LoopTasks() {
   static uint32_t loop_count = 0;
 
   if (this->initialised) {
-    if (loop_count % 50 == 0) {
-      //every 50 cycles (500ms), read status and safety status - no callback needed, we're only reading to update the registers
-      this->ReadRegister16Async(I2CDEF_POWERAMP_STATUS, ModuleTransferCallback());
-      this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SAFETY_STATUS, poweramp_scratch, 3, ModuleTransferCallback());
-    }
+    //status, safety and PVDD information are read on interrupts, and refreshed every 100 cycles (1s) as a fallback
+    this->RefreshWatchdogTasks();
 
-    if (loop_count % 100 == 10) {
-      //every 100 cycles (1s), read PVDD information
-      this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_PVDD_TARGET, poweramp_scratch, 3, ModuleTransferCallback());
+    if (loop_count % 100 == 10 && this->monitor_measurements) {
+      //every 100 cycles (1s), read output monitor values if enabled
+      this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_MON_VRMS_FAST_A, poweramp_scratch, 32, [this](bool, uint32_t, uint16_t) {
+        this->ExecuteCallbacks(MODIF_POWERAMP_EVENT_MEASUREMENT_UPDATE);
+      });
+    }
 
-      //read output monitor values if enabled
-      if (this->monitor_measurements) {
-        this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_MON_VRMS_FAST_A, poweramp_scratch, 32, [this](bool, uint32_t, uint16_t) {
-          this->ExecuteCallbacks(MODIF_POWERAMP_EVENT_MEASUREMENT_UPDATE);
-        });
-      }
+    if (loop_count % 20 == 15 && this->monitor_speaker_model) {
+      //every 20 cycles (200ms), read speaker model outputs if enabled
+      this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SPK_TEMP_A, poweramp_scratch, 8, [this](bool, uint32_t, uint16_t) {
+        this->ExecuteCallbacks(MODIF_POWERAMP_EVENT_SPEAKER_UPDATE);
+      });
     }
 
     loop_count++;
@@ -308,7 +352,9 @@ void PowerAmpInterface::LoopTasks() {
 
 
 PowerAmpInterface::PowerAmpInterface(I2CHardwareInterface& hw_interface, uint8_t i2c_address, GPIO_TypeDef* int_port, uint16_t int_pin) :
-        IntRegI2CModuleInterface(hw_interface, i2c_address, I2CDEF_POWERAMP_REG_SIZES, int_port, int_pin, IF_POWERAMP_USE_CRC), monitor_measurements(false), initialised(false), reset_wait_timer(0) {}
+        IntRegI2CModuleInterface(hw_interface, i2c_address, I2CDEF_POWERAMP_REG_SIZES, int_port, int_pin, IF_POWERAMP_USE_CRC), monitor_measurements(false), monitor_speaker_model(false), initialised(false), reset_wait_timer(0) {
+  this->SetRefreshGroups(poweramp_refresh_groups, sizeof(poweramp_refresh_groups) / sizeof(IntRegI2CRefreshGroup), IF_POWERAMP_REFRESH_PERIOD);
+}
 
 
 
@@ -363,25 +409,5 @@ void PowerAmpInterface::OnI2CInterrupt(uint16_t interrupt_flags) {
     }
     return;
   }
-
-  if (interrupt_flags != 0) {
-    //all other interrupts indicate a status update, so read status
-    this->ReadRegister16Async(I2CDEF_POWERAMP_STATUS, ModuleTransferCallback());
-  }
-
-  if ((interrupt_flags & I2CDEF_POWERAMP_INT_FLAGS_INT_SERR_Msk) != 0) {
-    //safety error: read safety status and error source
-    this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_SAFETY_STATUS, poweramp_scratch, 2, ModuleTransferCallback());
-  }
-
-  if ((interrupt_flags & I2CDEF_POWERAMP_INT_FLAGS_INT_SWARN_Msk) != 0) {
-    //safety warning: read warning source
-    this->ReadRegister16Async(I2CDEF_POWERAMP_SWARN_SOURCE, ModuleTransferCallback());
-  }
-
-  if ((interrupt_flags & (I2CDEF_POWERAMP_INT_FLAGS_INT_PVDD_ERR_Msk | I2CDEF_POWERAMP_INT_FLAGS_INT_PVDD_REDDONE_Msk)) != 0) {
-    //PVDD event: read PVDD information
-    this->ReadMultiRegisterAsync(I2CDEF_POWERAMP_PVDD_TARGET, poweramp_scratch, 3, ModuleTransferCallback());
-  }
 }
 
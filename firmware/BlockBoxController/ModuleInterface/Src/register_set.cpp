@@ -74,6 +74,80 @@ uint32_t RegisterSet::Reg32(uint8_t reg_addr) const {
 }
 
 
+bool RegisterSet::IsValid(uint8_t reg_addr) const noexcept {
+  return (this->valid_flags[reg_addr >> 5] & (1u << (reg_addr & 0x1F))) != 0;
+}
+
+void RegisterSet::SetValid(uint8_t reg_addr, bool valid) noexcept {
+  if (valid) {
+    this->valid_flags[reg_addr >> 5] |= 1u << (reg_addr & 0x1F);
+  } else {
+    this->valid_flags[reg_addr >> 5] &= ~(1u << (reg_addr & 0x1F));
+  }
+}
+
+void RegisterSet::InvalidateAll() noexcept {
+  memset(this->valid_flags, 0, sizeof(this->valid_flags));
+}
+
+
+bool RegisterSet::IsDirty(uint8_t reg_addr) const noexcept {
+  return (this->dirty_flags[reg_addr >> 5] & (1u << (reg_addr & 0x1F))) != 0;
+}
+
+void RegisterSet::SetDirty(uint8_t reg_addr, bool dirty) noexcept {
+  if (dirty) {
+    this->dirty_flags[reg_addr >> 5] |= 1u << (reg_addr & 0x1F);
+  } else {
+    this->dirty_flags[reg_addr >> 5] &= ~(1u << (reg_addr & 0x1F));
+  }
+}
+
+bool RegisterSet::AnyDirty() const noexcept {
+  for (int i = 0; i < 8; i++) {
+    if (this->dirty_flags[i] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+uint8_t* RegisterSet::Desired(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] == 0) {
+    throw std::invalid_argument("RegisterSet attempted desired-value access to invalid register");
+  }
+
+  //allocate shadow only when needed, since most register sets never stage values
+  if (this->desired.size() != this->data.size()) {
+    this->desired.resize(this->data.size());
+  }
+
+  return this->desired.data() + this->data_offsets[reg_addr];
+}
+
+const uint8_t* RegisterSet::Desired(uint8_t reg_addr) const {
+  if (this->reg_sizes[reg_addr] == 0) {
+    throw std::invalid_argument("RegisterSet attempted desired-value access to invalid register");
+  }
+
+  if (this->desired.size() != this->data.size()) {
+    throw std::logic_error("RegisterSet attempted desired-value read before any value was staged");
+  }
+
+  return this->desired.data() + this->data_offsets[reg_addr];
+}
+
+
+bool RegisterSet::Matches(uint8_t reg_addr, const void* value) const {
+  if (value == NULL) {
+    throw std::invalid_argument("RegisterSet Matches requires a non-null value");
+  }
+
+  return this->IsValid(reg_addr) && memcmp(this->operator [](reg_addr), value, this->reg_sizes[reg_addr]) == 0;
+}
+
+
 RegisterSet::RegisterSet(const uint16_t* reg_sizes) : reg_sizes(this->_reg_sizes) {
   this->Init(reg_sizes);
 }
@@ -115,4 +189,8 @@ void RegisterSet::Init(const uint16_t* reg_sizes) {
 
   //initialise data vector with the total size
   this->data.resize(offset);
+
+  //nothing known or staged yet
+  memset(this->valid_flags, 0, sizeof(this->valid_flags));
+  memset(this->dirty_flags, 0, sizeof(this->dirty_flags));
 }
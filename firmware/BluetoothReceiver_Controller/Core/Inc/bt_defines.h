@@ -71,60 +71,61 @@
 #define BT_CMD_WRITE "WRITE\r"
 
 
-//notifications - command responses (scanf syntax)
-#define BT_NOTIF_OK "OK\r"
-//#define BT_NOTIF_PENDING "PENDING\r"
+//notifications - command responses: arguments after the keyword and its separator (space or equals sign), in scanf syntax
+//keyword-less notifications (config items, volume readback) are given in full; "\r" means no arguments
+#define BT_NOTIF_OK "\r"
+//#define BT_NOTIF_PENDING "\r"
 #define BT_NOTIF_CONFIG_ITEM "%255[^=]=%255[^\r]\r"
-#define BT_NOTIF_NAME "NAME %llX \"%255[^\"]\"\r"
-#define BT_NOTIF_RSSI "RSSI=%hd\r"
-#define BT_NOTIF_QUALITY "QUALITY=%hu\r"
+#define BT_NOTIF_NAME "%llX \"%255[^\"]\"\r"
+#define BT_NOTIF_RSSI "%hd\r"
+#define BT_NOTIF_QUALITY "%hu\r"
 //TODO: double-check format of this scan response - no way of testing until actually implementing broadcast stuff
-#define BT_NOTIF_SCAN_BCAST "SCAN 2 %llX 0x%lX 0x%hhX %s %hd\r"
-#define BT_NOTIF_SCAN_OK "SCAN_OK\r"
-#define BT_NOTIF_STATE "STATE CONNECTABLE[%255[^]]] DISCOVERABLE[%255[^]]] ADVERTISING[%255[^]]] SCAN_UNI[%255[^]]]\r"
-#define BT_NOTIF_LINK_A2DP "LINK %hhX CONNECTED A2DP %llX %255s %255s %255s %lu\r"
-#define BT_NOTIF_LINK_AVRCP "LINK %hhX CONNECTED AVRCP %llX %255s\r"
-//#define BT_NOTIF_LINK_HFP "LINK %X HFP %llX %255s %255s %255s\r"
-//#define BT_NOTIF_LINK_BLE "LINK %X BLE %llX %u\r"
-#define BT_NOTIF_LINK_BRX1 "LINK %hhX CONNECTED BRX1 %llX 0x%lX %255s %255s PDEL %lu RATE %lu ENCR: %hhu SUBGROUP %hhu\r"
-#define BT_NOTIF_LINK_BTX1 "LINK %hhX CONNECTED BTX1 %llX %255s PDEL %lu RATE %lu SUBGROUP %hhu BISS %hhu\r"
+#define BT_NOTIF_SCAN_BCAST "2 %llX 0x%lX 0x%hhX %s %hd\r"
+#define BT_NOTIF_SCAN_OK "\r"
+#define BT_NOTIF_STATE "CONNECTABLE[%255[^]]] DISCOVERABLE[%255[^]]] ADVERTISING[%255[^]]] SCAN_UNI[%255[^]]]\r"
+#define BT_NOTIF_LINK_A2DP "%hhX CONNECTED A2DP %llX %255s %255s %255s %lu\r"
+#define BT_NOTIF_LINK_AVRCP "%hhX CONNECTED AVRCP %llX %255s\r"
+//#define BT_NOTIF_LINK_HFP "%X HFP %llX %255s %255s %255s\r"
+//#define BT_NOTIF_LINK_BLE "%X BLE %llX %u\r"
+#define BT_NOTIF_LINK_BRX1 "%hhX CONNECTED BRX1 %llX 0x%lX %255s %255s PDEL %lu RATE %lu ENCR: %hhu SUBGROUP %hhu\r"
+#define BT_NOTIF_LINK_BTX1 "%hhX CONNECTED BTX1 %llX %255s PDEL %lu RATE %lu SUBGROUP %hhu BISS %hhu\r"
 #define BT_NOTIF_VOLUME_READ "%hhX %s %hhu\r"
 
-//notifications - potentially unprompted (scanf syntax)
-#define BT_NOTIF_READY "Ready\r"
-#define BT_NOTIF_ERROR "ERROR 0x%hX\r"
-#define BT_NOTIF_A2DP_STREAM_START "A2DP_STREAM_START %hhX\r"
-#define BT_NOTIF_A2DP_STREAM_SUSPEND "A2DP_STREAM_SUSPEND %hhX\r"
-#define BT_NOTIF_ABS_VOL "ABS_VOL %hhX %hhu\r"
-//#define BT_NOTIF_AT "AT %X %u %255s\r"
-#define BT_NOTIF_AVRCP_BACKWARD "AVRCP_BACKWARD %hhX\r"
-#define BT_NOTIF_AVRCP_FORWARD "AVRCP_FORWARD %hhX\r"
-#define BT_NOTIF_AVRCP_MEDIA_TITLE "AVRCP_MEDIA TITLE: %255[^\r]\r"
-#define BT_NOTIF_AVRCP_MEDIA_ARTIST "AVRCP_MEDIA ARTIST: %255[^\r]\r"
-#define BT_NOTIF_AVRCP_MEDIA_ALBUM "AVRCP_MEDIA ALBUM: %255[^\r]\r"
-#define BT_NOTIF_AVRCP_PAUSE "AVRCP_PAUSE %hhX\r"
-#define BT_NOTIF_AVRCP_PLAY "AVRCP_PLAY %hhX\r"
-#define BT_NOTIF_AVRCP_STOP "AVRCP_STOP %hhX\r"
-//#define BT_NOTIF_BLE_INDICATION "BLE_INDICATION %X %X %u %255s\r"
-//#define BT_NOTIF_BLE_NOTIFICATION "BLE_NOTIFICATION %X %X %u %255s\r"
-//#define BT_NOTIF_BLE_READ "BLE_READ %X %X\r"
-//#define BT_NOTIF_BLE_WRITE "BLE_WRITE %X %X %u %255s\r"
-//#define BT_NOTIF_CALL_ACTIVE "CALL_ACTIVE %X\r"
-//#define BT_NOTIF_CALL_DIAL "CALL_DIAL %X %255s\r"
-//#define BT_NOTIF_CALL_END "CALL_END %X\r"
-//#define BT_NOTIF_CALL_INCOMING "CALL_INCOMING %X\r"
-//#define BT_NOTIF_CALL_OUTGOING "CALL_OUTGOING %X\r"
-#define BT_NOTIF_CLOSE_OK "CLOSE_OK %hhX %255s\r"
-#define BT_NOTIF_LINK_LOSS "LINK_LOSS %hhX %255s\r"
-#define BT_NOTIF_OPEN_OK "OPEN_OK %hhX %255s %llX\r"
-#define BT_NOTIF_OPEN_ERROR "OPEN_ERROR %llX %255s %hhu\r"
-#define BT_NOTIF_PAIR_ERROR "PAIR_ERROR %llX\r"
-#define BT_NOTIF_PAIR_OK "PAIR_OK %llX\r"
-//#define BT_NOTIF_PAIR_PASSKEY "PAIR_PASSKEY %llX %u %255s\r"
-#define BT_NOTIF_PAIR_PENDING "PAIR_PENDING\r"
-#define BT_NOTIF_RECV "RECV %hhX %hu %255[^\r]\r"
-//#define BT_NOTIF_SCO_CLOSE "SCO_CLOSE %X\r"
-//#define BT_NOTIF_SCO_OPEN "SCO_OPEN %X\r"
+//notifications - potentially unprompted: arguments after the keyword, as above
+#define BT_NOTIF_READY "\r"
+#define BT_NOTIF_ERROR "0x%hX\r"
+#define BT_NOTIF_A2DP_STREAM_START "%hhX\r"
+#define BT_NOTIF_A2DP_STREAM_SUSPEND "%hhX\r"
+#define BT_NOTIF_ABS_VOL "%hhX %hhu\r"
+//#define BT_NOTIF_AT "%X %u %255s\r"
+#define BT_NOTIF_AVRCP_BACKWARD "%hhX\r"
+#define BT_NOTIF_AVRCP_FORWARD "%hhX\r"
+#define BT_NOTIF_AVRCP_MEDIA_TITLE "TITLE: %255[^\r]\r"
+#define BT_NOTIF_AVRCP_MEDIA_ARTIST "ARTIST: %255[^\r]\r"
+#define BT_NOTIF_AVRCP_MEDIA_ALBUM "ALBUM: %255[^\r]\r"
+#define BT_NOTIF_AVRCP_PAUSE "%hhX\r"
+#define BT_NOTIF_AVRCP_PLAY "%hhX\r"
+#define BT_NOTIF_AVRCP_STOP "%hhX\r"
+//#define BT_NOTIF_BLE_INDICATION "%X %X %u %255s\r"
+//#define BT_NOTIF_BLE_NOTIFICATION "%X %X %u %255s\r"
+//#define BT_NOTIF_BLE_READ "%X %X\r"
+//#define BT_NOTIF_BLE_WRITE "%X %X %u %255s\r"
+//#define BT_NOTIF_CALL_ACTIVE "%X\r"
+//#define BT_NOTIF_CALL_DIAL "%X %255s\r"
+//#define BT_NOTIF_CALL_END "%X\r"
+//#define BT_NOTIF_CALL_INCOMING "%X\r"
+//#define BT_NOTIF_CALL_OUTGOING "%X\r"
+#define BT_NOTIF_CLOSE_OK "%hhX %255s\r"
+#define BT_NOTIF_LINK_LOSS "%hhX %255s\r"
+#define BT_NOTIF_OPEN_OK "%hhX %255s %llX\r"
+#define BT_NOTIF_OPEN_ERROR "%llX %255s %hhu\r"
+#define BT_NOTIF_PAIR_ERROR "%llX\r"
+#define BT_NOTIF_PAIR_OK "%llX\r"
+//#define BT_NOTIF_PAIR_PASSKEY "%llX %u %255s\r"
+#define BT_NOTIF_PAIR_PENDING "\r"
+#define BT_NOTIF_RECV "%hhX %hu %255[^\r]\r"
+//#define BT_NOTIF_SCO_CLOSE "%X\r"
+//#define BT_NOTIF_SCO_OPEN "%X\r"
 
 
 typedef enum {
@@ -150,6 +151,7 @@ typedef enum {
   CMD_VOLUME,
   CMD_VOLUME_GET,
   CMD_WRITE,
+  CMD_ANY = 0xFD, //only used for notification parser matching: response to any active command
   CMD_INIT = 0xFE,
   CMD_NONE = 0xFF
 } BT_Command;
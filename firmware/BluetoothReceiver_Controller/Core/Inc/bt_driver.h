@@ -21,6 +21,12 @@
 #define BT_CMD_TIMEOUT 8000
 //maximum retransmit attempts per command
 #define BT_CMD_RETRANSMIT_ATTEMPTS 3
+//number of command queue items (statically allocated)
+#define BT_CMD_QUEUE_SIZE 48
+//maximum number of commands in flight at once - only pipelinable commands are sent while others are in flight
+#define BT_CMD_PIPELINE_DEPTH 4
+//delay between transmissions of pipelined commands, in ms
+#define BT_CMD_PIPELINE_DELAY 10
 
 //maximum length of album/artist/title strings (including zero termination)
 #define BT_AVRCP_META_LENGTH 256
@@ -8,12 +8,23 @@
 #include "bt_driver.h"
 #include "uart_host.h"
 #include <stdlib.h>
+#include <string.h>
 
 
 #define BT_PARSEBUF_SIZE 2048
 #define BT_CMDBUF_SIZE 256
 
 
+//notification parser: called with the arguments following the keyword (pointer into the parse buffer), returns whether the notification was parsed successfully
+typedef bool (*BT_NotificationParser)(const char* args);
+
+//notification keyword table entry
+typedef struct {
+  const char* keyword;
+  BT_Command command; //command the notification is a response to (only parsed while it's active), CMD_ANY for any active command, CMD_NONE for unprompted notifications
+  BT_NotificationParser parser;
+} BT_NotificationType;
+
 typedef struct _cmd_queue_item {
   BT_Command command;
   char cmd_text[BT_CMDBUF_SIZE];
@@ -46,16 +57,25 @@ static char _parse_str_3[256] = { 0 };
 
 //command preparation buffer holding the current command
 static char _cmd_prep_buffer[BT_CMDBUF_SIZE] = { 0 };
+//static pool of command queue items, and list of free items
+static BT_CommandQueueItem _cmd_queue_pool[BT_CMD_QUEUE_SIZE];
+static BT_CommandQueueItem* _cmd_queue_free = NULL;
 //head and tail pointers of command queue
 static BT_CommandQueueItem* _cmd_queue_head = NULL;
 static BT_CommandQueueItem* _cmd_queue_tail = NULL;
 
-//command that is currently being executed (and has not been confirmed as completed yet)
+//commands that have been sent and not confirmed as completed yet, oldest first - responses without type (OK/ERROR) refer to the oldest one
+static BT_Command _cmd_in_flight[BT_CMD_PIPELINE_DEPTH];
+static uint8_t _cmd_in_flight_count = 0;
+//oldest command in flight, which is currently being executed (CMD_NONE if none)
 static BT_Command _current_command = CMD_NONE;
-//transmit buffer for the current command
+//transmit buffer for the last sent command, and whether its transmission is still ongoing
 static char _cmd_tx_buffer[BT_CMDBUF_SIZE] = { 0 };
-//tick after which the next command may be sent
+static volatile bool _cmd_tx_busy = false;
+//tick after which the next command may be sent when none are in flight
 static uint32_t _next_cmd_tick = 0;
+//tick after which the next pipelined command may be sent
+static uint32_t _next_pipelined_cmd_tick = 0;
 //tick after which the current command times out
 static uint32_t _cmd_timeout_tick = HAL_MAX_DELAY;
 
@@ -92,12 +112,13 @@ static HAL_StatusTypeDef _BT_QueueCommand(BT_Command command, int32_t length) {
     return HAL_ERROR;
   }
 
-  //allocate queue item
-  BT_CommandQueueItem* new_item = malloc(sizeof(BT_CommandQueueItem));
+  //take queue item from the free list
+  BT_CommandQueueItem* new_item = _cmd_queue_free;
   if (new_item == NULL) {
-    //insufficient heap memory
+    //queue full
     return HAL_ERROR;
   }
+  _cmd_queue_free = new_item->next;
 
   //populate queue item values
   new_item->command = command;
@@ -155,13 +176,18 @@ static void _BT_RequeueCommand(BT_CommandQueueItem* item) {
   _cmd_queue_head = item;
 }
 
+//return the given (dequeued) item to the free list
+static void _BT_FreeCommand(BT_CommandQueueItem* item) {
+  item->next = _cmd_queue_free;
+  _cmd_queue_free = item;
+}
+
 static void _BT_ClearCommandQueue() {
-  //iterate through queue from head, freeing all items
-  BT_CommandQueueItem* item = _cmd_queue_head;
-  while (item != NULL) {
-    BT_CommandQueueItem* next_item = item->next;
-    free(item);
-    item = next_item;
+  //put all pool items into the free list
+  int i;
+  _cmd_queue_free = NULL;
+  for (i = 0; i < BT_CMD_QUEUE_SIZE; i++) {
+    _BT_FreeCommand(_cmd_queue_pool + i);
   }
 
   //clear pointers to mark queue as empty
@@ -169,6 +195,68 @@ static void _BT_ClearCommandQueue() {
   _cmd_queue_tail = NULL;
 }
 
+//whether the given command may be sent while other commands are in flight: no dependency on results of previous commands, and responses are only OK/ERROR, or data notifications matched by type
+static bool _BT_IsCommandPipelinable(BT_Command command) {
+  switch (command) {
+    case CMD_SET:
+    case CMD_VOLUME:
+    case CMD_RSSI:
+    case CMD_QUALITY:
+    case CMD_VOLUME_GET:
+      return true;
+    default:
+      return false;
+  }
+}
+
+//whether the given command is currently in flight (sent, not completed yet)
+static bool _BT_IsCommandInFlight(BT_Command command) {
+  int i;
+  for (i = 0; i < _cmd_in_flight_count; i++) {
+    if (_cmd_in_flight[i] == command) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//whether the given command can be sent now, in addition to the commands in flight
+static bool _BT_CanSendCommand(BT_Command command, uint32_t tick) {
+  if (_cmd_tx_busy) {
+    return false;
+  }
+
+  if (_cmd_in_flight_count == 0) {
+    //nothing in flight: wait for the delay after the last command end
+    return (int32_t)(tick - _next_cmd_tick) >= 0;
+  }
+
+  //commands in flight: only pipeline if all involved commands allow it, with at most one in flight per type for commands with data responses
+  if (_cmd_in_flight_count >= BT_CMD_PIPELINE_DEPTH || !_BT_IsCommandPipelinable(command) || !_BT_IsCommandPipelinable(_current_command)) {
+    return false;
+  }
+  if (command != CMD_SET && command != CMD_VOLUME && _BT_IsCommandInFlight(command)) {
+    return false;
+  }
+  return (int32_t)(tick - _next_pipelined_cmd_tick) >= 0;
+}
+
+//complete the current (oldest) command, the next one in flight (if any) becomes the current one
+static void _BT_CompleteCurrentCommand() {
+  if (_cmd_in_flight_count > 0) {
+    _cmd_in_flight_count--;
+    memmove(_cmd_in_flight, _cmd_in_flight + 1, _cmd_in_flight_count * sizeof(BT_Command));
+  }
+
+  if (_cmd_in_flight_count > 0) {
+    //next command becomes current: restart timeout for it
+    _current_command = _cmd_in_flight[0];
+    _cmd_timeout_tick = HAL_GetTick() + BT_CMD_TIMEOUT;
+  } else {
+    _current_command = CMD_NONE;
+  }
+}
+
 HAL_StatusTypeDef BT_Command_AVRCP_META_DATA(uint8_t link_id) {
   int32_t res = snprintf(_cmd_prep_buffer, BT_CMDBUF_SIZE, BT_CMD_AVRCP_META_DATA, link_id);
   return _BT_QueueCommand(CMD_AVRCP_META_DATA, res);
@@ -304,7 +392,7 @@ static void _BT_Command_Finish(BT_Error error) {
 
   if (error == BTERR_NONE) {
     //DEBUG_PRINTF("Command finished successfully\n");
-    _current_command = CMD_NONE;
+    _BT_CompleteCurrentCommand();
     return;
   }
 
@@ -312,7 +400,7 @@ static void _BT_Command_Finish(BT_Error error) {
 
   if (((uint16_t)error & 0xFFF0U) == 0xF000U) {
     //"critical error", reset
-    _current_command = CMD_NONE;
+    _BT_CompleteCurrentCommand();
     if (error == BTERR_WRONG_CONFIG) {
       //wrong config: force factory reset
       _init_force_factory_reset = true;
@@ -325,7 +413,7 @@ static void _BT_Command_Finish(BT_Error error) {
 
   if (_current_command == CMD_INIT || _current_command == CMD_CONFIG || _current_command == CMD_SET || _current_command == CMD_WRITE) {
     //error in init procedure: reset
-    _current_command = CMD_NONE;
+    _BT_CompleteCurrentCommand();
     _BT_ErrorReset();
     return;
   }
@@ -336,7 +424,7 @@ static void _BT_Command_Finish(BT_Error error) {
     UARTH_Notification_Event_Error((uint16_t)error, false);
   }
 
-  _current_command = CMD_NONE;
+  _BT_CompleteCurrentCommand();
 }
 
 static void _BT_Command_Timeout() {
@@ -345,7 +433,11 @@ static void _BT_Command_Timeout() {
     //timeout in init procedure: reset
     _BT_ErrorReset();
   } else {
-    _BT_Command_Finish(BTERR_COMMAND_TIMEOUT);
+    //responses of other commands in flight can't be matched reliably anymore: time them out as well (stop if one of them triggers a reset)
+    uint8_t count = _cmd_in_flight_count;
+    while (count-- > 0 && _current_command != CMD_NONE && _current_command != CMD_INIT) {
+      _BT_Command_Finish(BTERR_COMMAND_TIMEOUT);
+    }
   }
 }
 
@@ -470,8 +562,8 @@ static bool _BT_ProcessStatusUpdate() {
 }
 
 
-static bool _BT_Parse_OK() {
-  if (strcmp(_parse_buffer, BT_NOTIF_OK) != 0) {
+static bool _BT_Parse_OK(const char* args) {
+  if (strcmp(args, BT_NOTIF_OK) != 0) {
     return false;
   }
   if (_current_command == CMD_CONFIG) {
@@ -520,8 +612,8 @@ static bool _BT_Parse_OK() {
   return true;
 }
 
-static bool _BT_Parse_CONFIG_Item() {
-  if (sscanf(_parse_buffer, BT_NOTIF_CONFIG_ITEM, _parse_str_0, _parse_str_1) < 2) {
+static bool _BT_Parse_CONFIG_Item(const char* args) {
+  if (sscanf(args, BT_NOTIF_CONFIG_ITEM, _parse_str_0, _parse_str_1) < 2) {
     return false;
   }
   _BT_CheckConfigItem(_parse_str_0, _parse_str_1);
@@ -529,9 +621,9 @@ static bool _BT_Parse_CONFIG_Item() {
   return true;
 }
 
-static bool _BT_Parse_NAME() {
+static bool _BT_Parse_NAME(const char* args) {
   uint64_t bt_addr;
-  if (sscanf(_parse_buffer, BT_NOTIF_NAME, &bt_addr, _parse_str_0) < 2) {
+  if (sscanf(args, BT_NOTIF_NAME, &bt_addr, _parse_str_0) < 2) {
     return false;
   }
   if (bt_driver_state.connected_device_addr == bt_addr) {
@@ -547,9 +639,9 @@ static bool _BT_Parse_NAME() {
   return true;
 }
 
-static bool _BT_Parse_RSSI() {
+static bool _BT_Parse_RSSI(const char* args) {
   int16_t rssi;
-  if (sscanf(_parse_buffer, BT_NOTIF_RSSI, &rssi) < 1) {
+  if (sscanf(args, BT_NOTIF_RSSI, &rssi) < 1) {
     return false;
   }
   if (bt_driver_state.connected_device_addr != 0) {
@@ -563,9 +655,9 @@ static bool _BT_Parse_RSSI() {
   return true;
 }
 
-static bool _BT_Parse_QUALITY() {
+static bool _BT_Parse_QUALITY(const char* args) {
   uint16_t quality;
-  if (sscanf(_parse_buffer, BT_NOTIF_QUALITY, &quality) < 1) {
+  if (sscanf(args, BT_NOTIF_QUALITY, &quality) < 1) {
     return false;
   }
   if (bt_driver_state.connected_device_addr != 0) {
@@ -579,25 +671,30 @@ static bool _BT_Parse_QUALITY() {
   return true;
 }
 
-static bool _BT_Parse_SCAN() {
+static bool _BT_Parse_SCAN(const char* args) {
   uint64_t bt_addr;
   uint32_t bcast_id;
   uint8_t adv_id;
   int16_t rssi;
-  if (sscanf(_parse_buffer, BT_NOTIF_SCAN_BCAST, &bt_addr, &bcast_id, &adv_id, _parse_str_0, &rssi) == 5) {
-    //TODO: process broadcast scan result
-    DEBUG_PRINTF("SCAN broadcast response parsed\n");
-    return true;
-  } else if (strcmp(_parse_buffer, BT_NOTIF_SCAN_OK) == 0) {
-    _BT_Command_Finish(BTERR_NONE);
-    DEBUG_PRINTF("SCAN_OK response parsed\n");
-    return true;
+  if (sscanf(args, BT_NOTIF_SCAN_BCAST, &bt_addr, &bcast_id, &adv_id, _parse_str_0, &rssi) < 5) {
+    return false;
   }
-  return false;
+  //TODO: process broadcast scan result
+  DEBUG_PRINTF("SCAN broadcast response parsed\n");
+  return true;
 }
 
-static bool _BT_Parse_STATE() {
-  if (sscanf(_parse_buffer, BT_NOTIF_STATE, _parse_str_0, _parse_str_1, _parse_str_2, _parse_str_3) < 4) {
+static bool _BT_Parse_SCAN_OK(const char* args) {
+  if (strcmp(args, BT_NOTIF_SCAN_OK) != 0) {
+    return false;
+  }
+  _BT_Command_Finish(BTERR_NONE);
+  DEBUG_PRINTF("SCAN_OK response parsed\n");
+  return true;
+}
+
+static bool _BT_Parse_STATE(const char* args) {
+  if (sscanf(args, BT_NOTIF_STATE, _parse_str_0, _parse_str_1, _parse_str_2, _parse_str_3) < 4) {
     return false;
   }
 
@@ -610,7 +707,7 @@ static bool _BT_Parse_STATE() {
   return true;
 }
 
-static bool _BT_Parse_LINK() {
+static bool _BT_Parse_LINK(const char* args) {
   uint8_t link_id;
   uint64_t bt_addr;
   uint32_t sample_rate;
@@ -620,7 +717,7 @@ static bool _BT_Parse_LINK() {
   uint8_t bcast_subgroup;
   uint8_t bcast_biss;
 
-  if (sscanf(_parse_buffer, BT_NOTIF_LINK_A2DP, &link_id, &bt_addr, _parse_str_0, _parse_str_1, _parse_str_2, &sample_rate) == 6) {
+  if (sscanf(args, BT_NOTIF_LINK_A2DP, &link_id, &bt_addr, _parse_str_0, _parse_str_1, _parse_str_2, &sample_rate) == 6) {
     _status_a2dp_link_id = link_id;
     _status_a2dp_bt_addr = bt_addr;
     _status_a2dp_stream_active = (strcmp(_parse_str_0, "STREAMING") == 0);
@@ -628,17 +725,17 @@ static bool _BT_Parse_LINK() {
     _status_a2dp_codec[BT_STATE_STR_LENGTH - 1] = '\0';
     //DEBUG_PRINTF("LINK A2DP response parsed\n");
     return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_LINK_AVRCP, &link_id, &bt_addr, _parse_str_0) == 3) {
+  } else if (sscanf(args, BT_NOTIF_LINK_AVRCP, &link_id, &bt_addr, _parse_str_0) == 3) {
     _status_avrcp_link_id = link_id;
     _status_avrcp_bt_addr = bt_addr;
     _status_avrcp_playing = (strcmp(_parse_str_0, "PLAYING") == 0);
     //DEBUG_PRINTF("LINK AVRCP response parsed\n");
     return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_LINK_BRX1, &link_id, &bt_addr, &bcast_code, _parse_str_0, _parse_str_1, &bcast_pdel, &sample_rate, &bcast_encr, &bcast_subgroup) == 9) {
+  } else if (sscanf(args, BT_NOTIF_LINK_BRX1, &link_id, &bt_addr, &bcast_code, _parse_str_0, _parse_str_1, &bcast_pdel, &sample_rate, &bcast_encr, &bcast_subgroup) == 9) {
     //TODO: process data
     DEBUG_PRINTF("LINK BRX1 response parsed\n");
     return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_LINK_BTX1, &link_id, &bt_addr, _parse_str_0, &bcast_pdel, &sample_rate, &bcast_subgroup, &bcast_biss) == 7) {
+  } else if (sscanf(args, BT_NOTIF_LINK_BTX1, &link_id, &bt_addr, _parse_str_0, &bcast_pdel, &sample_rate, &bcast_subgroup, &bcast_biss) == 7) {
     //TODO: process data
     DEBUG_PRINTF("LINK BTX1 response parsed\n");
     return true;
@@ -647,10 +744,10 @@ static bool _BT_Parse_LINK() {
   return false;
 }
 
-static bool _BT_Parse_VOLUME_READ() {
+static bool _BT_Parse_VOLUME_READ(const char* args) {
   uint8_t link_id;
   uint8_t volume;
-  if (sscanf(_parse_buffer, BT_NOTIF_VOLUME_READ, &link_id, _parse_str_0, &volume) < 3) {
+  if (sscanf(args, BT_NOTIF_VOLUME_READ, &link_id, _parse_str_0, &volume) < 3) {
     return false;
   }
   //only care about A2DP volume
@@ -667,8 +764,8 @@ static bool _BT_Parse_VOLUME_READ() {
   return true;
 }
 
-static bool _BT_Parse_Ready() {
-  if (strcmp(_parse_buffer, BT_NOTIF_READY) != 0) {
+static bool _BT_Parse_Ready(const char* args) {
+  if (strcmp(args, BT_NOTIF_READY) != 0) {
     return false;
   }
   if (_current_command == CMD_INIT) {
@@ -687,9 +784,9 @@ static bool _BT_Parse_Ready() {
   return true;
 }
 
-static bool _BT_Parse_ERROR() {
+static bool _BT_Parse_ERROR(const char* args) {
   uint16_t error_code;
-  if (sscanf(_parse_buffer, BT_NOTIF_ERROR, &error_code) < 1) {
+  if (sscanf(args, BT_NOTIF_ERROR, &error_code) < 1) {
     return false;
   }
   _BT_Command_Finish((BT_Error)error_code);
@@ -697,36 +794,45 @@ static bool _BT_Parse_ERROR() {
   return true;
 }
 
-static bool _BT_Parse_A2DP_Event() {
+//parse a single hexadecimal link ID argument (must be the only argument)
+static bool _BT_ParseLinkIDArg(const char* args, uint8_t* link_id) {
+  char* end;
+  uint32_t value = strtoul(args, &end, 16);
+  if (end == args || *end != '\r' || value > 0xFF) {
+    return false;
+  }
+  *link_id = (uint8_t)value;
+  return true;
+}
+
+static bool _BT_HandleA2DPStreamEvent(const char* args, bool active, const char* name) {
   uint8_t link_id;
-  if (sscanf(_parse_buffer, BT_NOTIF_A2DP_STREAM_START, &link_id) == 1) {
-    if (bt_driver_state.a2dp_link_id != 0 && link_id == bt_driver_state.a2dp_link_id) {
-      bt_driver_state.a2dp_stream_active = true;
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    } else {
-      DEBUG_PRINTF("A2DP_STREAM_START on unknown link %02X!\n", link_id);
-    }
-    //DEBUG_PRINTF("A2DP_STREAM_START notification parsed\n");
-    return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_A2DP_STREAM_SUSPEND, &link_id) == 1) {
-    if (bt_driver_state.a2dp_link_id != 0 && link_id == bt_driver_state.a2dp_link_id) {
-      bt_driver_state.a2dp_stream_active = false;
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    } else {
-      DEBUG_PRINTF("A2DP_STREAM_SUSPEND on unknown link %02X!\n", link_id);
-    }
-    //DEBUG_PRINTF("A2DP_STREAM_SUSPEND notification parsed\n");
-    return true;
+  if (!_BT_ParseLinkIDArg(args, &link_id)) {
+    return false;
   }
-  return false;
+  if (bt_driver_state.a2dp_link_id != 0 && link_id == bt_driver_state.a2dp_link_id) {
+    bt_driver_state.a2dp_stream_active = active;
+    //notify host of change if requested
+    UARTH_ForceCheckChangeNotification();
+  } else {
+    DEBUG_PRINTF("%s on unknown link %02X!\n", name, link_id);
+  }
+  //DEBUG_PRINTF("%s notification parsed\n", name);
+  return true;
 }
 
-static bool _BT_Parse_ABS_VOL() {
+static bool _BT_Parse_A2DP_STREAM_START(const char* args) {
+  return _BT_HandleA2DPStreamEvent(args, true, "A2DP_STREAM_START");
+}
+
+static bool _BT_Parse_A2DP_STREAM_SUSPEND(const char* args) {
+  return _BT_HandleA2DPStreamEvent(args, false, "A2DP_STREAM_SUSPEND");
+}
+
+static bool _BT_Parse_ABS_VOL(const char* args) {
   uint8_t link_id;
   uint8_t volume;
-  if (sscanf(_parse_buffer, BT_NOTIF_ABS_VOL, &link_id, &volume) < 2) {
+  if (sscanf(args, BT_NOTIF_ABS_VOL, &link_id, &volume) < 2) {
     return false;
   }
   if (bt_driver_state.avrcp_link_id != 0 && link_id == bt_driver_state.avrcp_link_id) {
@@ -740,95 +846,84 @@ static bool _BT_Parse_ABS_VOL() {
   return true;
 }
 
-static bool _BT_Parse_AVRCP_Command() {
+static bool _BT_HandleAVRCPPlayEvent(const char* args, bool playing, const char* name) {
   uint8_t link_id;
-  if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_BACKWARD, &link_id) == 1) {
-    //TODO: process command
-    //DEBUG_PRINTF("AVRCP_BACKWARD notification parsed\n");
-    return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_FORWARD, &link_id) == 1) {
-    //TODO: process command
-    //DEBUG_PRINTF("AVRCP_FORWARD notification parsed\n");
-    return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_PAUSE, &link_id) == 1) {
-    if (bt_driver_state.avrcp_link_id != 0 && link_id == bt_driver_state.avrcp_link_id) {
-      bt_driver_state.avrcp_playing = false;
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    } else {
-      DEBUG_PRINTF("AVRCP_PAUSE on unknown link %02X!\n", link_id);
-    }
-    //DEBUG_PRINTF("AVRCP_PAUSE notification parsed\n");
-    return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_PLAY, &link_id) == 1) {
-    if (bt_driver_state.avrcp_link_id != 0 && link_id == bt_driver_state.avrcp_link_id) {
-      bt_driver_state.avrcp_playing = true;
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    } else {
-      DEBUG_PRINTF("AVRCP_PLAY on unknown link %02X!\n", link_id);
-    }
-    //DEBUG_PRINTF("AVRCP_PLAY notification parsed\n");
-    return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_STOP, &link_id) == 1) {
-    if (bt_driver_state.avrcp_link_id != 0 && link_id == bt_driver_state.avrcp_link_id) {
-      bt_driver_state.avrcp_playing = false;
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    } else {
-      DEBUG_PRINTF("AVRCP_STOP on unknown link %02X!\n", link_id);
-    }
-    //DEBUG_PRINTF("AVRCP_STOP notification parsed\n");
-    return true;
+  if (!_BT_ParseLinkIDArg(args, &link_id)) {
+    return false;
   }
-  return false;
+  if (bt_driver_state.avrcp_link_id != 0 && link_id == bt_driver_state.avrcp_link_id) {
+    bt_driver_state.avrcp_playing = playing;
+    //notify host of change if requested
+    UARTH_ForceCheckChangeNotification();
+  } else {
+    DEBUG_PRINTF("%s on unknown link %02X!\n", name, link_id);
+  }
+  //DEBUG_PRINTF("%s notification parsed\n", name);
+  return true;
 }
 
-static bool _BT_Parse_AVRCP_MediaInfo() {
-  //uint8_t link_id;
-  if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_MEDIA_TITLE, _parse_str_0) == 1) {
-    if (bt_driver_state.avrcp_link_id != 0) {
-      strncpy(bt_driver_state.avrcp_title, _parse_str_0, BT_AVRCP_META_LENGTH - 1);
-      bt_driver_state.avrcp_title[BT_AVRCP_META_LENGTH - 1] = '\0';
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    }
-    //DEBUG_PRINTF("AVRCP_MEDIA title notification parsed\n");
-    return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_MEDIA_ARTIST, _parse_str_0) == 1) {
-    if (bt_driver_state.avrcp_link_id != 0) {
-      strncpy(bt_driver_state.avrcp_artist, _parse_str_0, BT_AVRCP_META_LENGTH - 1);
-      bt_driver_state.avrcp_artist[BT_AVRCP_META_LENGTH - 1] = '\0';
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    }
-    //DEBUG_PRINTF("AVRCP_MEDIA artist notification parsed\n");
-    return true;
-  } else if (sscanf(_parse_buffer, BT_NOTIF_AVRCP_MEDIA_ALBUM, _parse_str_0) == 1) {
-    if (bt_driver_state.avrcp_link_id != 0) {
-      strncpy(bt_driver_state.avrcp_album, _parse_str_0, BT_AVRCP_META_LENGTH - 1);
-      bt_driver_state.avrcp_album[BT_AVRCP_META_LENGTH - 1] = '\0';
-      //notify host of change if requested
-      UARTH_ForceCheckChangeNotification();
-    }
-    //DEBUG_PRINTF("AVRCP_MEDIA album notification parsed\n");
-    return true;
+static bool _BT_Parse_AVRCP_Skip(const char* args) {
+  uint8_t link_id;
+  if (!_BT_ParseLinkIDArg(args, &link_id)) {
+    return false;
   }
-  return false;
+  //TODO: process command
+  //DEBUG_PRINTF("AVRCP_BACKWARD/FORWARD notification parsed\n");
+  return true;
 }
 
-static bool _BT_Parse_CLOSE_LOSS() {
-  uint8_t link_id;
-  bool loss;
-  if (sscanf(_parse_buffer, BT_NOTIF_CLOSE_OK, &link_id, _parse_str_0) == 2) {
-    loss = false;
-    //DEBUG_PRINTF("CLOSE_OK notification parsed\n");
-  } else if (sscanf(_parse_buffer, BT_NOTIF_LINK_LOSS, &link_id, _parse_str_0) == 2) {
-    loss = true;
-    //DEBUG_PRINTF("LINK_LOSS notification parsed\n");
+static bool _BT_Parse_AVRCP_PAUSE(const char* args) {
+  return _BT_HandleAVRCPPlayEvent(args, false, "AVRCP_PAUSE");
+}
+
+static bool _BT_Parse_AVRCP_PLAY(const char* args) {
+  return _BT_HandleAVRCPPlayEvent(args, true, "AVRCP_PLAY");
+}
+
+static bool _BT_Parse_AVRCP_STOP(const char* args) {
+  return _BT_HandleAVRCPPlayEvent(args, false, "AVRCP_STOP");
+}
+
+//copy the rest of the notification (up to the terminating CR) into the given string, truncating to its size
+static void _BT_CopyStringArg(char* dest, const char* src, uint32_t dest_size) {
+  uint32_t i;
+  for (i = 0; i < dest_size - 1 && src[i] != '\r' && src[i] != '\0'; i++) {
+    dest[i] = src[i];
+  }
+  dest[i] = '\0';
+}
+
+static bool _BT_Parse_AVRCP_MEDIA(const char* args) {
+  //field name and value follow the keyword directly: copy value straight from the parse buffer into the state
+  char* field;
+  uint32_t prefix_length;
+  if (strncmp(args, "TITLE: ", 7) == 0) {
+    field = bt_driver_state.avrcp_title;
+    prefix_length = 7;
+  } else if (strncmp(args, "ARTIST: ", 8) == 0) {
+    field = bt_driver_state.avrcp_artist;
+    prefix_length = 8;
+  } else if (strncmp(args, "ALBUM: ", 7) == 0) {
+    field = bt_driver_state.avrcp_album;
+    prefix_length = 7;
   } else {
     return false;
   }
+
+  if (bt_driver_state.avrcp_link_id != 0) {
+    _BT_CopyStringArg(field, args + prefix_length, BT_AVRCP_META_LENGTH);
+    //notify host of change if requested
+    UARTH_ForceCheckChangeNotification();
+  }
+  //DEBUG_PRINTF("AVRCP_MEDIA notification parsed\n");
+  return true;
+}
+
+static bool _BT_HandleLinkClosed(const char* args, const char* format, bool loss) {
+  uint8_t link_id;
+  if (sscanf(args, format, &link_id, _parse_str_0) < 2) {
+    return false;
+  }
   (void)loss; //unused right now
 
   if (bt_driver_state.a2dp_link_id != 0 && link_id == bt_driver_state.a2dp_link_id) {
@@ -862,10 +957,20 @@ static bool _BT_Parse_CLOSE_LOSS() {
   return true;
 }
 
-static bool _BT_Parse_OPEN_OK() {
+static bool _BT_Parse_CLOSE_OK(const char* args) {
+  //DEBUG_PRINTF("CLOSE_OK notification parsed\n");
+  return _BT_HandleLinkClosed(args, BT_NOTIF_CLOSE_OK, false);
+}
+
+static bool _BT_Parse_LINK_LOSS(const char* args) {
+  //DEBUG_PRINTF("LINK_LOSS notification parsed\n");
+  return _BT_HandleLinkClosed(args, BT_NOTIF_LINK_LOSS, true);
+}
+
+static bool _BT_Parse_OPEN_OK(const char* args) {
   uint8_t link_id;
   uint64_t bt_addr;
-  if (sscanf(_parse_buffer, BT_NOTIF_OPEN_OK, &link_id, _parse_str_0, &bt_addr) < 3) {
+  if (sscanf(args, BT_NOTIF_OPEN_OK, &link_id, _parse_str_0, &bt_addr) < 3) {
     return false;
   }
 
@@ -918,10 +1023,10 @@ static bool _BT_Parse_OPEN_OK() {
   return true;
 }
 
-static bool _BT_Parse_OPEN_ERROR() {
+static bool _BT_Parse_OPEN_ERROR(const char* args) {
   uint64_t bt_addr;
   uint8_t reason;
-  int scan_res = sscanf(_parse_buffer, BT_NOTIF_OPEN_ERROR, &bt_addr, _parse_str_0, &reason);
+  int scan_res = sscanf(args, BT_NOTIF_OPEN_ERROR, &bt_addr, _parse_str_0, &reason);
   if (scan_res == 3) {
     if (_current_command == CMD_OPEN || _current_command == CMD_OPEN_LONG) {
       _BT_Command_Finish((BT_Error)(0xFFF0U | reason));
@@ -938,9 +1043,9 @@ static bool _BT_Parse_OPEN_ERROR() {
   return false;
 }
 
-//static bool _BT_Parse_PAIR_ERROR() {
+//static bool _BT_Parse_PAIR_ERROR(const char* args) {
 //  uint64_t bt_addr;
-//  if (sscanf(_parse_buffer, BT_NOTIF_PAIR_ERROR, &bt_addr) < 1) {
+//  if (sscanf(args, BT_NOTIF_PAIR_ERROR, &bt_addr) < 1) {
 //    return false;
 //  }
 //  //TODO: process error
@@ -948,9 +1053,9 @@ static bool _BT_Parse_OPEN_ERROR() {
 //  return true;
 //}
 //
-//static bool _BT_Parse_PAIR_OK() {
+//static bool _BT_Parse_PAIR_OK(const char* args) {
 //  uint64_t bt_addr;
-//  if (sscanf(_parse_buffer, BT_NOTIF_PAIR_OK, &bt_addr) < 1) {
+//  if (sscanf(args, BT_NOTIF_PAIR_OK, &bt_addr) < 1) {
 //    return false;
 //  }
 //  //TODO: process pair
@@ -958,8 +1063,8 @@ static bool _BT_Parse_OPEN_ERROR() {
 //  return true;
 //}
 //
-//static bool _BT_Parse_PAIR_PENDING() {
-//  if (strcmp(_parse_buffer, BT_NOTIF_PAIR_PENDING) != 0) {
+//static bool _BT_Parse_PAIR_PENDING(const char* args) {
+//  if (strcmp(args, BT_NOTIF_PAIR_PENDING) != 0) {
 //    return false;
 //  }
 //  //TODO: process pending pair
@@ -967,10 +1072,10 @@ static bool _BT_Parse_OPEN_ERROR() {
 //  return true;
 //}
 
-static bool _BT_Parse_RECV() {
+static bool _BT_Parse_RECV(const char* args) {
   uint8_t link_id;
   uint16_t size;
-  if (sscanf(_parse_buffer, BT_NOTIF_RECV, &link_id, &size, _parse_str_0) < 3) {
+  if (sscanf(args, BT_NOTIF_RECV, &link_id, &size, _parse_str_0) < 3) {
     return false;
   }
   //TODO: process received data
@@ -978,52 +1083,87 @@ static bool _BT_Parse_RECV() {
   return true;
 }
 
-static const bool (*_unprompted_parsers[])() = {
-  &_BT_Parse_Ready,
-  &_BT_Parse_ERROR,
-  &_BT_Parse_A2DP_Event,
-  &_BT_Parse_ABS_VOL,
-  &_BT_Parse_AVRCP_Command,
-  &_BT_Parse_AVRCP_MediaInfo,
-  &_BT_Parse_CLOSE_LOSS,
-  &_BT_Parse_OPEN_OK,
-  &_BT_Parse_OPEN_ERROR,
-//  &_BT_Parse_PAIR_ERROR,
-//  &_BT_Parse_PAIR_OK,
-//  &_BT_Parse_PAIR_PENDING,
-  &_BT_Parse_RECV
+//notification types by keyword (first word of the notification), sorted by keyword (strcmp order) for binary search
+static const BT_NotificationType _notification_types[] = {
+  { "A2DP_STREAM_START", CMD_NONE, &_BT_Parse_A2DP_STREAM_START },
+  { "A2DP_STREAM_SUSPEND", CMD_NONE, &_BT_Parse_A2DP_STREAM_SUSPEND },
+  { "ABS_VOL", CMD_NONE, &_BT_Parse_ABS_VOL },
+  { "AVRCP_BACKWARD", CMD_NONE, &_BT_Parse_AVRCP_Skip },
+  { "AVRCP_FORWARD", CMD_NONE, &_BT_Parse_AVRCP_Skip },
+  { "AVRCP_MEDIA", CMD_NONE, &_BT_Parse_AVRCP_MEDIA },
+  { "AVRCP_PAUSE", CMD_NONE, &_BT_Parse_AVRCP_PAUSE },
+  { "AVRCP_PLAY", CMD_NONE, &_BT_Parse_AVRCP_PLAY },
+  { "AVRCP_STOP", CMD_NONE, &_BT_Parse_AVRCP_STOP },
+  { "CLOSE_OK", CMD_NONE, &_BT_Parse_CLOSE_OK },
+  { "ERROR", CMD_NONE, &_BT_Parse_ERROR },
+  { "LINK", CMD_STATUS, &_BT_Parse_LINK },
+  { "LINK_LOSS", CMD_NONE, &_BT_Parse_LINK_LOSS },
+  { "NAME", CMD_NAME, &_BT_Parse_NAME },
+  { "OK", CMD_ANY, &_BT_Parse_OK },
+  { "OPEN_ERROR", CMD_NONE, &_BT_Parse_OPEN_ERROR },
+  { "OPEN_OK", CMD_NONE, &_BT_Parse_OPEN_OK },
+//  { "PAIR_ERROR", CMD_NONE, &_BT_Parse_PAIR_ERROR },
+//  { "PAIR_OK", CMD_NONE, &_BT_Parse_PAIR_OK },
+//  { "PAIR_PENDING", CMD_NONE, &_BT_Parse_PAIR_PENDING },
+  { "QUALITY", CMD_QUALITY, &_BT_Parse_QUALITY },
+  { "RECV", CMD_NONE, &_BT_Parse_RECV },
+  { "RSSI", CMD_RSSI, &_BT_Parse_RSSI },
+  { "Ready", CMD_NONE, &_BT_Parse_Ready },
+  { "SCAN", CMD_SCAN_BCAST, &_BT_Parse_SCAN },
+  { "SCAN_OK", CMD_SCAN_BCAST, &_BT_Parse_SCAN_OK },
+  { "STATE", CMD_STATUS, &_BT_Parse_STATE }
 };
 
-static const int _unprompted_parser_count = 10;
+static const int _notification_type_count = sizeof(_notification_types) / sizeof(BT_NotificationType);
+
+//find the notification type for the given keyword (not null-terminated), NULL if unknown
+static const BT_NotificationType* _BT_FindNotificationType(const char* keyword, uint32_t keyword_length) {
+  int low = 0;
+  int high = _notification_type_count - 1;
+
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    const char* mid_keyword = _notification_types[mid].keyword;
+    //compare like strcmp(mid_keyword, keyword)
+    int cmp = strncmp(mid_keyword, keyword, keyword_length);
+    if (cmp == 0 && mid_keyword[keyword_length] != '\0') {
+      cmp = 1; //table keyword is longer, so it sorts after the given keyword
+    }
+
+    if (cmp == 0) {
+      return _notification_types + mid;
+    } else if (cmp < 0) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+
+  return NULL;
+}
 
 //parse the notification in the parse buffer (must be completely received at this point)
 static void _BT_ParseNotification() {
-  //try to parse command responses if there's a corresponding active command
-  if (_current_command != CMD_NONE) {
-    if (_BT_Parse_OK()) return;
+  //classify notification once by its keyword (up to the first space, equals sign, or the end)
+  uint32_t keyword_length = strcspn(_parse_buffer, " =\r");
+  const BT_NotificationType* type = _BT_FindNotificationType(_parse_buffer, keyword_length);
+
+  if (type != NULL) {
+    //known keyword: parse if the notification is expected in the current state
+    bool expected = (type->command == CMD_NONE) || _BT_IsCommandInFlight(type->command) || (type->command == CMD_ANY && _current_command != CMD_NONE);
+    //arguments start after the separator following the keyword
+    const char* args = _parse_buffer + keyword_length;
+    if (*args == ' ' || *args == '=') {
+      args++;
+    }
+    if (expected && type->parser(args)) return;
   }
 
+  //notifications without keyword: config items and volume readback
   if (_current_command == CMD_CONFIG) {
-    if (_BT_Parse_CONFIG_Item()) return;
-  } else if (_current_command == CMD_NAME) {
-    if (_BT_Parse_NAME()) return;
-  } else if (_current_command == CMD_RSSI) {
-    if (_BT_Parse_RSSI()) return;
-  } else if (_current_command == CMD_QUALITY) {
-    if (_BT_Parse_QUALITY()) return;
-  } else if (_current_command == CMD_SCAN_BCAST) {
-    if (_BT_Parse_SCAN()) return;
-  } else if (_current_command == CMD_STATUS) {
-    if (_BT_Parse_STATE()) return;
-    if (_BT_Parse_LINK()) return;
-  } else if (_current_command == CMD_VOLUME_GET) {
-    if (_BT_Parse_VOLUME_READ()) return;
-  }
-
-  //try to parse notifications that may come up unprompted
-  int i;
-  for (i = 0; i < _unprompted_parser_count; i++) {
-    if (_unprompted_parsers[i]()) return;
+    if (_BT_Parse_CONFIG_Item(_parse_buffer)) return;
+  } else if (_BT_IsCommandInFlight(CMD_VOLUME_GET)) {
+    if (_BT_Parse_VOLUME_READ(_parse_buffer)) return;
   }
 
   //DEBUG_PRINTF("Notification parse failed\n");
@@ -1051,6 +1191,7 @@ void BT_UARTEx_RxEventCallback(UART_HandleTypeDef* huart, uint16_t Size) {
 }
 
 void BT_UART_TxCpltCallback(UART_HandleTypeDef* huart) {
+  _cmd_tx_busy = false;
   DEBUG_PRINTF("[CMD] %s\n", _cmd_tx_buffer);
 }
 
@@ -1090,8 +1231,13 @@ HAL_StatusTypeDef BT_Init() {
   _rx_buffer_write_offset = 0;
   _rx_buffer_read_offset = 0;
   _parse_buffer_write_offset = 0;
+  //module startup is handled as the "init command" in flight
+  _cmd_in_flight[0] = CMD_INIT;
+  _cmd_in_flight_count = 1;
   _current_command = CMD_INIT;
+  _cmd_tx_busy = false;
   _next_cmd_tick = 0;
+  _next_pipelined_cmd_tick = 0;
   _cmd_timeout_tick = HAL_MAX_DELAY;
   _init_config_changed = false;
   _init_force_factory_reset = false;
@@ -1142,17 +1288,29 @@ void BT_Update(uint32_t loop_counter) {
     return;
   }
 
-  //handle received data
+  //handle received data: copy contiguous chunks up to the next CR into the parse buffer
   while (_rx_buffer_read_offset != _rx_buffer_write_offset) {
-    //read character from receive buffer, transfer to parse buffer, and increment offsets
-    char rx_char = _rx_text[_rx_buffer_read_offset++];
-    _parse_buffer[_parse_buffer_write_offset++] = rx_char;
+    //chunk: received data up to the write offset or the end of the circular buffer, limited to the remaining parse buffer space
+    uint32_t write_offset = _rx_buffer_write_offset;
+    uint32_t length = ((write_offset > _rx_buffer_read_offset) ? write_offset : BT_RXBUF_SIZE) - _rx_buffer_read_offset;
+    length = MIN(length, BT_PARSEBUF_SIZE - 1 - _parse_buffer_write_offset);
+    const char* chunk = _rx_text + _rx_buffer_read_offset;
+    const char* cr = memchr(chunk, '\r', length);
+    if (cr != NULL) {
+      //notification ends within the chunk: only take data up to and including the CR
+      length = cr - chunk + 1;
+    }
+
+    //transfer chunk to parse buffer and increment offsets
+    memcpy(_parse_buffer + _parse_buffer_write_offset, chunk, length);
+    _parse_buffer_write_offset += length;
+    _rx_buffer_read_offset += length;
     //handle circular receive buffer
     if (_rx_buffer_read_offset >= BT_RXBUF_SIZE) {
       _rx_buffer_read_offset = 0;
     }
 
-    if (rx_char == '\r') {
+    if (cr != NULL) {
       //received CR character: notification complete, so null-terminate parse buffer, reset write offset, and parse the notification
       _parse_buffer[_parse_buffer_write_offset] = '\0';
       _parse_buffer_write_offset = 0;
@@ -1172,43 +1330,50 @@ void BT_Update(uint32_t loop_counter) {
     _BT_Command_Timeout();
   }
 
-  //send next command if it's time for that
-  if (_current_command == CMD_NONE && (int32_t)(tick - _next_cmd_tick) >= 0) {
-    //conditions for next command are met: dequeue command, if there is one
-    BT_CommandQueueItem* item = _BT_DequeueCommand();
-    if (item == NULL) {
+  //send next command if it's time for that (may be pipelined with commands in flight)
+  if (_cmd_queue_head == NULL) {
+    if (_cmd_in_flight_count == 0 && (int32_t)(tick - _next_cmd_tick) >= 0) {
       //no command queued: update next command tick (to avoid eventual underflows), try again next time
       _next_cmd_tick = tick;
-    } else {
-      //command queued: sanity-check length first
-      uint32_t length = item->cmd_length;
-      if (length < BT_CMDBUF_SIZE) {
-        //length okay: proceed, extract queue item values
-        _current_command = item->command;
-        memcpy(_cmd_tx_buffer, item->cmd_text, length);
-        _cmd_tx_buffer[length + 1] = '\0';
-
-        //start command
-        if (HAL_UART_Transmit_IT(&huart6, (uint8_t*)_cmd_tx_buffer, length) == HAL_OK) {
-          //send success: free queue item memory, schedule timeout
-          free(item);
+    }
+  } else if (_BT_CanSendCommand(_cmd_queue_head->command, tick)) {
+    //conditions for next command are met: dequeue and sanity-check length first
+    BT_CommandQueueItem* item = _BT_DequeueCommand();
+    uint32_t length = item->cmd_length;
+    if (length < BT_CMDBUF_SIZE) {
+      //length okay: proceed, extract queue item values
+      memcpy(_cmd_tx_buffer, item->cmd_text, length);
+      _cmd_tx_buffer[length] = '\0';
+
+      //start command
+      _cmd_tx_busy = true;
+      if (HAL_UART_Transmit_IT(&huart6, (uint8_t*)_cmd_tx_buffer, length) == HAL_OK) {
+        //send success: add to commands in flight, free queue item, schedule timeout if it's the only command in flight
+        _cmd_in_flight[_cmd_in_flight_count++] = item->command;
+        if (_cmd_in_flight_count == 1) {
+          _current_command = item->command;
           _cmd_timeout_tick = tick + BT_CMD_TIMEOUT;
+        }
+        _next_pipelined_cmd_tick = tick + BT_CMD_PIPELINE_DELAY;
+        _BT_FreeCommand(item);
+      } else {
+        //error: update next command tick, requeue item to try again next time
+        _cmd_tx_busy = false;
+        DEBUG_PRINTF("*** Command transmit error on command %s\n", _cmd_tx_buffer);
+        if (item->retransmit_attempts >= BT_CMD_RETRANSMIT_ATTEMPTS) {
+          //maximum retransmit attempts exceeded: reset
+          _BT_ErrorReset();
+          return;
         } else {
-          //error: reset to no command, update next command tick, requeue item to try again next time
-          DEBUG_PRINTF("*** Command transmit error on command %s\n", _cmd_tx_buffer);
-          if (item->retransmit_attempts >= BT_CMD_RETRANSMIT_ATTEMPTS) {
-            //maximum retransmit attempts exceeded: reset
-            _BT_ErrorReset();
-            return;
-          } else {
-            //attempt retransmit
-            _current_command = CMD_NONE;
-            _next_cmd_tick = tick;
-            item->retransmit_attempts++;
-            _BT_RequeueCommand(item);
-          }
+          //attempt retransmit
+          _next_cmd_tick = tick;
+          item->retransmit_attempts++;
+          _BT_RequeueCommand(item);
         }
       }
+    } else {
+      //invalid length: drop command
+      _BT_FreeCommand(item);
     }
   }
 
@@ -0,0 +1,46 @@
+/*
+ * dsp_selftest.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ *
+ *  Offline render test of the SRC + signal processor chain: renders test tones at all input rates, with the SRC in
+ *  fixed-ratio and adaptive mode, and with default and non-default signal processor settings. Reports level, THD+N,
+ *  image rejection, output hash and processing time, and checks them against per-case limits and golden hashes
+ *  (generated by the host render test, HostTest/DigitalAudioProcessor).
+ */
+
+#ifndef INC_DSP_SELFTEST_H_
+#define INC_DSP_SELFTEST_H_
+
+#include "main.h"
+#include "signal_processing.h"
+
+//enable to run the render test at startup, before the output is started (host builds define it on the command line)
+//#define DSP_SELFTEST
+
+//output batches rendered before measuring, to let filters and the adaptive resampler settle
+#define DSPTEST_SETTLE_BATCHES 256
+//output batches rendered before measuring with the SRC in adaptive mode, to let its resampling loop settle
+#define DSPTEST_ADAPTIVE_SETTLE_BATCHES 2000
+//output batches per least-squares fit of the tone with the SRC in adaptive mode (which hunts around the exact ratio)
+#define DSPTEST_ADAPTIVE_FIT_BATCHES 1
+//output batches measured per test tone
+#define DSPTEST_MEASURE_BATCHES 1000
+//test tone amplitude (relative to full scale) - the tone is quantised to 16 bits, so the input is bit-identical on host and target
+#define DSPTEST_TONE_AMPLITUDE 0.5
+//whether a golden hash mismatch fails the self-test - limits are always checked, and mismatches always reported
+//the golden hashes come from the host build (host CMSIS-DSP implementations): only enable this on target once they're confirmed there
+//(the host render test defines it on the command line)
+#ifndef DSPTEST_CHECK_HASHES
+#define DSPTEST_CHECK_HASHES 0
+#endif
+
+
+//render all test tones at all input rates, SRC modes and SP setups, print the results and check them against the expected limits and hashes
+//returns HAL_ERROR if any result is out of limits (or doesn't match its golden hash, if checked) - leaves the SP reset with its default settings,
+//SRC needs to be configured afterwards
+HAL_StatusTypeDef DSPTEST_Run();
+
+
+#endif /* INC_DSP_SELFTEST_H_ */
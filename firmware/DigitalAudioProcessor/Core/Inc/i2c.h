@@ -13,6 +13,10 @@
 #include "i2c_defines_dap.h"
 
 
+//register size definitions (checked against the register table on init), and interrupt flag that is always signalled on the interrupt pin
+#define I2C_REG_SIZES I2CDEF_DAP_REG_SIZES
+#define I2C_INT_RESET_Msk I2CDEF_DAP_INT_FLAGS_INT_RESET_Msk
+
 //size of virtual read/write buffers, in bytes - equals maximum virtual register size
 #define I2C_VIRT_BUFFER_SIZE I2CDEF_DAP_REG_SIZE_SP_FIR
 
@@ -40,6 +44,13 @@
 #define I2C_PERIPHERAL_BUSY_TIMEOUT 10
 #endif
 
+//minimum transfer size (including CRC) for which DMA is used instead of byte interrupts
+#define I2C_DMA_MIN_SIZE 16
+
+//hardware CRC unit configuration: CRC-8 with polynomial 0x7F, no input/output reversal
+#define I2C_CRC_POLYNOMIAL 0x7FU
+#define I2C_CRC_CR_CONFIG CRC_CR_POLYSIZE_1
+
 //I2C instance to use
 #define I2C_INSTANCE hi2c1
 #define I2C_INT_PORT I2C_INT_N_GPIO_Port
@@ -48,11 +59,12 @@
 #define I2C_RELEASE_RESET() __HAL_RCC_I2C1_RELEASE_RESET()
 
 
-HAL_StatusTypeDef I2C_Init();
-void I2C_TriggerInterrupt(uint8_t interrupt_bit);
-void I2C_LoopUpdate();
+//register engine (after configuration above)
+#include "i2c_slave.h"
+
 
-void I2C_TimeoutISR();
+//checks for status changes without a dedicated interrupt, signalling the status interrupt if needed - to be called once per main loop cycle
+void I2C_StatusLoopUpdate();
 
 
 #endif /* INC_I2C_H_ */
@@ -29,6 +29,9 @@
  *    - 0x42: LOUDNESS_GAINS: Loudness compensation gain per output channel in dB - active in range [-30, 0], lower to disable (8B, 2 * 4B float, rw)
  *    - 0x43: BIQUAD_SETUP: Number of active biquad filters per channel and their post-shift values (4B, 2 * 1B unsigned count + 2 * 1B unsigned shift, rw)
  *    - 0x44: FIR_SETUP: Active length of FIR filter per channel (4B, 2 * 2B unsigned length, rw)
+ *    - 0x45: VOLUME_GAINS_DELAYED: Volume gains per output channel in dB (as in VOLUME_GAINS), applied after the given number of output batches (max 1000, 0 = next batch) - read gives gains active after the delay and remaining batches, counted as in the write (0 = applied with the next batch, or none pending); VOLUME_GAINS write cancels pending gains (12B, 2 * 4B float + 4B unsigned batches, rw)
+ *    - 0x48: OUTPUT_PEAKS: Output levels per channel as fraction of full scale: look-ahead envelope (upper bound of the output peak within the next 48ms, from the output path delay), then peak absolute output level since last OUTPUT_PEAKS_RESET - read doesn't reset (16B, 2 * 4B float envelope + 2 * 4B float peak, r)
+ *    - 0x49: OUTPUT_PEAKS_RESET: Reset the output peak levels of the channels whose bit is set (1B, bit field, w)
  *    - 0x50-0x51: BIQUAD_COEFFS_CH?: Biquad filter coefficients: each b0 b1 b2 a1 a2, consecutive filters, a1+a2 negated vs. MATLAB (320B, 16 * 5 * 4B fixed point Q31, rw)
  *    - 0x58-0x59: FIR_COEFFS_CH?: FIR filter coefficients, in reverse-time order (coefficient 0 is last) (1200B, 300 * 4B fixed point Q31, rw)
  *  * Misc registers
@@ -47,6 +50,8 @@
  *    - 0: INT_EN: Enable I2C interrupts
  *  * INT_MASK (0x10, bit field, 1B):
  *    - 7: RESET: Module reset
+ *    - 5: INT_OUTPUT_ENVELOPE: Output envelope rose by more than 1dB since last OUTPUT_PEAKS read
+ *    - 4: INT_STATUS: Streaming or USB connection state changed
  *    - 3: INT_INPUT_RATE: Input sample rate changed
  *    - 2: INT_INPUT_AVAILABLE: Availability of inputs changed
  *    - 1: INT_ACTIVE_INPUT: Active input changed
@@ -83,7 +88,7 @@
   1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
   1, 1, 0, 0, 0, 0, 0, 0, 4, 4, 4, 0, 0, 0, 0, 0,\
   4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
-  16, 8, 8, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
+  16, 8, 8, 4, 4, 12, 0, 0, 16, 1, 0, 0, 0, 0, 0, 0,\
   I2CDEF_DAP_REG_SIZE_SP_BIQUAD, I2CDEF_DAP_REG_SIZE_SP_BIQUAD, 0, 0, 0, 0, 0, 0, I2CDEF_DAP_REG_SIZE_SP_FIR, I2CDEF_DAP_REG_SIZE_SP_FIR, 0, 0, 0, 0, 0, 0,\
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
@@ -133,6 +138,10 @@
 #define I2CDEF_DAP_INT_MASK_INT_INPUT_AVAILABLE_Msk (0x1 << I2CDEF_DAP_INT_MASK_INT_INPUT_AVAILABLE_Pos)
 #define I2CDEF_DAP_INT_MASK_INT_INPUT_RATE_Pos 3
 #define I2CDEF_DAP_INT_MASK_INT_INPUT_RATE_Msk (0x1 << I2CDEF_DAP_INT_MASK_INT_INPUT_RATE_Pos)
+#define I2CDEF_DAP_INT_MASK_INT_STATUS_Pos 4
+#define I2CDEF_DAP_INT_MASK_INT_STATUS_Msk (0x1 << I2CDEF_DAP_INT_MASK_INT_STATUS_Pos)
+#define I2CDEF_DAP_INT_MASK_INT_OUTPUT_ENVELOPE_Pos 5
+#define I2CDEF_DAP_INT_MASK_INT_OUTPUT_ENVELOPE_Msk (0x1 << I2CDEF_DAP_INT_MASK_INT_OUTPUT_ENVELOPE_Pos)
 #define I2CDEF_DAP_INT_MASK_INT_RESET_Pos 7
 #define I2CDEF_DAP_INT_MASK_INT_RESET_Msk (0x1 << I2CDEF_DAP_INT_MASK_INT_RESET_Pos)
 
@@ -146,6 +155,10 @@
 #define I2CDEF_DAP_INT_FLAGS_INT_INPUT_AVAILABLE_Msk I2CDEF_DAP_INT_MASK_INT_INPUT_AVAILABLE_Msk
 #define I2CDEF_DAP_INT_FLAGS_INT_INPUT_RATE_Pos I2CDEF_DAP_INT_MASK_INT_INPUT_RATE_Pos
 #define I2CDEF_DAP_INT_FLAGS_INT_INPUT_RATE_Msk I2CDEF_DAP_INT_MASK_INT_INPUT_RATE_Msk
+#define I2CDEF_DAP_INT_FLAGS_INT_STATUS_Pos I2CDEF_DAP_INT_MASK_INT_STATUS_Pos
+#define I2CDEF_DAP_INT_FLAGS_INT_STATUS_Msk I2CDEF_DAP_INT_MASK_INT_STATUS_Msk
+#define I2CDEF_DAP_INT_FLAGS_INT_OUTPUT_ENVELOPE_Pos I2CDEF_DAP_INT_MASK_INT_OUTPUT_ENVELOPE_Pos
+#define I2CDEF_DAP_INT_FLAGS_INT_OUTPUT_ENVELOPE_Msk I2CDEF_DAP_INT_MASK_INT_OUTPUT_ENVELOPE_Msk
 #define I2CDEF_DAP_INT_FLAGS_INT_RESET_Pos I2CDEF_DAP_INT_MASK_INT_RESET_Pos
 #define I2CDEF_DAP_INT_FLAGS_INT_RESET_Msk I2CDEF_DAP_INT_MASK_INT_RESET_Msk
 
@@ -199,6 +212,12 @@
 
 #define I2CDEF_DAP_FIR_SETUP 0x44
 
+#define I2CDEF_DAP_VOLUME_GAINS_DELAYED 0x45
+
+#define I2CDEF_DAP_OUTPUT_PEAKS 0x48
+
+#define I2CDEF_DAP_OUTPUT_PEAKS_RESET 0x49
+
 #define I2CDEF_DAP_BIQUAD_COEFFS_CH1 0x50
 #define I2CDEF_DAP_BIQUAD_COEFFS_CH2 0x51
 
@@ -27,6 +27,11 @@
 //size of each I2S receive buffer in samples - 2 batches to match DMA half-transfer callbacks
 #define INPUT_I2S_RX_BUF_SAMPLES (2 * INPUT_I2S_RX_BATCH_TOTAL_SAMPLES)
 
+//rate tracking of all available inputs against the SRC output rate, to start the SRC's adaptive resampling from the known rate on input switches:
+//minimum measurement window length for a valid rate error, and maximum length before the window is restarted (to follow slow clock drift), in SRC output batches
+#define INPUT_RATE_TRACK_MIN_BATCHES 8192
+#define INPUT_RATE_TRACK_MAX_BATCHES 131072
+
 
 typedef enum {
   INPUT_NONE = 0,
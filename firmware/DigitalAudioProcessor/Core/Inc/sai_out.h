@@ -21,8 +21,13 @@
 #define SAI_OUT_TOTAL_BATCH_SAMPLES (SAI_OUT_CHANNEL_BATCH_SAMPLES * SAI_OUT_CHANNELS)
 //total DMA buffer size in samples - 2 batches to match DMA half-transfer callbacks
 #define SAI_OUT_BUF_SAMPLES (SAI_OUT_TOTAL_BATCH_SAMPLES * 2)
+//total DMA buffer size in frames (samples per channel)
+#define SAI_OUT_BUF_FRAMES (SAI_OUT_BUF_SAMPLES / SAI_OUT_CHANNELS)
 
 
 HAL_StatusTypeDef SAI_OUT_Init();
 
+//get the current DMA read position in the output buffer, in frames, in [0, SAI_OUT_BUF_FRAMES) - for measuring the output clock against other clocks
+uint32_t SAI_OUT_GetBufferFramePosition();
+
 #endif /* INC_SAI_OUT_H_ */
@@ -44,6 +44,12 @@
 #define SRC_ADAPTIVE_BUF_FILL_COEFF_P (1.0f / 4096.0f)
 #define SRC_ADAPTIVE_BUF_FILL_COEFF_D (2.0f)
 
+//maximum deviation of the buffer fill level from the ideal level, in samples, before fixed-ratio mode falls back to adaptive resampling
+#define SRC_FIXED_RATIO_MAX_FILL_ERROR (2 * SRC_BATCH_CHANNEL_SAMPLES)
+
+//length of the output fade-in when the SRC becomes ready, and of the fade-out of the old signal on an input switch, in batches
+#define SRC_FADE_BATCHES 2
+
 //bit shift of output samples - negative means shifted right
 #define SRC_OUTPUT_SHIFT -4
 
@@ -67,14 +73,29 @@ bool SRC_IsReady();
 
 //reset the SRC's internal state and prepare for the conversion of a new input signal at the given sample rate
 HAL_StatusTypeDef SRC_Configure(SRC_SampleRate input_rate);
+//switch to a new input signal at the given sample rate - like SRC_Configure, but glitch-free and with a warm start:
+//if the SRC is currently outputting, the buffered old signal is faded out first (new input samples are dropped until the reset happens then)
+//if `rate_error_known`, the adaptive resampling starts from the given relative input rate error (see SRC_GetAverageRateError) instead of re-converging
+HAL_StatusTypeDef SRC_SwitchInput(SRC_SampleRate input_rate, bool rate_error_known, float rate_error);
 //get the currently configured input sample rate
 SRC_SampleRate SRC_GetCurrentInputRate();
+//get and clear whether the SRC has restarted its data stream for a switched input since the last call - downstream state should be reset then
+bool SRC_TakeStreamRestart();
 
 //get the average relative input rate error
 float SRC_GetAverageRateError();
 //get the average buffer fill error in samples
 float SRC_GetAverageBufferFillError();
 
+//get the total number of output batches requested so far (whether or not the SRC was ready), as a time base at the output rate
+uint32_t SRC_GetOutputBatchCount();
+
+//allow or disallow fixed-ratio mode, where the adaptive resampling stage is bypassed - for inputs whose source rate is locked to our output clock
+//only takes effect when the SRC becomes ready (starts outputting); disallowing it also ends an active fixed-ratio mode immediately
+void SRC_SetFixedRatioAllowed(bool allowed);
+//get whether the SRC is currently running in fixed-ratio mode
+bool SRC_IsFixedRatioActive();
+
 //process `in_channels` input channels with `in_samples` samples per channel; where inputs were previously shifted to `in_shift` (negative = shifted right)
 //must be at the currently configured input sample rate; to switch sample rate, a re-init is required
 //channels may be in separate buffers or interleaved, starting at `in_bufs[channel]`, each with step size `in_step`
@@ -28,10 +28,17 @@
 #define SP_MIN_VOL_GAIN -120.0f
 //maximum volume gain in dB
 #define SP_MAX_VOL_GAIN 20.0f
+//maximum delay of delayed volume gains, in output batches
+#define SP_MAX_VOL_GAIN_DELAY 1000
 //minimum loudness compensation gain in dB (anything less than this means loudness compensation is disabled)
 #define SP_MIN_LOUDNESS_ENABLED_GAIN -30.0f
 //maximum loudness compensation gain in dB
 #define SP_MAX_LOUDNESS_GAIN 0.0f
+//look-ahead delay of the output path in batches (before the volume stage) - the output envelope covers the audio within this delay
+#define SP_LOOKAHEAD_BATCHES 48
+//output envelope interrupt: triggered when the envelope rises by this factor over the last read envelope (+1dB), and is at least the given level
+#define SP_ENVELOPE_INT_RISE 1.122f
+#define SP_ENVELOPE_INT_MIN_LEVEL 0.001f
 
 //bit shift of output samples - negative means shifted right
 #define SP_OUTPUT_SHIFT 0
@@ -74,6 +81,19 @@ HAL_StatusTypeDef SP_SetupFIRs(const uint16_t* filter_lengths);
 void SP_GetBiquadSetup(uint8_t* filter_counts, uint8_t* post_shifts);
 //get current FIR setup
 void SP_GetFIRSetup(uint16_t* filter_lengths);
+//get output levels per channel (as fraction of full scale): look-ahead envelope (upper bound of the output peak within the next `SP_LOOKAHEAD_BATCHES`)
+//and peak-hold since the last peak reset - non-destructive, either pointer may be null
+void SP_GetOutputLevels(float* envelopes, float* peaks);
+//reset the output peak-hold values of the channels in the given bit mask (bit n = channel n)
+void SP_ResetOutputPeaks(uint8_t channel_mask);
+//schedule the given volume gains (in dB, assumed valid) to be applied after `delay_batches` output batches (at most `SP_MAX_VOL_GAIN_DELAY`, 0 = next batch)
+//replaces any previously scheduled gains
+HAL_StatusTypeDef SP_SetVolumeGainsDelayed(const float* gains_dB, uint32_t delay_batches);
+//get the volume gains that will be active once scheduled gains are applied (current gains if nothing is scheduled), and the remaining delay in batches,
+//counted like `delay_batches` of SP_SetVolumeGainsDelayed (0 = applied with the next batch, or nothing scheduled)
+void SP_GetVolumeGainsDelayed(float* gains_dB, uint32_t* remaining_batches);
+//discard scheduled volume gains, if any (when new gains are applied directly)
+void SP_CancelVolumeGainsDelayed();
 
 //produce `out_channels` output channels with `SP_BATCH_CHANNEL_SAMPLES` samples per channel
 //output buffer(s) must have enough space for a full batch of samples!
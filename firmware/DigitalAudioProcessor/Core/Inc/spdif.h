@@ -16,9 +16,8 @@
 //SPDIFRX peripheral kernel clock frequency, in Hz
 #define SPDIF_KERNEL_CLK_FREQ 240000000
 
-//sample rate smoothing exponential moving average coefficients
-#define SPDIF_SAMPLE_RATE_EMA_ALPHA 0.0625f
-#define SPDIF_SAMPLE_RATE_EMA_1MALPHA (1.0f - SPDIF_SAMPLE_RATE_EMA_ALPHA)
+//number of WIDTH5 readings (one per batch) used for median-filtered sample rate detection - odd, so lock takes (length + 1) / 2 batches
+#define SPDIF_RATE_HISTORY_LENGTH 5
 
 //maximum acceptable relative sample rate error (from 44.1K/48K/96K) for activation
 #define SPDIF_MAX_SAMPLE_RATE_ERROR_ON 0.01f
@@ -38,6 +37,9 @@
 //size of SPDIF control receive buffer in control words - 2 blocks to match DMA half-transfer callbacks
 #define SPDIF_RX_CTL_BUF_WORDS (2 * SPDIF_RX_CTLBLOCK_CHANNEL_BYTES)
 
+//maximum number of consecutive invalid samples per channel which are concealed (interpolated, or held at the end of a batch) - longer bursts are muted
+#define SPDIF_CONCEAL_MAX_SAMPLES 16
+
 
 //last detected reception sample rate (enum value); unknown if invalid or unsupported rate or too far away from nominal rate
 extern SRC_SampleRate spdif_sample_rate_enum;
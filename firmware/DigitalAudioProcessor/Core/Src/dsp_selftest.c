@@ -0,0 +1,321 @@
+/*
+ * dsp_selftest.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ *
+ *  Offline render test of the SRC + signal processor chain: renders test tones at all input rates, with the SRC in
+ *  fixed-ratio and adaptive mode, and with default and non-default signal processor settings. Reports level, THD+N,
+ *  image rejection, output hash and processing time, and checks them against per-case limits and golden hashes
+ *  (generated by the host render test, HostTest/DigitalAudioProcessor).
+ */
+
+#include "dsp_selftest.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef DSP_SELFTEST
+
+//signal processor setups the tones are rendered with
+typedef enum {
+  DSPTEST_SETUP_DEFAULT = 0,  //settings after SP_Init: no filters, 0dB volume
+  DSPTEST_SETUP_FILTERS = 1   //two unity biquad stages, a 2-sample delay FIR, and -6dB volume
+} DSPTEST_Setup;
+
+//expected results per input rate, test tone, SRC mode and SP setup - tones are mid-band for THD+N, and near the passband edge for ripple/droop
+//in fixed-ratio mode the whole chain is fixed-point, so the output is bit-exact between builds and has a golden hash;
+//adaptive resampling is floating-point, so its output may differ in the last bits between builds and isn't hashed
+typedef struct {
+  SRC_SampleRate rate;
+  uint32_t freq;
+  bool fixed_ratio;               //whether the SRC runs in fixed-ratio mode (otherwise adaptive resampling)
+  DSPTEST_Setup setup;
+  double max_level_deviation_dB;  //max deviation of the fundamental level from the nominal gain (passband ripple/droop)
+  double max_thdn_dB;             //max THD+N
+  double min_image_rejection_dB;  //min rejection of the interpolation image at (rate - freq), relative to the fundamental - 0 = not applicable
+  uint32_t hash;                  //golden output hash - 0 = not applicable
+} DSPTEST_Expectation;
+
+static const DSPTEST_Expectation _dsptest_expectations[] = {
+  { SR_44K,   997, true,  DSPTEST_SETUP_DEFAULT, 0.05, -88.0, 120.0, 0xba8e4709 },
+  { SR_44K, 19997, true,  DSPTEST_SETUP_DEFAULT, 0.20, -88.0, 120.0, 0x8d136289 },
+  { SR_48K,   997, true,  DSPTEST_SETUP_DEFAULT, 0.05, -88.0, 120.0, 0x7371e1b5 },
+  { SR_48K, 19997, true,  DSPTEST_SETUP_DEFAULT, 0.05, -88.0, 120.0, 0xaeede15d },
+  { SR_96K,   997, true,  DSPTEST_SETUP_DEFAULT, 0.05, -88.0,   0.0, 0x3c848905 },
+  { SR_96K, 19997, true,  DSPTEST_SETUP_DEFAULT, 0.05, -88.0,   0.0, 0x1f76cdc5 },
+  { SR_44K,   997, true,  DSPTEST_SETUP_FILTERS, 0.05, -88.0, 120.0, 0xbbe45ec5 },
+  { SR_48K, 19997, true,  DSPTEST_SETUP_FILTERS, 0.05, -88.0, 120.0, 0x1e914ff5 },
+  //adaptive: the residual is dominated by the loop's ratio hunting (a pitch jitter of a few hundred ppm, inaudible), not the resampler's noise floor
+  { SR_44K,   997, false, DSPTEST_SETUP_DEFAULT, 0.05, -65.0,  90.0, 0 },
+  { SR_48K,   997, false, DSPTEST_SETUP_DEFAULT, 0.05, -65.0,  90.0, 0 },
+  { SR_96K,   997, false, DSPTEST_SETUP_DEFAULT, 0.05, -65.0,   0.0, 0 },
+  { SR_48K, 19997, false, DSPTEST_SETUP_FILTERS, 0.05, -38.0,  80.0, 0 }
+};
+
+//nominal gain of the chain from input to output: the SP output shift, everything else is unity gain
+#define DSPTEST_NOMINAL_LEVEL_DB (6.020599913 * (double)SP_OUTPUT_SHIFT)
+//volume gain of DSPTEST_SETUP_FILTERS
+#define DSPTEST_FILTERS_VOLUME_DB -6.0206f
+
+//input and output batch buffers
+static q31_t _dsptest_in_bufs[SRC_MAX_CHANNELS][SRC_INPUT_CHANNEL_SAMPLES_MAX];
+static q31_t _dsptest_out_bufs[SP_MAX_CHANNELS][SP_BATCH_CHANNEL_SAMPLES];
+
+//least-squares fit sums of the output against sin, cos and DC at the tone frequency, plus output energy
+typedef struct {
+  double s_ss, s_cc, s_sc, s_s, s_c, s_n;
+  double s_xs, s_xc, s_x, s_xx;
+} DSPTEST_FitSums;
+
+//results of a single tone render
+typedef struct {
+  double level_dB;    //fundamental level relative to the input tone
+  double thdn_dB;     //residual (everything except the fundamental and DC) relative to the fundamental
+  double image_dB;    //level at the interpolation image frequency (rate - freq) relative to the fundamental, if applicable
+  uint32_t hash;      //FNV-1a hash of all measured output samples
+  uint32_t cycles;    //average CPU cycles per output batch (SRC input + SRC output + SP)
+} DSPTEST_ToneResult;
+
+
+//FNV-1a hash update with one 32-bit value
+static inline uint32_t _DSPTEST_HashUpdate(uint32_t hash, uint32_t value) {
+  int i;
+  for (i = 0; i < 4; i++) {
+    hash ^= (value >> (8 * i)) & 0xFF;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+//apply the given SP setup (filters and volume) and reset the SP - DSPTEST_SETUP_DEFAULT restores the settings after SP_Init
+static HAL_StatusTypeDef _DSPTEST_ApplySetup(DSPTEST_Setup setup) {
+  int i;
+  uint8_t biquad_counts[SP_MAX_CHANNELS];
+  uint8_t biquad_shifts[SP_MAX_CHANNELS];
+  uint16_t fir_lengths[SP_MAX_CHANNELS];
+
+  for (i = 0; i < SP_MAX_CHANNELS; i++) {
+    //biquad coefficients stay at their default (b0 = 0.5 with post-shift 1: no effect on the signal), only the stage count changes
+    biquad_counts[i] = (setup == DSPTEST_SETUP_FILTERS) ? 2 : 0;
+    biquad_shifts[i] = 1;
+    //FIR: coefficient 2 (stored at index length-3) ~1, so a pure 2-sample delay
+    fir_lengths[i] = (setup == DSPTEST_SETUP_FILTERS) ? 3 : 0;
+    memset(sp_fir_coeffs[i], 0, 3 * sizeof(q31_t));
+    sp_fir_coeffs[i][0] = (setup == DSPTEST_SETUP_FILTERS) ? INT32_MAX : 0;
+    sp_volume_gains_dB[i] = (setup == DSPTEST_SETUP_FILTERS) ? DSPTEST_FILTERS_VOLUME_DB : 0.0f;
+  }
+  ReturnOnError(SP_SetupBiquads(biquad_counts, biquad_shifts));
+  ReturnOnError(SP_SetupFIRs(fir_lengths));
+  SP_Reset();
+
+  return HAL_OK;
+}
+
+//nominal level of the given SP setup relative to the input, in dB
+static double _DSPTEST_NominalLevel(DSPTEST_Setup setup) {
+  return DSPTEST_NOMINAL_LEVEL_DB + ((setup == DSPTEST_SETUP_FILTERS) ? (double)DSPTEST_FILTERS_VOLUME_DB : 0.0);
+}
+
+//solve the 3x3 normal equations of a fit for sin/cos/DC amplitudes (Cramer's rule), and add its squared amplitude, fundamental energy and
+//residual energy to the given totals - returns false if the fit is singular
+static bool _DSPTEST_SolveFit(const DSPTEST_FitSums* f, double* amplitude_sq, double* fundamental, double* residual) {
+  double det = f->s_ss * (f->s_cc * f->s_n - f->s_c * f->s_c) - f->s_sc * (f->s_sc * f->s_n - f->s_c * f->s_s) + f->s_s * (f->s_sc * f->s_c - f->s_cc * f->s_s);
+  if (det == 0.0) {
+    return false;
+  }
+  double a = (f->s_xs * (f->s_cc * f->s_n - f->s_c * f->s_c) - f->s_sc * (f->s_xc * f->s_n - f->s_c * f->s_x) + f->s_s * (f->s_xc * f->s_c - f->s_cc * f->s_x)) / det;
+  double b = (f->s_ss * (f->s_xc * f->s_n - f->s_c * f->s_x) - f->s_xs * (f->s_sc * f->s_n - f->s_c * f->s_s) + f->s_s * (f->s_sc * f->s_x - f->s_xc * f->s_s)) / det;
+  double d = (f->s_ss * (f->s_cc * f->s_x - f->s_c * f->s_xc) - f->s_sc * (f->s_sc * f->s_x - f->s_c * f->s_xs) + f->s_xs * (f->s_sc * f->s_c - f->s_cc * f->s_s)) / det;
+
+  //residual energy of the least-squares fit: sum(x^2) - fit . (sums of x * basis)
+  *amplitude_sq += a * a + b * b;
+  *fundamental += 0.5 * (a * a + b * b) * f->s_n;
+  *residual += f->s_xx - (a * f->s_xs + b * f->s_xc + d * f->s_x);
+  return true;
+}
+
+//render one test tone through SRC + SP with the given SRC mode and SP setup, measuring the left output channel
+static HAL_StatusTypeDef _DSPTEST_RenderTone(const DSPTEST_Expectation* exp, DSPTEST_ToneResult* result) {
+  SRC_SampleRate rate = exp->rate;
+  uint32_t freq = exp->freq;
+  int i, j;
+
+  //fixed-ratio mode keeps the adaptive resampler (the only floating-point stage) out of the signal path
+  SRC_SetFixedRatioAllowed(exp->fixed_ratio);
+  ReturnOnError(SRC_Configure(rate));
+  ReturnOnError(_DSPTEST_ApplySetup(exp->setup));
+
+  //interpolation image frequency - only exists for interpolated input rates
+  uint32_t image_freq = (rate < SR_96K) ? (uint32_t)rate - freq : 0;
+
+  const q31_t* in_ptrs[SRC_MAX_CHANNELS];
+  q31_t* out_ptrs[SP_MAX_CHANNELS];
+  for (i = 0; i < SRC_MAX_CHANNELS; i++) {
+    in_ptrs[i] = _dsptest_in_bufs[i];
+  }
+  for (i = 0; i < SP_MAX_CHANNELS; i++) {
+    out_ptrs[i] = _dsptest_out_bufs[i];
+  }
+
+  //the adaptive resampling loop needs longer to settle
+  uint32_t settle_batches = exp->fixed_ratio ? DSPTEST_SETTLE_BATCHES : DSPTEST_ADAPTIVE_SETTLE_BATCHES;
+  //fixed ratio: one fit over the whole measurement, at exactly the tone frequency
+  //adaptive: the resampling ratio hunts around 1 by a few ppm, which shifts the tone's phase over a second - so fit short blocks instead
+  uint32_t fit_batches = exp->fixed_ratio ? DSPTEST_MEASURE_BATCHES : DSPTEST_ADAPTIVE_FIT_BATCHES;
+  DSPTEST_FitSums fit;
+  memset(&fit, 0, sizeof(fit));
+  double amplitude_sq = 0.0, fundamental = 0.0, residual = 0.0;
+  uint32_t fit_count = 0;
+  //correlation sums at the image frequency - the measurement covers exactly one second, so all integer frequencies are orthogonal
+  double s_xsi = 0.0, s_xci = 0.0;
+  uint32_t hash = 2166136261UL;
+  uint64_t total_cycles = 0;
+
+  uint32_t in_sample_index = 0;
+  uint32_t out_sample_index = 0;
+  uint32_t batch;
+  for (batch = 0; batch < settle_batches + DSPTEST_MEASURE_BATCHES; batch++) {
+    //input samples for one output batch: exactly rate/1000 per batch on average (one batch = 1ms at 96k)
+    uint32_t in_samples = (uint32_t)(((uint64_t)(batch + 1) * rate) / 1000) - (uint32_t)(((uint64_t)batch * rate) / 1000);
+    for (j = 0; j < in_samples; j++) {
+      //index modulo rate keeps the phase exact for integer frequencies
+      double phase = (2.0 * M_PI * (double)freq * (double)((in_sample_index + j) % rate)) / (double)rate;
+      q31_t sample = (q31_t)lround(DSPTEST_TONE_AMPLITUDE * 32767.0 * sin(phase)) << 16;
+      for (i = 0; i < SRC_MAX_CHANNELS; i++) {
+        _dsptest_in_bufs[i][j] = sample;
+      }
+    }
+    in_sample_index += in_samples;
+
+    uint32_t start_cycles = DWT->CYCCNT;
+    ReturnOnError(SRC_ProcessInputSamples(in_ptrs, 1, SRC_MAX_CHANNELS, in_samples, 0));
+    HAL_StatusTypeDef status = SP_ProduceOutputBatch(out_ptrs, 1, SP_MAX_CHANNELS);
+    uint32_t batch_cycles = DWT->CYCCNT - start_cycles;
+
+    if (status == HAL_BUSY) {
+      //SRC still pre-filling: no output yet
+      continue;
+    } else if (status != HAL_OK) {
+      return status;
+    }
+
+    if (batch >= settle_batches) {
+      if (SRC_IsFixedRatioActive() != exp->fixed_ratio) {
+        DEBUG_PRINTF("* DSP self-test: SRC not in %s mode\n", exp->fixed_ratio ? "fixed-ratio" : "adaptive");
+        return HAL_ERROR;
+      }
+      total_cycles += batch_cycles;
+      for (j = 0; j < SP_BATCH_CHANNEL_SAMPLES; j++) {
+        double phase = (2.0 * M_PI * (double)freq * (double)((out_sample_index + j) % 96000)) / 96000.0;
+        double s = sin(phase);
+        double c = cos(phase);
+        double x = (double)_dsptest_out_bufs[0][j] / 2147483648.0;
+        fit.s_ss += s * s; fit.s_cc += c * c; fit.s_sc += s * c; fit.s_s += s; fit.s_c += c; fit.s_n += 1.0;
+        fit.s_xs += x * s; fit.s_xc += x * c; fit.s_x += x; fit.s_xx += x * x;
+        if (image_freq > 0) {
+          double phase_i = (2.0 * M_PI * (double)image_freq * (double)((out_sample_index + j) % 96000)) / 96000.0;
+          s_xsi += x * sin(phase_i);
+          s_xci += x * cos(phase_i);
+        }
+        for (i = 0; i < SP_MAX_CHANNELS; i++) {
+          hash = _DSPTEST_HashUpdate(hash, (uint32_t)_dsptest_out_bufs[i][j]);
+        }
+      }
+      if ((batch + 1 - settle_batches) % fit_batches == 0) {
+        if (!_DSPTEST_SolveFit(&fit, &amplitude_sq, &fundamental, &residual)) {
+          return HAL_ERROR;
+        }
+        fit_count++;
+        memset(&fit, 0, sizeof(fit));
+      }
+    }
+    out_sample_index += SP_BATCH_CHANNEL_SAMPLES;
+
+    HAL_WWDG_Refresh(&hwwdg1);
+  }
+
+  if (fit_count == 0) {
+    return HAL_ERROR;
+  }
+  double amplitude = sqrt(amplitude_sq / (double)fit_count);
+
+  result->level_dB = 20.0 * log10(amplitude / DSPTEST_TONE_AMPLITUDE);
+  result->thdn_dB = 10.0 * log10(fmax(residual, 1e-30) / fundamental);
+  //image amplitude from the correlation: 2/N * |sum|, compared to the fundamental amplitude
+  double image_amplitude = 2.0 * sqrt(s_xsi * s_xsi + s_xci * s_xci) / ((double)DSPTEST_MEASURE_BATCHES * SP_BATCH_CHANNEL_SAMPLES);
+  result->image_dB = (image_freq > 0) ? 20.0 * log10(fmax(image_amplitude, 1e-15) / amplitude) : -INFINITY;
+  result->hash = hash;
+  result->cycles = (uint32_t)(total_cycles / DSPTEST_MEASURE_BATCHES);
+
+  return HAL_OK;
+}
+
+
+//check a tone result against its expectation, printing every violation - returns whether all checks passed
+static bool _DSPTEST_CheckResult(const DSPTEST_Expectation* exp, const DSPTEST_ToneResult* result) {
+  bool pass = true;
+
+  double level_deviation = fabs(result->level_dB - _DSPTEST_NominalLevel(exp->setup));
+  if (level_deviation > exp->max_level_deviation_dB) {
+    DEBUG_PRINTF("* DSP self-test %lu Hz @ %lu: level deviation %.3f dB exceeds %.3f dB\n", exp->freq, (uint32_t)exp->rate, level_deviation, exp->max_level_deviation_dB);
+    pass = false;
+  }
+  if (result->thdn_dB > exp->max_thdn_dB) {
+    DEBUG_PRINTF("* DSP self-test %lu Hz @ %lu: THD+N %.1f dB exceeds %.1f dB\n", exp->freq, (uint32_t)exp->rate, result->thdn_dB, exp->max_thdn_dB);
+    pass = false;
+  }
+  if (exp->min_image_rejection_dB > 0.0 && -result->image_dB < exp->min_image_rejection_dB) {
+    DEBUG_PRINTF("* DSP self-test %lu Hz @ %lu: image rejection %.1f dB below %.1f dB\n", exp->freq, (uint32_t)exp->rate, -result->image_dB, exp->min_image_rejection_dB);
+    pass = false;
+  }
+  if (exp->hash != 0 && result->hash != exp->hash) {
+    DEBUG_PRINTF("%s DSP self-test %lu Hz @ %lu: hash %08lx doesn't match golden hash %08lx\n", DSPTEST_CHECK_HASHES ? "*" : "(warning)", exp->freq,
+                 (uint32_t)exp->rate, result->hash, exp->hash);
+#if DSPTEST_CHECK_HASHES
+    pass = false;
+#endif
+  }
+
+  return pass;
+}
+
+
+//render all test tones at all input rates, SRC modes and SP setups, print the results and check them against the expected limits and hashes
+//returns HAL_ERROR if any result is out of limits (or doesn't match its golden hash, if checked) - leaves the SP reset with its default settings,
+//SRC needs to be configured afterwards
+HAL_StatusTypeDef DSPTEST_Run() {
+  int i;
+  bool pass = true;
+
+  //make sure the cycle counter is running
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  DEBUG_PRINTF("DSP self-test: %u (adaptive: %u) settle + %u measured batches per tone\n", DSPTEST_SETTLE_BATCHES, DSPTEST_ADAPTIVE_SETTLE_BATCHES,
+               DSPTEST_MEASURE_BATCHES);
+
+  for (i = 0; i < (sizeof(_dsptest_expectations) / sizeof(DSPTEST_Expectation)); i++) {
+    const DSPTEST_Expectation* exp = _dsptest_expectations + i;
+    DSPTEST_ToneResult result;
+    HAL_StatusTypeDef status = _DSPTEST_RenderTone(exp, &result);
+    if (status != HAL_OK) {
+      DEBUG_PRINTF("* DSP self-test failed for %lu Hz at rate %lu: %d\n", exp->freq, (uint32_t)exp->rate, status);
+      SRC_SetFixedRatioAllowed(false);
+      _DSPTEST_ApplySetup(DSPTEST_SETUP_DEFAULT);
+      return status;
+    }
+    DEBUG_PRINTF("DSP self-test %lu Hz @ %lu (%s, %s): level %.3f dB, THD+N %.1f dB, image %.1f dB, hash %08lx, %lu cycles/batch\n",
+                 exp->freq, (uint32_t)exp->rate, exp->fixed_ratio ? "fixed" : "adaptive", (exp->setup == DSPTEST_SETUP_FILTERS) ? "filters" : "default",
+                 result.level_dB, result.thdn_dB, result.image_dB, result.hash, result.cycles);
+    if (!_DSPTEST_CheckResult(exp, &result)) {
+      pass = false;
+    }
+  }
+
+  SRC_SetFixedRatioAllowed(false);
+  ReturnOnError(_DSPTEST_ApplySetup(DSPTEST_SETUP_DEFAULT));
+  return pass ? HAL_OK : HAL_ERROR;
+}
+
+#endif
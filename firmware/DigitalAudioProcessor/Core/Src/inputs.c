@@ -22,6 +22,14 @@ bool inputs_available[_INPUT_COUNT];
 //sources that are available but have been silent for at least one main loop cycle
 static bool _inputs_silent[_INPUT_COUNT];
 
+//input rate tracking: samples received in the current measurement window, SRC output batch count at the window start, and the input sample rate of the window
+static volatile uint32_t _input_rate_window_samples[_INPUT_COUNT];
+static uint32_t _input_rate_window_starts[_INPUT_COUNT];
+static SRC_SampleRate _input_rate_window_rates[_INPUT_COUNT];
+//latest measured relative rate error of each input, and whether it is valid (window long enough, for the current sample rate)
+static float _input_rate_errors[_INPUT_COUNT];
+static bool _input_rate_errors_valid[_INPUT_COUNT];
+
 //parameters of the sample batch currently being transferred over MDMA
 static q31_t    __DTCM_BSS  _input_dma_sample_buf     [INPUT_MAX_CHANNELS * INPUT_MAX_BATCH_CHANNEL_SAMPLES];
 static uint16_t             _input_dma_step           = 0;
@@ -112,6 +120,102 @@ static void _INPUT_ResetI2S(INPUT_Source input) {
 }
 
 
+//get the current sample rate of the given input (from config/info depending on the source) - SR_UNKNOWN for invalid inputs
+static SRC_SampleRate _INPUT_GetSampleRate(INPUT_Source input) {
+  extern USBD_HandleTypeDef hUsbDeviceHS;
+  USBD_AUDIO_HandleTypeDef* haudio;
+
+  switch (input) {
+    case INPUT_I2S1:
+      return input_i2s_sample_rates[0];
+    case INPUT_I2S2:
+      return input_i2s_sample_rates[1];
+    case INPUT_I2S3:
+      return input_i2s_sample_rates[2];
+    case INPUT_USB:
+      haudio = (USBD_AUDIO_HandleTypeDef*)hUsbDeviceHS.pClassDataCmsit[hUsbDeviceHS.classId];
+      return (SRC_SampleRate)haudio->freq;
+    case INPUT_SPDIF:
+      return spdif_sample_rate_enum;
+    default:
+      return SR_UNKNOWN;
+  }
+}
+
+//restart the rate tracking of the given input, discarding its rate error
+static void _INPUT_ResetRateTracking(INPUT_Source input) {
+  _input_rate_window_rates[input] = SR_UNKNOWN;
+  _input_rate_errors_valid[input] = false;
+}
+
+//update the rate tracking of all available inputs - the received samples are counted over a window of SRC output batches
+static void _INPUT_UpdateRateTracking() {
+  int i;
+
+  for (i = 1; i < _INPUT_COUNT; i++) {
+    //skip unavailable inputs
+    if (!inputs_available[i]) {
+      continue;
+    }
+
+    SRC_SampleRate rate = _INPUT_GetSampleRate((INPUT_Source)i);
+    if (!SRC_IsValidSampleRate(rate)) {
+      _INPUT_ResetRateTracking((INPUT_Source)i);
+      continue;
+    }
+
+    //take the window's sample and batch counts, restarting the window if it's new or complete - must happen atomically
+    bool new_window = (rate != _input_rate_window_rates[i]);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t samples = _input_rate_window_samples[i];
+    uint32_t batches = SRC_GetOutputBatchCount() - _input_rate_window_starts[i];
+    if (new_window || batches >= INPUT_RATE_TRACK_MAX_BATCHES) {
+      _input_rate_window_samples[i] = 0;
+      _input_rate_window_starts[i] = SRC_GetOutputBatchCount();
+    }
+    __set_PRIMASK(primask);
+
+    if (new_window) {
+      //first window at this rate: no valid rate error yet
+      _input_rate_window_rates[i] = rate;
+      _input_rate_errors_valid[i] = false;
+      continue;
+    }
+
+    if (batches < INPUT_RATE_TRACK_MIN_BATCHES) {
+      //window too short for an accurate measurement: keep the previous rate error (if any)
+      continue;
+    }
+
+    //rate error: received samples (converted to the SRC output rate) vs. SRC output samples over the window
+    int64_t input_samples = ((int64_t)samples * (int64_t)SR_96K) / (int64_t)rate;
+    int64_t output_samples = (int64_t)batches * SRC_BATCH_CHANNEL_SAMPLES;
+    _input_rate_errors[i] = (float)(input_samples - output_samples) / (float)output_samples;
+    _input_rate_errors_valid[i] = true;
+  }
+}
+
+//re-arm the SRC for a newly activated input: fades out the old signal and starts the adaptive resampling from the input's tracked rate error, if known
+static HAL_StatusTypeDef _INPUT_SwitchSRC(INPUT_Source input) {
+  SRC_SampleRate rate = _INPUT_GetSampleRate(input);
+  if (!SRC_IsValidSampleRate(rate)) {
+    //invalid sample rate
+    DEBUG_PRINTF("* Input %u reported invalid sample rate %u\n", input, rate);
+    return HAL_ERROR;
+  }
+
+  bool rate_changed = (rate != SRC_GetCurrentInputRate());
+  ReturnOnError(SRC_SwitchInput(rate, _input_rate_errors_valid[input], _input_rate_errors[input]));
+
+  if (rate_changed) {
+    I2C_TriggerInterrupt(I2CDEF_DAP_INT_FLAGS_INT_INPUT_RATE_Msk);
+  }
+
+  return HAL_OK;
+}
+
+
 //I2S receive first buffer half callback
 void HAL_I2S_RxHalfCpltCallback(I2S_HandleTypeDef *hi2s) {
   _INPUT_HandleI2SRx(hi2s, 0);
@@ -157,6 +261,9 @@ HAL_StatusTypeDef INPUT_Init() {
   for (i = 0; i < _INPUT_COUNT; i++) {
     inputs_available[i] = false;
     _inputs_silent[i] = false;
+    _input_rate_window_samples[i] = 0;
+    _input_rate_window_starts[i] = 0;
+    _INPUT_ResetRateTracking((INPUT_Source)i);
   }
 
   //initialise I2S sample rates with defaults specified in hardware config
@@ -200,6 +307,8 @@ void INPUT_LoopUpdate() {
       _inputs_silent[i] = true;
     }
   }
+
+  _INPUT_UpdateRateTracking();
 }
 
 //marks the given input as unavailable immediately - if it was active, switches to the next available input (if there is one)
@@ -217,9 +326,10 @@ void INPUT_Stop(INPUT_Source input) {
     return;
   }
 
-  //make unavailable and not silent
+  //make unavailable and not silent, discard rate tracking (source may be different when it becomes available again)
   inputs_available[input] = false;
   _inputs_silent[input] = false;
+  _INPUT_ResetRateTracking(input);
 
   I2C_TriggerInterrupt(I2CDEF_DAP_INT_FLAGS_INT_INPUT_AVAILABLE_Msk);
 
@@ -256,10 +366,16 @@ HAL_StatusTypeDef INPUT_Activate(INPUT_Source input) {
   }
 
   //mark input as active
+  INPUT_Source previous_input = input_active;
   input_active = input;
 
-  //update input's sample rate (including setting up the SRC for it)
-  INPUT_UpdateSampleRate(input_active);
+  if (input != previous_input) {
+    //different input: re-arm the SRC for it, even at the same sample rate - the old input's clock doesn't apply to the new one
+    _INPUT_SwitchSRC(input);
+  } else {
+    //same input: update its sample rate (including setting up the SRC for it)
+    INPUT_UpdateSampleRate(input_active);
+  }
 
   //for I2S inputs: reset for new reception, to avoid data misalignment - unnecessary in most cases, but mightt help some edge cases
   if (input == INPUT_I2S1 || input == INPUT_I2S2 || input == INPUT_I2S3) {
@@ -275,39 +391,19 @@ HAL_StatusTypeDef INPUT_Activate(INPUT_Source input) {
 
 //update the sample rate of the given input (takes sample rate information directly from the corresponding source), applies it to the SRC if the input is active
 HAL_StatusTypeDef INPUT_UpdateSampleRate(INPUT_Source input) {
-  extern USBD_HandleTypeDef hUsbDeviceHS;
-  USBD_AUDIO_HandleTypeDef* haudio;
-
   //check if the input is active - nothing to do for inactive inputs right now
   if (input != input_active) {
     return HAL_OK;
   }
 
-  //get sample rate from config/info depending on the source
-  SRC_SampleRate rate;
-  switch (input) {
-    case INPUT_I2S1:
-      rate = input_i2s_sample_rates[0];
-      break;
-    case INPUT_I2S2:
-      rate = input_i2s_sample_rates[1];
-      break;
-    case INPUT_I2S3:
-      rate = input_i2s_sample_rates[2];
-      break;
-    case INPUT_USB:
-      haudio = (USBD_AUDIO_HandleTypeDef*)hUsbDeviceHS.pClassDataCmsit[hUsbDeviceHS.classId];
-      rate = haudio->freq;
-      break;
-    case INPUT_SPDIF:
-      rate = spdif_sample_rate_enum;
-      break;
-    default:
-      //invalid input
-      DEBUG_PRINTF("* Attempted to update sample rate of invalid input %u\n", input);
-      return HAL_ERROR;
+  //check for valid input
+  if (input <= INPUT_NONE || input >= _INPUT_COUNT) {
+    DEBUG_PRINTF("* Attempted to update sample rate of invalid input %u\n", input);
+    return HAL_ERROR;
   }
 
+  //get sample rate from config/info depending on the source
+  SRC_SampleRate rate = _INPUT_GetSampleRate(input);
   if (!SRC_IsValidSampleRate(rate)) {
     //invalid sample rate
     DEBUG_PRINTF("* Input %u reported invalid sample rate %u\n", input, rate);
@@ -345,6 +441,7 @@ HAL_StatusTypeDef INPUT_ProcessSamples(INPUT_Source input, const q31_t* in_buf,
     I2C_TriggerInterrupt(I2CDEF_DAP_INT_FLAGS_INT_INPUT_AVAILABLE_Msk);
   }
   _inputs_silent[input] = false;
+  _input_rate_window_samples[input] += in_samples;
 
   //if there's no valid active input, activate this input
   if (input_active <= INPUT_NONE || input_active >= _INPUT_COUNT) {
@@ -28,6 +28,7 @@
 #include "sai_out.h"
 #include "inputs.h"
 #include "i2c.h"
+#include "dsp_selftest.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -48,6 +49,8 @@
 /* Private variables ---------------------------------------------------------*/
 
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_rx;
+DMA_HandleTypeDef hdma_i2c1_tx;
 
 I2S_HandleTypeDef hi2s1;
 I2S_HandleTypeDef hi2s2;
@@ -205,6 +208,22 @@ int main(void)
     Error_Handler();
   }
 
+#ifdef DSP_SELFTEST
+  //offline render test of the DSP chain - needs to happen before the output is started, and leaves the SRC unconfigured
+  if (DSPTEST_Run() != HAL_OK) {
+    DEBUG_PRINTF("*** DSP self-test failed!\n");
+    HAL_Delay(100);
+    Error_Handler();
+  }
+  _RefreshWatchdogs();
+
+  if (SRC_Configure(SR_96K) != HAL_OK) {
+    DEBUG_PRINTF("*** SRC config failed!\n");
+    HAL_Delay(100);
+    Error_Handler();
+  }
+#endif
+
   if (SAI_OUT_Init() == HAL_OK) {
     DEBUG_PRINTF("SAI initialised\n");
   } else {
@@ -275,6 +294,7 @@ int main(void)
 
     INPUT_LoopUpdate();
     I2C_LoopUpdate();
+    I2C_StatusLoopUpdate();
 
     loop_count++;
     _RefreshWatchdogs();
@@ -902,6 +922,12 @@ static void MX_DMA_Init(void)
   /* DMA1_Stream4_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 4, 0);
   HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+  /* DMA1_Stream5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+  /* DMA1_Stream6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
 
 }
 
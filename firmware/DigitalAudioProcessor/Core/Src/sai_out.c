@@ -61,3 +61,14 @@ HAL_StatusTypeDef SAI_OUT_Init() {
   //start the circular DMA transfer
   return HAL_SAI_Transmit_DMA(&hsai_BlockB4, (uint8_t*)_sai_out_buffer, SAI_OUT_BUF_SAMPLES);
 }
+
+//get the current DMA read position in the output buffer, in frames, in [0, SAI_OUT_BUF_FRAMES) - for measuring the output clock against other clocks
+uint32_t SAI_OUT_GetBufferFramePosition() {
+  //DMA counter holds the remaining samples until the end of the buffer
+  uint32_t remaining = __HAL_DMA_GET_COUNTER(&hdma_sai4_b);
+  if (remaining == 0 || remaining > SAI_OUT_BUF_SAMPLES) {
+    //not running, or just wrapping around
+    return 0;
+  }
+  return (SAI_OUT_BUF_SAMPLES - remaining) / SAI_OUT_CHANNELS;
+}
@@ -44,6 +44,7 @@
 /*                  FILTER VARIABLES                    */
 /********************************************************/
 
+//coefficient tables are specified in design_simulations/filter_testing_python/filter_specs, verified/regenerated with coeff_gen.py
 //filter coefficients for 2x FIR interpolator
 static const q31_t __ITCM_DATA _src_fir_int2_coeffs[2 * SRC_FIR_INT2_PHASE_LENGTH] = {
 #include "../Data/fir_interp2_coeffs.txt"
@@ -82,6 +83,9 @@ static FFIR_Instance                    __DTCM_BSS  _src_ffir_adap_instances
 static SRC_SampleRate _src_input_rate = SR_UNKNOWN;
 //whether the SRC is ready to produce outputs (i.e. adaptive buffer has been pre-filled)
 static bool _src_output_ready = false;
+//whether fixed-ratio mode (bypassing adaptive resampling) may be used, and whether it is currently active
+static volatile bool _src_fixed_ratio_allowed = false;
+static bool _src_fixed_ratio_active = false;
 
 //semi-circular sample buffers for adaptive resampling, one per channel, read/write pointers are shared/synchronised
 //each length (2 * buflength - 1), read/write pointers are always in [0, buflength), and the entries in [buflength, 2 * buflength - 1) are a copy of entries [0, buflength - 1)
@@ -109,6 +113,20 @@ static int32_t _src_buffer_fill_error_sum;
 static float _src_last_buffer_fill_error_avg;
 //counter of input samples since the last output batch
 static volatile uint16_t _src_input_samples_since_last_output;
+//total number of requested output batches
+static volatile uint32_t _src_output_batch_count = 0;
+
+//known relative input rate error of the current input, used to pre-fill the input rate error history when the SRC becomes ready
+static bool _src_rate_error_seed_valid = false;
+static float _src_rate_error_seed = 0.0f;
+
+//fade gain position, in samples per channel: 0 = silent, SRC_FADE_CHANNEL_SAMPLES = full gain
+#define SRC_FADE_CHANNEL_SAMPLES (SRC_FADE_BATCHES * SRC_BATCH_CHANNEL_SAMPLES)
+static uint32_t _src_fade_position = 0;
+//whether an input switch is pending: the old signal is being faded out, new input samples are dropped until the SRC is reset
+static volatile bool _src_switch_pending = false;
+//whether the SRC has restarted its data stream after a pending input switch, not yet taken by downstream processing
+static volatile bool _src_stream_restarted = false;
 
 //debug access to internal state
 #ifdef DEBUG
@@ -146,6 +164,34 @@ static inline void _PrintLogData(float d1, float d2) {
 /*                 INTERNAL FUNCTIONS                   */
 /********************************************************/
 
+//reset the averaging histories for the adaptive resampling
+//with a known input rate error, the rate error history starts out full and averaging to that error, so the adaptive resampling doesn't need to re-converge
+static void __RAM_FUNC _SRC_ResetAveraging() {
+  int i;
+
+  if (_src_rate_error_seed_valid) {
+    //distribute the error (in samples per batch) over the history, such that all partial sums are rounded multiples of it
+    float batch_error = _src_rate_error_seed * (float)SRC_BATCH_CHANNEL_SAMPLES;
+    int32_t previous_sum = 0;
+    for (i = 0; i < SRC_ADAPTIVE_RATE_ERROR_AVG_BATCHES; i++) {
+      int32_t sum = (int32_t)floorf(batch_error * (float)(i + 1) + 0.5f);
+      _src_input_rate_error_history[i] = (int16_t)(sum - previous_sum);
+      previous_sum = sum;
+    }
+    _src_input_rate_error_length = SRC_ADAPTIVE_RATE_ERROR_AVG_BATCHES;
+    _src_input_rate_error_sum = previous_sum;
+  } else {
+    memset(_src_input_rate_error_history, 0, sizeof(_src_input_rate_error_history));
+    _src_input_rate_error_length = SRC_ADAPTIVE_RATE_ERROR_AVG_BATCHES_INITIAL;
+    _src_input_rate_error_sum = 0;
+  }
+  _src_input_rate_error_history_position = 0;
+  memset(_src_buffer_fill_error_history, 0, sizeof(_src_buffer_fill_error_history));
+  _src_buffer_fill_error_history_position = 0;
+  _src_buffer_fill_error_sum = 0;
+  _src_last_buffer_fill_error_avg = 0.0f;
+}
+
 //should be called after every (block) write to the semi-circular buffer, specifying written channels and number of written samples per channel
 //handles copying newly written data (to maintain semi-circular buffer properties) and updating the write pointer accordingly
 static void __RAM_FUNC _SRC_FinishBufferWrite(uint16_t active_channels, uint32_t written_samples) {
@@ -192,21 +238,121 @@ static void __RAM_FUNC _SRC_FinishBufferWrite(uint16_t active_channels, uint32_t
   if (!_src_output_ready && _src_buffer_available_data() > SRC_BUF_IDEAL_CHANNEL_SAMPLES) {
     DEBUG_PRINTF("SRC ready: buffer filled to %lu samples\n", _src_buffer_available_data());
 
-    //reset averaging data
-    memset(_src_input_rate_error_history, 0, sizeof(_src_input_rate_error_history));
-    _src_input_rate_error_history_position = 0;
-    _src_input_rate_error_length = SRC_ADAPTIVE_RATE_ERROR_AVG_BATCHES_INITIAL;
-    _src_input_rate_error_sum = 0;
-    memset(_src_buffer_fill_error_history, 0, sizeof(_src_buffer_fill_error_history));
-    _src_buffer_fill_error_history_position = 0;
-    _src_buffer_fill_error_sum = 0;
-    _src_last_buffer_fill_error_avg = 0.0f;
+    //reset averaging data, and fade in the new output
+    _SRC_ResetAveraging();
+    _src_fade_position = 0;
+
+    //start in fixed-ratio mode if allowed - adaptive resamplers are still in their reset state then, for a potential fallback later
+    _src_fixed_ratio_active = _src_fixed_ratio_allowed;
+    if (_src_fixed_ratio_active) {
+      DEBUG_PRINTF("SRC using fixed-ratio mode\n");
+      //nothing corrects the fill level quickly in fixed-ratio mode: skip the oldest samples beyond the ideal level (up to one input
+      //packet, depending on its phase) so the buffer starts without a fill error - they're still silent in the fade-in anyway
+      _src_buffer_read_ptr = (_src_buffer_read_ptr + _src_buffer_available_data() - SRC_BUF_IDEAL_CHANNEL_SAMPLES) % SRC_BUF_TOTAL_CHANNEL_SAMPLES;
+    }
 
     _src_output_ready = true;
     I2C_TriggerInterrupt(I2CDEF_DAP_INT_FLAGS_INT_SRC_READY_Msk);
   }
 }
 
+//ends fixed-ratio mode: restarts the adaptive resamplers at a 1:1 ratio, with their filter state primed from the samples preceding the read pointer
+static void _SRC_LeaveFixedRatioMode(uint16_t active_channels) {
+  int i, j;
+
+  for (i = 0; i < active_channels; i++) {
+    FFIR_Instance* ffir_adap = _src_ffir_adap_instances + i;
+    ffir_adap->phase_step_fract = (float)SRC_FFIR_ADAP_PHASE_COUNT;
+    FFIR_Reset(ffir_adap);
+
+    //samples before the read pointer are still valid (circular buffer) - start offset includes one buffer length to avoid negative values
+    uint32_t prime_start = _src_buffer_read_ptr + SRC_BUF_TOTAL_CHANNEL_SAMPLES - (SRC_FFIR_ADAP_PHASE_LENGTH - 1);
+    for (j = 0; j < SRC_FFIR_ADAP_PHASE_LENGTH - 1; j++) {
+      armext_fir_single_shiftonly_q31(ffir_adap->phase_instances, _src_buffers[i] + ((prime_start + j) % SRC_BUF_TOTAL_CHANNEL_SAMPLES));
+    }
+  }
+
+  _src_fixed_ratio_active = false;
+}
+
+//reset the SRC's data stream for the currently configured input rate: disables output, resets filters/resamplers and empties the buffer
+//must be called with interrupts disabled
+static void _SRC_Reset() {
+  int i;
+
+  //disable output until buffer is refilled
+  if (_src_output_ready) {
+    _src_output_ready = false;
+    I2C_TriggerInterrupt(I2CDEF_DAP_INT_FLAGS_INT_SRC_READY_Msk);
+  }
+  _src_fixed_ratio_active = false;
+  _src_switch_pending = false;
+
+  //reset and clear filters/resamplers that are needed for the input rate
+  if (_src_input_rate != SR_96K) {
+    //needs 2x interpolation: clear 2x interpolator states
+    memset(_src_fir_int2_states, 0, sizeof(_src_fir_int2_states));
+
+    if (_src_input_rate == SR_44K) {
+      //needs 160/147 resampling: reset fixed FFIR resamplers
+      for (i = 0; i < SRC_MAX_CHANNELS; i++) {
+        FFIR_Reset(_src_ffir_160147_instances + i);
+      }
+    }
+  }
+  //reset adaptive FFIR resamplers and restore default phase steps
+  for (i = 0; i < SRC_MAX_CHANNELS; i++) {
+    FFIR_Instance* ffir_adap = _src_ffir_adap_instances + i;
+    ffir_adap->phase_step_fract = (float)SRC_FFIR_ADAP_PHASE_COUNT;
+    FFIR_Reset(ffir_adap);
+  }
+
+  //reset adaptive resampling buffer to empty
+  _src_buffer_read_ptr = 0;
+  _src_buffer_write_ptr = 0;
+}
+
+//complete a pending input switch: reset for the new input, and indicate the new data stream to downstream processing
+static void _SRC_CompleteSwitch() {
+  __disable_irq();
+  _SRC_Reset();
+  _src_stream_restarted = true;
+  __enable_irq();
+
+  DEBUG_PRINTF("SRC switched to input sample rate %u\n", _src_input_rate);
+}
+
+//finish a produced output batch: applies the current fade-in or fade-out, and completes a pending input switch once the old signal is faded out
+static void __RAM_FUNC _SRC_FinishOutputBatch(q31_t** out_bufs, uint16_t out_step, uint16_t out_channels) {
+  int i, j;
+
+  if (!_src_switch_pending && _src_fade_position >= SRC_FADE_CHANNEL_SAMPLES) {
+    //full gain, nothing to do
+    return;
+  }
+
+  //linear gain ramp, one step per sample - down when fading out for a switch, up otherwise
+  int32_t fade_step = _src_switch_pending ? -1 : 1;
+  int32_t end_position = 0;
+  for (i = 0; i < out_channels; i++) {
+    q31_t* ptr = out_bufs[i];
+    int32_t position = (int32_t)_src_fade_position;
+    for (j = 0; j < SRC_BATCH_CHANNEL_SAMPLES; j++) {
+      position = MIN(MAX(position + fade_step, 0), SRC_FADE_CHANNEL_SAMPLES);
+      q31_t gain = (q31_t)position * (0x7FFFFFFF / SRC_FADE_CHANNEL_SAMPLES);
+      *ptr = (q31_t)(((q63_t)*ptr * gain) >> 31);
+      ptr += out_step;
+    }
+    end_position = position;
+  }
+  _src_fade_position = (uint32_t)end_position;
+
+  if (_src_switch_pending && _src_fade_position == 0) {
+    //old signal faded out completely: reset for the new input now
+    _SRC_CompleteSwitch();
+  }
+}
+
 
 /********************************************************/
 /*                    API FUNCTIONS                     */
@@ -217,18 +363,16 @@ HAL_StatusTypeDef SRC_Init() {
   //reset SRC's own state - not configured for any sample rate at first
   _src_input_rate = SR_UNKNOWN;
   _src_output_ready = false;
+  _src_fixed_ratio_allowed = false;
+  _src_fixed_ratio_active = false;
   _src_buffer_read_ptr = 0;
   _src_buffer_write_ptr = 0;
+  _src_rate_error_seed_valid = false;
+  _src_switch_pending = false;
+  _src_stream_restarted = false;
 
   //reset averaging data
-  memset(_src_input_rate_error_history, 0, sizeof(_src_input_rate_error_history));
-  _src_input_rate_error_history_position = 0;
-  _src_input_rate_error_length = SRC_ADAPTIVE_RATE_ERROR_AVG_BATCHES_INITIAL;
-  _src_input_rate_error_sum = 0;
-  memset(_src_buffer_fill_error_history, 0, sizeof(_src_buffer_fill_error_history));
-  _src_buffer_fill_error_history_position = 0;
-  _src_buffer_fill_error_sum = 0;
-  _src_last_buffer_fill_error_avg = 0.0f;
+  _SRC_ResetAveraging();
 
 
   //clear 2x interpolator states - doesn't happen automatically because we don't call any init function for them
@@ -277,8 +421,6 @@ bool SRC_IsReady() {
 
 //reset the SRC's internal state and prepare for the conversion of a new input signal at the given sample rate
 HAL_StatusTypeDef SRC_Configure(SRC_SampleRate input_rate) {
-  int i;
-
   //check for valid input rate
   if (!SRC_IsValidSampleRate(input_rate)) {
     DEBUG_PRINTF("* Attempted SRC config with invalid sample rate %lu\n", (uint32_t)input_rate);
@@ -288,37 +430,10 @@ HAL_StatusTypeDef SRC_Configure(SRC_SampleRate input_rate) {
   //reset must happen atomically
   __disable_irq();
 
-  //disable output until buffer is refilled
-  if (_src_output_ready) {
-    _src_output_ready = false;
-    I2C_TriggerInterrupt(I2CDEF_DAP_INT_FLAGS_INT_SRC_READY_Msk);
-  }
-
-  //switch to new input rate
+  //switch to new input rate, without any known rate error, and reset immediately
   _src_input_rate = input_rate;
-
-  //reset and clear filters/resamplers that are needed for the new input rate
-  if (_src_input_rate != SR_96K) {
-    //needs 2x interpolation: clear 2x interpolator states
-    memset(_src_fir_int2_states, 0, sizeof(_src_fir_int2_states));
-
-    if (_src_input_rate == SR_44K) {
-      //needs 160/147 resampling: reset fixed FFIR resamplers
-      for (i = 0; i < SRC_MAX_CHANNELS; i++) {
-        FFIR_Reset(_src_ffir_160147_instances + i);
-      }
-    }
-  }
-  //reset adaptive FFIR resamplers and restore default phase steps
-  for (i = 0; i < SRC_MAX_CHANNELS; i++) {
-    FFIR_Instance* ffir_adap = _src_ffir_adap_instances + i;
-    ffir_adap->phase_step_fract = (float)SRC_FFIR_ADAP_PHASE_COUNT;
-    FFIR_Reset(ffir_adap);
-  }
-
-  //reset adaptive resampling buffer to empty
-  _src_buffer_read_ptr = 0;
-  _src_buffer_write_ptr = 0;
+  _src_rate_error_seed_valid = false;
+  _SRC_Reset();
 
   __enable_irq();
 
@@ -332,11 +447,58 @@ HAL_StatusTypeDef SRC_Configure(SRC_SampleRate input_rate) {
   return HAL_OK;
 }
 
+//switch to a new input signal at the given sample rate - like SRC_Configure, but glitch-free and with a warm start:
+//if the SRC is currently outputting, the buffered old signal is faded out first (new input samples are dropped until the reset happens then)
+//if `rate_error_known`, the adaptive resampling starts from the given relative input rate error (see SRC_GetAverageRateError) instead of re-converging
+HAL_StatusTypeDef SRC_SwitchInput(SRC_SampleRate input_rate, bool rate_error_known, float rate_error) {
+  //check for valid input rate
+  if (!SRC_IsValidSampleRate(input_rate)) {
+    DEBUG_PRINTF("* Attempted SRC switch with invalid sample rate %lu\n", (uint32_t)input_rate);
+    return HAL_ERROR;
+  }
+
+  //ignore rate errors outside of the adaptive resampling range - can't be a correct measurement
+  if (rate_error_known && fabsf(rate_error) * (float)SRC_BATCH_CHANNEL_SAMPLES >= (float)(SRC_BATCH_INPUT_SAMPLES_MAX - SRC_BATCH_CHANNEL_SAMPLES)) {
+    DEBUG_PRINTF("* SRC switch ignoring implausible rate error %f\n", rate_error);
+    rate_error_known = false;
+  }
+
+  //switch must happen atomically
+  __disable_irq();
+
+  _src_input_rate = input_rate;
+  _src_rate_error_seed_valid = rate_error_known;
+  _src_rate_error_seed = rate_error;
+
+  if (_src_output_ready) {
+    //currently outputting: fade out first, the reset happens at the end of the fade-out (picking up the new rate and rate error then)
+    _src_switch_pending = true;
+  } else {
+    //not outputting, nothing to fade out: reset right away
+    _SRC_Reset();
+  }
+
+  __enable_irq();
+
+  DEBUG_PRINTF("SRC switching to input sample rate %u, rate error %s\n", _src_input_rate, rate_error_known ? "known" : "unknown");
+
+  return HAL_OK;
+}
+
 //get the currently configured input sample rate
 SRC_SampleRate SRC_GetCurrentInputRate() {
   return _src_input_rate;
 }
 
+//get and clear whether the SRC has restarted its data stream for a switched input since the last call - downstream state should be reset then
+bool SRC_TakeStreamRestart() {
+  if (!_src_stream_restarted) {
+    return false;
+  }
+  _src_stream_restarted = false;
+  return true;
+}
+
 //get the average relative input rate error
 float SRC_GetAverageRateError() {
   //average error, in samples per batch
@@ -351,6 +513,22 @@ float SRC_GetAverageBufferFillError() {
   return (float)_src_buffer_fill_error_sum / (float)SRC_ADAPTIVE_BUF_ERROR_AVG_BATCHES;
 }
 
+//get the total number of output batches requested so far (whether or not the SRC was ready), as a time base at the output rate
+uint32_t SRC_GetOutputBatchCount() {
+  return _src_output_batch_count;
+}
+
+//allow or disallow fixed-ratio mode, where the adaptive resampling stage is bypassed - for inputs whose source rate is locked to our output clock
+//only takes effect when the SRC becomes ready (starts outputting); disallowing it also ends an active fixed-ratio mode immediately
+void SRC_SetFixedRatioAllowed(bool allowed) {
+  _src_fixed_ratio_allowed = allowed;
+}
+
+//get whether the SRC is currently running in fixed-ratio mode
+bool SRC_IsFixedRatioActive() {
+  return _src_output_ready && _src_fixed_ratio_active;
+}
+
 //process `in_channels` input channels with `in_samples` samples per channel; where inputs were previously shifted to `in_shift` (negative = shifted right)
 //must be at the currently configured input sample rate; to switch sample rate, a re-init is required
 //channels may be in separate buffers or interleaved, starting at `in_bufs[channel]`, each with step size `in_step`
@@ -368,6 +546,11 @@ HAL_StatusTypeDef __RAM_FUNC SRC_ProcessInputSamples(const q31_t** in_bufs, uint
     return HAL_ERROR;
   }
 
+  //drop input samples while the old signal is faded out for an input switch - they belong to the new input already
+  if (_src_switch_pending) {
+    return HAL_OK;
+  }
+
   //calculate required space for the given input samples
   uint32_t required_space;
   switch (_src_input_rate) {
@@ -486,6 +669,8 @@ HAL_StatusTypeDef __RAM_FUNC SRC_ProduceOutputBatch(q31_t** out_bufs, uint16_t o
     return HAL_ERROR;
   }
 
+  _src_output_batch_count++;
+
   //check if we're even ready to output
   if (!_src_output_ready) {
 #ifdef SRC_DEBUG_ADAPTIVE
@@ -500,7 +685,12 @@ HAL_StatusTypeDef __RAM_FUNC SRC_ProduceOutputBatch(q31_t** out_bufs, uint16_t o
 
   //check how many input samples we have
   uint32_t available_input_samples = _src_buffer_available_data();
-  if (available_input_samples < SRC_BUF_CRITICAL_CHANNEL_SAMPLES) {
+  if (available_input_samples < SRC_BUF_CRITICAL_CHANNEL_SAMPLES && _src_switch_pending) {
+    //buffer ran out while fading out for an input switch (no more input): just end the fade-out early and reset for the new input
+    _SRC_CompleteSwitch();
+    _src_input_samples_since_last_output = 0;
+    return HAL_BUSY;
+  } else if (available_input_samples < SRC_BUF_CRITICAL_CHANNEL_SAMPLES) {
     //buffer level is critically low: reset to "not ready" until buffer is refilled sufficiently
     DEBUG_PRINTF("SRC buffer critical (%lu samples), disabling until refilled\n", available_input_samples);
 
@@ -510,6 +700,7 @@ HAL_StatusTypeDef __RAM_FUNC SRC_ProduceOutputBatch(q31_t** out_bufs, uint16_t o
                   _src_ffir_adap_instances[0].phase_step_fract - (float)SRC_BATCH_CHANNEL_SAMPLES);
 #endif
     _src_output_ready = false;
+    _src_fixed_ratio_active = false;
     _src_input_samples_since_last_output = 0;
 
     //stop currently active input (if valid)
@@ -542,6 +733,38 @@ HAL_StatusTypeDef __RAM_FUNC SRC_ProduceOutputBatch(q31_t** out_bufs, uint16_t o
   _src_input_rate_error_history_position = (_src_input_rate_error_history_position + 1) % SRC_ADAPTIVE_RATE_ERROR_AVG_BATCHES;
   _src_buffer_fill_error_history_position = (_src_buffer_fill_error_history_position + 1) % SRC_ADAPTIVE_BUF_ERROR_AVG_BATCHES;
 
+  //in fixed-ratio mode: fall back to adaptive resampling if no longer allowed, or if the buffer fill level drifted too far (source isn't actually locked)
+  if (_src_fixed_ratio_active && (!_src_fixed_ratio_allowed ||
+      buffer_fill_error > SRC_FIXED_RATIO_MAX_FILL_ERROR || buffer_fill_error < -SRC_FIXED_RATIO_MAX_FILL_ERROR)) {
+    DEBUG_PRINTF("SRC leaving fixed-ratio mode (fill error %d samples)\n", buffer_fill_error);
+    _SRC_LeaveFixedRatioMode(out_channels);
+  }
+
+  if (_src_fixed_ratio_active) {
+    //fixed-ratio mode: buffer is already at the output rate, so one batch of output is exactly one batch of buffered samples
+    for (i = 0; i < out_channels; i++) {
+      const q31_t* in_ptr = _src_buffers[i] + _src_buffer_read_ptr;
+      if (out_step == 1) {
+        arm_copy_q31(in_ptr, out_bufs[i], SRC_BATCH_CHANNEL_SAMPLES);
+      } else {
+        q31_t* out_ptr = out_bufs[i];
+        int j;
+        for (j = 0; j < SRC_BATCH_CHANNEL_SAMPLES; j++) {
+          *out_ptr = in_ptr[j];
+          out_ptr += out_step;
+        }
+      }
+    }
+
+    //semi-circular buffer allows the contiguous read above; just advance the read pointer with wrap-around
+    _src_buffer_read_ptr = (_src_buffer_read_ptr + SRC_BATCH_CHANNEL_SAMPLES) % SRC_BUF_TOTAL_CHANNEL_SAMPLES;
+
+    //keep derivative base up to date, so a later fallback to adaptive mode doesn't start with a derivative spike
+    _src_last_buffer_fill_error_avg = (float)_src_buffer_fill_error_sum / (float)SRC_ADAPTIVE_BUF_ERROR_AVG_BATCHES;
+
+    _SRC_FinishOutputBatch(out_bufs, out_step, out_channels);
+    return HAL_OK;
+  }
 
   //compute adaptive resampler's phase step (decimation factor) as the average fill margin (exponential moving average), starting with the first channel
   /*_src_ffir_adap_instances[0].phase_step_fract =
@@ -603,6 +826,8 @@ HAL_StatusTypeDef __RAM_FUNC SRC_ProduceOutputBatch(q31_t** out_bufs, uint16_t o
   //update the buffer read pointer in accordance with the number of input samples we used
   _src_buffer_read_ptr = (_src_buffer_read_ptr + input_samples_consumed) % SRC_BUF_TOTAL_CHANNEL_SAMPLES;
 
+  _SRC_FinishOutputBatch(out_bufs, out_step, out_channels);
+
 #ifdef SRC_DEBUG_TIMING
   _src_debug_time_out_avg = SRC_DEBUG_TIMING_EMA_ALPHA * (float)htim5.Instance->CNT + SRC_DEBUG_TIMING_EMA_1MALPHA * _src_debug_time_out_avg;
   static uint32_t sampcounter = 0;
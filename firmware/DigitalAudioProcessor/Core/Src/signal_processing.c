@@ -9,6 +9,7 @@
 
 #include "signal_processing.h"
 #include "sample_rate_conv.h"
+#include "i2c.h"
 
 
 #define SP_LOUDNESS_BIQUAD_STAGES 4
@@ -53,6 +54,9 @@ static  arm_fir_instance_q31  __DTCM_BSS  _sp_fir_instances [SP_MAX_CHANNELS];
         float __DTCM_BSS  sp_volume_gains_dB[SP_MAX_CHANNELS];
 //whether positive dB volume gains are allowed
         bool              sp_volume_allow_positive_dB = false;
+//scheduled volume gains in dB, and remaining output batches until they're applied - 0 means nothing is scheduled
+static  float             __DTCM_BSS  _sp_volume_gains_delayed_dB[SP_MAX_CHANNELS];
+static  volatile uint32_t             _sp_volume_gains_delay = 0;
 
 //loudness compensation gains in dB - max `SP_MAX_LOUDNESS_GAIN`, less than `SP_MIN_LOUDNESS_ENABLED_GAIN` means loudness compensation is disabled
         float                         __DTCM_BSS  sp_loudness_gains_dB    [SP_MAX_CHANNELS];
@@ -60,6 +64,17 @@ static  arm_fir_instance_q31  __DTCM_BSS  _sp_fir_instances [SP_MAX_CHANNELS];
 static  q31_t                         __DTCM_BSS  _sp_loudness_states     [SP_MAX_CHANNELS][4 * SP_LOUDNESS_BIQUAD_STAGES];
 static  arm_biquad_casd_df1_inst_q31  __DTCM_BSS  _sp_loudness_instances  [SP_MAX_CHANNELS];
 
+//look-ahead delay line (pre-volume samples, in RAM_D1 due to its size), with the peak absolute sample value of each delayed batch, and the current position
+static  q31_t                 _sp_lookahead_delay [SP_MAX_CHANNELS][SP_LOOKAHEAD_BATCHES][SP_BATCH_CHANNEL_SAMPLES];
+static  q31_t __DTCM_BSS      _sp_lookahead_peaks [SP_MAX_CHANNELS][SP_LOOKAHEAD_BATCHES];
+static  uint32_t              _sp_lookahead_pos = 0;
+
+//output envelope per channel (upper bound of the output peak within the look-ahead delay, as fraction of full scale), and the envelope at the last read
+static  float __DTCM_BSS  _sp_output_envelopes[SP_MAX_CHANNELS];
+static  float __DTCM_BSS  _sp_output_envelopes_read[SP_MAX_CHANNELS];
+//peak absolute output sample values per channel since the last peak reset (peak-hold, reset by `SP_ResetOutputPeaks`)
+static  q31_t __DTCM_BSS  _sp_output_peaks[SP_MAX_CHANNELS];
+
 //temporary scratch buffers for processing
 static  q31_t __DTCM_BSS  _sp_scratch_a [SP_MAX_CHANNELS][SP_BATCH_CHANNEL_SAMPLES];
 static  q31_t __DTCM_BSS  _sp_scratch_b [SP_MAX_CHANNELS][SP_BATCH_CHANNEL_SAMPLES];
@@ -123,8 +138,9 @@ HAL_StatusTypeDef SP_Init() {
     //sp_fir_coeffs[i][SP_MAX_FIR_LENGTH - 1] = INT32_MAX;
   }
 
-  //initialise volume gains to 0dB
+  //initialise volume gains to 0dB, with nothing scheduled
   memset(sp_volume_gains_dB, 0, sizeof(sp_volume_gains_dB));
+  _sp_volume_gains_delay = 0;
 
   //initialise loudness biquad cascades
   for (i = 0; i < SP_MAX_CHANNELS; i++) {
@@ -150,6 +166,12 @@ void SP_Reset() {
   memset(_sp_biquad_states, 0, sizeof(_sp_biquad_states));
   memset(_sp_fir_states, 0, sizeof(_sp_fir_states));
   memset(_sp_loudness_states, 0, sizeof(_sp_loudness_states));
+  memset(_sp_lookahead_delay, 0, sizeof(_sp_lookahead_delay));
+  memset(_sp_lookahead_peaks, 0, sizeof(_sp_lookahead_peaks));
+  _sp_lookahead_pos = 0;
+  memset(_sp_output_envelopes, 0, sizeof(_sp_output_envelopes));
+  memset(_sp_output_envelopes_read, 0, sizeof(_sp_output_envelopes_read));
+  memset(_sp_output_peaks, 0, sizeof(_sp_output_peaks));
 }
 
 //setup the biquad filter parameters: number of filters and post-shift for each channel
@@ -225,6 +247,80 @@ void SP_GetFIRSetup(uint16_t* filter_lengths) {
   }
 }
 
+//get output levels per channel (as fraction of full scale): look-ahead envelope (upper bound of the output peak within the next `SP_LOOKAHEAD_BATCHES`)
+//and peak-hold since the last peak reset - non-destructive, either pointer may be null
+void SP_GetOutputLevels(float* envelopes, float* peaks) {
+  int i;
+
+  for (i = 0; i < SP_MAX_CHANNELS; i++) {
+    //read consistently w.r.t. the audio processing interrupt - the read envelope is the reference for the next envelope interrupt
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    float envelope = _sp_output_envelopes[i];
+    q31_t peak = _sp_output_peaks[i];
+    if (envelopes != NULL) {
+      _sp_output_envelopes_read[i] = envelope;
+    }
+    __set_PRIMASK(primask);
+
+    if (envelopes != NULL) {
+      envelopes[i] = envelope;
+    }
+    if (peaks != NULL) {
+      peaks[i] = (float)peak / 2147483648.0f;
+    }
+  }
+}
+
+//reset the output peak-hold values of the channels in the given bit mask (bit n = channel n)
+void SP_ResetOutputPeaks(uint8_t channel_mask) {
+  int i;
+  for (i = 0; i < SP_MAX_CHANNELS; i++) {
+    if ((channel_mask & (1u << i)) != 0) {
+      _sp_output_peaks[i] = 0;
+    }
+  }
+}
+
+//schedule the given volume gains (in dB, assumed valid) to be applied after `delay_batches` output batches (at most `SP_MAX_VOL_GAIN_DELAY`, 0 = next batch)
+//replaces any previously scheduled gains
+HAL_StatusTypeDef SP_SetVolumeGainsDelayed(const float* gains_dB, uint32_t delay_batches) {
+  if (gains_dB == NULL || delay_batches > SP_MAX_VOL_GAIN_DELAY) {
+    DEBUG_PRINTF("* SP delayed volume gains got invalid parameters %p %lu\n", gains_dB, delay_batches);
+    return HAL_ERROR;
+  }
+
+  //update atomically w.r.t. the audio processing interrupt - stored delay is one more than requested, since the countdown happens before applying
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(_sp_volume_gains_delayed_dB, gains_dB, sizeof(_sp_volume_gains_delayed_dB));
+  _sp_volume_gains_delay = delay_batches + 1;
+  __set_PRIMASK(primask);
+
+  return HAL_OK;
+}
+
+//get the volume gains that will be active once scheduled gains are applied (current gains if nothing is scheduled), and the remaining delay in batches,
+//counted like `delay_batches` of SP_SetVolumeGainsDelayed (0 = applied with the next batch, or nothing scheduled)
+void SP_GetVolumeGainsDelayed(float* gains_dB, uint32_t* remaining_batches) {
+  if (gains_dB == NULL || remaining_batches == NULL) {
+    return;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t stored_delay = _sp_volume_gains_delay;
+  //stored delay is one more than the requested delay (see SP_SetVolumeGainsDelayed)
+  *remaining_batches = stored_delay > 0 ? stored_delay - 1 : 0;
+  memcpy(gains_dB, stored_delay > 0 ? _sp_volume_gains_delayed_dB : sp_volume_gains_dB, sizeof(_sp_volume_gains_delayed_dB));
+  __set_PRIMASK(primask);
+}
+
+//discard scheduled volume gains, if any (when new gains are applied directly)
+void SP_CancelVolumeGainsDelayed() {
+  _sp_volume_gains_delay = 0;
+}
+
 //produce `out_channels` output channels with `SP_BATCH_CHANNEL_SAMPLES` samples per channel
 //output buffer(s) must have enough space for a full batch of samples!
 //channels may be in separate buffers or interleaved, starting at `out_bufs[channel]`, each with step size `out_step`
@@ -238,6 +334,16 @@ HAL_StatusTypeDef __RAM_FUNC SP_ProduceOutputBatch(q31_t** out_bufs, uint16_t ou
     return HAL_ERROR;
   }
 
+  //count down scheduled volume gains, and apply them when due - counted for every output batch, even if no input is available or the SP is disabled
+  if (_sp_volume_gains_delay > 0 && --_sp_volume_gains_delay == 0) {
+    memcpy(sp_volume_gains_dB, _sp_volume_gains_delayed_dB, sizeof(sp_volume_gains_dB));
+  }
+
+  //SRC restarted its data stream for a switched input (old signal faded out by now): reset our filter states, so they don't carry over into the new signal
+  if (SRC_TakeStreamRestart()) {
+    SP_Reset();
+  }
+
   //process SRC output batch into scratch A
   q31_t* src_output_bufs[SRC_MAX_CHANNELS];
   for (i = 0; i < SRC_MAX_CHANNELS; i++) {
@@ -290,6 +396,23 @@ HAL_StatusTypeDef __RAM_FUNC SP_ProduceOutputBatch(q31_t** out_bufs, uint16_t ou
   }
   _SwapScratchPointers();
 
+  //look-ahead delay: record the peak of the new batch, and exchange it for the oldest batch in the delay line
+  for (i = 0; i < out_channels; i++) {
+    q31_t peak;
+    uint32_t peak_index;
+    arm_absmax_q31(scratch_in[i], SP_BATCH_CHANNEL_SAMPLES, &peak, &peak_index);
+    _sp_lookahead_peaks[i][_sp_lookahead_pos] = peak;
+    arm_copy_q31(_sp_lookahead_delay[i][_sp_lookahead_pos], scratch_out[i], SP_BATCH_CHANNEL_SAMPLES);
+    arm_copy_q31(scratch_in[i], _sp_lookahead_delay[i][_sp_lookahead_pos], SP_BATCH_CHANNEL_SAMPLES);
+  }
+  if (++_sp_lookahead_pos >= SP_LOOKAHEAD_BATCHES) {
+    _sp_lookahead_pos = 0;
+  }
+  _SwapScratchPointers();
+
+  //upper bound of the total volume + loudness gain per channel, for the output envelope
+  float output_gain_bounds[SP_MAX_CHANNELS];
+
   //process volume gains and loudness compensation
   for (i = 0; i < out_channels; i++) {
     //get gain and clamp it to the valid range
@@ -310,6 +433,7 @@ HAL_StatusTypeDef __RAM_FUNC SP_ProduceOutputBatch(q31_t** out_bufs, uint16_t ou
       //unity gain: no processing needed and loudness compensation doesn't apply either
       //just copy the existing data, taking into account the SRC output shift and desired SP output shift
       arm_shift_q31(scratch_in[i], SP_OUTPUT_SHIFT - SRC_OUTPUT_SHIFT, scratch_out[i], SP_BATCH_CHANNEL_SAMPLES);
+      output_gain_bounds[i] = 1.0f;
     } else {
       //non-unity gain: get linear volume gain
       float vol_gain_linear = powf(10.0f, vol_gain_dB / 20.0f);
@@ -326,6 +450,7 @@ HAL_StatusTypeDef __RAM_FUNC SP_ProduceOutputBatch(q31_t** out_bufs, uint16_t ou
       if (vol_gain_dB > 0.0f || loudness_gain_dB < SP_MIN_LOUDNESS_ENABLED_GAIN) {
         //no loudness compensation: just apply volume gain, taking into account the SRC output shift and desired SP output shift
         _SP_ApplyGain(scratch_in[i], scratch_out[i], vol_gain_linear, SP_OUTPUT_SHIFT - SRC_OUTPUT_SHIFT);
+        output_gain_bounds[i] = vol_gain_linear;
       } else {
         //loudness compensation necessary: split into two paths: filtered signal, original signal
         //start by undoing SRC output shift to give the biquads maximum dynamic range to work with (these biquads scale the signal down a lot)
@@ -341,6 +466,7 @@ HAL_StatusTypeDef __RAM_FUNC SP_ProduceOutputBatch(q31_t** out_bufs, uint16_t ou
         if (loudness_gain_linear > max_loudness_gain_linear) {
           loudness_gain_linear = max_loudness_gain_linear;
         }
+        output_gain_bounds[i] = vol_gain_linear + loudness_gain_linear;
         //multiply loudness compensation gain by biquad post gain to cancel out the signal reduction caused by the biquads themselves
         loudness_gain_linear *= SP_LOUDNESS_BIQUAD_POST_GAIN;
         //apply resulting loudness compensation gain, taking into account the desired SP output shift
@@ -356,6 +482,31 @@ HAL_StatusTypeDef __RAM_FUNC SP_ProduceOutputBatch(q31_t** out_bufs, uint16_t ou
   }
   _SwapScratchPointers();
 
+  //update output peak-hold values, and the output envelopes for supply envelope tracking: peak of the delay line contents at the current gains
+  bool envelope_rise = false;
+  for (i = 0; i < out_channels; i++) {
+    q31_t peak;
+    uint32_t peak_index;
+    arm_absmax_q31(scratch_in[i], SP_BATCH_CHANNEL_SAMPLES, &peak, &peak_index);
+    if (peak > _sp_output_peaks[i]) {
+      _sp_output_peaks[i] = peak;
+    }
+
+    arm_max_q31(_sp_lookahead_peaks[i], SP_LOOKAHEAD_BATCHES, &peak, &peak_index);
+    float envelope = ldexpf((float)peak, SP_OUTPUT_SHIFT - SRC_OUTPUT_SHIFT - 31) * output_gain_bounds[i];
+    _sp_output_envelopes[i] = MIN(envelope, 1.0f);
+
+    if (_sp_output_envelopes[i] >= SP_ENVELOPE_INT_MIN_LEVEL && _sp_output_envelopes[i] > _sp_output_envelopes_read[i] * SP_ENVELOPE_INT_RISE) {
+      //only interrupt once per rise: the new envelope is the reference until it's read
+      _sp_output_envelopes_read[i] = _sp_output_envelopes[i];
+      envelope_rise = true;
+    }
+  }
+  if (envelope_rise) {
+    //notify the controller of the envelope rise, so the supply can follow before the delayed audio is output
+    I2C_TriggerInterrupt(I2CDEF_DAP_INT_FLAGS_INT_OUTPUT_ENVELOPE_Msk);
+  }
+
   //final output
   if (out_step == 1) {
     //non-interleaved output: can just directly copy out
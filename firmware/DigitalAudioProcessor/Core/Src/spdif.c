@@ -26,13 +26,20 @@ static bool _spdif_control_valid = false;
 //whether the last control block is acceptable for data reception
 static bool _spdif_control_acceptable = false;
 
+//history of WIDTH5 readings for median filtering, and current write position
+static uint16_t _spdif_width5_history[SPDIF_RATE_HISTORY_LENGTH];
+static uint16_t _spdif_width5_history_position = 0;
 //last detected reception sample rate (approximate)
 /*static*/ float _spdif_sample_rate_approx = 0.0f;
 //last detected reception sample rate (enum value); unknown if invalid or unsupported rate or too far away from nominal rate
 SRC_SampleRate spdif_sample_rate_enum = SR_UNKNOWN;
 
-//temporary sample buffers for sample batch processing
+//temporary sample buffers and validity flags for sample batch processing, for batches that need sorting or concealment
 static q31_t _spdif_sample_temp_bufs[2][SPDIF_RX_BATCH_CHANNEL_SAMPLES];
+static bool _spdif_sample_temp_valid[2][SPDIF_RX_BATCH_CHANNEL_SAMPLES];
+//concealment state per channel: last valid sample, and number of consecutive invalid samples so far
+static q31_t _spdif_conceal_last_sample[2];
+static uint32_t _spdif_conceal_run_length[2];
 
 
 //reset the SPDIF reception logic
@@ -44,8 +51,12 @@ static void _SPDIF_Reset() {
   _spdif_control_buffer_pointer = 0;
   _spdif_control_valid = false;
   _spdif_control_acceptable = false;
+  memset(_spdif_width5_history, 0, sizeof(_spdif_width5_history));
+  _spdif_width5_history_position = 0;
   _spdif_sample_rate_approx = 0.0f;
   spdif_sample_rate_enum = SR_UNKNOWN;
+  memset(_spdif_conceal_last_sample, 0, sizeof(_spdif_conceal_last_sample));
+  memset(_spdif_conceal_run_length, 0, sizeof(_spdif_conceal_run_length));
 
   //enable sync complete and interface error interrupts and start sync
   __HAL_SPDIFRX_IDLE(&hspdif1);
@@ -109,32 +120,48 @@ static void _SPDIF_ProcessControl(uint32_t buffer_offset) {
       _spdif_control_buffer_pointer = 0;
     }
 
-    //extract data if we're within a valid block
-    if (_spdif_control_valid) {
+    //extract data if we're within a valid block (and its length)
+    if (_spdif_control_valid && _spdif_control_buffer_pointer < SPDIF_RX_CTLBLOCK_CHANNEL_BYTES) {
       _spdif_control_data[_spdif_control_buffer_pointer] = (uint8_t)((control_word & SPDIFRX_CSR_CS_Msk) >> SPDIFRX_CSR_CS_Pos);
       _spdif_control_user_data[_spdif_control_buffer_pointer] = (uint16_t)((control_word & SPDIFRX_CSR_USR_Msk) >> SPDIFRX_CSR_USR_Pos);
+      _spdif_control_buffer_pointer++;
     }
   }
 }
 
-//process sample data from the reception buffer at the given offset
-static void _SPDIF_ProcessSamples(uint32_t buffer_offset) {
+//update the sample rate detection with the current WIDTH5 reading; returns false if the input was stopped due to an unknown rate
+static bool _SPDIF_UpdateSampleRate() {
   int i, j;
 
+  //add current reading to the history
+  _spdif_width5_history[_spdif_width5_history_position] = (uint16_t)((hspdif1.Instance->SR & SPDIFRX_SR_WIDTH5_Msk) >> SPDIFRX_SR_WIDTH5_Pos);
+  _spdif_width5_history_position = (_spdif_width5_history_position + 1) % SPDIF_RATE_HISTORY_LENGTH;
+
+  //find median reading (insertion sort of a copy) - rejects single outliers without the lag of an average
+  uint16_t sorted[SPDIF_RATE_HISTORY_LENGTH];
+  for (i = 0; i < SPDIF_RATE_HISTORY_LENGTH; i++) {
+    uint16_t value = _spdif_width5_history[i];
+    for (j = i; j > 0 && sorted[j - 1] > value; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = value;
+  }
+  uint16_t width5 = sorted[SPDIF_RATE_HISTORY_LENGTH / 2];
+
   //calculate approximate sample rate - TODO: ideally this should be based on the true I2C_CKIN frequency (measured somehow?) instead of just the kernel frequency
-  uint32_t width5 = (hspdif1.Instance->SR & SPDIFRX_SR_WIDTH5_Msk) >> SPDIFRX_SR_WIDTH5_Pos;
-  float raw_approx_rate = (5.0f * (float)SPDIF_KERNEL_CLK_FREQ) / ((float)width5 * 64.0f);
-  //apply exponential smoothing
-  _spdif_sample_rate_approx = SPDIF_SAMPLE_RATE_EMA_ALPHA * raw_approx_rate + SPDIF_SAMPLE_RATE_EMA_1MALPHA * _spdif_sample_rate_approx;
+  _spdif_sample_rate_approx = (width5 == 0) ? 0.0f : (5.0f * (float)SPDIF_KERNEL_CLK_FREQ) / ((float)width5 * 64.0f);
 
   //sample rate error margin, depending on whether we already have a valid sample rate or not
   float error_margin = SRC_IsValidSampleRate(spdif_sample_rate_enum) ? SPDIF_MAX_SAMPLE_RATE_ERROR_OFF : SPDIF_MAX_SAMPLE_RATE_ERROR_ON;
 
-  //find corresponding sample rate enum value, if there is one
+  //find corresponding sample rate enum value, if there is one - keep the current rate while it's within the (wider) deactivation margin
   SRC_SampleRate detected_rate = SR_UNKNOWN;
-  const SRC_SampleRate possible_rates[] = { SR_44K, SR_48K, SR_96K };
+  const SRC_SampleRate possible_rates[] = { spdif_sample_rate_enum, SR_44K, SR_48K, SR_96K };
   for (i = 0; i < (sizeof(possible_rates) / sizeof(SRC_SampleRate)); i++) {
     SRC_SampleRate rate = possible_rates[i];
+    if (!SRC_IsValidSampleRate(rate)) {
+      continue;
+    }
     //absolute relative error to the given rate
     float error = fabsf((_spdif_sample_rate_approx / (float)rate) - 1.0f);
     if (error < error_margin) {
@@ -142,6 +169,8 @@ static void _SPDIF_ProcessSamples(uint32_t buffer_offset) {
       detected_rate = rate;
       break;
     }
+    //other rates need to be within the activation margin
+    error_margin = SPDIF_MAX_SAMPLE_RATE_ERROR_ON;
   }
 
   //update sample rate setting if it changed
@@ -150,42 +179,118 @@ static void _SPDIF_ProcessSamples(uint32_t buffer_offset) {
 
     //apply corresponding action to the input management logic
     if (detected_rate == SR_UNKNOWN) {
-      //unknown/invalid rate: disable input, and return as we're done processing this batch for sure
+      //unknown/invalid rate: disable input
       INPUT_Stop(INPUT_SPDIF);
-      return;
+      return false;
     } else {
       //valid rate: update rate
       INPUT_UpdateSampleRate(INPUT_SPDIF);
     }
   }
 
+  return true;
+}
+
+//conceal invalid samples of the given channel in the temporary buffer: short bursts are linearly interpolated (or held at the end of the batch), long ones are muted
+static void _SPDIF_ConcealChannel(uint32_t channel) {
+  int i, k;
+  q31_t* buf = _spdif_sample_temp_bufs[channel];
+  const bool* valid = _spdif_sample_temp_valid[channel];
+  q31_t last = _spdif_conceal_last_sample[channel];
+  uint32_t run = _spdif_conceal_run_length[channel];
+  int gap_start = -1;
+
+  for (i = 0; i < SPDIF_RX_BATCH_CHANNEL_SAMPLES; i++) {
+    if (valid[i]) {
+      if (gap_start >= 0) {
+        //end of a gap: interpolate if it's short and started within this batch (otherwise the held/muted values stay)
+        uint32_t gap_length = i - gap_start;
+        if (run == gap_length && run <= SPDIF_CONCEAL_MAX_SAMPLES) {
+          int64_t diff = (int64_t)buf[i] - (int64_t)last;
+          for (k = 0; k < gap_length; k++) {
+            buf[gap_start + k] = last + (q31_t)((diff * (k + 1)) / (int64_t)(gap_length + 1));
+          }
+        }
+        gap_start = -1;
+      }
+      run = 0;
+      last = buf[i];
+    } else {
+      if (gap_start < 0) {
+        gap_start = i;
+      }
+      //hold the last valid sample for now, or mute if the burst is too long
+      run++;
+      buf[i] = (run <= SPDIF_CONCEAL_MAX_SAMPLES) ? last : 0;
+    }
+  }
+
+  _spdif_conceal_last_sample[channel] = last;
+  _spdif_conceal_run_length[channel] = run;
+}
+
+//process sample data from the reception buffer at the given offset
+static void _SPDIF_ProcessSamples(uint32_t buffer_offset) {
+  int i;
+
+  if (!_SPDIF_UpdateSampleRate()) {
+    //input stopped: we're done processing this batch for sure
+    return;
+  }
+
   if (!_spdif_control_valid || !_spdif_control_acceptable || !SRC_IsValidSampleRate(spdif_sample_rate_enum)) {
     //invalid conditions for reception: ignore sample batch
     return;
   }
 
-  //process samples in pairs
-  for (i = 0; i < SPDIF_RX_BATCH_CHANNEL_SAMPLES; i++) {
-    uint32_t rx_buf_offset = buffer_offset + 2 * i;
+  uint32_t* rx_buf = (uint32_t*)_spdif_sample_rx_buffer + buffer_offset;
+
+  //check the whole batch at once: all samples valid, and channels in the expected order (A on even, B on odd positions)?
+  uint32_t status_or = 0;
+  uint32_t right_pt_and = SPDIFRX_DR1_PT_Msk;
+  uint32_t left_pt_is_b = 0;
+  for (i = 0; i < SPDIF_RX_BATCH_TOTAL_SAMPLES; i += 2) {
+    uint32_t left = rx_buf[i];
+    uint32_t right = rx_buf[i + 1];
+    status_or |= left | right;
+    right_pt_and &= right;
+    left_pt_is_b |= left & (left >> 1); //both preamble type bits set = channel B preamble
+  }
 
-    for (j = 0; j < 2; j++) {
-      uint32_t rx_sample = _spdif_sample_rx_buffer[rx_buf_offset + j];
+  if ((status_or & SPDIFRX_DR1_V_Msk) == 0 && (right_pt_and & SPDIFRX_DR1_PT_Msk) == SPDIFRX_DR1_PT_Msk &&
+      (left_pt_is_b & (1UL << SPDIFRX_DR1_PT_Pos)) == 0) {
+    //good batch: strip status bits in place and pass the interleaved buffer on directly
+    for (i = 0; i < SPDIF_RX_BATCH_TOTAL_SAMPLES; i++) {
+      rx_buf[i] &= SPDIFRX_DR1_DR_Msk;
+    }
+    _spdif_conceal_last_sample[0] = (q31_t)rx_buf[SPDIF_RX_BATCH_TOTAL_SAMPLES - 2];
+    _spdif_conceal_last_sample[1] = (q31_t)rx_buf[SPDIF_RX_BATCH_TOTAL_SAMPLES - 1];
+    _spdif_conceal_run_length[0] = 0;
+    _spdif_conceal_run_length[1] = 0;
 
-      //detect channel by preamble type
-      uint32_t preamble_type = (rx_sample & SPDIFRX_DR1_PT_Msk) >> SPDIFRX_DR1_PT_Pos;
-      uint32_t channel = (preamble_type == 0x3) ? 1 : 0;
+    INPUT_ProcessSamples(INPUT_SPDIF, (q31_t*)rx_buf, 2, 2, SPDIF_RX_BATCH_CHANNEL_SAMPLES, SPDIF_RX_BATCH_CHANNEL_SAMPLES, 0);
+    return;
+  }
 
-      //copy data or zero, based on validity
-      if ((rx_sample & SPDIFRX_DR1_V_Msk) == 0) {
-        //valid data: copy
-        _spdif_sample_temp_bufs[channel][i] = (rx_sample & SPDIFRX_DR1_DR_Msk);
-      } else {
-        //invalid data: write zero
-        _spdif_sample_temp_bufs[channel][i] = 0;
-      }
+  //batch with invalid or misordered samples: sort samples into channels by preamble, marking missing or invalid ones for concealment
+  memset(_spdif_sample_temp_valid, 0, sizeof(_spdif_sample_temp_valid));
+  for (i = 0; i < SPDIF_RX_BATCH_TOTAL_SAMPLES; i++) {
+    uint32_t rx_sample = rx_buf[i];
+
+    //detect channel by preamble type
+    uint32_t preamble_type = (rx_sample & SPDIFRX_DR1_PT_Msk) >> SPDIFRX_DR1_PT_Pos;
+    uint32_t channel = (preamble_type == 0x3) ? 1 : 0;
+
+    //copy data if valid
+    if ((rx_sample & SPDIFRX_DR1_V_Msk) == 0) {
+      _spdif_sample_temp_bufs[channel][i / 2] = (rx_sample & SPDIFRX_DR1_DR_Msk);
+      _spdif_sample_temp_valid[channel][i / 2] = true;
     }
   }
 
+  _SPDIF_ConcealChannel(0);
+  _SPDIF_ConcealChannel(1);
+
   //pass samples to input
   INPUT_ProcessSamples(INPUT_SPDIF, _spdif_sample_temp_bufs[0], 1, 2, SPDIF_RX_BATCH_CHANNEL_SAMPLES, SPDIF_RX_BATCH_CHANNEL_SAMPLES, 0);
 }
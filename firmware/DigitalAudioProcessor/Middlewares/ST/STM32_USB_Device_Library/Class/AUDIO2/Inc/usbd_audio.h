@@ -72,7 +72,11 @@
 #define SOF_RATE                                      0x02U
 
 //#define USB_AUDIO_CONFIG_DESC_SIZ                     124
-#define USB_AUDIO_CONFIG_DESC_SIZ                     115
+#define USB_AUDIO_CONFIG_DESC_SIZ                     182
+
+/* Streaming alternate settings: 0 = zero bandwidth, 1 = 24-bit samples, 2 = 32-bit samples */
+#define AUDIO_OUT_ALT_SETTING_24B                     0x01U
+#define AUDIO_OUT_ALT_SETTING_32B                     0x02U
 
 #define AUDIO_INTERFACE_DESC_SIZE                     0x09U
 #define USB_AUDIO_DESC_SIZ                            0x09U
@@ -137,6 +141,10 @@
 // e.g. 96kHz, 24bit : (96000 / 1000 + 1) * 2(stereo) * 3(24bit) = 582 bytes
 
 #define AUDIO_OUT_PACKET_24B                          ((uint16_t)((USBD_AUDIO_FREQ_MAX / 1000U + 1) * 2U * 3U))
+// e.g. 96kHz, 32bit : (96000 / 1000 + 1) * 2(stereo) * 4(32bit) = 776 bytes
+#define AUDIO_OUT_PACKET_32B                          ((uint16_t)((USBD_AUDIO_FREQ_MAX / 1000U + 1) * 2U * 4U))
+// Largest packet of any supported format, used for endpoint setup and receive buffer sizing
+#define AUDIO_OUT_PACKET_MAX                          AUDIO_OUT_PACKET_32B
 
 /* Input endpoint is for feedback. See USB 1.1 Spec, 5.10.4.2 Feedback. */
 #define AUDIO_IN_PACKET                               3U
@@ -227,10 +235,8 @@ typedef struct
 
 //#define DEBUG_FEEDBACK_ENDPOINT
 #ifdef DEBUG_FEEDBACK_ENDPOINT
-extern volatile uint32_t  DbgMinWritableSamples;
-extern volatile uint32_t  DbgMaxWritableSamples;
 extern volatile uint32_t  DbgSofHistory[];
-extern volatile uint32_t  DbgWritableSampleHistory[];
+extern volatile float     DbgFillErrorHistory[];
 extern volatile float     DbgFeedbackHistory[];
 extern volatile uint8_t   DbgIndex;
 #endif
@@ -22,12 +22,12 @@
   *          The current audio class version supports the following audio features:
   *             - Pulse Coded Modulation (PCM) format
   *             - sampling rate: 44.1kHz, 48kHz, 96kHz
-  *             - Bit resolution: 24
+  *             - Bit resolution: 24 (alternate setting 1), 32 (alternate setting 2)
   *             - Number of channels: 2
   *             - Volume control max=0dB, min=-96dB, 3dB attenuation steps
   *             - Mute/Unmute
   *             - Asynchronous Endpoints
-  *             - Endpoint for Sampling frequency DbgFeedbackHistory 10.14 3bytes
+  *             - Endpoint for Sampling frequency feedback 10.14 3bytes, measured against the SAI output clock
   ******************************************************************************
   */
 
@@ -36,6 +36,8 @@
 #include "main.h"
 #include "stm32h7xx_ll_dma.h"
 #include "inputs.h"
+#include "sai_out.h"
+#include "sample_rate_conv.h"
 
 
 #define AUDIO_SAMPLE_FREQ(frq) (uint8_t)(frq), (uint8_t)((frq >> 8)), (uint8_t)((frq >> 16))
@@ -46,12 +48,28 @@
 #define AUDIO_PACKET_SZE_24B(frq) (uint8_t)(((frq / 1000U + 1) * 2U * 3U) & 0xFFU), \
                                   (uint8_t)((((frq / 1000U + 1) * 2U * 3U) >> 8) & 0xFFU)
 
+#define AUDIO_PACKET_SZE_32B(frq) (uint8_t)(((frq / 1000U + 1) * 2U * 4U) & 0xFFU), \
+                                  (uint8_t)((((frq / 1000U + 1) * 2U * 4U) >> 8) & 0xFFU)
+
 
 #define AUDIO_FB_DEFAULT AUDIO_FB_DEFAULT_96K
 
-// DbgFeedbackHistory is limited to +/- 1kHz
+// Feedback value is limited to nominal +/- 1kHz
 #define  AUDIO_FB_DELTA_MAX (uint32_t)(1 << 22)
 
+// Rate of the SAI output clock (and the SRC buffer), which the feedback value is measured against
+#define AUDIO_FB_OUTPUT_RATE 96000U
+// Output frames are counted over this many SOFs (ms) per measurement: resolution is 1/AUDIO_FB_MEAS_WINDOW_SOFS frames per ms
+#define AUDIO_FB_MEAS_WINDOW_SOFS 1024U
+// Smoothing of successive measurements: filtered += (measured - filtered) >> shift
+#define AUDIO_FB_MEAS_FILTER_SHIFT 2U
+// Time (in ms) over which an SRC buffer fill error is corrected through the feedback value.
+// Must be well above the SRC's fill error averaging time (~8.5s), otherwise the loop overshoots
+#define AUDIO_FB_FILL_CORRECTION_TIME_MS 32768.0f
+// Maximum averaged SRC buffer fill error (in samples) for the host to be considered locked to our clock, and for unlocking again (hysteresis)
+#define AUDIO_FB_LOCK_MAX_FILL_ERROR 24.0f
+#define AUDIO_FB_UNLOCK_MIN_FILL_ERROR 96.0f
+
 static uint8_t USBD_AUDIO_Init(USBD_HandleTypeDef* pdev, uint8_t cfgidx);
 static uint8_t USBD_AUDIO_DeInit(USBD_HandleTypeDef* pdev, uint8_t cfgidx);
 static uint8_t USBD_AUDIO_Setup(USBD_HandleTypeDef* pdev, USBD_SetupReqTypedef* req);
@@ -190,7 +208,7 @@ __ALIGN_BEGIN static uint8_t USBD_AUDIO_CfgDesc[USB_AUDIO_CONFIG_DESC_SIZ] __ALI
     USB_DESC_TYPE_INTERFACE,       /* bDescriptorType */
     0x01,                          /* bInterfaceNumber */
     0x01,                          /* bAlternateSetting */
-    0x01,//0x02,                   /* bNumEndpoints - 1 output & 1 feedback */
+    0x02,                          /* bNumEndpoints - 1 output & 1 feedback */
     USB_DEVICE_CLASS_AUDIO,        /* bInterfaceClass */
     AUDIO_SUBCLASS_AUDIOSTREAMING, /* bInterfaceSubClass */
     AUDIO_PROTOCOL_UNDEFINED,      /* bInterfaceProtocol */
@@ -226,11 +244,11 @@ __ALIGN_BEGIN static uint8_t USBD_AUDIO_CfgDesc[USB_AUDIO_CONFIG_DESC_SIZ] __ALI
     AUDIO_STANDARD_ENDPOINT_DESC_SIZE,         /* bLength */
     USB_DESC_TYPE_ENDPOINT,                    /* bDescriptorType */
     AUDIO_OUT_EP,                              /* bEndpointAddress 1 out endpoint*/
-    USBD_EP_TYPE_ISOC_ADAPTIVE,                /* bmAttributes */
+    USBD_EP_TYPE_ISOC_ASYNC,                   /* bmAttributes */
     AUDIO_PACKET_SZE_24B(USBD_AUDIO_FREQ_MAX), /* wMaxPacketSize in Bytes (freq / 1000 + extra_samples) * channels * bytes_per_sample */
     0x01,                                      /* bInterval */
     0x00,                                      /* bRefresh */
-    0x00,//AUDIO_IN_EP,                        /* bSynchAddress */
+    AUDIO_IN_EP,                               /* bSynchAddress */
     // 09 byte
 
     // Endpoint - Audio Streaming Descriptor
@@ -245,14 +263,86 @@ __ALIGN_BEGIN static uint8_t USBD_AUDIO_CfgDesc[USB_AUDIO_CONFIG_DESC_SIZ] __ALI
 
     // Endpoint 2 - Standard Descriptor - See UAC Spec 1.0 p.63 4.6.2.1 Standard AS Isochronous Synch Endpoint Descriptor
     // 3byte 10.14 sampling frequency feedback to host
-    //AUDIO_STANDARD_ENDPOINT_DESC_SIZE, /* bLength */
-    //USB_DESC_TYPE_ENDPOINT,            /* bDescriptorType */
-    //AUDIO_IN_EP,                       /* bEndpointAddress */
-    //0x11,                              /* bmAttributes */
-    //0x03, 0x00,                        /* wMaxPacketSize in Bytes */
-    //0x01,                              /* bInterval 1ms */
-    //SOF_RATE,                          /* bRefresh 4ms = 2^2 */
-    //0x00,                              /* bSynchAddress */
+    AUDIO_STANDARD_ENDPOINT_DESC_SIZE, /* bLength */
+    USB_DESC_TYPE_ENDPOINT,            /* bDescriptorType */
+    AUDIO_IN_EP,                       /* bEndpointAddress */
+    0x11,                              /* bmAttributes */
+    AUDIO_IN_PACKET, 0x00,             /* wMaxPacketSize in Bytes */
+    0x01,                              /* bInterval 1ms */
+    SOF_RATE,                          /* bRefresh 4ms = 2^2 */
+    0x00,                              /* bSynchAddress */
+    // 09 byte
+
+    // USB Speaker Standard AS Interface Descriptor
+    // Interface 1, Alternate Setting 2
+    // Used when Audio Streaming is in operation with 32-bit samples
+    AUDIO_INTERFACE_DESC_SIZE,     /* bLength */
+    USB_DESC_TYPE_INTERFACE,       /* bDescriptorType */
+    0x01,                          /* bInterfaceNumber */
+    0x02,                          /* bAlternateSetting */
+    0x02,                          /* bNumEndpoints - 1 output & 1 feedback */
+    USB_DEVICE_CLASS_AUDIO,        /* bInterfaceClass */
+    AUDIO_SUBCLASS_AUDIOSTREAMING, /* bInterfaceSubClass */
+    AUDIO_PROTOCOL_UNDEFINED,      /* bInterfaceProtocol */
+    0x00,                          /* iInterface */
+    // 09 byte
+
+    // USB Speaker Audio Streaming Interface Descriptor
+    AUDIO_STREAMING_INTERFACE_DESC_SIZE, /* bLength */
+    AUDIO_INTERFACE_DESCRIPTOR_TYPE,     /* bDescriptorType */
+    AUDIO_STREAMING_GENERAL,             /* bDescriptorSubtype */
+    0x01,                                /* bTerminalLink */
+    0x01,                                /* bDelay */
+    0x01,                                /* wFormatTag AUDIO_FORMAT_PCM  0x0001*/
+    0x00,
+    // 07 byte
+
+    // USB Speaker Audio Type I Format Interface Descriptor
+    17,                            /* bLength */
+    AUDIO_INTERFACE_DESCRIPTOR_TYPE, /* bDescriptorType */
+    AUDIO_STREAMING_FORMAT_TYPE,     /* bDescriptorSubtype */
+    AUDIO_FORMAT_TYPE_I,             /* bFormatType */
+    2,                            /* bNrChannels */
+    4,                            /* bSubFrameSize :  4 Bytes per frame (32bits) */
+    32,                            /* bBitResolution (32-bits per sample) */
+    3,                            /* bSamFreqType 3 frequencies supported */
+    AUDIO_SAMPLE_FREQ(44100),        /* Audio sampling frequency coded on 3 bytes */
+    AUDIO_SAMPLE_FREQ(48000),        /* Audio sampling frequency coded on 3 bytes */
+    AUDIO_SAMPLE_FREQ(96000),        /* Audio sampling frequency coded on 3 bytes */
+    // 17 byte
+
+    // Endpoint 1 - Standard Descriptor
+    // Isochronous Async endpoint for audio packets
+    AUDIO_STANDARD_ENDPOINT_DESC_SIZE,         /* bLength */
+    USB_DESC_TYPE_ENDPOINT,                    /* bDescriptorType */
+    AUDIO_OUT_EP,                              /* bEndpointAddress 1 out endpoint*/
+    USBD_EP_TYPE_ISOC_ASYNC,                   /* bmAttributes */
+    AUDIO_PACKET_SZE_32B(USBD_AUDIO_FREQ_MAX), /* wMaxPacketSize in Bytes (freq / 1000 + extra_samples) * channels * bytes_per_sample */
+    0x01,                                      /* bInterval */
+    0x00,                                      /* bRefresh */
+    AUDIO_IN_EP,                               /* bSynchAddress */
+    // 09 byte
+
+    // Endpoint - Audio Streaming Descriptor
+    AUDIO_STREAMING_ENDPOINT_DESC_SIZE, /* bLength */
+    AUDIO_ENDPOINT_DESCRIPTOR_TYPE,     /* bDescriptorType */
+    AUDIO_ENDPOINT_GENERAL,             /* bDescriptor */
+    0x01,                               /* bmAttributes - Sampling Frequency control is supported. See UAC Spec 1.0 p.62 */
+    0x01,                               /* bLockDelayUnits */
+    0x10,                               /* wLockDelay */
+    0x00,
+    // 07 byte
+
+    // Endpoint 2 - Standard Descriptor - See UAC Spec 1.0 p.63 4.6.2.1 Standard AS Isochronous Synch Endpoint Descriptor
+    // 3byte 10.14 sampling frequency feedback to host
+    AUDIO_STANDARD_ENDPOINT_DESC_SIZE, /* bLength */
+    USB_DESC_TYPE_ENDPOINT,            /* bDescriptorType */
+    AUDIO_IN_EP,                       /* bEndpointAddress */
+    0x11,                              /* bmAttributes */
+    AUDIO_IN_PACKET, 0x00,             /* wMaxPacketSize in Bytes */
+    0x01,                              /* bInterval 1ms */
+    SOF_RATE,                          /* bRefresh 4ms = 2^2 */
+    0x00,                              /* bSynchAddress */
     // 09 byte
 
 };
@@ -280,7 +370,16 @@ volatile uint32_t all_ready = 0;
 
 volatile uint32_t fb_nom = AUDIO_FB_DEFAULT;
 volatile uint32_t fb_value = AUDIO_FB_DEFAULT;
-volatile uint32_t audio_buf_writable_samples_last = AUDIO_TOTAL_BUF_SIZE /(2*6);
+
+// Output clock measurement state: frames counted in the current window, filtered output rate in frames per ms (10.22 format)
+static uint32_t fb_meas_last_fnsof = 0;
+static uint32_t fb_meas_last_frame_pos = 0;
+static uint32_t fb_meas_sofs = 0;
+static uint32_t fb_meas_frames = 0;
+static uint32_t fb_meas_out_rate = 0;
+static uint8_t fb_meas_valid = 0U;
+// Whether the host's rate is locked to our output clock (so the SRC may skip adaptive resampling)
+static uint8_t fb_locked = 0U;
 
 volatile uint8_t fb_data[3] = {
     (uint8_t)((AUDIO_FB_DEFAULT >> 8) & 0x000000FF),
@@ -289,8 +388,10 @@ volatile uint8_t fb_data[3] = {
 };
 
 
-static uint8_t tmpbuf[1024];
+// receive buffer must be word-aligned for block unpacking
+__ALIGN_BEGIN static uint8_t tmpbuf[1024] __ALIGN_END;
 
+// channel sample capacity - 24-bit packets hold the most samples per packet of all formats
 #define SAMPLEBUF_CH_SAMPLE_COUNT (AUDIO_OUT_PACKET_24B / 6 + 1)
 static q31_t sample_bufs[2][SAMPLEBUF_CH_SAMPLE_COUNT];
 
@@ -316,17 +417,17 @@ static uint8_t USBD_AUDIO_Init(USBD_HandleTypeDef* pdev, uint8_t cfgidx) {
   USBD_AUDIO_HandleTypeDef* haudio;
 
   /* Open EP OUT */
-  USBD_LL_OpenEP(pdev, AUDIO_OUT_EP, USBD_EP_TYPE_ISOC, AUDIO_OUT_PACKET_24B);
+  USBD_LL_OpenEP(pdev, AUDIO_OUT_EP, USBD_EP_TYPE_ISOC, AUDIO_OUT_PACKET_MAX);
   pdev->ep_out[AUDIO_OUT_EP & 0xFU].is_used = 1U;
   pdev->ep_out[AUDIO_OUT_EP & 0xFU].bInterval = 1U;
 
   /* Open EP IN */
-  /*USBD_LL_OpenEP(pdev, AUDIO_IN_EP, USBD_EP_TYPE_ISOC, AUDIO_IN_PACKET);
+  USBD_LL_OpenEP(pdev, AUDIO_IN_EP, USBD_EP_TYPE_ISOC, AUDIO_IN_PACKET);
   pdev->ep_in[AUDIO_IN_EP & 0xFU].is_used = 1U;
-  pdev->ep_in[AUDIO_OUT_EP & 0xFU].bInterval = 1U;*/
+  pdev->ep_in[AUDIO_IN_EP & 0xFU].bInterval = 1U;
 
   /* Flush feedback endpoint */
-  //USBD_LL_FlushEP(pdev, AUDIO_IN_EP);
+  USBD_LL_FlushEP(pdev, AUDIO_IN_EP);
 
   /** 
    * Set tx_flag 1 to block feedback transmission in SOF handler since 
@@ -361,7 +462,7 @@ static uint8_t USBD_AUDIO_Init(USBD_HandleTypeDef* pdev, uint8_t cfgidx) {
   }
 
   /* Prepare Out endpoint to receive 1st packet */
-  uint8_t rr = USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_24B);
+  uint8_t rr = USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_MAX);
 
   return rr;
 }
@@ -383,11 +484,13 @@ static uint8_t USBD_AUDIO_DeInit(USBD_HandleTypeDef* pdev, uint8_t cfgidx) {
   pdev->ep_out[AUDIO_OUT_EP & 0xFU].is_used = 0U;
 
   /* Close EP IN */
-  /*USBD_LL_CloseEP(pdev, AUDIO_IN_EP);
-  pdev->ep_in[AUDIO_IN_EP & 0xFU].is_used = 0U;*/
+  USBD_LL_CloseEP(pdev, AUDIO_IN_EP);
+  pdev->ep_in[AUDIO_IN_EP & 0xFU].is_used = 0U;
 
   /* Clear feedback transmission flag */
   tx_flag = 0U;
+  fb_locked = 0U;
+  SRC_SetFixedRatioAllowed(false);
 
   /* DeInit physical Interface components */
   if (pdev->pClassDataCmsit[pdev->classId] != NULL) {
@@ -479,7 +582,7 @@ static uint8_t USBD_AUDIO_Setup(USBD_HandleTypeDef* pdev, USBD_SetupReqTypedef*
 
         case USB_REQ_SET_INTERFACE:
           if (pdev->dev_state == USBD_STATE_CONFIGURED) {
-            if ((uint8_t)(req->wValue) <= USBD_MAX_NUM_INTERFACES) {
+            if ((uint8_t)(req->wValue) <= AUDIO_OUT_ALT_SETTING_32B) {
               /* Do things only when alt_setting changes */
               if (haudio->alt_setting != (uint8_t)(req->wValue)) {
                 DEBUG_PRINTF("alt setting change %lu to %u\n", haudio->alt_setting, (uint8_t)(req->wValue));
@@ -487,11 +590,12 @@ static uint8_t USBD_AUDIO_Setup(USBD_HandleTypeDef* pdev, USBD_SetupReqTypedef*
                 if (haudio->alt_setting == 0U) {
                 	AUDIO_OUT_StopAndReset(pdev);
                 } else {
-                	haudio->bit_depth = USBD_AUDIO_BIT_DEPTH_DEFAULT;
+                  /* Sample format is determined by the alternate setting */
+                  haudio->bit_depth = (haudio->alt_setting == AUDIO_OUT_ALT_SETTING_32B) ? 32U : 24U;
                   AUDIO_OUT_Restart(pdev);
                 }
               }
-              //USBD_LL_FlushEP(pdev, AUDIO_IN_EP);
+              USBD_LL_FlushEP(pdev, AUDIO_IN_EP);
             } else {
               /* Call the error management function (command will be nacked */
               USBD_CtlError(pdev, req);
@@ -540,23 +644,70 @@ static uint8_t* USBD_AUDIO_GetCfgDesc(uint16_t* length) {
   */
 static uint8_t USBD_AUDIO_DataIn(USBD_HandleTypeDef* pdev, uint8_t epnum) {
   /* epnum is the lowest 4 bits of bEndpointAddress. See UAC 1.0 spec, p.61 */
-  /*if (epnum == (AUDIO_IN_EP & 0xf)) {
+  if (epnum == (AUDIO_IN_EP & 0xf)) {
     tx_flag = 0U;
-  }*/
+  }
   return USBD_OK;
 }
 
 
 #ifdef DEBUG_FEEDBACK_ENDPOINT
-volatile uint32_t  DbgMinWritableSamples = 99999;
-volatile uint32_t  DbgMaxWritableSamples = 0;
 volatile uint32_t  DbgSofHistory[256] = {0};
-volatile uint32_t  DbgWritableSampleHistory[256] = {0};
+volatile float     DbgFillErrorHistory[256] = {0};
 volatile float     DbgFeedbackHistory[256] = {0};
 volatile uint8_t   DbgIndex = 0; // roll over every 256 entries
 static volatile uint32_t  DbgSofCounter = 0;
 #endif
 
+#ifndef USBD_AUDIO_FNSOF_EMULATED
+/**
+  * @brief  USBD_AUDIO_GetFrameNumber
+  *         Read the current USB frame number (FNSOF) from the core's device status register
+  *         Host builds define USBD_AUDIO_FNSOF_EMULATED and provide an emulation of this instead
+  * @retval frame number
+  */
+static inline uint32_t USBD_AUDIO_GetFrameNumber(void) {
+  USB_OTG_GlobalTypeDef* USBx = USB_OTG_HS;
+  uint32_t USBx_BASE = (uint32_t)USBx;
+  return (USBx_DEVICE->DSTS & USB_OTG_DSTS_FNSOF) >> 8;
+}
+#endif
+
+/**
+  * @brief  USBD_AUDIO_MeasureOutputClock
+  *         Count SAI output frames between SOFs to measure the output clock against the host's 1ms frame clock
+  *         The SAI DMA buffer holds 2ms of frames, so the per-SOF difference is unambiguous as long as no SOF is missed
+  * @param  fnsof_new: current USB frame number
+  * @retval None
+  */
+static void USBD_AUDIO_MeasureOutputClock(uint32_t fnsof_new) {
+  uint32_t frame_pos = SAI_OUT_GetBufferFramePosition();
+
+  if (((fb_meas_last_fnsof + 1U) & 0x7FFU) == fnsof_new) {
+    fb_meas_frames += (frame_pos + SAI_OUT_BUF_FRAMES - fb_meas_last_frame_pos) % SAI_OUT_BUF_FRAMES;
+    fb_meas_sofs++;
+  } else {
+    // Missed SOF (or first one after a pause): restart the current window
+    fb_meas_frames = 0U;
+    fb_meas_sofs = 0U;
+  }
+  fb_meas_last_fnsof = fnsof_new;
+  fb_meas_last_frame_pos = frame_pos;
+
+  if (fb_meas_sofs >= AUDIO_FB_MEAS_WINDOW_SOFS) {
+    // Window complete: output frames per ms, in 10.22 format
+    uint32_t out_rate = (uint32_t)(((uint64_t)fb_meas_frames << 22) / AUDIO_FB_MEAS_WINDOW_SOFS);
+    if (fb_meas_valid == 1U) {
+      fb_meas_out_rate += (int32_t)(out_rate - fb_meas_out_rate) >> AUDIO_FB_MEAS_FILTER_SHIFT;
+    } else {
+      fb_meas_out_rate = out_rate;
+      fb_meas_valid = 1U;
+    }
+    fb_meas_frames = 0U;
+    fb_meas_sofs = 0U;
+  }
+}
+
 /**
   * @brief  USBD_AUDIO_SOF
   *         handle SOF event
@@ -566,87 +717,66 @@ static volatile uint32_t  DbgSofCounter = 0;
 static uint8_t USBD_AUDIO_SOF(USBD_HandleTypeDef* pdev) {
   USBD_AUDIO_HandleTypeDef* haudio;
   haudio = (USBD_AUDIO_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
-  static volatile uint32_t sof_count = 0;
+
+  /* Get FNSOF */
+  uint32_t fnsof_new = USBD_AUDIO_GetFrameNumber();
+
+  /* Measure the output clock continuously, so the feedback is accurate from the start of streaming */
+  USBD_AUDIO_MeasureOutputClock(fnsof_new);
+
+  if (haudio == NULL) {
+    return USBD_OK;
+  }
 
   /* Do stuff only when playing */
-  if (haudio->rd_enable == 1U && all_ready == 1U) {
+  if (all_ready == 1U && fb_meas_valid == 1U) {
 #ifdef DEBUG_FEEDBACK_ENDPOINT
     DbgSofCounter++;
 #endif
-    // Update audio read pointer
-    //haudio->rd_ptr = AUDIO_TOTAL_BUF_SIZE - (LL_DMA_ReadReg(BDMA_Channel0, CNDTR) & 0xFFFF);
-
-    // Calculate remaining writable buffer samples
-    uint32_t audio_buf_writable_samples = AUDIO_TOTAL_BUF_SIZE/(2*6);/*haudio->rd_ptr < haudio->wr_ptr ?
-    		  (haudio->rd_ptr + AUDIO_TOTAL_BUF_SIZE - haudio->wr_ptr)/6 : (haudio->rd_ptr - haudio->wr_ptr)/6;*/
+    // The feedback is the measured output rate, converted to the host's sample rate - the SRC converts back at a fixed ratio.
+    // On top of that, a slow proportional correction steers the SRC buffer towards its ideal fill level,
+    // which makes up for measurement error and lets the SRC run without adaptive resampling.
+    uint8_t src_active = (input_active == INPUT_USB && SRC_IsReady()) ? 1U : 0U;
+    float fill_error = (src_active == 1U) ? SRC_GetAverageBufferFillError() : 0.0f;
+
+    int64_t fb_new = ((int64_t)fb_meas_out_rate * haudio->freq) / AUDIO_FB_OUTPUT_RATE;
+    fb_new -= (int64_t)(fill_error * ((float)haudio->freq * (float)(1 << 22) / ((float)AUDIO_FB_OUTPUT_RATE * AUDIO_FB_FILL_CORRECTION_TIME_MS)));
+
+    // Clamp feedback value to nominal value +/- 1kHz
+    if (fb_new > (int64_t)(fb_nom + AUDIO_FB_DELTA_MAX)) {
+      fb_new = fb_nom + AUDIO_FB_DELTA_MAX;
+    } else if (fb_new < (int64_t)(fb_nom - AUDIO_FB_DELTA_MAX)) {
+      fb_new = fb_nom - AUDIO_FB_DELTA_MAX;
+    }
+    fb_value = (uint32_t)fb_new;
 
-    // Monitor remaining writable buffer samples with LED
-    /*if (audio_buf_writable_samples < AUDIO_BUF_SAFEZONE_SAMPLES) {
-    	//BSP_OnboardLED_On();
-      HAL_GPIO_WritePin(LD3_GPIO_Port, LD3_Pin, GPIO_PIN_SET);
+    // Lock detection with hysteresis: fixed-ratio SRC is only allowed while the buffer stays near its ideal level
+    float fill_error_abs = fabsf(fill_error);
+    if (fb_locked == 1U) {
+      fb_locked = (fill_error_abs < AUDIO_FB_UNLOCK_MIN_FILL_ERROR) ? 1U : 0U;
     } else {
-      HAL_GPIO_WritePin(LD3_GPIO_Port, LD3_Pin, GPIO_PIN_RESET);
-    }*/
-
-    sof_count += 1;
-
-    if (sof_count == 1U) {
-      sof_count = 0;
-
-      // we start transmitting to I2S DAC when the audio buffer is half full, so the optimal
-      // remaining writable size is (AUDIO_TOTAL_BUF_SIZE/2)/6 samples
-      // Calculate feedback value based on the deviation from optimal
-      int32_t audio_buf_writable_dev_from_nom_samples = audio_buf_writable_samples - AUDIO_TOTAL_BUF_SIZE/(2*6);
-
-      // The feedback is ideally the true Fs generated by the I2S PLL clock and dividers. Unfortunately we have no means
-      // to measure it internally. So we can only start with a nominal value calculated by assuming the HSE clock crystal
-      // has 0ppm accuracy, and calculate the Fs frequency generated by the PLLI2S N, R, I2SDIV and ODD register values.
-      // We then modify this nominal feedback frequency by the deviation from the ideal write pointer position wrt the read
-      // pointer over time.
-      // Need to multiply by at least a "PID k factor" of (1<<22) + 256 for a deviation of 1 sample to produce a change in feedback
-      // as the internal fb value = (10.14) shifted 8bits in uint32_t.
-      // We also should use the minimum "PID k factor" that keeps the write-pointer to read-pointer distance out of the
-      // danger zone. This is to minimize the distortion caused by changes in host sampling frequency Fs.
-      uint64_t tmp = (uint64_t)((int32_t)(1<<22) + (audio_buf_writable_dev_from_nom_samples * 256));
-      uint64_t pid_k = ((uint64_t)fb_nom) * tmp;
-      fb_value = (uint32_t)(pid_k >> 22);
-      // Clamp feedback value to nominal value +/- 1kHz
-      if (fb_value > fb_nom +  AUDIO_FB_DELTA_MAX) {
-        fb_value = fb_nom +  AUDIO_FB_DELTA_MAX;
-      } else if (fb_value < fb_nom -  AUDIO_FB_DELTA_MAX) {
-        fb_value = fb_nom -  AUDIO_FB_DELTA_MAX;
-      }
+      fb_locked = (fill_error_abs < AUDIO_FB_LOCK_MAX_FILL_ERROR) ? 1U : 0U;
+    }
+    SRC_SetFixedRatioAllowed(input_active == INPUT_USB && fb_locked == 1U);
 
 #ifdef DEBUG_FEEDBACK_ENDPOINT
-      if (audio_buf_writable_samples != audio_buf_writable_samples_last) {
-        if (audio_buf_writable_samples > DbgMaxWritableSamples) DbgMaxWritableSamples = audio_buf_writable_samples;
-        if (audio_buf_writable_samples < DbgMinWritableSamples) DbgMinWritableSamples = audio_buf_writable_samples;
-        DbgWritableSampleHistory[DbgIndex] = audio_buf_writable_samples;
-        DbgFeedbackHistory[DbgIndex] = (float)(fb_value >> 8)/(float)(1<<14);
-        DbgSofHistory[DbgIndex] = DbgSofCounter;
-        DbgIndex++; // uint8_t, so only record last 256 entries
-      }
-#endif
-
-      // Update last writable buffer size
-      audio_buf_writable_samples_last = audio_buf_writable_samples;
-      // Set 10.14 format feedback data
-      // Order of 3 bytes in feedback packet: { LO byte, MID byte, HI byte }
-      fb_data[0] = (uint8_t)((fb_value >> 8) & 0x000000FF);
-      fb_data[1] = (uint8_t)((fb_value >> 16) & 0x000000FF);
-      fb_data[2] = (uint8_t)((fb_value >> 24) & 0x000000FF);
+    if ((DbgSofCounter & 0x3FFU) == 0U) {
+      DbgFillErrorHistory[DbgIndex] = fill_error;
+      DbgFeedbackHistory[DbgIndex] = (float)(fb_value >> 8)/(float)(1<<14);
+      DbgSofHistory[DbgIndex] = DbgSofCounter;
+      DbgIndex++; // uint8_t, so only record last 256 entries
     }
-
+#endif
 
     /* Transmit feedback only when the last one is transmitted */
     if (tx_flag == 0U) {
-      /* Get FNSOF. Use volatile for fnsof_new since its address is mapped to a hardware register. */
-      USB_OTG_GlobalTypeDef* USBx = USB_OTG_HS;
-      uint32_t USBx_BASE = (uint32_t)USBx;
-      uint32_t volatile fnsof_new = (USBx_DEVICE->DSTS & USB_OTG_DSTS_FNSOF) >> 8;
-
       if ((fnsof & 0x1) == (fnsof_new & 0x1)) {
-        //USBD_LL_Transmit(pdev, AUDIO_IN_EP, (uint8_t*)fb_data, 3U);
+        // Set 10.14 format feedback data
+        // Order of 3 bytes in feedback packet: { LO byte, MID byte, HI byte }
+        fb_data[0] = (uint8_t)((fb_value >> 8) & 0x000000FF);
+        fb_data[1] = (uint8_t)((fb_value >> 16) & 0x000000FF);
+        fb_data[2] = (uint8_t)((fb_value >> 24) & 0x000000FF);
+        USBD_LL_Transmit(pdev, AUDIO_IN_EP, (uint8_t*)fb_data, 3U);
         /* Block transmission until it's finished. */
         tx_flag = 1U;
       }
@@ -686,14 +816,12 @@ void USBD_AUDIO_Sync(USBD_HandleTypeDef* pdev, AUDIO_OffsetTypeDef offset) {
   * @retval status
   */
 static uint8_t USBD_AUDIO_IsoINIncomplete(USBD_HandleTypeDef* pdev, uint8_t epnum) {
-  /*USB_OTG_GlobalTypeDef* USBx = USB_OTG_HS;
-  uint32_t USBx_BASE = (uint32_t)USBx;
-  fnsof = (USBx_DEVICE->DSTS & USB_OTG_DSTS_FNSOF) >> 8;
+  fnsof = USBD_AUDIO_GetFrameNumber();
 
   if (tx_flag == 1U) {
     tx_flag = 0U;
     USBD_LL_FlushEP(pdev, AUDIO_IN_EP);
-  }*/
+  }
 
   return USBD_OK;
 }
@@ -714,33 +842,84 @@ static uint8_t USBD_AUDIO_IsoOutIncomplete(USBD_HandleTypeDef* pdev, uint8_t epn
 	USBD_LL_FlushEP(pdev, AUDIO_OUT_EP);
 
 	/* Prepare Out endpoint to receive next audio packet */
-	(void)USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_24B);
+	(void)USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_MAX);
 
 	return (uint8_t)USBD_OK;
 }
 
 
-typedef union UN32_ {
-	uint8_t b[4];
-	int32_t s;
-} UN32;
+//#define USBD_AUDIO_DEBUG_TIMING
+#ifdef USBD_AUDIO_DEBUG_TIMING
+volatile uint32_t DbgUnpackCycles = 0;
+volatile uint32_t DbgUnpackSamples = 0;
+#endif
 
-// ref : https://www.microchip.com/forums/m932509.aspx
+/**
+  * @brief  USBD_AUDIO_Unpack24
+  *         Unpack interleaved 24-bit stereo data into left-aligned q31 channel buffers
+  *         Works on whole words: every 3 words (12 bytes) hold 2 stereo frames (4 samples)
+  * @param  in: word-aligned packet data
+  * @param  out_l: left channel output buffer
+  * @param  out_r: right channel output buffer
+  * @param  frames: number of stereo frames in the packet
+  * @param  scale_mask: 0xFFFFFFFF to scale all samples by 0.75 (odd 3dB attenuation step), 0 otherwise
+  */
+// Byte layout of two frames (LSbyte first): b0-b2 = L0, b3-b5 = R0, b6-b8 = L1, b9-b11 = R1
+// Taking the 3 sample bytes into the upper 24 bits of a word gives the left-aligned q31 value directly (sign included)
+static inline void USBD_AUDIO_Unpack24(const uint32_t* in, q31_t* out_l, q31_t* out_r, uint32_t frames, uint32_t scale_mask) {
+  uint32_t pairs = frames >> 1;
+  q31_t s;
+
+  while (pairs-- > 0U) {
+    uint32_t w0 = in[0];
+    uint32_t w1 = in[1];
+    uint32_t w2 = in[2];
+
+    s = (q31_t)(w0 << 8);
+    out_l[0] = s - ((s >> 2) & scale_mask);
+    s = (q31_t)((w1 << 16) | ((w0 >> 16) & 0x0000FF00U));
+    out_r[0] = s - ((s >> 2) & scale_mask);
+    s = (q31_t)((w2 << 24) | ((w1 >> 8) & 0x00FFFF00U));
+    out_l[1] = s - ((s >> 2) & scale_mask);
+    s = (q31_t)(w2 & 0xFFFFFF00U);
+    out_r[1] = s - ((s >> 2) & scale_mask);
+
+    in += 3;
+    out_l += 2;
+    out_r += 2;
+  }
 
-/*inline*/ int32_t USBD_AUDIO_Volume_Ctrl(int32_t sample, int32_t shift_3dB) {
-	int32_t sample_atten = sample;
-	int32_t shift_6dB = shift_3dB>>1;
+  // Odd frame count: last frame only occupies 1.5 words (reading the full second word is fine, the receive buffer is larger than any packet)
+  if (frames & 1U) {
+    uint32_t w0 = in[0];
+    uint32_t w1 = in[1];
 
-	if (shift_3dB & 1) {
-    // shift_3dB is odd, implement 6dB shift and compensate
-    shift_6dB++;
-    sample_atten >>= shift_6dB;
-    sample_atten += (sample_atten>>1);
-  } else {
-    // shift_3dB is even, implement with 6dB shift
-    sample_atten >>= shift_6dB;
+    s = (q31_t)(w0 << 8);
+    out_l[0] = s - ((s >> 2) & scale_mask);
+    s = (q31_t)((w1 << 16) | ((w0 >> 16) & 0x0000FF00U));
+    out_r[0] = s - ((s >> 2) & scale_mask);
+  }
+}
+
+/**
+  * @brief  USBD_AUDIO_Unpack32
+  *         De-interleave 32-bit stereo data into q31 channel buffers
+  * @param  in: word-aligned packet data
+  * @param  out_l: left channel output buffer
+  * @param  out_r: right channel output buffer
+  * @param  frames: number of stereo frames in the packet
+  * @param  scale_mask: 0xFFFFFFFF to scale all samples by 0.75 (odd 3dB attenuation step), 0 otherwise
+  */
+static inline void USBD_AUDIO_Unpack32(const uint32_t* in, q31_t* out_l, q31_t* out_r, uint32_t frames, uint32_t scale_mask) {
+  q31_t s;
+
+  while (frames-- > 0U) {
+    s = (q31_t)in[0];
+    *out_l++ = s - ((s >> 2) & scale_mask);
+    s = (q31_t)in[1];
+    *out_r++ = s - ((s >> 2) & scale_mask);
+    in += 2;
   }
-	return sample_atten;
 }
 
 /**
@@ -750,88 +929,58 @@ typedef union UN32_ {
   * @param  epnum: endpoint index
   * @retval status
   */
-// incoming USB audio data buffer : uint8_t array
-// Each 24bit stereo sample is encoded as : L channel 3bytes + R channel 3bytes, LSbyte first
+// incoming USB audio data buffer : uint8_t array (word-aligned)
+// 24-bit format (alt setting 1): each stereo sample is encoded as : L channel 3bytes + R channel 3bytes, LSbyte first
 // b0:lo_L, b1:mid_L, b2:hi_L, b3:lo_R, b4:mid_R, b5:hi_R
+// 32-bit format (alt setting 2): each stereo sample is encoded as : L channel 4bytes + R channel 4bytes, LSbyte first
 
 // volume control is implemented by scaling the data, attenuation resolution is 3dB.
-// 6dB is equivalent to a shift right by 1 bit.
+// 6dB is equivalent to a shift right by 1 bit. Whole 6dB steps are not applied here, but passed on as the input shift,
+// so they get folded into the shift that the SRC applies to all incoming samples anyway.
+// The remaining odd 3dB step (x0.75) and mute are applied in the same pass as the unpacking.
 
-// outgoing I2S Philips data format is : left-aligned 24bits in 32bit frame, MSbyte first
-// STM32 I2S peripheral uses a 16bit data register
-// => outgoing I2S transmit data buffer : uint16_t array
-// Each I2S stereo sample is encoded as {hi_L:mid_L}, {lo_L:0x00}, {hi_R:mid_R}, {lo_R:0x00}
+// outgoing data : separate left-aligned q31 buffers per channel, passed on to the input handler
 
 static uint8_t USBD_AUDIO_DataOut(USBD_HandleTypeDef* pdev,  uint8_t epnum) {
 	USBD_AUDIO_HandleTypeDef* haudio;
 	haudio = (USBD_AUDIO_HandleTypeDef*)pdev->pClassDataCmsit[pdev->classId];
 
 	if (all_ready == 1U && epnum == AUDIO_OUT_EP) {
+#ifdef USBD_AUDIO_DEBUG_TIMING
+		uint32_t start_cycle = DWT->CYCCNT;
+#endif
+		uint8_t is_32b = (haudio->bit_depth == 32U);
 		uint32_t curr_length = USBD_GetRxCount(pdev, epnum);
 		// Ignore strangely large packets
-		if (curr_length > AUDIO_OUT_PACKET_24B) {
+		if (curr_length > (is_32b ? AUDIO_OUT_PACKET_32B : AUDIO_OUT_PACKET_24B)) {
 			curr_length = 0U;
     }
 
-		uint32_t tmpbuf_ptr = 0U;
-		uint32_t num_samples = curr_length / 6; // 3bytes per sample
-
-		for (int i = 0; i < num_samples; i++) {
-			UN32 sample;
-			sample.b[0] = tmpbuf[tmpbuf_ptr]; // lsb
-			sample.b[1] = tmpbuf[tmpbuf_ptr+1];
-			sample.b[2] = tmpbuf[tmpbuf_ptr+2]; // msb
-			sample.b[3] = sample.b[2] & 0x80 ? 0xFF : 0x00; // sign extend to 32bits
-
-			sample.s = USBD_AUDIO_Volume_Ctrl(sample.s,haudio->vol_3dB_shift);
-
-			sample_bufs[0][i] = (q31_t)(sample.s << 8);
+		uint32_t num_samples = curr_length / (is_32b ? 8U : 6U); // 3 or 4 bytes per sample
 
-			/*haudio->buffer[haudio->wr_ptr++] = ((uint16_t)sample.b[0]) << 8;
-			haudio->buffer[haudio->wr_ptr++] = (((uint16_t)sample.b[2]) << 8) | (uint16_t)sample.b[1];*/
-			//haudio->buffer[haudio->wr_ptr++] = ((uint16_t)sample.b[0]) << 8;
+		// Split volume into whole 6dB steps (deferred to the input shift) and a remaining odd 3dB step
+		int8_t vol_shift = (int8_t)(haudio->vol_3dB_shift >> 1);
+		uint32_t scale_mask = (haudio->vol_3dB_shift & 1) ? 0xFFFFFFFFU : 0U;
 
-			sample.b[0] = tmpbuf[tmpbuf_ptr+3]; // lsb
-			sample.b[1] = tmpbuf[tmpbuf_ptr+4];
-			sample.b[2] = tmpbuf[tmpbuf_ptr+5]; // msb
-			sample.b[3] = sample.b[2] & 0x80 ? 0xFF : 0x00; // sign extend to 32bits
+		if (haudio->mute != 0U) {
+			// Muted: keep the input alive, but with silent data
+			memset(sample_bufs, 0, sizeof(sample_bufs));
+		} else if (is_32b) {
+			USBD_AUDIO_Unpack32((const uint32_t*)tmpbuf, sample_bufs[0], sample_bufs[1], num_samples, scale_mask);
+		} else {
+			USBD_AUDIO_Unpack24((const uint32_t*)tmpbuf, sample_bufs[0], sample_bufs[1], num_samples, scale_mask);
+		}
 
-			sample.s = USBD_AUDIO_Volume_Ctrl(sample.s,haudio->vol_3dB_shift);
+    USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_MAX);
 
-			sample_bufs[1][i] = (q31_t)(sample.s << 8);
-
-			/*haudio->buffer[haudio->wr_ptr++] = ((uint16_t)sample.b[0]) << 8;
-			haudio->buffer[haudio->wr_ptr++] = (((uint16_t)sample.b[2]) << 8) | (uint16_t)sample.b[1];*/
-			//haudio->buffer[haudio->wr_ptr++] = ((uint16_t)sample.b[0]) << 8;
-
-			tmpbuf_ptr += 6;
-
-			// Rollover at end of buffer
-			/*if (haudio->wr_ptr >= AUDIO_TOTAL_BUF_SIZE) {
-				haudio->wr_ptr = 0U;
-      }*/
-    }
-
-		// Start playing when half of the audio buffer is filled
-		// so if you increase the buffer length too much, the audio latency will be obvious when watching video+audio
-		/*if (haudio->offset == AUDIO_OFFSET_UNKNOWN && is_playing == 0U) {
-			if (haudio->wr_ptr >= AUDIO_TOTAL_BUF_SIZE / 2U) {
-				haudio->offset = AUDIO_OFFSET_NONE;
-				is_playing = 1U;
-
-				if (haudio->rd_enable == 0U) {
-					haudio->rd_enable = 1U;
-					// Set last writable buffer size to actual value. Note that rd_ptr is 0 now.
-					audio_buf_writable_samples_last = (AUDIO_TOTAL_BUF_SIZE - haudio->wr_ptr)/6;
-					}
-
-				((USBD_AUDIO_ItfTypeDef*)pdev->pUserData[pdev->classId])->AudioCmd((uint8_t*)&haudio->buffer[0], AUDIO_TOTAL_BUF_SIZE * 2, AUDIO_CMD_START);
-      }
-    }*/
-
-    USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_24B);
+#ifdef USBD_AUDIO_DEBUG_TIMING
+		DbgUnpackCycles = DWT->CYCCNT - start_cycle;
+		DbgUnpackSamples = num_samples;
+#endif
 
-    INPUT_ProcessSamples(INPUT_USB, sample_bufs[0], 1, 2, num_samples, SAMPLEBUF_CH_SAMPLE_COUNT, 0);
+		if (num_samples > 0U) {
+			INPUT_ProcessSamples(INPUT_USB, sample_bufs[0], 1, 2, num_samples, SAMPLEBUF_CH_SAMPLE_COUNT, vol_shift);
+		}
   }
 
 	return USBD_OK;
@@ -1030,10 +1179,9 @@ static void AUDIO_OUT_StopAndReset(USBD_HandleTypeDef* pdev) {
   all_ready = 0U;
   tx_flag = 1U;
   is_playing = 0U;
-  audio_buf_writable_samples_last = AUDIO_TOTAL_BUF_SIZE /(2*6);
+  fb_locked = 0U;
+  SRC_SetFixedRatioAllowed(false);
 #ifdef DEBUG_FEEDBACK_ENDPOINT
-  DbgMinWritableSamples = 99999;
-  DbgMaxWritableSamples = 0;
   DbgIndex = 0;
   DbgSofCounter = 0;
 #endif
@@ -1042,7 +1190,7 @@ static void AUDIO_OUT_StopAndReset(USBD_HandleTypeDef* pdev) {
   haudio->rd_ptr = 0U;
   haudio->wr_ptr = 0U;
 
-  //USBD_LL_FlushEP(pdev, AUDIO_IN_EP);
+  USBD_LL_FlushEP(pdev, AUDIO_IN_EP);
   USBD_LL_FlushEP(pdev, AUDIO_OUT_EP);
 
   ((USBD_AUDIO_ItfTypeDef*)pdev->pUserData[pdev->classId])->DeInit(0);
@@ -1059,22 +1207,12 @@ static void AUDIO_OUT_Restart(USBD_HandleTypeDef* pdev) {
 
   AUDIO_OUT_StopAndReset(pdev);
 
-  switch (haudio->freq) {
-    case 44100:
-      fb_nom = fb_value = AUDIO_FB_DEFAULT_44K;
-      break;
-    case 48000:
-      fb_nom = fb_value = AUDIO_FB_DEFAULT_48K;
-      break;
-    case 96000:
-    default :
-      fb_nom = fb_value = AUDIO_FB_DEFAULT_96K;
-      break;
-  }
+  // Nominal feedback: exact sample rate in 10.22 format - actual feedback is measured against the output clock
+  fb_nom = fb_value = (uint32_t)(((uint64_t)haudio->freq << 22) / 1000U);
 
   ((USBD_AUDIO_ItfTypeDef*)pdev->pUserData[pdev->classId])->Init(haudio->freq, haudio->volume, haudio->mute);
 
-  USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_24B);
+  USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP, tmpbuf, AUDIO_OUT_PACKET_MAX);
 
   tx_flag = 0U;
   all_ready = 1U;
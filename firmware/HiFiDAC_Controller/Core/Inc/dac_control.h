@@ -26,6 +26,9 @@
 
 //period between manual register reads in main loop cycles
 #define DAC_MANUAL_UPDATE_PERIOD 50
+//period between background verification steps of the shadow registers in main loop cycles, and number of registers checked per step
+#define DAC_VERIFY_PERIOD 20
+#define DAC_VERIFY_CHUNK_SIZE 16
 
 //calibrated volume offsets (reduction) in 0.5dB steps - prototype tests showed -1.5dB as an okay level with ~9.2Vpp
 #define DAC_VOL_CAL_CH1 3
@@ -10,6 +10,19 @@
 
 #include "main.h"
 
+//number of read/write registers (0x00 to 0x8E), all of which are mirrored in the shadow register map
+#define DAC_SPI_RW_REGISTER_COUNT 0x8F
+//size of the buffer for shadow flush transactions (command and address headers plus data), in bytes
+#define DAC_SPI_FLUSH_BUFFER_SIZE 96
+//maximum number of burst write transactions per shadow flush
+#define DAC_SPI_FLUSH_MAX_TRANSACTIONS 16
+//maximum number of unchanged registers between dirty ones that are rewritten as part of a burst, instead of starting a new transaction
+#define DAC_SPI_FLUSH_MAX_GAP 2
+//maximum number of registers in a single burst read
+#define DAC_SPI_READ_BURST_MAX 16
+//timeout for waiting on an ongoing shadow flush, in ms
+#define DAC_SPI_FLUSH_TIMEOUT 50
+
 
 typedef enum {
   REG_SYSTEM_CONFIG = 0x00,
@@ -107,4 +120,35 @@ HAL_StatusTypeDef DAC_SPI_Read8(DAC_SPI_Register reg, uint8_t* data);
 HAL_StatusTypeDef DAC_SPI_Read16(DAC_SPI_Register reg, uint16_t* data);
 HAL_StatusTypeDef DAC_SPI_Read24(DAC_SPI_Register reg, uint32_t* data);
 
+/**
+ * Read consecutive DAC registers in a single burst transaction (auto-incrementing address)
+ */
+HAL_StatusTypeDef DAC_SPI_ReadBurst(DAC_SPI_Register reg, uint8_t* data, uint8_t length);
+
+
+/**
+ * Shadow register map: shadow writes only update the local copy and mark changed registers as dirty (safe to call from interrupts).
+ * Dirty registers are transferred by DAC_SPI_Flush, as burst writes of contiguous ranges via DMA, without read-back.
+ * Registers written through the shadow are verified against the DAC by DAC_SPI_VerifyShadow.
+ */
+//invalidate all shadow values (e.g. after a DAC reset) - the next shadow write to each register is always transferred
+void DAC_SPI_ShadowReset();
+
+HAL_StatusTypeDef DAC_SPI_ShadowWrite8(DAC_SPI_Register reg, uint8_t data);
+HAL_StatusTypeDef DAC_SPI_ShadowWrite16(DAC_SPI_Register reg, uint16_t data);
+
+uint8_t DAC_SPI_ShadowRead8(DAC_SPI_Register reg);
+uint16_t DAC_SPI_ShadowRead16(DAC_SPI_Register reg);
+
+//start transferring all dirty shadow registers in the background - call from main loop context only
+HAL_StatusTypeDef DAC_SPI_Flush();
+//transfer all dirty shadow registers and wait for completion - call from main loop context only
+HAL_StatusTypeDef DAC_SPI_FlushBlocking();
+//whether there are no dirty shadow registers and no flush transfers ongoing
+bool DAC_SPI_IsFlushComplete();
+
+//read back the shadowed registers within the given range and compare them to the shadow values - mismatching registers are marked dirty to be rewritten
+//mismatches: optional output for the number of mismatching registers
+HAL_StatusTypeDef DAC_SPI_VerifyShadow(DAC_SPI_Register start, uint8_t count, uint8_t* mismatches);
+
 #endif /* INC_DAC_SPI_H_ */
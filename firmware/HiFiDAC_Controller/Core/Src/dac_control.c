@@ -116,40 +116,6 @@ static void PrintAllRegisters() {
 #endif
 
 
-//write value to given register and read back true value - 8 bit or 16 bit
-static HAL_StatusTypeDef _DAC_WriteAndCheckRegister(DAC_SPI_Register reg, bool _16bit, uint16_t value, uint16_t* read_value) {
-  //perform write
-  if (_16bit) {
-    ReturnOnError(DAC_SPI_Write16(reg, value));
-  } else {
-    ReturnOnError(DAC_SPI_Write8(reg, (uint8_t)value));
-  }
-
-  //read back
-  if (_16bit) {
-    ReturnOnError(DAC_SPI_Read16(reg, read_value));
-  } else {
-    *read_value = 0;
-    ReturnOnError(DAC_SPI_Read8(reg, (uint8_t*)read_value));
-  }
-
-  //check for correct readback
-  if (*read_value != value) {
-    if (_16bit) {
-      //incorrect readback in 16 bit mode: error
-      return HAL_ERROR;
-    } else {
-      //incorrect readback in 8 bit mode: check for correctness of relevant byte
-      if (*(uint8_t*)read_value != (uint8_t)value) {
-        return HAL_ERROR;
-      }
-    }
-  }
-
-  return HAL_OK;
-}
-
-
 //Check that the DAC chip ID is correct, confirming that the chip functions and can communicate
 HAL_StatusTypeDef DAC_CheckChipID() {
   uint8_t chip_id = 0;
@@ -164,314 +130,243 @@ HAL_StatusTypeDef DAC_CheckChipID() {
 }
 
 HAL_StatusTypeDef DAC_WriteSysConfig(bool enable) {
-  uint16_t readback;
-  uint16_t value = enable ? 0x02 : 0x00;
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_SYSTEM_CONFIG, enable ? 0x02 : 0x00));
 
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_SYSTEM_CONFIG, false, value, &readback);
+  dac_status.enabled = enable;
 
-  dac_status.enabled = ((readback & 0x02) != 0);
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteSysModeConfig(bool sync) {
-  uint16_t readback;
-  uint16_t value = DAC_SYS_MODE_CFG_BASE_VALUE | (sync ? 0x40 : 0x00);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_SYS_MODE_CONFIG, DAC_SYS_MODE_CFG_BASE_VALUE | (sync ? 0x40 : 0x00)));
 
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_SYS_MODE_CONFIG, false, value, &readback);
+  dac_status.sync = sync;
 
-  dac_status.sync = ((readback & 0x40) != 0);
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteDACClockConfig(uint8_t config) {
-  uint16_t readback;
-  uint16_t value = (uint16_t)config;
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_DAC_CLOCK_CONFIG, false, value, &readback);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_CLOCK_CONFIG, config));
 
-  dac_status.clk_config = (uint8_t)readback;
+  dac_status.clk_config = config;
 
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteMasterClockConfig(uint8_t div) {
-  uint16_t readback;
-  uint16_t value = (uint16_t)div;
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_CLOCK_CONFIG, false, value, &readback);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_CLOCK_CONFIG, div));
 
-  dac_status.master_div = (uint8_t)readback;
+  dac_status.master_div = div;
 
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_Write4XGains(bool ch1gain, bool ch2gain) {
-  uint16_t readback;
-  uint16_t value = (ch1gain ? 0x01 : 0x00) | (ch2gain ? 0x02 : 0x00);
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_PCM_4X_GAIN, false, value, &readback);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_PCM_4X_GAIN, (ch1gain ? 0x01 : 0x00) | (ch2gain ? 0x02 : 0x00)));
 
-  dac_status.en4xgain_ch1 = ((readback & 0x01) != 0);
-  dac_status.en4xgain_ch2 = ((readback & 0x02) != 0);
+  dac_status.en4xgain_ch1 = ch1gain;
+  dac_status.en4xgain_ch2 = ch2gain;
 
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteInputSelection(bool master) {
-  uint16_t readback;
-  uint16_t value = master ? 0x10 : 0x00;
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_INPUT_SELECTION, master ? 0x10 : 0x00));
 
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_INPUT_SELECTION, false, value, &readback);
+  dac_status.master = master;
 
-  dac_status.master = ((readback & 0x10) != 0);
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteTDMSlotNum(uint8_t num) {
-  uint16_t readback;
-  uint16_t value = num & 0x1F;
+  uint8_t value = num & 0x1F;
 
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_TDM_CONFIG, false, value, &readback);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_TDM_CONFIG, value));
 
-  dac_status.tdm_slot_num = (uint8_t)readback;
+  dac_status.tdm_slot_num = value;
 
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteChannelTDMSlots(uint8_t ch1slot, uint8_t ch2slot) {
-  uint16_t readback;
-  uint16_t value = ch1slot & 0x1F;
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_CH1_SLOT_CONFIG, false, value, &readback);
-
-  dac_status.tdm_slot_ch1 = (uint8_t)readback;
-
-  if (result != HAL_OK) {
-    return result;
-  }
+  uint8_t value1 = ch1slot & 0x1F;
+  uint8_t value2 = ch2slot & 0x1F;
 
-  value = ch2slot & 0x1F;
+  //adjacent registers: transferred as one burst
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_CH1_SLOT_CONFIG, value1));
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_CH2_SLOT_CONFIG, value2));
 
-  result = _DAC_WriteAndCheckRegister(REG_CH2_SLOT_CONFIG, false, value, &readback);
+  dac_status.tdm_slot_ch1 = value1;
+  dac_status.tdm_slot_ch2 = value2;
 
-  dac_status.tdm_slot_ch2 = (uint8_t)readback;
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteChannelVolumes(uint8_t ch1vol, uint8_t ch2vol) {
-  //set volume hold
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_IIR_BANDWIDTH_SPDIF_SEL, DAC_IIRBW_SPDIFSEL_BASE_VALUE | 0x08));
-
-  uint16_t readback1, readback2;
-  uint16_t value = ch1vol + DAC_VOL_CAL_CH1;
-  if (value > 0xFF) {
-    value = 0xFF;
-  }
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_VOLUME_CH1, false, value, &readback1);
-
-  if (result != HAL_OK) {
-    return result;
-  }
-
-  value = ch2vol + DAC_VOL_CAL_CH2;
-  if (value > 0xFF) {
-    value = 0xFF;
-  }
+  uint8_t value1 = (uint8_t)MIN((uint16_t)ch1vol + DAC_VOL_CAL_CH1, 0xFF);
+  uint8_t value2 = (uint8_t)MIN((uint16_t)ch2vol + DAC_VOL_CAL_CH2, 0xFF);
 
-  result = _DAC_WriteAndCheckRegister(REG_VOLUME_CH2, false, value, &readback2);
+  //adjacent registers, written together in one shadow snapshot: always transferred in the same burst, so no volume hold is needed to apply them together
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_VOLUME_CH1, value1));
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_VOLUME_CH2, value2));
 
-  if (result != HAL_OK) {
-    return result;
-  }
-
-  //remove volume hold
-  result = DAC_SPI_WriteConfirm8(REG_IIR_BANDWIDTH_SPDIF_SEL, DAC_IIRBW_SPDIFSEL_BASE_VALUE);
+  dac_status.volume_ch1 = value1 - DAC_VOL_CAL_CH1;
+  dac_status.volume_ch2 = value2 - DAC_VOL_CAL_CH2;
 
-  if (result == HAL_OK) {
-    //store new volumes if all succeeded
-    dac_status.volume_ch1 = (uint8_t)readback1 - DAC_VOL_CAL_CH1;
-    dac_status.volume_ch2 = (uint8_t)readback2 - DAC_VOL_CAL_CH2;
-  }
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteChannelMutes(bool ch1mute, bool ch2mute) {
-  uint16_t readback;
-  uint16_t value = (ch1mute ? 0x01 : 0x00) | (ch2mute ? 0x02 : 0x00);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_MUTE, (ch1mute ? 0x01 : 0x00) | (ch2mute ? 0x02 : 0x00)));
 
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_DAC_MUTE, false, value, &readback);
+  dac_status.manual_mute_ch1 = ch1mute;
+  dac_status.manual_mute_ch2 = ch2mute;
 
-  dac_status.manual_mute_ch1 = ((readback & 0x01) != 0);
-  dac_status.manual_mute_ch2 = ((readback & 0x02) != 0);
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteChannelInverts(bool ch1invert, bool ch2invert) {
-  uint16_t readback;
-  uint16_t value = (ch1invert ? 0x01 : 0x00) | (ch2invert ? 0x02 : 0x00);
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_DAC_INVERT, false, value, &readback);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_INVERT, (ch1invert ? 0x01 : 0x00) | (ch2invert ? 0x02 : 0x00)));
 
-  dac_status.invert_ch1 = ((readback & 0x01) != 0);
-  dac_status.invert_ch2 = ((readback & 0x02) != 0);
+  dac_status.invert_ch1 = ch1invert;
+  dac_status.invert_ch2 = ch2invert;
 
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteFilterShape(uint8_t shape) {
-  uint16_t readback;
-  uint16_t value = DAC_FILTER_SHAPE_BASE_VALUE | (shape & 0x07);
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_FILTER_SHAPE, false, value, &readback);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_FILTER_SHAPE, DAC_FILTER_SHAPE_BASE_VALUE | (shape & 0x07)));
 
-  dac_status.filter_shape = (uint8_t)readback & 0x07;
+  dac_status.filter_shape = shape & 0x07;
 
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteTHDC2(int16_t ch1c2, int16_t ch2c2) {
-  uint16_t readback;
-  uint16_t value = (uint16_t)ch1c2;
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_THD_C2_CH1, true, value, &readback);
-
-  dac_status.thd_c2_ch1 = (int16_t)readback;
-
-  if (result != HAL_OK) {
-    return result;
-  }
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C2_CH1, (uint16_t)ch1c2));
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C2_CH2, (uint16_t)ch2c2));
 
-  value = (uint16_t)ch2c2;
+  dac_status.thd_c2_ch1 = ch1c2;
+  dac_status.thd_c2_ch2 = ch2c2;
 
-  result = _DAC_WriteAndCheckRegister(REG_THD_C2_CH2, true, value, &readback);
-
-  dac_status.thd_c2_ch2 = (int16_t)readback;
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteTHDC3(int16_t ch1c3, int16_t ch2c3) {
-  uint16_t readback;
-  uint16_t value = (uint16_t)ch1c3;
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C3_CH1, (uint16_t)ch1c3));
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C3_CH2, (uint16_t)ch2c3));
 
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_THD_C3_CH1, true, value, &readback);
+  dac_status.thd_c3_ch1 = ch1c3;
+  dac_status.thd_c3_ch2 = ch2c3;
 
-  dac_status.thd_c3_ch1 = (int16_t)readback;
-
-  if (result != HAL_OK) {
-    return result;
-  }
-
-  value = (uint16_t)ch2c3;
-
-  result = _DAC_WriteAndCheckRegister(REG_THD_C3_CH2, true, value, &readback);
-
-  dac_status.thd_c3_ch2 = (int16_t)readback;
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteChannelAutomuteEnables(bool ch1automute, bool ch2automute) {
-  uint16_t readback;
-  uint16_t value = DAC_AUTOMUTE_EN_BASE_VALUE | (ch1automute ? 0x01 : 0x00) | (ch2automute ? 0x02 : 0x00);
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_AUTOMUTE_ENABLE, DAC_AUTOMUTE_EN_BASE_VALUE | (ch1automute ? 0x01 : 0x00) | (ch2automute ? 0x02 : 0x00)));
 
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_AUTOMUTE_ENABLE, false, value, &readback);
+  dac_status.automute_enabled_ch1 = ch1automute;
+  dac_status.automute_enabled_ch2 = ch2automute;
 
-  dac_status.automute_enabled_ch1 = ((readback & 0x01) != 0);
-  dac_status.automute_enabled_ch2 = ((readback & 0x02) != 0);
-
-  return result;
+  return HAL_OK;
 }
 
 HAL_StatusTypeDef DAC_WriteAutomuteTimeAndRamp(bool mute_gnd_ramp) {
-  uint16_t readback;
-  uint16_t value = DAC_AUTOMUTE_TIME_BASE_VALUE | (mute_gnd_ramp ? 0x0800 : 0x0000);
-
-  HAL_StatusTypeDef result = _DAC_WriteAndCheckRegister(REG_AUTOMUTE_TIME, true, value, &readback);
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_AUTOMUTE_TIME, DAC_AUTOMUTE_TIME_BASE_VALUE | (mute_gnd_ramp ? 0x0800 : 0x0000)));
 
-  dac_status.mute_gnd_ramp = ((readback & 0x0800) != 0);
+  dac_status.mute_gnd_ramp = mute_gnd_ramp;
 
-  return result;
+  return HAL_OK;
 }
 
 
 HAL_StatusTypeDef DAC_Init() {
 
+  uint8_t mismatches = 0;
+
   ReturnOnError(DAC_SPI_Write8(REG_SYSTEM_CONFIG, 0x80)); //perform soft reset
 
   HAL_Delay(10);
 
+  DAC_SPI_ShadowReset(); //register values unknown after reset
+
   ReturnOnError(DAC_SPI_Write8(REG_SYS_MODE_CONFIG, DAC_SYS_MODE_CFG_BASE_VALUE)); //reset sys mode config to the default base value
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DAC_CLOCK_CONFIG, 0x80)); //keep auto FS detection on, init CLK_IDAC = SYS_CLK
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_CLOCK_CONFIG, 0x07)); //set master BCK divider to default value
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_CLK_GEAR_SELECT, 0x00)); //keep clock gear as SYS_CLK = MCLK - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_CLOCK_CONFIG, 0x80)); //keep auto FS detection on, init CLK_IDAC = SYS_CLK
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_CLOCK_CONFIG, 0x07)); //set master BCK divider to default value
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_CLK_GEAR_SELECT, 0x00)); //keep clock gear as SYS_CLK = MCLK - should be the default already
 
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_INTERRUPT_MASKP, 0x00BC)); //enable interrupts for monitor fail, ramps, and automute changes - each in both polarities
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_INTERRUPT_MASKN, 0x00BC));
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_INTERRUPT_MASKP, 0x00BC)); //enable interrupts for monitor fail, ramps, and automute changes - each in both polarities
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_INTERRUPT_MASKN, 0x00BC));
 
   ReturnOnError(DAC_SPI_Write8(REG_DPLL_BW, 0x40)); //default DPLL bandwidth
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DATA_PATH_CONFIG, 0x40)); //mono mode off, keep calibration resistor on - no reason not to - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_PCM_4X_GAIN, 0x00)); //no 4x gains - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DATA_PATH_CONFIG, 0x40)); //mono mode off, keep calibration resistor on - no reason not to - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_PCM_4X_GAIN, 0x00)); //no 4x gains - should be the default already
+
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_GPIO12_CONFIG, 0x7D)); //configure GPIO1 as automute status and GPIO2 as lock status - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_GPIO34_CONFIG, 0x4E)); //configure GPIO3 as soft ramp status and GPIO4 as interrupt
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_GPIO_OUTPUT_ENABLE, 0x0F)); //configure GPIO1-4 as outputs
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_GPIO_INPUT, 0x00)); //no GPIO inputs - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_INVERT_GPIO, 0x00)); //no GPIOs inverted - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_GPIO_OUTPUT_LOGIC, 0x0007)); //GPIO output logic ANDed - should be the default already
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_GPIO12_CONFIG, 0x7D)); //configure GPIO1 as automute status and GPIO2 as lock status - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_GPIO34_CONFIG, 0x4E)); //configure GPIO3 as soft ramp status and GPIO4 as interrupt
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_GPIO_OUTPUT_ENABLE, 0x0F)); //configure GPIO1-4 as outputs
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_GPIO_INPUT, 0x00)); //no GPIO inputs - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_INVERT_GPIO, 0x00)); //no GPIOs inverted - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_GPIO_OUTPUT_LOGIC, 0x0007)); //GPIO output logic ANDed - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_INPUT_SELECTION, 0x00)); //fixed PCM input in slave mode
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_MASTER_ENCODER_CONFIG, 0x00)); //master encoder in default config but without any inverts
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_INPUT_SELECTION, 0x00)); //fixed PCM input in slave mode
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_MASTER_ENCODER_CONFIG, 0x00)); //master encoder in default config but without any inverts
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_TDM_CONFIG, 0x01)); //init to 2 channels - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_TDM_CONFIG1, 0x00)); //reset TDM config to the defaults
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_TDM_CONFIG2, 0x80));
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_TDM_CONFIG, 0x01)); //init to 2 channels - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_TDM_CONFIG1, 0x00)); //reset TDM config to the defaults
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_TDM_CONFIG2, 0x80));
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_BCKWS_MONITOR_CONFIG, 0x30)); //enable BCK/WS monitor and all related features - should be the default already
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_BCKWS_MONITOR_CONFIG, 0x30)); //enable BCK/WS monitor and all related features - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_CH1_SLOT_CONFIG, 0x00)); //channel 1 on slot 0 - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_CH2_SLOT_CONFIG, 0x01)); //channel 2 on slot 1
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_CH1_SLOT_CONFIG, 0x00)); //channel 1 on slot 0 - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_CH2_SLOT_CONFIG, 0x01)); //channel 2 on slot 1
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_VOLUME_CH1, DAC_VOL_INIT_CH1 + DAC_VOL_CAL_CH1)); //write initial volume to configured value with calibration offset
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_VOLUME_CH2, DAC_VOL_INIT_CH2 + DAC_VOL_CAL_CH2));
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_VOLUME_CH1, DAC_VOL_INIT_CH1 + DAC_VOL_CAL_CH1)); //write initial volume to configured value with calibration offset
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_VOLUME_CH2, DAC_VOL_INIT_CH2 + DAC_VOL_CAL_CH2));
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_VOL_UP_RATE, 0x04)); //default volume increase and decrease rates
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_VOL_DOWN_RATE, 0x04));
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_VOL_DOWN_RATE_FAST, 0xFF));
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DAC_VOL_UP_RATE, 0x04)); //default volume increase and decrease rates
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DAC_VOL_DOWN_RATE, 0x04));
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DAC_VOL_DOWN_RATE_FAST, 0xFF));
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_MUTE, 0x00)); //no muted channels - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_INVERT, 0x00)); //no inverted channels - should be the default already
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DAC_MUTE, 0x00)); //no muted channels - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DAC_INVERT, 0x00)); //no inverted channels - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_FILTER_SHAPE, DAC_FILTER_SHAPE_BASE_VALUE)); //default filter shape
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_IIR_BANDWIDTH_SPDIF_SEL, DAC_IIRBW_SPDIFSEL_BASE_VALUE)); //default IIR bandwidth, SPDIF selection, and no volume hold
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_DAC_PATH_CONFIG, 0x00)); //no filter bypass - should be the default already
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_FILTER_SHAPE, DAC_FILTER_SHAPE_BASE_VALUE)); //default filter shape
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_IIR_BANDWIDTH_SPDIF_SEL, DAC_IIRBW_SPDIFSEL_BASE_VALUE)); //default IIR bandwidth, SPDIF selection, and no volume hold
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_DAC_PATH_CONFIG, 0x00)); //no filter bypass - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C2_CH1, 0x0000)); //reset THD correction coefficients to default (none)
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C2_CH2, 0x0000));
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C3_CH1, 0x0000));
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_THD_C3_CH2, 0x0000));
 
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_THD_C2_CH1, 0x0000)); //reset THD correction coefficients to default (none)
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_THD_C2_CH2, 0x0000));
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_THD_C3_CH1, 0x0000));
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_THD_C3_CH2, 0x0000));
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_AUTOMUTE_ENABLE, DAC_AUTOMUTE_EN_BASE_VALUE | 0x03)); //enable both automutes - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_AUTOMUTE_TIME, DAC_AUTOMUTE_TIME_BASE_VALUE | 0x0800)); //enable mute ramp to ground with default time - should be the default already
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_AUTOMUTE_LEVEL, 0x0008)); //default automute on and off levels
+  ReturnOnError(DAC_SPI_ShadowWrite16(REG_AUTOMUTE_OFF_LEVEL, 0x000A)); //default automute on and off levels
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_AUTOMUTE_ENABLE, DAC_AUTOMUTE_EN_BASE_VALUE | 0x03)); //enable both automutes - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_AUTOMUTE_TIME, DAC_AUTOMUTE_TIME_BASE_VALUE | 0x0800)); //enable mute ramp to ground with default time - should be the default already
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_AUTOMUTE_LEVEL, 0x0008)); //default automute on and off levels
-  ReturnOnError(DAC_SPI_WriteConfirm16(REG_AUTOMUTE_OFF_LEVEL, 0x000A)); //default automute on and off levels
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_SOFT_RAMP_CONFIG, 0x03)); //default soft ramp time
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_SOFT_RAMP_CONFIG, 0x03)); //default soft ramp time
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_PROGRAM_RAM_CONTROL, 0x00)); //no program RAM functions - should be the default already
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_PROGRAM_RAM_CONTROL, 0x00)); //no program RAM functions - should be the default already
+  //transfer configuration in bursts, then confirm it using one read-back pass
+  ReturnOnError(DAC_SPI_FlushBlocking());
+  ReturnOnError(DAC_SPI_VerifyShadow(REG_SYSTEM_CONFIG, DAC_SPI_RW_REGISTER_COUNT, &mismatches));
+  if (mismatches > 0) {
+    DEBUG_PRINTF("* DAC init read-back mismatch in %u registers\n", mismatches);
+    return HAL_ERROR;
+  }
 
   HAL_Delay(10);
 
-  ReturnOnError(DAC_SPI_WriteConfirm8(REG_SYSTEM_CONFIG, 0x02)); //enable DAC analog section
+  ReturnOnError(DAC_SPI_ShadowWrite8(REG_SYSTEM_CONFIG, 0x02)); //enable DAC analog section
+  ReturnOnError(DAC_SPI_FlushBlocking());
+  ReturnOnError(DAC_SPI_VerifyShadow(REG_SYSTEM_CONFIG, 1, &mismatches));
+  if (mismatches > 0) {
+    return HAL_ERROR;
+  }
 
   dac_status.enabled = true;
   dac_status.sync = false;
@@ -519,6 +414,7 @@ HAL_StatusTypeDef DAC_Init() {
 
 void DAC_LoopUpdate() {
   static uint32_t loop_count = 0;
+  static uint8_t verify_address = 0;
 
   if (HAL_GPIO_ReadPin(GPIO4_GPIO_Port, GPIO4_Pin) == GPIO_PIN_SET) {
     //interrupt detected
@@ -588,4 +484,19 @@ void DAC_LoopUpdate() {
     //reset interrupt flags
     _dac_interrupts_triggered = 0;
   }
+
+  if (loop_count % DAC_VERIFY_PERIOD == 0 && DAC_SPI_IsFlushComplete()) {
+    //background verification of the next chunk of shadowed registers - mismatches are rewritten by the flush below
+    uint8_t mismatches = 0;
+    if (DAC_SPI_VerifyShadow((DAC_SPI_Register)verify_address, DAC_VERIFY_CHUNK_SIZE, &mismatches) == HAL_OK && mismatches > 0) {
+      DEBUG_PRINTF("* DAC register mismatch (%u) in range 0x%02X-0x%02X, rewriting\n", mismatches, verify_address, verify_address + DAC_VERIFY_CHUNK_SIZE - 1);
+    }
+    verify_address += DAC_VERIFY_CHUNK_SIZE;
+    if (verify_address >= DAC_SPI_RW_REGISTER_COUNT) {
+      verify_address = 0;
+    }
+  }
+
+  //transfer changed registers in the background
+  DAC_SPI_Flush();
 }
@@ -12,6 +12,74 @@
 #define DAC_SPI_IS_READWRITE(x) (x >= 0 && x <= 0x8E)
 #define DAC_SPI_IS_READONLY(x) (x >= 0xE0 && x <= 0xFB)
 
+#define DAC_SPI_BITMAP_WORDS ((DAC_SPI_RW_REGISTER_COUNT + 31) / 32)
+#define DAC_SPI_BITMAP_GET(map, x) ((map[(x) >> 5] & (1UL << ((x) & 0x1F))) != 0)
+#define DAC_SPI_BITMAP_SET(map, x) do { map[(x) >> 5] |= (1UL << ((x) & 0x1F)); } while (0)
+#define DAC_SPI_BITMAP_CLEAR(map, x) do { map[(x) >> 5] &= ~(1UL << ((x) & 0x1F)); } while (0)
+
+
+//shadow copy of the read/write registers
+static uint8_t _dac_spi_shadow[DAC_SPI_RW_REGISTER_COUNT] = { 0 };
+//registers whose shadow value is known to be written to the DAC (or queued for it)
+static uint32_t _dac_spi_shadow_valid[DAC_SPI_BITMAP_WORDS] = { 0 };
+//registers whose shadow value still needs to be transferred
+static uint32_t _dac_spi_shadow_dirty[DAC_SPI_BITMAP_WORDS] = { 0 };
+
+//flush transactions (write command, start address, data), and their start offsets in the buffer - transaction i ends at offset i + 1
+static uint8_t __attribute__((aligned(4))) _dac_spi_flush_buffer[DAC_SPI_FLUSH_BUFFER_SIZE] = { 0 };
+static uint8_t _dac_spi_flush_offsets[DAC_SPI_FLUSH_MAX_TRANSACTIONS + 1] = { 0 };
+static uint8_t _dac_spi_flush_count = 0;
+//index of the currently ongoing flush transaction
+static volatile uint8_t _dac_spi_flush_index = 0;
+//whether a flush is ongoing
+static volatile bool _dac_spi_flush_active = false;
+
+
+//wait for an ongoing flush to complete, aborting it on timeout
+static HAL_StatusTypeDef _DAC_SPI_WaitForFlush() {
+  uint32_t start_tick = HAL_GetTick();
+
+  while (_dac_spi_flush_active) {
+    if (HAL_GetTick() - start_tick > DAC_SPI_FLUSH_TIMEOUT) {
+      //timeout: abort transfer, remaining transactions get marked as dirty again by the abort callback
+      DEBUG_PRINTF("* DAC SPI flush timeout\n");
+      HAL_SPI_Abort_IT(&hspi1);
+      return HAL_TIMEOUT;
+    }
+  }
+
+  return HAL_OK;
+}
+
+//mark the registers of the given flush transaction and all following ones as dirty again (after a failed transfer)
+static void _DAC_SPI_RequeueFlushTransactions(uint8_t first) {
+  int i, j;
+
+  for (i = first; i < _dac_spi_flush_count; i++) {
+    uint8_t start = _dac_spi_flush_offsets[i];
+    uint8_t address = _dac_spi_flush_buffer[start + 1];
+    uint8_t length = _dac_spi_flush_offsets[i + 1] - start - 2;
+    for (j = 0; j < length; j++) {
+      DAC_SPI_BITMAP_SET(_dac_spi_shadow_dirty, address + j);
+    }
+  }
+}
+
+//start the current flush transaction
+static void _DAC_SPI_StartFlushTransaction() {
+  uint8_t index = _dac_spi_flush_index;
+  uint8_t start = _dac_spi_flush_offsets[index];
+
+  HAL_GPIO_WritePin(SPI1_NSS_GPIO_Port, SPI1_NSS_Pin, GPIO_PIN_RESET);
+  if (HAL_SPI_Transmit_DMA(&hspi1, _dac_spi_flush_buffer + start, _dac_spi_flush_offsets[index + 1] - start) != HAL_OK) {
+    //failed to start: requeue remaining transactions for the next flush
+    HAL_GPIO_WritePin(SPI1_NSS_GPIO_Port, SPI1_NSS_Pin, GPIO_PIN_SET);
+    _DAC_SPI_RequeueFlushTransactions(index);
+    _dac_spi_flush_active = false;
+  }
+}
+
+
 /**
  * Write data to DAC register
  */
@@ -22,6 +90,8 @@ HAL_StatusTypeDef DAC_SPI_Write8(DAC_SPI_Register reg, uint8_t data) {
 
   if (!DAC_SPI_IS_READWRITE(address)) return HAL_ERROR;
 
+  ReturnOnError(_DAC_SPI_WaitForFlush());
+
   spi_data[0] = 0x03; //write command
   spi_data[1] = address;
   spi_data[2] = data;
@@ -91,6 +161,8 @@ HAL_StatusTypeDef DAC_SPI_Read8(DAC_SPI_Register reg, uint8_t* data) {
 
   if (!(DAC_SPI_IS_READWRITE(address) || DAC_SPI_IS_READONLY(address))) return HAL_ERROR;
 
+  ReturnOnError(_DAC_SPI_WaitForFlush());
+
   spi_send_data[0] = 0x01; //read command
   spi_send_data[1] = address;
 
@@ -122,3 +194,245 @@ HAL_StatusTypeDef DAC_SPI_Read24(DAC_SPI_Register reg, uint32_t* data) {
   if (result == HAL_OK) *data = (uint32_t)read24data[0] | ((uint32_t)read24data[1] << 8) | ((uint32_t)read24data[2] << 16);
   return result;
 }
+
+/**
+ * Read consecutive DAC registers in a single burst transaction (auto-incrementing address)
+ */
+HAL_StatusTypeDef DAC_SPI_ReadBurst(DAC_SPI_Register reg, uint8_t* data, uint8_t length) {
+  uint8_t spi_send_data[DAC_SPI_READ_BURST_MAX + 2] = { 0 };
+  uint8_t spi_receive_data[DAC_SPI_READ_BURST_MAX + 2] = { 0 };
+
+  uint8_t address = (uint8_t)reg;
+  uint8_t last_address = address + length - 1;
+
+  if (data == NULL || length == 0 || length > DAC_SPI_READ_BURST_MAX) return HAL_ERROR;
+  if (!(DAC_SPI_IS_READWRITE(address) && DAC_SPI_IS_READWRITE(last_address)) && !(DAC_SPI_IS_READONLY(address) && DAC_SPI_IS_READONLY(last_address))) return HAL_ERROR;
+
+  ReturnOnError(_DAC_SPI_WaitForFlush());
+
+  spi_send_data[0] = 0x01; //read command
+  spi_send_data[1] = address;
+
+  HAL_GPIO_WritePin(SPI1_NSS_GPIO_Port, SPI1_NSS_Pin, GPIO_PIN_RESET);
+  HAL_StatusTypeDef result = HAL_SPI_TransmitReceive(&hspi1, spi_send_data, spi_receive_data, length + 2, 100);
+  HAL_GPIO_WritePin(SPI1_NSS_GPIO_Port, SPI1_NSS_Pin, GPIO_PIN_SET);
+
+  if (result == HAL_OK) memcpy(data, spi_receive_data + 2, length);
+  return result;
+}
+
+
+/**
+ * Shadow register map
+ */
+void DAC_SPI_ShadowReset() {
+  __disable_irq();
+  memset(_dac_spi_shadow_valid, 0, sizeof(_dac_spi_shadow_valid));
+  memset(_dac_spi_shadow_dirty, 0, sizeof(_dac_spi_shadow_dirty));
+  __enable_irq();
+}
+
+HAL_StatusTypeDef DAC_SPI_ShadowWrite8(DAC_SPI_Register reg, uint8_t data) {
+  uint8_t address = (uint8_t)reg;
+
+  if (!DAC_SPI_IS_READWRITE(address)) return HAL_ERROR;
+
+  __disable_irq();
+  //only mark dirty if the value changes, or if it's unknown
+  if (!DAC_SPI_BITMAP_GET(_dac_spi_shadow_valid, address) || _dac_spi_shadow[address] != data) {
+    _dac_spi_shadow[address] = data;
+    DAC_SPI_BITMAP_SET(_dac_spi_shadow_valid, address);
+    DAC_SPI_BITMAP_SET(_dac_spi_shadow_dirty, address);
+  }
+  __enable_irq();
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef DAC_SPI_ShadowWrite16(DAC_SPI_Register reg, uint16_t data) {
+  ReturnOnError(DAC_SPI_ShadowWrite8(reg, (uint8_t)(data & 0xFF)));
+  return DAC_SPI_ShadowWrite8(reg + 1, (uint8_t)((data >> 8) & 0xFF));
+}
+
+uint8_t DAC_SPI_ShadowRead8(DAC_SPI_Register reg) {
+  uint8_t address = (uint8_t)reg;
+
+  if (!DAC_SPI_IS_READWRITE(address)) return 0;
+
+  return _dac_spi_shadow[address];
+}
+
+uint16_t DAC_SPI_ShadowRead16(DAC_SPI_Register reg) {
+  return (uint16_t)DAC_SPI_ShadowRead8(reg) | ((uint16_t)DAC_SPI_ShadowRead8(reg + 1) << 8);
+}
+
+HAL_StatusTypeDef DAC_SPI_Flush() {
+  if (_dac_spi_flush_active) {
+    return HAL_BUSY;
+  }
+
+  uint8_t address = 0;
+  uint8_t buffer_pos = 0;
+  uint8_t count = 0;
+
+  //build transactions from the dirty registers - interrupts disabled to get a consistent snapshot (shadow writes happen from the I2C interrupt)
+  __disable_irq();
+  while (address < DAC_SPI_RW_REGISTER_COUNT && count < DAC_SPI_FLUSH_MAX_TRANSACTIONS) {
+    if (_dac_spi_shadow_dirty[address >> 5] == 0) {
+      //no dirty registers in the rest of this bitmap word: skip it
+      address = (address & ~0x1F) + 32;
+      continue;
+    }
+    if (!DAC_SPI_BITMAP_GET(_dac_spi_shadow_dirty, address)) {
+      address++;
+      continue;
+    }
+
+    //extend range over following dirty registers, including short gaps of known registers (rewritten with their unchanged shadow values)
+    uint8_t end = address + 1;
+    while (true) {
+      uint8_t next = end;
+      while (next < DAC_SPI_RW_REGISTER_COUNT && next - end < DAC_SPI_FLUSH_MAX_GAP && !DAC_SPI_BITMAP_GET(_dac_spi_shadow_dirty, next) && DAC_SPI_BITMAP_GET(_dac_spi_shadow_valid, next)) {
+        next++;
+      }
+      if (next < DAC_SPI_RW_REGISTER_COUNT && DAC_SPI_BITMAP_GET(_dac_spi_shadow_dirty, next)) {
+        end = next + 1;
+      } else {
+        break;
+      }
+    }
+
+    //limit range to the remaining buffer space (rest stays dirty for the next flush)
+    if (buffer_pos + 3 > DAC_SPI_FLUSH_BUFFER_SIZE) {
+      break;
+    }
+    if (buffer_pos + 2 + (end - address) > DAC_SPI_FLUSH_BUFFER_SIZE) {
+      end = address + DAC_SPI_FLUSH_BUFFER_SIZE - buffer_pos - 2;
+    }
+
+    //write transaction to buffer, clear dirty flags of transferred registers
+    _dac_spi_flush_offsets[count++] = buffer_pos;
+    _dac_spi_flush_buffer[buffer_pos++] = 0x03; //write command
+    _dac_spi_flush_buffer[buffer_pos++] = address;
+    for (; address < end; address++) {
+      _dac_spi_flush_buffer[buffer_pos++] = _dac_spi_shadow[address];
+      DAC_SPI_BITMAP_CLEAR(_dac_spi_shadow_dirty, address);
+    }
+  }
+  __enable_irq();
+
+  if (count == 0) {
+    //nothing to do
+    return HAL_OK;
+  }
+
+  //start first transaction, the rest are started from the transfer complete callback
+  _dac_spi_flush_offsets[count] = buffer_pos;
+  _dac_spi_flush_count = count;
+  _dac_spi_flush_index = 0;
+  _dac_spi_flush_active = true;
+  _DAC_SPI_StartFlushTransaction();
+
+  return _dac_spi_flush_active ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef DAC_SPI_FlushBlocking() {
+  //flush until no more dirty registers are left (multiple rounds if the buffer or transaction limit is reached)
+  do {
+    ReturnOnError(_DAC_SPI_WaitForFlush());
+    ReturnOnError(DAC_SPI_Flush());
+  } while (!DAC_SPI_IsFlushComplete());
+
+  return _DAC_SPI_WaitForFlush();
+}
+
+bool DAC_SPI_IsFlushComplete() {
+  int i;
+
+  if (_dac_spi_flush_active) {
+    return false;
+  }
+
+  for (i = 0; i < DAC_SPI_BITMAP_WORDS; i++) {
+    if (_dac_spi_shadow_dirty[i] != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+HAL_StatusTypeDef DAC_SPI_VerifyShadow(DAC_SPI_Register start, uint8_t count, uint8_t* mismatches) {
+  uint8_t read_data[DAC_SPI_READ_BURST_MAX];
+  uint8_t address = (uint8_t)start;
+  uint16_t end = (uint16_t)address + count;
+  uint8_t mismatch_count = 0;
+
+  if (end > DAC_SPI_RW_REGISTER_COUNT) {
+    end = DAC_SPI_RW_REGISTER_COUNT;
+  }
+
+  while (address < end) {
+    //only read contiguous ranges of shadowed registers, unknown registers may not be safe to read
+    if (!DAC_SPI_BITMAP_GET(_dac_spi_shadow_valid, address)) {
+      address++;
+      continue;
+    }
+    uint8_t length = 1;
+    while (address + length < end && length < DAC_SPI_READ_BURST_MAX && DAC_SPI_BITMAP_GET(_dac_spi_shadow_valid, address + length)) {
+      length++;
+    }
+
+    ReturnOnError(DAC_SPI_ReadBurst((DAC_SPI_Register)address, read_data, length));
+
+    //compare to shadow - skip dirty registers, their DAC value is expected to differ until the next flush
+    int i;
+    __disable_irq();
+    for (i = 0; i < length; i++) {
+      uint8_t reg = address + i;
+      if (!DAC_SPI_BITMAP_GET(_dac_spi_shadow_dirty, reg) && read_data[i] != _dac_spi_shadow[reg]) {
+        DAC_SPI_BITMAP_SET(_dac_spi_shadow_dirty, reg);
+        mismatch_count++;
+      }
+    }
+    __enable_irq();
+
+    address += length;
+  }
+
+  if (mismatches != NULL) {
+    *mismatches = mismatch_count;
+  }
+  return HAL_OK;
+}
+
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef* hspi) {
+  if (hspi != &hspi1 || !_dac_spi_flush_active) {
+    return;
+  }
+
+  HAL_GPIO_WritePin(SPI1_NSS_GPIO_Port, SPI1_NSS_Pin, GPIO_PIN_SET);
+
+  //start next transaction, if any
+  if (++_dac_spi_flush_index < _dac_spi_flush_count) {
+    _DAC_SPI_StartFlushTransaction();
+  } else {
+    _dac_spi_flush_active = false;
+  }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi) {
+  if (hspi != &hspi1 || !_dac_spi_flush_active) {
+    return;
+  }
+
+  //transfer failed: requeue current and remaining transactions for the next flush
+  HAL_GPIO_WritePin(SPI1_NSS_GPIO_Port, SPI1_NSS_Pin, GPIO_PIN_SET);
+  _DAC_SPI_RequeueFlushTransactions(_dac_spi_flush_index);
+  _dac_spi_flush_active = false;
+}
+
+void HAL_SPI_AbortCpltCallback(SPI_HandleTypeDef* hspi) {
+  HAL_SPI_ErrorCallback(hspi);
+}
@@ -11,543 +11,165 @@
 #include "dac_control.h"
 
 
-#define I2C_OWN_ADDRESS_WRITE ((uint8_t)I2C_GET_OWN_ADDRESS1(&I2C_INSTANCE))
-#define I2C_OWN_ADDRESS_READ (I2C_OWN_ADDRESS_WRITE | 0x01)
-
-
-typedef enum {
-  I2C_UNINIT,
-  I2C_IDLE,
-  I2C_WAITING_ADDR,
-  I2C_ADDR_RECEIVED,
-  I2C_WRITE,
-  I2C_READ
-} _I2C_State;
-
-
-//internal state of the I2C system
-static _I2C_State state = I2C_UNINIT;
-//virtual register address to be written/read
-static uint8_t reg_addr = 0;
-//size of selected virtual register (for reads/writes)
-static uint16_t reg_size = 0;
-//virtual data buffers (read and write)
-static uint8_t __attribute__((aligned(4))) read_buf[I2C_VIRT_BUFFER_SIZE + 1] = { 0 };
-static uint8_t __attribute__((aligned(4))) write_buf[I2C_VIRT_BUFFER_SIZE + 1] = { 0 };
-
-//whether a comm error has been detected since the last status read
-static uint8_t i2c_err_detected = 0;
-
-//timeout for non-idle states in main loop cycles
-static uint8_t non_idle_timeout = 0;
-//sightings of busy peripheral in idle state
-static uint8_t idle_busy_count = 0;
-
-//register size map
-static const uint16_t reg_size_map[] = I2CDEF_HIFIDAC_REG_SIZES;
-
-//configured state
-static uint8_t interrupts_enabled = 0;
-static uint8_t interrupt_mask = 0;
-static uint8_t interrupt_flags = I2CDEF_HIFIDAC_INT_FLAGS_INT_RESET_Msk;
-
-//I2C CRC data
-static const uint8_t _i2c_crc_table[256] = {
-  0x00, 0x7F, 0xFE, 0x81, 0x83, 0xFC, 0x7D, 0x02, 0x79, 0x06, 0x87, 0xF8, 0xFA, 0x85, 0x04, 0x7B,
-  0xF2, 0x8D, 0x0C, 0x73, 0x71, 0x0E, 0x8F, 0xF0, 0x8B, 0xF4, 0x75, 0x0A, 0x08, 0x77, 0xF6, 0x89,
-  0x9B, 0xE4, 0x65, 0x1A, 0x18, 0x67, 0xE6, 0x99, 0xE2, 0x9D, 0x1C, 0x63, 0x61, 0x1E, 0x9F, 0xE0,
-  0x69, 0x16, 0x97, 0xE8, 0xEA, 0x95, 0x14, 0x6B, 0x10, 0x6F, 0xEE, 0x91, 0x93, 0xEC, 0x6D, 0x12,
-  0x49, 0x36, 0xB7, 0xC8, 0xCA, 0xB5, 0x34, 0x4B, 0x30, 0x4F, 0xCE, 0xB1, 0xB3, 0xCC, 0x4D, 0x32,
-  0xBB, 0xC4, 0x45, 0x3A, 0x38, 0x47, 0xC6, 0xB9, 0xC2, 0xBD, 0x3C, 0x43, 0x41, 0x3E, 0xBF, 0xC0,
-  0xD2, 0xAD, 0x2C, 0x53, 0x51, 0x2E, 0xAF, 0xD0, 0xAB, 0xD4, 0x55, 0x2A, 0x28, 0x57, 0xD6, 0xA9,
-  0x20, 0x5F, 0xDE, 0xA1, 0xA3, 0xDC, 0x5D, 0x22, 0x59, 0x26, 0xA7, 0xD8, 0xDA, 0xA5, 0x24, 0x5B,
-  0x92, 0xED, 0x6C, 0x13, 0x11, 0x6E, 0xEF, 0x90, 0xEB, 0x94, 0x15, 0x6A, 0x68, 0x17, 0x96, 0xE9,
-  0x60, 0x1F, 0x9E, 0xE1, 0xE3, 0x9C, 0x1D, 0x62, 0x19, 0x66, 0xE7, 0x98, 0x9A, 0xE5, 0x64, 0x1B,
-  0x09, 0x76, 0xF7, 0x88, 0x8A, 0xF5, 0x74, 0x0B, 0x70, 0x0F, 0x8E, 0xF1, 0xF3, 0x8C, 0x0D, 0x72,
-  0xFB, 0x84, 0x05, 0x7A, 0x78, 0x07, 0x86, 0xF9, 0x82, 0xFD, 0x7C, 0x03, 0x01, 0x7E, 0xFF, 0x80,
-  0xDB, 0xA4, 0x25, 0x5A, 0x58, 0x27, 0xA6, 0xD9, 0xA2, 0xDD, 0x5C, 0x23, 0x21, 0x5E, 0xDF, 0xA0,
-  0x29, 0x56, 0xD7, 0xA8, 0xAA, 0xD5, 0x54, 0x2B, 0x50, 0x2F, 0xAE, 0xD1, 0xD3, 0xAC, 0x2D, 0x52,
-  0x40, 0x3F, 0xBE, 0xC1, 0xC3, 0xBC, 0x3D, 0x42, 0x39, 0x46, 0xC7, 0xB8, 0xBA, 0xC5, 0x44, 0x3B,
-  0xB2, 0xCD, 0x4C, 0x33, 0x31, 0x4E, 0xCF, 0xB0, 0xCB, 0xB4, 0x35, 0x4A, 0x48, 0x37, 0xB6, 0xC9
-};
-static uint8_t _i2c_crc_state = 0;
-
-
-void _I2C_UpdateInterruptPin() {
-  if (((interrupt_flags & I2CDEF_HIFIDAC_INT_FLAGS_INT_RESET_Msk) != 0) || (interrupts_enabled && (interrupt_flags & interrupt_mask) != 0)) {
-    HAL_GPIO_WritePin(I2C_INT_PORT, I2C_INT_PIN, GPIO_PIN_RESET);
-  } else {
-    HAL_GPIO_WritePin(I2C_INT_PORT, I2C_INT_PIN, GPIO_PIN_SET);
+//report failed DAC writes as comm errors
+static inline void _I2C_CheckDACWrite(HAL_StatusTypeDef result) {
+  if (result != HAL_OK) {
+    I2C_ReportError();
   }
 }
 
-/**
- * called at the end of a write transaction, processes the received data to update amp state
- */
-void _I2C_ProcessWriteData() {
-  uint8_t temp8;
-
-  //DEBUG_PRINTF("I2C write trigger: address 0x%02X; size %u; value 0x%08lX (%f)\n", reg_addr, reg_size, *(uint32_t*)write_buf, *(float*)write_buf);
-
-  switch (reg_addr) {
-    case I2CDEF_HIFIDAC_CONTROL:
-      temp8 = (write_buf[0] & I2CDEF_HIFIDAC_CONTROL_RESET_Msk) >> I2CDEF_HIFIDAC_CONTROL_RESET_Pos;
-
-      if (temp8 != 0) { //check reset code
-        if (temp8 == I2CDEF_HIFIDAC_CONTROL_RESET_VALUE) { //correct: perform reset
-          NVIC_SystemReset();
-        } else { //incorrect: report error
-          DEBUG_PRINTF("I2C write error: incorrect reset code\n");
-          i2c_err_detected = 1;
-        }
-      }
-
-      interrupts_enabled = (write_buf[0] & I2CDEF_HIFIDAC_CONTROL_INT_EN_Msk) != 0 ? 1 : 0; //interrupt state
-      _I2C_UpdateInterruptPin();
 
-      if (DAC_WriteSysModeConfig((write_buf[0] & I2CDEF_HIFIDAC_CONTROL_SYNC_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-
-      if (DAC_WriteInputSelection((write_buf[0] & I2CDEF_HIFIDAC_CONTROL_MASTER_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-
-      if (DAC_WriteSysConfig((write_buf[0] & I2CDEF_HIFIDAC_CONTROL_DAC_EN_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_INT_MASK:
-      interrupt_mask = write_buf[0];
-      _I2C_UpdateInterruptPin();
-      break;
-    case I2CDEF_HIFIDAC_INT_FLAGS:
-      interrupt_flags &= write_buf[0]; //clear bits received as 0
-      _I2C_UpdateInterruptPin();
-      break;
-    case I2CDEF_HIFIDAC_VOLUME:
-      if (DAC_WriteChannelVolumes(write_buf[0], write_buf[1]) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_MUTE:
-      if (DAC_WriteChannelMutes((write_buf[0] & I2CDEF_HIFIDAC_MUTE_MUTE_CH1_Msk) != 0, (write_buf[0] & I2CDEF_HIFIDAC_MUTE_MUTE_CH2_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_PATH:
-      if (DAC_WriteChannelAutomuteEnables((write_buf[0] & I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH1_Msk) != 0, (write_buf[0] & I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH2_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
+static void _I2C_ReadStatus(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] =
+      (dac_status.src_lock ? I2CDEF_HIFIDAC_STATUS_LOCK_Msk : 0) |
+      (dac_status.automute_ch1 ? I2CDEF_HIFIDAC_STATUS_AUTOMUTE_CH1_Msk : 0) |
+      (dac_status.automute_ch2 ? I2CDEF_HIFIDAC_STATUS_AUTOMUTE_CH2_Msk : 0) |
+      (dac_status.full_ramp_ch1 ? I2CDEF_HIFIDAC_STATUS_RAMP_DONE_CH1_Msk : 0) |
+      (dac_status.full_ramp_ch2 ? I2CDEF_HIFIDAC_STATUS_RAMP_DONE_CH2_Msk : 0) |
+      (dac_status.monitor_error ? I2CDEF_HIFIDAC_STATUS_MONITOR_ERROR_Msk : 0) |
+      (I2C_GetAndResetError() ? I2CDEF_HIFIDAC_STATUS_I2CERR_Msk : 0); //comm error detection is reset after read
+}
 
-      if (DAC_WriteChannelInverts((write_buf[0] & I2CDEF_HIFIDAC_PATH_INVERT_CH1_Msk) != 0, (write_buf[0] & I2CDEF_HIFIDAC_PATH_INVERT_CH2_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
+static void _I2C_ReadControl(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] =
+      (I2C_GetInterruptsEnabled() ? I2CDEF_HIFIDAC_CONTROL_INT_EN_Msk : 0) |
+      (dac_status.enabled ? I2CDEF_HIFIDAC_CONTROL_DAC_EN_Msk : 0) |
+      (dac_status.sync ? I2CDEF_HIFIDAC_CONTROL_SYNC_Msk : 0) |
+      (dac_status.master ? I2CDEF_HIFIDAC_CONTROL_MASTER_Msk : 0);
+}
 
-      if (DAC_Write4XGains((write_buf[0] & I2CDEF_HIFIDAC_PATH_4XGAIN_CH1_Msk) != 0, (write_buf[0] & I2CDEF_HIFIDAC_PATH_4XGAIN_CH2_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
+static void _I2C_WriteControl(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  uint8_t reset_code = (buf[0] & I2CDEF_HIFIDAC_CONTROL_RESET_Msk) >> I2CDEF_HIFIDAC_CONTROL_RESET_Pos;
 
-      if (DAC_WriteAutomuteTimeAndRamp((write_buf[0] & I2CDEF_HIFIDAC_PATH_MUTE_GND_RAMP_Msk) != 0) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_CLK_CFG:
-      if (DAC_WriteDACClockConfig(write_buf[0]) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_MASTER_DIV:
-      if (DAC_WriteMasterClockConfig(write_buf[0]) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_TDM_SLOT_NUM:
-      if (write_buf[0] > 31) {
-        i2c_err_detected = 1;
-        break;
-      }
-      if (DAC_WriteTDMSlotNum(write_buf[0]) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_CH_SLOTS:
-      if (write_buf[0] > 31 || write_buf[1] > 31) {
-        i2c_err_detected = 1;
-        break;
-      }
-      if (DAC_WriteChannelTDMSlots(write_buf[0], write_buf[1]) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_FILTER_SHAPE:
-      if (write_buf[0] > 7) {
-        i2c_err_detected = 1;
-        break;
-      }
-      if (DAC_WriteFilterShape(write_buf[0]) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_THD_C2:
-      if (DAC_WriteTHDC2((int16_t)write_buf[0] | (int16_t)write_buf[1] << 8, (int16_t)write_buf[2] | (int16_t)write_buf[3] << 8) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    case I2CDEF_HIFIDAC_THD_C3:
-      if (DAC_WriteTHDC3((int16_t)write_buf[0] | (int16_t)write_buf[1] << 8, (int16_t)write_buf[2] | (int16_t)write_buf[3] << 8) != HAL_OK) {
-        i2c_err_detected = 1;
-      }
-      break;
-    default:
-      DEBUG_PRINTF("I2C write error: attempted write to non-writable register\n");
-      i2c_err_detected = 1; //attempting to write to read-only register - report error
-      break;
+  if (reset_code != 0) { //check reset code
+    if (reset_code == I2CDEF_HIFIDAC_CONTROL_RESET_VALUE) { //correct: perform reset
+      NVIC_SystemReset();
+    } else { //incorrect: report error
+      DEBUG_PRINTF("I2C write error: incorrect reset code\n");
+      I2C_ReportError();
+    }
   }
-}
 
-/**
- * called at the start of a read transaction, prepares the data to be sent
- */
-void _I2C_PrepareReadData() {
-  memset(read_buf, 0, I2C_VIRT_BUFFER_SIZE);
+  I2C_SetInterruptsEnabled((buf[0] & I2CDEF_HIFIDAC_CONTROL_INT_EN_Msk) != 0); //interrupt state
 
-  switch (reg_addr) {
-    case I2CDEF_HIFIDAC_STATUS:
-      read_buf[0] =
-          (dac_status.src_lock ? I2CDEF_HIFIDAC_STATUS_LOCK_Msk : 0) |
-          (dac_status.automute_ch1 ? I2CDEF_HIFIDAC_STATUS_AUTOMUTE_CH1_Msk : 0) |
-          (dac_status.automute_ch2 ? I2CDEF_HIFIDAC_STATUS_AUTOMUTE_CH2_Msk : 0) |
-          (dac_status.full_ramp_ch1 ? I2CDEF_HIFIDAC_STATUS_RAMP_DONE_CH1_Msk : 0) |
-          (dac_status.full_ramp_ch2 ? I2CDEF_HIFIDAC_STATUS_RAMP_DONE_CH2_Msk : 0) |
-          (dac_status.monitor_error ? I2CDEF_HIFIDAC_STATUS_MONITOR_ERROR_Msk : 0) |
-          (i2c_err_detected != 0 ? I2CDEF_HIFIDAC_STATUS_I2CERR_Msk : 0);
-      i2c_err_detected = 0; //reset comm error detection after read
-      break;
-    case I2CDEF_HIFIDAC_CONTROL:
-      read_buf[0] =
-          (interrupts_enabled != 0 ? I2CDEF_HIFIDAC_CONTROL_INT_EN_Msk : 0) |
-          (dac_status.enabled ? I2CDEF_HIFIDAC_CONTROL_DAC_EN_Msk : 0) |
-          (dac_status.sync ? I2CDEF_HIFIDAC_CONTROL_SYNC_Msk : 0) |
-          (dac_status.master ? I2CDEF_HIFIDAC_CONTROL_MASTER_Msk : 0);
-      break;
-    case I2CDEF_HIFIDAC_INT_MASK:
-      read_buf[0] = interrupt_mask;
-      break;
-    case I2CDEF_HIFIDAC_INT_FLAGS:
-      read_buf[0] = interrupt_flags;
-      break;
-    case I2CDEF_HIFIDAC_VOLUME:
-      read_buf[0] = dac_status.volume_ch1;
-      read_buf[1] = dac_status.volume_ch2;
-      break;
-    case I2CDEF_HIFIDAC_MUTE:
-      read_buf[0] =
-          (dac_status.manual_mute_ch1 ? I2CDEF_HIFIDAC_MUTE_MUTE_CH1_Msk : 0) |
-          (dac_status.manual_mute_ch2 ? I2CDEF_HIFIDAC_MUTE_MUTE_CH2_Msk : 0);
-      break;
-    case I2CDEF_HIFIDAC_PATH:
-      read_buf[0] =
-          (dac_status.automute_enabled_ch1 ? I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH1_Msk : 0) |
-          (dac_status.automute_enabled_ch2 ? I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH2_Msk : 0) |
-          (dac_status.invert_ch1 ? I2CDEF_HIFIDAC_PATH_INVERT_CH1_Msk : 0) |
-          (dac_status.invert_ch2 ? I2CDEF_HIFIDAC_PATH_INVERT_CH2_Msk : 0) |
-          (dac_status.en4xgain_ch1 ? I2CDEF_HIFIDAC_PATH_4XGAIN_CH1_Msk : 0) |
-          (dac_status.en4xgain_ch2 ? I2CDEF_HIFIDAC_PATH_4XGAIN_CH2_Msk : 0) |
-          (dac_status.mute_gnd_ramp ? I2CDEF_HIFIDAC_PATH_MUTE_GND_RAMP_Msk : 0);
-      break;
-    case I2CDEF_HIFIDAC_CLK_CFG:
-      read_buf[0] = dac_status.clk_config;
-      break;
-    case I2CDEF_HIFIDAC_MASTER_DIV:
-      read_buf[0] = dac_status.master_div;
-      break;
-    case I2CDEF_HIFIDAC_TDM_SLOT_NUM:
-      read_buf[0] = dac_status.tdm_slot_num;
-      break;
-    case I2CDEF_HIFIDAC_CH_SLOTS:
-      read_buf[0] = dac_status.tdm_slot_ch1;
-      read_buf[1] = dac_status.tdm_slot_ch2;
-      break;
-    case I2CDEF_HIFIDAC_FILTER_SHAPE:
-      read_buf[0] = dac_status.filter_shape;
-      break;
-    case I2CDEF_HIFIDAC_THD_C2:
-      read_buf[0] = (uint8_t)(dac_status.thd_c2_ch1 & 0xFF);
-      read_buf[1] = (uint8_t)((dac_status.thd_c2_ch1 >> 8) & 0xFF);
-      read_buf[2] = (uint8_t)(dac_status.thd_c2_ch2 & 0xFF);
-      read_buf[3] = (uint8_t)((dac_status.thd_c2_ch2 >> 8) & 0xFF);
-      break;
-    case I2CDEF_HIFIDAC_THD_C3:
-      read_buf[0] = (uint8_t)(dac_status.thd_c3_ch1 & 0xFF);
-      read_buf[1] = (uint8_t)((dac_status.thd_c3_ch1 >> 8) & 0xFF);
-      read_buf[2] = (uint8_t)(dac_status.thd_c3_ch2 & 0xFF);
-      read_buf[3] = (uint8_t)((dac_status.thd_c3_ch2 >> 8) & 0xFF);
-      break;
-    case I2CDEF_HIFIDAC_MODULE_ID:
-      read_buf[0] = I2CDEF_HIFIDAC_MODULE_ID_VALUE;
-      break;
-  }
+  _I2C_CheckDACWrite(DAC_WriteSysModeConfig((buf[0] & I2CDEF_HIFIDAC_CONTROL_SYNC_Msk) != 0));
+  _I2C_CheckDACWrite(DAC_WriteInputSelection((buf[0] & I2CDEF_HIFIDAC_CONTROL_MASTER_Msk) != 0));
+  _I2C_CheckDACWrite(DAC_WriteSysConfig((buf[0] & I2CDEF_HIFIDAC_CONTROL_DAC_EN_Msk) != 0));
 }
 
-//calculate CRC, starting with existing _i2c_crc_state
-static uint8_t _I2C_CRC_Accumulate(uint8_t* buf, uint16_t length) {
-  int i;
-  for (i = 0; i < length; i++) {
-    _i2c_crc_state = _i2c_crc_table[buf[i] ^ _i2c_crc_state];
-  }
-  return _i2c_crc_state;
+static void _I2C_ReadVolume(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] = dac_status.volume_ch1;
+  buf[1] = dac_status.volume_ch2;
 }
 
-//calculates the CRC for the current read buffer and writes it to the end of the buffer
-static inline void _I2C_CalculateReadCRC() {
-  read_buf[reg_size] = _I2C_CRC_Accumulate(read_buf, reg_size);
+static void _I2C_WriteVolume(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  _I2C_CheckDACWrite(DAC_WriteChannelVolumes(buf[0], buf[1]));
 }
 
-static __always_inline void _I2C_ErrorReset() {
-  i2c_err_detected = 1;
-  state = I2C_IDLE;
-  HAL_I2C_EnableListen_IT(&I2C_INSTANCE);
+static void _I2C_ReadMute(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] =
+      (dac_status.manual_mute_ch1 ? I2CDEF_HIFIDAC_MUTE_MUTE_CH1_Msk : 0) |
+      (dac_status.manual_mute_ch2 ? I2CDEF_HIFIDAC_MUTE_MUTE_CH2_Msk : 0);
 }
 
-static __always_inline void _I2C_HardwareReset() {
-  __disable_irq();
-  //reset peripheral
-  HAL_I2C_DeInit(&I2C_INSTANCE);
-  I2C_FORCE_RESET();
-  int i;
-  for (i = 0; i < 10; i++) __NOP();
-  I2C_RELEASE_RESET();
-  HAL_I2C_Init(&I2C_INSTANCE);
-  //enable I2C timeouts
-  WRITE_REG(I2C_INSTANCE.Instance->TIMEOUTR, (I2C_SCL_STRETCH_TIMEOUT | I2C_SCL_LOW_TIMEOUT));
-  SET_BIT(I2C_INSTANCE.Instance->TIMEOUTR, (I2C_TIMEOUTR_TEXTEN | I2C_TIMEOUTR_TIMOUTEN));
-  //clear interrupt pin
-  HAL_GPIO_WritePin(I2C_INT_PORT, I2C_INT_PIN, GPIO_PIN_SET);
-  //reset loop counters
-  idle_busy_count = 0;
-  non_idle_timeout = 0;
-  __enable_irq();
+static void _I2C_WriteMute(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  _I2C_CheckDACWrite(DAC_WriteChannelMutes((buf[0] & I2CDEF_HIFIDAC_MUTE_MUTE_CH1_Msk) != 0, (buf[0] & I2CDEF_HIFIDAC_MUTE_MUTE_CH2_Msk) != 0));
 }
 
-
-void HAL_I2C_ListenCpltCallback(I2C_HandleTypeDef *hi2c) {
-  state = I2C_IDLE;
-  HAL_I2C_EnableListen_IT(hi2c);
+static void _I2C_ReadPath(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] =
+      (dac_status.automute_enabled_ch1 ? I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH1_Msk : 0) |
+      (dac_status.automute_enabled_ch2 ? I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH2_Msk : 0) |
+      (dac_status.invert_ch1 ? I2CDEF_HIFIDAC_PATH_INVERT_CH1_Msk : 0) |
+      (dac_status.invert_ch2 ? I2CDEF_HIFIDAC_PATH_INVERT_CH2_Msk : 0) |
+      (dac_status.en4xgain_ch1 ? I2CDEF_HIFIDAC_PATH_4XGAIN_CH1_Msk : 0) |
+      (dac_status.en4xgain_ch2 ? I2CDEF_HIFIDAC_PATH_4XGAIN_CH2_Msk : 0) |
+      (dac_status.mute_gnd_ramp ? I2CDEF_HIFIDAC_PATH_MUTE_GND_RAMP_Msk : 0);
 }
 
-void HAL_I2C_AddrCallback(I2C_HandleTypeDef *hi2c, uint8_t TransferDirection, uint16_t AddrMatchCode) {
-  if (TransferDirection == I2C_DIRECTION_TRANSMIT) {
-    if (state != I2C_UNINIT) { //write transmission: start with register address, with potential write data afterwards
-      state = I2C_WAITING_ADDR;
-      non_idle_timeout = I2C_NONIDLE_TIMEOUT;
-
-      HAL_I2C_Slave_Seq_Receive_IT(hi2c, &reg_addr, 1, I2C_FIRST_FRAME);
-    } else {
-      DEBUG_PRINTF("I2C Error: Transmit request in invalid state %u\n", state);
-      _I2C_HardwareReset();
-      _I2C_ErrorReset();
-    }
-  } else {
-    if (state == I2C_ADDR_RECEIVED) { //read transmission: only supported after address write
-      state = I2C_READ;
-      non_idle_timeout = I2C_NONIDLE_TIMEOUT;
-
-      if (HAL_I2C_Slave_Seq_Transmit_IT(hi2c, read_buf, reg_size + 1, I2C_NEXT_FRAME) != HAL_OK) {
-        DEBUG_PRINTF("I2C Error: Read start fail, address 0x%02X\n", reg_addr);
-        _I2C_HardwareReset();
-        _I2C_ErrorReset();
-      }
-    } else {
-      DEBUG_PRINTF("I2C Error: Receive request in invalid state %u\n", state);
-      _I2C_HardwareReset();
-      _I2C_ErrorReset();
-    }
-  }
+static void _I2C_WritePath(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  _I2C_CheckDACWrite(DAC_WriteChannelAutomuteEnables((buf[0] & I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH1_Msk) != 0, (buf[0] & I2CDEF_HIFIDAC_PATH_AUTOMUTE_CH2_Msk) != 0));
+  _I2C_CheckDACWrite(DAC_WriteChannelInverts((buf[0] & I2CDEF_HIFIDAC_PATH_INVERT_CH1_Msk) != 0, (buf[0] & I2CDEF_HIFIDAC_PATH_INVERT_CH2_Msk) != 0));
+  _I2C_CheckDACWrite(DAC_Write4XGains((buf[0] & I2CDEF_HIFIDAC_PATH_4XGAIN_CH1_Msk) != 0, (buf[0] & I2CDEF_HIFIDAC_PATH_4XGAIN_CH2_Msk) != 0));
+  _I2C_CheckDACWrite(DAC_WriteAutomuteTimeAndRamp((buf[0] & I2CDEF_HIFIDAC_PATH_MUTE_GND_RAMP_Msk) != 0));
 }
 
-void HAL_I2C_SlaveTxCpltCallback(I2C_HandleTypeDef *hi2c) {
-  //always allow more reads, to avoid I2C bus freezing
-
-  uint16_t new_size;
-
-  non_idle_timeout = I2C_NONIDLE_TIMEOUT;
-
-  if (reg_addr == 0) { //we're at register 0 (invalid) - always continue as invalid
-    new_size = 0;
-  } else { //otherwise look at next register to potentially continue with valid read operations
-    new_size = reg_size_map[++reg_addr];
-  }
-
-  if (new_size > 0) { //register valid: prepare and send its data next, stay in read state
-    reg_size = new_size;
-    _I2C_PrepareReadData();
-  } else { //register invalid: send dummy data
-    memset(read_buf, 0, I2C_VIRT_BUFFER_SIZE + 1);
-    reg_size = 1;
-    reg_addr = 0;
-  }
+static void _I2C_WriteClockConfig(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  _I2C_CheckDACWrite(DAC_WriteDACClockConfig(buf[0]));
+}
 
-  //subsequent chained register read: only include data itself in CRC
-  _i2c_crc_state = 0;
-  _I2C_CalculateReadCRC();
+static void _I2C_WriteMasterDiv(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  _I2C_CheckDACWrite(DAC_WriteMasterClockConfig(buf[0]));
+}
 
-  if (HAL_I2C_Slave_Seq_Transmit_IT(hi2c, read_buf, reg_size + 1, I2C_NEXT_FRAME) != HAL_OK) {
-    DEBUG_PRINTF("I2C Error: Sequential read start fail, address 0x%02X\n", reg_addr);
-    _I2C_HardwareReset();
-    _I2C_ErrorReset();
+static void _I2C_WriteTDMSlotNum(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  if (buf[0] > 31) {
+    I2C_ReportError();
+    return;
   }
+  _I2C_CheckDACWrite(DAC_WriteTDMSlotNum(buf[0]));
 }
 
-void HAL_I2C_SlaveRxCpltCallback(I2C_HandleTypeDef *hi2c) {
-  if (state == I2C_WAITING_ADDR) { //received data is the address
-    state = I2C_ADDR_RECEIVED;
-    non_idle_timeout = I2C_NONIDLE_TIMEOUT;
-
-    uint16_t size = reg_size_map[reg_addr];
-    if (size == 0) { //invalid register address: accept/send dummy bytes
-      DEBUG_PRINTF("I2C Error: Attempted access of invalid address 0x%02X\n", reg_addr);
-      memset(read_buf, 0, I2C_VIRT_BUFFER_SIZE + 1);
-      reg_size = 1;
-      reg_addr = 0;
-      i2c_err_detected = 1;
-    } else { //valid register: set size and prepare potential read data
-      reg_size = size;
-      _I2C_PrepareReadData();
-    }
-
-    //first register read after address: include I2C address and register address bytes in CRC
-    uint8_t read_crc_buf[3] = { I2C_OWN_ADDRESS_WRITE, reg_addr, I2C_OWN_ADDRESS_READ };
-    _i2c_crc_state = 0;
-    _I2C_CRC_Accumulate(read_crc_buf, 3);
-    _I2C_CalculateReadCRC();
-
-    if (HAL_I2C_Slave_Seq_Receive_IT(hi2c, write_buf, reg_size + 1, I2C_NEXT_FRAME) != HAL_OK) { //prepare to receive write data immediately
-      DEBUG_PRINTF("I2C Error: Write start fail, address 0x%02X\n", reg_addr);
-      _I2C_HardwareReset();
-      _I2C_ErrorReset();
-    }
-  } else if (state == I2C_ADDR_RECEIVED || state == I2C_WRITE) { //received data is the data to be written: process it and prepare to accept more data (always to prevent freeze)
-    uint16_t new_size;
-
-    _I2C_State prev_state = state;
-    state = I2C_WRITE;
-    non_idle_timeout = I2C_NONIDLE_TIMEOUT;
-
-    if (reg_addr == 0) { //register invalid - continue as invalid
-      new_size = 0;
-    } else { //register valid: calculate and check CRC before processing
-      _i2c_crc_state = 0;
-      if (prev_state == I2C_ADDR_RECEIVED) {
-        //first register after address: include I2C address and register address in CRC
-        uint8_t write_crc_init_buf[2] = { I2C_OWN_ADDRESS_WRITE, reg_addr };
-        _I2C_CRC_Accumulate(write_crc_init_buf, 2);
-      }
-
-      uint8_t crc_check = _I2C_CRC_Accumulate(write_buf, reg_size + 1);
-      if (crc_check == 0) {
-        //good CRC: process data
-        _I2C_ProcessWriteData();
-      } else {
-        //wrong CRC: report error and ignore data
-        DEBUG_PRINTF("I2C CRC mismatch on write of register 0x%02X\n", reg_addr);
-        i2c_err_detected = 1;
-      }
-
-      //get next register size (if valid)
-      new_size = reg_size_map[++reg_addr];
-    }
-
-    if (new_size > 0) { //next register valid: accept its data next
-      reg_size = new_size;
-    } else { //next register invalid: accept dummy data and continue as invalid
-      reg_size = 1;
-      reg_addr = 0;
-    }
-
-    if (HAL_I2C_Slave_Seq_Receive_IT(hi2c, write_buf, reg_size + 1, I2C_NEXT_FRAME) != HAL_OK) {
-      DEBUG_PRINTF("I2C Error: Sequential write start fail, address 0x%02X\n", reg_addr);
-      _I2C_HardwareReset();
-      _I2C_ErrorReset();
-    }
-  } else { //ignore data received in idle or other states
-    state = I2C_IDLE;
+static void _I2C_WriteChannelSlots(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  if (buf[0] > 31 || buf[1] > 31) {
+    I2C_ReportError();
+    return;
   }
+  _I2C_CheckDACWrite(DAC_WriteChannelTDMSlots(buf[0], buf[1]));
 }
 
-void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
-  uint32_t error_code = HAL_I2C_GetError(hi2c);
-
-  //if error is not an expected AF: indicate error
-  if (error_code != HAL_I2C_ERROR_AF) {
-    DEBUG_PRINTF("I2C Error: HAL error 0x%02lX\n", error_code);
-    _I2C_HardwareReset();
-    _I2C_ErrorReset();
+static void _I2C_WriteFilterShape(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  if (buf[0] > 7) {
+    I2C_ReportError();
+    return;
   }
-
-  //go back to idle state
-  state = I2C_IDLE;
+  _I2C_CheckDACWrite(DAC_WriteFilterShape(buf[0]));
 }
 
-
-void I2C_TimeoutISR() {
-  DEBUG_PRINTF("I2C Error: Timeout\n");
-  _I2C_HardwareReset();
-  _I2C_ErrorReset();
+//THD compensation coefficients, stored as ch1, ch2 int16 pairs in dac_status - sent as little-endian int16 each
+static void _I2C_ReadTHDC2(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] = (uint8_t)(dac_status.thd_c2_ch1 & 0xFF);
+  buf[1] = (uint8_t)((dac_status.thd_c2_ch1 >> 8) & 0xFF);
+  buf[2] = (uint8_t)(dac_status.thd_c2_ch2 & 0xFF);
+  buf[3] = (uint8_t)((dac_status.thd_c2_ch2 >> 8) & 0xFF);
 }
 
-HAL_StatusTypeDef I2C_Init() {
-  //reset interrupt and error state
-  interrupts_enabled = 0;
-  interrupt_mask = 0;
-  interrupt_flags = I2CDEF_HIFIDAC_INT_FLAGS_INT_RESET_Msk;
-  i2c_err_detected = 0;
-  non_idle_timeout = 0;
-  idle_busy_count = 0;
-
-  //perform hardware reset
-  _I2C_HardwareReset();
-
-  //enable I2C listening
-  ReturnOnError(HAL_I2C_EnableListen_IT(&I2C_INSTANCE));
-
-  //reset internal state
-  state = I2C_IDLE;
+static void _I2C_WriteTHDC2(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  _I2C_CheckDACWrite(DAC_WriteTHDC2((int16_t)buf[0] | (int16_t)buf[1] << 8, (int16_t)buf[2] | (int16_t)buf[3] << 8));
+}
 
-  //update interrupt pin for init interrupt
-  _I2C_UpdateInterruptPin();
+static void _I2C_ReadTHDC3(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] = (uint8_t)(dac_status.thd_c3_ch1 & 0xFF);
+  buf[1] = (uint8_t)((dac_status.thd_c3_ch1 >> 8) & 0xFF);
+  buf[2] = (uint8_t)(dac_status.thd_c3_ch2 & 0xFF);
+  buf[3] = (uint8_t)((dac_status.thd_c3_ch2 >> 8) & 0xFF);
+}
 
-  return HAL_OK;
+static void _I2C_WriteTHDC3(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  _I2C_CheckDACWrite(DAC_WriteTHDC3((int16_t)buf[0] | (int16_t)buf[1] << 8, (int16_t)buf[2] | (int16_t)buf[3] << 8));
 }
 
-void I2C_TriggerInterrupt(uint8_t interrupt_bit) {
-  interrupt_flags |= interrupt_bit; //set flag
-  _I2C_UpdateInterruptPin();
+static void _I2C_ReadModuleID(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] = I2CDEF_HIFIDAC_MODULE_ID_VALUE;
 }
 
-void I2C_LoopUpdate() {
-  if (state == I2C_IDLE && __HAL_I2C_GET_FLAG(&I2C_INSTANCE, I2C_FLAG_BUSY) == SET) { //driver idle but peripheral busy: check timeout
-    if (++idle_busy_count > I2C_PERIPHERAL_BUSY_TIMEOUT) { //peripheral busy for too long, reset
-      DEBUG_PRINTF("I2C Error: Peripheral busy in idle state timeout\n");
-      _I2C_HardwareReset();
-      _I2C_ErrorReset();
-    }
-  } else {
-    idle_busy_count = 0;
-  }
 
-  __disable_irq();
-  if (non_idle_timeout > 0) { //handle non-idle state timeouts
-    if (state == I2C_IDLE || state == I2C_UNINIT) { //reset timeout if idle
-      non_idle_timeout = 0;
-    } else {
-      if (--non_idle_timeout == 0) { //timed out: error
-        __enable_irq();
-        DEBUG_PRINTF("I2C Error: Non-idle state timed out\n");
-        _I2C_HardwareReset();
-        _I2C_ErrorReset();
-      }
-    }
-  }
-  __enable_irq();
-}
+//register table - single-byte DAC settings are read directly from the live DAC status
+const I2C_Register i2c_registers[] = {
+  I2C_REGISTER(I2CDEF_HIFIDAC_STATUS, 1, I2C_REG_READ, _I2C_ReadStatus, NULL),
+  I2C_REGISTER(I2CDEF_HIFIDAC_CONTROL, 1, I2C_REG_RW, _I2C_ReadControl, _I2C_WriteControl),
+  I2C_REGISTER(I2CDEF_HIFIDAC_INT_MASK, 1, I2C_REG_RW, I2C_ReadInterruptMask, I2C_WriteInterruptMask),
+  I2C_REGISTER(I2CDEF_HIFIDAC_INT_FLAGS, 1, I2C_REG_RW, I2C_ReadInterruptFlags, I2C_WriteInterruptFlags),
+  I2C_REGISTER(I2CDEF_HIFIDAC_VOLUME, 2, I2C_REG_RW, _I2C_ReadVolume, _I2C_WriteVolume),
+  I2C_REGISTER(I2CDEF_HIFIDAC_MUTE, 1, I2C_REG_RW, _I2C_ReadMute, _I2C_WriteMute),
+  I2C_REGISTER(I2CDEF_HIFIDAC_PATH, 1, I2C_REG_RW, _I2C_ReadPath, _I2C_WritePath),
+  I2C_REGISTER_LIVE(I2CDEF_HIFIDAC_CLK_CFG, 1, 1, I2C_REG_RW, &dac_status.clk_config, _I2C_WriteClockConfig, NULL),
+  I2C_REGISTER_LIVE(I2CDEF_HIFIDAC_MASTER_DIV, 1, 1, I2C_REG_RW, &dac_status.master_div, _I2C_WriteMasterDiv, NULL),
+  I2C_REGISTER_LIVE(I2CDEF_HIFIDAC_TDM_SLOT_NUM, 1, 1, I2C_REG_RW, &dac_status.tdm_slot_num, _I2C_WriteTDMSlotNum, NULL),
+  I2C_REGISTER_LIVE(I2CDEF_HIFIDAC_CH_SLOTS, 1, 2, I2C_REG_RW, &dac_status.tdm_slot_ch1, _I2C_WriteChannelSlots, NULL),
+  I2C_REGISTER_LIVE(I2CDEF_HIFIDAC_FILTER_SHAPE, 1, 1, I2C_REG_RW, &dac_status.filter_shape, _I2C_WriteFilterShape, NULL),
+  I2C_REGISTER(I2CDEF_HIFIDAC_THD_C2, 4, I2C_REG_RW, _I2C_ReadTHDC2, _I2C_WriteTHDC2),
+  I2C_REGISTER(I2CDEF_HIFIDAC_THD_C3, 4, I2C_REG_RW, _I2C_ReadTHDC3, _I2C_WriteTHDC3),
+  I2C_REGISTER(I2CDEF_HIFIDAC_MODULE_ID, 1, I2C_REG_READ, _I2C_ReadModuleID, NULL)
+};
+const uint8_t i2c_register_count = sizeof(i2c_registers) / sizeof(I2C_Register);
@@ -0,0 +1,46 @@
+/*
+ * system.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host stand-in for the controller's system.h, for unit tests of Core sources that only use the debug log from it
+ *  (operation queue, event source). Log entries are printed and counted per level instead of going to the GUI log.
+ */
+
+#ifndef INC_SYSTEM_H_
+#define INC_SYSTEM_H_
+
+
+#include "cpp_main.h"
+#include <stdarg.h>
+
+
+typedef enum {
+  DEBUG_CRITICAL = 0,
+  DEBUG_ERROR = 1,
+  DEBUG_WARNING = 2,
+  DEBUG_INFO = 3
+} DebugLevel;
+
+
+//number of log entries per level so far
+inline uint32_t host_debug_log_counts[4] = { 0 };
+
+inline void HOST_DebugLog(DebugLevel level, const char* fmt, ...) __attribute__((__format__(__printf__, 2, 3)));
+inline void HOST_DebugLog(DebugLevel level, const char* fmt, ...) {
+  static const char* const level_names[4] = { "CRITICAL", "ERROR", "WARNING", "INFO" };
+  va_list args;
+
+  host_debug_log_counts[level]++;
+  printf("[%s] ", level_names[level]);
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  printf("\n");
+}
+
+#define DEBUG_LOG(level, ...) do { HOST_DebugLog(level, __VA_ARGS__); } while (0)
+
+
+#endif /* INC_SYSTEM_H_ */
@@ -0,0 +1,238 @@
+/*
+ * sim_eve.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ */
+
+
+#include "sim_eve.h"
+#include "sim_time.h"
+#include "EVE.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+//the simulated EVE (only one OSPI display per system)
+static SimEVE* _sim_eve = NULL;
+
+
+//line count of an OSPI phase mode field (none, 1, 2, 4 or 8 lines)
+static uint32_t _SimEVE_Lines(uint32_t mode, uint32_t pos) {
+  static const uint32_t lines[5] = { 0, 1, 2, 4, 8 };
+  uint32_t index = (mode >> pos) & 0x7;
+  return (index < 5) ? lines[index] : 0;
+}
+
+//bit count of an OSPI phase size field (8, 16, 24 or 32 bits)
+static uint32_t _SimEVE_Bits(uint32_t size, uint32_t pos) {
+  return (((size >> pos) & 0x3) + 1) * 8;
+}
+
+
+uint8_t* SimEVE::Mem(uint32_t address, uint32_t length) {
+  if (address >= SIMEVE_MEMORY_SIZE || length > SIMEVE_MEMORY_SIZE - address) {
+    throw std::invalid_argument("SimEVE access outside of the address space");
+  }
+  return this->memory + address;
+}
+
+uint8_t& SimEVE::Mem8(uint32_t address) {
+  return *this->Mem(address);
+}
+
+uint16_t& SimEVE::Mem16(uint32_t address) {
+  return *(uint16_t*)this->Mem(address, 2);
+}
+
+uint32_t& SimEVE::Mem32(uint32_t address) {
+  return *(uint32_t*)this->Mem(address, 4);
+}
+
+
+uint32_t SimEVE::BusClock() const {
+  return this->kernel_clock_hz / MAX(this->handle.Init.ClockPrescaler, 1u);
+}
+
+
+void SimEVE::TimeTransfer(const OSPI_RegularCmdTypeDef& cmd, uint32_t data_bytes) {
+  //clock cycles per phase: bits divided by the lines they use
+  uint32_t cycles = 0;
+  uint32_t lines = _SimEVE_Lines(cmd.InstructionMode, OCTOSPI_CCR_IMODE_Pos);
+  if (lines > 0) {
+    cycles += _SimEVE_Bits(cmd.InstructionSize, OCTOSPI_CCR_ISIZE_Pos) / lines;
+  }
+  lines = _SimEVE_Lines(cmd.AddressMode, OCTOSPI_CCR_ADMODE_Pos);
+  if (lines > 0) {
+    cycles += _SimEVE_Bits(cmd.AddressSize, OCTOSPI_CCR_ADSIZE_Pos) / lines;
+  }
+  lines = _SimEVE_Lines(cmd.AlternateBytesMode, OCTOSPI_CCR_ABMODE_Pos);
+  if (lines > 0) {
+    cycles += _SimEVE_Bits(cmd.AlternateBytesSize, OCTOSPI_CCR_ABSIZE_Pos) / lines;
+  }
+  cycles += cmd.DummyCycles;
+  lines = _SimEVE_Lines(cmd.DataMode, OCTOSPI_CCR_DMODE_Pos);
+  if (lines > 0) {
+    cycles += data_bytes * 8 / lines;
+  }
+
+  double time_us = (double)cycles * 1000000.0 / (double)this->BusClock();
+  this->transfer_count++;
+  this->byte_count += data_bytes;
+  this->busy_time_ms += time_us / 1000.0;
+
+  //polling-mode transfers block the CPU for their bus time (interrupts keep running)
+  SimTime_AdvanceTo(SimTime_Now() + (uint64_t)(time_us + 0.5));
+}
+
+
+SimEVE::SimEVE(OSPI_HandleTypeDef& handle, uint32_t kernel_clock_hz) : handle(handle), kernel_clock_hz(kernel_clock_hz), transfer_count(0), byte_count(0), busy_time_ms(0.0),
+    host_command_count(0), cmd_fifo_byte_count(0), memory(NULL), memory_fd(-1), command_pending(false) {
+  if (_sim_eve != NULL) {
+    throw std::logic_error("SimEVE only supports a single instance");
+  }
+
+  //one memory, mapped at the firmware's OSPI window and at its write alias (main mmap writes set address bit 23)
+  this->memory_fd = memfd_create("sim_eve", 0);
+  if (this->memory_fd < 0 || ftruncate(this->memory_fd, SIMEVE_MEMORY_SIZE) != 0) {
+    throw std::runtime_error("SimEVE failed to create the display memory");
+  }
+  void* read_map = mmap((void*)(uintptr_t)EVE_MMAP_BASE, SIMEVE_MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, this->memory_fd, 0);
+  void* write_map = mmap((void*)(uintptr_t)(EVE_MMAP_BASE | 0x800000), SIMEVE_MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, this->memory_fd, 0);
+  if (read_map != (void*)(uintptr_t)EVE_MMAP_BASE || write_map != (void*)(uintptr_t)(EVE_MMAP_BASE | 0x800000)) {
+    throw std::runtime_error("SimEVE failed to map the display memory at the OSPI window");
+  }
+  this->memory = (uint8_t*)read_map;
+
+  memset(&this->instance, 0, sizeof(this->instance));
+  memset(&this->command, 0, sizeof(this->command));
+  this->handle.Instance = &this->instance;
+  this->handle.State = HAL_OSPI_STATE_READY;
+
+  //power-up register values the driver waits for: chip ID, all units out of reset, empty command FIFO, no touch
+  this->Mem8(REG_ID) = 0x7C;
+  this->Mem8(REG_CPURESET) = 0;
+  this->Mem16(REG_CMDB_SPACE) = 0xFFC;
+  this->Mem32(REG_TOUCH_DIRECT_XY) = 0x80008000;
+  this->Mem32(REG_TOUCH_SCREEN_XY) = 0x80008000;
+
+  _sim_eve = this;
+}
+
+SimEVE::~SimEVE() {
+  munmap((void*)(uintptr_t)EVE_MMAP_BASE, SIMEVE_MEMORY_SIZE);
+  munmap((void*)(uintptr_t)(EVE_MMAP_BASE | 0x800000), SIMEVE_MEMORY_SIZE);
+  close(this->memory_fd);
+  _sim_eve = NULL;
+}
+
+
+static SimEVE* _SimEVE_Find(OSPI_HandleTypeDef* hospi) {
+  if (_sim_eve == NULL || &_sim_eve->handle != hospi) {
+    throw std::logic_error("SimEVE: HAL call with unknown OSPI handle");
+  }
+  return _sim_eve;
+}
+
+
+/*********************************************************/
+/*                  HAL OSPI replacement                 */
+/*********************************************************/
+
+HAL_StatusTypeDef HAL_OSPI_Init(OSPI_HandleTypeDef* hospi) {
+  hospi->State = HAL_OSPI_STATE_READY;
+  hospi->ErrorCode = HAL_OSPI_ERROR_NONE;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_OSPI_DeInit(OSPI_HandleTypeDef* hospi) {
+  hospi->State = HAL_OSPI_STATE_RESET;
+  return HAL_OK;
+}
+
+uint32_t HAL_OSPI_GetState(const OSPI_HandleTypeDef* hospi) {
+  return hospi->State;
+}
+
+HAL_StatusTypeDef HAL_OSPI_Abort(OSPI_HandleTypeDef* hospi) {
+  _SimEVE_Find(hospi)->command_pending = false;
+  hospi->State = HAL_OSPI_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_OSPI_Command(OSPI_HandleTypeDef* hospi, OSPI_RegularCmdTypeDef* cmd, uint32_t Timeout) {
+  UNUSED(Timeout);
+  SimEVE* eve = _SimEVE_Find(hospi);
+
+  //like the HAL, commands are rejected while memory-mapped (the driver has to abort first)
+  if (hospi->State != HAL_OSPI_STATE_READY && hospi->State != HAL_OSPI_STATE_CMD_CFG) {
+    hospi->ErrorCode = HAL_OSPI_ERROR_INVALID_SEQUENCE;
+    return HAL_ERROR;
+  }
+
+  if (cmd->OperationType != HAL_OSPI_OPTYPE_COMMON_CFG) {
+    //read/write configuration of the following memory-mapped mode
+    hospi->State = HAL_OSPI_STATE_CMD_CFG;
+    return HAL_OK;
+  }
+
+  if (cmd->DataMode == HAL_OSPI_DATA_NONE) {
+    //command without data (EVE host command): sent right away
+    eve->host_command_count++;
+    eve->TimeTransfer(*cmd, 0);
+    hospi->State = HAL_OSPI_STATE_READY;
+    return HAL_OK;
+  }
+
+  //indirect-mode transfer: sent with its data phase
+  eve->command = *cmd;
+  eve->command_pending = true;
+  hospi->State = HAL_OSPI_STATE_CMD_CFG;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_OSPI_Transmit(OSPI_HandleTypeDef* hospi, uint8_t* pData, uint32_t Timeout) {
+  UNUSED(Timeout);
+  SimEVE* eve = _SimEVE_Find(hospi);
+  if (!eve->command_pending || pData == NULL) {
+    return HAL_ERROR;
+  }
+  eve->command_pending = false;
+  hospi->State = HAL_OSPI_STATE_READY;
+
+  uint32_t address = eve->command.Address & 0x3FFFFF;
+  uint32_t length = eve->command.NbData;
+  eve->TimeTransfer(eve->command, length);
+
+  if (address == REG_CMDB_WRITE) {
+    //command FIFO port: consumed by the (instant) coprocessor
+    eve->cmd_fifo_byte_count += length;
+  } else {
+    memcpy(eve->Mem(address, length), pData, length);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_OSPI_Receive(OSPI_HandleTypeDef* hospi, uint8_t* pData, uint32_t Timeout) {
+  UNUSED(Timeout);
+  SimEVE* eve = _SimEVE_Find(hospi);
+  if (!eve->command_pending || pData == NULL) {
+    return HAL_ERROR;
+  }
+  eve->command_pending = false;
+  hospi->State = HAL_OSPI_STATE_READY;
+
+  uint32_t address = eve->command.Address & 0x3FFFFF;
+  uint32_t length = eve->command.NbData;
+  eve->TimeTransfer(eve->command, length);
+
+  memcpy(pData, eve->Mem(address, length), length);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_OSPI_MemoryMapped(OSPI_HandleTypeDef* hospi, OSPI_MemoryMappedTypeDef* cfg) {
+  UNUSED(cfg);
+  _SimEVE_Find(hospi);
+  hospi->State = HAL_OSPI_STATE_BUSY_MEM_MAPPED;
+  return HAL_OK;
+}
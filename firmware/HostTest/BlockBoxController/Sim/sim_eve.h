@@ -0,0 +1,71 @@
+/*
+ * sim_eve.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Simulated EVE display controller on the OCTOSPI peripheral, for host builds of the controller GUI: implements the HAL
+ *  OSPI functions used by EVETargetPHY against a flat copy of the EVE address space. Direct (indirect-mode) transfers and
+ *  host commands take their bit-accurate bus time at the configured OSPI clock; memory-mapped accesses go straight to the
+ *  memory (mapped at the firmware's fixed OSPI window and its write alias) and are not timed. The coprocessor is modelled
+ *  as infinitely fast: data written to the command FIFO port is counted and dropped, and the FIFO always reports empty.
+ */
+
+#ifndef SIM_EVE_H_
+#define SIM_EVE_H_
+
+
+#include "cpp_main.h"
+
+
+//size of the simulated EVE address space (covers RAM_G, ROM, RAM_DL, registers and RAM_CMD)
+#define SIMEVE_MEMORY_SIZE 0x400000
+
+
+//simulated EVE with its OSPI link on an external HAL handle
+class SimEVE {
+public:
+  OSPI_HandleTypeDef& handle;
+  OCTOSPI_TypeDef instance;
+
+  //OSPI kernel clock in Hz, divided by the handle's ClockPrescaler for the bus clock
+  const uint32_t kernel_clock_hz;
+
+  //statistics of timed transfers: count, data bytes, and the bus time they take; host commands; command FIFO bytes
+  uint32_t transfer_count;
+  uint32_t byte_count;
+  double busy_time_ms;
+  uint32_t host_command_count;
+  uint32_t cmd_fifo_byte_count;
+
+  //pointer to the given display memory range
+  uint8_t* Mem(uint32_t address, uint32_t length = 1);
+  uint8_t& Mem8(uint32_t address);
+  uint16_t& Mem16(uint32_t address);
+  uint32_t& Mem32(uint32_t address);
+
+  //current OSPI bus clock in Hz
+  uint32_t BusClock() const;
+
+  SimEVE(OSPI_HandleTypeDef& handle, uint32_t kernel_clock_hz);
+  ~SimEVE();
+
+private:
+  friend HAL_StatusTypeDef HAL_OSPI_Abort(OSPI_HandleTypeDef*);
+  friend HAL_StatusTypeDef HAL_OSPI_Command(OSPI_HandleTypeDef*, OSPI_RegularCmdTypeDef*, uint32_t);
+  friend HAL_StatusTypeDef HAL_OSPI_Transmit(OSPI_HandleTypeDef*, uint8_t*, uint32_t);
+  friend HAL_StatusTypeDef HAL_OSPI_Receive(OSPI_HandleTypeDef*, uint8_t*, uint32_t);
+
+  uint8_t* memory;
+  int memory_fd;
+
+  //configured indirect-mode command, waiting for its data phase
+  OSPI_RegularCmdTypeDef command;
+  bool command_pending;
+
+  //takes the bus time of a command (instruction, address, alternate bytes, dummy cycles) with the given number of data bytes
+  void TimeTransfer(const OSPI_RegularCmdTypeDef& cmd, uint32_t data_bytes);
+};
+
+
+#endif /* SIM_EVE_H_ */
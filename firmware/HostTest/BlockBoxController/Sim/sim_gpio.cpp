@@ -0,0 +1,29 @@
+/*
+ * sim_gpio.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  HAL GPIO functions for host builds of the controller, working on host GPIO_TypeDef instances like the hardware does:
+ *  pin reads return the IDR bits (set by the test or module stand-ins), pin writes change ODR.
+ */
+
+
+#include "cpp_main.h"
+
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin) {
+  return (GPIOx->IDR & GPIO_Pin) != 0 ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  if (PinState != GPIO_PIN_RESET) {
+    GPIOx->ODR |= GPIO_Pin;
+  } else {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin) {
+  GPIOx->ODR ^= GPIO_Pin;
+}
@@ -0,0 +1,379 @@
+/*
+ * sim_i2c.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ */
+
+
+#include "sim_i2c.h"
+#include "sim_time.h"
+#include <algorithm>
+
+
+//all existing buses, to map HAL handles to buses
+static std::vector<SimI2CBus*> _sim_i2c_buses;
+
+
+uint8_t SimI2C_CRC(const uint8_t* buf, uint16_t length, uint8_t state) {
+  for (uint16_t i = 0; i < length; i++) {
+    state ^= buf[i];
+    for (int b = 0; b < 8; b++) {
+      state = (state & 0x80) ? (uint8_t)((state << 1) ^ 0x7F) : (uint8_t)(state << 1);
+    }
+  }
+  return state;
+}
+
+uint32_t SimI2C_BitRate(uint32_t timingr, uint32_t kernel_clock_hz) {
+  uint32_t presc = (timingr & I2C_TIMINGR_PRESC_Msk) >> I2C_TIMINGR_PRESC_Pos;
+  uint32_t sclh = (timingr & I2C_TIMINGR_SCLH_Msk) >> I2C_TIMINGR_SCLH_Pos;
+  uint32_t scll = (timingr & I2C_TIMINGR_SCLL_Msk) >> I2C_TIMINGR_SCLL_Pos;
+  //SCL period: low and high phases in prescaled clocks, plus about 4 kernel clocks of SCL synchronisation
+  uint32_t kernel_clocks = (scll + 1 + sclh + 1) * (presc + 1) + 4;
+  return kernel_clock_hz / kernel_clocks;
+}
+
+
+/*********************************************************/
+/*                   Simulated Device                    */
+/*********************************************************/
+
+uint8_t* SimI2CDevice::Reg(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] == 0) {
+    throw std::invalid_argument("SimI2CDevice access to invalid register");
+  }
+  return this->data.data() + this->data_offsets[reg_addr];
+}
+
+uint8_t& SimI2CDevice::Reg8(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] != 1) {
+    throw std::invalid_argument("SimI2CDevice 8-bit access to invalid or differently-sized register");
+  }
+  return *this->Reg(reg_addr);
+}
+
+uint16_t& SimI2CDevice::Reg16(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] != 2) {
+    throw std::invalid_argument("SimI2CDevice 16-bit access to invalid or differently-sized register");
+  }
+  return *(uint16_t*)this->Reg(reg_addr);
+}
+
+uint32_t& SimI2CDevice::Reg32(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] != 4) {
+    throw std::invalid_argument("SimI2CDevice 32-bit access to invalid or differently-sized register");
+  }
+  return *(uint32_t*)this->Reg(reg_addr);
+}
+
+
+bool SimI2CDevice::HandleRead(uint16_t reg_addr, uint8_t* buf, uint16_t length) {
+  this->read_count++;
+
+  //CRC of the first register covers the address bytes too: write address, register address, read address
+  uint8_t prefix[3] = { (uint8_t)(this->address << 1), (uint8_t)reg_addr, (uint8_t)((this->address << 1) | 1) };
+  uint8_t crc = SimI2C_CRC(prefix, 3, 0);
+
+  uint16_t offset = 0;
+  uint16_t reg = reg_addr;
+  while (offset < length) {
+    if (reg > 255 || this->reg_sizes[reg] == 0) {
+      return false;
+    }
+    this->OnRegisterRead((uint8_t)reg);
+
+    uint16_t size = this->reg_sizes[reg];
+    const uint8_t* value = this->Reg((uint8_t)reg);
+    uint16_t copy = std::min<uint16_t>(size, length - offset);
+    memcpy(buf + offset, value, copy);
+    offset += copy;
+
+    if (this->uses_crc && offset < length) {
+      buf[offset++] = SimI2C_CRC(value, size, crc);
+    }
+    crc = 0;
+    reg++;
+  }
+
+  return true;
+}
+
+bool SimI2CDevice::HandleWrite(uint16_t reg_addr, const uint8_t* buf, uint16_t length) {
+  this->write_count++;
+
+  uint8_t prefix[2] = { (uint8_t)(this->address << 1), (uint8_t)reg_addr };
+  uint8_t crc = SimI2C_CRC(prefix, 2, 0);
+
+  uint16_t offset = 0;
+  uint16_t reg = reg_addr;
+  while (offset < length) {
+    if (reg > 255 || this->reg_sizes[reg] == 0) {
+      return false;
+    }
+
+    uint16_t size = this->reg_sizes[reg];
+    if (offset + size + (this->uses_crc ? 1 : 0) > length) {
+      //incomplete register: ignored, like the module engine does
+      return false;
+    }
+    if (this->uses_crc) {
+      if (SimI2C_CRC(buf + offset, size, crc) != buf[offset + size]) {
+        this->crc_error_count++;
+        return false;
+      }
+    }
+    if (!this->OnRegisterWrite((uint8_t)reg, buf + offset)) {
+      return false;
+    }
+    this->register_write_count++;
+
+    offset += size + (this->uses_crc ? 1 : 0);
+    crc = 0;
+    reg++;
+  }
+
+  return true;
+}
+
+
+void SimI2CDevice::OnRegisterRead(uint8_t reg_addr) {
+  UNUSED(reg_addr);
+}
+
+bool SimI2CDevice::OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) {
+  memcpy(this->Reg(reg_addr), value, this->reg_sizes[reg_addr]);
+  return true;
+}
+
+
+SimI2CDevice::SimI2CDevice(uint8_t address, const uint16_t* reg_sizes, bool use_crc, uint16_t reg_addr_size) :
+    address(address), uses_crc(use_crc), reg_addr_size(reg_addr_size), read_count(0), write_count(0), register_write_count(0), crc_error_count(0), nack_count(0) {
+  uint16_t offset = 0;
+  for (int i = 0; i < 256; i++) {
+    this->reg_sizes[i] = reg_sizes[i];
+    this->data_offsets[i] = offset;
+    offset += reg_sizes[i];
+  }
+  this->data.resize(offset);
+}
+
+
+/*********************************************************/
+/*                     Simulated Bus                     */
+/*********************************************************/
+
+void SimI2CBus::AddDevice(SimI2CDevice* device) {
+  if (device == NULL || this->FindDevice(device->address) != NULL) {
+    throw std::invalid_argument("SimI2CBus requires non-null devices with unique addresses");
+  }
+  this->devices.push_back(device);
+}
+
+SimI2CDevice* SimI2CBus::FindDevice(uint8_t address) {
+  for (auto device : this->devices) {
+    if (device->address == address) {
+      return device;
+    }
+  }
+  return NULL;
+}
+
+bool SimI2CBus::IsPending() const {
+  return this->pending;
+}
+
+void SimI2CBus::AbortPending() {
+  this->pending = false;
+  this->pending_generation++;
+}
+
+
+double SimI2CBus::AccountTransfer(bool read, uint16_t reg_addr_size, uint16_t length) {
+  //wire bytes: address, register address, (repeated start with read address,) data - 9 clocks each
+  uint32_t bytes = 1 + reg_addr_size + (read ? 1 : 0) + length;
+  //plus start, stop and bus free time, and the repeated start of reads
+  uint32_t bits = bytes * 9 + 3 + (read ? 1 : 0);
+  double time_us = (double)bits * 1000000.0 / (double)this->bit_rate;
+
+  this->transfer_count++;
+  this->byte_count += bytes;
+  this->busy_time_ms += time_us / 1000.0;
+  return time_us;
+}
+
+bool SimI2CBus::Execute(bool read, uint16_t dev_address, uint16_t reg_addr, uint16_t reg_addr_size, uint8_t* buf, uint16_t length) {
+  SimI2CDevice* device = this->FindDevice((uint8_t)(dev_address >> 1));
+  if (device == NULL || reg_addr_size != device->reg_addr_size) {
+    return false;
+  }
+  if (device->nack_count > 0) {
+    device->nack_count--;
+    return false;
+  }
+
+  if (read) {
+    return device->HandleRead(reg_addr, buf, length);
+  } else {
+    return device->HandleWrite(reg_addr, buf, length);
+  }
+}
+
+
+void SimI2CBus::CompletePending() {
+  this->pending = false;
+  bool success = this->Execute(this->pending_read, this->pending_dev_address, this->pending_reg_addr, this->pending_reg_addr_size, this->pending_buf, this->pending_length);
+  this->handle.State = HAL_I2C_STATE_READY;
+
+  if (!success) {
+    this->handle.ErrorCode = HAL_I2C_ERROR_AF;
+    HAL_I2C_ErrorCallback(&this->handle);
+  } else if (this->pending_read) {
+    HAL_I2C_MemRxCpltCallback(&this->handle);
+  } else {
+    HAL_I2C_MemTxCpltCallback(&this->handle);
+  }
+}
+
+
+SimI2CBus::SimI2CBus(uint32_t bit_rate) : handle(own_handle), bit_rate(bit_rate), timed(false), transfer_count(0), byte_count(0), busy_time_ms(0.0), pending(false),
+    pending_read(false), pending_dev_address(0), pending_reg_addr(0), pending_reg_addr_size(0), pending_buf(NULL), pending_length(0), free_time_us(0), pending_generation(0) {
+  memset(&this->handle, 0, sizeof(this->handle));
+  memset(&this->instance, 0, sizeof(this->instance));
+  this->handle.Instance = &this->instance;
+  this->handle.State = HAL_I2C_STATE_READY;
+  _sim_i2c_buses.push_back(this);
+}
+
+SimI2CBus::SimI2CBus(I2C_HandleTypeDef& handle, uint32_t bit_rate, bool timed) : handle(handle), bit_rate(bit_rate), timed(timed), transfer_count(0), byte_count(0),
+    busy_time_ms(0.0), pending(false), pending_read(false), pending_dev_address(0), pending_reg_addr(0), pending_reg_addr_size(0), pending_buf(NULL), pending_length(0),
+    free_time_us(0), pending_generation(0) {
+  //keep the firmware's Init settings, only swap in the simulated peripheral
+  memset(&this->instance, 0, sizeof(this->instance));
+  this->handle.Instance = &this->instance;
+  _sim_i2c_buses.push_back(this);
+}
+
+SimI2CBus::~SimI2CBus() {
+  _sim_i2c_buses.erase(std::remove(_sim_i2c_buses.begin(), _sim_i2c_buses.end(), this), _sim_i2c_buses.end());
+}
+
+
+static SimI2CBus* _SimI2C_FindBus(I2C_HandleTypeDef* hi2c) {
+  for (auto bus : _sim_i2c_buses) {
+    if (&bus->handle == hi2c) {
+      return bus;
+    }
+  }
+  throw std::logic_error("SimI2C: HAL call with unknown I2C handle");
+}
+
+
+HAL_StatusTypeDef SimI2C_Transfer(I2C_HandleTypeDef* hi2c, bool read, uint16_t dev_address, uint16_t reg_addr, uint16_t reg_addr_size, uint8_t* buf, uint16_t length, bool interrupt) {
+  SimI2CBus* bus = _SimI2C_FindBus(hi2c);
+
+  if (hi2c->State != HAL_I2C_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (buf == NULL || length == 0) {
+    return HAL_ERROR;
+  }
+
+  double time_us = bus->AccountTransfer(read, reg_addr_size, length);
+  uint64_t end_time_us = 0;
+  if (bus->timed) {
+    bus->free_time_us = std::max(bus->free_time_us, SimTime_Now()) + (uint64_t)(time_us + 0.5);
+    end_time_us = bus->free_time_us;
+  }
+
+  if (!interrupt) {
+    //blocking: busy until the end of the transfer (interrupts keep running meanwhile), then done
+    hi2c->State = read ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+    if (bus->timed) {
+      SimTime_AdvanceTo(end_time_us);
+    }
+    bool success = bus->Execute(read, dev_address, reg_addr, reg_addr_size, buf, length);
+    hi2c->State = HAL_I2C_STATE_READY;
+    if (!success) {
+      hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+      return HAL_ERROR;
+    }
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    return HAL_OK;
+  }
+
+  //interrupt mode: remember the transfer for its completion - at the end of its bus time, or in SimI2C_Process
+  hi2c->State = read ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  bus->pending = true;
+  bus->pending_read = read;
+  bus->pending_dev_address = dev_address;
+  bus->pending_reg_addr = reg_addr;
+  bus->pending_reg_addr_size = reg_addr_size;
+  bus->pending_buf = buf;
+  bus->pending_length = length;
+
+  if (bus->timed) {
+    uint32_t generation = bus->pending_generation;
+    SimTime_Schedule(end_time_us - SimTime_Now(), [bus, generation]() {
+      if (bus->pending && bus->pending_generation == generation) {
+        bus->CompletePending();
+      }
+    });
+  }
+  return HAL_OK;
+}
+
+
+bool SimI2C_Process() {
+  for (auto bus : _sim_i2c_buses) {
+    if (bus->timed || !bus->pending) {
+      continue;
+    }
+
+    bus->CompletePending();
+    return true;
+  }
+
+  return false;
+}
+
+
+/*********************************************************/
+/*                  HAL I2C replacement                  */
+/*********************************************************/
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c) {
+  hi2c->State = HAL_I2C_STATE_READY;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c) {
+  //an aborted interrupt-mode transfer never completes
+  _SimI2C_FindBus(hi2c)->AbortPending();
+  hi2c->State = HAL_I2C_STATE_RESET;
+  return HAL_OK;
+}
+
+uint32_t HAL_I2C_GetError(const I2C_HandleTypeDef* hi2c) {
+  return hi2c->ErrorCode;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+  UNUSED(Timeout);
+  return SimI2C_Transfer(hi2c, true, DevAddress, MemAddress, MemAddSize, pData, Size, false);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+  UNUSED(Timeout);
+  return SimI2C_Transfer(hi2c, false, DevAddress, MemAddress, MemAddSize, pData, Size, false);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size) {
+  return SimI2C_Transfer(hi2c, true, DevAddress, MemAddress, MemAddSize, pData, Size, true);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size) {
+  return SimI2C_Transfer(hi2c, false, DevAddress, MemAddress, MemAddSize, pData, Size, true);
+}
@@ -0,0 +1,131 @@
+/*
+ * sim_i2c.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Simulated I2C buses for host builds of the controller: implements the HAL I2C functions used by I2CHardwareInterface
+ *  against register-file module stand-ins, with the framing and CRC-8 of the modules' register engine (ModuleShared).
+ *  Untimed buses complete interrupt-mode transfers when SimI2C_Process is called; timed buses (on the sim_time scheduler)
+ *  complete them after their bit-accurate bus time, blocking transfers take that time too. Both go through the usual HAL
+ *  completion callbacks.
+ */
+
+#ifndef SIM_I2C_H_
+#define SIM_I2C_H_
+
+
+#include "cpp_main.h"
+#include <vector>
+
+
+//CRC-8 of the module register protocol (polynomial 0x7F), continuing from the given state
+uint8_t SimI2C_CRC(const uint8_t* buf, uint16_t length, uint8_t state);
+
+//bit rate of an STM32H7 I2C peripheral with the given TIMINGR value and kernel clock, including the SCL sync delays
+uint32_t SimI2C_BitRate(uint32_t timingr, uint32_t kernel_clock_hz);
+
+
+//register-file module stand-in on a simulated bus - 8-bit register addresses, auto-increment over consecutive registers
+class SimI2CDevice {
+public:
+  const uint8_t address;
+  const bool uses_crc;
+  //register address size in HAL terms (I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT) - mismatching transfers are NACKed
+  const uint16_t reg_addr_size;
+  uint16_t reg_sizes[256];
+
+  //transfer statistics
+  uint32_t read_count;
+  uint32_t write_count;
+  uint32_t register_write_count;
+  uint32_t crc_error_count;
+
+  //number of upcoming transfers to NACK (simulated bus errors)
+  uint32_t nack_count;
+
+  uint8_t* Reg(uint8_t reg_addr);
+  uint8_t& Reg8(uint8_t reg_addr);
+  uint16_t& Reg16(uint8_t reg_addr);
+  uint32_t& Reg32(uint8_t reg_addr);
+
+  //handles a bus read of `length` bytes starting at the given register - returns false to NACK
+  virtual bool HandleRead(uint16_t reg_addr, uint8_t* buf, uint16_t length);
+  //handles a bus write of `length` bytes starting at the given register - returns false to NACK
+  virtual bool HandleWrite(uint16_t reg_addr, const uint8_t* buf, uint16_t length);
+
+  SimI2CDevice(uint8_t address, const uint16_t* reg_sizes, bool use_crc = true, uint16_t reg_addr_size = I2C_MEMADD_SIZE_8BIT);
+  virtual ~SimI2CDevice() = default;
+
+protected:
+  std::vector<uint8_t> data;
+  uint16_t data_offsets[256];
+
+  //called before a register is read by the controller, e.g. to update live values
+  virtual void OnRegisterRead(uint8_t reg_addr);
+  //applies a register write from the controller (CRC already checked) - returns false to reject it. Default: store the value
+  virtual bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value);
+};
+
+
+//simulated I2C bus with its HAL handle (own or external, e.g. the firmware's global handle)
+class SimI2CBus {
+public:
+  I2C_HandleTypeDef& handle;
+  I2C_TypeDef instance;
+
+  //bus bit rate in Hz, for the bus time
+  uint32_t bit_rate;
+  //whether transfers take their bus time on the sim_time scheduler (otherwise interrupt-mode transfers wait for SimI2C_Process)
+  const bool timed;
+
+  //transfer statistics: transfers and bytes on the wire (including address bytes), and the bus time they take
+  uint32_t transfer_count;
+  uint32_t byte_count;
+  double busy_time_ms;
+
+  void AddDevice(SimI2CDevice* device);
+  SimI2CDevice* FindDevice(uint8_t address);
+
+  //whether an interrupt-mode transfer is waiting for completion
+  bool IsPending() const;
+  //drops the pending interrupt-mode transfer without completion (peripheral de-initialised)
+  void AbortPending();
+
+  SimI2CBus(uint32_t bit_rate = 100000);
+  //bus on an external HAL handle, whose Instance is pointed to the simulated peripheral
+  SimI2CBus(I2C_HandleTypeDef& handle, uint32_t bit_rate, bool timed);
+  ~SimI2CBus();
+
+private:
+  friend bool SimI2C_Process();
+  friend HAL_StatusTypeDef SimI2C_Transfer(I2C_HandleTypeDef*, bool, uint16_t, uint16_t, uint16_t, uint8_t*, uint16_t, bool);
+
+  I2C_HandleTypeDef own_handle;
+  std::vector<SimI2CDevice*> devices;
+
+  //pending interrupt-mode transfer
+  bool pending;
+  bool pending_read;
+  uint16_t pending_dev_address;
+  uint16_t pending_reg_addr;
+  uint16_t pending_reg_addr_size;
+  uint8_t* pending_buf;
+  uint16_t pending_length;
+
+  //timed buses: simulated time (us) at which the bus becomes free, and the pending transfer generation (to drop aborted ones)
+  uint64_t free_time_us;
+  uint32_t pending_generation;
+
+  //bus time of a transfer in microseconds, and adds it to the statistics
+  double AccountTransfer(bool read, uint16_t reg_addr_size, uint16_t length);
+  bool Execute(bool read, uint16_t dev_address, uint16_t reg_addr, uint16_t reg_addr_size, uint8_t* buf, uint16_t length);
+  void CompletePending();
+};
+
+
+//completes one pending interrupt-mode transfer (of any untimed bus) through the HAL callbacks - returns whether there was one
+bool SimI2C_Process();
+
+
+#endif /* SIM_I2C_H_ */
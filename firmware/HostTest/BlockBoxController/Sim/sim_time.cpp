@@ -0,0 +1,87 @@
+/*
+ * sim_time.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ */
+
+
+#include "sim_time.h"
+#include "host_test.h"
+#include <map>
+
+
+static uint64_t _sim_time_us = 0;
+//scheduled events by due time - multimap keeps insertion order for equal times
+static std::multimap<uint64_t, std::function<void()>> _sim_events;
+//whether an event is running (events don't nest, like interrupts of equal priority)
+static bool _sim_in_event = false;
+
+
+static void _SimTime_SetNow(uint64_t time_us) {
+  _sim_time_us = time_us;
+  host_tick_ms = (uint32_t)(time_us / 1000);
+}
+
+//runs all events due at or before the current time, unless interrupts are disabled or an event is already running
+static void _SimTime_RunDueEvents() {
+  if (_sim_in_event) {
+    return;
+  }
+
+  _sim_in_event = true;
+  while (host_primask == 0 && !_sim_events.empty() && _sim_events.begin()->first <= _sim_time_us) {
+    auto item = _sim_events.begin();
+    std::function<void()> event = std::move(item->second);
+    _sim_events.erase(item);
+    event();
+  }
+  _sim_in_event = false;
+}
+
+
+static void _SimTime_TickHook() {
+  _SimTime_SetNow(_sim_time_us + SIMTIME_TICK_POLL_COST_US);
+  _SimTime_RunDueEvents();
+}
+
+static void _SimTime_AdvanceHook(uint32_t ms) {
+  SimTime_Advance((uint64_t)ms * 1000);
+}
+
+
+void SimTime_Install() {
+  _sim_events.clear();
+  _sim_in_event = false;
+  _SimTime_SetNow(0);
+  host_tick_hook = _SimTime_TickHook;
+  host_advance_hook = _SimTime_AdvanceHook;
+}
+
+uint64_t SimTime_Now() {
+  return _sim_time_us;
+}
+
+void SimTime_Schedule(uint64_t delay_us, std::function<void()>&& event) {
+  _sim_events.emplace(_sim_time_us + delay_us, std::move(event));
+}
+
+
+void SimTime_AdvanceTo(uint64_t time_us) {
+  //step from event to event, so that each event sees its own due time as the current time
+  while (!_sim_in_event && host_primask == 0 && !_sim_events.empty() && _sim_events.begin()->first <= time_us) {
+    if (_sim_events.begin()->first > _sim_time_us) {
+      _SimTime_SetNow(_sim_events.begin()->first);
+    }
+    _SimTime_RunDueEvents();
+  }
+
+  if (time_us > _sim_time_us) {
+    _SimTime_SetNow(time_us);
+  }
+  _SimTime_RunDueEvents();
+}
+
+void SimTime_Advance(uint64_t delay_us) {
+  SimTime_AdvanceTo(_sim_time_us + delay_us);
+}
@@ -0,0 +1,40 @@
+/*
+ * sim_time.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Microsecond time base and event scheduler for timed host simulations of the controller. Scheduled events stand for
+ *  interrupts: they run in time order whenever simulated time advances, but not while interrupts are disabled (PRIMASK set)
+ *  and not nested inside another event. Once installed, HAL_GetTick follows the simulated time, every HAL_GetTick call
+ *  costs a small fixed amount of time (so busy-wait loops make progress), and HAL_Delay advances the simulated time.
+ */
+
+#ifndef SIM_TIME_H_
+#define SIM_TIME_H_
+
+
+#include "cpp_main.h"
+#include <functional>
+
+
+//simulated time cost of one HAL_GetTick call, in microseconds (busy-wait loop iteration)
+#define SIMTIME_TICK_POLL_COST_US 1
+
+
+//installs the HAL time hooks and resets the simulated time to zero, dropping all scheduled events
+void SimTime_Install();
+
+//current simulated time in microseconds
+uint64_t SimTime_Now();
+
+//schedules an event (interrupt) after the given delay in microseconds - events at the same time run in scheduling order
+void SimTime_Schedule(uint64_t delay_us, std::function<void()>&& event);
+
+//advances the simulated time to the given absolute time, running the due events on the way (no-op if already past it)
+void SimTime_AdvanceTo(uint64_t time_us);
+//advances the simulated time by the given number of microseconds, running the due events on the way
+void SimTime_Advance(uint64_t delay_us);
+
+
+#endif /* SIM_TIME_H_ */
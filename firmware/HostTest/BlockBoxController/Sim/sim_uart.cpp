@@ -0,0 +1,401 @@
+/*
+ * sim_uart.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ */
+
+
+#include "sim_uart.h"
+#include "sim_time.h"
+#include "module_interface_uart.h"
+#include <algorithm>
+
+
+//all existing ports, to map HAL handles to ports
+static std::vector<SimUARTPort*> _sim_uart_ports;
+
+
+//CRC table of the module UART protocol, generated for polynomial 0x1FB7
+static uint16_t _sim_uart_crc_table[256];
+static bool _sim_uart_crc_table_ready = false;
+
+uint16_t SimUART_CRC(const uint8_t* buf, uint32_t length, uint16_t crc) {
+  if (!_sim_uart_crc_table_ready) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t value = (uint16_t)(i << 8);
+      for (int b = 0; b < 8; b++) {
+        value = (value & 0x8000) ? (uint16_t)((value << 1) ^ 0x1FB7) : (uint16_t)(value << 1);
+      }
+      _sim_uart_crc_table[i] = value;
+    }
+    _sim_uart_crc_table_ready = true;
+  }
+
+  for (uint32_t i = 0; i < length; i++) {
+    crc = (uint16_t)((crc << 8) ^ _sim_uart_crc_table[buf[i] ^ (uint8_t)(crc >> 8)]);
+  }
+  return crc;
+}
+
+
+/*********************************************************/
+/*                     Simulated Port                    */
+/*********************************************************/
+
+double SimUARTPort::ByteTimeUs() const {
+  return (double)SIMUART_BITS_PER_BYTE * 1000000.0 / (double)this->baud_rate;
+}
+
+
+void SimUARTPort::SendToController(const uint8_t* buf, uint16_t length) {
+  if (length == 0) {
+    return;
+  }
+
+  double time_us = (double)length * this->ByteTimeUs();
+  this->rx_byte_count += length;
+  this->rx_busy_time_ms += time_us / 1000.0;
+
+  //bytes become visible to the controller's receiver when they're completely on the line
+  this->rx_free_time_us = std::max(this->rx_free_time_us, SimTime_Now()) + (uint64_t)(time_us + 0.5);
+  std::vector<uint8_t> bytes(buf, buf + length);
+  SimTime_Schedule(this->rx_free_time_us - SimTime_Now(), [this, bytes = std::move(bytes)]() {
+    this->ReceiveBytes(bytes);
+  });
+}
+
+
+void SimUARTPort::ReceiveBytes(const std::vector<uint8_t>& bytes) {
+  for (uint8_t b : bytes) {
+    if (this->rx_buf == NULL || this->handle.RxState != HAL_UART_STATE_BUSY_RX) {
+      //receiver not running: byte lost (overrun)
+      this->rx_lost_count++;
+      continue;
+    }
+    this->rx_buf[this->rx_count++] = b;
+    if (this->rx_count >= this->rx_size) {
+      //buffer full: completes the reception right away (the callback usually restarts it)
+      this->CompleteReception();
+    }
+  }
+
+  //idle line: reported one character time after the last byte, unless more bytes follow
+  uint32_t generation = ++this->rx_generation;
+  SimTime_Schedule((uint64_t)(this->ByteTimeUs() + 0.5), [this, generation]() {
+    if (this->rx_generation == generation && this->rx_buf != NULL && this->handle.RxState == HAL_UART_STATE_BUSY_RX && this->rx_count > 0) {
+      this->CompleteReception();
+    }
+  });
+}
+
+void SimUARTPort::CompleteReception() {
+  uint16_t count = this->rx_count;
+  this->rx_buf = NULL;
+  this->rx_count = 0;
+  this->handle.RxState = HAL_UART_STATE_READY;
+  HAL_UARTEx_RxEventCallback(&this->handle, count);
+}
+
+
+SimUARTPort::SimUARTPort(UART_HandleTypeDef& handle, uint32_t baud_rate) : handle(handle), baud_rate(baud_rate), tx_byte_count(0), tx_busy_time_ms(0.0),
+    rx_byte_count(0), rx_busy_time_ms(0.0), rx_lost_count(0), tx_generation(0), tx_free_time_us(0), rx_buf(NULL), rx_size(0), rx_count(0), rx_generation(0),
+    rx_free_time_us(0) {
+  //keep the firmware's Init settings, only swap in the simulated peripheral
+  memset(&this->instance, 0, sizeof(this->instance));
+  this->handle.Instance = &this->instance;
+  this->handle.gState = HAL_UART_STATE_READY;
+  this->handle.RxState = HAL_UART_STATE_READY;
+  _sim_uart_ports.push_back(this);
+}
+
+SimUARTPort::~SimUARTPort() {
+  _sim_uart_ports.erase(std::remove(_sim_uart_ports.begin(), _sim_uart_ports.end(), this), _sim_uart_ports.end());
+}
+
+
+static SimUARTPort* _SimUART_FindPort(UART_HandleTypeDef* huart) {
+  for (auto port : _sim_uart_ports) {
+    if (&port->handle == huart) {
+      return port;
+    }
+  }
+  throw std::logic_error("SimUART: HAL call with unknown UART handle");
+}
+
+
+/*********************************************************/
+/*                  HAL UART replacement                 */
+/*********************************************************/
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size) {
+  SimUARTPort* port = _SimUART_FindPort(huart);
+
+  if (huart->gState != HAL_UART_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (pData == NULL || Size == 0) {
+    return HAL_ERROR;
+  }
+
+  //the hardware reads the buffer while sending, but the caller may free it on completion: take a copy at the start
+  port->tx_data.assign(pData, pData + Size);
+  huart->gState = HAL_UART_STATE_BUSY_TX;
+
+  double time_us = (double)Size * port->ByteTimeUs();
+  port->tx_byte_count += Size;
+  port->tx_busy_time_ms += time_us / 1000.0;
+  port->tx_free_time_us = std::max(port->tx_free_time_us, SimTime_Now()) + (uint64_t)(time_us + 0.5);
+
+  uint32_t generation = port->tx_generation;
+  SimTime_Schedule(port->tx_free_time_us - SimTime_Now(), [port, generation]() {
+    if (port->tx_generation != generation) {
+      //aborted
+      return;
+    }
+    std::vector<uint8_t> data = std::move(port->tx_data);
+    port->tx_data.clear();
+    port->handle.gState = HAL_UART_STATE_READY;
+    HAL_UART_TxCpltCallback(&port->handle);
+    if (port->on_controller_data) {
+      port->on_controller_data(data.data(), (uint16_t)data.size());
+    }
+  });
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size) {
+  SimUARTPort* port = _SimUART_FindPort(huart);
+
+  if (huart->RxState != HAL_UART_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (pData == NULL || Size == 0) {
+    return HAL_ERROR;
+  }
+
+  port->rx_buf = pData;
+  port->rx_size = Size;
+  port->rx_count = 0;
+  huart->RxState = HAL_UART_STATE_BUSY_RX;
+  huart->ReceptionType = HAL_UART_RECEPTION_TOIDLE;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef* huart) {
+  SimUARTPort* port = _SimUART_FindPort(huart);
+
+  //drops the transmission in progress and the current reception, without callbacks
+  port->tx_generation++;
+  port->tx_data.clear();
+  port->rx_generation++;
+  port->rx_buf = NULL;
+  port->rx_count = 0;
+  huart->gState = HAL_UART_STATE_READY;
+  huart->RxState = HAL_UART_STATE_READY;
+  huart->ErrorCode = HAL_UART_ERROR_NONE;
+  return HAL_OK;
+}
+
+
+/*********************************************************/
+/*                Simulated Register Device              */
+/*********************************************************/
+
+uint8_t* SimUARTRegDevice::Reg(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] == 0) {
+    throw std::invalid_argument("SimUARTRegDevice access to invalid register");
+  }
+  return this->data.data() + this->data_offsets[reg_addr];
+}
+
+uint8_t& SimUARTRegDevice::Reg8(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] != 1) {
+    throw std::invalid_argument("SimUARTRegDevice 8-bit access to invalid or differently-sized register");
+  }
+  return *this->Reg(reg_addr);
+}
+
+uint16_t& SimUARTRegDevice::Reg16(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] != 2) {
+    throw std::invalid_argument("SimUARTRegDevice 16-bit access to invalid or differently-sized register");
+  }
+  return *(uint16_t*)this->Reg(reg_addr);
+}
+
+uint32_t& SimUARTRegDevice::Reg32(uint8_t reg_addr) {
+  if (this->reg_sizes[reg_addr] != 4) {
+    throw std::invalid_argument("SimUARTRegDevice 32-bit access to invalid or differently-sized register");
+  }
+  return *(uint32_t*)this->Reg(reg_addr);
+}
+
+
+void SimUARTRegDevice::NotifyChange(uint8_t reg_addr) {
+  //mask bit X enables notifications for register 0x0X
+  if (reg_addr >= 16 || (this->Reg16(this->notif_mask_reg) & (1u << reg_addr)) == 0) {
+    return;
+  }
+
+  uint16_t length = this->GetValueLength(reg_addr);
+  const uint8_t* value = this->Reg(reg_addr);
+  std::vector<uint8_t> payload = { IF_UART_TYPE_CHANGE_NOTIFICATION, reg_addr };
+  payload.insert(payload.end(), value, value + length);
+  this->notification_count++;
+  this->SendFrame(std::move(payload), 0);
+}
+
+void SimUARTRegDevice::SendEvent(uint8_t event_type, const uint8_t* params, uint16_t params_length) {
+  std::vector<uint8_t> payload = { IF_UART_TYPE_EVENT, event_type };
+  if (params != NULL) {
+    payload.insert(payload.end(), params, params + params_length);
+  }
+  this->notification_count++;
+  this->SendFrame(std::move(payload), 0);
+}
+
+
+void SimUARTRegDevice::SendFrame(std::vector<uint8_t>&& payload, uint32_t delay_us) {
+  if (this->uses_crc) {
+    uint16_t crc = SimUART_CRC(payload.data(), payload.size(), 0);
+    payload.push_back((uint8_t)(crc >> 8));
+    payload.push_back((uint8_t)crc);
+  }
+
+  //link layer: start byte, escaped payload, end byte
+  std::vector<uint8_t> frame;
+  frame.reserve(payload.size() + 8);
+  frame.push_back(MODIF_UART_START_BYTE);
+  for (uint8_t b : payload) {
+    if (b == MODIF_UART_START_BYTE || b == MODIF_UART_END_BYTE || b == MODIF_UART_ESCAPE_BYTE) {
+      frame.push_back(MODIF_UART_ESCAPE_BYTE);
+    }
+    frame.push_back(b);
+  }
+  frame.push_back(MODIF_UART_END_BYTE);
+
+  if (delay_us == 0) {
+    this->port.SendToController(frame.data(), frame.size());
+  } else {
+    SimTime_Schedule(delay_us, [this, frame = std::move(frame)]() {
+      this->port.SendToController(frame.data(), frame.size());
+    });
+  }
+}
+
+
+uint16_t SimUARTRegDevice::GetValueLength(uint8_t reg_addr) {
+  return this->reg_sizes[reg_addr];
+}
+
+void SimUARTRegDevice::OnRegisterRead(uint8_t reg_addr) {
+  UNUSED(reg_addr);
+}
+
+bool SimUARTRegDevice::OnRegisterWrite(uint8_t reg_addr, const uint8_t* value, uint16_t length) {
+  uint8_t* reg = this->Reg(reg_addr);
+  memset(reg, 0, this->reg_sizes[reg_addr]);
+  memcpy(reg, value, length);
+  return true;
+}
+
+
+void SimUARTRegDevice::ReceiveData(const uint8_t* buf, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    uint8_t b = buf[i];
+    if (this->rx_escape_active) {
+      if (!this->rx_skip_to_start) {
+        this->parse_buffer.push_back(b);
+      }
+      this->rx_escape_active = false;
+    } else if (b == MODIF_UART_ESCAPE_BYTE) {
+      this->rx_escape_active = true;
+    } else if (b == MODIF_UART_START_BYTE) {
+      this->parse_buffer.clear();
+      this->rx_skip_to_start = false;
+    } else if (this->rx_skip_to_start) {
+      continue;
+    } else if (b == MODIF_UART_END_BYTE) {
+      this->HandleCommand();
+      this->parse_buffer.clear();
+      this->rx_skip_to_start = true;
+    } else {
+      this->parse_buffer.push_back(b);
+    }
+  }
+}
+
+void SimUARTRegDevice::HandleCommand() {
+  uint16_t crc_length = this->uses_crc ? 2 : 0;
+  uint16_t length = this->parse_buffer.size();
+  const uint8_t* cmd = this->parse_buffer.data();
+
+  //error event response, with the little-endian error code
+  auto error = [this](uint16_t code) {
+    std::vector<uint8_t> payload = { IF_UART_TYPE_EVENT, IF_UART_EVENT_ERROR, (uint8_t)code, (uint8_t)(code >> 8) };
+    this->SendFrame(std::move(payload), this->response_delay_us);
+  };
+
+  if (this->uses_crc && (length < crc_length || SimUART_CRC(cmd, length, 0) != 0)) {
+    this->crc_error_count++;
+    error(IF_UART_ERROR_UART_CRC_ERROR_REMOTE);
+    return;
+  }
+  if (length < 2 + crc_length) {
+    error(IF_UART_ERROR_UART_FORMAT_ERROR_REMOTE);
+    return;
+  }
+
+  uint8_t type = cmd[0];
+  uint8_t reg_addr = cmd[1];
+  uint16_t data_length = length - 2 - crc_length;
+  if (this->reg_sizes[reg_addr] == 0) {
+    error(IF_UART_ERROR_UART_COMMAND_NOT_ALLOWED);
+    return;
+  }
+
+  switch (type) {
+    case IF_UART_TYPE_READ:
+    {
+      this->read_count++;
+      this->OnRegisterRead(reg_addr);
+      uint16_t value_length = this->GetValueLength(reg_addr);
+      const uint8_t* value = this->Reg(reg_addr);
+      std::vector<uint8_t> payload = { IF_UART_TYPE_READ_DATA, reg_addr };
+      payload.insert(payload.end(), value, value + value_length);
+      this->SendFrame(std::move(payload), this->response_delay_us);
+      break;
+    }
+    case IF_UART_TYPE_WRITE:
+      this->write_count++;
+      if (data_length == 0 || data_length > this->reg_sizes[reg_addr]) {
+        error(IF_UART_ERROR_UART_FORMAT_ERROR_REMOTE);
+        break;
+      }
+      if (this->OnRegisterWrite(reg_addr, cmd + 2, data_length)) {
+        std::vector<uint8_t> payload = { IF_UART_TYPE_EVENT, IF_UART_EVENT_WRITE_ACK, reg_addr };
+        this->SendFrame(std::move(payload), this->response_delay_us);
+      }
+      break;
+    default:
+      error(IF_UART_ERROR_UART_FORMAT_ERROR_REMOTE);
+      break;
+  }
+}
+
+
+SimUARTRegDevice::SimUARTRegDevice(SimUARTPort& port, const uint16_t* reg_sizes, uint8_t notif_mask_reg, bool use_crc) :
+    port(port), uses_crc(use_crc), response_delay_us(1000), read_count(0), write_count(0), notification_count(0), crc_error_count(0),
+    notif_mask_reg(notif_mask_reg), rx_escape_active(false), rx_skip_to_start(true) {
+  uint32_t offset = 0;
+  for (int i = 0; i < 256; i++) {
+    this->reg_sizes[i] = reg_sizes[i];
+    this->data_offsets[i] = (uint16_t)offset;
+    offset += reg_sizes[i];
+  }
+  this->data.resize(offset);
+
+  this->port.on_controller_data = [this](const uint8_t* buf, uint16_t length) {
+    this->ReceiveData(buf, length);
+  };
+}
@@ -0,0 +1,136 @@
+/*
+ * sim_uart.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Simulated UART links for host builds of the controller, on the sim_time scheduler: implements the HAL UART functions used
+ *  by UARTModuleInterface (interrupt-mode transmit, receive-to-idle), with both directions taking their bit-accurate line time
+ *  (start + 8 data + stop bits per byte). Received data is reported one character time after the last byte, like the idle
+ *  line detection does. SimUARTRegDevice is a register-file module stand-in speaking the modules' framed UART protocol.
+ */
+
+#ifndef SIM_UART_H_
+#define SIM_UART_H_
+
+
+#include "cpp_main.h"
+#include <functional>
+#include <vector>
+
+
+//line bits per byte: start, 8 data, stop
+#define SIMUART_BITS_PER_BYTE 10
+
+
+//CRC-16 of the module UART protocol (polynomial 0x1FB7), continuing from the given state
+uint16_t SimUART_CRC(const uint8_t* buf, uint32_t length, uint16_t crc);
+
+
+//simulated UART link between a HAL handle (controller side) and a module stand-in
+class SimUARTPort {
+public:
+  UART_HandleTypeDef& handle;
+  USART_TypeDef instance;
+
+  const uint32_t baud_rate;
+
+  //called with the bytes of each completed controller transmission (module side reception)
+  std::function<void(const uint8_t* buf, uint16_t length)> on_controller_data;
+
+  //statistics per direction: bytes on the wire and the line time they take
+  uint32_t tx_byte_count;
+  double tx_busy_time_ms;
+  uint32_t rx_byte_count;
+  double rx_busy_time_ms;
+  //module-side bytes lost because the controller wasn't receiving
+  uint32_t rx_lost_count;
+
+  //line time of one byte, in microseconds
+  double ByteTimeUs() const;
+
+  //sends bytes from the module side to the controller, after any earlier module-side bytes
+  void SendToController(const uint8_t* buf, uint16_t length);
+
+  SimUARTPort(UART_HandleTypeDef& handle, uint32_t baud_rate);
+  ~SimUARTPort();
+
+private:
+  friend HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef*, const uint8_t*, uint16_t);
+  friend HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef*, uint8_t*, uint16_t);
+  friend HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef*);
+
+  //controller transmission in progress, with its generation (to drop aborted ones)
+  std::vector<uint8_t> tx_data;
+  uint32_t tx_generation;
+  uint64_t tx_free_time_us;
+
+  //controller reception: destination buffer, space, received count, and the receive generation (to detect the idle line)
+  uint8_t* rx_buf;
+  uint16_t rx_size;
+  uint16_t rx_count;
+  uint32_t rx_generation;
+  uint64_t rx_free_time_us;
+
+  void ReceiveBytes(const std::vector<uint8_t>& bytes);
+  void CompleteReception();
+};
+
+
+//register-file module stand-in on a simulated UART link - protocol framing, CRC, read data and write acknowledgements,
+//change notifications gated by the module's notification mask register
+class SimUARTRegDevice {
+public:
+  SimUARTPort& port;
+  const bool uses_crc;
+  uint16_t reg_sizes[256];
+
+  //module processing time between a received command and its response, in microseconds
+  uint32_t response_delay_us;
+
+  //statistics: commands handled, notifications and events sent
+  uint32_t read_count;
+  uint32_t write_count;
+  uint32_t notification_count;
+  uint32_t crc_error_count;
+
+  uint8_t* Reg(uint8_t reg_addr);
+  uint8_t& Reg8(uint8_t reg_addr);
+  uint16_t& Reg16(uint8_t reg_addr);
+  uint32_t& Reg32(uint8_t reg_addr);
+
+  //sends a change notification for the given register, if enabled in the notification mask
+  void NotifyChange(uint8_t reg_addr);
+  //sends an event notification with the given event type and parameter bytes
+  void SendEvent(uint8_t event_type, const uint8_t* params = NULL, uint16_t params_length = 0);
+
+  SimUARTRegDevice(SimUARTPort& port, const uint16_t* reg_sizes, uint8_t notif_mask_reg, bool use_crc = true);
+  virtual ~SimUARTRegDevice() = default;
+
+protected:
+  std::vector<uint8_t> data;
+  uint16_t data_offsets[256];
+  const uint8_t notif_mask_reg;
+
+  //sends a protocol frame (payload without CRC and framing) to the controller after the response delay
+  void SendFrame(std::vector<uint8_t>&& payload, uint32_t delay_us);
+
+  //number of bytes sent for a register in read data and notifications - default: full register size
+  virtual uint16_t GetValueLength(uint8_t reg_addr);
+  //called before a register is read by the controller, e.g. to update live values
+  virtual void OnRegisterRead(uint8_t reg_addr);
+  //applies a register write from the controller - returns whether to acknowledge it. Default: store the value, acknowledge
+  virtual bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value, uint16_t length);
+
+private:
+  //link layer decoding state
+  std::vector<uint8_t> parse_buffer;
+  bool rx_escape_active;
+  bool rx_skip_to_start;
+
+  void ReceiveData(const uint8_t* buf, uint16_t length);
+  void HandleCommand();
+};
+
+
+#endif /* SIM_UART_H_ */
@@ -0,0 +1,466 @@
+/*
+ * sim_modules.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ */
+
+
+#include "sim_modules.h"
+#include "sim_time.h"
+
+
+//register sizes of the stand-ins
+static const uint16_t _simmod_dap_reg_sizes[256] = I2CDEF_DAP_REG_SIZES;
+static const uint16_t _simmod_hifidac_reg_sizes[256] = I2CDEF_HIFIDAC_REG_SIZES;
+static const uint16_t _simmod_poweramp_reg_sizes[256] = I2CDEF_POWERAMP_REG_SIZES;
+static const uint16_t _simmod_rtc_reg_sizes[256] = I2CDEF_RTC_REG_SIZES;
+static const uint16_t _simmod_chg_reg_sizes[256] = I2CDEF_CHG_REG_SIZES;
+static const uint16_t _simmod_btrx_reg_sizes[256] = UARTDEF_BTRX_REG_SIZES;
+static const uint16_t _simmod_bms_reg_sizes[256] = UARTDEF_BMS_REG_SIZES;
+//EEPROM: no registers, memory accesses only
+static const uint16_t _simmod_eeprom_reg_sizes[256] = { 0 };
+
+
+static uint8_t _SimMod_ToBCD(uint32_t value) {
+  return (uint8_t)(((value / 10) << 4) | (value % 10));
+}
+
+static uint32_t _SimMod_FromBCD(uint8_t bcd) {
+  return (bcd >> 4) * 10 + (bcd & 0xF);
+}
+
+
+/*********************************************************/
+/*                  Interrupt I2C module                 */
+/*********************************************************/
+
+void SimIntModule::Raise(uint8_t flags) {
+  flags &= this->Reg8(MODIF_I2C_INT_MASK_REG) | MODIF_I2C_INT_RESET_FLAG;
+  this->Reg8(MODIF_I2C_INT_FLAGS_REG) |= flags;
+  this->UpdateLine();
+}
+
+void SimIntModule::SavePowerUpState() {
+  this->power_up_data = this->data;
+}
+
+
+void SimIntModule::UpdateLine() {
+  bool was_high = (this->int_port->IDR & this->int_pin) != 0;
+  if (!this->booting && this->Reg8(MODIF_I2C_INT_FLAGS_REG) != 0) {
+    this->int_port->IDR &= ~(uint32_t)this->int_pin;
+    if (was_high) {
+      //falling edge: EXTI
+      HAL_GPIO_EXTI_Callback(this->int_pin);
+    }
+  } else {
+    this->int_port->IDR |= this->int_pin;
+  }
+}
+
+
+bool SimIntModule::HandleRead(uint16_t reg_addr, uint8_t* buf, uint16_t length) {
+  if (this->booting) {
+    return false;
+  }
+  return this->SimI2CDevice::HandleRead(reg_addr, buf, length);
+}
+
+bool SimIntModule::HandleWrite(uint16_t reg_addr, const uint8_t* buf, uint16_t length) {
+  if (this->booting) {
+    return false;
+  }
+  return this->SimI2CDevice::HandleWrite(reg_addr, buf, length);
+}
+
+bool SimIntModule::OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) {
+  this->last_write_us[reg_addr] = SimTime_Now();
+  this->last_any_write_us = SimTime_Now();
+
+  if (reg_addr == MODIF_I2C_INT_FLAGS_REG) {
+    //write-zero-to-clear
+    this->Reg8(reg_addr) &= *value;
+    this->UpdateLine();
+    return true;
+  }
+
+  if (reg_addr == this->control_reg && (*value >> 4) == 0xA) {
+    //software reset: registers back to their power-up state, unresponsive until booted, then the reset flag
+    this->reset_count++;
+    this->data = this->power_up_data;
+    this->booting = true;
+    this->UpdateLine();
+    SimTime_Schedule(this->boot_time_us, [this]() {
+      this->booting = false;
+      this->Raise(MODIF_I2C_INT_RESET_FLAG);
+    });
+    return true;
+  }
+
+  return this->SimI2CDevice::OnRegisterWrite(reg_addr, value);
+}
+
+
+SimIntModule::SimIntModule(uint8_t address, const uint16_t* reg_sizes, uint8_t control_reg, GPIO_TypeDef* int_port, uint16_t int_pin, uint32_t boot_time_us) :
+    SimI2CDevice(address, reg_sizes, true), int_port(int_port), int_pin(int_pin), control_reg(control_reg), boot_time_us(boot_time_us), reset_count(0),
+    last_any_write_us(0), booting(false) {
+  memset(this->last_write_us, 0, sizeof(this->last_write_us));
+  this->int_port->IDR |= this->int_pin;
+}
+
+
+SimDAPModule::SimDAPModule(uint8_t address, GPIO_TypeDef* int_port, uint16_t int_pin) :
+    SimIntModule(address, _simmod_dap_reg_sizes, I2CDEF_DAP_CONTROL, int_port, int_pin, SIMMOD_DAP_BOOT_TIME_US) {
+  this->Reg8(I2CDEF_DAP_MODULE_ID) = I2CDEF_DAP_MODULE_ID_VALUE;
+  this->SavePowerUpState();
+}
+
+SimHiFiDACModule::SimHiFiDACModule(uint8_t address, GPIO_TypeDef* int_port, uint16_t int_pin) :
+    SimIntModule(address, _simmod_hifidac_reg_sizes, I2CDEF_HIFIDAC_CONTROL, int_port, int_pin, SIMMOD_HIFIDAC_BOOT_TIME_US) {
+  this->Reg8(I2CDEF_HIFIDAC_MODULE_ID) = I2CDEF_HIFIDAC_MODULE_ID_VALUE;
+  this->SavePowerUpState();
+}
+
+
+SimPowerAmpModule::SimPowerAmpModule(uint8_t address, GPIO_TypeDef* int_port, uint16_t int_pin) :
+    SimIntModule(address, _simmod_poweramp_reg_sizes, I2CDEF_POWERAMP_CONTROL, int_port, int_pin, SIMMOD_POWERAMP_BOOT_TIME_US) {
+  float pvdd = IF_POWERAMP_PVDD_TARGET_MAX;
+  this->Reg8(I2CDEF_POWERAMP_MODULE_ID) = I2CDEF_POWERAMP_MODULE_ID_VALUE;
+  memcpy(this->Reg(I2CDEF_POWERAMP_PVDD_TARGET), &pvdd, sizeof(float));
+  memcpy(this->Reg(I2CDEF_POWERAMP_PVDD_REQ), &pvdd, sizeof(float));
+  memcpy(this->Reg(I2CDEF_POWERAMP_PVDD_MEASURED), &pvdd, sizeof(float));
+  //PVDD stays valid throughout, since it follows its target right away
+  this->Reg16(I2CDEF_POWERAMP_STATUS) = I2CDEF_POWERAMP_STATUS_PVDD_VALID_Msk;
+  this->SavePowerUpState();
+}
+
+bool SimPowerAmpModule::OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) {
+  if (reg_addr != I2CDEF_POWERAMP_PVDD_TARGET) {
+    return this->SimIntModule::OnRegisterWrite(reg_addr, value);
+  }
+
+  float prev_target, target;
+  memcpy(&prev_target, this->Reg(I2CDEF_POWERAMP_PVDD_TARGET), sizeof(float));
+  memcpy(&target, value, sizeof(float));
+  if (!this->SimIntModule::OnRegisterWrite(reg_addr, value)) {
+    return false;
+  }
+
+  //PVDD follows the target; a reduction is reported as done once settled
+  memcpy(this->Reg(I2CDEF_POWERAMP_PVDD_REQ), &target, sizeof(float));
+  memcpy(this->Reg(I2CDEF_POWERAMP_PVDD_MEASURED), &target, sizeof(float));
+  if (target < prev_target) {
+    SimTime_Schedule(SIMMOD_POWERAMP_PVDD_REDUCTION_TIME_US, [this]() {
+      this->Raise(I2CDEF_POWERAMP_INT_FLAGS_INT_PVDD_REDDONE_Msk);
+    });
+  }
+  return true;
+}
+
+
+/*********************************************************/
+/*                         EEPROM                        */
+/*********************************************************/
+
+SimEEPROM::SimEEPROM(uint8_t address) : SimI2CDevice(address, _simmod_eeprom_reg_sizes, false, I2C_MEMADD_SIZE_16BIT) {
+  memset(this->memory, 0xFF, sizeof(this->memory));
+}
+
+bool SimEEPROM::HandleRead(uint16_t reg_addr, uint8_t* buf, uint16_t length) {
+  this->read_count++;
+  //sequential reads roll over at the end of the memory
+  for (uint16_t i = 0; i < length; i++) {
+    buf[i] = this->memory[(reg_addr + i) % SIMMOD_EEPROM_SIZE];
+  }
+  return true;
+}
+
+bool SimEEPROM::HandleWrite(uint16_t reg_addr, const uint8_t* buf, uint16_t length) {
+  this->write_count++;
+  //page writes wrap around within the page
+  uint16_t page_start = (reg_addr % SIMMOD_EEPROM_SIZE) & ~(SIMMOD_EEPROM_PAGE_SIZE - 1);
+  for (uint16_t i = 0; i < length; i++) {
+    this->memory[page_start + ((reg_addr + i) % SIMMOD_EEPROM_PAGE_SIZE)] = buf[i];
+  }
+  return true;
+}
+
+
+/*********************************************************/
+/*                          RTC                          */
+/*********************************************************/
+
+SimRTC::SimRTC(uint8_t address, uint8_t year, uint8_t month, uint8_t date, uint8_t hours, uint8_t minutes, uint8_t seconds) :
+    SimI2CDevice(address, _simmod_rtc_reg_sizes, false), time_base_us(SimTime_Now()) {
+  this->Reg8(I2CDEF_RTC_SECONDS) = _SimMod_ToBCD(seconds);
+  this->Reg8(I2CDEF_RTC_MINUTES) = _SimMod_ToBCD(minutes);
+  this->Reg8(I2CDEF_RTC_HOURS) = _SimMod_ToBCD(hours);
+  this->Reg8(I2CDEF_RTC_WEEKDAY) = 1;
+  this->Reg8(I2CDEF_RTC_DAY) = _SimMod_ToBCD(date);
+  this->Reg8(I2CDEF_RTC_MONTH) = _SimMod_ToBCD(month);
+  this->Reg8(I2CDEF_RTC_YEAR) = _SimMod_ToBCD(year);
+}
+
+void SimRTC::UpdateTime() {
+  uint64_t elapsed_s = (SimTime_Now() - this->time_base_us) / 1000000;
+  if (elapsed_s == 0) {
+    return;
+  }
+  this->time_base_us += elapsed_s * 1000000;
+
+  //24-hour mode only, the day doesn't roll over
+  uint8_t hours_reg = this->Reg8(I2CDEF_RTC_HOURS);
+  uint32_t hours = _SimMod_FromBCD(hours_reg & (I2CDEF_RTC_HOURS_ONES_Msk | I2CDEF_RTC_HOURS_TENS_Msk)) + (((hours_reg & I2CDEF_RTC_HOURS_20H_PM_Msk) != 0) ? 20 : 0);
+  uint64_t day_s = hours * 3600 + _SimMod_FromBCD(this->Reg8(I2CDEF_RTC_MINUTES)) * 60 + _SimMod_FromBCD(this->Reg8(I2CDEF_RTC_SECONDS)) + elapsed_s;
+  day_s %= 86400;
+
+  hours = (uint32_t)(day_s / 3600);
+  this->Reg8(I2CDEF_RTC_SECONDS) = _SimMod_ToBCD((uint32_t)(day_s % 60));
+  this->Reg8(I2CDEF_RTC_MINUTES) = _SimMod_ToBCD((uint32_t)((day_s / 60) % 60));
+  this->Reg8(I2CDEF_RTC_HOURS) = (hours >= 20) ? (_SimMod_ToBCD(hours - 20) | I2CDEF_RTC_HOURS_20H_PM_Msk) : _SimMod_ToBCD(hours);
+}
+
+void SimRTC::OnRegisterRead(uint8_t reg_addr) {
+  if (reg_addr == I2CDEF_RTC_SECONDS) {
+    this->UpdateTime();
+  }
+}
+
+bool SimRTC::OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) {
+  if (reg_addr == I2CDEF_RTC_SECONDS) {
+    //setting the time restarts the second
+    this->time_base_us = SimTime_Now();
+  }
+  return this->SimI2CDevice::OnRegisterWrite(reg_addr, value);
+}
+
+
+/*********************************************************/
+/*                        Charger                        */
+/*********************************************************/
+
+SimCharger::SimCharger(uint8_t address, GPIO_TypeDef* acok_port, uint16_t acok_pin, bool adapter_present) :
+    SimI2CDevice(address, _simmod_chg_reg_sizes, false), acok_port(acok_port), acok_pin(acok_pin) {
+  this->Reg16(I2CDEF_CHG_MFR_ID) = 0x0040;
+  this->Reg16(I2CDEF_CHG_DEV_ID) = I2CDEF_CHG_DEV_ID_VALUE;
+  if (adapter_present) {
+    this->acok_port->IDR |= this->acok_pin;
+  } else {
+    this->acok_port->IDR &= ~(uint32_t)this->acok_pin;
+  }
+}
+
+void SimCharger::SetAdapterPresent(bool present) {
+  bool was_present = (this->acok_port->IDR & this->acok_pin) != 0;
+  if (present == was_present) {
+    return;
+  }
+  if (present) {
+    this->acok_port->IDR |= this->acok_pin;
+  } else {
+    this->acok_port->IDR &= ~(uint32_t)this->acok_pin;
+  }
+  HAL_GPIO_EXTI_Callback(this->acok_pin);
+}
+
+
+/*********************************************************/
+/*                   Bluetooth receiver                  */
+/*********************************************************/
+
+void SimBluetoothReceiver::ConnectPhone() {
+  static const uint8_t device_addr[6] = { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC };
+  memcpy(this->Reg(UARTDEF_BTRX_DEVICE_ADDR), device_addr, sizeof(device_addr));
+  strcpy((char*)this->Reg(UARTDEF_BTRX_DEVICE_NAME), "Sim Phone");
+  strcpy((char*)this->Reg(UARTDEF_BTRX_CODEC), "AAC");
+  strcpy((char*)this->Reg(UARTDEF_BTRX_TITLE), "Sim Title");
+  strcpy((char*)this->Reg(UARTDEF_BTRX_ARTIST), "Sim Artist");
+  strcpy((char*)this->Reg(UARTDEF_BTRX_ALBUM), "Sim Album");
+  this->Reg32(UARTDEF_BTRX_CONN_STATS) = (uint32_t)(uint16_t)-50 | (200u << 16);
+
+  this->SetStatusBits(UARTDEF_BTRX_STATUS_CONNECTED_Msk | UARTDEF_BTRX_STATUS_A2DP_LINK_Msk | UARTDEF_BTRX_STATUS_AVRCP_LINK_Msk |
+                      UARTDEF_BTRX_STATUS_A2DP_STREAMING_Msk | UARTDEF_BTRX_STATUS_AVRCP_PLAYING_Msk, 0);
+  this->NotifyChange(UARTDEF_BTRX_DEVICE_ADDR);
+  this->NotifyChange(UARTDEF_BTRX_DEVICE_NAME);
+  this->NotifyChange(UARTDEF_BTRX_CODEC);
+  this->NotifyChange(UARTDEF_BTRX_TITLE);
+  this->NotifyChange(UARTDEF_BTRX_ARTIST);
+  this->NotifyChange(UARTDEF_BTRX_ALBUM);
+  this->NotifyChange(UARTDEF_BTRX_CONN_STATS);
+}
+
+void SimBluetoothReceiver::SetPhoneVolume(uint8_t volume) {
+  this->Reg8(UARTDEF_BTRX_VOLUME) = volume;
+  this->NotifyChange(UARTDEF_BTRX_VOLUME);
+}
+
+
+void SimBluetoothReceiver::ResetRegisters() {
+  std::fill(this->data.begin(), this->data.end(), 0);
+  this->Reg16(UARTDEF_BTRX_NOTIF_MASK) = UARTDEF_BTRX_NOTIF_MASK_DEFAULT_VALUE;
+  this->Reg8(UARTDEF_BTRX_VOLUME) = 64;
+  this->Reg8(UARTDEF_BTRX_MODULE_ID) = UARTDEF_BTRX_MODULE_ID_VALUE;
+}
+
+void SimBluetoothReceiver::SetStatusBits(uint16_t set, uint16_t clear) {
+  uint16_t status = (uint16_t)((this->Reg16(UARTDEF_BTRX_STATUS) & ~clear) | set);
+  if (status != this->Reg16(UARTDEF_BTRX_STATUS)) {
+    this->Reg16(UARTDEF_BTRX_STATUS) = status;
+    this->NotifyChange(UARTDEF_BTRX_STATUS);
+  }
+}
+
+
+uint16_t SimBluetoothReceiver::GetValueLength(uint8_t reg_addr) {
+  switch (reg_addr) {
+    case UARTDEF_BTRX_TITLE:
+    case UARTDEF_BTRX_ARTIST:
+    case UARTDEF_BTRX_ALBUM:
+    case UARTDEF_BTRX_DEVICE_NAME:
+    case UARTDEF_BTRX_CODEC:
+      //text: up to and including the terminator
+      return (uint16_t)strnlen((const char*)this->Reg(reg_addr), this->reg_sizes[reg_addr] - 1) + 1;
+    default:
+      return this->SimUARTRegDevice::GetValueLength(reg_addr);
+  }
+}
+
+bool SimBluetoothReceiver::OnRegisterWrite(uint8_t reg_addr, const uint8_t* value, uint16_t length) {
+  switch (reg_addr) {
+    case UARTDEF_BTRX_CONTROL:
+      if ((value[0] >> UARTDEF_BTRX_CONTROL_RESET_Pos) == UARTDEF_BTRX_CONTROL_RESET_VALUE) {
+        //software reset: no acknowledgement, MCU reset event, Bluetooth reset event, Bluetooth init done later
+        uint32_t generation = ++this->reset_generation;
+        this->reset_count++;
+        this->ResetRegisters();
+        SimTime_Schedule(SIMMOD_BTRX_MCU_RESET_TIME_US, [this, generation]() {
+          if (generation == this->reset_generation) {
+            this->SendEvent(UARTDEF_BTRX_EVENT_MCU_RESET);
+          }
+        });
+        SimTime_Schedule(SIMMOD_BTRX_BT_RESET_TIME_US, [this, generation]() {
+          if (generation == this->reset_generation) {
+            this->SendEvent(UARTDEF_BTRX_EVENT_BT_RESET);
+          }
+        });
+        SimTime_Schedule(SIMMOD_BTRX_INIT_DONE_TIME_US, [this, generation]() {
+          if (generation == this->reset_generation) {
+            this->SetStatusBits(UARTDEF_BTRX_STATUS_INIT_DONE_Msk | UARTDEF_BTRX_STATUS_CONNECTABLE_Msk, 0);
+          }
+        });
+        return false;
+      }
+      return this->SimUARTRegDevice::OnRegisterWrite(reg_addr, value, length);
+    case UARTDEF_BTRX_CONN_CONTROL:
+    {
+      //connection control: applied to the status, reads as zero
+      uint16_t set = 0, clear = 0;
+      if ((value[0] & UARTDEF_BTRX_CONN_CONTROL_CONNECTABLE_ON_Msk) != 0) set |= UARTDEF_BTRX_STATUS_CONNECTABLE_Msk;
+      if ((value[0] & UARTDEF_BTRX_CONN_CONTROL_CONNECTABLE_OFF_Msk) != 0) clear |= UARTDEF_BTRX_STATUS_CONNECTABLE_Msk;
+      if ((value[0] & UARTDEF_BTRX_CONN_CONTROL_DISCOVERABLE_ON_Msk) != 0) set |= UARTDEF_BTRX_STATUS_DISCOVERABLE_Msk;
+      if ((value[0] & UARTDEF_BTRX_CONN_CONTROL_DISCOVERABLE_OFF_Msk) != 0) clear |= UARTDEF_BTRX_STATUS_DISCOVERABLE_Msk;
+      if ((value[0] & UARTDEF_BTRX_CONN_CONTROL_DISCONNECT_Msk) != 0) {
+        clear |= UARTDEF_BTRX_STATUS_CONNECTED_Msk | UARTDEF_BTRX_STATUS_A2DP_LINK_Msk | UARTDEF_BTRX_STATUS_AVRCP_LINK_Msk |
+                 UARTDEF_BTRX_STATUS_A2DP_STREAMING_Msk | UARTDEF_BTRX_STATUS_AVRCP_PLAYING_Msk;
+      }
+      this->SetStatusBits(set, clear);
+      return true;
+    }
+    case UARTDEF_BTRX_VOLUME:
+      this->last_volume_write_us = SimTime_Now();
+      return this->SimUARTRegDevice::OnRegisterWrite(reg_addr, value, length);
+    default:
+      return this->SimUARTRegDevice::OnRegisterWrite(reg_addr, value, length);
+  }
+}
+
+
+SimBluetoothReceiver::SimBluetoothReceiver(SimUARTPort& port) :
+    SimUARTRegDevice(port, _simmod_btrx_reg_sizes, UARTDEF_BTRX_NOTIF_MASK, IF_BTRX_USE_CRC), reset_count(0), last_volume_write_us(0),
+    reset_generation(0) {
+  this->ResetRegisters();
+}
+
+
+/*********************************************************/
+/*                    Battery monitor                    */
+/*********************************************************/
+
+void SimBatteryMonitor::Start() {
+  SimTime_Schedule(SIMMOD_BMS_MEASUREMENT_PERIOD_US, [this]() {
+    this->UpdateMeasurements();
+    if (this->measurement_count % (SIMMOD_BMS_TEMPERATURE_PERIOD_US / SIMMOD_BMS_MEASUREMENT_PERIOD_US) == 0) {
+      this->UpdateTemperatures();
+    }
+    this->Start();
+  });
+}
+
+
+void SimBatteryMonitor::SetAndNotify(uint8_t reg_addr, const void* value) {
+  if (memcmp(this->Reg(reg_addr), value, this->reg_sizes[reg_addr]) == 0) {
+    return;
+  }
+  memcpy(this->Reg(reg_addr), value, this->reg_sizes[reg_addr]);
+  this->NotifyChange(reg_addr);
+}
+
+void SimBatteryMonitor::UpdateMeasurements() {
+  this->measurement_count++;
+
+  //discharge current wandering around 1.5A (or the set charge current), taken out of (or added to) the stored energy; the cells
+  //follow it a little
+  int32_t current_mA = (this->charge_current_mA != 0) ? this->charge_current_mA : -1500 + (int32_t)((this->measurement_count * 37) % 200) - 100;
+  this->soc_energy_wh += (double)current_mA / 1000.0 * 18.0 * ((double)SIMMOD_BMS_MEASUREMENT_PERIOD_US / 3.6e9);
+  float soc_fraction = (float)(this->soc_energy_wh / 100.0);
+  int16_t cell_mV = (int16_t)(3000 + 1100 * soc_fraction + current_mA / 20);
+
+  int16_t cells[5];
+  for (int i = 0; i < 5; i++) {
+    cells[i] = (int16_t)(cell_mV + i);
+  }
+  uint16_t stack_mV = 0;
+  for (int16_t cell : cells) {
+    stack_mV += (uint16_t)cell;
+  }
+
+  uint8_t soc[5];
+  float soc_energy = (float)this->soc_energy_wh;
+  memcpy(soc, &soc_fraction, sizeof(float));
+  soc[4] = 0x02;
+
+  this->SetAndNotify(UARTDEF_BMS_CURRENT, &current_mA);
+  this->SetAndNotify(UARTDEF_BMS_CELL_VOLTAGES, cells);
+  this->SetAndNotify(UARTDEF_BMS_STACK_VOLTAGE, &stack_mV);
+  this->SetAndNotify(UARTDEF_BMS_SOC_FRACTION, soc);
+  memcpy(soc, &soc_energy, sizeof(float));
+  this->SetAndNotify(UARTDEF_BMS_SOC_ENERGY, soc);
+}
+
+void SimBatteryMonitor::UpdateTemperatures() {
+  int16_t bat_temp = 25, int_temp = 30;
+  this->SetAndNotify(UARTDEF_BMS_BAT_TEMP, &bat_temp);
+  this->SetAndNotify(UARTDEF_BMS_INT_TEMP, &int_temp);
+}
+
+
+SimBatteryMonitor::SimBatteryMonitor(SimUARTPort& port) :
+    SimUARTRegDevice(port, _simmod_bms_reg_sizes, UARTDEF_BMS_NOTIF_MASK, IF_BMS_USE_CRC), charge_current_mA(0), measurement_count(0), soc_energy_wh(60.0) {
+  //5s1p pack of 3.0-4.2V cells, 100Wh
+  this->Reg8(UARTDEF_BMS_MODULE_ID) = UARTDEF_BMS_MODULE_ID_VALUE;
+  this->Reg8(UARTDEF_BMS_CELLS_SERIES) = 5;
+  this->Reg8(UARTDEF_BMS_CELLS_PARALLEL) = 1;
+  this->Reg16(UARTDEF_BMS_MIN_VOLTAGE) = 3000;
+  this->Reg16(UARTDEF_BMS_MAX_VOLTAGE) = 4200;
+  this->Reg32(UARTDEF_BMS_MAX_DSG_CURRENT) = 10000;
+  this->Reg32(UARTDEF_BMS_PEAK_DSG_CURRENT) = 20000;
+  this->Reg32(UARTDEF_BMS_MAX_CHG_CURRENT) = 5000;
+  this->Reg16(UARTDEF_BMS_NOTIF_MASK) = 0x0C00;
+
+  float health = 0.95f;
+  memcpy(this->Reg(UARTDEF_BMS_HEALTH), &health, sizeof(float));
+  this->UpdateMeasurements();
+  this->UpdateTemperatures();
+  this->measurement_count = 0;
+}
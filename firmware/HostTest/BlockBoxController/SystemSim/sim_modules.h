@@ -0,0 +1,206 @@
+/*
+ * sim_modules.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Module stand-ins of the system simulation, built on the modules' own register definitions (i2c_defines_*, uart_defines_*):
+ *  the I2C modules with interrupt lines and software reset (DAP, HiFiDAC, PowerAmp), the EEPROM, the RTC and the charger,
+ *  and the UART modules (Bluetooth receiver, BMS). They model what the controller sees on the buses - register contents,
+ *  reset and boot sequences, change notifications - not the modules' internal behaviour. Boot and processing times are
+ *  assumptions taken from the module firmwares' startup delays; they are listed with each stand-in.
+ */
+
+#ifndef SIM_MODULES_H_
+#define SIM_MODULES_H_
+
+
+#include "sim_i2c.h"
+#include "sim_uart.h"
+#include "dap_interface.h"
+#include "hifidac_interface.h"
+#include "power_amp_interface.h"
+#include "bluetooth_receiver_interface.h"
+#include "battery_interface.h"
+#include "i2c_defines_charger.h"
+#include "i2c_defines_rtc.h"
+
+
+//assumed module boot times after a software reset, from the module firmwares' startup delays
+#define SIMMOD_DAP_BOOT_TIME_US 20000
+#define SIMMOD_HIFIDAC_BOOT_TIME_US 60000
+#define SIMMOD_POWERAMP_BOOT_TIME_US 40000
+
+//assumed time for the PowerAmp to settle PVDD on a lowered target, before it reports the reduction as done
+#define SIMMOD_POWERAMP_PVDD_REDUCTION_TIME_US 100000
+
+//assumed Bluetooth receiver reset sequence: MCU restart, Bluetooth module restart, Bluetooth init done
+#define SIMMOD_BTRX_MCU_RESET_TIME_US 50000
+#define SIMMOD_BTRX_BT_RESET_TIME_US 200000
+#define SIMMOD_BTRX_INIT_DONE_TIME_US 1500000
+
+//BMS notification periods of measurements and temperatures
+#define SIMMOD_BMS_MEASUREMENT_PERIOD_US 1000000
+#define SIMMOD_BMS_TEMPERATURE_PERIOD_US 2000000
+
+//EEPROM size and page size (24xx32-type, 16-bit addresses)
+#define SIMMOD_EEPROM_SIZE 4096
+#define SIMMOD_EEPROM_PAGE_SIZE 32
+
+
+/*********************************************************/
+/*                      I2C modules                      */
+/*********************************************************/
+
+//I2C module with the standard interrupt registers and a software reset through its CONTROL register: raised flags pull the
+//active-low interrupt line (and trigger its EXTI on the falling edge); a reset restores the power-up register contents and
+//raises the reset flag after the boot time
+class SimIntModule : public SimI2CDevice {
+public:
+  GPIO_TypeDef* const int_port;
+  const uint16_t int_pin;
+  const uint8_t control_reg;
+  const uint32_t boot_time_us;
+
+  uint32_t reset_count;
+  //simulated time (us) of the last controller write per register, and overall
+  uint64_t last_write_us[256];
+  uint64_t last_any_write_us;
+
+  //raises the given flags (masked like the modules do, except for the reset flag)
+  void Raise(uint8_t flags);
+  //saves the current register contents as the power-up state restored by resets
+  void SavePowerUpState();
+
+  SimIntModule(uint8_t address, const uint16_t* reg_sizes, uint8_t control_reg, GPIO_TypeDef* int_port, uint16_t int_pin, uint32_t boot_time_us);
+
+protected:
+  std::vector<uint8_t> power_up_data;
+  //whether the module is booting after a reset (NACKs everything)
+  bool booting;
+
+  void UpdateLine();
+
+  bool HandleRead(uint16_t reg_addr, uint8_t* buf, uint16_t length) override;
+  bool HandleWrite(uint16_t reg_addr, const uint8_t* buf, uint16_t length) override;
+  bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) override;
+};
+
+
+//Digital Audio Processor
+class SimDAPModule : public SimIntModule {
+public:
+  SimDAPModule(uint8_t address, GPIO_TypeDef* int_port, uint16_t int_pin);
+};
+
+//HiFiDAC
+class SimHiFiDACModule : public SimIntModule {
+public:
+  SimHiFiDACModule(uint8_t address, GPIO_TypeDef* int_port, uint16_t int_pin);
+};
+
+//Power Amp Controller: PVDD follows the target right away, a lowered target reports its reduction as done after the settling time
+class SimPowerAmpModule : public SimIntModule {
+public:
+  SimPowerAmpModule(uint8_t address, GPIO_TypeDef* int_port, uint16_t int_pin);
+
+protected:
+  bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) override;
+};
+
+
+//EEPROM: flat memory with 16-bit addresses, blank (0xFF) initially; writes wrap around within their page like the real device.
+//The write cycle time (NACKs while programming) isn't modelled - the controller's accesses are spaced by its loop anyway
+class SimEEPROM : public SimI2CDevice {
+public:
+  uint8_t memory[SIMMOD_EEPROM_SIZE];
+
+  SimEEPROM(uint8_t address);
+
+  bool HandleRead(uint16_t reg_addr, uint8_t* buf, uint16_t length) override;
+  bool HandleWrite(uint16_t reg_addr, const uint8_t* buf, uint16_t length) override;
+};
+
+
+//RTC (DS3231-type BCD registers): starts at the given date and time and keeps time with the simulation - date rollover isn't modelled
+class SimRTC : public SimI2CDevice {
+public:
+  SimRTC(uint8_t address, uint8_t year, uint8_t month, uint8_t date, uint8_t hours, uint8_t minutes, uint8_t seconds);
+
+protected:
+  //simulated time (us) up to which the time registers are current
+  uint64_t time_base_us;
+
+  void UpdateTime();
+
+  void OnRegisterRead(uint8_t reg_addr) override;
+  bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) override;
+};
+
+
+//battery charger (16-bit registers, no CRC), with its adapter-present (ACOK) signal
+class SimCharger : public SimI2CDevice {
+public:
+  GPIO_TypeDef* const acok_port;
+  const uint16_t acok_pin;
+
+  //connects or disconnects the adapter (EXTI on every edge, like the ACOK interrupt)
+  void SetAdapterPresent(bool present);
+
+  SimCharger(uint8_t address, GPIO_TypeDef* acok_port, uint16_t acok_pin, bool adapter_present);
+};
+
+
+/*********************************************************/
+/*                      UART modules                     */
+/*********************************************************/
+
+//Bluetooth receiver: reset sequence with MCU and Bluetooth reset events and a delayed INIT_DONE, connection control applied
+//to the status, text registers sent with their actual length
+class SimBluetoothReceiver : public SimUARTRegDevice {
+public:
+  uint32_t reset_count;
+  //simulated time (us) of the last controller write of the VOLUME register
+  uint64_t last_volume_write_us;
+
+  //phone-side events: connection with A2DP streaming and AVRCP, and an absolute volume change
+  void ConnectPhone();
+  void SetPhoneVolume(uint8_t volume);
+
+  SimBluetoothReceiver(SimUARTPort& port);
+
+protected:
+  //reset generation, to drop the pending steps of an interrupted reset sequence
+  uint32_t reset_generation;
+
+  void ResetRegisters();
+  void SetStatusBits(uint16_t set, uint16_t clear);
+
+  uint16_t GetValueLength(uint8_t reg_addr) override;
+  bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value, uint16_t length) override;
+};
+
+
+//battery monitor: a five-cell pack discharging at a slowly varying current, with change notifications of the measurements
+//every second and of the temperatures every two seconds (sent only for changed values, like the module does)
+class SimBatteryMonitor : public SimUARTRegDevice {
+public:
+  //charge current in mA replacing the discharge while nonzero (charging or regeneration), applied from the next measurement
+  int32_t charge_current_mA;
+
+  //starts the periodic measurement updates
+  void Start();
+
+  SimBatteryMonitor(SimUARTPort& port);
+
+protected:
+  uint32_t measurement_count;
+  double soc_energy_wh;
+
+  void UpdateMeasurements();
+  void UpdateTemperatures();
+  void SetAndNotify(uint8_t reg_addr, const void* value);
+};
+
+
+#endif /* SIM_MODULES_H_ */
@@ -0,0 +1,171 @@
+/*
+ * sim_system.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ */
+
+
+#include "sim_system.h"
+#include "retarget.h"
+
+
+/*********************************************************/
+/*        Peripherals and handles of the firmware        */
+/*********************************************************/
+
+//GPIO ports and RCC, replacing the hardware register blocks (see stm32h7xx_hal_conf.h in this directory)
+GPIO_TypeDef sim_gpioA, sim_gpioB, sim_gpioC, sim_gpioD, sim_gpioE, sim_gpioF, sim_gpioG, sim_gpioH;
+RCC_TypeDef sim_rcc;
+
+//timer register blocks, written directly by the LED PWM code
+static TIM_TypeDef _sim_tim2, _sim_tim4;
+
+
+//handles with the settings of main.c's MX_*_Init functions that the simulation depends on
+static I2C_HandleTypeDef _SimSystem_I2CHandle(uint32_t timing) {
+  I2C_HandleTypeDef handle = {};
+  handle.Init.Timing = timing;
+  handle.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+  handle.State = HAL_I2C_STATE_READY;
+  return handle;
+}
+
+static UART_HandleTypeDef _SimSystem_UARTHandle(uint32_t baud_rate) {
+  UART_HandleTypeDef handle = {};
+  handle.Init.BaudRate = baud_rate;
+  handle.Init.WordLength = UART_WORDLENGTH_8B;
+  handle.Init.StopBits = UART_STOPBITS_1;
+  handle.Init.Parity = UART_PARITY_NONE;
+  handle.Init.Mode = UART_MODE_TX_RX;
+  return handle;
+}
+
+static OSPI_HandleTypeDef _SimSystem_OSPIHandle(uint32_t clock_prescaler) {
+  OSPI_HandleTypeDef handle = {};
+  handle.Init.FifoThreshold = 1;
+  handle.Init.DeviceSize = 24;
+  handle.Init.ChipSelectHighTime = 8;
+  handle.Init.ClockPrescaler = clock_prescaler;
+  return handle;
+}
+
+static TIM_HandleTypeDef _SimSystem_TIMHandle(TIM_TypeDef* instance, uint32_t period) {
+  TIM_HandleTypeDef handle = {};
+  handle.Instance = instance;
+  handle.Init.Prescaler = 3;
+  handle.Init.Period = period;
+  return handle;
+}
+
+
+ADC_HandleTypeDef hadc1 = {};
+I2C_HandleTypeDef hi2c3 = _SimSystem_I2CHandle(0x2000090E);
+I2C_HandleTypeDef hi2c5 = _SimSystem_I2CHandle(0x2000090E);
+OSPI_HandleTypeDef hospi1 = _SimSystem_OSPIHandle(26);
+TIM_HandleTypeDef htim2 = _SimSystem_TIMHandle(&_sim_tim2, 65535);
+TIM_HandleTypeDef htim4 = _SimSystem_TIMHandle(&_sim_tim4, 65534);
+UART_HandleTypeDef huart4 = _SimSystem_UARTHandle(57600);
+UART_HandleTypeDef huart1 = _SimSystem_UARTHandle(115200);
+
+
+//the firmware's system object (cpp_main.cpp isn't part of the simulation)
+BlockBoxV2System bbv2_system;
+System& main_system = bbv2_system;
+
+
+/*********************************************************/
+/*              Unsimulated HAL functions                */
+/*********************************************************/
+
+//LED PWM timers: only their compare registers matter, which the firmware writes directly
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef* htim) {
+  UNUSED(htim);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef* htim, uint32_t Channel) {
+  UNUSED(htim);
+  UNUSED(Channel);
+  return HAL_OK;
+}
+
+//debug UART: printf goes to stdout directly, so no transmissions to complete
+void Retarget_UART_TxCpltCallback(UART_HandleTypeDef* huart) {
+  UNUSED(huart);
+}
+
+
+/*********************************************************/
+/*                   Simulated system                    */
+/*********************************************************/
+
+void SimSystem::InitSystem() {
+  bbv2_system.Init();
+  this->bms.Start();
+}
+
+
+void SimSystem::RunLoopIteration() {
+  //like cpp_main: loop tasks with exceptions caught, then wait for the rest of the loop period
+  uint32_t iteration_start_tick = HAL_GetTick();
+
+  try {
+    bbv2_system.LoopTasks();
+  } catch (const std::exception& err) {
+    this->loop_exception_count++;
+    DEBUG_PRINTF("Exception in main loop: %s\n", err.what());
+  }
+
+  this->loop_count++;
+  __enable_irq();
+  SimTime_AdvanceTo(MAX(SimTime_Now(), (uint64_t)(iteration_start_tick + MAIN_LOOP_PERIOD_MS) * 1000));
+}
+
+void SimSystem::RunUntil(uint64_t time_us) {
+  while (SimTime_Now() < time_us) {
+    this->RunLoopIteration();
+  }
+}
+
+void SimSystem::Run(uint64_t duration_us) {
+  this->RunUntil(SimTime_Now() + duration_us);
+}
+
+uint64_t SimSystem::RunUntilCondition(const std::function<bool()>& condition, uint64_t timeout_us) {
+  uint64_t start_us = SimTime_Now();
+  while (!condition()) {
+    if (SimTime_Now() - start_us >= timeout_us) {
+      return UINT64_MAX;
+    }
+    this->RunLoopIteration();
+  }
+  return SimTime_Now() - start_us;
+}
+
+
+SimSystem::SimSystem() :
+    main_bus(hi2c5, SimI2C_BitRate(hi2c5.Init.Timing, SIMSYS_I2C_KERNEL_CLOCK_HZ), true),
+    chg_bus(hi2c3, SimI2C_BitRate(hi2c3.Init.Timing, SIMSYS_I2C_KERNEL_CLOCK_HZ), true),
+    btrx_port(huart1, huart1.Init.BaudRate),
+    bms_port(huart4, huart4.Init.BaudRate),
+    eve(hospi1, SIMSYS_OSPI_KERNEL_CLOCK_HZ),
+    eeprom(0x57),
+    rtc(0x68, 26, 10, 19, 12, 0, 0),
+    dap(0x4A, I2C5_INT3_N_GPIO_Port, I2C5_INT3_N_Pin),
+    dac(0x1D, I2C5_INT2_N_GPIO_Port, I2C5_INT2_N_Pin),
+    amp(0x11, I2C5_INT1_N_GPIO_Port, I2C5_INT1_N_Pin),
+    charger(0x09, CHG_ACOK_GPIO_Port, CHG_ACOK_Pin, true),
+    btrx(btrx_port),
+    bms(bms_port),
+    loop_count(0),
+    loop_exception_count(0) {
+  SimTime_Install();
+
+  this->main_bus.AddDevice(&this->eeprom);
+  this->main_bus.AddDevice(&this->rtc);
+  this->main_bus.AddDevice(&this->dap);
+  this->main_bus.AddDevice(&this->dac);
+  this->main_bus.AddDevice(&this->amp);
+  this->chg_bus.AddDevice(&this->charger);
+}
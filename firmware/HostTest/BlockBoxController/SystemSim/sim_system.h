@@ -0,0 +1,71 @@
+/*
+ * sim_system.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  System simulation of the BlockBox v2 controller: the real controller firmware (bbv2_system with its module interfaces,
+ *  managers and GUI) on Linux, with the firmware's peripheral handles and GPIO ports backed by the simulated buses and
+ *  module stand-ins. All time is simulated (sim_time): bus transfers take their bit-accurate time at the firmware's
+ *  peripheral clock settings, module reactions their assumed delays, and firmware code runs in zero time - so measured
+ *  latencies are the bus and protocol part of the real ones, without the controller's CPU time.
+ */
+
+#ifndef SIM_SYSTEM_H_
+#define SIM_SYSTEM_H_
+
+
+#include "system.h"
+#include "sim_time.h"
+#include "sim_i2c.h"
+#include "sim_uart.h"
+#include "sim_eve.h"
+#include "sim_modules.h"
+#include <functional>
+
+
+//peripheral kernel clocks of the controller clock tree (main.c SystemClock_Config / PeriphCommonClock_Config)
+#define SIMSYS_I2C_KERNEL_CLOCK_HZ 8000000
+#define SIMSYS_OSPI_KERNEL_CLOCK_HZ 260000000
+
+
+//the simulated hardware around the controller firmware
+class SimSystem {
+public:
+  SimI2CBus main_bus;
+  SimI2CBus chg_bus;
+  SimUARTPort btrx_port;
+  SimUARTPort bms_port;
+  SimEVE eve;
+
+  SimEEPROM eeprom;
+  SimRTC rtc;
+  SimDAPModule dap;
+  SimHiFiDACModule dac;
+  SimPowerAmpModule amp;
+  SimCharger charger;
+  SimBluetoothReceiver btrx;
+  SimBatteryMonitor bms;
+
+  //main loop iterations so far, and the exceptions they threw (caught and counted like the firmware's main loop does)
+  uint32_t loop_count;
+  uint32_t loop_exception_count;
+
+  //runs the system init (bbv2_system.Init), which blocks for its initial delays like on the hardware
+  void InitSystem();
+
+  //runs main loop iterations at the firmware's loop period until the given simulated time
+  void RunUntil(uint64_t time_us);
+  void Run(uint64_t duration_us);
+  //runs main loop iterations until the condition holds - returns the simulated time it took, or UINT64_MAX on timeout
+  uint64_t RunUntilCondition(const std::function<bool()>& condition, uint64_t timeout_us);
+
+  //creates the simulated hardware - installs the sim_time scheduler, so it must exist before any other simulated activity
+  SimSystem();
+
+private:
+  void RunLoopIteration();
+};
+
+
+#endif /* SIM_SYSTEM_H_ */
@@ -0,0 +1,51 @@
+/*
+ * stm32h7xx_hal_conf.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  System simulation wrapper of the controller's HAL configuration: includes the real one, then points the GPIO ports and
+ *  RCC, which the controller sources access through fixed peripheral addresses, to host instances (defined in sim_system.cpp)
+ */
+
+#ifndef SYSTEMSIM_STM32H7XX_HAL_CONF_H_
+#define SYSTEMSIM_STM32H7XX_HAL_CONF_H_
+
+
+#include_next "stm32h7xx_hal_conf.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern GPIO_TypeDef sim_gpioA, sim_gpioB, sim_gpioC, sim_gpioD, sim_gpioE, sim_gpioF, sim_gpioG, sim_gpioH;
+extern RCC_TypeDef sim_rcc;
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#undef GPIOF
+#undef GPIOG
+#undef GPIOH
+#undef RCC
+
+#define GPIOA (&sim_gpioA)
+#define GPIOB (&sim_gpioB)
+#define GPIOC (&sim_gpioC)
+#define GPIOD (&sim_gpioD)
+#define GPIOE (&sim_gpioE)
+#define GPIOF (&sim_gpioF)
+#define GPIOG (&sim_gpioG)
+#define GPIOH (&sim_gpioH)
+#define RCC (&sim_rcc)
+
+
+#endif /* SYSTEMSIM_STM32H7XX_HAL_CONF_H_ */
@@ -0,0 +1,349 @@
+/*
+ * test_event_source.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the event callback lists (event_source.cpp): per-bit dispatch with each registration called once per
+ *  event (in registration order within each event bit's list), replacing and unregistering identified callbacks,
+ *  registration changes from running callbacks (including nested executions), deferred delivery with coalescing and
+ *  stale entries, callback exceptions, and exhaustion of the static registration and link pools.
+ */
+
+#include "host_test.h"
+#include "event_source.h"
+#include "system.h"
+#include <string>
+#include <vector>
+
+
+#define TEST_EVENT_A (1u << 0)
+#define TEST_EVENT_B (1u << 1)
+#define TEST_EVENT_C (1u << 5)
+#define TEST_EVENT_D (1u << 31)
+
+
+//event source stand-in: exposes the protected callback execution
+class TestSource : public EventSource {
+public:
+  void Trigger(uint32_t event) {
+    this->ExecuteCallbacks(event);
+  }
+};
+
+
+static std::vector<std::string> _events;
+
+static void _Log(const char* name, uint32_t event) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%s:%lX", name, (unsigned long)event);
+  _events.push_back(buf);
+}
+
+//callback that logs its name and the event
+static EventCallback _LogCallback(const char* name) {
+  return [name](EventSource*, uint32_t event) { _Log(name, event); };
+}
+
+//events since the last call, as one string
+static std::string _TakeEvents() {
+  std::string result;
+  for (auto& event : _events) {
+    if (!result.empty()) {
+      result += ", ";
+    }
+    result += event;
+  }
+  _events.clear();
+  return result;
+}
+
+#define CHECK_EVENTS(expected) do { \
+  std::string __events = _TakeEvents(); \
+  CHECK_MSG(__events == (expected), "events \"%s\", expected \"%s\"", __events.c_str(), (expected)); \
+} while (0)
+
+
+//only registrations matching the event are called, each once per event, in registration order - for multi-bit events list by list, lowest bit first
+static void _Test_Dispatch() {
+  TestSource source;
+
+  source.RegisterCallback(_LogCallback("ab"), TEST_EVENT_A | TEST_EVENT_B);
+  source.RegisterCallback(_LogCallback("b"), TEST_EVENT_B);
+  source.RegisterCallback(_LogCallback("cd"), TEST_EVENT_C | TEST_EVENT_D);
+  source.RegisterCallback(_LogCallback("all"), 0xFFFFFFFF);
+
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("ab:1, all:1");
+  source.Trigger(TEST_EVENT_B);
+  CHECK_EVENTS("ab:2, b:2, all:2");
+  source.Trigger(TEST_EVENT_D);
+  CHECK_EVENTS("cd:80000000, all:80000000");
+  source.Trigger(1u << 10);
+  CHECK_EVENTS("all:400");
+
+  //combined event: per-bit lists are walked bit by bit, but nobody is called twice
+  source.Trigger(TEST_EVENT_A | TEST_EVENT_B | TEST_EVENT_C);
+  CHECK_EVENTS("ab:23, all:23, b:23, cd:23");
+
+  //the source is passed to the callback
+  EventSource* seen = NULL;
+  source.RegisterCallback([&seen](EventSource* s, uint32_t) { seen = s; }, TEST_EVENT_C);
+  source.Trigger(TEST_EVENT_C);
+  CHECK(seen == &source);
+  _TakeEvents();
+
+  //other sources are independent
+  TestSource other;
+  other.RegisterCallback(_LogCallback("other"), TEST_EVENT_A);
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("ab:1, all:1");
+  other.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("other:1");
+}
+
+//identified registrations: replacing keeps the position, unregistering and clearing
+static void _Test_Identifiers() {
+  TestSource source;
+
+  source.RegisterCallback(_LogCallback("x"), TEST_EVENT_A, 1);
+  source.RegisterCallback(_LogCallback("y"), TEST_EVENT_A, 2);
+  source.RegisterCallback(_LogCallback("z"), TEST_EVENT_A);
+
+  source.RegisterCallback(_LogCallback("x2"), TEST_EVENT_A | TEST_EVENT_B, 1);
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("x2:1, y:1, z:1");
+  source.Trigger(TEST_EVENT_B);
+  CHECK_EVENTS("x2:2");
+
+  //changed mask: removed from the old bit's list
+  source.RegisterCallback(_LogCallback("x3"), TEST_EVENT_B, 1);
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("y:1, z:1");
+  source.Trigger(TEST_EVENT_B);
+  CHECK_EVENTS("x3:2");
+
+  source.UnregisterCallback(2);
+  source.UnregisterCallback(1234);
+  source.Trigger(TEST_EVENT_A | TEST_EVENT_B);
+  CHECK_EVENTS("z:3, x3:3");
+
+  source.ClearCallbacks();
+  source.Trigger(0xFFFFFFFF);
+  CHECK_EVENTS("");
+
+  //invalid arguments
+  int thrown = 0;
+  try {
+    source.RegisterCallback(EventCallback(), TEST_EVENT_A);
+  } catch (const std::invalid_argument&) {
+    thrown++;
+  }
+  try {
+    source.RegisterCallback(_LogCallback("x"), 0);
+  } catch (const std::invalid_argument&) {
+    thrown++;
+  }
+  try {
+    source.UnregisterCallback(0);
+  } catch (const std::invalid_argument&) {
+    thrown++;
+  }
+  CHECK_EQ(thrown, 3);
+}
+
+//registration changes from running callbacks only take effect once the source's callbacks are done
+static void _Test_ChangesDuringExecution() {
+  TestSource source;
+
+  //a callback removing itself and a later one, and adding a new one
+  source.RegisterCallback([&source](EventSource*, uint32_t event) {
+    _Log("self", event);
+    source.UnregisterCallback(1);
+    source.UnregisterCallback(3);
+    source.RegisterCallback(_LogCallback("new"), TEST_EVENT_A, 4);
+  }, TEST_EVENT_A, 1);
+  source.RegisterCallback(_LogCallback("keep"), TEST_EVENT_A, 2);
+  source.RegisterCallback(_LogCallback("later"), TEST_EVENT_A, 3);
+
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("self:1, keep:1");
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("keep:1, new:1");
+
+  //replacing a registration from its own callback: the running one stays intact, the new one is used afterwards
+  source.ClearCallbacks();
+  int calls = 0;
+  source.RegisterCallback([&source, &calls](EventSource*, uint32_t event) {
+    calls++;
+    source.RegisterCallback(_LogCallback("replaced"), TEST_EVENT_A, 1);
+    _Log("original", event);
+  }, TEST_EVENT_A, 1);
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("original:1");
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("replaced:1");
+  CHECK_EQ(calls, 1);
+
+  //nested execution (callback triggering another event of the same source): changes wait for the outermost one
+  source.ClearCallbacks();
+  source.RegisterCallback([&source](EventSource*, uint32_t event) {
+    _Log("outer", event);
+    source.UnregisterCallback(2);
+    source.Trigger(TEST_EVENT_B);
+    source.RegisterCallback(_LogCallback("added"), TEST_EVENT_B, 3);
+  }, TEST_EVENT_A, 1);
+  source.RegisterCallback(_LogCallback("inner"), TEST_EVENT_B, 2);
+  source.RegisterCallback(_LogCallback("inner2"), TEST_EVENT_B, 5);
+
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("outer:1, inner2:2");
+  source.Trigger(TEST_EVENT_B);
+  CHECK_EVENTS("inner2:2, added:2");
+
+  //clearing from a callback
+  source.RegisterCallback([&source](EventSource*, uint32_t event) {
+    _Log("clear", event);
+    source.ClearCallbacks();
+  }, TEST_EVENT_C, 6);
+  source.Trigger(TEST_EVENT_B | TEST_EVENT_C);
+  CHECK_EVENTS("inner2:22, added:22, clear:22");
+  source.Trigger(0xFFFFFFFF);
+  CHECK_EVENTS("");
+}
+
+//deferred callbacks are queued, coalesced per registration and event, and delivered from the main loop
+static void _Test_Deferred() {
+  TestSource source;
+
+  source.RegisterCallback(_LogCallback("direct"), TEST_EVENT_A | TEST_EVENT_B);
+  source.RegisterCallback(_LogCallback("deferred"), TEST_EVENT_A | TEST_EVENT_B, 1, true);
+
+  source.Trigger(TEST_EVENT_A);
+  source.Trigger(TEST_EVENT_B);
+  source.Trigger(TEST_EVENT_A);
+  source.Trigger(TEST_EVENT_A | TEST_EVENT_B);
+  CHECK_EVENTS("direct:1, direct:2, direct:1, direct:3");
+
+  EventSource::DeliverDeferredEvents();
+  CHECK_EVENTS("deferred:1, deferred:2, deferred:3");
+  EventSource::DeliverDeferredEvents();
+  CHECK_EVENTS("");
+
+  //removed or replaced registrations drop their pending deliveries
+  source.Trigger(TEST_EVENT_A);
+  source.UnregisterCallback(1);
+  source.RegisterCallback(_LogCallback("deferred2"), TEST_EVENT_B, 2, true);
+  source.Trigger(TEST_EVENT_B);
+  source.RegisterCallback(_LogCallback("deferred3"), TEST_EVENT_B, 2, true);
+  _TakeEvents();
+  EventSource::DeliverDeferredEvents();
+  CHECK_EVENTS("");
+
+  //events queued by delivered callbacks are delivered in the next cycle; registration changes from a delivery wait until it's done
+  source.ClearCallbacks();
+  source.RegisterCallback([&source](EventSource*, uint32_t event) {
+    _Log("first", event);
+    if (event == TEST_EVENT_A) {
+      source.UnregisterCallback(1);
+      source.Trigger(TEST_EVENT_B);
+    }
+  }, TEST_EVENT_A | TEST_EVENT_B, 1, true);
+  source.RegisterCallback(_LogCallback("second"), TEST_EVENT_A | TEST_EVENT_B, 2, true);
+  source.Trigger(TEST_EVENT_A);
+  EventSource::DeliverDeferredEvents();
+  CHECK_EVENTS("first:1, second:1");
+  EventSource::DeliverDeferredEvents();
+  CHECK_EVENTS("second:2");
+
+  //full queue: dropped with a warning
+  source.ClearCallbacks();
+  source.RegisterCallback(_LogCallback("q"), 0xFFFFFFFF, 1, true);
+  uint32_t warnings_before = host_debug_log_counts[DEBUG_WARNING];
+  for (uint32_t i = 1; i <= EVENT_DEFERRED_QUEUE_SIZE + 2; i++) {
+    source.Trigger(i);
+  }
+  CHECK_EQ(host_debug_log_counts[DEBUG_WARNING], warnings_before + 2);
+  EventSource::DeliverDeferredEvents();
+  CHECK_EQ(_events.size(), (size_t)EVENT_DEFERRED_QUEUE_SIZE);
+  CHECK(!_events.empty() && _events.back() == "q:20");
+  _TakeEvents();
+}
+
+//throwing callbacks are logged, the other callbacks still run
+static void _Test_Exceptions() {
+  TestSource source;
+
+  source.RegisterCallback([](EventSource*, uint32_t) { throw std::runtime_error("callback failure"); }, TEST_EVENT_A);
+  source.RegisterCallback([](EventSource*, uint32_t) { throw 1; }, TEST_EVENT_A, 0, true);
+  source.RegisterCallback(_LogCallback("after"), TEST_EVENT_A);
+
+  uint32_t errors_before = host_debug_log_counts[DEBUG_ERROR];
+  source.Trigger(TEST_EVENT_A);
+  CHECK_EVENTS("after:1");
+  CHECK_EQ(host_debug_log_counts[DEBUG_ERROR], errors_before + 1);
+  EventSource::DeliverDeferredEvents();
+  CHECK_EQ(host_debug_log_counts[DEBUG_ERROR], errors_before + 2);
+}
+
+//static pools: exhaustion throws, and destroyed sources return their registrations and links
+static void _Test_Pools() {
+  int i, thrown = 0;
+
+  for (int round = 0; round < 3; round++) {
+    TestSource source;
+
+    //registration slots
+    for (i = 0; i < EVENT_MAX_REGISTRATIONS; i++) {
+      source.RegisterCallback(_LogCallback("r"), TEST_EVENT_A);
+    }
+    try {
+      source.RegisterCallback(_LogCallback("r"), TEST_EVENT_A);
+    } catch (const std::runtime_error&) {
+      thrown++;
+    }
+    source.Trigger(TEST_EVENT_A);
+    CHECK_EQ(_events.size(), (size_t)EVENT_MAX_REGISTRATIONS);
+    _TakeEvents();
+    source.ClearCallbacks();
+
+    //links: one per event bit
+    for (i = 0; i < EVENT_MAX_LINKS / 32; i++) {
+      source.RegisterCallback(_LogCallback("l"), 0xFFFFFFFF, 100 + i);
+    }
+    try {
+      source.RegisterCallback(_LogCallback("l"), 0xFFFFFFFF);
+    } catch (const std::runtime_error&) {
+      thrown++;
+    }
+    //growing an identified registration's mask beyond the free links fails and leaves it unchanged
+    source.UnregisterCallback(100);
+    for (i = 0; i < EVENT_MAX_LINKS % 32 + 31; i++) {
+      source.RegisterCallback(_LogCallback("m"), TEST_EVENT_D);
+    }
+    source.RegisterCallback(_LogCallback("g"), TEST_EVENT_A, 200);
+    try {
+      source.RegisterCallback(_LogCallback("g2"), TEST_EVENT_A | TEST_EVENT_B, 200);
+    } catch (const std::runtime_error&) {
+      thrown++;
+    }
+    source.Trigger(TEST_EVENT_A);
+    CHECK_EQ(_events.size(), (size_t)(EVENT_MAX_LINKS / 32));
+    CHECK(!_events.empty() && _events.back() == "g:1");
+    _TakeEvents();
+    //the source's destructor frees everything for the next round
+  }
+  CHECK_EQ(thrown, 9);
+}
+
+
+int main() {
+  _Test_Dispatch();
+  _Test_Identifiers();
+  _Test_ChangesDuringExecution();
+  _Test_Deferred();
+  _Test_Exceptions();
+  _Test_Pools();
+
+  return HOST_TestSummary("test_event_source");
+}
@@ -0,0 +1,440 @@
+/*
+ * test_module_interrupts.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the interrupt-driven register refresh of IntRegI2CModuleInterface (module_interface_i2c.cpp), against
+ *  module stand-ins with the standard INT_MASK/INT_FLAGS registers and an active-low interrupt line on a simulated I2C bus:
+ *  only the refresh groups of raised flags are read (adjacent ones merged), reset flags invalidate the register set
+ *  instead, missed EXTIs are caught by the pin check, and the watchdog refreshes everything. The real DAP interface is
+ *  checked the same way, including the bus time from interrupt to updated status.
+ */
+
+#include "host_test.h"
+#include "module_interface_i2c.h"
+#include "dap_interface.h"
+#include "sim_i2c.h"
+#include "system.h"
+
+
+#define TEST_I2C_ADDR 0x30
+#define TEST_DAP_I2C_ADDR 0x31
+
+#define TEST_INT_PIN (1u << 4)
+
+//register map: interrupt registers, two adjacent groups, a separate one, and a full-size group followed by a small one
+#define TEST_REG_A 0x20
+#define TEST_REG_B 0x21
+#define TEST_REG_C 0x30
+#define TEST_REG_LARGE 0x40
+#define TEST_REG_AFTER_LARGE 0x41
+
+#define TEST_INT_A (1u << 0)
+#define TEST_INT_B (1u << 1)
+#define TEST_INT_C (1u << 2)
+#define TEST_INT_LARGE (1u << 3)
+#define TEST_INT_AFTER_LARGE (1u << 4)
+
+#define TEST_WATCHDOG_PERIOD 5
+
+static uint16_t _test_reg_sizes[256];
+
+static void _InitRegSizes() {
+  memset(_test_reg_sizes, 0, sizeof(_test_reg_sizes));
+  _test_reg_sizes[MODIF_I2C_INT_MASK_REG] = 1;
+  _test_reg_sizes[MODIF_I2C_INT_FLAGS_REG] = 1;
+  _test_reg_sizes[TEST_REG_A] = 1;
+  _test_reg_sizes[TEST_REG_B] = 2;
+  _test_reg_sizes[TEST_REG_C] = 2;
+  _test_reg_sizes[TEST_REG_LARGE] = MODIF_I2C_REFRESH_GROUP_MAX_SIZE;
+  _test_reg_sizes[TEST_REG_AFTER_LARGE] = 1;
+}
+
+static const IntRegI2CRefreshGroup _test_groups[] = {
+  { TEST_INT_A, TEST_REG_A, 1 },
+  { TEST_INT_B, TEST_REG_B, 1 },
+  { TEST_INT_C, TEST_REG_C, 1 },
+  { TEST_INT_LARGE, TEST_REG_LARGE, 1 },
+  { TEST_INT_AFTER_LARGE, TEST_REG_AFTER_LARGE, 1 }
+};
+
+
+//module stand-in with the standard interrupt registers: raised flags pull the interrupt line low until they are all cleared
+class TestIntDevice : public SimI2CDevice {
+public:
+  GPIO_TypeDef* const int_port;
+  const uint16_t int_pin;
+
+  //reads per register since the last ClearReads
+  uint32_t register_reads[256];
+
+  TestIntDevice(uint8_t address, const uint16_t* reg_sizes, GPIO_TypeDef* int_port, uint16_t int_pin, bool use_crc = true) :
+      SimI2CDevice(address, reg_sizes, use_crc), int_port(int_port), int_pin(int_pin) {
+    this->int_port->IDR |= this->int_pin;
+    this->ClearReads();
+  }
+
+  void ClearReads() {
+    memset(this->register_reads, 0, sizeof(this->register_reads));
+    this->read_count = 0;
+  }
+
+  //raises the given flags (masked like the modules do, except for the reset flag)
+  void Raise(uint8_t flags) {
+    flags &= this->Reg8(MODIF_I2C_INT_MASK_REG) | MODIF_I2C_INT_RESET_FLAG;
+    this->Reg8(MODIF_I2C_INT_FLAGS_REG) |= flags;
+    this->UpdateLine();
+  }
+
+protected:
+  void UpdateLine() {
+    if (this->Reg8(MODIF_I2C_INT_FLAGS_REG) != 0) {
+      this->int_port->IDR &= ~(uint32_t)this->int_pin;
+    } else {
+      this->int_port->IDR |= this->int_pin;
+    }
+  }
+
+  void OnRegisterRead(uint8_t reg_addr) override {
+    this->register_reads[reg_addr]++;
+    this->SimI2CDevice::OnRegisterRead(reg_addr);
+  }
+
+  bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) override {
+    if (reg_addr == MODIF_I2C_INT_FLAGS_REG) {
+      //write-zero-to-clear
+      this->Reg8(reg_addr) &= *value;
+      this->UpdateLine();
+      return true;
+    }
+    return this->SimI2CDevice::OnRegisterWrite(reg_addr, value);
+  }
+};
+
+//interrupt-enabled interface with the test refresh groups, refreshing in the loop task like an initialised module interface
+class TestIntInterface : public IntRegI2CModuleInterface {
+public:
+  uint32_t update_counts[256];
+
+  TestIntInterface(I2CHardwareInterface& hw_interface, GPIO_TypeDef* int_port) :
+      IntRegI2CModuleInterface(hw_interface, TEST_I2C_ADDR, _test_reg_sizes, int_port, TEST_INT_PIN) {
+    memset(this->update_counts, 0, sizeof(this->update_counts));
+    this->SetRefreshGroups(_test_groups, sizeof(_test_groups) / sizeof(IntRegI2CRefreshGroup));
+  }
+
+  void LoopTasks() override {
+    this->RefreshWatchdogTasks();
+    this->IntRegI2CModuleInterface::LoopTasks();
+  }
+
+  void TestSetRefreshGroups(const IntRegI2CRefreshGroup* groups, uint8_t count, uint32_t watchdog_period) {
+    this->SetRefreshGroups(groups, count, watchdog_period);
+  }
+
+protected:
+  void OnRegisterUpdate(uint8_t address) override {
+    this->update_counts[address]++;
+    this->IntRegI2CModuleInterface::OnRegisterUpdate(address);
+  }
+};
+
+
+static void _HardwareReset() {}
+
+static SimI2CBus* _bus;
+static I2CHardwareInterface* _hw;
+static ModuleInterface* _iface;
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c) {
+  UNUSED(hi2c);
+  _hw->HandleInterrupt(IF_TX_COMPLETE);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c) {
+  UNUSED(hi2c);
+  _hw->HandleInterrupt(IF_RX_COMPLETE);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c) {
+  UNUSED(hi2c);
+  _hw->HandleInterrupt(IF_ERROR);
+}
+
+
+//runs the given number of main loop cycles, with all bus transfers of each cycle completing in it
+static void _Run(int cycles) {
+  for (int i = 0; i < cycles; i++) {
+    while (SimI2C_Process()) {}
+    _iface->LoopTasks();
+  }
+  while (SimI2C_Process()) {}
+}
+
+//raises the given flags at the module and delivers the EXTI, like the pin interrupt handler does
+static void _Interrupt(TestIntDevice& device, uint8_t flags) {
+  device.Raise(flags);
+  _iface->HandleInterrupt(IF_EXTI, device.int_pin);
+}
+
+
+//only the groups of raised flags are read, adjacent ones in a single transfer; the flags are cleared and the line released
+static void _Test_FlaggedGroups(TestIntDevice& device, TestIntInterface& iface) {
+  device.Reg8(TEST_REG_A) = 0x5A;
+  device.Reg16(TEST_REG_B) = 0x1234;
+  device.Reg16(TEST_REG_C) = 0xBEEF;
+  device.ClearReads();
+
+  _Interrupt(device, TEST_INT_A | TEST_INT_B);
+  _Run(2);
+  CHECK_EQ(device.register_reads[MODIF_I2C_INT_FLAGS_REG], 1u);
+  CHECK_EQ(device.register_reads[TEST_REG_A], 1u);
+  CHECK_EQ(device.register_reads[TEST_REG_B], 1u);
+  CHECK_EQ(device.register_reads[TEST_REG_C], 0u);
+  CHECK_EQ(device.register_reads[TEST_REG_LARGE], 0u);
+  //flags read and one merged group read
+  CHECK_EQ(device.read_count, 2u);
+  CHECK_EQ(iface.registers.Reg8(TEST_REG_A), 0x5A);
+  CHECK_EQ(iface.registers.Reg16(TEST_REG_B), 0x1234);
+  CHECK(!iface.registers.IsValid(TEST_REG_C));
+  CHECK_EQ(iface.update_counts[TEST_REG_A], 1u);
+  CHECK_EQ(iface.update_counts[TEST_REG_B], 1u);
+  CHECK_EQ(device.Reg8(MODIF_I2C_INT_FLAGS_REG), 0);
+  CHECK(HAL_GPIO_ReadPin(device.int_port, device.int_pin) == GPIO_PIN_SET);
+
+  //separate group on its own, nothing else
+  device.ClearReads();
+  _Interrupt(device, TEST_INT_C);
+  _Run(2);
+  CHECK_EQ(device.read_count, 2u);
+  CHECK_EQ(device.register_reads[TEST_REG_C], 1u);
+  CHECK_EQ(device.register_reads[TEST_REG_A] + device.register_reads[TEST_REG_B], 0u);
+  CHECK_EQ(iface.registers.Reg16(TEST_REG_C), 0xBEEF);
+
+  //non-adjacent groups: one read each
+  device.ClearReads();
+  _Interrupt(device, TEST_INT_A | TEST_INT_C);
+  _Run(2);
+  CHECK_EQ(device.read_count, 3u);
+  CHECK_EQ(device.register_reads[TEST_REG_B], 0u);
+
+  //adjacent groups that together exceed the maximum group size aren't merged
+  device.ClearReads();
+  _Interrupt(device, TEST_INT_LARGE | TEST_INT_AFTER_LARGE);
+  _Run(2);
+  CHECK_EQ(device.read_count, 3u);
+  CHECK_EQ(device.register_reads[TEST_REG_LARGE], 1u);
+  CHECK_EQ(device.register_reads[TEST_REG_AFTER_LARGE], 1u);
+
+  //masked flags are never raised, an interrupt without flags reads nothing but the flags
+  device.Reg8(MODIF_I2C_INT_MASK_REG) = TEST_INT_A;
+  device.ClearReads();
+  _Interrupt(device, TEST_INT_C);
+  _Run(2);
+  CHECK_EQ(device.read_count, 1u);
+  CHECK_EQ(device.register_reads[TEST_REG_C], 0u);
+  device.Reg8(MODIF_I2C_INT_MASK_REG) = 0xFF;
+}
+
+//a reset flag makes all stored values unknown, without refreshing any groups
+static void _Test_ResetFlag(TestIntDevice& device, TestIntInterface& iface) {
+  _Interrupt(device, TEST_INT_A | TEST_INT_B);
+  _Run(2);
+  CHECK(iface.registers.IsValid(TEST_REG_A));
+  CHECK(iface.registers.IsValid(TEST_REG_B));
+
+  device.ClearReads();
+  _Interrupt(device, MODIF_I2C_INT_RESET_FLAG | TEST_INT_A);
+  _Run(2);
+  CHECK_EQ(device.read_count, 1u);
+  CHECK(!iface.registers.IsValid(TEST_REG_A));
+  CHECK(!iface.registers.IsValid(TEST_REG_B));
+  CHECK(!iface.registers.IsValid(TEST_REG_C));
+  CHECK_EQ(device.Reg8(MODIF_I2C_INT_FLAGS_REG), 0);
+}
+
+//an interrupt whose EXTI was missed is picked up by the pin check of the next loop cycle - but only once per handling
+static void _Test_MissedInterrupt(TestIntDevice& device, TestIntInterface& iface) {
+  device.Reg8(TEST_REG_A) = 0x77;
+  device.ClearReads();
+
+  device.Raise(TEST_INT_A);
+  CHECK_EQ(device.read_count, 0u);
+  _iface->LoopTasks();
+  _iface->LoopTasks();
+  _iface->HandleInterrupt(IF_EXTI, device.int_pin);
+  _Run(2);
+  CHECK_EQ(device.register_reads[MODIF_I2C_INT_FLAGS_REG], 1u);
+  CHECK_EQ(device.register_reads[TEST_REG_A], 1u);
+  CHECK_EQ(iface.registers.Reg8(TEST_REG_A), 0x77);
+
+  //EXTIs of other pins are ignored
+  device.ClearReads();
+  _iface->HandleInterrupt(IF_EXTI, (uint16_t)(device.int_pin << 1));
+  _Run(2);
+  CHECK_EQ(device.read_count, 0u);
+}
+
+//without interrupts, all groups are refreshed once per watchdog period
+static void _Test_Watchdog(TestIntDevice& device, TestIntInterface& iface) {
+  int i;
+
+  iface.TestSetRefreshGroups(_test_groups, sizeof(_test_groups) / sizeof(IntRegI2CRefreshGroup), TEST_WATCHDOG_PERIOD);
+
+  //align to the start of a watchdog period
+  for (i = 0; i < TEST_WATCHDOG_PERIOD && device.register_reads[TEST_REG_C] == 0; i++) {
+    _Run(1);
+  }
+  device.ClearReads();
+
+  _Run(TEST_WATCHDOG_PERIOD - 1);
+  CHECK_EQ(device.read_count, 0u);
+  _Run(2);
+  //A+B merged, C, LARGE, AFTER_LARGE
+  CHECK_EQ(device.read_count, 4u);
+  CHECK_EQ(device.register_reads[MODIF_I2C_INT_FLAGS_REG], 0u);
+  for (const IntRegI2CRefreshGroup& group : _test_groups) {
+    CHECK_EQ(device.register_reads[group.reg_addr_first], 1u);
+    CHECK(iface.registers.IsValid(group.reg_addr_first));
+  }
+
+  _Run(TEST_WATCHDOG_PERIOD);
+  CHECK_EQ(device.read_count, 8u);
+
+  iface.TestSetRefreshGroups(_test_groups, sizeof(_test_groups) / sizeof(IntRegI2CRefreshGroup), MODIF_I2C_REFRESH_WATCHDOG_PERIOD);
+}
+
+//refresh group table validation
+static void _Test_GroupValidation(TestIntDevice& device, TestIntInterface& iface) {
+  static const IntRegI2CRefreshGroup invalid_reg[] = { { TEST_INT_A, TEST_REG_A + 3, 1 } };
+  static const IntRegI2CRefreshGroup oversized[] = { { TEST_INT_LARGE, TEST_REG_LARGE, 2 } };
+  static const IntRegI2CRefreshGroup overrun[] = { { TEST_INT_A, 0xFF, 2 } };
+
+  int thrown = 0;
+  try { iface.TestSetRefreshGroups(NULL, 1, TEST_WATCHDOG_PERIOD); } catch (const std::invalid_argument&) { thrown++; }
+  try { iface.TestSetRefreshGroups(_test_groups, 1, 0); } catch (const std::invalid_argument&) { thrown++; }
+  try { iface.TestSetRefreshGroups(invalid_reg, 1, TEST_WATCHDOG_PERIOD); } catch (const std::invalid_argument&) { thrown++; }
+  try { iface.TestSetRefreshGroups(oversized, 1, TEST_WATCHDOG_PERIOD); } catch (const std::invalid_argument&) { thrown++; }
+  try { iface.TestSetRefreshGroups(overrun, 1, TEST_WATCHDOG_PERIOD); } catch (const std::invalid_argument&) { thrown++; }
+  CHECK_EQ(thrown, 5);
+
+  //failed validation keeps the previous table
+  device.ClearReads();
+  _Interrupt(device, TEST_INT_C);
+  _Run(2);
+  CHECK_EQ(device.register_reads[TEST_REG_C], 1u);
+}
+
+
+//DAP module stand-in: identifies itself, everything else is plain register storage
+class TestDAPDevice : public TestIntDevice {
+public:
+  TestDAPDevice(const uint16_t* reg_sizes, GPIO_TypeDef* int_port, uint16_t int_pin) :
+      TestIntDevice(TEST_DAP_I2C_ADDR, reg_sizes, int_port, int_pin, IF_DAP_USE_CRC) {
+    this->Reg8(I2CDEF_DAP_MODULE_ID) = I2CDEF_DAP_MODULE_ID_VALUE;
+  }
+};
+
+//the real DAP interface: initialisation enables the interrupts, status and input changes are picked up through their refresh groups
+static void _Test_DAP() {
+  static const uint16_t dap_reg_sizes[256] = I2CDEF_DAP_REG_SIZES;
+  GPIO_TypeDef port = {};
+
+  SimI2CBus bus;
+  I2CHardwareInterface hw(&bus.handle, _HardwareReset);
+  TestDAPDevice device(dap_reg_sizes, &port, TEST_INT_PIN);
+  DAPInterface dap(hw, TEST_DAP_I2C_ADDR, &port, TEST_INT_PIN);
+  bus.AddDevice(&device);
+  _bus = &bus;
+  _hw = &hw;
+  _iface = &dap;
+  hw.Init();
+  dap.Init();
+
+  int init_result = -1;
+  dap.InitModule([&init_result](bool success) {
+    init_result = success ? 1 : 0;
+  });
+  _Run(20);
+  CHECK_EQ(init_result, 1);
+  CHECK_EQ(device.Reg8(I2CDEF_DAP_INT_MASK), 0x3F);
+  CHECK((device.Reg8(I2CDEF_DAP_CONTROL) & I2CDEF_DAP_CONTROL_INT_EN_Msk) != 0);
+
+  uint32_t status_events = 0, input_events = 0, reset_events = 0;
+  dap.RegisterCallback([&](EventSource*, uint32_t event) {
+    if (event == MODIF_DAP_EVENT_STATUS_UPDATE) {
+      status_events++;
+    } else if (event == MODIF_DAP_EVENT_INPUTS_UPDATE) {
+      input_events++;
+    } else if (event == MODIF_EVENT_MODULE_RESET) {
+      reset_events++;
+    }
+  }, MODIF_DAP_EVENT_STATUS_UPDATE | MODIF_DAP_EVENT_INPUTS_UPDATE | MODIF_EVENT_MODULE_RESET);
+
+  //USB connection: flags read, flags clear, status read - and nothing else, at about 0.5ms of bus time per transfer
+  device.Reg8(I2CDEF_DAP_STATUS) = I2CDEF_DAP_STATUS_STREAMING_Msk | I2CDEF_DAP_STATUS_USB_CONN_Msk;
+  device.ClearReads();
+  uint32_t transfers_before = bus.transfer_count;
+  double busy_before = bus.busy_time_ms;
+  _Interrupt(device, I2CDEF_DAP_INT_FLAGS_INT_STATUS_Msk);
+  _Run(2);
+  CHECK_EQ(status_events, 1u);
+  CHECK_EQ(dap.GetStatus().value, I2CDEF_DAP_STATUS_STREAMING_Msk | I2CDEF_DAP_STATUS_USB_CONN_Msk);
+  CHECK_EQ(device.read_count, 2u);
+  CHECK_EQ(device.register_reads[I2CDEF_DAP_STATUS], 1u);
+  CHECK_EQ(bus.transfer_count - transfers_before, 3u);
+  double busy_ms = bus.busy_time_ms - busy_before;
+  CHECK_MSG(busy_ms > 1.0 && busy_ms < 2.5, "interrupt handling took %.2f ms of bus time", busy_ms);
+
+  //input change: active input and available inputs are adjacent, one read
+  device.Reg8(I2CDEF_DAP_INPUT_ACTIVE) = I2CDEF_DAP_INPUT_ACTIVE_USB;
+  device.Reg8(I2CDEF_DAP_INPUTS_AVAILABLE) = 0x0F;
+  device.ClearReads();
+  _Interrupt(device, I2CDEF_DAP_INT_FLAGS_INT_ACTIVE_INPUT_Msk | I2CDEF_DAP_INT_FLAGS_INT_INPUT_AVAILABLE_Msk);
+  _Run(2);
+  CHECK_EQ(device.read_count, 2u);
+  CHECK_EQ(device.register_reads[I2CDEF_DAP_INPUT_ACTIVE], 1u);
+  CHECK_EQ(device.register_reads[I2CDEF_DAP_INPUTS_AVAILABLE], 1u);
+  CHECK_EQ(device.register_reads[I2CDEF_DAP_STATUS], 0u);
+  CHECK_EQ(dap.registers.Reg8(I2CDEF_DAP_INPUT_ACTIVE), I2CDEF_DAP_INPUT_ACTIVE_USB);
+  CHECK(input_events >= 1u);
+
+  //spurious module reset: re-initialisation, then the reset event
+  uint32_t warnings_before = host_debug_log_counts[DEBUG_WARNING];
+  device.Reg8(I2CDEF_DAP_INT_MASK) = 0;
+  device.ClearReads();
+  _Interrupt(device, MODIF_I2C_INT_RESET_FLAG);
+  _Run(20);
+  CHECK_EQ(reset_events, 1u);
+  CHECK_EQ(host_debug_log_counts[DEBUG_WARNING], warnings_before + 1);
+  CHECK_EQ(device.register_reads[I2CDEF_DAP_MODULE_ID], 1u);
+  CHECK_EQ(device.Reg8(I2CDEF_DAP_INT_MASK), 0x3F);
+}
+
+
+int main() {
+  _InitRegSizes();
+
+  GPIO_TypeDef port = {};
+  SimI2CBus bus;
+  I2CHardwareInterface hw(&bus.handle, _HardwareReset);
+  TestIntDevice device(TEST_I2C_ADDR, _test_reg_sizes, &port, TEST_INT_PIN);
+  TestIntInterface iface(hw, &port);
+  bus.AddDevice(&device);
+  device.Reg8(MODIF_I2C_INT_MASK_REG) = 0xFF;
+  _bus = &bus;
+  _hw = &hw;
+  _iface = &iface;
+  hw.Init();
+  iface.Init();
+
+  _Test_FlaggedGroups(device, iface);
+  _Test_ResetFlag(device, iface);
+  _Test_MissedInterrupt(device, iface);
+  _Test_Watchdog(device, iface);
+  _Test_GroupValidation(device, iface);
+
+  _Test_DAP();
+
+  return HOST_TestSummary("test_module_interrupts");
+}
@@ -0,0 +1,345 @@
+/*
+ * test_operation_queue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the manager operation queue (operation_queue.cpp), used through a small manager that follows the
+ *  pattern of the high-level managers (try to lock, otherwise queue; asynchronous completion unlocks): lock timeout,
+ *  start order of queued operations and their completion callbacks, coalescing of same-kind operations, synchronous
+ *  completions without recursion, re-queueing when the lock is taken before a queued operation starts, and errors (start
+ *  failures reported to the operation's callback).
+ */
+
+#include "host_test.h"
+#include "operation_queue.h"
+#include "system.h"
+#include <string>
+#include <vector>
+
+
+#define TEST_LOCK_TIMEOUT_CYCLES 20
+
+#define TEST_OP_VALUE 1
+#define TEST_OP_OTHER 2
+
+
+//manager stand-in: value setter that completes asynchronously (like a module write), optionally synchronously
+class TestManager {
+public:
+  OperationQueue operations;
+
+  int value;
+  std::vector<std::string> events;
+  std::deque<std::function<void(bool)>> pending;
+
+  int depth;
+  int max_depth;
+
+  TestManager() : operations("TestManager"), value(0), depth(0), max_depth(0) {}
+
+  void Log(const char* fmt, int arg) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), fmt, arg);
+    this->events.push_back(buf);
+  }
+
+  SuccessCallback MakeCallback(int id) {
+    return [this, id](bool success) {
+      this->Log(success ? "cb %d" : "cb %d fail", id);
+    };
+  }
+
+  void SetValue(int new_value, SuccessCallback&& callback, bool queue_if_busy, OperationKind kind = TEST_OP_VALUE, bool sync = false) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!this->operations.TryLock(TEST_LOCK_TIMEOUT_CYCLES)) {
+      if (queue_if_busy) {
+        this->operations.Push(kind, [this, new_value, kind, sync](SuccessCallback&& callback) {
+          this->SetValue(new_value, std::move(callback), true, kind, sync);
+        }, std::move(callback));
+        __set_PRIMASK(primask);
+      } else {
+        __set_PRIMASK(primask);
+        if (callback) {
+          callback(false);
+        }
+      }
+      return;
+    }
+    __set_PRIMASK(primask);
+
+    this->Log("start %d", new_value);
+
+    auto complete = [this, new_value, callback = std::move(callback)](bool success) {
+      if (success) {
+        this->value = new_value;
+      }
+      this->Log("done %d", new_value);
+      this->operations.Unlock(callback, success);
+    };
+
+    if (sync) {
+      this->depth++;
+      if (this->depth > this->max_depth) {
+        this->max_depth = this->depth;
+      }
+      complete(true);
+      this->depth--;
+    } else {
+      this->pending.push_back(std::move(complete));
+    }
+  }
+
+  void CompleteNext(bool success) {
+    CHECK(!this->pending.empty());
+    if (this->pending.empty()) {
+      return;
+    }
+    auto complete = std::move(this->pending.front());
+    this->pending.pop_front();
+    complete(success);
+  }
+
+  //events since the last call, as one string
+  std::string TakeEvents() {
+    std::string result;
+    for (auto& event : this->events) {
+      if (!result.empty()) {
+        result += ", ";
+      }
+      result += event;
+    }
+    this->events.clear();
+    return result;
+  }
+};
+
+
+#define CHECK_EVENTS(manager, expected) do { \
+  std::string __events = (manager).TakeEvents(); \
+  CHECK_MSG(__events == (expected), "events \"%s\", expected \"%s\"", __events.c_str(), (expected)); \
+} while (0)
+
+
+//lock, unlock, reset, and lock timeout in the loop task
+static void _Test_Lock() {
+  OperationQueue queue("LockTest");
+
+  CHECK(!queue.IsLocked());
+  CHECK(queue.TryLock(3));
+  CHECK(queue.IsLocked());
+  CHECK(!queue.TryLock(3));
+  queue.Unlock();
+  CHECK(!queue.IsLocked());
+
+  CHECK(queue.TryLock(3));
+  queue.ResetLock();
+  CHECK(!queue.IsLocked());
+
+  uint32_t warnings_before = host_debug_log_counts[DEBUG_WARNING];
+  CHECK(queue.TryLock(3));
+  queue.LoopTasks();
+  queue.LoopTasks();
+  CHECK(queue.IsLocked());
+  queue.LoopTasks();
+  CHECK(!queue.IsLocked());
+  CHECK_EQ(host_debug_log_counts[DEBUG_WARNING], warnings_before + 1);
+}
+
+//queued operations start right after the previous one completes, and each completion callback runs before the next operation starts
+static void _Test_Order() {
+  TestManager manager;
+
+  manager.SetValue(1, manager.MakeCallback(1), true);
+  manager.SetValue(2, manager.MakeCallback(2), true, TEST_OP_VALUE);
+  manager.SetValue(3, manager.MakeCallback(3), true, TEST_OP_OTHER);
+  CHECK_EVENTS(manager, "start 1");
+
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 1, cb 1, start 2");
+  CHECK_EQ(manager.value, 1);
+
+  manager.CompleteNext(false);
+  CHECK_EVENTS(manager, "done 2, cb 2 fail, start 3");
+
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 3, cb 3");
+  CHECK(!manager.operations.IsLocked());
+  CHECK_EQ(manager.value, 3);
+
+  //not queued if busy: immediate failure
+  manager.SetValue(4, manager.MakeCallback(4), true);
+  manager.SetValue(5, manager.MakeCallback(5), false);
+  CHECK_EVENTS(manager, "start 4, cb 5 fail");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 4, cb 4");
+}
+
+//a completion callback reacting with a new operation gets it in before the queued ones
+static void _Test_CallbackFollowUp() {
+  TestManager manager;
+
+  manager.SetValue(1, [&manager](bool success) {
+    manager.Log("cb %d", 1);
+    manager.SetValue(10, manager.MakeCallback(10), true, TEST_OP_OTHER);
+  }, true);
+  manager.SetValue(2, manager.MakeCallback(2), true);
+  CHECK_EVENTS(manager, "start 1");
+
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 1, cb 1, start 10");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 10, cb 10, start 2");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 2, cb 2");
+}
+
+//a newer queued operation of the same kind supersedes the older one, whose callback receives the newer result; kind 0 is never coalesced
+static void _Test_Coalescing() {
+  TestManager manager;
+
+  manager.SetValue(1, manager.MakeCallback(1), true);
+  manager.SetValue(2, manager.MakeCallback(2), true, TEST_OP_VALUE);
+  manager.SetValue(3, manager.MakeCallback(3), true, OP_KIND_NONE);
+  manager.SetValue(4, manager.MakeCallback(4), true, TEST_OP_VALUE);
+  manager.SetValue(5, manager.MakeCallback(5), true, OP_KIND_NONE);
+  manager.SetValue(6, manager.MakeCallback(6), true, TEST_OP_VALUE);
+  CHECK_EVENTS(manager, "start 1");
+
+  //the superseding operation takes the place of the superseded one in the queue
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 1, cb 1, start 6");
+  manager.CompleteNext(false);
+  CHECK_EVENTS(manager, "done 6, cb 2 fail, cb 4 fail, cb 6 fail, start 3");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 3, cb 3, start 5");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 5, cb 5");
+  CHECK_EQ(manager.value, 5);
+
+  //a later operation of another kind stays after the superseded one (e.g. volume change, power off, volume change: the volume
+  //change isn't moved behind the power off)
+  manager.SetValue(7, manager.MakeCallback(7), true);
+  manager.SetValue(8, manager.MakeCallback(8), true, TEST_OP_VALUE);
+  manager.SetValue(9, manager.MakeCallback(9), true, TEST_OP_OTHER);
+  manager.SetValue(10, manager.MakeCallback(10), true, TEST_OP_VALUE);
+  CHECK_EVENTS(manager, "start 7");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 7, cb 7, start 10");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 10, cb 8, cb 10, start 9");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 9, cb 9");
+  CHECK_EQ(manager.value, 9);
+}
+
+//synchronously completing operations all run from one unlock, without nesting
+static void _Test_SyncCompletion() {
+  TestManager manager;
+  int i, callbacks = 0;
+
+  manager.SetValue(1, nullptr, true);
+  for (i = 0; i < 50; i++) {
+    manager.SetValue(100 + i, [&callbacks](bool success) { callbacks++; }, true, OP_KIND_NONE, true);
+  }
+  manager.TakeEvents();
+
+  manager.CompleteNext(true);
+  CHECK_EQ(callbacks, 50);
+  CHECK_EQ(manager.value, 149);
+  CHECK_EQ(manager.max_depth, 1);
+  CHECK(!manager.operations.IsLocked());
+  CHECK(manager.pending.empty());
+}
+
+//the lock is taken (e.g. from an interrupt) between dequeueing and starting an operation: the operation re-queues itself
+static void _Test_Requeue() {
+  TestManager manager;
+
+  manager.SetValue(1, manager.MakeCallback(1), true);
+  manager.operations.Push(OP_KIND_NONE, [&manager](SuccessCallback&& callback) {
+    manager.SetValue(20, manager.MakeCallback(20), true, TEST_OP_OTHER);
+    manager.SetValue(2, std::move(callback), true);
+  }, manager.MakeCallback(2));
+  CHECK_EVENTS(manager, "start 1");
+
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 1, cb 1, start 20");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 20, cb 20, start 2");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 2, cb 2");
+}
+
+//invalid operations, operations failing to start, throwing callbacks, and the loop task fallback
+static void _Test_Errors() {
+  TestManager manager;
+
+  bool thrown = false;
+  try {
+    manager.operations.Push(OP_KIND_NONE, nullptr, nullptr);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+
+  //start failure is logged and reported to the operation's callback (even if the operation moved it away before failing), the
+  //next operation still starts
+  uint32_t errors_before = host_debug_log_counts[DEBUG_ERROR];
+  manager.SetValue(1, manager.MakeCallback(1), true);
+  manager.operations.Push(OP_KIND_NONE, [](SuccessCallback&&) {
+    throw std::runtime_error("start failure");
+  }, nullptr);
+  manager.operations.Push(OP_KIND_NONE, [](SuccessCallback&& callback) {
+    SuccessCallback moved = std::move(callback);
+    throw std::runtime_error("start failure");
+  }, manager.MakeCallback(11));
+  manager.operations.Push(OP_KIND_NONE, [](SuccessCallback&&) {
+    throw 12;
+  }, manager.MakeCallback(12));
+  manager.SetValue(2, manager.MakeCallback(2), true, OP_KIND_NONE);
+  manager.CompleteNext(true);
+  CHECK_EQ(host_debug_log_counts[DEBUG_ERROR], errors_before + 3);
+  CHECK_EVENTS(manager, "start 1, done 1, cb 1, cb 11 fail, cb 12 fail, start 2");
+  manager.CompleteNext(true);
+  manager.TakeEvents();
+
+  //throwing completion callback: propagates to the completing context, the next operation is started anyway
+  manager.SetValue(3, [](bool) { throw std::runtime_error("callback failure"); }, true);
+  manager.SetValue(4, manager.MakeCallback(4), true, OP_KIND_NONE);
+  thrown = false;
+  try {
+    manager.CompleteNext(true);
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK_EVENTS(manager, "start 3, done 3, start 4");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 4, cb 4");
+
+  //reset doesn't start queued operations, the loop task does
+  manager.SetValue(5, manager.MakeCallback(5), true);
+  manager.SetValue(6, manager.MakeCallback(6), true);
+  manager.pending.clear();
+  manager.operations.ResetLock();
+  CHECK_EVENTS(manager, "start 5");
+  manager.operations.LoopTasks();
+  CHECK_EVENTS(manager, "start 6");
+  manager.CompleteNext(true);
+  CHECK_EVENTS(manager, "done 6, cb 6");
+}
+
+
+int main() {
+  _Test_Lock();
+  _Test_Order();
+  _Test_CallbackFollowUp();
+  _Test_Coalescing();
+  _Test_SyncCompletion();
+  _Test_Requeue();
+  _Test_Errors();
+
+  return HOST_TestSummary("test_operation_queue");
+}
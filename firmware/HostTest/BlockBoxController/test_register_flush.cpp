@@ -0,0 +1,374 @@
+/*
+ * test_register_flush.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the register valid/dirty tracking (register_set.cpp) and the staged register flushes of
+ *  RegI2CModuleInterface (module_interface_i2c.cpp), against a register-file module on a simulated I2C bus: staging
+ *  skips known values, consecutive dirty registers are merged into one write and readback, unconfirmed registers stay
+ *  dirty, values staged during a flush survive it, and a module reset makes all values unknown again.
+ */
+
+#include "host_test.h"
+#include "module_interface_i2c.h"
+#include "sim_i2c.h"
+#include "system.h"
+
+
+#define TEST_I2C_ADDR 0x30
+
+//register map: a run of differently-sized registers, a gap, a register the module clamps on write, and the top two addresses
+#define TEST_REG_A 0x01
+#define TEST_REG_B 0x02
+#define TEST_REG_C 0x03
+#define TEST_REG_D 0x04
+#define TEST_REG_E 0x05
+#define TEST_REG_F 0x08
+#define TEST_REG_CLAMPED 0x09
+#define TEST_REG_TOP1 0xFE
+#define TEST_REG_TOP2 0xFF
+
+static uint16_t _test_reg_sizes[256];
+
+static void _InitRegSizes() {
+  memset(_test_reg_sizes, 0, sizeof(_test_reg_sizes));
+  _test_reg_sizes[TEST_REG_A] = 1;
+  _test_reg_sizes[TEST_REG_B] = 2;
+  _test_reg_sizes[TEST_REG_C] = 4;
+  _test_reg_sizes[TEST_REG_D] = 1;
+  _test_reg_sizes[TEST_REG_E] = 1;
+  _test_reg_sizes[TEST_REG_F] = 2;
+  _test_reg_sizes[TEST_REG_CLAMPED] = 1;
+  _test_reg_sizes[TEST_REG_TOP1] = 1;
+  _test_reg_sizes[TEST_REG_TOP2] = 1;
+}
+
+
+//module stand-in: only keeps the low nibble of the clamped register
+class TestDevice : public SimI2CDevice {
+public:
+  TestDevice() : SimI2CDevice(TEST_I2C_ADDR, _test_reg_sizes) {}
+
+protected:
+  bool OnRegisterWrite(uint8_t reg_addr, const uint8_t* value) override {
+    if (reg_addr == TEST_REG_CLAMPED) {
+      this->Reg8(reg_addr) = *value & 0x0F;
+      return true;
+    }
+    return this->SimI2CDevice::OnRegisterWrite(reg_addr, value);
+  }
+};
+
+//interface with access to the register set, like a module reset would need
+class TestInterface : public RegI2CModuleInterface {
+public:
+  TestInterface(I2CHardwareInterface& hw_interface) : RegI2CModuleInterface(hw_interface, TEST_I2C_ADDR, _test_reg_sizes) {}
+
+  void InvalidateAll() {
+    this->_registers.InvalidateAll();
+  }
+};
+
+
+static uint32_t _hw_reset_count = 0;
+
+static void _HardwareReset() {
+  _hw_reset_count++;
+}
+
+static SimI2CBus* _bus;
+static I2CHardwareInterface* _hw;
+static TestDevice* _device;
+static TestInterface* _iface;
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c) {
+  UNUSED(hi2c);
+  _hw->HandleInterrupt(IF_TX_COMPLETE);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c) {
+  UNUSED(hi2c);
+  _hw->HandleInterrupt(IF_RX_COMPLETE);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c) {
+  UNUSED(hi2c);
+  _hw->HandleInterrupt(IF_ERROR);
+}
+
+
+//runs bus transfers and main loop cycles until everything is done
+static void _Run() {
+  for (int i = 0; i < 100; i++) {
+    while (SimI2C_Process()) {}
+    _iface->LoopTasks();
+  }
+}
+
+static bool _Stage8(uint8_t reg_addr, uint8_t value) {
+  return _iface->StageRegister(reg_addr, &value);
+}
+
+static bool _Stage16(uint8_t reg_addr, uint16_t value) {
+  return _iface->StageRegister(reg_addr, (const uint8_t*)&value);
+}
+
+static bool _Stage32(uint8_t reg_addr, uint32_t value) {
+  return _iface->StageRegister(reg_addr, (const uint8_t*)&value);
+}
+
+//flushes and runs until done - returns the callback result, -1 if it wasn't called
+static int _Flush() {
+  int result = -1;
+  _iface->FlushRegistersAsync([&result](bool success) {
+    CHECK(result == -1);
+    result = success ? 1 : 0;
+  });
+  _Run();
+  return result;
+}
+
+
+//plain register set: layout, access checks, valid/dirty flags and the desired-value shadow
+static void _Test_RegisterSet() {
+  RegisterSet set(_test_reg_sizes);
+
+  CHECK(set[TEST_REG_B] == set[TEST_REG_A] + 1);
+  CHECK(set[TEST_REG_C] == set[TEST_REG_B] + 2);
+  CHECK(set[TEST_REG_F] == set[TEST_REG_E] + 1);
+
+  int thrown = 0;
+  try { set[0x06]; } catch (const std::invalid_argument&) { thrown++; }
+  try { set.Reg8(TEST_REG_B); } catch (const std::invalid_argument&) { thrown++; }
+  try { set.Reg16(TEST_REG_C); } catch (const std::invalid_argument&) { thrown++; }
+  try { set.Reg32(TEST_REG_A); } catch (const std::invalid_argument&) { thrown++; }
+  try { set.Desired(0x06); } catch (const std::invalid_argument&) { thrown++; }
+  try { set.Matches(TEST_REG_A, NULL); } catch (const std::invalid_argument&) { thrown++; }
+  CHECK_EQ(thrown, 6);
+
+  //valid flags, including the bitmap word edges
+  const uint8_t edges[] = { 0, 31, 32, 63, 64, 255 };
+  for (uint8_t reg : edges) {
+    CHECK(!set.IsValid(reg));
+    set.SetValid(reg, true);
+  }
+  for (uint8_t reg : edges) {
+    CHECK(set.IsValid(reg));
+  }
+  CHECK(!set.IsValid(1) && !set.IsValid(30) && !set.IsValid(33) && !set.IsValid(254));
+  set.SetValid(32, false);
+  CHECK(!set.IsValid(32) && set.IsValid(31) && set.IsValid(63));
+  set.InvalidateAll();
+  for (uint8_t reg : edges) {
+    CHECK(!set.IsValid(reg));
+  }
+
+  //dirty flags
+  CHECK(!set.AnyDirty());
+  set.SetDirty(255, true);
+  CHECK(set.AnyDirty() && set.IsDirty(255) && !set.IsDirty(254));
+  set.SetDirty(64, true);
+  set.SetDirty(255, false);
+  CHECK(set.AnyDirty() && set.IsDirty(64));
+  set.SetDirty(64, false);
+  CHECK(!set.AnyDirty());
+
+  //desired shadow: only readable once allocated, separate from the stored values
+  const RegisterSet& const_set = set;
+  bool logic_thrown = false;
+  try { const_set.Desired(TEST_REG_A); } catch (const std::logic_error&) { logic_thrown = true; }
+  CHECK(logic_thrown);
+  set.Reg16(TEST_REG_B) = 0x1234;
+  *(uint16_t*)set.Desired(TEST_REG_B) = 0xABCD;
+  CHECK_EQ(set.Reg16(TEST_REG_B), 0x1234);
+  CHECK_EQ(*(const uint16_t*)const_set.Desired(TEST_REG_B), 0xABCD);
+  CHECK(set.Desired(TEST_REG_C) == set.Desired(TEST_REG_B) + 2);
+
+  //matching needs a valid register
+  uint16_t value = 0x1234;
+  CHECK(!set.Matches(TEST_REG_B, &value));
+  set.SetValid(TEST_REG_B, true);
+  CHECK(set.Matches(TEST_REG_B, &value));
+  value = 0x1235;
+  CHECK(!set.Matches(TEST_REG_B, &value));
+}
+
+//staging against known and unknown register values
+static void _Test_Stage() {
+  _iface->InvalidateAll();
+
+  //unknown value: always dirty, even if the stored value happens to match
+  CHECK(_Stage8(TEST_REG_A, 0));
+  CHECK(_iface->registers.IsDirty(TEST_REG_A));
+
+  //known value after a read: matching values are not written, and drop a different value staged before
+  _iface->ReadRegister8(TEST_REG_D);
+  CHECK(_iface->registers.IsValid(TEST_REG_D));
+  CHECK(_Stage8(TEST_REG_D, 0x55));
+  CHECK(!_Stage8(TEST_REG_D, _iface->registers.Reg8(TEST_REG_D)));
+  CHECK(!_iface->registers.IsDirty(TEST_REG_D));
+
+  CHECK(_Stage8(TEST_REG_A, 0x11));
+  CHECK(_Stage16(TEST_REG_B, 0x2222));
+  CHECK_EQ(*_iface->registers.Desired(TEST_REG_A), 0x11);
+
+  bool thrown = false;
+  try { _Stage8(0x06, 0); } catch (const std::invalid_argument&) { thrown = true; }
+  CHECK(thrown);
+
+  //leave nothing staged
+  _Flush();
+  CHECK(!_iface->registers.AnyDirty());
+}
+
+//consecutive dirty registers are merged into one write and one readback each
+static void _Test_Merging() {
+  //nothing dirty: immediate success without traffic
+  uint32_t transfers_before = _bus->transfer_count;
+  bool called = false;
+  _iface->FlushRegistersAsync([&called](bool success) { called = success; });
+  CHECK(called);
+  CHECK_EQ(_bus->transfer_count, transfers_before);
+
+  _iface->InvalidateAll();
+  CHECK(_Stage8(TEST_REG_A, 0xA1));
+  CHECK(_Stage16(TEST_REG_B, 0xB2B2));
+  CHECK(_Stage32(TEST_REG_C, 0xC3C3C3C3));
+  CHECK(_Stage8(TEST_REG_E, 0xE5));
+  CHECK(_Stage16(TEST_REG_F, 0xF6F6));
+
+  uint32_t writes_before = _device->write_count;
+  uint32_t reads_before = _device->read_count;
+  uint32_t reg_writes_before = _device->register_write_count;
+  CHECK_EQ(_Flush(), 1);
+
+  //runs: A-C, E, F (D is not dirty, F follows a gap)
+  CHECK_EQ(_device->write_count - writes_before, 3);
+  CHECK_EQ(_device->read_count - reads_before, 3);
+  CHECK_EQ(_device->register_write_count - reg_writes_before, 5);
+  CHECK_EQ(_device->crc_error_count, 0);
+
+  CHECK_EQ(_device->Reg8(TEST_REG_A), 0xA1);
+  CHECK_EQ(_device->Reg16(TEST_REG_B), 0xB2B2);
+  CHECK_EQ(_device->Reg32(TEST_REG_C), 0xC3C3C3C3);
+  CHECK_EQ(_device->Reg8(TEST_REG_E), 0xE5);
+  CHECK_EQ(_device->Reg16(TEST_REG_F), 0xF6F6);
+  CHECK(!_iface->registers.AnyDirty());
+  CHECK(_iface->registers.IsValid(TEST_REG_C) && _iface->registers.Reg32(TEST_REG_C) == 0xC3C3C3C3);
+
+  //the confirmed values are known now: staging them again needs no write
+  CHECK(!_Stage8(TEST_REG_A, 0xA1));
+  CHECK(!_Stage32(TEST_REG_C, 0xC3C3C3C3));
+  CHECK(_Stage8(TEST_REG_D, 0xD4));
+  writes_before = _device->write_count;
+  CHECK_EQ(_Flush(), 1);
+  CHECK_EQ(_device->write_count - writes_before, 1);
+
+  //whole run dirty: one transfer for all of it
+  CHECK(_Stage8(TEST_REG_A, 0x01));
+  CHECK(_Stage16(TEST_REG_B, 0x0202));
+  CHECK(_Stage32(TEST_REG_C, 0x03030303));
+  CHECK(_Stage8(TEST_REG_D, 0x04));
+  CHECK(_Stage8(TEST_REG_E, 0x05));
+  writes_before = _device->write_count;
+  transfers_before = _bus->transfer_count;
+  CHECK_EQ(_Flush(), 1);
+  CHECK_EQ(_device->write_count - writes_before, 1);
+  CHECK_EQ(_bus->transfer_count - transfers_before, 2);
+
+  //register 255 is never part of a multi-register transfer
+  CHECK(_Stage8(TEST_REG_TOP1, 0x7E));
+  CHECK(_Stage8(TEST_REG_TOP2, 0x7F));
+  writes_before = _device->write_count;
+  CHECK_EQ(_Flush(), 1);
+  CHECK_EQ(_device->write_count - writes_before, 2);
+  CHECK_EQ(_device->Reg8(TEST_REG_TOP2), 0x7F);
+}
+
+//registers whose readback doesn't match stay dirty, as do registers restaged while their flush is running
+static void _Test_Confirmation() {
+  //module clamps the value: unconfirmed
+  CHECK(_Stage8(TEST_REG_CLAMPED, 0x35));
+  CHECK_EQ(_Flush(), 0);
+  CHECK(_iface->registers.IsDirty(TEST_REG_CLAMPED));
+  CHECK(_iface->registers.IsValid(TEST_REG_CLAMPED));
+  CHECK_EQ(_iface->registers.Reg8(TEST_REG_CLAMPED), 0x05);
+  //staging the value the module actually holds clears it
+  CHECK(!_Stage8(TEST_REG_CLAMPED, 0x05));
+  CHECK(!_iface->registers.AnyDirty());
+
+  //restaged during the flush: the first value is confirmed, the newer one stays dirty for the next flush
+  CHECK(_Stage8(TEST_REG_A, 0x10));
+  int result = -1;
+  _iface->FlushRegistersAsync([&result](bool success) { result = success ? 1 : 0; });
+  CHECK(_Stage8(TEST_REG_A, 0x20));
+  _Run();
+  CHECK_EQ(result, 1);
+  CHECK_EQ(_device->Reg8(TEST_REG_A), 0x10);
+  CHECK(_iface->registers.IsDirty(TEST_REG_A));
+  CHECK_EQ(_Flush(), 1);
+  CHECK_EQ(_device->Reg8(TEST_REG_A), 0x20);
+  CHECK(!_iface->registers.AnyDirty());
+}
+
+//module reset: known values are lost, so staging writes them again
+static void _Test_Reset() {
+  CHECK(!_Stage8(TEST_REG_A, 0x20));
+  _iface->InvalidateAll();
+  CHECK(_Stage8(TEST_REG_A, 0x20));
+  uint32_t writes_before = _device->write_count;
+  CHECK_EQ(_Flush(), 1);
+  CHECK_EQ(_device->write_count - writes_before, 1);
+  CHECK(!_Stage8(TEST_REG_A, 0x20));
+}
+
+//bus errors: retried transparently, persistent failures leave the registers dirty
+static void _Test_BusErrors() {
+  uint32_t resets_before = _hw_reset_count;
+  _device->nack_count = 2;
+  CHECK(_Stage16(TEST_REG_B, 0x4242));
+  CHECK_EQ(_Flush(), 1);
+  CHECK_EQ(_device->Reg16(TEST_REG_B), 0x4242);
+  CHECK_EQ(_hw_reset_count - resets_before, 2);
+  CHECK(!_iface->registers.AnyDirty());
+
+  _device->nack_count = 100;
+  CHECK(_Stage16(TEST_REG_B, 0x4343));
+  CHECK(_Stage8(TEST_REG_D, 0x44));
+  CHECK_EQ(_Flush(), 0);
+  CHECK(_iface->registers.IsDirty(TEST_REG_B) && _iface->registers.IsDirty(TEST_REG_D));
+  CHECK_EQ(_device->Reg16(TEST_REG_B), 0x4242);
+
+  _device->nack_count = 0;
+  CHECK_EQ(_Flush(), 1);
+  CHECK_EQ(_device->Reg16(TEST_REG_B), 0x4343);
+  CHECK_EQ(_device->Reg8(TEST_REG_D), 0x44);
+  CHECK(!_iface->registers.AnyDirty());
+}
+
+
+int main() {
+  _InitRegSizes();
+
+  SimI2CBus bus;
+  I2CHardwareInterface hw(&bus.handle, _HardwareReset);
+  TestDevice device;
+  TestInterface iface(hw);
+  bus.AddDevice(&device);
+  _bus = &bus;
+  _hw = &hw;
+  _device = &device;
+  _iface = &iface;
+  hw.Init();
+  iface.Init();
+
+  _Test_RegisterSet();
+  _Test_Stage();
+  _Test_Merging();
+  _Test_Confirmation();
+  _Test_Reset();
+  _Test_BusErrors();
+
+  return HOST_TestSummary("test_register_flush");
+}
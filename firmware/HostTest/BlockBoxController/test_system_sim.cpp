@@ -0,0 +1,210 @@
+/*
+ * test_system_sim.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  System simulation scenarios of the controller firmware (SystemSim/): init from power-up, power-on, a volume step, an EQ
+ *  preset switch, a phone-side Bluetooth volume change, idle operation with a streaming phone, and the battery time estimation
+ *  through charge current. Each scenario reports its latency and the bus traffic it caused; idle operation reports the load
+ *  of every bus. Latencies are simulated time - bus and protocol time at the firmware's peripheral settings, module delays as
+ *  assumed in sim_modules.h, and the loop period granularity - with the controller's CPU time taken as zero. The display coprocessor is instant and memory-mapped display
+ *  accesses are untimed (see sim_eve.h), so the OSPI load only covers the direct transfers.
+ */
+
+#include "host_test.h"
+#include "sim_system.h"
+
+
+//bus statistics snapshot, for the traffic of a scenario
+typedef struct {
+  uint64_t time_us;
+  uint32_t main_transfers;
+  double main_busy_ms;
+  uint32_t chg_transfers;
+  double chg_busy_ms;
+  double btrx_busy_ms;
+  double bms_busy_ms;
+  uint32_t ospi_transfers;
+  double ospi_busy_ms;
+} SimBusSnapshot;
+
+static SimBusSnapshot _Snapshot(const SimSystem& sim) {
+  SimBusSnapshot snap;
+  snap.time_us = SimTime_Now();
+  snap.main_transfers = sim.main_bus.transfer_count;
+  snap.main_busy_ms = sim.main_bus.busy_time_ms;
+  snap.chg_transfers = sim.chg_bus.transfer_count;
+  snap.chg_busy_ms = sim.chg_bus.busy_time_ms;
+  snap.btrx_busy_ms = sim.btrx_port.tx_busy_time_ms + sim.btrx_port.rx_busy_time_ms;
+  snap.bms_busy_ms = sim.bms_port.tx_busy_time_ms + sim.bms_port.rx_busy_time_ms;
+  snap.ospi_transfers = sim.eve.transfer_count;
+  snap.ospi_busy_ms = sim.eve.busy_time_ms;
+  return snap;
+}
+
+//prints a scenario line: latency and the main bus traffic since the snapshot
+static void _Report(const char* scenario, double latency_ms, const SimSystem& sim, const SimBusSnapshot& before) {
+  SimBusSnapshot now = _Snapshot(sim);
+  printf("  %-28s %9.2f ms   main I2C: %4u transfers, %7.2f ms busy\n", scenario, latency_ms, now.main_transfers - before.main_transfers,
+         now.main_busy_ms - before.main_busy_ms);
+}
+
+//runs until an asynchronous operation reports its result - returns the simulated time in ms, negative on failure or timeout
+static double _RunOperation(SimSystem& sim, const std::function<void(SuccessCallback&&)>& operation, uint64_t timeout_us) {
+  int result = -1;
+  operation([&result](bool success) {
+    result = success ? 1 : 0;
+  });
+  uint64_t time_us = sim.RunUntilCondition([&result]() { return result >= 0; }, timeout_us);
+  if (time_us == UINT64_MAX || result != 1) {
+    return -1.0;
+  }
+  return (double)time_us / 1000.0;
+}
+
+
+//first power-up (blank EEPROM) to the end of the init sequence (init screen left), with all modules initialised on the way
+static void _Scenario_Init(SimSystem& sim) {
+  SimBusSnapshot before = _Snapshot(sim);
+  sim.InitSystem();
+
+  //the GUI shows the init screen until the init sequence is done
+  BlockBoxV2GUIManager& gui = bbv2_system.gui_mgr;
+  uint64_t gui_time_us = sim.RunUntilCondition([&gui]() { return gui.GetCurrentScreen() == &gui.init_screen; }, 2000000);
+  CHECK(gui_time_us != UINT64_MAX);
+  uint64_t done_time_us = sim.RunUntilCondition([&gui]() { return gui.GetCurrentScreen() != &gui.init_screen; }, 10000000);
+  CHECK_MSG(done_time_us != UINT64_MAX, "init didn't complete within 10s");
+
+  double init_ms = (double)(SimTime_Now() - before.time_us) / 1000.0;
+  _Report("init (power-up to done)", init_ms, sim, before);
+  //500ms initial delay, module boot times, the Bluetooth init done at 1.5s after its reset, and the audio manager's DSP setup
+  //(about 0.8s of main bus transfers) - 4.2s as simulated
+  CHECK_MSG(init_ms > 3000.0 && init_ms < 5500.0, "init took %.1f ms", init_ms);
+
+  CHECK_EQ(sim.dap.reset_count, 1u);
+  CHECK_EQ(sim.dac.reset_count, 1u);
+  CHECK_EQ(sim.amp.reset_count, 0u);
+  CHECK_EQ(sim.btrx.reset_count, 1u);
+  CHECK(bbv2_system.bat_if.IsBatteryPresent());
+  CHECK(bbv2_system.chg_if.IsAdapterPresent());
+  CHECK(bbv2_system.amp_if.IsManualShutdownActive());
+  //the blank EEPROM holds no touch calibration, so the first boot proceeds to the calibration screen
+  CHECK(gui.GetCurrentScreen() == &gui.touch_cal_screen);
+  CHECK_EQ(sim.loop_exception_count, 0u);
+}
+
+static void _Scenario_PowerOn(SimSystem& sim) {
+  SimBusSnapshot before = _Snapshot(sim);
+  double ms = _RunOperation(sim, [](SuccessCallback&& cb) { bbv2_system.SetPowerState(true, std::move(cb)); }, 2000000);
+  _Report("power on", ms, sim, before);
+  CHECK_MSG(ms >= 0.0 && ms < 500.0, "power on took %.2f ms", ms);
+  CHECK(bbv2_system.IsPoweredOn());
+  CHECK(!bbv2_system.amp_if.IsManualShutdownActive());
+}
+
+static void _Scenario_VolumeStep(SimSystem& sim) {
+  float volume_before = bbv2_system.audio_mgr.GetCurrentVolumeDB();
+  SimBusSnapshot before = _Snapshot(sim);
+  double ms = _RunOperation(sim, [](SuccessCallback&& cb) { bbv2_system.audio_mgr.StepCurrentVolumeDB(true, std::move(cb)); }, 1000000);
+  _Report("volume step", ms, sim, before);
+  CHECK_MSG(ms >= 0.0 && ms < 50.0, "volume step took %.2f ms", ms);
+  CHECK(bbv2_system.audio_mgr.GetCurrentVolumeDB() > volume_before);
+}
+
+static void _Scenario_EQPresetSwitch(SimSystem& sim) {
+  AudioPathEQMode mode = (bbv2_system.audio_mgr.GetEQMode() == AUDIO_EQ_HIFI) ? AUDIO_EQ_POWER : AUDIO_EQ_HIFI;
+  SimBusSnapshot before = _Snapshot(sim);
+  double ms = _RunOperation(sim, [mode](SuccessCallback&& cb) { bbv2_system.audio_mgr.SetEQMode(mode, std::move(cb)); }, 5000000);
+  _Report("EQ preset switch", ms, sim, before);
+  CHECK_MSG(ms >= 0.0 && ms < 1000.0, "EQ preset switch took %.2f ms", ms);
+  CHECK_EQ(bbv2_system.audio_mgr.GetEQMode(), mode);
+}
+
+//phone volume change to the last gain register write it causes (bus time of the notification, loop pickup, gain writes)
+static void _Scenario_BluetoothVolume(SimSystem& sim) {
+  sim.btrx.ConnectPhone();
+  //the audio manager checks for new connections every 50 loops
+  sim.Run(1000000);
+  CHECK(bbv2_system.btrx_if.GetStatus().avrcp_link);
+
+  uint8_t phone_volume = (bbv2_system.btrx_if.GetAbsoluteVolume() > 64) ? 40 : 110;
+  float volume_before = bbv2_system.audio_mgr.GetCurrentVolumeDB();
+  SimBusSnapshot before = _Snapshot(sim);
+  sim.btrx.SetPhoneVolume(phone_volume);
+  sim.Run(500000);
+
+  uint64_t last_gain_write_us = MAX(MAX(sim.dap.last_write_us[I2CDEF_DAP_VOLUME_GAINS], sim.dap.last_write_us[I2CDEF_DAP_VOLUME_GAINS_DELAYED]),
+                                    sim.dac.last_write_us[I2CDEF_HIFIDAC_VOLUME]);
+  CHECK(last_gain_write_us > before.time_us);
+  double ms = (double)(last_gain_write_us - before.time_us) / 1000.0;
+  _Report("Bluetooth phone volume", ms, sim, before);
+  CHECK_MSG(ms < 50.0, "Bluetooth volume took %.2f ms", ms);
+  CHECK(bbv2_system.audio_mgr.GetCurrentVolumeDB() != volume_before);
+}
+
+//idle operation with a streaming phone: load of every bus from the periodic polling and notifications
+static void _Scenario_IdleLoad(SimSystem& sim) {
+  const double duration_ms = 10000.0;
+  SimBusSnapshot before = _Snapshot(sim);
+  sim.Run((uint64_t)(duration_ms * 1000.0));
+  SimBusSnapshot after = _Snapshot(sim);
+
+  double main_load = (after.main_busy_ms - before.main_busy_ms) / duration_ms;
+  double chg_load = (after.chg_busy_ms - before.chg_busy_ms) / duration_ms;
+  double btrx_load = (after.btrx_busy_ms - before.btrx_busy_ms) / duration_ms;
+  double bms_load = (after.bms_busy_ms - before.bms_busy_ms) / duration_ms;
+  double ospi_load = (after.ospi_busy_ms - before.ospi_busy_ms) / duration_ms;
+
+  printf("  idle bus load over %.0f s:\n", duration_ms / 1000.0);
+  printf("    main I2C (I2C5, %u bit/s):     %6.2f %%  (%.1f transfers/s)\n", sim.main_bus.bit_rate, main_load * 100.0,
+         (after.main_transfers - before.main_transfers) / (duration_ms / 1000.0));
+  printf("    charger I2C (I2C3, %u bit/s):  %6.2f %%  (%.1f transfers/s)\n", sim.chg_bus.bit_rate, chg_load * 100.0,
+         (after.chg_transfers - before.chg_transfers) / (duration_ms / 1000.0));
+  printf("    BTRX UART (%u baud, both dirs): %6.2f %%\n", sim.btrx_port.baud_rate, btrx_load * 100.0 / 2.0);
+  printf("    BMS UART (%u baud, both dirs):   %6.2f %%\n", sim.bms_port.baud_rate, bms_load * 100.0 / 2.0);
+  printf("    display OSPI (%u Hz, direct):   %6.2f %%  (%.1f transfers/s)\n", sim.eve.BusClock(), ospi_load * 100.0,
+         (after.ospi_transfers - before.ospi_transfers) / (duration_ms / 1000.0));
+
+  CHECK_MSG(main_load > 0.0 && main_load < 0.15, "main I2C idle load %.3f", main_load);
+  CHECK_MSG(chg_load > 0.0 && chg_load < 0.01, "charger I2C idle load %.3f", chg_load);
+  CHECK_MSG(btrx_load > 0.0 && btrx_load < 0.02, "BTRX UART idle load %.3f", btrx_load);
+  CHECK_MSG(bms_load > 0.0 && bms_load < 0.05, "BMS UART idle load %.3f", bms_load);
+  CHECK_EQ(sim.btrx_port.rx_lost_count + sim.bms_port.rx_lost_count, 0u);
+  CHECK_EQ(sim.loop_exception_count, 0u);
+}
+
+//battery time estimation through a short charge current (regeneration-like) and sustained charging: the short one only pauses
+//the estimation, sustained charging resets it
+static void _Scenario_BatteryTimeCharging(SimSystem& sim) {
+  //discharge long enough for an estimate
+  sim.Run(70000000);
+  CHECK(bbv2_system.power_mgr.GetBatteryTimeEstimate().time_sec > 0);
+
+  sim.bms.charge_current_mA = 2000;
+  sim.Run(3000000);
+  CHECK_MSG(bbv2_system.power_mgr.GetBatteryTimeEstimate().time_sec > 0, "estimate lost on a 3s charge current");
+
+  sim.Run(70000000);
+  CHECK_MSG(bbv2_system.power_mgr.GetBatteryTimeEstimate().time_sec == 0, "estimate kept through sustained charging");
+
+  sim.bms.charge_current_mA = 0;
+  sim.Run(5000000);
+  CHECK_EQ(sim.loop_exception_count, 0u);
+}
+
+
+int main() {
+  SimSystem sim;
+
+  printf("System simulation scenarios (simulated time, zero CPU time):\n");
+  _Scenario_Init(sim);
+  _Scenario_PowerOn(sim);
+  _Scenario_VolumeStep(sim);
+  _Scenario_EQPresetSwitch(sim);
+  _Scenario_BluetoothVolume(sim);
+  _Scenario_IdleLoad(sim);
+  _Scenario_BatteryTimeCharging(sim);
+
+  return HOST_TestSummary("bbc_test_system_sim");
+}
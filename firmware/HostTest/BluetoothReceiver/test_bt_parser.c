@@ -0,0 +1,392 @@
+/*
+ * test_bt_parser.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test and benchmark of the Bluetooth module notification parsing (bt_driver.c): keyword lookup against the
+ *  notification table, argument parsing of each notification type and its effect on the driver state, rejection of
+ *  malformed or unexpected notifications, and the receive path from the UART ring into the parse buffer (including
+ *  notifications wrapping around the ring end).
+ */
+
+#include "host_test.h"
+#include "bt_driver.h"
+
+//the driver itself, with access to its parse buffer, command state and parsers
+#include "bt_driver.c"
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+UART_HandleTypeDef huart6;
+
+static uint32_t uart_transmits = 0;
+static char uart_last_command[BT_CMDBUF_SIZE];
+static uint32_t host_errors = 0;
+
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef* huart) { return HAL_OK; }
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size) { return HAL_OK; }
+uint32_t HAL_UART_GetError(UART_HandleTypeDef* huart) { return HAL_UART_ERROR_NONE; }
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size) {
+  memcpy(uart_last_command, pData, Size);
+  uart_last_command[Size] = '\0';
+  uart_transmits++;
+  return HAL_OK;
+}
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {}
+void HAL_NVIC_SystemReset(void) {}
+
+HAL_StatusTypeDef UARTH_Notification_Event_Error(uint16_t error_code, bool high_priority) {
+  host_errors++;
+  return HAL_OK;
+}
+HAL_StatusTypeDef UARTH_Notification_Event_BTReset() { return HAL_OK; }
+void UARTH_ForceCheckChangeNotification() {}
+
+
+/* --------------------------------------- helpers --------------------------------------- */
+
+//parse a complete notification line (with CR) as if it had just been received
+static void _Parse(const char* line) {
+  strcpy(_parse_buffer, line);
+  _BT_ParseNotification();
+}
+
+//put the driver into a state with exactly the given command in flight (CMD_NONE for none), with an empty queue
+static void _SetInFlight(BT_Command command) {
+  _BT_ClearCommandQueue();
+  _cmd_in_flight_count = (command == CMD_NONE) ? 0 : 1;
+  _cmd_in_flight[0] = command;
+  _current_command = command;
+}
+
+//number of queued commands
+static uint32_t _QueueLength() {
+  uint32_t count = 0;
+  BT_CommandQueueItem* item;
+  for (item = _cmd_queue_head; item != NULL; item = item->next) {
+    count++;
+  }
+  return count;
+}
+
+//whether a command of the given type is queued
+static bool _IsQueued(BT_Command command) {
+  BT_CommandQueueItem* item;
+  for (item = _cmd_queue_head; item != NULL; item = item->next) {
+    if (item->command == command) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+//table is sorted for the binary search, every keyword is found, prefixes and unknown keywords are not
+static void _Test_KeywordLookup() {
+  int i;
+  for (i = 0; i < _notification_type_count; i++) {
+    const char* keyword = _notification_types[i].keyword;
+    if (i > 0) {
+      CHECK_MSG(strcmp(_notification_types[i - 1].keyword, keyword) < 0, "%s", keyword);
+    }
+    CHECK(_BT_FindNotificationType(keyword, strlen(keyword)) == _notification_types + i);
+  }
+
+  CHECK(_BT_FindNotificationType("LINK_LOSS 1A", 4) == _BT_FindNotificationType("LINK", 4));
+  CHECK(_BT_FindNotificationType("LINK_", 5) == NULL);
+  CHECK(_BT_FindNotificationType("LINK_LOSSX", 10) == NULL);
+  CHECK(_BT_FindNotificationType("A", 1) == NULL);
+  CHECK(_BT_FindNotificationType("ZZZ", 3) == NULL);
+  CHECK(_BT_FindNotificationType("", 0) == NULL);
+}
+
+//init sequence: Ready queues the config read, config items queue corrections, OK after config queues the write
+static void _Test_Init() {
+  BT_Init();
+  CHECK_EQ(_current_command, CMD_INIT);
+
+  _Parse("Ready\r");
+  CHECK_EQ(_current_command, CMD_NONE);
+  CHECK(_IsQueued(CMD_CONFIG));
+
+  _SetInFlight(CMD_CONFIG);
+  _Parse("NAME=BlockBox v2 neo\r");
+  CHECK(!_init_config_changed);
+  CHECK_EQ(_QueueLength(), 0);
+  _Parse("POWERMAX=9\r");
+  CHECK(_init_config_changed);
+  CHECK(_IsQueued(CMD_SET));
+  //config items are only parsed as such while the config is read
+  _SetInFlight(CMD_NONE);
+  _init_config_changed = false;
+  _Parse("POWERMAX=9\r");
+  CHECK(!_init_config_changed);
+
+  _SetInFlight(CMD_CONFIG);
+  _init_config_changed = false;
+  _Parse("OK\r");
+  CHECK(bt_driver_state.init_complete);
+  CHECK_EQ(_current_command, CMD_NONE);
+}
+
+//connection lifecycle: open, name/RSSI/quality responses, volume, playback and metadata notifications, close and link loss
+static void _Test_Connection() {
+  const uint64_t addr = 0x001122334455ULL;
+
+  BT_Init();
+  bt_driver_state.init_complete = true;
+  _SetInFlight(CMD_NONE);
+
+  _Parse("OPEN_OK 1A A2DP 001122334455\r");
+  CHECK_EQ(bt_driver_state.connected_device_addr, addr);
+  CHECK_EQ(bt_driver_state.a2dp_link_id, 0x1A);
+  CHECK(_IsQueued(CMD_NAME) && _IsQueued(CMD_RSSI) && _IsQueued(CMD_QUALITY) && _IsQueued(CMD_VOLUME_GET));
+  _Parse("OPEN_OK 1B AVRCP 001122334455\r");
+  CHECK_EQ(bt_driver_state.avrcp_link_id, 0x1B);
+
+  //responses are only taken while their command is in flight
+  _SetInFlight(CMD_NONE);
+  _Parse("RSSI=-42\r");
+  CHECK_EQ(bt_driver_state.connected_device_rssi, 0);
+  _SetInFlight(CMD_RSSI);
+  _Parse("RSSI=-42\r");
+  CHECK_EQ(bt_driver_state.connected_device_rssi, -42);
+  _SetInFlight(CMD_QUALITY);
+  _Parse("QUALITY=200\r");
+  CHECK_EQ(bt_driver_state.connected_device_link_quality, 200);
+  _SetInFlight(CMD_NAME);
+  _Parse("NAME 001122334455 \"Alex's Phone\"\r");
+  CHECK(strcmp(bt_driver_state.connected_device_name, "Alex's Phone") == 0);
+  CHECK_EQ(_current_command, CMD_NONE);
+  _SetInFlight(CMD_VOLUME_GET);
+  _Parse("1A A2DP 77\r");
+  CHECK_EQ(bt_driver_state.abs_volume, 77);
+
+  //unprompted notifications
+  _SetInFlight(CMD_NONE);
+  _Parse("ABS_VOL 1B 100\r");
+  CHECK_EQ(bt_driver_state.abs_volume, 100);
+  _Parse("ABS_VOL 1C 20\r");
+  CHECK_EQ(bt_driver_state.abs_volume, 100);
+  _Parse("A2DP_STREAM_START 1A\r");
+  CHECK(bt_driver_state.a2dp_stream_active);
+  _Parse("A2DP_STREAM_SUSPEND 1A\r");
+  CHECK(!bt_driver_state.a2dp_stream_active);
+  _Parse("AVRCP_PLAY 1B\r");
+  CHECK(bt_driver_state.avrcp_playing);
+  _Parse("AVRCP_PAUSE 1B\r");
+  CHECK(!bt_driver_state.avrcp_playing);
+  _Parse("AVRCP_MEDIA TITLE: Song = Title\r");
+  _Parse("AVRCP_MEDIA ARTIST: Artist\r");
+  _Parse("AVRCP_MEDIA ALBUM: \r");
+  CHECK(strcmp(bt_driver_state.avrcp_title, "Song = Title") == 0);
+  CHECK(strcmp(bt_driver_state.avrcp_artist, "Artist") == 0);
+  CHECK(bt_driver_state.avrcp_album[0] == '\0');
+
+  //status update: STATE and LINK lines, completed by OK
+  _SetInFlight(CMD_STATUS);
+  _status_a2dp_link_id = _status_avrcp_link_id = 0;
+  _Parse("STATE CONNECTABLE[ON] DISCOVERABLE[OFF] ADVERTISING[OFF] SCAN_UNI[OFF]\r");
+  CHECK(bt_driver_state.connectable && !bt_driver_state.discoverable);
+  _Parse("LINK 1A CONNECTED A2DP 001122334455 STREAMING AAC SINK 44100\r");
+  CHECK_EQ(_status_a2dp_link_id, 0x1A);
+  CHECK_EQ(_status_a2dp_bt_addr, addr);
+  CHECK(_status_a2dp_stream_active);
+  CHECK(strcmp(_status_a2dp_codec, "AAC") == 0);
+  _Parse("LINK 1B CONNECTED AVRCP 001122334455 PLAYING\r");
+  CHECK_EQ(_status_avrcp_link_id, 0x1B);
+  CHECK(_status_avrcp_playing);
+  _Parse("OK\r");
+  CHECK(bt_driver_state.a2dp_stream_active && bt_driver_state.avrcp_playing);
+  CHECK(strcmp(bt_driver_state.a2dp_codec, "AAC") == 0);
+  CHECK_EQ(_current_command, CMD_NONE);
+
+  //close and link loss: connection ends with the last link
+  _SetInFlight(CMD_NONE);
+  _Parse("CLOSE_OK 1A A2DP\r");
+  CHECK_EQ(bt_driver_state.a2dp_link_id, 0);
+  CHECK_EQ(bt_driver_state.connected_device_addr, addr);
+  _Parse("LINK_LOSS 1B AVRCP\r");
+  CHECK_EQ(bt_driver_state.avrcp_link_id, 0);
+  CHECK_EQ(bt_driver_state.connected_device_addr, 0);
+  CHECK(bt_driver_state.connected_device_name[0] == '\0');
+}
+
+//errors and command completions
+static void _Test_Errors() {
+  BT_Init();
+  bt_driver_state.init_complete = true;
+
+  //error in a host-triggered command is reported to the host
+  _SetInFlight(CMD_VOLUME);
+  host_errors = 0;
+  _Parse("ERROR 0x0013\r");
+  CHECK_EQ(_current_command, CMD_NONE);
+  CHECK_EQ(host_errors, 1);
+
+  //open errors with and without reason
+  _SetInFlight(CMD_OPEN);
+  _Parse("OPEN_ERROR 001122334455 A2DP 2\r");
+  CHECK_EQ(_current_command, CMD_NONE);
+  _SetInFlight(CMD_OPEN);
+  _Parse("OPEN_ERROR 001122334455 A2DP\r");
+  CHECK_EQ(_current_command, CMD_NONE);
+
+  //scan results and completion
+  _SetInFlight(CMD_SCAN_BCAST);
+  _Parse("SCAN 2 001122334455 0x123456 0x01 Name -60\r");
+  CHECK_EQ(_current_command, CMD_SCAN_BCAST);
+  _Parse("SCAN_OK\r");
+  CHECK_EQ(_current_command, CMD_NONE);
+}
+
+//malformed, truncated or unexpected notifications leave the state untouched
+static void _Test_Malformed() {
+  BT_Init();
+  bt_driver_state.init_complete = true;
+  _SetInFlight(CMD_NONE);
+  _Parse("OPEN_OK 1A A2DP 001122334455\r");
+  _Parse("OPEN_OK 1B AVRCP 001122334455\r");
+  bt_driver_state.abs_volume = 50;
+  _SetInFlight(CMD_RSSI);
+
+  _Parse("RSSI\r");
+  _Parse("RSSI=\r");
+  _Parse("OK extra\r");
+  CHECK_EQ(_current_command, CMD_RSSI);
+  _Parse("SCAN_OK\r");
+  CHECK_EQ(_current_command, CMD_RSSI);
+  _Parse("ABS_VOL\r");
+  _Parse("ABS_VOL zz 10\r");
+  _Parse("ABSVOL 1B 10\r");
+  _Parse("ABS_VOL1B 10\r");
+  CHECK_EQ(bt_driver_state.abs_volume, 50);
+  _Parse("AVRCP_PLAY 1B 2\r");
+  _Parse("AVRCP_PLAY 100\r");
+  _Parse("AVRCP_PLAY\r");
+  CHECK(!bt_driver_state.avrcp_playing);
+  _Parse("AVRCP_MEDIA GENRE: Pop\r");
+  _Parse("CLOSE_OK 1A\r");
+  _Parse("LINK_LOSS\r");
+  CHECK_EQ(bt_driver_state.a2dp_link_id, 0x1A);
+  _Parse("\r");
+  _Parse("");
+  CHECK_EQ(_current_command, CMD_RSSI);
+  CHECK_EQ(bt_driver_state.connected_device_addr, 0x001122334455ULL);
+}
+
+//receive path: notifications arriving in pieces, several per reception, and wrapping around the ring end
+static void _Test_ReceivePath() {
+  const char* stream = "ABS_VOL 1B 11\rAVRCP_PLAY 1B\rAVRCP_MEDIA TITLE: Wrapped title\rABS_VOL 1B 12\r";
+  uint32_t length = strlen(stream);
+  uint32_t i;
+
+  BT_Init();
+  bt_driver_state.init_complete = true;
+  _SetInFlight(CMD_NONE);
+  _Parse("OPEN_OK 1B AVRCP 001122334455\r");
+
+  //start close to the ring end, so the title wraps around
+  _rx_buffer_write_offset = _rx_buffer_read_offset = BT_RXBUF_SIZE - 40;
+  uint32_t offset = _rx_buffer_write_offset;
+  for (i = 0; i < length; i += 7) {
+    uint32_t piece = MIN(7, length - i);
+    uint32_t j;
+    for (j = 0; j < piece; j++) {
+      _rx_buffer[(offset + j) % BT_RXBUF_SIZE] = (uint8_t)stream[i + j];
+    }
+    //the HAL reception ends at the ring end: report the two parts separately
+    if (offset + piece > BT_RXBUF_SIZE) {
+      BT_UARTEx_RxEventCallback(&huart6, (uint16_t)(BT_RXBUF_SIZE - offset));
+      BT_UARTEx_RxEventCallback(&huart6, (uint16_t)(offset + piece - BT_RXBUF_SIZE));
+    } else {
+      BT_UARTEx_RxEventCallback(&huart6, (uint16_t)piece);
+    }
+    offset = (offset + piece) % BT_RXBUF_SIZE;
+    if (i == 14) {
+      //first notification complete, second still partial
+      BT_Update(1);
+      CHECK_EQ(bt_driver_state.abs_volume, 11);
+      CHECK(!bt_driver_state.avrcp_playing);
+    }
+  }
+  BT_Update(1);
+  CHECK(bt_driver_state.avrcp_playing);
+  CHECK(strcmp(bt_driver_state.avrcp_title, "Wrapped title") == 0);
+  CHECK_EQ(bt_driver_state.abs_volume, 12);
+  CHECK_EQ(_rx_buffer_read_offset, _rx_buffer_write_offset);
+}
+
+//benchmark: keyword lookup (binary search vs. linear scan of the table) and full parsing of a typical notification mix
+static void _Benchmark() {
+  static const char* lines[] = {
+    "ABS_VOL 1B 64\r", "AVRCP_MEDIA TITLE: Some Song Title\r", "AVRCP_MEDIA ARTIST: Some Artist\r", "A2DP_STREAM_START 1A\r",
+    "AVRCP_PLAY 1B\r", "RSSI=-55\r", "QUALITY=210\r", "STATE CONNECTABLE[ON] DISCOVERABLE[OFF] ADVERTISING[OFF] SCAN_UNI[OFF]\r",
+    "LINK 1A CONNECTED A2DP 001122334455 STREAMING AAC SINK 44100\r", "LINK 1B CONNECTED AVRCP 001122334455 PLAYING\r"
+  };
+  const int line_count = sizeof(lines) / sizeof(lines[0]);
+  const int rounds = 20000;
+  volatile uintptr_t sink = 0;
+  int r, l, i;
+
+  uint64_t start = HOST_GetTimeNs();
+  for (r = 0; r < rounds; r++) {
+    for (l = 0; l < line_count; l++) {
+      sink += (uintptr_t)_BT_FindNotificationType(lines[l], strcspn(lines[l], " =\r"));
+    }
+  }
+  uint64_t binary_ns = HOST_GetTimeNs() - start;
+
+  start = HOST_GetTimeNs();
+  for (r = 0; r < rounds; r++) {
+    for (l = 0; l < line_count; l++) {
+      uint32_t keyword_length = strcspn(lines[l], " =\r");
+      for (i = 0; i < _notification_type_count; i++) {
+        if (strncmp(_notification_types[i].keyword, lines[l], keyword_length) == 0 && _notification_types[i].keyword[keyword_length] == '\0') {
+          sink += (uintptr_t)(_notification_types + i);
+          break;
+        }
+      }
+    }
+  }
+  uint64_t linear_ns = HOST_GetTimeNs() - start;
+
+  //full parse with every response expected
+  BT_Init();
+  _SetInFlight(CMD_NONE);
+  _Parse("OPEN_OK 1A A2DP 001122334455\r");
+  _Parse("OPEN_OK 1B AVRCP 001122334455\r");
+  start = HOST_GetTimeNs();
+  for (r = 0; r < rounds; r++) {
+    for (l = 0; l < line_count; l++) {
+      _cmd_in_flight[0] = CMD_STATUS;
+      _cmd_in_flight[1] = CMD_RSSI;
+      _cmd_in_flight[2] = CMD_QUALITY;
+      _cmd_in_flight_count = 3;
+      _current_command = CMD_STATUS;
+      _Parse(lines[l]);
+    }
+  }
+  uint64_t parse_ns = HOST_GetTimeNs() - start;
+
+  const double per_line = 1.0 / ((double)rounds * line_count);
+  printf("keyword lookup: binary search %.1f ns, linear scan %.1f ns per notification\n", binary_ns * per_line, linear_ns * per_line);
+  printf("full notification parse: %.1f ns per notification\n", parse_ns * per_line);
+}
+
+
+int main() {
+  _Test_KeywordLookup();
+  _Test_Init();
+  _Test_Connection();
+  _Test_Errors();
+  _Test_Malformed();
+  _Test_ReceivePath();
+  _Benchmark();
+
+  return HOST_TestSummary("test_bt_parser");
+}
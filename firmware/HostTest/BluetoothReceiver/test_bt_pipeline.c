@@ -0,0 +1,574 @@
+/*
+ * test_bt_pipeline.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the Bluetooth module command scheduling (bt_driver.c) against a simulated module on a simulated 9600 baud
+ *  UART (huart6): the module processes received commands one after another and answers each after a fixed processing time,
+ *  with command and response bytes taking their real transmission time. Checks the command pool (exhaustion, no leaks), the
+ *  pipelining limits, the in-order matching of responses to commands in flight, error and timeout handling within the
+ *  pipeline, and reports the init, connect and volume sequence durations in simulated time.
+ *  Built with pipelining, and with the former serial scheduling (one command in flight) with TEST_SERIAL_SCHEDULING.
+ */
+
+#include "host_test.h"
+#include "bt_driver.h"
+
+#ifdef TEST_SERIAL_SCHEDULING
+#undef BT_CMD_PIPELINE_DEPTH
+#define BT_CMD_PIPELINE_DEPTH 1
+#endif
+
+//the driver itself, with access to its command queue and pipeline state
+#include "bt_driver.c"
+
+
+/* --------------------------------------- simulated module --------------------------------------- */
+
+//UART byte time at 9600 baud 8N1, in us
+#define SIM_BYTE_US (10000000 / 9600)
+//module boot time from reset release to the Ready notification, in ms
+#define SIM_BOOT_MS 500
+//processing times per command, in ms - midpoints of the ranges in design_simulations/bt_pipeline_python
+#define SIM_PROC_CONFIG_MS 100
+#define SIM_PROC_SET_MS 20
+#define SIM_PROC_WRITE_MS 200
+#define SIM_PROC_STATUS_MS 30
+#define SIM_PROC_NAME_MS 500
+#define SIM_PROC_OTHER_MS 10
+
+#define SIM_LINE_QUEUE_SIZE 64
+#define SIM_OUTSTANDING_SIZE 16
+
+typedef struct {
+  char text[128];
+  uint64_t done_us; //time at which the last byte has been received by the MCU
+  bool final;       //last response line of the oldest outstanding command
+} SimLine;
+
+static SimLine sim_lines[SIM_LINE_QUEUE_SIZE];
+static uint32_t sim_lines_head = 0;
+static uint32_t sim_lines_count = 0;
+
+//commands sent by the driver and not fully answered yet, oldest first
+static BT_Command sim_outstanding[SIM_OUTSTANDING_SIZE];
+static uint32_t sim_outstanding_count = 0;
+
+//module config: working values, and the values stored in flash (loaded at reset, written by WRITE)
+static char sim_config_ram[BT_CONFIG_ARRAY_ENTRIES][128];
+static char sim_config_flash[BT_CONFIG_ARRAY_ENTRIES][128];
+
+static bool sim_connected = false;
+static uint64_t sim_module_free_us = 0;
+static uint64_t sim_line_free_us = 0;
+
+//command transmission in progress
+static bool sim_tx_active = false;
+static uint64_t sim_tx_done_us = 0;
+static char sim_tx_text[BT_CMDBUF_SIZE];
+
+//receive target armed by the driver
+static uint8_t* sim_rx_target = NULL;
+static uint32_t sim_rx_remaining = 0;
+
+//fault injection: answer the n-th following VOLUME command with an error (0 = off), drop the responses to the next command of the given type
+static uint32_t sim_error_volume_countdown = 0;
+static BT_Command sim_drop_command = CMD_NONE;
+
+//statistics
+static uint32_t sim_sets = 0;
+static uint32_t sim_writes = 0;
+static uint32_t sim_resets = 0;
+static uint32_t sim_commands = 0;
+static uint8_t sim_volumes[16];
+static uint32_t sim_volume_count = 0;
+static uint32_t sim_max_in_flight = 0;
+static bool sim_check_matching = true;
+
+static uint64_t _SimNowUs() {
+  return (uint64_t)host_tick_ms * 1000;
+}
+
+//queue a response line, sent after the given time and after all previous lines
+static void _SimSendLine(const char* text, uint64_t ready_us, bool final) {
+  CHECK(sim_lines_count < SIM_LINE_QUEUE_SIZE);
+  SimLine* line = sim_lines + ((sim_lines_head + sim_lines_count++) % SIM_LINE_QUEUE_SIZE);
+  strncpy(line->text, text, sizeof(line->text) - 1);
+  line->text[sizeof(line->text) - 1] = '\0';
+  uint64_t start_us = MAX(ready_us, sim_line_free_us);
+  line->done_us = start_us + strlen(line->text) * SIM_BYTE_US;
+  line->final = final;
+  sim_line_free_us = line->done_us;
+}
+
+//command type of a command line sent by the driver
+static BT_Command _SimCommandType(const char* text) {
+  static const struct { const char* keyword; BT_Command command; } keywords[] = {
+    { "CLOSE ALL\r", CMD_CLOSE_ALL }, { "CONFIG\r", CMD_CONFIG }, { "CONNECTABLE ", CMD_CONNECTABLE }, { "DISCOVERABLE ", CMD_DISCOVERABLE },
+    { "NAME ", CMD_NAME }, { "QUALITY ", CMD_QUALITY }, { "RSSI ", CMD_RSSI }, { "SET ", CMD_SET }, { "STATUS\r", CMD_STATUS },
+    { "VOLUME\r", CMD_VOLUME_GET }, { "VOLUME ", CMD_VOLUME }, { "WRITE\r", CMD_WRITE }
+  };
+  int i;
+  for (i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+    if (strncmp(text, keywords[i].keyword, strlen(keywords[i].keyword)) == 0) {
+      return keywords[i].command;
+    }
+  }
+  return CMD_NONE;
+}
+
+//module side: handle a completely received command
+static void _SimReceiveCommand(const char* text, uint64_t arrival_us) {
+  BT_Command command = _SimCommandType(text);
+  CHECK_MSG(command != CMD_NONE, "unexpected command %s", text);
+  sim_commands++;
+
+  uint32_t proc_ms = SIM_PROC_OTHER_MS;
+  switch (command) {
+    case CMD_CONFIG: proc_ms = SIM_PROC_CONFIG_MS; break;
+    case CMD_SET: proc_ms = SIM_PROC_SET_MS; break;
+    case CMD_WRITE: proc_ms = SIM_PROC_WRITE_MS; break;
+    case CMD_STATUS: proc_ms = SIM_PROC_STATUS_MS; break;
+    case CMD_NAME: proc_ms = SIM_PROC_NAME_MS; break;
+    default: break;
+  }
+  uint64_t done_us = MAX(arrival_us, sim_module_free_us) + proc_ms * 1000;
+  sim_module_free_us = done_us;
+
+  if (command == sim_drop_command) {
+    sim_drop_command = CMD_NONE;
+    return;
+  }
+
+  char line[128];
+  int i;
+  switch (command) {
+    case CMD_CONFIG:
+      for (i = 0; i < BT_CONFIG_ARRAY_ENTRIES; i++) {
+        snprintf(line, sizeof(line), "%s=%s\r", _config_array[2 * i], sim_config_ram[i]);
+        _SimSendLine(line, done_us, false);
+      }
+      break;
+    case CMD_SET:
+      for (i = 0; i < BT_CONFIG_ARRAY_ENTRIES; i++) {
+        const char* key = _config_array[2 * i];
+        if (strncmp(text + 4, key, strlen(key)) == 0 && text[4 + strlen(key)] == '=') {
+          strncpy(sim_config_ram[i], text + 5 + strlen(key), 127);
+          sim_config_ram[i][strcspn(sim_config_ram[i], "\r")] = '\0';
+        }
+      }
+      sim_sets++;
+      break;
+    case CMD_WRITE:
+      memcpy(sim_config_flash, sim_config_ram, sizeof(sim_config_flash));
+      sim_writes++;
+      break;
+    case CMD_STATUS:
+      _SimSendLine("STATE CONNECTABLE[ON] DISCOVERABLE[OFF] ADVERTISING[OFF] SCAN_UNI[OFF]\r", done_us, false);
+      if (sim_connected) {
+        _SimSendLine("LINK 1A CONNECTED A2DP 001122334455 STREAMING AAC SINK 44100\r", done_us, false);
+        _SimSendLine("LINK 1B CONNECTED AVRCP 001122334455 PLAYING\r", done_us, false);
+      }
+      break;
+    case CMD_NAME:
+      //answered by the name notification alone
+      _SimSendLine("NAME 001122334455 \"Alex's Phone\"\r", done_us, true);
+      return;
+    case CMD_RSSI:
+      _SimSendLine("RSSI=-42\r", done_us, false);
+      break;
+    case CMD_QUALITY:
+      _SimSendLine("QUALITY=200\r", done_us, false);
+      break;
+    case CMD_VOLUME_GET:
+      _SimSendLine("1A A2DP 64\r", done_us, false);
+      break;
+    case CMD_VOLUME:
+      if (sim_volume_count < sizeof(sim_volumes)) {
+        unsigned int link_id, volume;
+        sscanf(text, "VOLUME %X %u", &link_id, &volume);
+        sim_volumes[sim_volume_count++] = (uint8_t)volume;
+      }
+      if (sim_error_volume_countdown > 0 && --sim_error_volume_countdown == 0) {
+        _SimSendLine("ERROR 0x0013\r", done_us, true);
+        return;
+      }
+      break;
+    default:
+      break;
+  }
+  _SimSendLine("OK\r", done_us, true);
+}
+
+//module reset: drop everything in progress, reload the config from flash
+static void _SimReset() {
+  sim_lines_count = 0;
+  sim_outstanding_count = 0;
+  sim_tx_active = false;
+  memcpy(sim_config_ram, sim_config_flash, sizeof(sim_config_ram));
+  sim_module_free_us = _SimNowUs();
+  sim_line_free_us = _SimNowUs();
+}
+
+//factory-fresh module: no config entry matches the driver's
+static void _SimFactoryReset() {
+  int i;
+  for (i = 0; i < BT_CONFIG_ARRAY_ENTRIES; i++) {
+    strcpy(sim_config_flash[i], "0");
+  }
+  _SimReset();
+}
+
+//deliver received bytes into the armed receive buffer, with one idle event per line (split at the receive buffer end)
+static void _SimDeliver(const char* text) {
+  uint32_t length = strlen(text);
+  while (length > 0) {
+    CHECK(sim_rx_target != NULL && sim_rx_remaining > 0);
+    if (sim_rx_target == NULL || sim_rx_remaining == 0) {
+      return;
+    }
+    uint32_t chunk = MIN(length, sim_rx_remaining);
+    memcpy(sim_rx_target, text, chunk);
+    text += chunk;
+    length -= chunk;
+    sim_rx_target = NULL;
+    BT_UARTEx_RxEventCallback(&huart6, (uint16_t)chunk);
+  }
+}
+
+//advance the module and UART by one tick: command transmission complete, response lines received
+static void _SimUpdate() {
+  uint64_t now_us = _SimNowUs();
+
+  if (sim_tx_active && sim_tx_done_us <= now_us) {
+    sim_tx_active = false;
+    BT_UART_TxCpltCallback(&huart6);
+    _SimReceiveCommand(sim_tx_text, sim_tx_done_us);
+  }
+
+  while (sim_lines_count > 0 && sim_lines[sim_lines_head].done_us <= now_us) {
+    SimLine* line = sim_lines + sim_lines_head;
+    sim_lines_head = (sim_lines_head + 1) % SIM_LINE_QUEUE_SIZE;
+    sim_lines_count--;
+    if (line->final && sim_outstanding_count > 0) {
+      sim_outstanding_count--;
+      memmove(sim_outstanding, sim_outstanding + 1, sim_outstanding_count * sizeof(BT_Command));
+    }
+    _SimDeliver(line->text);
+  }
+}
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+UART_HandleTypeDef huart6;
+
+static uint32_t host_errors = 0;
+
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef* huart) {
+  sim_rx_target = NULL;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size) {
+  sim_rx_target = pData;
+  sim_rx_remaining = Size;
+  return HAL_OK;
+}
+uint32_t HAL_UART_GetError(UART_HandleTypeDef* huart) { return HAL_UART_ERROR_NONE; }
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size) {
+  CHECK(!sim_tx_active);
+  memcpy(sim_tx_text, pData, Size);
+  sim_tx_text[Size] = '\0';
+  sim_tx_active = true;
+  sim_tx_done_us = _SimNowUs() + Size * SIM_BYTE_US;
+  if (sim_outstanding_count < SIM_OUTSTANDING_SIZE) {
+    sim_outstanding[sim_outstanding_count++] = _SimCommandType(sim_tx_text);
+  }
+  return HAL_OK;
+}
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  if (GPIOx == BT_RST_N_GPIO_Port && GPIO_Pin == BT_RST_N_Pin) {
+    _SimReset();
+    if (PinState == GPIO_PIN_SET) {
+      //reset released: module boots and reports ready
+      sim_resets++;
+      _SimSendLine("Ready\r", _SimNowUs() + SIM_BOOT_MS * 1000, false);
+    }
+  }
+}
+void HAL_NVIC_SystemReset(void) {
+  CHECK_MSG(false, "unexpected MCU reset");
+}
+
+HAL_StatusTypeDef UARTH_Notification_Event_Error(uint16_t error_code, bool high_priority) {
+  host_errors++;
+  return HAL_OK;
+}
+HAL_StatusTypeDef UARTH_Notification_Event_BTReset() { return HAL_OK; }
+void UARTH_ForceCheckChangeNotification() {}
+
+
+/* --------------------------------------- main loop --------------------------------------- */
+
+static uint32_t loop_counter = 1;
+
+//number of free command queue items
+static uint32_t _FreeItems() {
+  uint32_t count = 0;
+  BT_CommandQueueItem* item;
+  for (item = _cmd_queue_free; item != NULL; item = item->next) {
+    count++;
+  }
+  return count;
+}
+
+//number of queued commands
+static uint32_t _QueueLength() {
+  uint32_t count = 0;
+  BT_CommandQueueItem* item;
+  for (item = _cmd_queue_head; item != NULL; item = item->next) {
+    count++;
+  }
+  return count;
+}
+
+//pipeline invariants, checked after every driver update
+static void _CheckInvariants() {
+  int i;
+
+  CHECK(_cmd_in_flight_count <= BT_CMD_PIPELINE_DEPTH);
+  sim_max_in_flight = MAX(sim_max_in_flight, _cmd_in_flight_count);
+  if (_cmd_in_flight_count > 1) {
+    uint32_t data_reads[3] = { 0 };
+    for (i = 0; i < _cmd_in_flight_count; i++) {
+      CHECK_MSG(_BT_IsCommandPipelinable(_cmd_in_flight[i]), "command %u pipelined", _cmd_in_flight[i]);
+      data_reads[0] += (_cmd_in_flight[i] == CMD_RSSI);
+      data_reads[1] += (_cmd_in_flight[i] == CMD_QUALITY);
+      data_reads[2] += (_cmd_in_flight[i] == CMD_VOLUME_GET);
+    }
+    CHECK(data_reads[0] <= 1 && data_reads[1] <= 1 && data_reads[2] <= 1);
+  }
+
+  //items in flight are back in the free list, so free + queued always covers the whole pool
+  CHECK_EQ(_FreeItems() + _QueueLength(), BT_CMD_QUEUE_SIZE);
+
+  //all responses received so far have been matched to the right commands: the driver's commands in flight are exactly the module's unanswered ones
+  if (sim_check_matching && _current_command != CMD_INIT) {
+    CHECK_EQ(_cmd_in_flight_count, sim_outstanding_count);
+    for (i = 0; i < MIN(_cmd_in_flight_count, sim_outstanding_count); i++) {
+      CHECK_EQ(_cmd_in_flight[i], sim_outstanding[i]);
+    }
+  }
+}
+
+//one 1 ms tick: simulated module and UART, and the driver update every main loop period
+static void _Step() {
+  HOST_AdvanceTime(1);
+  _SimUpdate();
+  if (host_tick_ms % MAIN_LOOP_PERIOD_MS == 0) {
+    BT_Update(loop_counter++);
+    _CheckInvariants();
+  }
+}
+
+static bool _Idle() {
+  return _cmd_in_flight_count == 0 && _cmd_queue_head == NULL && sim_lines_count == 0 && !sim_tx_active;
+}
+
+static bool _InitComplete() {
+  return bt_driver_state.init_complete && _Idle();
+}
+
+static bool _NameKnown() {
+  return bt_driver_state.connected_device_name[0] != '\0' && _Idle();
+}
+
+//run until the condition is met (checked every main loop period), returns the elapsed time in ms, or UINT32_MAX on timeout
+static uint32_t _RunUntil(bool (*condition)(), uint32_t max_ms) {
+  uint32_t start = host_tick_ms;
+  while (host_tick_ms - start < max_ms) {
+    _Step();
+    if (host_tick_ms % MAIN_LOOP_PERIOD_MS == 0 && condition()) {
+      return host_tick_ms - start;
+    }
+  }
+  return UINT32_MAX;
+}
+
+static void _Run(uint32_t ms) {
+  uint32_t start = host_tick_ms;
+  while (host_tick_ms - start < ms) {
+    _Step();
+  }
+}
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+//the static pool holds BT_CMD_QUEUE_SIZE commands, rejects further ones, and is refilled completely by a re-init
+static void _Test_Pool() {
+  int i;
+  CHECK_EQ(BT_Init(), HAL_OK);
+  CHECK_EQ(_FreeItems(), BT_CMD_QUEUE_SIZE);
+  for (i = 0; i < BT_CMD_QUEUE_SIZE; i++) {
+    CHECK_EQ(BT_Command_VOLUME(0x1A, i), HAL_OK);
+  }
+  CHECK_EQ(_FreeItems(), 0);
+  CHECK_EQ(BT_Command_VOLUME(0x1A, 0), HAL_ERROR);
+  CHECK_EQ(_QueueLength(), BT_CMD_QUEUE_SIZE);
+  CHECK_EQ(BT_Init(), HAL_OK);
+  CHECK_EQ(_FreeItems(), BT_CMD_QUEUE_SIZE);
+  CHECK_EQ(_QueueLength(), 0);
+}
+
+//init of a factory-fresh module (all config entries changed, written, module reset) and of a configured module
+static void _Test_Init(uint32_t* fresh_ms, uint32_t* configured_ms) {
+  int i;
+
+  _SimFactoryReset();
+  sim_sets = sim_writes = sim_resets = sim_commands = 0;
+  sim_max_in_flight = 0;
+  loop_counter = 1;
+  CHECK_EQ(BT_Init(), HAL_OK);
+  *fresh_ms = _RunUntil(_InitComplete, 60000);
+  CHECK(*fresh_ms != UINT32_MAX);
+  CHECK_EQ(sim_sets, BT_CONFIG_ARRAY_ENTRIES);
+  CHECK_EQ(sim_writes, 1);
+  CHECK_EQ(sim_resets, 2);
+  //the written config is the driver's (UI_CONFIG with OTA disabled)
+  CHECK_EQ(strcmp(sim_config_flash[0], "1 1"), 0);
+  CHECK_EQ(strcmp(sim_config_flash[BT_CONFIG_ARRAY_ENTRIES - 2], "OFF OFF OFF OFF OFF OFF 0 ON"), 0);
+  CHECK_EQ(strcmp(sim_config_flash[BT_CONFIG_ARRAY_ENTRIES - 1], "OFF 127 ON"), 0);
+  for (i = 0; i < BT_CONFIG_ARRAY_ENTRIES; i++) {
+    CHECK(strcmp(sim_config_flash[i], "0") != 0);
+  }
+#ifdef TEST_SERIAL_SCHEDULING
+  CHECK_EQ(sim_max_in_flight, 1);
+#else
+  //SETs are pipelined (at 9600 baud, transmitting a SET takes longer than processing it, which limits the depth actually used)
+  CHECK(sim_max_in_flight > 1);
+#endif
+
+  sim_sets = sim_writes = sim_resets = 0;
+  CHECK_EQ(BT_Init(), HAL_OK);
+  *configured_ms = _RunUntil(_InitComplete, 60000);
+  CHECK(*configured_ms != UINT32_MAX);
+  CHECK_EQ(sim_sets, 0);
+  CHECK_EQ(sim_writes, 0);
+  CHECK_EQ(sim_resets, 1);
+}
+
+//status read finding a new connection: NAME, then RSSI and QUALITY; a later status read with the name known only reads RSSI and QUALITY
+static void _Test_Connect(uint32_t* unknown_ms, uint32_t* known_ms) {
+  sim_connected = true;
+  sim_commands = 0;
+
+  //the next driver update queues the periodic status read
+  loop_counter = BT_STATUS_READ_PERIOD;
+  *unknown_ms = _RunUntil(_NameKnown, 10000);
+  CHECK(*unknown_ms != UINT32_MAX);
+  CHECK_EQ(sim_commands, 4);
+  CHECK_EQ(bt_driver_state.connected_device_addr, 0x001122334455ULL);
+  CHECK_EQ(strcmp(bt_driver_state.connected_device_name, "Alex's Phone"), 0);
+  CHECK_EQ(bt_driver_state.connected_device_rssi, -42);
+  CHECK_EQ(bt_driver_state.connected_device_link_quality, 200);
+  CHECK_EQ(bt_driver_state.a2dp_link_id, 0x1A);
+
+  bt_driver_state.connected_device_rssi = 0;
+  bt_driver_state.connected_device_link_quality = 0;
+  sim_commands = 0;
+  loop_counter = BT_STATUS_READ_PERIOD;
+  *known_ms = _RunUntil(_NameKnown, 10000);
+  CHECK(*known_ms != UINT32_MAX);
+  CHECK_EQ(sim_commands, 3);
+  CHECK_EQ(bt_driver_state.connected_device_link_quality, 200);
+}
+
+//volume steps from the host, followed by a readback: sent in order, readback applied
+static void _Test_Volume(uint32_t* volume_ms) {
+  int i;
+  sim_volume_count = 0;
+  loop_counter = 1;
+  for (i = 1; i <= 8; i++) {
+    CHECK_EQ(BT_Command_VOLUME(0x1A, 10 * i), HAL_OK);
+  }
+  CHECK_EQ(BT_Command_VOLUME_GET(), HAL_OK);
+  *volume_ms = _RunUntil(_Idle, 10000);
+  CHECK(*volume_ms != UINT32_MAX);
+  CHECK_EQ(sim_volume_count, 8);
+  for (i = 0; i < 8; i++) {
+    CHECK_EQ(sim_volumes[i], 10 * (i + 1));
+  }
+  CHECK_EQ(bt_driver_state.abs_volume, 64);
+  CHECK_EQ(host_errors, 0);
+}
+
+//an error response to a pipelined host command is reported to the host, and only completes that command
+static void _Test_ErrorInPipeline() {
+  int i;
+  host_errors = 0;
+  sim_resets = 0;
+  sim_volume_count = 0;
+  sim_error_volume_countdown = 3;
+  loop_counter = 1;
+  for (i = 1; i <= 5; i++) {
+    CHECK_EQ(BT_Command_VOLUME(0x1A, i), HAL_OK);
+  }
+  CHECK(_RunUntil(_Idle, 10000) != UINT32_MAX);
+  CHECK_EQ(sim_volume_count, 5);
+  CHECK_EQ(host_errors, 1);
+  CHECK_EQ(sim_resets, 0);
+}
+
+//a command without response times out all commands in flight without a module reset, and the driver carries on afterwards
+static void _Test_Timeout() {
+  sim_check_matching = false;
+  sim_drop_command = CMD_RSSI;
+  sim_resets = 0;
+  loop_counter = 1;
+  CHECK_EQ(BT_Command_RSSI(0x001122334455ULL), HAL_OK);
+  CHECK_EQ(BT_Command_QUALITY(0x001122334455ULL), HAL_OK);
+  uint32_t elapsed = _RunUntil(_Idle, 3 * BT_CMD_TIMEOUT);
+  CHECK(elapsed != UINT32_MAX);
+  CHECK(elapsed >= BT_CMD_TIMEOUT);
+  CHECK_EQ(sim_resets, 0);
+  CHECK(bt_driver_state.init_complete);
+
+  //responses are in order again after the timeout
+  sim_drop_command = CMD_NONE;
+  sim_outstanding_count = 0;
+  sim_check_matching = true;
+  sim_volume_count = 0;
+  CHECK_EQ(BT_Command_VOLUME(0x1A, 99), HAL_OK);
+  CHECK(_RunUntil(_Idle, 1000) != UINT32_MAX);
+  CHECK_EQ(sim_volume_count, 1);
+  CHECK_EQ(sim_volumes[0], 99);
+}
+
+
+/* --------------------------------------- main --------------------------------------- */
+
+int main() {
+  uint32_t fresh_ms, configured_ms, connect_unknown_ms, connect_known_ms, volume_ms;
+
+  _Test_Pool();
+  _Test_Init(&fresh_ms, &configured_ms);
+  _Test_Connect(&connect_unknown_ms, &connect_known_ms);
+  _Test_Volume(&volume_ms);
+  _Test_ErrorInPipeline();
+  _Test_Timeout();
+
+#ifdef TEST_SERIAL_SCHEDULING
+  printf("serial scheduling, 9600 baud, %u ms module boot:\n", SIM_BOOT_MS);
+#else
+  printf("pipelined scheduling (depth %u), 9600 baud, %u ms module boot:\n", BT_CMD_PIPELINE_DEPTH, SIM_BOOT_MS);
+#endif
+  printf("  init, fresh module (22 SETs, WRITE, reset): %5u ms\n", fresh_ms);
+  printf("  init, configured module:                    %5u ms\n", configured_ms);
+  printf("  connect, device name unknown:               %5u ms\n", connect_unknown_ms);
+  printf("  connect, device name known:                 %5u ms\n", connect_known_ms);
+  printf("  8 volume steps + readback:                  %5u ms\n", volume_ms);
+
+  return HOST_TestSummary("test_bt_pipeline");
+}
@@ -0,0 +1,313 @@
+/*
+ * arm_math_host.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host implementations of the CMSIS-DSP functions used by the module firmwares (the targets link the prebuilt CMSIS-DSP 1.16.2 libraries)
+ *  These follow the CMSIS-DSP reference arithmetic exactly (same products, rounding, accumulation order and saturation),
+ *  so fixed-point results are bit-identical to the target library
+ */
+
+#include "arm_math.h"
+
+
+//fast q31 multiply-accumulate helpers, as in CMSIS-DSP's arm_math_memory.h / utils
+#define HOST_MULT_32x32_KEEP32_R(a, x, y) a = (q31_t)(((q63_t)(x) * (y) + 0x80000000LL) >> 32)
+#define HOST_MULTACC_32x32_KEEP32_R(a, x, y) a = (q31_t)(((((q63_t)(a)) << 32) + ((q63_t)(x) * (y)) + 0x80000000LL) >> 32)
+#define HOST_MULTACC_32x32_KEEP32(a, x, y) a = (q31_t)(((((q63_t)(a)) << 32) + ((q63_t)(x) * (y))) >> 32)
+
+
+static inline q31_t _host_qadd(q31_t a, q31_t b) {
+  return clip_q63_to_q31((q63_t)a + b);
+}
+
+
+/* --------------------------------------- statistics --------------------------------------- */
+
+void arm_absmax_no_idx_f32(const float32_t* pSrc, uint32_t blockSize, float32_t* pResult) {
+  float32_t max = 0.0f;
+  while (blockSize-- > 0U) {
+    float32_t in = fabsf(*pSrc++);
+    if (in > max) max = in;
+  }
+  *pResult = max;
+}
+
+void arm_absmax_q15(const q15_t* pSrc, uint32_t blockSize, q15_t* pResult, uint32_t* pIndex) {
+  q15_t max = -1;
+  uint32_t idx = 0;
+  for (uint32_t i = 0; i < blockSize; i++) {
+    //absolute value with saturation (0x8000 -> 0x7FFF), as with __QSUB16(0, x)
+    q15_t in = (pSrc[i] > 0) ? pSrc[i] : (q15_t)__SSAT(-(q31_t)pSrc[i], 16);
+    if (in > max) {
+      max = in;
+      idx = i;
+    }
+  }
+  *pResult = max;
+  *pIndex = idx;
+}
+
+void arm_absmax_q31(const q31_t* pSrc, uint32_t blockSize, q31_t* pResult, uint32_t* pIndex) {
+  q31_t max = -1;
+  uint32_t idx = 0;
+  for (uint32_t i = 0; i < blockSize; i++) {
+    //absolute value with saturation (0x80000000 -> 0x7FFFFFFF), as with __QSUB(0, x)
+    q31_t in = (pSrc[i] > 0) ? pSrc[i] : clip_q63_to_q31(-(q63_t)pSrc[i]);
+    if (in > max) {
+      max = in;
+      idx = i;
+    }
+  }
+  *pResult = max;
+  *pIndex = idx;
+}
+
+void arm_max_q31(const q31_t* pSrc, uint32_t blockSize, q31_t* pResult, uint32_t* pIndex) {
+  q31_t max = pSrc[0];
+  uint32_t idx = 0;
+  for (uint32_t i = 1; i < blockSize; i++) {
+    if (pSrc[i] > max) {
+      max = pSrc[i];
+      idx = i;
+    }
+  }
+  *pResult = max;
+  *pIndex = idx;
+}
+
+void arm_mean_q15(const q15_t* pSrc, uint32_t blockSize, q15_t* pResult) {
+  q31_t sum = 0;
+  for (uint32_t i = 0; i < blockSize; i++) {
+    sum += pSrc[i];
+  }
+  *pResult = (q15_t)(sum / (int32_t)blockSize);
+}
+
+void arm_power_q15(const q15_t* pSrc, uint32_t blockSize, q63_t* pResult) {
+  q63_t sum = 0;
+  for (uint32_t i = 0; i < blockSize; i++) {
+    sum += (q31_t)pSrc[i] * pSrc[i];
+  }
+  *pResult = sum;
+}
+
+
+/* --------------------------------------- basic math --------------------------------------- */
+
+void arm_add_q31(const q31_t* pSrcA, const q31_t* pSrcB, q31_t* pDst, uint32_t blockSize) {
+  while (blockSize-- > 0U) {
+    *pDst++ = _host_qadd(*pSrcA++, *pSrcB++);
+  }
+}
+
+void arm_mult_q15(const q15_t* pSrcA, const q15_t* pSrcB, q15_t* pDst, uint32_t blockSize) {
+  while (blockSize-- > 0U) {
+    *pDst++ = (q15_t)__SSAT(((q31_t)(*pSrcA++) * (*pSrcB++)) >> 15, 16);
+  }
+}
+
+void arm_scale_q31(const q31_t* pSrc, q31_t scaleFract, int8_t shift, q31_t* pDst, uint32_t blockSize) {
+  int8_t kShift = shift + 1;
+  q31_t in, out;
+
+  if (kShift >= 0) {
+    while (blockSize-- > 0U) {
+      in = (q31_t)(((q63_t)(*pSrc++) * scaleFract) >> 32);
+      out = (q31_t)((uint32_t)in << kShift);
+      if (in != (out >> kShift)) {
+        out = 0x7FFFFFFF ^ (in >> 31);
+      }
+      *pDst++ = out;
+    }
+  } else {
+    while (blockSize-- > 0U) {
+      in = (q31_t)(((q63_t)(*pSrc++) * scaleFract) >> 32);
+      *pDst++ = in >> -kShift;
+    }
+  }
+}
+
+void arm_shift_q31(const q31_t* pSrc, int8_t shiftBits, q31_t* pDst, uint32_t blockSize) {
+  if (shiftBits >= 0) {
+    while (blockSize-- > 0U) {
+      *pDst++ = clip_q63_to_q31((q63_t)(*pSrc++) << shiftBits);
+    }
+  } else {
+    while (blockSize-- > 0U) {
+      *pDst++ = *pSrc++ >> -shiftBits;
+    }
+  }
+}
+
+
+/* --------------------------------------- support --------------------------------------- */
+
+void arm_copy_q31(const q31_t* pSrc, q31_t* pDst, uint32_t blockSize) {
+  while (blockSize-- > 0U) {
+    *pDst++ = *pSrc++;
+  }
+}
+
+void arm_fill_q31(q31_t value, q31_t* pDst, uint32_t blockSize) {
+  while (blockSize-- > 0U) {
+    *pDst++ = value;
+  }
+}
+
+void arm_float_to_q31(const float32_t* pSrc, q31_t* pDst, uint32_t blockSize) {
+  //default (non-ARM_MATH_ROUNDING) conversion: truncation with saturation
+  while (blockSize-- > 0U) {
+    *pDst++ = clip_q63_to_q31((q63_t)(*pSrc++ * 2147483648.0f));
+  }
+}
+
+void arm_q15_to_float(const q15_t* pSrc, float32_t* pDst, uint32_t blockSize) {
+  while (blockSize-- > 0U) {
+    *pDst++ = (float32_t)(*pSrc++) / 32768.0f;
+  }
+}
+
+
+/* --------------------------------------- filtering --------------------------------------- */
+
+void arm_biquad_cascade_df1_fast_q31(const arm_biquad_casd_df1_inst_q31* S, const q31_t* pSrc, q31_t* pDst, uint32_t blockSize) {
+  const q31_t* pIn = pSrc;
+  q31_t* pState = S->pState;
+  const q31_t* pCoeffs = S->pCoeffs;
+  int32_t shift = (int32_t)S->postShift + 1;
+  uint32_t stage = S->numStages;
+
+  do {
+    q31_t b0 = pCoeffs[0], b1 = pCoeffs[1], b2 = pCoeffs[2], a1 = pCoeffs[3], a2 = pCoeffs[4];
+    q31_t Xn1 = pState[0], Xn2 = pState[1], Yn1 = pState[2], Yn2 = pState[3];
+    pCoeffs += 5;
+
+    for (uint32_t i = 0; i < blockSize; i++) {
+      q31_t Xn = pIn[i];
+      q31_t acc;
+      //accumulation order of the CMSIS fast implementation: b1 term first, then b0, b2, a1, a2
+      HOST_MULT_32x32_KEEP32_R(acc, b1, Xn1);
+      HOST_MULTACC_32x32_KEEP32_R(acc, b0, Xn);
+      HOST_MULTACC_32x32_KEEP32_R(acc, b2, Xn2);
+      HOST_MULTACC_32x32_KEEP32_R(acc, a1, Yn1);
+      HOST_MULTACC_32x32_KEEP32_R(acc, a2, Yn2);
+      acc = (q31_t)((uint32_t)acc << shift);
+
+      Xn2 = Xn1;
+      Xn1 = Xn;
+      Yn2 = Yn1;
+      Yn1 = acc;
+      pDst[i] = acc;
+    }
+
+    pState[0] = Xn1;
+    pState[1] = Xn2;
+    pState[2] = Yn1;
+    pState[3] = Yn2;
+    pState += 4;
+
+    //following stages work on the output of the previous stage
+    pIn = pDst;
+  } while (--stage > 0U);
+}
+
+void arm_fir_fast_q31(const arm_fir_instance_q31* S, const q31_t* pSrc, q31_t* pDst, uint32_t blockSize) {
+  q31_t* pState = S->pState;
+  const q31_t* pCoeffs = S->pCoeffs;
+  uint32_t numTaps = S->numTaps;
+
+  //append new samples to the state buffer (which holds the numTaps - 1 previous samples at its start)
+  q31_t* pStateCurnt = pState + (numTaps - 1U);
+  for (uint32_t i = 0; i < blockSize; i++) {
+    pStateCurnt[i] = pSrc[i];
+  }
+
+  //coefficients are stored time-reversed: pCoeffs[0] multiplies the oldest sample
+  for (uint32_t n = 0; n < blockSize; n++) {
+    const q31_t* px = pState + n;
+    q31_t acc = 0;
+    for (uint32_t k = 0; k < numTaps; k++) {
+      HOST_MULTACC_32x32_KEEP32_R(acc, px[k], pCoeffs[k]);
+    }
+    pDst[n] = (q31_t)((uint32_t)acc << 1);
+  }
+
+  //keep the last numTaps - 1 samples for the next call
+  for (uint32_t i = 0; i < numTaps - 1U; i++) {
+    pState[i] = pState[blockSize + i];
+  }
+}
+
+void arm_fir_interpolate_q31(const arm_fir_interpolate_instance_q31* S, const q31_t* pSrc, q31_t* pDst, uint32_t blockSize) {
+  q31_t* pState = S->pState;
+  const q31_t* pCoeffs = S->pCoeffs;
+  uint32_t L = S->L;
+  uint32_t phaseLen = S->phaseLength;
+
+  q31_t* pStateCurnt = pState + (phaseLen - 1U);
+  q31_t* pStateStart = pState;
+
+  for (uint32_t n = 0; n < blockSize; n++) {
+    *pStateCurnt++ = *pSrc++;
+
+    for (uint32_t j = 1; j <= L; j++) {
+      const q31_t* ptr1 = pState;
+      const q31_t* ptr2 = pCoeffs + (L - j);
+      q63_t sum = 0;
+      for (uint32_t k = 0; k < phaseLen; k++) {
+        sum += (q63_t)(*ptr1++) * (*ptr2);
+        ptr2 += L;
+      }
+      *pDst++ = (q31_t)(sum >> 31);
+    }
+
+    pState++;
+  }
+
+  //keep the last phaseLen - 1 samples for the next call
+  for (uint32_t i = 0; i < phaseLen - 1U; i++) {
+    pStateStart[i] = pState[i];
+  }
+}
+
+
+/* --------------------------------------- matrix --------------------------------------- */
+
+arm_status arm_mat_mult_fast_q31(const arm_matrix_instance_q31* pSrcA, const arm_matrix_instance_q31* pSrcB, arm_matrix_instance_q31* pDst) {
+  uint16_t rows = pSrcA->numRows;
+  uint16_t inner = pSrcA->numCols;
+  uint16_t cols = pSrcB->numCols;
+
+#ifdef ARM_MATH_MATRIX_CHECK
+  if (pSrcA->numCols != pSrcB->numRows || pSrcA->numRows != pDst->numRows || pSrcB->numCols != pDst->numCols) {
+    return ARM_MATH_SIZE_MISMATCH;
+  }
+#endif
+
+  for (uint16_t r = 0; r < rows; r++) {
+    for (uint16_t c = 0; c < cols; c++) {
+      q31_t sum = 0;
+      for (uint16_t k = 0; k < inner; k++) {
+        HOST_MULTACC_32x32_KEEP32(sum, pSrcA->pData[r * inner + k], pSrcB->pData[k * cols + c]);
+      }
+      pDst->pData[r * cols + c] = (q31_t)((uint32_t)sum << 1);
+    }
+  }
+
+  return ARM_MATH_SUCCESS;
+}
+
+void arm_mat_vec_mult_q15(const arm_matrix_instance_q15* pSrcMat, const q15_t* pVec, q15_t* pDst) {
+  uint16_t rows = pSrcMat->numRows;
+  uint16_t cols = pSrcMat->numCols;
+
+  for (uint16_t r = 0; r < rows; r++) {
+    q63_t sum = 0;
+    for (uint16_t c = 0; c < cols; c++) {
+      sum += (q31_t)pSrcMat->pData[r * cols + c] * pVec[c];
+    }
+    *pDst++ = (q15_t)__SSAT((q31_t)(sum >> 15), 16);
+  }
+}
@@ -0,0 +1,535 @@
+/*
+ * test_dsp_render.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host render tool and golden regression test of the SRC + signal processor chain (sample_rate_conv.c, fractional_fir.c,
+ *  signal_processing.c): runs the firmware's own DSP self-test (dsp_selftest.c), which checks level/THD+N/image limits
+ *  and the golden output hashes per input rate and tone. The hashes printed here are the golden values for the target.
+ *  Also checks the output look-ahead envelope (leads the delayed output, bounds its peaks, raises the envelope interrupt)
+ *  and the non-destructive output peak-hold.
+ *
+ *  Usage:
+ *    dap_test_dsp_render                                   run the self-test as a regression test
+ *    dap_test_dsp_render <rate> <freq> <out.wav> [<cfg>]   render a 0.5 FS tone at the given input rate to a 96k stereo WAV
+ *                                                          (1 second after settling, like the self-test)
+ *    dap_test_dsp_render <in.wav> <out.wav> [<cfg>]        render a WAV file (16/24/32-bit PCM, mono/stereo, 44.1/48/96k)
+ *                                                          to a 96k stereo WAV, including the flushed tail
+ *  The optional configuration file sets the SRC mode (fixed-ratio by default) and the signal processor settings - see _LoadConfig.
+ */
+
+#include "host_test.h"
+#include "dsp_selftest.h"
+#include "inputs.h"
+#include "i2c.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+WWDG_HandleTypeDef hwwdg1;
+HAL_StatusTypeDef HAL_WWDG_Refresh(WWDG_HandleTypeDef* hwwdg) { return HAL_OK; }
+
+INPUT_Source input_active = INPUT_NONE;
+void INPUT_Stop(INPUT_Source input) {}
+
+static uint32_t envelope_interrupts = 0;
+void I2C_TriggerInterrupt(uint8_t interrupt_bit) {
+  if ((interrupt_bit & I2CDEF_DAP_INT_FLAGS_INT_OUTPUT_ENVELOPE_Msk) != 0) {
+    envelope_interrupts++;
+  }
+}
+
+
+/* --------------------------------------- render tool --------------------------------------- */
+
+//output batches rendered after the end of a WAV input, to flush the SRC buffer and the look-ahead delay
+#define RENDER_TAIL_BATCHES (SRC_BUF_TOTAL_CHANNEL_SAMPLES / SRC_BATCH_CHANNEL_SAMPLES + SP_LOOKAHEAD_BATCHES + 2)
+
+//render input: a test tone like the self-test's, or the samples of a WAV file
+typedef struct {
+  SRC_SampleRate rate;
+  uint32_t freq;          //test tone frequency - 0 for WAV input
+  uint32_t frames;        //WAV input length in frames
+  q31_t* samples[2];      //WAV input samples per channel, left-aligned (both point to the same samples for mono files)
+} RenderInput;
+
+static void _WriteLE(FILE* file, uint32_t value, int bytes) {
+  int i;
+  for (i = 0; i < bytes; i++) {
+    fputc((value >> (8 * i)) & 0xFF, file);
+  }
+}
+
+static uint32_t _ReadLE(const uint8_t* p, int bytes) {
+  uint32_t value = 0;
+  int i;
+  for (i = 0; i < bytes; i++) {
+    value |= (uint32_t)p[i] << (8 * i);
+  }
+  return value;
+}
+
+//load a 16/24/32-bit integer PCM WAV file with 1 or 2 channels at a supported input rate - returns 0 on success
+static int _LoadWav(const char* path, RenderInput* input) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    perror(path);
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t* data = malloc((size_t)size);
+  if (data == NULL || size < 12 || fread(data, 1, (size_t)size, file) != (size_t)size || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+    fprintf(stderr, "%s: not a WAV file\n", path);
+    fclose(file);
+    free(data);
+    return 1;
+  }
+  fclose(file);
+
+  //find the format and data chunks
+  uint32_t format = 0, channels = 0, rate = 0, bits = 0;
+  const uint8_t* pcm = NULL;
+  uint32_t pcm_bytes = 0;
+  long pos = 12;
+  while (pos + 8 <= size) {
+    uint32_t chunk_size = _ReadLE(data + pos + 4, 4);
+    if (chunk_size > (uint32_t)(size - pos - 8)) {
+      chunk_size = (uint32_t)(size - pos - 8);
+    }
+    if (memcmp(data + pos, "fmt ", 4) == 0 && chunk_size >= 16) {
+      format = _ReadLE(data + pos + 8, 2);
+      channels = _ReadLE(data + pos + 10, 2);
+      rate = _ReadLE(data + pos + 12, 4);
+      bits = _ReadLE(data + pos + 22, 2);
+      //WAVE_FORMAT_EXTENSIBLE: actual format in the sub-format GUID
+      if (format == 0xFFFE && chunk_size >= 26) {
+        format = _ReadLE(data + pos + 32, 2);
+      }
+    } else if (memcmp(data + pos, "data", 4) == 0) {
+      pcm = data + pos + 8;
+      pcm_bytes = chunk_size;
+    }
+    pos += 8 + chunk_size + (chunk_size & 1);
+  }
+
+  if (format != 1 || (channels != 1 && channels != 2) || (bits != 16 && bits != 24 && bits != 32) || !SRC_IsValidSampleRate((SRC_SampleRate)rate) || pcm == NULL) {
+    fprintf(stderr, "%s: unsupported format %u, %u channels, %u Hz, %u bits (needs integer PCM, 1-2 channels, 44100/48000/96000 Hz, 16/24/32 bits)\n", path,
+            format, channels, rate, bits);
+    free(data);
+    return 1;
+  }
+
+  uint32_t sample_bytes = bits / 8;
+  input->rate = (SRC_SampleRate)rate;
+  input->freq = 0;
+  input->frames = pcm_bytes / (sample_bytes * channels);
+  input->samples[0] = malloc(input->frames * sizeof(q31_t) + 1);
+  input->samples[1] = (channels == 2) ? malloc(input->frames * sizeof(q31_t) + 1) : input->samples[0];
+  uint32_t n, ch;
+  for (n = 0; n < input->frames; n++) {
+    for (ch = 0; ch < channels; ch++) {
+      uint32_t raw = _ReadLE(pcm + (n * channels + ch) * sample_bytes, (int)sample_bytes);
+      input->samples[ch][n] = (q31_t)(raw << (32 - bits));
+    }
+  }
+
+  free(data);
+  return 0;
+}
+
+//convert a float coefficient to q31 after scaling by 2^-shift, saturating exactly 2^shift - returns false if it doesn't fit
+static bool _ToQ31(double value, int shift, q31_t* result) {
+  double scaled = ldexp(value, 31 - shift);
+  if (scaled > 2147483648.0 || scaled < -2147483648.0) {
+    return false;
+  }
+  *result = (scaled >= 2147483647.0) ? INT32_MAX : (q31_t)llround(scaled);
+  return true;
+}
+
+//load an SP/SRC configuration file into the signal processor state, one setting per line ('#' starts a comment):
+//  fixed_ratio <0|1>                       SRC fixed-ratio mode (default 1) or adaptive resampling
+//  volume <left dB> <right dB>             volume gains (positive gains are allowed)
+//  loudness <left dB> <right dB>           loudness compensation gains
+//  mixer <ll> <lr> <rl> <rr>               mixer gains (-2..2), output channel x input channel
+//  biquad <channel> <b0> <b1> <b2> <a1> <a2>  adds a biquad stage (denominator 1 + a1 z^-1 + a2 z^-2) - the post-shift is chosen from the largest coefficient
+//  fir <channel> <h0> <h1> ...             FIR filter coefficients, in normal order
+//returns 0 on success
+static int _LoadConfig(const char* path, bool* fixed_ratio) {
+  static double biquads[SP_MAX_CHANNELS][5 * SP_MAX_BIQUADS];
+  uint8_t biquad_counts[SP_MAX_CHANNELS] = { 0 };
+  uint8_t biquad_shifts[SP_MAX_CHANNELS] = { 1, 1 };
+  uint16_t fir_lengths[SP_MAX_CHANNELS] = { 0 };
+  char line[8192];
+  int line_number = 0;
+  int i, ch;
+
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    perror(path);
+    return 1;
+  }
+
+  while (fgets(line, sizeof(line), file) != NULL) {
+    line_number++;
+    line[strcspn(line, "\r\n")] = 0;
+    char* comment = strchr(line, '#');
+    if (comment != NULL) {
+      *comment = 0;
+    }
+    char name[32];
+    int consumed = 0;
+    if (sscanf(line, "%31s%n", name, &consumed) != 1) {
+      continue;
+    }
+    const char* args = line + consumed;
+    double v[5];
+    int ok = 0;
+
+    if (strcmp(name, "fixed_ratio") == 0 && sscanf(args, "%lf", v) == 1) {
+      *fixed_ratio = (v[0] != 0.0);
+      ok = 1;
+    } else if (strcmp(name, "volume") == 0 && sscanf(args, "%lf %lf", v, v + 1) == 2) {
+      sp_volume_allow_positive_dB = true;
+      sp_volume_gains_dB[0] = (float)v[0];
+      sp_volume_gains_dB[1] = (float)v[1];
+      ok = 1;
+    } else if (strcmp(name, "loudness") == 0 && sscanf(args, "%lf %lf", v, v + 1) == 2) {
+      sp_loudness_gains_dB[0] = (float)v[0];
+      sp_loudness_gains_dB[1] = (float)v[1];
+      ok = 1;
+    } else if (strcmp(name, "mixer") == 0 && sscanf(args, "%lf %lf %lf %lf", v, v + 1, v + 2, v + 3) == 4) {
+      ok = _ToQ31(v[0], 1, &sp_mixer_gains[0][0]) && _ToQ31(v[1], 1, &sp_mixer_gains[0][1]) && _ToQ31(v[2], 1, &sp_mixer_gains[1][0]) &&
+           _ToQ31(v[3], 1, &sp_mixer_gains[1][1]);
+    } else if (strcmp(name, "biquad") == 0 && sscanf(args, "%d %lf %lf %lf %lf %lf", &ch, v, v + 1, v + 2, v + 3, v + 4) == 6 && ch >= 0 &&
+               ch < SP_MAX_CHANNELS && biquad_counts[ch] < SP_MAX_BIQUADS) {
+      for (i = 0; i < 5; i++) {
+        biquads[ch][5 * biquad_counts[ch] + i] = v[i];
+      }
+      biquad_counts[ch]++;
+      ok = 1;
+    } else if (strcmp(name, "fir") == 0 && sscanf(args, "%d%n", &ch, &consumed) == 1 && ch >= 0 && ch < SP_MAX_CHANNELS) {
+      static double coeffs[SP_MAX_FIR_LENGTH];
+      const char* p = args + consumed;
+      int length = 0;
+      while (length < SP_MAX_FIR_LENGTH && sscanf(p, "%lf%n", coeffs + length, &consumed) == 1) {
+        p += consumed;
+        length++;
+      }
+      //reversed order in the SP: index length-1 is coefficient 0
+      ok = (length > 0);
+      for (i = 0; i < length && ok; i++) {
+        ok = _ToQ31(coeffs[i], 0, &sp_fir_coeffs[ch][length - 1 - i]);
+      }
+      fir_lengths[ch] = (uint16_t)length;
+    }
+
+    if (!ok) {
+      fprintf(stderr, "%s:%d: invalid setting: %s\n", path, line_number, line);
+      fclose(file);
+      return 1;
+    }
+  }
+  fclose(file);
+
+  //biquads: smallest post-shift that fits all coefficients of the channel (at least 1, like the SP's default), a1/a2 negated
+  for (ch = 0; ch < SP_MAX_CHANNELS; ch++) {
+    double max_coeff = 0.0;
+    for (i = 0; i < 5 * biquad_counts[ch]; i++) {
+      max_coeff = fmax(max_coeff, fabs(biquads[ch][i]));
+    }
+    while (biquad_shifts[ch] < 31 && max_coeff >= ldexp(1.0, biquad_shifts[ch])) {
+      biquad_shifts[ch]++;
+    }
+    for (i = 0; i < 5 * biquad_counts[ch]; i++) {
+      double coeff = ((i % 5) >= 3) ? -biquads[ch][i] : biquads[ch][i];
+      _ToQ31(coeff, biquad_shifts[ch], &sp_biquad_coeffs[ch][i]);
+    }
+  }
+  if (SP_SetupBiquads(biquad_counts, biquad_shifts) != HAL_OK || SP_SetupFIRs(fir_lengths) != HAL_OK) {
+    return 1;
+  }
+
+  return 0;
+}
+
+//render the input through SRC + SP into a 32-bit stereo WAV file at the output rate - a tone for one second after settling, like the self-test,
+//a WAV input from the first output batch until the SRC and the look-ahead delay are flushed - returns 0 on success
+static int _RenderToFile(const RenderInput* input, bool fixed_ratio, const char* path) {
+  int i, j;
+
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    perror(path);
+    return 1;
+  }
+
+  //header with the sizes filled in at the end
+  fwrite("RIFF", 1, 4, file); _WriteLE(file, 0, 4);
+  fwrite("WAVEfmt ", 1, 8, file); _WriteLE(file, 16, 4);
+  _WriteLE(file, 1, 2); _WriteLE(file, 2, 2); _WriteLE(file, 96000, 4); _WriteLE(file, 96000 * 8, 4); _WriteLE(file, 8, 2); _WriteLE(file, 32, 2);
+  fwrite("data", 1, 4, file); _WriteLE(file, 0, 4);
+
+  static q31_t in_bufs[SRC_MAX_CHANNELS][SRC_INPUT_CHANNEL_SAMPLES_MAX];
+  static q31_t out_bufs[SP_MAX_CHANNELS][SP_BATCH_CHANNEL_SAMPLES];
+  const q31_t* in_ptrs[SRC_MAX_CHANNELS] = { in_bufs[0], in_bufs[1] };
+  q31_t* out_ptrs[SP_MAX_CHANNELS] = { out_bufs[0], out_bufs[1] };
+  SRC_SampleRate rate = input->rate;
+
+  SRC_SetFixedRatioAllowed(fixed_ratio);
+  if (SRC_Configure(rate) != HAL_OK) {
+    fclose(file);
+    return 1;
+  }
+  SP_Reset();
+
+  //same batch pattern as the self-test: exactly rate/1000 input samples per output batch on average
+  uint32_t in_sample_index = 0;
+  uint32_t out_frames = 0;
+  uint32_t settle_batches = (input->freq > 0) ? (fixed_ratio ? DSPTEST_SETTLE_BATCHES : DSPTEST_ADAPTIVE_SETTLE_BATCHES) : 0;
+  uint32_t total_batches = (input->freq > 0) ? settle_batches + DSPTEST_MEASURE_BATCHES
+                                             : (uint32_t)(((uint64_t)input->frames * 1000 + rate - 1) / rate) + RENDER_TAIL_BATCHES;
+  uint32_t batch;
+  for (batch = 0; batch < total_batches; batch++) {
+    uint32_t in_samples = (uint32_t)(((uint64_t)(batch + 1) * rate) / 1000) - (uint32_t)(((uint64_t)batch * rate) / 1000);
+    for (j = 0; j < in_samples; j++) {
+      uint32_t n = in_sample_index + j;
+      for (i = 0; i < SRC_MAX_CHANNELS; i++) {
+        if (input->freq > 0) {
+          double phase = (2.0 * M_PI * (double)input->freq * (double)(n % rate)) / (double)rate;
+          in_bufs[i][j] = (q31_t)lround(DSPTEST_TONE_AMPLITUDE * 32767.0 * sin(phase)) << 16;
+        } else {
+          in_bufs[i][j] = (n < input->frames) ? input->samples[i][n] : 0;
+        }
+      }
+    }
+    in_sample_index += in_samples;
+
+    SRC_ProcessInputSamples(in_ptrs, 1, SRC_MAX_CHANNELS, in_samples, 0);
+    HAL_StatusTypeDef status = SP_ProduceOutputBatch(out_ptrs, 1, SP_MAX_CHANNELS);
+    if (status == HAL_OK && batch >= settle_batches) {
+      for (j = 0; j < SP_BATCH_CHANNEL_SAMPLES; j++) {
+        _WriteLE(file, (uint32_t)out_bufs[0][j], 4);
+        _WriteLE(file, (uint32_t)out_bufs[1][j], 4);
+      }
+      out_frames += SP_BATCH_CHANNEL_SAMPLES;
+    }
+  }
+  bool fixed_ratio_end = SRC_IsFixedRatioActive();
+
+  fseek(file, 4, SEEK_SET);
+  _WriteLE(file, 36 + out_frames * 8, 4);
+  fseek(file, 40, SEEK_SET);
+  _WriteLE(file, out_frames * 8, 4);
+  fclose(file);
+  SRC_SetFixedRatioAllowed(false);
+
+  printf("rendered %u frames @ %u to %s (%u frames @ 96000, SRC %s at the end)\n", (input->freq > 0) ? DSPTEST_MEASURE_BATCHES * (uint32_t)rate / 1000 : input->frames,
+         (uint32_t)rate, path, out_frames, fixed_ratio_end ? "fixed-ratio" : "adaptive");
+  return 0;
+}
+
+//command line render tool: tone or WAV input, optional configuration - returns the process exit code
+static int _RenderTool(int argc, char** argv) {
+  RenderInput input = { SR_UNKNOWN, 0, 0, { NULL, NULL } };
+  bool fixed_ratio = true;
+  const char* out_path;
+  int config_arg;
+
+  size_t length = strlen(argv[1]);
+  if (length > 4 && strcasecmp(argv[1] + length - 4, ".wav") == 0) {
+    if (_LoadWav(argv[1], &input) != 0) {
+      return 1;
+    }
+    out_path = argv[2];
+    config_arg = 3;
+  } else if (argc >= 4) {
+    input.rate = (SRC_SampleRate)strtoul(argv[1], NULL, 10);
+    input.freq = (uint32_t)strtoul(argv[2], NULL, 10);
+    if (!SRC_IsValidSampleRate(input.rate) || input.freq == 0 || input.freq >= (uint32_t)input.rate / 2) {
+      fprintf(stderr, "invalid rate %u or frequency %u\n", (uint32_t)input.rate, input.freq);
+      return 1;
+    }
+    out_path = argv[3];
+    config_arg = 4;
+  } else {
+    fprintf(stderr, "usage: %s [<rate> <freq> | <in.wav>] <out.wav> [<config>]\n", argv[0]);
+    return 1;
+  }
+
+  if (argc > config_arg && _LoadConfig(argv[config_arg], &fixed_ratio) != 0) {
+    return 1;
+  }
+  return _RenderToFile(&input, fixed_ratio, out_path);
+}
+
+
+/* --------------------------------------- look-ahead envelope --------------------------------------- */
+
+//silence followed by a 0.5 FS tone burst at 96k: the envelope must rise (with an interrupt) a full look-ahead delay before the output does,
+//and bound every following output batch; the peak-hold is only reset by an explicit reset
+static void _Test_LookAhead() {
+  static q31_t in_bufs[SRC_MAX_CHANNELS][SRC_INPUT_CHANNEL_SAMPLES_MAX];
+  static q31_t out_bufs[SP_MAX_CHANNELS][SP_BATCH_CHANNEL_SAMPLES];
+  const q31_t* in_ptrs[SRC_MAX_CHANNELS] = { in_bufs[0], in_bufs[1] };
+  q31_t* out_ptrs[SP_MAX_CHANNELS] = { out_bufs[0], out_bufs[1] };
+  const uint32_t burst_start = 300;
+  int32_t envelope_rise_batch = -1, output_rise_batch = -1;
+  float envelopes[SP_MAX_CHANNELS], peaks[SP_MAX_CHANNELS];
+  float prev_envelope = 0.0f;
+  uint32_t batch, j;
+  int i;
+
+  SRC_SetFixedRatioAllowed(true);
+  CHECK_EQ(SRC_Configure(SR_96K), HAL_OK);
+  SP_Reset();
+  envelope_interrupts = 0;
+
+  for (batch = 0; batch < burst_start + 2 * SP_LOOKAHEAD_BATCHES; batch++) {
+    for (j = 0; j < SP_BATCH_CHANNEL_SAMPLES; j++) {
+      q31_t sample = (batch < burst_start) ? 0 : (q31_t)lround(0.5 * 2147483647.0 * sin(2.0 * M_PI * 997.0 * (double)(batch * SP_BATCH_CHANNEL_SAMPLES + j) / 96000.0));
+      for (i = 0; i < SRC_MAX_CHANNELS; i++) {
+        in_bufs[i][j] = sample;
+      }
+    }
+    SRC_ProcessInputSamples(in_ptrs, 1, SRC_MAX_CHANNELS, SP_BATCH_CHANNEL_SAMPLES, 0);
+    if (SP_ProduceOutputBatch(out_ptrs, 1, SP_MAX_CHANNELS) != HAL_OK) {
+      continue;
+    }
+
+    q31_t out_peak;
+    uint32_t out_peak_index;
+    arm_absmax_q31(out_bufs[0], SP_BATCH_CHANNEL_SAMPLES, &out_peak, &out_peak_index);
+    float out_level = (float)out_peak / 2147483648.0f;
+    //the envelope read after the previous batch covers this batch's output
+    CHECK(out_level <= prev_envelope + 1e-6f);
+
+    SP_GetOutputLevels(envelopes, NULL);
+    prev_envelope = envelopes[0];
+    if (envelope_rise_batch < 0 && envelopes[0] > 0.25f) {
+      envelope_rise_batch = (int32_t)batch;
+      CHECK(envelope_interrupts > 0);
+    }
+    if (output_rise_batch < 0 && out_level > 0.25f) {
+      output_rise_batch = (int32_t)batch;
+    }
+  }
+
+  CHECK(envelope_rise_batch > 0 && output_rise_batch > 0);
+  CHECK_EQ(output_rise_batch - envelope_rise_batch, SP_LOOKAHEAD_BATCHES);
+  CHECK(fabsf(envelopes[0] - 0.5f) < 0.01f && fabsf(envelopes[1] - 0.5f) < 0.01f);
+
+  //peak-hold: unchanged by reads, reset per channel
+  SP_GetOutputLevels(NULL, peaks);
+  CHECK(fabsf(peaks[0] - 0.5f) < 0.01f && fabsf(peaks[1] - 0.5f) < 0.01f);
+  SP_GetOutputLevels(NULL, peaks);
+  CHECK(fabsf(peaks[0] - 0.5f) < 0.01f);
+  SP_ResetOutputPeaks(0x01);
+  SP_GetOutputLevels(NULL, peaks);
+  CHECK(peaks[0] == 0.0f && fabsf(peaks[1] - 0.5f) < 0.01f);
+
+  //the envelope follows volume changes right away (volume is applied after the delay)
+  sp_volume_gains_dB[0] = -6.0206f;
+  SRC_ProcessInputSamples(in_ptrs, 1, SRC_MAX_CHANNELS, SP_BATCH_CHANNEL_SAMPLES, 0);
+  CHECK_EQ(SP_ProduceOutputBatch(out_ptrs, 1, SP_MAX_CHANNELS), HAL_OK);
+  SP_GetOutputLevels(envelopes, NULL);
+  CHECK(fabsf(envelopes[0] - 0.25f) < 0.01f && fabsf(envelopes[1] - 0.5f) < 0.01f);
+  sp_volume_gains_dB[0] = 0.0f;
+
+  SRC_SetFixedRatioAllowed(false);
+  SP_Reset();
+}
+
+
+/* --------------------------------------- WAV render --------------------------------------- */
+
+//round trip of the render tool's WAV mode: a 16-bit stereo 48k WAV (tone on the left, silence on the right) with a -6 dB volume
+//configuration, rendered to a 32-bit 96k WAV and read back
+static void _Test_WavRender() {
+  const char* in_path = "test_dsp_render_in.wav";
+  const char* config_path = "test_dsp_render_config.txt";
+  const char* out_path = "test_dsp_render_out.wav";
+  const uint32_t frames = 24000;
+  uint32_t n;
+
+  FILE* file = fopen(in_path, "wb");
+  CHECK(file != NULL);
+  if (file == NULL) {
+    return;
+  }
+  fwrite("RIFF", 1, 4, file); _WriteLE(file, 36 + frames * 4, 4);
+  fwrite("WAVEfmt ", 1, 8, file); _WriteLE(file, 16, 4);
+  _WriteLE(file, 1, 2); _WriteLE(file, 2, 2); _WriteLE(file, 48000, 4); _WriteLE(file, 48000 * 4, 4); _WriteLE(file, 4, 2); _WriteLE(file, 16, 2);
+  fwrite("data", 1, 4, file); _WriteLE(file, frames * 4, 4);
+  for (n = 0; n < frames; n++) {
+    _WriteLE(file, (uint32_t)lround(DSPTEST_TONE_AMPLITUDE * 32767.0 * sin(2.0 * M_PI * 997.0 * (double)n / 48000.0)), 2);
+    _WriteLE(file, 0, 2);
+  }
+  fclose(file);
+
+  file = fopen(config_path, "w");
+  CHECK(file != NULL);
+  if (file == NULL) {
+    return;
+  }
+  fprintf(file, "# render test\nfixed_ratio 1\nvolume -6 -6\n");
+  fclose(file);
+
+  char* argv[] = { "dap_test_dsp_render", (char*)in_path, (char*)out_path, (char*)config_path };
+  CHECK_EQ(_RenderTool(4, argv), 0);
+
+  RenderInput output = { SR_UNKNOWN, 0, 0, { NULL, NULL } };
+  CHECK_EQ(_LoadWav(out_path, &output), 0);
+  CHECK_EQ(output.rate, SR_96K);
+  //the whole input plus the flushed tail
+  CHECK_MSG(output.frames >= 2 * frames && output.frames <= 2 * frames + RENDER_TAIL_BATCHES * SP_BATCH_CHANNEL_SAMPLES,
+            "output length %u frames", output.frames);
+
+  //level of the middle part: tone amplitude - 6 dB on the left, silence on the right
+  if (output.frames >= 2 * frames) {
+    double sum_sq[2] = { 0.0, 0.0 };
+    uint32_t count = frames;
+    for (n = frames / 2; n < frames / 2 + count; n++) {
+      sum_sq[0] += pow((double)output.samples[0][n] / 2147483648.0, 2.0);
+      sum_sq[1] += pow((double)output.samples[1][n] / 2147483648.0, 2.0);
+    }
+    double level_dB = 10.0 * log10(2.0 * sum_sq[0] / (double)count) - 20.0 * log10(DSPTEST_TONE_AMPLITUDE);
+    printf("WAV render: %u frames @ 48000 -> %u frames @ 96000, left level %.3f dB, right energy %g\n", frames, output.frames, level_dB, sum_sq[1]);
+    CHECK_MSG(fabs(level_dB + 6.0) < 0.05, "left level %.3f dB", level_dB);
+    CHECK_MSG(sum_sq[1] < 1e-10, "right energy %g", sum_sq[1]);
+  }
+
+  if (output.samples[1] != output.samples[0]) {
+    free(output.samples[1]);
+  }
+  free(output.samples[0]);
+  remove(in_path);
+  remove(config_path);
+  remove(out_path);
+}
+
+
+/* --------------------------------------- main --------------------------------------- */
+
+int main(int argc, char** argv) {
+  CHECK_EQ(SRC_Init(), HAL_OK);
+  CHECK_EQ(SP_Init(), HAL_OK);
+
+  if (argc >= 3) {
+    return _RenderTool(argc, argv);
+  }
+
+  //golden regression: the self-test checks limits and hashes, and fails on any mismatch
+  CHECK_EQ(DSPTEST_Run(), HAL_OK);
+
+  _Test_LookAhead();
+  _Test_WavRender();
+
+  return HOST_TestSummary("test_dsp_render");
+}
@@ -0,0 +1,226 @@
+/*
+ * test_i2c_crc.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the I2C slave CRC-8 paths (i2c_slave.c): the hardware CRC unit path used by the DAP (word feeding with
+ *  byte swap, byte tail, state reload for chained transfers) against an emulated CRC unit, and the table path used by
+ *  the other modules (built with TEST_CRC_TABLE) - both checked against known answers from the controller's CRC over real
+ *  register frames, and compared to a bitwise reference for all lengths up to the largest register, unaligned buffers and
+ *  chained states.
+ */
+
+#include "host_test.h"
+#include "i2c.h"
+#include <stdlib.h>
+
+#ifdef TEST_CRC_TABLE
+//build the engine's table path instead of the hardware unit path
+#undef I2C_CRC_POLYNOMIAL
+#else
+//emulated hardware CRC unit: 8-bit polynomial, no reversal, words are processed most significant byte first
+#define I2C_CRC_UNIT_EMULATED
+
+static uint8_t crc_unit_state = 0;
+static uint32_t crc_unit_word_feeds = 0;
+
+static uint8_t _CRCUnit_ProcessByte(uint8_t crc, uint8_t byte) {
+  int i;
+  crc ^= byte;
+  for (i = 0; i < 8; i++) {
+    crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ I2C_CRC_POLYNOMIAL) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+static inline void _I2C_CRCUnit_Start(uint8_t crc_state) {
+  crc_unit_state = crc_state;
+}
+
+static inline void _I2C_CRCUnit_FeedWord(uint32_t word) {
+  int i;
+  for (i = 3; i >= 0; i--) {
+    crc_unit_state = _CRCUnit_ProcessByte(crc_unit_state, (uint8_t)(word >> (8 * i)));
+  }
+  crc_unit_word_feeds++;
+}
+
+static inline void _I2C_CRCUnit_FeedByte(uint8_t byte) {
+  crc_unit_state = _CRCUnit_ProcessByte(crc_unit_state, byte);
+}
+
+static inline uint8_t _I2C_CRCUnit_GetResult() {
+  return crc_unit_state;
+}
+#endif
+
+//the engine itself, with access to its internal CRC functions and state
+#include "i2c_slave.c"
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+I2C_HandleTypeDef hi2c1;
+
+const I2C_Register i2c_registers[] = { I2C_REGISTER(0x01, 1, I2C_REG_READ, I2C_ReadInterruptFlags, NULL) };
+const uint8_t i2c_register_count = 1;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {}
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_EnableListen_IT(I2C_HandleTypeDef* hi2c) { return HAL_OK; }
+uint32_t HAL_I2C_GetError(const I2C_HandleTypeDef* hi2c) { return HAL_I2C_ERROR_NONE; }
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Receive_IT(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Transmit_IT(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Receive_DMA(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Transmit_DMA(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) { return HAL_OK; }
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+//bitwise reference: CRC-8, polynomial 0x7F, no reversal
+static uint8_t _RefCRC(uint8_t crc, const uint8_t* buf, uint32_t length) {
+  uint32_t i;
+  int b;
+  for (i = 0; i < length; i++) {
+    crc ^= buf[i];
+    for (b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x7F) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static uint8_t src_mem[I2C_VIRT_BUFFER_SIZE + 8];
+static uint8_t dest_mem[I2C_VIRT_BUFFER_SIZE + 8];
+
+//known values: empty data, single bytes, and a frame with a correct CRC byte appended checks to zero
+static void _Test_KnownValues() {
+  static const uint8_t one = 0x01;
+  _i2c_crc_state = 0;
+  CHECK_EQ(_I2C_CRC_Accumulate(&one, 0), 0x00);
+  CHECK_EQ(_I2C_CRC_Accumulate(&one, 1), 0x7F);
+
+  uint8_t frame[7] = { 0x94, 0x20, 0x12, 0x34, 0x56, 0x78, 0x00 };
+  frame[6] = _RefCRC(0, frame, 6);
+  _i2c_crc_state = 0;
+  CHECK_EQ(_I2C_CRC_Accumulate(frame, 7), 0);
+}
+
+//known answers over real DAP register frames (I2C address 0x4A, as on the BBV2 board), computed with the controller's
+//table-based CRC (module_interface_i2c.cpp) - the CRC unit path must produce the same bytes as the controller on the wire
+static void _Test_ControllerVectors() {
+  //write of VOLUME_GAINS = -6.0 dB, -12.5 dB: I2C write address, register address, 2 * float
+  static const uint8_t volume_prefix[2] = { 0x94, 0x41 };
+  static const uint8_t volume_data[8] = { 0x00, 0x00, 0xC0, 0xC0, 0x00, 0x00, 0x48, 0xC1 };
+  _i2c_crc_state = 0;
+  _I2C_CRC_Accumulate(volume_prefix, 2);
+  CHECK_EQ(_I2C_CRC_Accumulate(volume_data, 8), 0xAA);
+
+  //read of MODULE_ID: I2C write address, register address, I2C read address, then the ID
+  static const uint8_t id_frame[4] = { 0x94, 0xFF, 0x95, 0xD4 };
+  _i2c_crc_state = 0;
+  CHECK_EQ(_I2C_CRC_Accumulate(id_frame, 4), 0x16);
+
+  //write of FIR_COEFFS_CH1 (largest register, through the word path): coefficient k = k * 0x9E3779B1 (little-endian), first
+  //with the address prefix, then as a chained register without it
+  static const uint8_t fir_prefix[2] = { 0x94, 0x58 };
+  uint8_t* fir_data = src_mem + 1;
+  uint32_t k;
+  for (k = 0; k < I2CDEF_DAP_REG_SIZE_SP_FIR / 4; k++) {
+    uint32_t coeff = k * 0x9E3779B1U;
+    memcpy(fir_data + 4 * k, &coeff, 4);
+  }
+  _i2c_crc_state = 0;
+  _I2C_CRC_Accumulate(fir_prefix, 2);
+  CHECK_EQ(_I2C_CRC_Copy(dest_mem, fir_data, I2CDEF_DAP_REG_SIZE_SP_FIR), 0x17);
+  _i2c_crc_state = 0;
+  CHECK_EQ(_I2C_CRC_Accumulate(fir_data, I2CDEF_DAP_REG_SIZE_SP_FIR), 0x9A);
+}
+
+//accumulate and copy for all lengths up to the largest register, at all source/destination alignments, from random start states
+static void _Test_Equivalence() {
+  uint32_t length, src_offset, dest_offset;
+
+  for (length = 0; length <= I2C_VIRT_BUFFER_SIZE + 1 && length + 4 <= sizeof(src_mem); length++) {
+    for (src_offset = 0; src_offset < 4; src_offset++) {
+      uint8_t* src = src_mem + src_offset;
+      uint32_t i;
+      for (i = 0; i < length; i++) {
+        src[i] = (uint8_t)rand();
+      }
+      uint8_t start = (uint8_t)rand();
+      uint8_t expected = _RefCRC(start, src, length);
+
+      _i2c_crc_state = start;
+      CHECK_EQ(_I2C_CRC_Accumulate(src, (uint16_t)length), expected);
+      CHECK_EQ(_i2c_crc_state, expected);
+
+      dest_offset = (src_offset + length) % 4;
+      uint8_t* dest = dest_mem + dest_offset;
+      memset(dest_mem, 0xAA, sizeof(dest_mem));
+      _i2c_crc_state = start;
+      CHECK_EQ(_I2C_CRC_Copy(dest, src, (uint16_t)length), expected);
+      CHECK(memcmp(dest, src, length) == 0);
+      //nothing written past the end
+      CHECK_EQ(dest[length], 0xAA);
+    }
+  }
+}
+
+//chained transfers: the CRC of split data equals the CRC of the whole, as used for the address prefix and the data/CRC byte split
+static void _Test_Chaining() {
+  uint8_t data[64];
+  uint32_t i, split;
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 37 + 11);
+  }
+  uint8_t expected = _RefCRC(0, data, sizeof(data));
+
+  for (split = 0; split <= sizeof(data); split++) {
+    _i2c_crc_state = 0;
+    _I2C_CRC_Accumulate(data, (uint16_t)split);
+    CHECK_EQ(_I2C_CRC_Accumulate(data + split, (uint16_t)(sizeof(data) - split)), expected);
+  }
+
+#ifndef TEST_CRC_TABLE
+  //full words go through the word register: a 1200-byte coefficient register takes 300 word writes, not 1200 byte writes
+  crc_unit_word_feeds = 0;
+  _i2c_crc_state = 0;
+  _I2C_CRC_Accumulate(src_mem, I2C_VIRT_BUFFER_SIZE);
+  CHECK_EQ(crc_unit_word_feeds, I2C_VIRT_BUFFER_SIZE / 4);
+#endif
+}
+
+//benchmark of the CRC over the largest register (the table path is the software fallback; the unit path here only measures the emulation)
+static void _Benchmark() {
+  const int rounds = 2000;
+  int r;
+  volatile uint8_t sink = 0;
+
+  uint64_t start = HOST_GetTimeNs();
+  for (r = 0; r < rounds; r++) {
+    _i2c_crc_state = (uint8_t)r;
+    sink ^= _I2C_CRC_Copy(dest_mem, src_mem, I2C_VIRT_BUFFER_SIZE);
+  }
+  uint64_t elapsed = HOST_GetTimeNs() - start;
+  printf("CRC copy of %u bytes: %.0f ns\n", I2C_VIRT_BUFFER_SIZE, (double)elapsed / rounds);
+}
+
+
+int main() {
+  srand(1234);
+
+  _Test_KnownValues();
+  _Test_ControllerVectors();
+  _Test_Equivalence();
+  _Test_Chaining();
+  _Benchmark();
+
+#ifdef TEST_CRC_TABLE
+  return HOST_TestSummary("test_i2c_crc (table)");
+#else
+  return HOST_TestSummary("test_i2c_crc (CRC unit)");
+#endif
+}
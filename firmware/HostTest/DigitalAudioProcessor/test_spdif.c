@@ -0,0 +1,348 @@
+/*
+ * test_spdif.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the SPDIF receiver logic (spdif.c) with synthetic SPDIFRX frame dumps:
+ *  median rate detection and lock time, margin hysteresis, the clean-batch fast path, channel sorting and error concealment
+ */
+
+#include "host_test.h"
+#include "spdif.h"
+#include <stdlib.h>
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+SPDIFRX_HandleTypeDef hspdif1;
+static SPDIFRX_TypeDef spdifrx_regs;
+
+//DMA buffers handed to the HAL by the receiver
+static uint32_t* data_dma_buf = NULL;
+static uint32_t* ctrl_dma_buf = NULL;
+
+HAL_StatusTypeDef HAL_SPDIFRX_DMAStop(SPDIFRX_HandleTypeDef* hspdif) { return HAL_OK; }
+HAL_StatusTypeDef HAL_SPDIFRX_ReceiveCtrlFlow_DMA(SPDIFRX_HandleTypeDef* hspdif, uint32_t* pData, uint16_t Size) {
+  CHECK_EQ(Size, SPDIF_RX_CTL_BUF_WORDS);
+  ctrl_dma_buf = pData;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_SPDIFRX_ReceiveDataFlow_DMA(SPDIFRX_HandleTypeDef* hspdif, uint32_t* pData, uint16_t Size) {
+  CHECK_EQ(Size, SPDIF_RX_BUF_SAMPLES);
+  data_dma_buf = pData;
+  return HAL_OK;
+}
+uint32_t HAL_SPDIFRX_GetError(const SPDIFRX_HandleTypeDef* hspdif) { return 0; }
+
+//input management: record what the receiver asks for
+static uint32_t input_stop_calls = 0;
+static uint32_t input_rate_updates = 0;
+static uint32_t input_calls = 0;
+static q31_t input_samples[2][SPDIF_RX_BATCH_CHANNEL_SAMPLES];
+
+void INPUT_Stop(INPUT_Source input) {
+  CHECK_EQ(input, INPUT_SPDIF);
+  input_stop_calls++;
+}
+
+HAL_StatusTypeDef INPUT_UpdateSampleRate(INPUT_Source input) {
+  CHECK_EQ(input, INPUT_SPDIF);
+  input_rate_updates++;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef INPUT_ProcessSamples(INPUT_Source input, const q31_t* in_buf, uint16_t in_step, uint16_t in_channels, uint16_t in_samples, uint16_t in_buf_sample_cap, int8_t in_shift) {
+  CHECK_EQ(input, INPUT_SPDIF);
+  CHECK_EQ(in_channels, 2);
+  CHECK_EQ(in_samples, SPDIF_RX_BATCH_CHANNEL_SAMPLES);
+  CHECK_EQ(in_shift, 0);
+  input_calls++;
+  for (uint16_t i = 0; i < in_samples; i++) {
+    if (in_step == 1) {
+      //separate channel buffers
+      input_samples[0][i] = in_buf[i];
+      input_samples[1][i] = in_buf[in_buf_sample_cap + i];
+    } else {
+      //interleaved
+      input_samples[0][i] = in_buf[i * in_step];
+      input_samples[1][i] = in_buf[i * in_step + 1];
+    }
+  }
+  return HAL_OK;
+}
+
+
+/* --------------------------------------- synthetic frames --------------------------------------- */
+
+#define PT_B 1U  //channel A, start of block
+#define PT_M 2U  //channel A
+#define PT_W 3U  //channel B
+
+//WIDTH5 reading for the given sample rate
+static uint32_t _Width5(float rate) {
+  return (uint32_t)((5.0f * (float)SPDIF_KERNEL_CLK_FREQ) / (rate * 64.0f) + 0.5f);
+}
+
+//SPDIFRX DR1 word: 24-bit data left-aligned, preamble type and validity flag (set = invalid)
+static uint32_t _Frame(q31_t sample, uint32_t preamble_type, bool invalid) {
+  return ((uint32_t)sample & SPDIFRX_DR1_DR_Msk) | (preamble_type << SPDIFRX_DR1_PT_Pos) | (invalid ? SPDIFRX_DR1_V_Msk : 0);
+}
+
+//test signal per channel: a ramp with a different slope per channel, left-aligned 24-bit
+static q31_t _Signal(uint32_t channel, uint32_t n) {
+  return (q31_t)(((int32_t)(n * (channel ? 70001U : 50021U)) & 0x7FFFFF) - 0x400000) << 8;
+}
+
+static uint32_t batch_counter = 0;
+static uint32_t sample_counter = 0;
+
+//build one batch of interleaved frames from the test signal into the next DMA half, with optional corruptions, and deliver it
+typedef struct {
+  int invalid_ch;          //channel with invalid samples, -1 for none
+  uint32_t invalid_start;  //first invalid sample index (per channel)
+  uint32_t invalid_count;  //number of invalid samples
+  bool swap_order;         //channel B first in every frame pair
+} BatchCorruption;
+
+static void _DeliverBatch(const BatchCorruption* corr, uint32_t* frames_out) {
+  uint32_t* buf = data_dma_buf + ((batch_counter & 1) ? SPDIF_RX_BATCH_TOTAL_SAMPLES : 0);
+  for (uint32_t i = 0; i < SPDIF_RX_BATCH_CHANNEL_SAMPLES; i++) {
+    uint32_t n = sample_counter + i;
+    for (uint32_t ch = 0; ch < 2; ch++) {
+      bool invalid = corr != NULL && corr->invalid_ch == (int)ch && i >= corr->invalid_start && i < corr->invalid_start + corr->invalid_count;
+      uint32_t pt = (ch == 1) ? PT_W : (((n % 192) == 0) ? PT_B : PT_M);
+      uint32_t pos = 2 * i + ((corr != NULL && corr->swap_order) ? (1 - ch) : ch);
+      buf[pos] = _Frame(_Signal(ch, n), pt, invalid);
+    }
+  }
+  if (frames_out != NULL) {
+    memcpy(frames_out, buf, SPDIF_RX_BATCH_TOTAL_SAMPLES * sizeof(uint32_t));
+  }
+
+  if (batch_counter & 1) {
+    HAL_SPDIFRX_RxCpltCallback(&hspdif1);
+  } else {
+    HAL_SPDIFRX_RxHalfCpltCallback(&hspdif1);
+  }
+  batch_counter++;
+  sample_counter += SPDIF_RX_BATCH_CHANNEL_SAMPLES;
+}
+
+//deliver control words for one channel status block (starting with the start-of-block flag), with the given first channel status byte
+static void _DeliverControlBlock(uint8_t cs_byte0) {
+  static uint32_t block_counter = 0;
+  uint32_t* buf = ctrl_dma_buf + ((block_counter & 1) ? SPDIF_RX_CTLBLOCK_CHANNEL_BYTES : 0);
+  for (uint32_t i = 0; i < SPDIF_RX_CTLBLOCK_CHANNEL_BYTES; i++) {
+    uint32_t cs = (i == 0) ? cs_byte0 : 0;
+    buf[i] = (cs << SPDIFRX_CSR_CS_Pos) | ((i == 0) ? SPDIFRX_CSR_SOB_Msk : 0);
+  }
+  if (block_counter & 1) {
+    HAL_SPDIFRX_CxCpltCallback(&hspdif1);
+  } else {
+    HAL_SPDIFRX_CxHalfCpltCallback(&hspdif1);
+  }
+  block_counter++;
+}
+
+static void _SetRate(float rate) {
+  spdifrx_regs.SR = _Width5(rate) << SPDIFRX_SR_WIDTH5_Pos;
+}
+
+static void _Restart(float rate) {
+  SPDIF_Init();
+  SPDIF_HandleSyncDoneIRQ();
+  CHECK(data_dma_buf != NULL && ctrl_dma_buf != NULL);
+  _SetRate(rate);
+  //two blocks: the first marks the control data valid, the second gets the first one interpreted
+  _DeliverControlBlock(0x00);
+  _DeliverControlBlock(0x00);
+}
+
+//expected output sample for the given channel/index within the last delivered batch
+static q31_t _Expected(uint32_t ch, uint32_t i) {
+  return _Signal(ch, sample_counter - SPDIF_RX_BATCH_CHANNEL_SAMPLES + i) & (q31_t)SPDIFRX_DR1_DR_Msk;
+}
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+static void _Test_RateLock() {
+  const float rates[] = { 44100.0f, 48000.0f, 96000.0f };
+  const SRC_SampleRate enums[] = { SR_44K, SR_48K, SR_96K };
+
+  for (int r = 0; r < 3; r++) {
+    _Restart(rates[r]);
+    input_rate_updates = 0;
+    input_calls = 0;
+
+    //median of 5 readings: lock on the 3rd batch (the empty history counts as zeros before)
+    _DeliverBatch(NULL, NULL);
+    _DeliverBatch(NULL, NULL);
+    CHECK_EQ(spdif_sample_rate_enum, SR_UNKNOWN);
+    CHECK_EQ(input_calls, 0);
+    _DeliverBatch(NULL, NULL);
+    CHECK_EQ(spdif_sample_rate_enum, enums[r]);
+    CHECK_EQ(input_rate_updates, 1);
+    CHECK_EQ(input_calls, 1);
+  }
+
+  //single outliers are rejected
+  input_rate_updates = 0;
+  input_stop_calls = 0;
+  _SetRate(1000.0f);
+  _DeliverBatch(NULL, NULL);
+  _SetRate(96000.0f);
+  _DeliverBatch(NULL, NULL);
+  _SetRate(48000.0f);
+  _DeliverBatch(NULL, NULL);
+  _SetRate(96000.0f);
+  _DeliverBatch(NULL, NULL);
+  CHECK_EQ(spdif_sample_rate_enum, SR_96K);
+  CHECK_EQ(input_rate_updates, 0);
+  CHECK_EQ(input_stop_calls, 0);
+
+  //rate change: follows after a majority of the history has the new rate
+  for (int i = 0; i < 5; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+  _SetRate(48000.0f);
+  _DeliverBatch(NULL, NULL);
+  _DeliverBatch(NULL, NULL);
+  CHECK_EQ(spdif_sample_rate_enum, SR_96K);
+  _DeliverBatch(NULL, NULL);
+  CHECK_EQ(spdif_sample_rate_enum, SR_48K);
+  CHECK_EQ(input_rate_updates, 1);
+}
+
+static void _Test_RateHysteresis() {
+  //1.2% off: not accepted for activation (1%), but kept once locked (1.5%)
+  _Restart(48000.0f * 1.012f);
+  for (int i = 0; i < 5; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+  CHECK_EQ(spdif_sample_rate_enum, SR_UNKNOWN);
+
+  _Restart(48000.0f);
+  for (int i = 0; i < 5; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+  CHECK_EQ(spdif_sample_rate_enum, SR_48K);
+  input_stop_calls = 0;
+  _SetRate(48000.0f * 1.012f);
+  for (int i = 0; i < 5; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+  CHECK_EQ(spdif_sample_rate_enum, SR_48K);
+  CHECK_EQ(input_stop_calls, 0);
+
+  //2% off: lost, input stopped
+  _SetRate(48000.0f * 1.02f);
+  for (int i = 0; i < 5; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+  CHECK_EQ(spdif_sample_rate_enum, SR_UNKNOWN);
+  CHECK_EQ(input_stop_calls, 1);
+}
+
+static void _Test_CleanBatch() {
+  uint32_t frames[SPDIF_RX_BATCH_TOTAL_SAMPLES];
+  _Restart(48000.0f);
+  for (int i = 0; i < 3; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+
+  input_calls = 0;
+  _DeliverBatch(NULL, frames);
+  CHECK_EQ(input_calls, 1);
+  bool ok = true;
+  for (uint32_t i = 0; i < SPDIF_RX_BATCH_CHANNEL_SAMPLES; i++) {
+    if (input_samples[0][i] != _Expected(0, i) || input_samples[1][i] != _Expected(1, i)) ok = false;
+  }
+  CHECK(ok);
+
+  //channel order swapped: sorted by preamble instead
+  BatchCorruption swap = { -1, 0, 0, true };
+  _DeliverBatch(&swap, NULL);
+  CHECK_EQ(input_calls, 2);
+  ok = true;
+  for (uint32_t i = 0; i < SPDIF_RX_BATCH_CHANNEL_SAMPLES; i++) {
+    if (input_samples[0][i] != _Expected(0, i) || input_samples[1][i] != _Expected(1, i)) ok = false;
+  }
+  CHECK(ok);
+}
+
+static void _Test_Concealment() {
+  _Restart(48000.0f);
+  for (int i = 0; i < 3; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+
+  //short gap within a batch: linear interpolation between the neighbouring valid samples
+  BatchCorruption gap = { 0, 10, 5, false };
+  _DeliverBatch(&gap, NULL);
+  q31_t before = _Expected(0, 9);
+  q31_t after = _Expected(0, 15);
+  bool ok = true;
+  for (uint32_t k = 0; k < 5; k++) {
+    q31_t expected = before + (q31_t)(((int64_t)after - before) * (k + 1) / 6);
+    if (input_samples[0][10 + k] != expected) ok = false;
+  }
+  CHECK(ok);
+  //the other channel and the rest are untouched
+  CHECK_EQ(input_samples[0][9], before);
+  CHECK_EQ(input_samples[0][15], after);
+  CHECK_EQ(input_samples[1][12], _Expected(1, 12));
+
+  //gap at the end of the batch: held, then continued into the next batch
+  BatchCorruption tail = { 1, SPDIF_RX_BATCH_CHANNEL_SAMPLES - 4, 4, false };
+  _DeliverBatch(&tail, NULL);
+  q31_t held = _Expected(1, SPDIF_RX_BATCH_CHANNEL_SAMPLES - 5);
+  CHECK_EQ(input_samples[1][SPDIF_RX_BATCH_CHANNEL_SAMPLES - 4], held);
+  CHECK_EQ(input_samples[1][SPDIF_RX_BATCH_CHANNEL_SAMPLES - 1], held);
+
+  //long burst: held up to the concealment limit, muted after that
+  BatchCorruption burst = { 0, 20, 40, false };
+  _DeliverBatch(&burst, NULL);
+  q31_t last = _Expected(0, 19);
+  CHECK_EQ(input_samples[0][20], last);
+  CHECK_EQ(input_samples[0][20 + SPDIF_CONCEAL_MAX_SAMPLES - 1], last);
+  CHECK_EQ(input_samples[0][20 + SPDIF_CONCEAL_MAX_SAMPLES], 0);
+  CHECK_EQ(input_samples[0][59], 0);
+  CHECK_EQ(input_samples[0][60], _Expected(0, 60));
+}
+
+static void _Test_ControlBlocks() {
+  _Restart(48000.0f);
+  for (int i = 0; i < 3; i++) {
+    _DeliverBatch(NULL, NULL);
+  }
+
+  //non-audio data flagged in the channel status: input stopped, batches ignored
+  input_stop_calls = 0;
+  _DeliverControlBlock(0x02);
+  _DeliverControlBlock(0x02);
+  CHECK_EQ(input_stop_calls, 1);
+  input_calls = 0;
+  _DeliverBatch(NULL, NULL);
+  CHECK_EQ(input_calls, 0);
+
+  //back to audio: reception resumes once that block has been interpreted (at the start of the next one)
+  _DeliverControlBlock(0x00);
+  _DeliverControlBlock(0x00);
+  _DeliverBatch(NULL, NULL);
+  CHECK_EQ(input_calls, 1);
+}
+
+
+int main() {
+  hspdif1.Instance = &spdifrx_regs;
+
+  _Test_RateLock();
+  _Test_RateHysteresis();
+  _Test_CleanBatch();
+  _Test_Concealment();
+  _Test_ControlBlocks();
+
+  return HOST_TestSummary("test_spdif");
+}
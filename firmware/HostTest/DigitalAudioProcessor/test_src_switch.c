@@ -0,0 +1,222 @@
+/*
+ * test_src_switch.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host simulation of DAP input switches through the SRC (sample_rate_conv.c), batch by batch at the output clock: input A is
+ *  active, then the active input is switched to input B, whose clock has a different error against the output clock. Input
+ *  samples arrive in whole receive batches at the sources' actual rates. B's rate error is tracked while it is idle, like the
+ *  inputs module does (received samples over a window of SRC output batches). Compares the warm switch (SRC_SwitchInput with
+ *  B's tracked rate error) with a cold one (rate error unknown, the adaptive loop re-converges), and reports:
+ *   - output gap: batches from the switch until the new input is output again (after the old signal's fade-out)
+ *   - settling time: until the 100 ms average resampling ratio stays within the loop's steady-state jitter (500 ppm) of B's
+ *     actual ratio and the averaged buffer fill error within 48 samples (100 ms resolution)
+ *   - maximum ratio excursion of 10 ms averages in the first 10 s after the switch (audible as pitch shift)
+ *  The warm switch's output gap is a few milliseconds (fade-out and buffer refill), and its ratio stays within the loop's
+ *  steady-state jitter from the start, so it settles within the 100 ms resolution. The cold loop swings by thousands of ppm while
+ *  its averaging windows grow, and depending on the receive batch timing takes from a few hundred milliseconds to seconds.
+ */
+
+#include "host_test.h"
+#include "sample_rate_conv.h"
+#include "inputs.h"
+#include "i2c.h"
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+INPUT_Source input_active = INPUT_NONE;
+
+//the SRC stops the active input on a buffer underrun
+static uint32_t underruns = 0;
+void INPUT_Stop(INPUT_Source input) {
+  underruns++;
+}
+
+void I2C_TriggerInterrupt(uint8_t interrupt_bit) {}
+
+//current adaptive resampling phase step (input samples per output batch), from the SRC's debug access
+extern float* const src_debug_adaptive_decimation_ptr;
+
+
+/* --------------------------------------- sources and rate tracking --------------------------------------- */
+
+//input samples per receive batch (I2S DMA half-buffer)
+#define TEST_RX_BATCH_SAMPLES 96
+//simulated time before and after the switch, in output batches (1 ms each)
+#define TEST_PRE_SWITCH_BATCHES 10000
+#define TEST_POST_SWITCH_BATCHES 20000
+
+//input source with a clock error against the output clock, delivering a tone in whole receive batches
+typedef struct {
+  SRC_SampleRate rate;
+  double ppm;
+  double phase;                 //receive batch phase offset
+  uint64_t received_samples;
+} TestSource;
+
+//receive batches arriving during output batch n - returns their count
+static uint32_t _Source_Receive(TestSource* source, uint32_t n) {
+  double period = (double)TEST_RX_BATCH_SAMPLES / ((double)source->rate * (1.0 + source->ppm * 1e-6));
+  double t0 = (double)n * SRC_BATCH_CHANNEL_SAMPLES / (double)SR_96K;
+  double t1 = (double)(n + 1) * SRC_BATCH_CHANNEL_SAMPLES / (double)SR_96K;
+  return (uint32_t)(floor(t1 / period + source->phase) - floor(t0 / period + source->phase));
+}
+
+//feeds one receive batch of the source to the SRC
+static void _Source_Feed(TestSource* source) {
+  static q31_t in_buf[TEST_RX_BATCH_SAMPLES];
+  const q31_t* in_ptrs[1] = { in_buf };
+  int j;
+
+  for (j = 0; j < TEST_RX_BATCH_SAMPLES; j++) {
+    double phase = 2.0 * M_PI * 997.0 * (double)(source->received_samples + j) / (double)source->rate;
+    in_buf[j] = (q31_t)lround(0.5 * 2147483647.0 * sin(phase));
+  }
+  SRC_ProcessInputSamples(in_ptrs, 1, 1, TEST_RX_BATCH_SAMPLES, 0);
+}
+
+//rate error of an idle input, measured like the inputs module: received samples (at the SRC output rate) vs. SRC output samples
+//over a window of at least INPUT_RATE_TRACK_MIN_BATCHES
+static bool _TrackedRateError(const TestSource* source, uint32_t window_batches, float* rate_error) {
+  if (window_batches < INPUT_RATE_TRACK_MIN_BATCHES) {
+    return false;
+  }
+  int64_t input_samples = ((int64_t)source->received_samples * (int64_t)SR_96K) / (int64_t)source->rate;
+  int64_t output_samples = (int64_t)window_batches * SRC_BATCH_CHANNEL_SAMPLES;
+  *rate_error = (float)(input_samples - output_samples) / (float)output_samples;
+  return true;
+}
+
+
+/* --------------------------------------- switch simulation --------------------------------------- */
+
+typedef struct {
+  uint32_t gap_batches;
+  uint32_t settled_batches;
+  double max_excursion_ppm;
+  uint32_t underruns;
+} TestSwitchResult;
+
+static TestSwitchResult _RunSwitch(SRC_SampleRate rate_a, double ppm_a, SRC_SampleRate rate_b, double ppm_b, bool warm) {
+  static float ratios[TEST_POST_SWITCH_BATCHES];
+  static float fill_errors[TEST_POST_SWITCH_BATCHES];
+  static q31_t out_buf[SRC_BATCH_CHANNEL_SAMPLES];
+  q31_t* out_ptrs[1] = { out_buf };
+  TestSource a = { rate_a, ppm_a, 0.37, 0 };
+  TestSource b = { rate_b, ppm_b, 0.71, 0 };
+  TestSwitchResult result = { 0, 0, 0.0, 0 };
+  bool restarted = false, output_back = false;
+  uint32_t n, k;
+
+  CHECK_EQ(SRC_Configure(rate_a), HAL_OK);
+  SRC_TakeStreamRestart();
+  uint32_t start_batch = SRC_GetOutputBatchCount();
+  underruns = 0;
+
+  for (n = 0; n < TEST_PRE_SWITCH_BATCHES + TEST_POST_SWITCH_BATCHES; n++) {
+    bool b_active = (n >= TEST_PRE_SWITCH_BATCHES);
+
+    //both sources keep receiving, only the active one feeds the SRC
+    uint32_t count = _Source_Receive(&a, n);
+    for (k = 0; k < count; k++) {
+      if (!b_active) {
+        _Source_Feed(&a);
+      }
+      a.received_samples += TEST_RX_BATCH_SAMPLES;
+    }
+    count = _Source_Receive(&b, n);
+    for (k = 0; k < count; k++) {
+      if (b_active) {
+        _Source_Feed(&b);
+      }
+      b.received_samples += TEST_RX_BATCH_SAMPLES;
+    }
+
+    if (n == TEST_PRE_SWITCH_BATCHES) {
+      float rate_error = 0.0f;
+      bool known = _TrackedRateError(&b, SRC_GetOutputBatchCount() - start_batch, &rate_error);
+      CHECK(known);
+      CHECK_EQ(SRC_SwitchInput(rate_b, warm && known, rate_error), HAL_OK);
+      result.underruns = underruns;
+    }
+
+    //a restart during this batch's output still leaves the batch with the old signal, so it's taken before
+    restarted = restarted || SRC_TakeStreamRestart();
+    HAL_StatusTypeDef status = SRC_ProduceOutputBatch(out_ptrs, 1, 1);
+    if (!b_active) {
+      continue;
+    }
+
+    uint32_t i = n - TEST_PRE_SWITCH_BATCHES;
+    if (!output_back) {
+      if (restarted && status == HAL_OK) {
+        output_back = true;
+      } else {
+        result.gap_batches++;
+      }
+    }
+    ratios[i] = (output_back && !SRC_IsFixedRatioActive()) ? *src_debug_adaptive_decimation_ptr / (float)SRC_BATCH_CHANNEL_SAMPLES : NAN;
+    fill_errors[i] = SRC_GetAverageBufferFillError();
+  }
+  result.underruns = underruns - result.underruns;
+
+  //settling: from the end backwards, the last 100 ms window whose average ratio or averaged fill error was out of bounds
+  double true_ratio = 1.0 + ppm_b * 1e-6;
+  int32_t w;
+  for (w = TEST_POST_SWITCH_BATCHES - 100; w >= 0; w -= 10) {
+    double sum = 0.0;
+    for (k = 0; k < 100; k++) {
+      sum += ratios[w + k];
+    }
+    if (isnan(sum) || fabs(sum / 100.0 - true_ratio) * 1e6 > 500.0 || fabsf(fill_errors[w + 99]) > 48.0f) {
+      result.settled_batches = (uint32_t)w + 100;
+      break;
+    }
+  }
+
+  //excursion of 10 ms averages in the first 10 s
+  for (w = 0; w < 10000; w += 10) {
+    double sum = 0.0;
+    for (k = 0; k < 10; k++) {
+      sum += ratios[w + k];
+    }
+    if (!isnan(sum)) {
+      result.max_excursion_ppm = fmax(result.max_excursion_ppm, fabs(sum / 10.0 - true_ratio) * 1e6);
+    }
+  }
+
+  return result;
+}
+
+static void _Test_Switch(const char* name, SRC_SampleRate rate_a, double ppm_a, SRC_SampleRate rate_b, double ppm_b) {
+  TestSwitchResult cold = _RunSwitch(rate_a, ppm_a, rate_b, ppm_b, false);
+  TestSwitchResult warm = _RunSwitch(rate_a, ppm_a, rate_b, ppm_b, true);
+
+  printf("%s:\n", name);
+  printf("  cold switch: output gap %3u ms, settled after %5u ms, max ratio excursion %6.0f ppm, underruns %u\n", cold.gap_batches,
+         cold.settled_batches, cold.max_excursion_ppm, cold.underruns);
+  printf("  warm switch: output gap %3u ms, settled after %5u ms, max ratio excursion %6.0f ppm, underruns %u\n", warm.gap_batches,
+         warm.settled_batches, warm.max_excursion_ppm, warm.underruns);
+
+  //fade-out and buffer refill only: a few milliseconds
+  CHECK_MSG(warm.gap_batches <= 10, "warm output gap %u ms", warm.gap_batches);
+  CHECK_MSG(warm.settled_batches <= 500, "warm switch settled after %u ms", warm.settled_batches);
+  CHECK_MSG(warm.max_excursion_ppm < 1000.0, "warm switch ratio excursion %.0f ppm", warm.max_excursion_ppm);
+  CHECK_EQ(warm.underruns, 0u);
+  //the cold loop re-converges from short averaging windows, with large ratio (pitch) swings on the way
+  CHECK_MSG(cold.max_excursion_ppm > 4.0 * warm.max_excursion_ppm, "cold switch ratio excursion %.0f ppm", cold.max_excursion_ppm);
+}
+
+
+/* --------------------------------------- main --------------------------------------- */
+
+int main() {
+  CHECK_EQ(SRC_Init(), HAL_OK);
+
+  _Test_Switch("I2S 48k +40 ppm -> I2S 48k -60 ppm", SR_48K, 40.0, SR_48K, -60.0);
+  _Test_Switch("I2S 48k +40 ppm -> I2S 44.1k -25 ppm", SR_48K, 40.0, SR_44K, -25.0);
+
+  return HOST_TestSummary("test_src_switch");
+}
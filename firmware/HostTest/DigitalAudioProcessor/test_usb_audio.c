@@ -0,0 +1,572 @@
+/*
+ * test_usb_audio.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the USB audio OUT path (usbd_audio.c): block unpacking of 24/32-bit packets and the split volume handling,
+ *  checked sample by sample against a byte-wise reference; plus a host timing comparison of the two.
+ *  Also simulates the asynchronous feedback loop millisecond by millisecond, with the real SRC (sample_rate_conv.c) behind it:
+ *   - the 10.14 feedback value from the measured output clock (USBD_AUDIO_MeasureOutputClock), at all rates, and its clamping
+ *   - the lock hysteresis of the feedback (which allows the SRC's fixed-ratio mode): lock below 24 samples of averaged buffer
+ *     fill error, unlock at 96 when the host drifts slowly off the feedback - after unlocking, the SRC leaves fixed-ratio mode
+ *   - a host drifting fast: the SRC leaves fixed-ratio mode on its own once the buffer drifts beyond
+ *     SRC_FIXED_RATIO_MAX_FILL_ERROR, before the averaged fill error unlocks the feedback
+ */
+
+#include "host_test.h"
+#include "inputs.h"
+#include "sai_out.h"
+#include "sample_rate_conv.h"
+#include "i2c.h"
+#include <stdlib.h>
+
+//the test includes usbd_audio.c to reach its feedback state, with the USB frame number (FNSOF) emulated
+#define USBD_AUDIO_FNSOF_EMULATED
+static uint32_t sim_fnsof = 0;
+static inline uint32_t USBD_AUDIO_GetFrameNumber(void) {
+  return sim_fnsof;
+}
+#include "usbd_audio.c"
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+INPUT_Source input_active = INPUT_USB;
+
+//while set, received samples go to the SRC like the inputs module does - for the feedback loop simulation
+static bool input_forward = false;
+
+//last INPUT_ProcessSamples call - not captured while benchmarking
+static bool input_capture = true;
+static uint32_t input_calls = 0;
+static q31_t input_samples[2][128];
+static uint16_t input_sample_count = 0;
+static int8_t input_shift = 0;
+
+HAL_StatusTypeDef INPUT_ProcessSamples(INPUT_Source input, const q31_t* in_buf, uint16_t in_step, uint16_t in_channels, uint16_t in_samples, uint16_t in_buf_sample_cap, int8_t in_shift) {
+  if (input_forward) {
+    const q31_t* in_ptrs[2] = { in_buf, in_buf + in_buf_sample_cap };
+    return SRC_ProcessInputSamples(in_ptrs, in_step, in_channels, in_samples, in_shift);
+  }
+  if (!input_capture) return HAL_OK;
+  CHECK_EQ(input, INPUT_USB);
+  CHECK_EQ(in_step, 1);
+  CHECK_EQ(in_channels, 2);
+  CHECK(in_samples <= in_buf_sample_cap);
+  input_calls++;
+  input_sample_count = in_samples;
+  input_shift = in_shift;
+  for (uint16_t i = 0; i < in_samples; i++) {
+    input_samples[0][i] = in_buf[i];
+    input_samples[1][i] = in_buf[in_buf_sample_cap + i];
+  }
+  return HAL_OK;
+}
+
+//the SRC stops the active input on a buffer underrun
+static uint32_t input_stops = 0;
+void INPUT_Stop(INPUT_Source input) {
+  input_stops++;
+}
+
+void I2C_TriggerInterrupt(uint8_t interrupt_bit) {}
+
+//output clock: its error against the host's SOF clock, output frames since the start - the SAI DMA position follows from it
+static double out_ppm = 0.0;
+static double out_frames = 0.0;
+uint32_t SAI_OUT_GetBufferFramePosition() {
+  return (uint32_t)((uint64_t)out_frames % SAI_OUT_BUF_FRAMES);
+}
+
+//USB low-level driver: endpoints just remember their receive buffers, packets are "received" by the tests
+static uint8_t* ep_rx_bufs[16];
+static uint32_t ep_rx_counts[16];
+
+USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef* pdev, uint8_t ep_addr, uint8_t ep_type, uint16_t ep_mps) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef* pdev, uint8_t ep_addr) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef* pdev, uint8_t ep_addr) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef* pdev, uint8_t ep_addr) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef* pdev, uint8_t ep_addr, uint8_t* pbuf, uint32_t size) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef* pdev, uint8_t ep_addr, uint8_t* pbuf, uint32_t size) {
+  ep_rx_bufs[ep_addr & 0xF] = pbuf;
+  return USBD_OK;
+}
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef* pdev, uint8_t ep_addr) { return ep_rx_counts[ep_addr & 0xF]; }
+void USBD_CtlError(USBD_HandleTypeDef* pdev, USBD_SetupReqTypedef* req) {}
+
+void* USBD_static_malloc(uint32_t size) {
+  static uint32_t mem[(sizeof(USBD_AUDIO_HandleTypeDef) / 4) + 1];
+  return mem;
+}
+void USBD_static_free(void* p) {}
+
+static int8_t _Itf_Init(uint32_t freq, uint32_t volume, uint32_t options) { return 0; }
+static int8_t _Itf_DeInit(uint32_t options) { return 0; }
+static int8_t _Itf_VolumeCtl(uint8_t vol) { return 0; }
+static int8_t _Itf_MuteCtl(uint8_t cmd) { return 0; }
+static USBD_AUDIO_ItfTypeDef _itf = { _Itf_Init, _Itf_DeInit, NULL, _Itf_VolumeCtl, _Itf_MuteCtl, NULL, NULL };
+
+
+/* --------------------------------------- helpers --------------------------------------- */
+
+static USBD_HandleTypeDef usb;
+
+static void _SetInterface(uint8_t alt) {
+  USBD_SetupReqTypedef req = { 0 };
+  req.bmRequest = USB_REQ_TYPE_STANDARD | USB_REQ_RECIPIENT_INTERFACE;
+  req.bRequest = USB_REQ_SET_INTERFACE;
+  req.wValue = alt;
+  CHECK_EQ(USBD_AUDIO.Setup(&usb, &req), USBD_OK);
+}
+
+static void _SetFeature(uint8_t cs, const uint8_t* data, uint16_t len) {
+  USBD_SetupReqTypedef req = { 0 };
+  req.bmRequest = USB_REQ_TYPE_CLASS | USB_REQ_RECIPIENT_INTERFACE;
+  req.bRequest = AUDIO_REQ_SET_CUR;
+  req.wValue = (uint16_t)cs << 8;
+  req.wLength = len;
+  CHECK_EQ(USBD_AUDIO.Setup(&usb, &req), USBD_OK);
+  memcpy(ep_rx_bufs[0], data, len);
+  USBD_AUDIO.EP0_RxReady(&usb);
+}
+
+static void _SetVolumeSteps(uint32_t steps_3dB) {
+  int16_t volume = (int16_t)(USBD_AUDIO_VOL_MAX - steps_3dB * USBD_AUDIO_VOL_STEP);
+  _SetFeature(AUDIO_CONTROL_REQ_FU_VOL, (const uint8_t*)&volume, 2);
+}
+
+static void _SetMute(uint8_t mute) {
+  _SetFeature(AUDIO_CONTROL_REQ_FU_MUTE, &mute, 1);
+}
+
+//deliver a packet on the audio OUT endpoint
+static void _ReceivePacket(const uint8_t* data, uint32_t length) {
+  memcpy(ep_rx_bufs[AUDIO_OUT_EP & 0xF], data, length);
+  ep_rx_counts[AUDIO_OUT_EP & 0xF] = length;
+  USBD_AUDIO.DataOut(&usb, AUDIO_OUT_EP);
+}
+
+//byte-wise reference unpack: sample as left-aligned q31, with the odd 3dB step applied as x0.75
+static q31_t _RefSample(const uint8_t* p, bool is_32b, uint32_t steps_3dB) {
+  q31_t s;
+  if (is_32b) {
+    s = (q31_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+  } else {
+    s = (q31_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+  }
+  if (steps_3dB & 1) {
+    s = s - (s >> 2);
+  }
+  return s;
+}
+
+//previous implementation (sign-extended 24-bit, whole volume applied in place, then left-aligned), for 24-bit data
+static q31_t _OldSample24(const uint8_t* p, uint32_t steps_3dB) {
+  int32_t s = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 8;
+  int32_t shift6 = (int32_t)(steps_3dB >> 1);
+  if (steps_3dB & 1) {
+    shift6++;
+    s >>= shift6;
+    s += s >> 1;
+  } else {
+    s >>= shift6;
+  }
+  return (q31_t)((uint32_t)s << 8);
+}
+
+static void _FillRandom(uint8_t* buf, uint32_t length) {
+  for (uint32_t i = 0; i < length; i++) {
+    buf[i] = (uint8_t)rand();
+  }
+  //include full-scale extremes in every packet
+  if (length >= 12) {
+    buf[0] = 0x00; buf[1] = 0x00; buf[2] = 0x80;
+    buf[3] = 0xFF; buf[4] = 0xFF; buf[5] = 0x7F;
+  }
+}
+
+//send random packets of the given frame count and check the unpacked result against the reference
+static void _CheckPackets(bool is_32b, uint32_t frames, uint32_t steps_3dB) {
+  uint8_t packet[1024];
+  uint32_t frame_bytes = is_32b ? 8 : 6;
+  uint32_t sample_bytes = frame_bytes / 2;
+
+  for (int rep = 0; rep < 20; rep++) {
+    _FillRandom(packet, frames * frame_bytes);
+    input_calls = 0;
+    _ReceivePacket(packet, frames * frame_bytes);
+
+    CHECK_EQ(input_calls, 1);
+    CHECK_EQ(input_sample_count, frames);
+    CHECK_EQ(input_shift, steps_3dB >> 1);
+
+    for (uint32_t i = 0; i < frames; i++) {
+      for (uint32_t ch = 0; ch < 2; ch++) {
+        const uint8_t* p = packet + i * frame_bytes + ch * sample_bytes;
+        q31_t ref = _RefSample(p, is_32b, steps_3dB);
+        if (input_samples[ch][i] != ref) {
+          CHECK_MSG(input_samples[ch][i] == ref, "%s frame %lu/%lu ch %lu vol %lu: %08lx vs %08lx", is_32b ? "32b" : "24b", (unsigned long)i,
+                    (unsigned long)frames, (unsigned long)ch, (unsigned long)steps_3dB, (unsigned long)input_samples[ch][i], (unsigned long)ref);
+          return;
+        }
+
+        if (!is_32b) {
+          //effective level after the SRC applies the deferred shift must match the old in-place volume within rounding
+          q31_t effective = input_samples[ch][i] >> input_shift;
+          q31_t old = _OldSample24(p, steps_3dB);
+          if (llabs((long long)effective - (long long)old) > (2LL << 8)) {
+            CHECK_MSG(false, "24b frame %lu ch %lu vol %lu: effective %ld vs old %ld", (unsigned long)i, (unsigned long)ch, (unsigned long)steps_3dB,
+                      (long)effective, (long)old);
+            return;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+static void _Test_Formats() {
+  //24-bit: frame counts of all rates, including odd ones (44.1kHz has 44/45 frame packets)
+  _SetInterface(AUDIO_OUT_ALT_SETTING_24B);
+  const uint32_t frame_counts[] = { 1, 2, 3, 44, 45, 47, 48, 49, 95, 96, 97 };
+  for (uint32_t vol = 0; vol <= 7; vol++) {
+    _SetVolumeSteps(vol);
+    for (uint32_t i = 0; i < sizeof(frame_counts) / sizeof(frame_counts[0]); i++) {
+      _CheckPackets(false, frame_counts[i], vol);
+    }
+  }
+
+  //32-bit
+  _SetInterface(AUDIO_OUT_ALT_SETTING_32B);
+  for (uint32_t vol = 0; vol <= 7; vol++) {
+    _SetVolumeSteps(vol);
+    for (uint32_t i = 0; i < sizeof(frame_counts) / sizeof(frame_counts[0]); i++) {
+      _CheckPackets(true, frame_counts[i], vol);
+    }
+  }
+
+  //minimum volume (-96dB) is the largest shift
+  _SetInterface(AUDIO_OUT_ALT_SETTING_24B);
+  _SetVolumeSteps(32);
+  _CheckPackets(false, 48, 32);
+  _SetVolumeSteps(0);
+}
+
+static void _Test_Mute() {
+  uint8_t packet[1024];
+  _SetInterface(AUDIO_OUT_ALT_SETTING_24B);
+  _SetMute(1);
+
+  _FillRandom(packet, 48 * 6);
+  input_calls = 0;
+  _ReceivePacket(packet, 48 * 6);
+  //muted input stays alive with silent data
+  CHECK_EQ(input_calls, 1);
+  CHECK_EQ(input_sample_count, 48);
+  bool all_zero = true;
+  for (uint32_t i = 0; i < 48; i++) {
+    if (input_samples[0][i] != 0 || input_samples[1][i] != 0) all_zero = false;
+  }
+  CHECK(all_zero);
+
+  _SetMute(0);
+  _CheckPackets(false, 48, 0);
+}
+
+static void _Test_InvalidPackets() {
+  uint8_t packet[1024];
+  _FillRandom(packet, sizeof(packet));
+
+  //oversized packets are dropped entirely
+  _SetInterface(AUDIO_OUT_ALT_SETTING_24B);
+  input_calls = 0;
+  _ReceivePacket(packet, AUDIO_OUT_PACKET_24B + 6);
+  CHECK_EQ(input_calls, 0);
+  _SetInterface(AUDIO_OUT_ALT_SETTING_32B);
+  _ReceivePacket(packet, AUDIO_OUT_PACKET_32B + 8);
+  CHECK_EQ(input_calls, 0);
+
+  //maximum-size packets are accepted
+  _ReceivePacket(packet, AUDIO_OUT_PACKET_32B);
+  CHECK_EQ(input_calls, 1);
+  CHECK_EQ(input_sample_count, AUDIO_OUT_PACKET_32B / 8);
+
+  //empty packets don't produce input calls
+  input_calls = 0;
+  _ReceivePacket(packet, 0);
+  CHECK_EQ(input_calls, 0);
+
+  //packets are ignored while the streaming interface is inactive
+  _SetInterface(0);
+  _ReceivePacket(packet, 48 * 6);
+  CHECK_EQ(input_calls, 0);
+}
+
+
+
+/* --------------------------------------- feedback loop simulation --------------------------------------- */
+
+//simulated stream state: SRC output batches produced so far, host frames (sent and due), whether the host follows the feedback
+static bool sim_streaming = false;
+static uint32_t sim_out_batches = 0;
+static bool host_following = true;
+static double host_rate = 0.0;
+static double host_frames = 0.0;
+static uint64_t host_sent = 0;
+
+//feedback as sent to the host: 10.14 format, frames per ms
+static uint32_t _Feedback1014() {
+  return (uint32_t)fb_data[0] | ((uint32_t)fb_data[1] << 8) | ((uint32_t)fb_data[2] << 16);
+}
+
+//averaged SRC buffer fill error, as the SOF handler sees it
+static float _FillError() {
+  return (input_active == INPUT_USB && SRC_IsReady()) ? SRC_GetAverageBufferFillError() : 0.0f;
+}
+
+//one millisecond: the output clock consumes SRC batches, SOF (with the feedback transmission completing), then the host's packet.
+//packets arriving right after the output batches is the worst case for the SRC's starting fill level (one packet over ideal)
+static void _Step() {
+  static q31_t out_buf[2][SRC_BATCH_CHANNEL_SAMPLES];
+  q31_t* out_ptrs[2] = { out_buf[0], out_buf[1] };
+
+  out_frames += (double)SRC_BATCH_CHANNEL_SAMPLES * (1.0 + out_ppm * 1e-6);
+  while (sim_out_batches < (uint32_t)(out_frames / SRC_BATCH_CHANNEL_SAMPLES)) {
+    if (sim_streaming) {
+      SRC_ProduceOutputBatch(out_ptrs, 1, 2);
+    }
+    sim_out_batches++;
+  }
+
+  sim_fnsof = (sim_fnsof + 1) & 0x7FFU;
+  USBD_AUDIO.SOF(&usb);
+  USBD_AUDIO.DataIn(&usb, AUDIO_IN_EP & 0xF);
+
+  if (sim_streaming) {
+    static uint8_t packet[AUDIO_OUT_PACKET_24B];
+    if (host_following) {
+      host_rate = (double)_Feedback1014() / (double)(1 << 14);
+    }
+    host_frames += host_rate;
+    uint64_t frames = ((uint64_t)host_frames > host_sent) ? (uint64_t)host_frames - host_sent : 0;
+    _ReceivePacket(packet, (uint32_t)frames * 6);
+    host_sent += frames;
+  }
+}
+
+//restart the output clock measurement, and let it measure for the given time without streaming
+static void _Measure(double ppm, uint32_t ms) {
+  out_ppm = ppm;
+  //skipping a frame number restarts the measurement window, like a missed SOF
+  sim_fnsof = (sim_fnsof + 1) & 0x7FFU;
+  fb_meas_valid = 0U;
+  for (uint32_t i = 0; i < ms; i++) {
+    _Step();
+  }
+}
+
+//start streaming 24-bit 96kHz through the SRC, with the host following the feedback
+static void _StartStream() {
+  CHECK_EQ(SRC_Configure(SR_96K), HAL_OK);
+  _SetInterface(0);
+  _SetInterface(AUDIO_OUT_ALT_SETTING_24B);
+  host_following = true;
+  host_frames = 0.0;
+  host_sent = 0;
+  input_forward = true;
+  sim_streaming = true;
+}
+
+//lock transitions seen by _TrackLock, each checked against the hysteresis thresholds
+static uint32_t lock_count = 0;
+static uint32_t unlock_count = 0;
+//steps spent locked with a fill error between the thresholds (only possible through the hysteresis)
+static uint32_t locked_between = 0;
+
+static void _TrackLock(uint8_t* prev_locked) {
+  float fill_error = fabsf(_FillError());
+  if (fb_locked != *prev_locked) {
+    if (fb_locked == 1U) {
+      CHECK_MSG(fill_error < AUDIO_FB_LOCK_MAX_FILL_ERROR, "locked at fill error %.1f", fill_error);
+      lock_count++;
+    } else {
+      CHECK_MSG(fill_error >= AUDIO_FB_UNLOCK_MIN_FILL_ERROR, "unlocked at fill error %.1f", fill_error);
+      unlock_count++;
+    }
+  } else if (fb_locked == 1U && fill_error >= AUDIO_FB_LOCK_MAX_FILL_ERROR) {
+    locked_between++;
+  }
+  *prev_locked = fb_locked;
+}
+
+
+/* --------------------------------------- feedback tests --------------------------------------- */
+
+static void _Test_FeedbackValue() {
+  USBD_AUDIO_HandleTypeDef* haudio = (USBD_AUDIO_HandleTypeDef*)usb.pClassDataCmsit[usb.classId];
+  const uint32_t freqs[] = { 44100, 48000, 96000 };
+  const double ppms[] = { -250.0, 0.0, 100.0 };
+
+  //no SRC stream: the feedback is the measured output rate, converted to the host's rate
+  _SetInterface(AUDIO_OUT_ALT_SETTING_24B);
+  for (uint32_t f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++) {
+    haudio->freq = freqs[f];
+    AUDIO_OUT_Restart(&usb);
+    CHECK_EQ(fb_nom, (uint32_t)(((uint64_t)freqs[f] << 22) / 1000U));
+
+    for (uint32_t p = 0; p < sizeof(ppms) / sizeof(ppms[0]); p++) {
+      //several windows, so the filtered measurement settles below the single-window resolution
+      _Measure(ppms[p], 8 * AUDIO_FB_MEAS_WINDOW_SOFS + 2);
+      CHECK(fb_meas_valid == 1U);
+      double expected = (double)freqs[f] / 1000.0 * (1.0 + ppms[p] * 1e-6) * (double)(1 << 14);
+      double value = (double)_Feedback1014();
+      //resolution: one frame per measurement window
+      CHECK_MSG(fabs(value - expected) <= (double)(1 << 14) / AUDIO_FB_MEAS_WINDOW_SOFS, "%lu Hz %+.0f ppm: feedback %.0f, expected %.1f",
+                (unsigned long)freqs[f], ppms[p], value, expected);
+      CHECK_EQ(_Feedback1014(), fb_value >> 8);
+      CHECK(fb_locked == 1U);
+    }
+  }
+
+  //an output clock far off (2%) is clamped to nominal +1 frame per ms
+  _Measure(20000.0, 2 * AUDIO_FB_MEAS_WINDOW_SOFS + 2);
+  CHECK_EQ(_Feedback1014(), (96U + 1U) << 14);
+  _Measure(-20000.0, 2 * AUDIO_FB_MEAS_WINDOW_SOFS + 2);
+  CHECK_EQ(_Feedback1014(), (96U - 1U) << 14);
+
+  haudio->freq = USBD_AUDIO_FREQ_DEFAULT;
+  _SetInterface(0);
+}
+
+static void _Test_FeedbackLoop() {
+  uint8_t prev_locked = 0U;
+  uint32_t i;
+
+  //the measurement runs before streaming starts, so the feedback is accurate from the first packet
+  _Measure(100.0, AUDIO_FB_MEAS_WINDOW_SOFS + 2);
+  input_stops = 0;
+  lock_count = unlock_count = locked_between = 0;
+  _StartStream();
+
+  //host follows the feedback: the SRC starts in fixed-ratio mode and stays there, while the fill correction removes the
+  //SRC's starting fill error
+  for (i = 0; i < 60000; i++) {
+    _Step();
+    _TrackLock(&prev_locked);
+  }
+  double expected = 96.0 * (1.0 + 100e-6) * (double)(1 << 14);
+  printf("feedback loop: feedback %lu (expected %.1f), fill error %.1f\n", (unsigned long)_Feedback1014(), expected, _FillError());
+  CHECK(SRC_IsFixedRatioActive());
+  CHECK(fb_locked == 1U);
+  CHECK_EQ(unlock_count, 0u);
+  CHECK(fabsf(_FillError()) < AUDIO_FB_LOCK_MAX_FILL_ERROR);
+  CHECK(fabs((double)_Feedback1014() - expected) <= 32.0);
+
+  //the host stops following the feedback and drifts slowly (50 ppm): the averaged fill error grows past the lock threshold
+  //and stays locked (hysteresis) until it reaches the unlock threshold - the SRC stays in fixed-ratio mode until then, and
+  //leaves it because it's no longer allowed
+  host_following = false;
+  host_rate *= 1.0 + 50e-6;
+  locked_between = 0;
+  for (i = 0; i < 60000 && unlock_count == 0; i++) {
+    _Step();
+    _TrackLock(&prev_locked);
+    if (unlock_count == 0) {
+      CHECK(SRC_IsFixedRatioActive());
+    }
+  }
+  _Step();
+  printf("feedback loop: host 50 ppm fast: unlocked after %lu ms, %lu ms locked between the thresholds\n", (unsigned long)i,
+         (unsigned long)locked_between);
+  CHECK_EQ(unlock_count, 1u);
+  CHECK(locked_between > 0);
+  CHECK(!SRC_IsFixedRatioActive());
+
+  //host follows again: adaptive resampling and the fill correction bring the fill error back, locks again below the lock threshold
+  host_following = true;
+  for (i = 0; i < 60000 && lock_count < 2; i++) {
+    _Step();
+    _TrackLock(&prev_locked);
+  }
+  printf("feedback loop: locked again %lu ms after following again\n", (unsigned long)i);
+  CHECK_EQ(lock_count, 2u);
+  CHECK_EQ(unlock_count, 1u);
+
+  //restart in fixed-ratio mode, then the host drifts fast (500 ppm): the SRC leaves fixed-ratio mode by itself once the buffer is
+  //SRC_FIXED_RATIO_MAX_FILL_ERROR (192 samples, ~4 s at 48 samples/s) over, while the averaged fill error still keeps the feedback locked
+  _StartStream();
+  for (i = 0; i < 60000; i++) {
+    _Step();
+  }
+  CHECK(SRC_IsFixedRatioActive());
+  host_following = false;
+  host_rate *= 1.0 + 500e-6;
+  for (i = 0; i < 10000 && SRC_IsFixedRatioActive(); i++) {
+    _Step();
+  }
+  printf("feedback loop: host 500 ppm fast: left fixed-ratio mode after %lu ms, fill error %.1f\n", (unsigned long)i, _FillError());
+  CHECK(!SRC_IsFixedRatioActive());
+  CHECK_MSG(i > 3000 && i < 5000, "left fixed-ratio mode after %lu ms", (unsigned long)i);
+  CHECK(fb_locked == 1U);
+
+  CHECK_EQ(input_stops, 0u);
+  input_forward = false;
+  sim_streaming = false;
+  _SetInterface(0);
+}
+
+//host timing comparison of the block unpack (through DataOut) and the byte-wise reference - informational only
+static void _Bench() {
+  const uint32_t iterations = 20000;
+  uint8_t packet[1024];
+  _FillRandom(packet, sizeof(packet));
+
+  _SetInterface(AUDIO_OUT_ALT_SETTING_24B);
+  _SetVolumeSteps(3);
+  memcpy(ep_rx_bufs[AUDIO_OUT_EP & 0xF], packet, 96 * 6);
+  ep_rx_counts[AUDIO_OUT_EP & 0xF] = 96 * 6;
+
+  input_capture = false;
+  uint64_t start = HOST_GetTimeNs();
+  for (uint32_t i = 0; i < iterations; i++) {
+    USBD_AUDIO.DataOut(&usb, AUDIO_OUT_EP);
+  }
+  uint64_t block_ns = HOST_GetTimeNs() - start;
+  input_capture = true;
+
+  static volatile q31_t sink[2][96];
+  start = HOST_GetTimeNs();
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (uint32_t f = 0; f < 96; f++) {
+      sink[0][f] = _OldSample24(packet + 6 * f, 3);
+      sink[1][f] = _OldSample24(packet + 6 * f + 3, 3);
+    }
+  }
+  uint64_t ref_ns = HOST_GetTimeNs() - start;
+
+  printf("bench: 96-frame 24-bit packet: DataOut (block unpack) %.1f ns, byte-wise reference unpack %.1f ns\n",
+         (double)block_ns / iterations, (double)ref_ns / iterations);
+}
+
+
+int main() {
+  srand(1234);
+  CHECK_EQ(SRC_Init(), HAL_OK);
+
+  usb.dev_state = USBD_STATE_CONFIGURED;
+  usb.pUserData[0] = &_itf;
+  CHECK_EQ(USBD_AUDIO.Init(&usb, 0), USBD_OK);
+
+  _Test_Formats();
+  _Test_Mute();
+  _Test_InvalidPackets();
+  _Test_FeedbackValue();
+  _Test_FeedbackLoop();
+  _Bench();
+
+  return HOST_TestSummary("test_usb_audio");
+}
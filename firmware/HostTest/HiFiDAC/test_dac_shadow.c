@@ -0,0 +1,466 @@
+/*
+ * test_dac_shadow.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the HiFiDAC shadow register map (dac_spi.c) and its use by the DAC control (dac_control.c), against a
+ *  simulated DAC register file on a simulated SPI bus with DMA: init transfer and read-back, coalescing of shadow writes
+ *  into burst transactions (gap merging, unknown registers, buffer and transaction limits), shadow writes during an
+ *  ongoing background flush, DMA start/transfer errors and flush timeouts, and the background verification in the main
+ *  loop repairing corrupted DAC registers. Reports the SPI traffic of the init against per-register confirmed writes.
+ */
+
+#include "host_test.h"
+#include "dac_spi.h"
+#include "dac_control.h"
+#include "i2c.h"
+#include <stdlib.h>
+
+
+/* --------------------------------------- simulated DAC and SPI bus --------------------------------------- */
+
+#define SIM_DMA_LOG_SIZE 64
+
+typedef struct {
+  uint8_t address;
+  uint8_t length;
+} SimTransaction;
+
+//register file: all addresses, read/write registers 0x00-0x8E, read-only registers 0xE0-0xFB
+static uint8_t sim_regs[256];
+//read/write registers written since the last soft reset - the driver must not read back others
+static bool sim_written[256];
+//register that ignores writes (broken bit, stuck value), -1 for none
+static int sim_stuck_address = -1;
+
+static bool sim_nss_low = false;
+
+//DMA transfer in progress (data captured at the start to detect buffer changes during the transfer)
+static const uint8_t* sim_dma_data = NULL;
+static uint8_t sim_dma_copy[DAC_SPI_FLUSH_BUFFER_SIZE];
+static uint16_t sim_dma_size = 0;
+static bool sim_dma_busy = false;
+//fault injection: fail the next DMA start, fail the n-th following DMA transfer (0 = off), stall DMA transfers
+static bool sim_dma_fail_start = false;
+static uint32_t sim_dma_fail_countdown = 0;
+static bool sim_dma_stall = false;
+
+//interrupt pin (GPIO4), lock pin (GPIO2), automute state read register
+static bool sim_int_pin = false;
+static bool sim_lock_pin = true;
+
+//statistics
+static uint32_t sim_dma_transactions = 0;
+static uint32_t sim_dma_bytes = 0;
+static uint32_t sim_write_transactions = 0;
+static uint32_t sim_read_transactions = 0;
+static uint32_t sim_spi_bytes = 0;
+static SimTransaction sim_dma_log[SIM_DMA_LOG_SIZE];
+static uint32_t sim_i2c_interrupts = 0;
+
+static void _SimResetStats() {
+  sim_dma_transactions = sim_dma_bytes = sim_write_transactions = sim_read_transactions = sim_spi_bytes = 0;
+}
+
+//soft reset: read/write registers return to their (arbitrary) defaults
+static void _SimSoftReset() {
+  int i;
+  for (i = 0; i < DAC_SPI_RW_REGISTER_COUNT; i++) {
+    sim_regs[i] = (uint8_t)(i * 7 + 1);
+    sim_written[i] = false;
+  }
+  sim_regs[REG_SYSTEM_CONFIG] = 0x00;
+  sim_regs[REG_CHIP_ID_READ] = DAC_EXPECTED_CHIP_ID;
+}
+
+//register write with auto-incrementing address
+static void _SimWrite(const uint8_t* data, uint16_t size) {
+  int i;
+  CHECK(size >= 3 && data[0] == 0x03);
+  uint8_t address = data[1];
+  if (address == REG_SYSTEM_CONFIG && (data[2] & 0x80) != 0) {
+    _SimSoftReset();
+    return;
+  }
+  for (i = 2; i < size; i++, address++) {
+    CHECK_MSG(address < DAC_SPI_RW_REGISTER_COUNT, "write to 0x%02X", address);
+    if (address == REG_INTERRUPT_CLEAR && data[i] == 0xFF) {
+      sim_int_pin = false;
+    }
+    if (address != sim_stuck_address) {
+      sim_regs[address] = data[i];
+    }
+    sim_written[address] = true;
+  }
+}
+
+static void _SimCompleteDMA() {
+  sim_dma_busy = false;
+  CHECK(sim_nss_low);
+  CHECK_MSG(memcmp(sim_dma_data, sim_dma_copy, sim_dma_size) == 0, "flush buffer changed during the DMA transfer");
+  if (sim_dma_fail_countdown > 0 && --sim_dma_fail_countdown == 0) {
+    HAL_SPI_ErrorCallback(&hspi1);
+    return;
+  }
+  _SimWrite(sim_dma_copy, sim_dma_size);
+  HAL_SPI_TxCpltCallback(&hspi1);
+}
+
+//"interrupts" during busy-waits: DMA completes, unless stalled - then time passes instead
+static void _SimTickHook() {
+  if (sim_dma_busy) {
+    if (sim_dma_stall) {
+      host_tick_ms++;
+    } else {
+      _SimCompleteDMA();
+    }
+  }
+}
+
+//let all ongoing background transfers complete
+static void _SimRunDMA() {
+  while (sim_dma_busy) {
+    _SimCompleteDMA();
+  }
+}
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+SPI_HandleTypeDef hspi1;
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+  CHECK(sim_nss_low && !sim_dma_busy);
+  sim_write_transactions++;
+  sim_spi_bytes += Size;
+  _SimWrite(pData, Size);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* hspi, uint8_t* pTxData, uint8_t* pRxData, uint16_t Size, uint32_t Timeout) {
+  int i;
+  CHECK(sim_nss_low && !sim_dma_busy);
+  CHECK(Size >= 3 && pTxData[0] == 0x01);
+  sim_read_transactions++;
+  sim_spi_bytes += Size;
+  for (i = 2; i < Size; i++) {
+    uint8_t address = pTxData[1] + i - 2;
+    CHECK_MSG(address >= DAC_SPI_RW_REGISTER_COUNT || sim_written[address], "read of unwritten register 0x%02X", address);
+    pRxData[i] = sim_regs[address];
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size) {
+  CHECK(sim_nss_low && !sim_dma_busy);
+  if (sim_dma_fail_start) {
+    sim_dma_fail_start = false;
+    return HAL_ERROR;
+  }
+  CHECK(Size <= DAC_SPI_FLUSH_BUFFER_SIZE);
+  if (sim_dma_transactions < SIM_DMA_LOG_SIZE) {
+    sim_dma_log[sim_dma_transactions].address = pData[1];
+    sim_dma_log[sim_dma_transactions].length = Size - 2;
+  }
+  sim_dma_transactions++;
+  sim_dma_bytes += Size;
+  sim_spi_bytes += Size;
+  sim_dma_data = pData;
+  memcpy(sim_dma_copy, pData, Size);
+  sim_dma_size = Size;
+  sim_dma_busy = true;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort_IT(SPI_HandleTypeDef* hspi) {
+  sim_dma_busy = false;
+  HAL_SPI_AbortCpltCallback(hspi);
+  return HAL_OK;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  if (GPIOx == SPI1_NSS_GPIO_Port && GPIO_Pin == SPI1_NSS_Pin) {
+    //NSS toggles once per transaction, never while a DMA transfer is running
+    CHECK(sim_nss_low != (PinState == GPIO_PIN_RESET));
+    CHECK(!sim_dma_busy);
+    sim_nss_low = (PinState == GPIO_PIN_RESET);
+  }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin) {
+  if (GPIOx == GPIO4_GPIO_Port && GPIO_Pin == GPIO4_Pin) {
+    return sim_int_pin ? GPIO_PIN_SET : GPIO_PIN_RESET;
+  }
+  if (GPIOx == GPIO2_GPIO_Port && GPIO_Pin == GPIO2_Pin) {
+    return sim_lock_pin ? GPIO_PIN_SET : GPIO_PIN_RESET;
+  }
+  return GPIO_PIN_RESET;
+}
+
+void I2C_TriggerInterrupt(uint8_t interrupt_bit) {
+  sim_i2c_interrupts++;
+}
+
+
+/* --------------------------------------- helpers --------------------------------------- */
+
+//whether the DAC holds the shadow values of all given registers
+static bool _DACMatchesShadow(uint8_t start, uint8_t count) {
+  int i;
+  for (i = start; i < start + count; i++) {
+    if (sim_regs[i] != DAC_SPI_ShadowRead8((DAC_SPI_Register)i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void _CheckTransaction(uint32_t index, uint8_t address, uint8_t length) {
+  CHECK_MSG(sim_dma_log[index].address == address && sim_dma_log[index].length == length, "transaction %u: 0x%02X+%u, expected 0x%02X+%u",
+            index, sim_dma_log[index].address, sim_dma_log[index].length, address, length);
+}
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+//init: configuration transferred in a few bursts and verified with one read-back pass; a stuck register fails the init
+static void _Test_Init(uint32_t* init_bytes, uint32_t* init_transactions, uint32_t* shadowed_registers) {
+  int i;
+
+  _SimSoftReset();
+  _SimResetStats();
+  CHECK_EQ(DAC_CheckChipID(), HAL_OK);
+  CHECK_EQ(DAC_Init(), HAL_OK);
+  CHECK(DAC_SPI_IsFlushComplete());
+  CHECK_EQ(sim_regs[REG_SYSTEM_CONFIG], 0x02);
+  CHECK_EQ(sim_regs[REG_VOLUME_CH1], DAC_VOL_INIT_CH1 + DAC_VOL_CAL_CH1);
+  CHECK_EQ(sim_regs[REG_CH2_SLOT_CONFIG], 0x01);
+  CHECK_EQ(sim_regs[REG_AUTOMUTE_TIME + 1], 0x08);
+  CHECK_EQ(sim_regs[REG_DPLL_BW], 0x40);
+
+  *shadowed_registers = 0;
+  for (i = 0; i < DAC_SPI_RW_REGISTER_COUNT; i++) {
+    //everything the driver configured is in the DAC (registers not shadowed read back as 0 from the shadow)
+    if (sim_written[i] && i != REG_SYS_MODE_CONFIG && i != REG_DPLL_BW) {
+      CHECK_EQ(sim_regs[i], DAC_SPI_ShadowRead8((DAC_SPI_Register)i));
+      (*shadowed_registers)++;
+    }
+  }
+  //far fewer transfers than registers
+  CHECK(sim_dma_transactions < *shadowed_registers / 2);
+  *init_bytes = sim_spi_bytes;
+  *init_transactions = sim_dma_transactions + sim_write_transactions + sim_read_transactions;
+
+  //a register that doesn't take the written value is caught by the read-back
+  _SimSoftReset();
+  sim_stuck_address = REG_TDM_CONFIG2;
+  CHECK_EQ(DAC_Init(), HAL_ERROR);
+  sim_stuck_address = -1;
+  CHECK_EQ(DAC_Init(), HAL_OK);
+}
+
+//shadow writes are coalesced: only changed registers, last value wins, adjacent and nearby registers in one burst
+static void _Test_Coalescing() {
+  //unchanged value: nothing to transfer
+  _SimResetStats();
+  CHECK_EQ(DAC_WriteChannelVolumes(DAC_VOL_INIT_CH1, DAC_VOL_INIT_CH2), HAL_OK);
+  CHECK(DAC_SPI_IsFlushComplete());
+  CHECK_EQ(DAC_SPI_Flush(), HAL_OK);
+  CHECK_EQ(sim_dma_transactions, 0);
+
+  //several volume changes before a flush: one burst of both channels with the last values
+  CHECK_EQ(DAC_WriteChannelVolumes(10, 12), HAL_OK);
+  CHECK_EQ(DAC_WriteChannelVolumes(20, 22), HAL_OK);
+  CHECK_EQ(DAC_WriteChannelVolumes(30, 32), HAL_OK);
+  CHECK(!DAC_SPI_IsFlushComplete());
+  CHECK_EQ(DAC_SPI_Flush(), HAL_OK);
+  CHECK_EQ(DAC_SPI_Flush(), HAL_BUSY);
+  _SimRunDMA();
+  CHECK_EQ(sim_dma_transactions, 1);
+  _CheckTransaction(0, REG_VOLUME_CH1, 2);
+  CHECK_EQ(sim_regs[REG_VOLUME_CH1], 30 + DAC_VOL_CAL_CH1);
+  CHECK_EQ(sim_regs[REG_VOLUME_CH2], 32 + DAC_VOL_CAL_CH2);
+  CHECK(DAC_SPI_IsFlushComplete());
+
+  //one known unchanged register between two dirty ones is rewritten as part of the burst
+  _SimResetStats();
+  CHECK_EQ(DAC_SPI_ShadowWrite8(REG_DAC_VOL_UP_RATE, 0x05), HAL_OK);
+  CHECK_EQ(DAC_SPI_ShadowWrite8(REG_DAC_VOL_DOWN_RATE_FAST, 0xFE), HAL_OK);
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+  CHECK_EQ(sim_dma_transactions, 1);
+  _CheckTransaction(0, REG_DAC_VOL_UP_RATE, 3);
+
+  //larger gaps, and gaps of registers not known to the shadow, start a new transaction
+  _SimResetStats();
+  CHECK_EQ(DAC_WriteChannelVolumes(40, 40), HAL_OK);
+  CHECK_EQ(DAC_WriteChannelMutes(true, false), HAL_OK);
+  CHECK_EQ(DAC_SPI_ShadowWrite8(REG_SYSTEM_CONFIG, 0x00), HAL_OK);
+  CHECK_EQ(DAC_SPI_ShadowWrite8(REG_DAC_CLOCK_CONFIG, 0x81), HAL_OK);
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+  CHECK_EQ(sim_dma_transactions, 4);
+  _CheckTransaction(0, REG_SYSTEM_CONFIG, 1);
+  _CheckTransaction(1, REG_DAC_CLOCK_CONFIG, 1);
+  _CheckTransaction(2, REG_VOLUME_CH1, 2);
+  _CheckTransaction(3, REG_DAC_MUTE, 1);
+  CHECK(_DACMatchesShadow(REG_VOLUME_CH1, 2));
+  CHECK_EQ(sim_regs[REG_DAC_MUTE], 0x01);
+
+  CHECK_EQ(DAC_WriteChannelMutes(false, false), HAL_OK);
+  CHECK_EQ(DAC_SPI_ShadowWrite8(REG_SYSTEM_CONFIG, 0x02), HAL_OK);
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+}
+
+//more dirty ranges than transactions per flush, and more dirty data than the flush buffer: multiple flush rounds
+static void _Test_Limits() {
+  //all registers after the system and sys mode config
+  const uint8_t first = 0x02;
+  int i;
+
+  //every 4th register changed (separate ranges, also over registers not known to the shadow so far)
+  _SimResetStats();
+  for (i = first; i < DAC_SPI_RW_REGISTER_COUNT; i += 4) {
+    CHECK_EQ(DAC_SPI_ShadowWrite8((DAC_SPI_Register)i, DAC_SPI_ShadowRead8((DAC_SPI_Register)i) ^ 0x40), HAL_OK);
+  }
+  CHECK_EQ(DAC_SPI_Flush(), HAL_OK);
+  _SimRunDMA();
+  CHECK_EQ(sim_dma_transactions, DAC_SPI_FLUSH_MAX_TRANSACTIONS);
+  CHECK(!DAC_SPI_IsFlushComplete());
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+  CHECK(DAC_SPI_IsFlushComplete());
+  CHECK_EQ(sim_dma_transactions, (DAC_SPI_RW_REGISTER_COUNT - REG_DAC_CLOCK_CONFIG + 4) / 4);
+  for (i = first; i < DAC_SPI_RW_REGISTER_COUNT; i += 4) {
+    CHECK(_DACMatchesShadow(i, 1));
+  }
+
+  //all registers from 0x02 changed: one contiguous range larger than the flush buffer, split over two flushes
+  _SimResetStats();
+  for (i = first; i < DAC_SPI_RW_REGISTER_COUNT; i++) {
+    CHECK_EQ(DAC_SPI_ShadowWrite8((DAC_SPI_Register)i, DAC_SPI_ShadowRead8((DAC_SPI_Register)i) ^ 0x40), HAL_OK);
+  }
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+  CHECK_EQ(sim_dma_transactions, 2);
+  _CheckTransaction(0, first, DAC_SPI_FLUSH_BUFFER_SIZE - 2);
+  CHECK_EQ(sim_dma_bytes, DAC_SPI_RW_REGISTER_COUNT - first + 4);
+  CHECK(_DACMatchesShadow(first, DAC_SPI_RW_REGISTER_COUNT - first));
+}
+
+//shadow writes (from the I2C interrupt) while a flush is transferring: the flush buffer is untouched, and the new value follows in the next flush
+static void _Test_WriteDuringFlush() {
+  _SimResetStats();
+  CHECK_EQ(DAC_WriteChannelVolumes(50, 50), HAL_OK);
+  CHECK_EQ(DAC_SPI_Flush(), HAL_OK);
+  CHECK(sim_dma_busy);
+  CHECK_EQ(DAC_WriteChannelVolumes(60, 50), HAL_OK);
+  _SimRunDMA();
+  CHECK_EQ(sim_regs[REG_VOLUME_CH1], 50 + DAC_VOL_CAL_CH1);
+  CHECK(!DAC_SPI_IsFlushComplete());
+  CHECK_EQ(DAC_SPI_Flush(), HAL_OK);
+  _SimRunDMA();
+  CHECK_EQ(sim_dma_transactions, 2);
+  _CheckTransaction(1, REG_VOLUME_CH1, 1);
+  CHECK_EQ(sim_regs[REG_VOLUME_CH1], 60 + DAC_VOL_CAL_CH1);
+  CHECK(DAC_SPI_IsFlushComplete());
+}
+
+//failed DMA starts and transfers keep the affected registers dirty, a stalled transfer is aborted by the next blocking access
+static void _Test_Errors() {
+  uint8_t value;
+
+  //DMA fails to start
+  CHECK_EQ(DAC_WriteChannelVolumes(70, 70), HAL_OK);
+  sim_dma_fail_start = true;
+  CHECK_EQ(DAC_SPI_Flush(), HAL_ERROR);
+  CHECK(!sim_nss_low);
+  CHECK(!DAC_SPI_IsFlushComplete());
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+  CHECK(_DACMatchesShadow(REG_VOLUME_CH1, 2));
+
+  //second of three transactions fails: it and the third are requeued
+  _SimResetStats();
+  CHECK_EQ(DAC_SPI_ShadowWrite8(REG_CLOCK_CONFIG, 0x05), HAL_OK);
+  CHECK_EQ(DAC_WriteChannelVolumes(80, 80), HAL_OK);
+  CHECK_EQ(DAC_WriteFilterShape(3), HAL_OK);
+  sim_dma_fail_countdown = 2;
+  CHECK_EQ(DAC_SPI_Flush(), HAL_OK);
+  _SimRunDMA();
+  CHECK_EQ(sim_dma_transactions, 2);
+  CHECK_EQ(sim_regs[REG_CLOCK_CONFIG], 0x05);
+  CHECK(!_DACMatchesShadow(REG_VOLUME_CH1, 2));
+  CHECK(!DAC_SPI_IsFlushComplete());
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+  CHECK_EQ(sim_dma_transactions, 4);
+  CHECK(_DACMatchesShadow(REG_VOLUME_CH1, 2));
+  CHECK(_DACMatchesShadow(REG_FILTER_SHAPE, 1));
+
+  //stalled transfer: a blocking read times out and aborts it, the data is requeued
+  CHECK_EQ(DAC_WriteChannelVolumes(90, 90), HAL_OK);
+  CHECK_EQ(DAC_SPI_Flush(), HAL_OK);
+  sim_dma_stall = true;
+  uint32_t start = host_tick_ms;
+  CHECK_EQ(DAC_SPI_Read8(REG_VOLUME_CH1, &value), HAL_TIMEOUT);
+  CHECK(host_tick_ms - start > DAC_SPI_FLUSH_TIMEOUT);
+  CHECK(!sim_dma_busy && !sim_nss_low);
+  sim_dma_stall = false;
+  CHECK(!DAC_SPI_IsFlushComplete());
+  CHECK_EQ(DAC_SPI_FlushBlocking(), HAL_OK);
+  CHECK(_DACMatchesShadow(REG_VOLUME_CH1, 2));
+}
+
+//main loop: background verification finds corrupted DAC registers and the flush rewrites them; interrupt and lock pin handling
+static void _Test_LoopUpdate() {
+  int i;
+
+  //DAC loses two registers (e.g. a glitch on the supply)
+  sim_regs[REG_VOLUME_CH2] ^= 0x10;
+  sim_regs[REG_THD_C3_CH2 + 1] ^= 0x01;
+  CHECK(!_DACMatchesShadow(REG_VOLUME_CH2, 1));
+
+  //one full verification cycle over the whole register map
+  for (i = 0; i < DAC_VERIFY_PERIOD * ((DAC_SPI_RW_REGISTER_COUNT + DAC_VERIFY_CHUNK_SIZE - 1) / DAC_VERIFY_CHUNK_SIZE + 1); i++) {
+    DAC_LoopUpdate();
+    _SimRunDMA();
+  }
+  CHECK(_DACMatchesShadow(REG_VOLUME_CH2, 1));
+  CHECK(_DACMatchesShadow(REG_THD_C3_CH2, 2));
+  CHECK(DAC_SPI_IsFlushComplete());
+
+  //DAC interrupt: states read and cleared, automute change reported to the I2C host
+  sim_i2c_interrupts = 0;
+  sim_regs[REG_INTERRUPT_STATES] = 0x04;
+  sim_regs[REG_AUTOMUTE_READ] = 0x01;
+  sim_int_pin = true;
+  DAC_LoopUpdate();
+  CHECK(!sim_int_pin);
+  CHECK(dac_status.automute_ch1);
+  CHECK_EQ(sim_i2c_interrupts, 1);
+
+  //lock pin change
+  sim_lock_pin = false;
+  DAC_LoopUpdate();
+  CHECK(!dac_status.src_lock);
+  CHECK_EQ(sim_i2c_interrupts, 2);
+  _SimRunDMA();
+}
+
+
+/* --------------------------------------- main --------------------------------------- */
+
+int main() {
+  uint32_t init_bytes, init_transactions, shadowed_registers;
+
+  host_tick_hook = _SimTickHook;
+
+  _Test_Init(&init_bytes, &init_transactions, &shadowed_registers);
+  _Test_Coalescing();
+  _Test_Limits();
+  _Test_WriteDuringFlush();
+  _Test_Errors();
+  _Test_LoopUpdate();
+
+  //per-register confirmed writes (previous init): write transaction plus read-back transaction, 3 bytes each
+  printf("init SPI traffic: %u transactions, %u bytes (per-register confirmed writes of the %u shadowed registers: %u transactions, %u bytes)\n",
+         init_transactions, init_bytes, shadowed_registers, 2 * shadowed_registers, 6 * shadowed_registers);
+
+  return HOST_TestSummary("test_dac_shadow");
+}
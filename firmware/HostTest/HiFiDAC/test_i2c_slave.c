@@ -0,0 +1,624 @@
+/*
+ * test_i2c_slave.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the shared I2C slave register engine (ModuleShared/Src/i2c_slave.c) with the HiFiDAC register table
+ *  (i2c.c), driven through the HAL I2C slave callbacks by a simulated bus master: register table checks against the
+ *  register size definitions (including broken tables), register reads/writes with the CRC-8 on the wire, address
+ *  auto-increment across registers of different sizes and into invalid addresses, CRC errors, invalid and read-only
+ *  accesses, the interrupt flag/mask/pin logic, and recovery from stuck transfers and a busy peripheral.
+ */
+
+#include "host_test.h"
+#include "i2c.h"
+#include "dac_control.h"
+#include <stdlib.h>
+
+//count peripheral resets instead of touching the RCC
+#undef I2C_FORCE_RESET
+#undef I2C_RELEASE_RESET
+static uint32_t sim_peripheral_resets = 0;
+#define I2C_FORCE_RESET() (sim_peripheral_resets++)
+#define I2C_RELEASE_RESET() do {} while (0)
+
+//the engine, built against a switchable register table so the table check can be fed broken tables
+static const I2C_Register* test_registers = NULL;
+static uint8_t test_register_count = 0;
+#define i2c_registers test_registers
+#define i2c_register_count test_register_count
+#include "i2c_slave.c"
+#undef i2c_registers
+#undef i2c_register_count
+
+
+/* --------------------------------------- simulated bus master and I2C peripheral --------------------------------------- */
+
+#define SIM_OWN_ADDRESS 58
+
+I2C_HandleTypeDef hi2c1;
+static I2C_TypeDef sim_i2c_regs;
+
+//transfer currently set up by the engine (receive or transmit), and how it was started
+static uint8_t* sim_rx_buf = NULL;
+static uint16_t sim_rx_size = 0;
+static uint16_t sim_rx_pos = 0;
+static uint8_t* sim_tx_buf = NULL;
+static uint16_t sim_tx_size = 0;
+static uint16_t sim_tx_pos = 0;
+static uint32_t sim_it_transfers = 0;
+static uint32_t sim_dma_transfers = 0;
+
+static uint32_t sim_error_code = HAL_I2C_ERROR_NONE;
+static uint32_t sim_listen_enables = 0;
+static GPIO_PinState sim_int_pin = GPIO_PIN_SET;
+
+static const uint16_t sim_reg_sizes[256] = I2CDEF_HIFIDAC_REG_SIZES;
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c) { return HAL_OK; }
+
+HAL_StatusTypeDef HAL_I2C_EnableListen_IT(I2C_HandleTypeDef* hi2c) {
+  sim_listen_enables++;
+  return HAL_OK;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef* hi2c) {
+  return sim_error_code;
+}
+
+static HAL_StatusTypeDef _Sim_StartReceive(uint8_t* pData, uint16_t Size) {
+  sim_rx_buf = pData;
+  sim_rx_size = Size;
+  sim_rx_pos = 0;
+  sim_tx_buf = NULL;
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef _Sim_StartTransmit(uint8_t* pData, uint16_t Size) {
+  sim_tx_buf = pData;
+  sim_tx_size = Size;
+  sim_tx_pos = 0;
+  sim_rx_buf = NULL;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Receive_IT(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) {
+  sim_it_transfers++;
+  return _Sim_StartReceive(pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Transmit_IT(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) {
+  sim_it_transfers++;
+  return _Sim_StartTransmit(pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Receive_DMA(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) {
+  sim_dma_transfers++;
+  return _Sim_StartReceive(pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Transmit_DMA(I2C_HandleTypeDef* hi2c, uint8_t* pData, uint16_t Size, uint32_t XferOptions) {
+  sim_dma_transfers++;
+  return _Sim_StartTransmit(pData, Size);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  if (GPIOx == I2C_INT_PORT && GPIO_Pin == I2C_INT_PIN) {
+    sim_int_pin = PinState;
+  }
+}
+
+//bitwise reference CRC-8 of the master: polynomial 0x7F, no reversal
+static uint8_t _Master_CRC(uint8_t crc, const uint8_t* buf, uint32_t length) {
+  uint32_t i;
+  int b;
+  for (i = 0; i < length; i++) {
+    crc ^= buf[i];
+    for (b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x7F) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+//size the master expects for the register at the given address - invalid registers are exchanged as single dummy bytes
+static uint16_t _Master_RegSize(uint8_t address) {
+  return sim_reg_sizes[address] == 0 ? 1 : sim_reg_sizes[address];
+}
+
+//master sends a byte: the engine must have a receive set up, completion of which is signalled through the callback
+static void _Master_SendByte(uint8_t byte) {
+  CHECK(sim_rx_buf != NULL && sim_rx_pos < sim_rx_size);
+  if (sim_rx_buf == NULL) return;
+  sim_rx_buf[sim_rx_pos++] = byte;
+  if (sim_rx_pos == sim_rx_size) {
+    sim_rx_buf = NULL;
+    HAL_I2C_SlaveRxCpltCallback(&hi2c1);
+  }
+}
+
+//master receives a byte: the engine must have a transmit set up
+static uint8_t _Master_ReceiveByte() {
+  CHECK(sim_tx_buf != NULL && sim_tx_pos < sim_tx_size);
+  if (sim_tx_buf == NULL) return 0xFF;
+  uint8_t byte = sim_tx_buf[sim_tx_pos++];
+  if (sim_tx_pos == sim_tx_size) {
+    sim_tx_buf = NULL;
+    HAL_I2C_SlaveTxCpltCallback(&hi2c1);
+  }
+  return byte;
+}
+
+static void _Master_Start(uint8_t direction) {
+  HAL_I2C_AddrCallback(&hi2c1, direction, 0);
+}
+
+static void _Master_Stop() {
+  sim_rx_buf = NULL;
+  sim_tx_buf = NULL;
+  HAL_I2C_ListenCpltCallback(&hi2c1);
+}
+
+//write the given registers, starting at the given address - data is the concatenation of the registers' data;
+//corrupt_reg selects the register (index within the transfer) to send with a wrong CRC, -1 for none
+static void _Master_WriteCorrupt(uint8_t address, const uint8_t* data, uint16_t length, int corrupt_reg) {
+  uint8_t header[2] = { SIM_OWN_ADDRESS, address };
+  uint8_t crc = _Master_CRC(0, header, 2);
+  int reg_num = 0;
+
+  _Master_Start(I2C_DIRECTION_TRANSMIT);
+  _Master_SendByte(address);
+
+  while (length > 0) {
+    uint16_t size = _Master_RegSize(address);
+    uint16_t i;
+    CHECK(size <= length);
+    for (i = 0; i < size; i++) {
+      _Master_SendByte(data[i]);
+    }
+    crc = _Master_CRC(crc, data, size);
+    _Master_SendByte(reg_num == corrupt_reg ? (uint8_t)(crc ^ 0x01) : crc);
+
+    //following registers: CRC of the data only
+    crc = 0;
+    data += size;
+    length -= size;
+    address++;
+    reg_num++;
+  }
+
+  _Master_Stop();
+}
+
+static void _Master_Write(uint8_t address, const uint8_t* data, uint16_t length) {
+  _Master_WriteCorrupt(address, data, length, -1);
+}
+
+//read registers starting at the given address into the buffer (concatenated register data), returns whether all CRCs checked out
+static bool _Master_Read(uint8_t address, uint8_t* data, uint16_t length) {
+  uint8_t header[3] = { SIM_OWN_ADDRESS, address, SIM_OWN_ADDRESS | 0x01 };
+  uint8_t crc = _Master_CRC(0, header, 3);
+  bool crc_ok = true;
+
+  _Master_Start(I2C_DIRECTION_TRANSMIT);
+  _Master_SendByte(address);
+  _Master_Start(I2C_DIRECTION_RECEIVE);
+
+  while (length > 0) {
+    uint16_t size = _Master_RegSize(address);
+    uint16_t i;
+    CHECK(size <= length);
+    for (i = 0; i < size; i++) {
+      data[i] = _Master_ReceiveByte();
+    }
+    crc = _Master_CRC(crc, data, size);
+    uint8_t crc_byte = _Master_ReceiveByte();
+    crc = _Master_CRC(crc, &crc_byte, 1);
+    if (crc != 0) {
+      crc_ok = false;
+    }
+
+    crc = 0;
+    data += size;
+    length -= size;
+    address++;
+  }
+
+  //master NACKs the last byte: expected acknowledge failure while the next register is already set up, then stop
+  sim_error_code = HAL_I2C_ERROR_AF;
+  HAL_I2C_ErrorCallback(&hi2c1);
+  sim_error_code = HAL_I2C_ERROR_NONE;
+  _Master_Stop();
+
+  return crc_ok;
+}
+
+static uint8_t _Master_ReadByte(uint8_t address) {
+  uint8_t value = 0;
+  CHECK(_Master_Read(address, &value, 1));
+  return value;
+}
+
+
+/* --------------------------------------- stand-ins for the DAC control --------------------------------------- */
+
+DAC_Status dac_status;
+
+static uint32_t dac_write_calls = 0;
+static HAL_StatusTypeDef dac_write_result = HAL_OK;
+
+#define DAC_STUB_WRITE(...) do { dac_write_calls++; if (dac_write_result == HAL_OK) { __VA_ARGS__; } return dac_write_result; } while (0)
+
+HAL_StatusTypeDef DAC_WriteSysConfig(bool enable) { DAC_STUB_WRITE(dac_status.enabled = enable); }
+HAL_StatusTypeDef DAC_WriteSysModeConfig(bool sync) { DAC_STUB_WRITE(dac_status.sync = sync); }
+HAL_StatusTypeDef DAC_WriteDACClockConfig(uint8_t config) { DAC_STUB_WRITE(dac_status.clk_config = config); }
+HAL_StatusTypeDef DAC_WriteMasterClockConfig(uint8_t div) { DAC_STUB_WRITE(dac_status.master_div = div); }
+HAL_StatusTypeDef DAC_Write4XGains(bool ch1gain, bool ch2gain) { DAC_STUB_WRITE(dac_status.en4xgain_ch1 = ch1gain; dac_status.en4xgain_ch2 = ch2gain); }
+HAL_StatusTypeDef DAC_WriteInputSelection(bool master) { DAC_STUB_WRITE(dac_status.master = master); }
+HAL_StatusTypeDef DAC_WriteTDMSlotNum(uint8_t num) { DAC_STUB_WRITE(dac_status.tdm_slot_num = num); }
+HAL_StatusTypeDef DAC_WriteChannelTDMSlots(uint8_t ch1slot, uint8_t ch2slot) { DAC_STUB_WRITE(dac_status.tdm_slot_ch1 = ch1slot; dac_status.tdm_slot_ch2 = ch2slot); }
+HAL_StatusTypeDef DAC_WriteChannelVolumes(uint8_t ch1vol, uint8_t ch2vol) { DAC_STUB_WRITE(dac_status.volume_ch1 = ch1vol; dac_status.volume_ch2 = ch2vol); }
+HAL_StatusTypeDef DAC_WriteChannelMutes(bool ch1mute, bool ch2mute) { DAC_STUB_WRITE(dac_status.manual_mute_ch1 = ch1mute; dac_status.manual_mute_ch2 = ch2mute); }
+HAL_StatusTypeDef DAC_WriteChannelInverts(bool ch1invert, bool ch2invert) { DAC_STUB_WRITE(dac_status.invert_ch1 = ch1invert; dac_status.invert_ch2 = ch2invert); }
+HAL_StatusTypeDef DAC_WriteFilterShape(uint8_t shape) { DAC_STUB_WRITE(dac_status.filter_shape = shape); }
+HAL_StatusTypeDef DAC_WriteTHDC2(int16_t ch1c2, int16_t ch2c2) { DAC_STUB_WRITE(dac_status.thd_c2_ch1 = ch1c2; dac_status.thd_c2_ch2 = ch2c2); }
+HAL_StatusTypeDef DAC_WriteTHDC3(int16_t ch1c3, int16_t ch2c3) { DAC_STUB_WRITE(dac_status.thd_c3_ch1 = ch1c3; dac_status.thd_c3_ch2 = ch2c3); }
+HAL_StatusTypeDef DAC_WriteChannelAutomuteEnables(bool ch1automute, bool ch2automute) { DAC_STUB_WRITE(dac_status.automute_enabled_ch1 = ch1automute; dac_status.automute_enabled_ch2 = ch2automute); }
+HAL_StatusTypeDef DAC_WriteAutomuteTimeAndRamp(bool mute_gnd_ramp) { DAC_STUB_WRITE(dac_status.mute_gnd_ramp = mute_gnd_ramp); }
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+//reset the engine with the module's register table and clear the reset interrupt flag
+static void _Setup() {
+  memset(&dac_status, 0, sizeof(dac_status));
+  memset(&sim_i2c_regs, 0, sizeof(sim_i2c_regs));
+  sim_i2c_regs.OAR1 = I2C_OAR1_OA1EN | SIM_OWN_ADDRESS;
+  hi2c1.Instance = &sim_i2c_regs;
+  dac_write_result = HAL_OK;
+
+  test_registers = i2c_registers;
+  test_register_count = i2c_register_count;
+  CHECK_EQ(I2C_Init(), HAL_OK);
+
+  uint8_t clear = 0;
+  _Master_Write(I2CDEF_HIFIDAC_INT_FLAGS, &clear, 1);
+  I2C_GetAndResetError();
+}
+
+//the module table passes the check, broken copies of it are rejected
+static void _Test_TableCheck() {
+  I2C_Register table[32];
+  uint8_t count = i2c_register_count;
+  uint8_t i, volume_index = 0, id_index = 0;
+
+  memset(&sim_i2c_regs, 0, sizeof(sim_i2c_regs));
+  sim_i2c_regs.OAR1 = I2C_OAR1_OA1EN | SIM_OWN_ADDRESS;
+  hi2c1.Instance = &sim_i2c_regs;
+
+  test_registers = i2c_registers;
+  test_register_count = i2c_register_count;
+  sim_peripheral_resets = 0;
+  sim_listen_enables = 0;
+  sim_int_pin = GPIO_PIN_SET;
+  CHECK_EQ(I2C_Init(), HAL_OK);
+  CHECK_EQ(sim_peripheral_resets, 1);
+  CHECK_EQ(sim_listen_enables, 1);
+  //reset interrupt is always signalled after init
+  CHECK_EQ(sim_int_pin, GPIO_PIN_RESET);
+
+  CHECK(count <= 31);
+  for (i = 0; i < count; i++) {
+    if (i2c_registers[i].address == I2CDEF_HIFIDAC_VOLUME) volume_index = i;
+    if (i2c_registers[i].address == I2CDEF_HIFIDAC_MODULE_ID) id_index = i;
+  }
+  test_registers = table;
+
+  //overlap: volume register defined twice
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  table[count] = table[volume_index];
+  test_register_count = count + 1;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+
+  //size mismatch with the register definitions
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  table[volume_index].size = 1;
+  test_register_count = count;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+
+  //block running into the next register
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  table[volume_index].count = 2;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+
+  //defined register missing from the table
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  table[id_index] = table[count - 1];
+  test_register_count = count - 1;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+
+  //writable register without write handler, readable register without data source
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  test_register_count = count;
+  table[volume_index].write = NULL;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  table[volume_index].read = NULL;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+
+  //register at address 0, undefined register address
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  table[count] = table[id_index];
+  table[count].address = 0;
+  test_register_count = count + 1;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+  table[count].address = 0x40;
+  CHECK_EQ(I2C_Init(), HAL_ERROR);
+
+  //the intact copy passes
+  memcpy(table, i2c_registers, count * sizeof(I2C_Register));
+  test_register_count = count;
+  CHECK_EQ(I2C_Init(), HAL_OK);
+}
+
+//single register writes reach the handlers and read back with correct CRCs; all registers are below the DMA minimum size, so
+//everything uses byte interrupts
+static void _Test_ReadWrite() {
+  _Setup();
+
+  uint8_t volumes[2] = { 0x30, 0x48 };
+  uint32_t it_before = sim_it_transfers, dma_before = sim_dma_transfers;
+  _Master_Write(I2CDEF_HIFIDAC_VOLUME, volumes, 2);
+  CHECK_EQ(dac_status.volume_ch1, 0x30);
+  CHECK_EQ(dac_status.volume_ch2, 0x48);
+  //address, data of the register, then the (unused) set-up for the next one
+  CHECK_EQ(sim_it_transfers - it_before, 3);
+  CHECK_EQ(sim_dma_transfers - dma_before, 0);
+
+  uint8_t read[4] = { 0 };
+  CHECK(_Master_Read(I2CDEF_HIFIDAC_VOLUME, read, 2));
+  CHECK_EQ(read[0], 0x30);
+  CHECK_EQ(read[1], 0x48);
+
+  //little-endian int16 pairs
+  uint8_t thd[4] = { 0x34, 0x12, 0xFE, 0xFF };
+  _Master_Write(I2CDEF_HIFIDAC_THD_C2, thd, 4);
+  CHECK_EQ(dac_status.thd_c2_ch1, 0x1234);
+  CHECK_EQ(dac_status.thd_c2_ch2, -2);
+  memset(read, 0, sizeof(read));
+  CHECK(_Master_Read(I2CDEF_HIFIDAC_THD_C2, read, 4));
+  CHECK(memcmp(read, thd, 4) == 0);
+
+  //live register: read straight from the DAC status
+  dac_status.clk_config = 0x5A;
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_CLK_CFG), 0x5A);
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_MODULE_ID), I2CDEF_HIFIDAC_MODULE_ID_VALUE);
+
+  //no errors so far
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk, 0);
+}
+
+//chained reads and writes across registers of different sizes, and on into invalid addresses
+static void _Test_AutoIncrement() {
+  _Setup();
+
+  //0x23 clock config, 0x24 master divider, 0x25 TDM slot number, 0x26 channel slots (2 bytes)
+  uint8_t data[5] = { 0x11, 0x04, 0x07, 0x02, 0x03 };
+  _Master_Write(I2CDEF_HIFIDAC_CLK_CFG, data, 5);
+  CHECK_EQ(dac_status.clk_config, 0x11);
+  CHECK_EQ(dac_status.master_div, 0x04);
+  CHECK_EQ(dac_status.tdm_slot_num, 0x07);
+  CHECK_EQ(dac_status.tdm_slot_ch1, 0x02);
+  CHECK_EQ(dac_status.tdm_slot_ch2, 0x03);
+
+  //0x20 volume (2 bytes) through 0x26, then two invalid addresses (dummy zero bytes with valid CRC)
+  dac_status.volume_ch1 = 0x21;
+  dac_status.volume_ch2 = 0x22;
+  dac_status.manual_mute_ch2 = true;
+  dac_status.invert_ch1 = true;
+  uint8_t read[11];
+  memset(read, 0xEE, sizeof(read));
+  CHECK(_Master_Read(I2CDEF_HIFIDAC_VOLUME, read, 11));
+  CHECK_EQ(read[0], 0x21);
+  CHECK_EQ(read[1], 0x22);
+  CHECK_EQ(read[2], I2CDEF_HIFIDAC_MUTE_MUTE_CH2_Msk);
+  CHECK_EQ(read[3], I2CDEF_HIFIDAC_PATH_INVERT_CH1_Msk);
+  CHECK_EQ(read[4], 0x11);
+  CHECK_EQ(read[5], 0x04);
+  CHECK_EQ(read[6], 0x07);
+  CHECK_EQ(read[7], 0x02);
+  CHECK_EQ(read[8], 0x03);
+  CHECK_EQ(read[9], 0x00);
+  CHECK_EQ(read[10], 0x00);
+
+  //reading past the end of the valid range is not an error by itself (only the addressed register counts)
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk, 0);
+}
+
+//wrong CRCs: the register is dropped and the error reported, following registers in the same transfer still apply
+static void _Test_CRCErrors() {
+  _Setup();
+
+  uint32_t calls_before = dac_write_calls;
+  uint8_t volumes[2] = { 0x10, 0x20 };
+  _Master_WriteCorrupt(I2CDEF_HIFIDAC_VOLUME, volumes, 2, 0);
+  CHECK_EQ(dac_write_calls, calls_before);
+  CHECK_EQ(dac_status.volume_ch1, 0);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+  //error is reset by the status read
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk, 0);
+
+  //second register corrupted: first and third apply
+  uint8_t data[3] = { 0x12, 0x05, 0x09 };
+  _Master_WriteCorrupt(I2CDEF_HIFIDAC_CLK_CFG, data, 3, 1);
+  CHECK_EQ(dac_status.clk_config, 0x12);
+  CHECK_EQ(dac_status.master_div, 0);
+  CHECK_EQ(dac_status.tdm_slot_num, 0x09);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+
+  //the address is part of the first CRC: the same data sent to another address does not check out
+  uint8_t header[2] = { SIM_OWN_ADDRESS, I2CDEF_HIFIDAC_MASTER_DIV };
+  uint8_t value = 0x06;
+  uint8_t crc = _Master_CRC(_Master_CRC(0, header, 2), &value, 1);
+  _Master_Start(I2C_DIRECTION_TRANSMIT);
+  _Master_SendByte(I2CDEF_HIFIDAC_TDM_SLOT_NUM);
+  _Master_SendByte(value);
+  _Master_SendByte(crc);
+  _Master_Stop();
+  CHECK_EQ(dac_status.tdm_slot_num, 0x09);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+}
+
+//invalid addresses, read-only registers, out-of-range values and failing DAC writes are all reported
+static void _Test_InvalidAccess() {
+  _Setup();
+
+  //invalid address: dummy data accepted, error reported
+  uint8_t dummy[2] = { 0x55, 0x66 };
+  _Master_Write(0x05, dummy, 2);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+
+  //reads return zero dummy bytes (the engine continues as the invalid register 0, so the CRC carries no meaning)
+  uint8_t read[2] = { 0xEE, 0xEE };
+  _Master_Read(0x05, read, 2);
+  CHECK_EQ(read[0], 0);
+  CHECK_EQ(read[1], 0);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+
+  //read-only register
+  uint8_t id = 0x12;
+  _Master_Write(I2CDEF_HIFIDAC_MODULE_ID, &id, 1);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_MODULE_ID), I2CDEF_HIFIDAC_MODULE_ID_VALUE);
+
+  //value out of range for the handler
+  uint8_t shape = 8;
+  _Master_Write(I2CDEF_HIFIDAC_FILTER_SHAPE, &shape, 1);
+  CHECK_EQ(dac_status.filter_shape, 0);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+
+  //DAC write failure
+  dac_write_result = HAL_ERROR;
+  shape = 3;
+  _Master_Write(I2CDEF_HIFIDAC_FILTER_SHAPE, &shape, 1);
+  dac_write_result = HAL_OK;
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+
+  //wrong reset code
+  uint8_t control = (0x3 << I2CDEF_HIFIDAC_CONTROL_RESET_Pos);
+  _Master_Write(I2CDEF_HIFIDAC_CONTROL, &control, 1);
+  CHECK(_Master_ReadByte(I2CDEF_HIFIDAC_STATUS) & I2CDEF_HIFIDAC_STATUS_I2CERR_Msk);
+}
+
+//interrupt flags, mask and enable drive the interrupt pin; the reset flag is signalled regardless of mask and enable
+static void _Test_Interrupts() {
+  _Setup();
+
+  //after clearing the reset flag the pin is released
+  CHECK_EQ(sim_int_pin, GPIO_PIN_SET);
+
+  I2C_TriggerInterrupt(I2CDEF_HIFIDAC_INT_FLAGS_INT_LOCK_Msk);
+  CHECK_EQ(sim_int_pin, GPIO_PIN_SET);
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_INT_FLAGS), I2CDEF_HIFIDAC_INT_FLAGS_INT_LOCK_Msk);
+
+  //masked in, but interrupts disabled
+  uint8_t mask = I2CDEF_HIFIDAC_INT_MASK_INT_LOCK_Msk | I2CDEF_HIFIDAC_INT_MASK_INT_RAMP_Msk;
+  _Master_Write(I2CDEF_HIFIDAC_INT_MASK, &mask, 1);
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_INT_MASK), mask);
+  CHECK_EQ(sim_int_pin, GPIO_PIN_SET);
+
+  //enable through the control register
+  uint8_t control = I2CDEF_HIFIDAC_CONTROL_INT_EN_Msk | I2CDEF_HIFIDAC_CONTROL_DAC_EN_Msk;
+  _Master_Write(I2CDEF_HIFIDAC_CONTROL, &control, 1);
+  CHECK(dac_status.enabled);
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_CONTROL), control);
+  CHECK_EQ(sim_int_pin, GPIO_PIN_RESET);
+
+  //clearing: bits written as 0 are cleared, bits written as 1 are kept
+  I2C_TriggerInterrupt(I2CDEF_HIFIDAC_INT_FLAGS_INT_MONITOR_Msk);
+  uint8_t flags = (uint8_t)~I2CDEF_HIFIDAC_INT_FLAGS_INT_LOCK_Msk;
+  _Master_Write(I2CDEF_HIFIDAC_INT_FLAGS, &flags, 1);
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_INT_FLAGS), I2CDEF_HIFIDAC_INT_FLAGS_INT_MONITOR_Msk);
+  //monitor flag is not in the mask
+  CHECK_EQ(sim_int_pin, GPIO_PIN_SET);
+
+  I2C_TriggerInterrupt(I2CDEF_HIFIDAC_INT_FLAGS_INT_RAMP_Msk);
+  CHECK_EQ(sim_int_pin, GPIO_PIN_RESET);
+  I2C_SetInterruptsEnabled(false);
+  CHECK_EQ(sim_int_pin, GPIO_PIN_SET);
+
+  //reset flag ignores mask and enable
+  I2C_TriggerInterrupt(I2CDEF_HIFIDAC_INT_FLAGS_INT_RESET_Msk);
+  CHECK_EQ(sim_int_pin, GPIO_PIN_RESET);
+}
+
+//stuck transfers and a busy peripheral are recovered by the main loop, bus errors and protocol violations reset immediately
+static void _Test_Recovery() {
+  int i;
+  _Setup();
+
+  //master stops responding after the address byte
+  uint32_t resets_before = sim_peripheral_resets;
+  _Master_Start(I2C_DIRECTION_TRANSMIT);
+  _Master_SendByte(I2CDEF_HIFIDAC_VOLUME);
+  for (i = 0; i < I2C_NONIDLE_TIMEOUT - 1; i++) {
+    I2C_LoopUpdate();
+  }
+  CHECK_EQ(sim_peripheral_resets, resets_before);
+  I2C_LoopUpdate();
+  CHECK_EQ(sim_peripheral_resets, resets_before + 1);
+  CHECK(I2C_GetAndResetError());
+
+  //engine is idle again and accepts new transfers
+  uint8_t volumes[2] = { 0x44, 0x45 };
+  _Master_Write(I2CDEF_HIFIDAC_VOLUME, volumes, 2);
+  CHECK_EQ(dac_status.volume_ch2, 0x45);
+  for (i = 0; i < 2 * I2C_NONIDLE_TIMEOUT; i++) {
+    I2C_LoopUpdate();
+  }
+  CHECK_EQ(sim_peripheral_resets, resets_before + 1);
+
+  //peripheral busy while the engine is idle
+  sim_i2c_regs.ISR |= I2C_ISR_BUSY;
+  for (i = 0; i < I2C_PERIPHERAL_BUSY_TIMEOUT; i++) {
+    I2C_LoopUpdate();
+  }
+  CHECK_EQ(sim_peripheral_resets, resets_before + 1);
+  I2C_LoopUpdate();
+  CHECK_EQ(sim_peripheral_resets, resets_before + 2);
+  sim_i2c_regs.ISR &= ~I2C_ISR_BUSY;
+  CHECK(I2C_GetAndResetError());
+
+  //read without a preceding register address
+  _Master_Start(I2C_DIRECTION_RECEIVE);
+  CHECK_EQ(sim_peripheral_resets, resets_before + 3);
+  _Master_Stop();
+  CHECK(I2C_GetAndResetError());
+
+  //bus error during a transfer
+  _Master_Start(I2C_DIRECTION_TRANSMIT);
+  sim_error_code = HAL_I2C_ERROR_BERR;
+  HAL_I2C_ErrorCallback(&hi2c1);
+  sim_error_code = HAL_I2C_ERROR_NONE;
+  CHECK_EQ(sim_peripheral_resets, resets_before + 4);
+  CHECK(I2C_GetAndResetError());
+
+  //normal operation afterwards
+  CHECK_EQ(_Master_ReadByte(I2CDEF_HIFIDAC_MODULE_ID), I2CDEF_HIFIDAC_MODULE_ID_VALUE);
+  CHECK(!I2C_GetAndResetError());
+}
+
+
+int main() {
+  _Test_TableCheck();
+  _Test_ReadWrite();
+  _Test_AutoIncrement();
+  _Test_CRCErrors();
+  _Test_InvalidAccess();
+  _Test_Interrupts();
+  _Test_Recovery();
+
+  return HOST_TestSummary("test_i2c_slave");
+}
@@ -0,0 +1,262 @@
+/*
+ * test_adc_kernel.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the fused ADC metering kernel (adc.c) against the original multi-pass CMSIS-DSP processing
+ *  (channel extraction by matrix-vector multiply, power multiply, sums of squares, mean, absmax): sums of squares and
+ *  peaks must match exactly, average power within the rounding of the reference's per-sample products. Also checks the
+ *  published metering values of the DMA callbacks for known signals, and benchmarks both paths.
+ *  Built for the 2-channel configuration, and for the 4-channel configuration with TEST_FOUR_CHANNEL.
+ */
+
+#include "host_test.h"
+#include "main.h"
+
+#ifdef TEST_FOUR_CHANNEL
+#define MAIN_FOUR_CHANNEL
+#endif
+
+//the ADC module itself, with access to its kernel and DMA buffers
+#include "adc.c"
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+ADC_HandleTypeDef hadc1, hadc2, hadc3, hadc4;
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef* hadc, uint32_t SingleDiff) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_AnalogWDGConfig(ADC_HandleTypeDef* hadc, ADC_AnalogWDGConfTypeDef* AnalogWDGConfig) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef* hadc) { return HAL_OK; }
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef* hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStart_DMA(ADC_HandleTypeDef* hadc, uint32_t* pData, uint32_t Length) { return HAL_OK; }
+
+static uint32_t safety_checks = 0;
+void SAFETY_CheckADCInstValues() { safety_checks++; }
+void SAFETY_TriggerPeakCurrentShutdown(uint8_t channel) {}
+
+static float speaker_powers[4] = { 0 };
+void SPKM_ProcessBatch(uint8_t channel, float power) { speaker_powers[channel] = power; }
+
+
+/* --------------------------------------- reference and signals --------------------------------------- */
+
+//number of channels processed per ADC pair
+#ifdef MAIN_FOUR_CHANNEL
+#define TEST_PAIR_CHANNELS 2
+#else
+#define TEST_PAIR_CHANNELS 1
+#endif
+
+typedef struct {
+  q63_t sos_current[2];
+  q63_t sos_voltage[2];
+  q15_t avg_power[2];
+  q15_t peak_current[2];
+  q15_t peak_voltage[2];
+} _RefSums;
+
+//the original multi-pass processing of one batch (interleaved channel pairs) with the CMSIS-DSP functions
+static void _ReferenceBatch(const q15_t* src_current, const q15_t* src_voltage, _RefSums* ref) {
+  static q15_t raw_current[P_ADC_SAMPLE_BATCH_SIZE];
+  static q15_t raw_voltage[P_ADC_SAMPLE_BATCH_SIZE];
+  static q15_t raw_power[P_ADC_SAMPLE_BATCH_SIZE];
+  arm_matrix_instance_q15 current_matrix = { P_ADC_SAMPLE_BATCH_SIZE, 2, (q15_t*)src_current };
+  arm_matrix_instance_q15 voltage_matrix = { P_ADC_SAMPLE_BATCH_SIZE, 2, (q15_t*)src_voltage };
+#ifdef MAIN_FOUR_CHANNEL
+  static const q15_t vectors_current[2][2] = { P_ADC_PROCESSING_VECTOR_AC, P_ADC_PROCESSING_VECTOR_BD };
+  static const q15_t vectors_voltage[2][2] = { P_ADC_PROCESSING_VECTOR_AC, P_ADC_PROCESSING_VECTOR_BD };
+#else
+  static const q15_t vectors_current[1][2] = { P_ADC_CURRENT_PROCESSING_VECTOR };
+  static const q15_t vectors_voltage[1][2] = { P_ADC_VOLTAGE_PROCESSING_VECTOR };
+#endif
+  uint32_t peak_index;
+  int ch;
+
+  for (ch = 0; ch < TEST_PAIR_CHANNELS; ch++) {
+    arm_mat_vec_mult_q15(&current_matrix, vectors_current[ch], raw_current);
+    arm_mat_vec_mult_q15(&voltage_matrix, vectors_voltage[ch], raw_voltage);
+    arm_mult_q15(raw_voltage, raw_current, raw_power, P_ADC_SAMPLE_BATCH_SIZE);
+    arm_power_q15(raw_current, P_ADC_SAMPLE_BATCH_SIZE, ref->sos_current + ch);
+    arm_power_q15(raw_voltage, P_ADC_SAMPLE_BATCH_SIZE, ref->sos_voltage + ch);
+    arm_mean_q15(raw_power, P_ADC_SAMPLE_BATCH_SIZE, ref->avg_power + ch);
+    arm_absmax_q15(raw_current, P_ADC_SAMPLE_BATCH_SIZE, ref->peak_current + ch, &peak_index);
+    arm_absmax_q15(raw_voltage, P_ADC_SAMPLE_BATCH_SIZE, ref->peak_voltage + ch, &peak_index);
+  }
+}
+
+//DMA sample of the given ADC code: 12-bit left-aligned with offset 2048, as configured in main.c
+static inline q15_t _AdcSample(int32_t code) {
+  if (code < 0) code = 0;
+  if (code > 4095) code = 4095;
+  return (q15_t)((code - 2048) << 4);
+}
+
+typedef enum {
+  SIGNAL_RANDOM,      //uniformly random codes on all channels
+  SIGNAL_SINE,        //sines with phase shift between current and voltage, different per channel
+  SIGNAL_FULL_SCALE,  //alternating full-scale extremes
+  SIGNAL_ZERO         //all channels at zero
+} _Signal;
+
+//fill one buffer half with the given signal
+static void _FillBatch(q15_t* current, q15_t* voltage, _Signal signal) {
+  int i, c;
+  for (i = 0; i < P_ADC_SAMPLE_BATCH_SIZE; i++) {
+    for (c = 0; c < 2; c++) {
+      int32_t code_i, code_v;
+      switch (signal) {
+        case SIGNAL_RANDOM:
+          code_i = rand() % 4096;
+          code_v = rand() % 4096;
+          break;
+        case SIGNAL_SINE: {
+          double phase = 2.0 * M_PI * (double)i * (c == 0 ? 7.0 : 13.0) / P_ADC_SAMPLE_BATCH_SIZE;
+          code_i = 2048 + (int32_t)lround((c == 0 ? 1500.0 : 600.0) * sin(phase - 0.4));
+          code_v = 2048 + (int32_t)lround((c == 0 ? 1800.0 : -900.0) * sin(phase));
+          break;
+        }
+        case SIGNAL_FULL_SCALE:
+          code_i = ((i + c) & 1) ? 4095 : 0;
+          code_v = ((i / 2 + c) & 1) ? 0 : 4095;
+          break;
+        default:
+          code_i = code_v = 2048;
+          break;
+      }
+      current[2 * i + c] = _AdcSample(code_i);
+      voltage[2 * i + c] = _AdcSample(code_v);
+    }
+  }
+}
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+//kernel sums against the multi-pass reference, for all signals and both buffer halves of both ADC pairs
+static void _Test_KernelVsReference() {
+  _Signal signal;
+  int round, half, ch;
+
+  for (signal = SIGNAL_RANDOM; signal <= SIGNAL_ZERO; signal++) {
+    for (round = 0; round < (signal == SIGNAL_RANDOM ? 20 : 1); round++) {
+      for (half = 0; half < 2; half++) {
+        q15_t* current = (round & 1 ? dma_current_CD : dma_current_AB) + half * (P_ADC_DMA_BUFFER_SIZE / 2);
+        q15_t* voltage = (round & 1 ? dma_voltage_CD : dma_voltage_AB) + half * (P_ADC_DMA_BUFFER_SIZE / 2);
+        _FillBatch(current, voltage, signal);
+
+        _ADC_BatchSums sums;
+        _RefSums ref;
+        _ADC_ProcessBatch(current, voltage, &sums);
+        _ReferenceBatch(current, voltage, &ref);
+
+        for (ch = 0; ch < TEST_PAIR_CHANNELS; ch++) {
+          CHECK_EQ(sums.sos_current[ch], ref.sos_current[ch]);
+          CHECK_EQ(sums.sos_voltage[ch], ref.sos_voltage[ch]);
+          CHECK_EQ(sums.peak_current[ch], ref.peak_current[ch]);
+          CHECK_EQ(sums.peak_voltage[ch], ref.peak_voltage[ch]);
+          CHECK_NEAR((float)sums.sum_power[ch] / P_ADC_SOS_AVG_DIVISOR, (float)ref.avg_power[ch] / 32768.0f, P_ADC_KERNEL_CHECK_POWER_TOLERANCE);
+        }
+      }
+    }
+  }
+}
+
+//published values of the DMA callbacks: match the original float conversion of the reference sums, and known signal levels
+static void _Test_PublishedValues() {
+  int ch;
+
+  _FillBatch(dma_current_AB, dma_voltage_AB, SIGNAL_SINE);
+  _FillBatch(dma_current_CD + (P_ADC_DMA_BUFFER_SIZE / 2), dma_voltage_CD + (P_ADC_DMA_BUFFER_SIZE / 2), SIGNAL_SINE);
+
+  uint32_t checks_before = safety_checks;
+  HAL_ADC_ConvHalfCpltCallback(&hadc1);
+  HAL_ADC_ConvCpltCallback(&hadc3);
+  CHECK_EQ(safety_checks, checks_before + 2);
+
+  _RefSums ref;
+  _ReferenceBatch(dma_current_AB, dma_voltage_AB, &ref);
+
+  for (ch = 0; ch < TEST_PAIR_CHANNELS; ch++) {
+    float f_current = (float)ref.sos_current[ch] / P_ADC_SOS_AVG_DIVISOR;
+    float f_voltage = (float)ref.sos_voltage[ch] / P_ADC_SOS_AVG_DIVISOR;
+    float f_power = (float)ref.avg_power[ch] / 32768.0f;
+#ifdef MAIN_FOUR_CHANNEL
+    float conv_i = ch == 0 ? P_ADC_FACTOR_IA : P_ADC_FACTOR_IB;
+    float conv_v = ch == 0 ? P_ADC_FACTOR_VA : P_ADC_FACTOR_VB;
+    float conv_p = ch == 0 ? P_ADC_FACTOR_PA : P_ADC_FACTOR_PB;
+    CHECK_NEAR(rms_current_inst[ch], sqrtf(f_current) * conv_i, 1e-4f * conv_i);
+    CHECK_NEAR(rms_voltage_inst[ch], sqrtf(f_voltage) * conv_v, 1e-4f * conv_v);
+    //known levels: sine amplitude in codes / 4096 * 2 * conversion factor (scaled by 0.5 in the kernel) / sqrt(2)
+    double amplitude_i = (ch == 0 ? 1500.0 : 600.0) / 4096.0;
+    double amplitude_v = (ch == 0 ? 1800.0 : 900.0) / 4096.0;
+    CHECK_NEAR(rms_current_inst[ch], amplitude_i / M_SQRT2 * conv_i, 2e-3 * conv_i);
+    CHECK_NEAR(rms_voltage_inst[ch], amplitude_v / M_SQRT2 * conv_v, 2e-3 * conv_v);
+    //real power of sines with phase shift: V_rms * I_rms * cos(phi) - channel B has inverted voltage
+    double expected_power = amplitude_i * amplitude_v / 2.0 * cos(0.4) * conv_p;
+    CHECK_NEAR(avg_real_power_inst[ch], expected_power, 3e-3 * conv_p);
+    CHECK_NEAR(speaker_powers[ch], avg_real_power_inst[ch], 1e-6f * conv_p);
+    CHECK(avg_apparent_power_inst[ch] >= avg_real_power_inst[ch]);
+#else
+    CHECK_NEAR(rms_current_inst[0], sqrtf(f_current) * 2.0f, 1e-4f);
+    CHECK_NEAR(rms_voltage_inst[0], sqrtf(f_voltage) * 2.0f, 1e-4f);
+    CHECK_NEAR(avg_real_power_inst[0], fabsf(f_power) * 4.0f, 4.0f * P_ADC_KERNEL_CHECK_POWER_TOLERANCE);
+    CHECK_EQ(rms_current_inst[1], rms_current_inst[0]);
+    CHECK_NEAR(speaker_powers[0], fabsf(f_power) * P_ADC_FACTOR_PA, P_ADC_FACTOR_PA * P_ADC_KERNEL_CHECK_POWER_TOLERANCE);
+    CHECK_EQ(speaker_powers[1], speaker_powers[0]);
+#endif
+    CHECK_NEAR(peak_current_inst[ch], (float)ref.peak_current[ch] / 32768.0f * P_ADC_FACTOR_IA, 1e-6f * P_ADC_FACTOR_IA);
+    CHECK_NEAR(peak_voltage_inst[ch], (float)ref.peak_voltage[ch] / 32768.0f * P_ADC_FACTOR_VA, 1e-6f * P_ADC_FACTOR_VA);
+  }
+
+  //second pair (C/D) got the same signal in the other buffer half
+  CHECK_NEAR(rms_voltage_inst[2], rms_voltage_inst[0], 1e-4f * P_ADC_FACTOR_VA);
+  CHECK_NEAR(avg_real_power_inst[2], avg_real_power_inst[0], 1e-4f * P_ADC_FACTOR_PA);
+
+  //EMAs (in volts in both configurations) move towards the batch value, the faster one further
+  float batch_rms_voltage = sqrtf((float)ref.sos_voltage[0] / P_ADC_SOS_AVG_DIVISOR) * P_ADC_FACTOR_VA;
+  CHECK(rms_voltage_0s1[0] > 0.0f && rms_voltage_0s1[0] < batch_rms_voltage);
+  CHECK(rms_voltage_1s0[0] > 0.0f && rms_voltage_1s0[0] < rms_voltage_0s1[0]);
+}
+
+static void _Benchmark() {
+  const int rounds = 2000;
+  int r;
+  _ADC_BatchSums sums;
+  _RefSums ref;
+
+  _FillBatch(dma_current_AB, dma_voltage_AB, SIGNAL_RANDOM);
+
+  uint64_t start = HOST_GetTimeNs();
+  for (r = 0; r < rounds; r++) {
+    _ADC_ProcessBatch(dma_current_AB, dma_voltage_AB, &sums);
+    __asm__ volatile("" : : "g"(&sums) : "memory");
+  }
+  uint64_t fused = HOST_GetTimeNs() - start;
+
+  start = HOST_GetTimeNs();
+  for (r = 0; r < rounds; r++) {
+    _ReferenceBatch(dma_current_AB, dma_voltage_AB, &ref);
+    __asm__ volatile("" : : "g"(&ref) : "memory");
+  }
+  uint64_t multi = HOST_GetTimeNs() - start;
+
+  printf("ADC batch (%u samples, %u channel(s)): fused %.0f ns, multi-pass %.0f ns\n", P_ADC_SAMPLE_BATCH_SIZE, TEST_PAIR_CHANNELS,
+         (double)fused / rounds, (double)multi / rounds);
+}
+
+
+int main() {
+  srand(31);
+
+  _Test_KernelVsReference();
+  _Test_PublishedValues();
+  _Benchmark();
+
+#ifdef MAIN_FOUR_CHANNEL
+  return HOST_TestSummary("test_adc_kernel (4 channel)");
+#else
+  return HOST_TestSummary("test_adc_kernel (2 channel)");
+#endif
+}
@@ -0,0 +1,312 @@
+/*
+ * test_overcurrent.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the fast overcurrent path: the ADC analog watchdogs (adc.c) trigger the peak current shutdown (safety.c) on a
+ *  single out-of-window current sample. Checks the watchdog threshold conversion against the current scaling of the metering
+ *  kernel, the immediate shutdown from the watchdog interrupt with the status reporting deferred to the main loop (merge of the
+ *  interrupt's error sources in SAFETY_LoopUpdate), disarming until the manual shutdown reset re-arms the watchdogs, and the
+ *  interrupt priorities of the ADC MSP init: the watchdog interrupts must preempt the I2C interrupts.
+ *  Built for the 2-channel configuration, and for the 4-channel configuration (second watchdog per ADC) with TEST_FOUR_CHANNEL.
+ */
+
+#include "host_test.h"
+#include "main.h"
+
+#ifdef TEST_FOUR_CHANNEL
+#define MAIN_FOUR_CHANNEL
+#endif
+
+//the ADC and safety modules themselves, with access to the watchdog configuration, the kernel and the pending error sources
+#include "adc.c"
+#include "safety.c"
+
+//the ADC MSP init for the interrupt priorities, with the clock control in host memory (only its own header guard is left to pass)
+#undef RCC
+static RCC_TypeDef sim_rcc;
+#define RCC (&sim_rcc)
+#include "stm32f3xx_hal_msp.c"
+
+
+/* --------------------------------------- stand-ins for the rest of the firmware --------------------------------------- */
+
+ADC_HandleTypeDef hadc1, hadc2, hadc3, hadc4;
+DMA_HandleTypeDef hdma_adc1, hdma_adc2, hdma_adc3, hdma_adc4, hdma_i2c3_tx, hdma_i2c3_rx;
+uint8_t pvdd_valid_voltage = 1;
+
+//ADC register blocks (interrupt enables and flags of the watchdog ADCs, DMA enables)
+static ADC_TypeDef sim_adc1, sim_adc2, sim_adc3, sim_adc4;
+
+//configured analog watchdogs
+typedef struct {
+  ADC_HandleTypeDef* hadc;
+  ADC_AnalogWDGConfTypeDef config;
+} SimWatchdog;
+static SimWatchdog sim_watchdogs[4];
+static uint32_t sim_watchdog_count = 0;
+
+HAL_StatusTypeDef HAL_ADC_AnalogWDGConfig(ADC_HandleTypeDef* hadc, ADC_AnalogWDGConfTypeDef* AnalogWDGConfig) {
+  CHECK(sim_watchdog_count < 4);
+  sim_watchdogs[sim_watchdog_count].hadc = hadc;
+  sim_watchdogs[sim_watchdog_count].config = *AnalogWDGConfig;
+  sim_watchdog_count++;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef* hadc, uint32_t SingleDiff) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef* hadc) { return HAL_OK; }
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef* hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStart_DMA(ADC_HandleTypeDef* hadc, uint32_t* pData, uint32_t Length) { return HAL_OK; }
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma) { return HAL_OK; }
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef* hdma) { return HAL_OK; }
+void HAL_GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_Init) {}
+void HAL_GPIO_DeInit(GPIO_TypeDef* GPIOx, uint32_t GPIO_Pin) {}
+void RefreshWatchdogsExt() {}
+void Error_Handler(void) { CHECK_MSG(false, "Error_Handler called"); }
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {
+  NVIC_SetPriority(IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PreemptPriority, SubPriority));
+}
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) { NVIC_EnableIRQ(IRQn); }
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn) { NVIC_DisableIRQ(IRQn); }
+
+void SPKM_ProcessBatch(uint8_t channel, float power) {}
+
+//amp reset pin (low = amp shut down)
+static GPIO_PinState sim_amp_reset_pin = GPIO_PIN_RESET;
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  if (GPIOx == AMP_RESET_N_GPIO_Port && GPIO_Pin == AMP_RESET_N_Pin) {
+    sim_amp_reset_pin = PinState;
+  }
+}
+
+static uint32_t sim_serr_interrupts = 0;
+void I2C_TriggerInterrupt(uint8_t interrupt_bit) {
+  if (interrupt_bit == I2CDEF_POWERAMP_INT_FLAGS_INT_SERR_Msk) {
+    sim_serr_interrupts++;
+  }
+}
+
+
+/* --------------------------------------- watchdog simulation --------------------------------------- */
+
+//current channels with a watchdog: ADC, channel, watchdog number, conversion factor, error source bit
+typedef struct {
+  ADC_HandleTypeDef* hadc;
+  uint32_t channel;
+  uint32_t watchdog;
+  float conv_fact_i;
+  uint16_t err_bit;
+} TestCurrentChannel;
+
+static const TestCurrentChannel test_channels[] = {
+  { &hadc1, P_ADC_CURRENT_CHANNEL_A, ADC_ANALOGWATCHDOG_1, P_ADC_FACTOR_IA, I2CDEF_POWERAMP_SERR_SOURCE_CHAN_A },
+  { &hadc3, P_ADC_CURRENT_CHANNEL_C, ADC_ANALOGWATCHDOG_1, P_ADC_FACTOR_IC, I2CDEF_POWERAMP_SERR_SOURCE_CHAN_C },
+#ifdef MAIN_FOUR_CHANNEL
+  { &hadc1, P_ADC_CURRENT_CHANNEL_B, ADC_ANALOGWATCHDOG_2, P_ADC_FACTOR_IB, I2CDEF_POWERAMP_SERR_SOURCE_CHAN_B },
+  { &hadc3, P_ADC_CURRENT_CHANNEL_D, ADC_ANALOGWATCHDOG_2, P_ADC_FACTOR_ID, I2CDEF_POWERAMP_SERR_SOURCE_CHAN_D },
+#endif
+};
+#define TEST_CHANNEL_COUNT (sizeof(test_channels) / sizeof(test_channels[0]))
+
+static const SimWatchdog* _FindWatchdog(const TestCurrentChannel* channel) {
+  uint32_t i;
+  for (i = 0; i < sim_watchdog_count; i++) {
+    if (sim_watchdogs[i].hadc == channel->hadc && sim_watchdogs[i].config.WatchdogNumber == channel->watchdog &&
+        sim_watchdogs[i].config.Channel == channel->channel) {
+      return sim_watchdogs + i;
+    }
+  }
+  return NULL;
+}
+
+//one conversion of the given current channel: like the hardware, an out-of-window code sets the watchdog flag, and raises the
+//watchdog interrupt if it's enabled - returns whether the interrupt was raised
+static bool _Sim_Convert(const TestCurrentChannel* channel, uint32_t code) {
+  const SimWatchdog* watchdog = _FindWatchdog(channel);
+  if (watchdog == NULL || (code <= watchdog->config.HighThreshold && code >= watchdog->config.LowThreshold)) {
+    return false;
+  }
+
+  bool awd2 = (channel->watchdog == ADC_ANALOGWATCHDOG_2);
+  channel->hadc->Instance->ISR |= awd2 ? ADC_FLAG_AWD2 : ADC_FLAG_AWD1;
+  if ((channel->hadc->Instance->IER & (awd2 ? ADC_IT_AWD2 : ADC_IT_AWD1)) == 0) {
+    return false;
+  }
+
+#ifdef MAIN_FOUR_CHANNEL
+  if (awd2) {
+    HAL_ADCEx_LevelOutOfWindow2Callback(channel->hadc);
+    return true;
+  }
+#endif
+  HAL_ADC_LevelOutOfWindowCallback(channel->hadc);
+  return true;
+}
+
+//current magnitude of the given code, as published by the metering kernel (absolute peak of a batch at that code on the channel)
+static float _KernelCurrent(const TestCurrentChannel* channel, uint32_t code) {
+  static q15_t current[P_ADC_DMA_BUFFER_SIZE / 2];
+  static q15_t voltage[P_ADC_DMA_BUFFER_SIZE / 2];
+  _ADC_BatchSums sums;
+  int i;
+
+  //DMA sample: 12-bit left-aligned with offset 2048; channel B/D is the second of each pair
+  uint32_t index = (channel->watchdog == ADC_ANALOGWATCHDOG_2) ? 1 : 0;
+  for (i = 0; i < P_ADC_SAMPLE_BATCH_SIZE; i++) {
+    current[2 * i + index] = (q15_t)(((int32_t)code - 2048) << 4);
+    current[2 * i + (1 - index)] = 0;
+    voltage[2 * i] = voltage[2 * i + 1] = 0;
+  }
+  _ADC_ProcessBatch(current, voltage, &sums);
+  return (float)sums.peak_current[index] / 32768.0f * channel->conv_fact_i;
+}
+
+//amp running, no errors, watchdogs armed
+static void _Setup() {
+  SAFETY_SetManualShutdown(1);
+  SAFETY_LoopUpdate();
+  SAFETY_SetManualShutdown(0);
+  SAFETY_LoopUpdate();
+  sim_serr_interrupts = 0;
+  CHECK_EQ(is_shutdown, 0);
+  CHECK_EQ(sim_amp_reset_pin, GPIO_PIN_SET);
+}
+
+
+/* --------------------------------------- tests --------------------------------------- */
+
+//watchdog windows: +-SAFETY_LIMIT_MAX_CURRENT_PEAK around the zero code, in the kernel's current scaling
+static void _Test_Thresholds() {
+  uint32_t i;
+
+  CHECK_EQ(ADC_StartMonitoring(), HAL_OK);
+  CHECK_EQ(sim_watchdog_count, TEST_CHANNEL_COUNT);
+
+  for (i = 0; i < TEST_CHANNEL_COUNT; i++) {
+    const TestCurrentChannel* channel = test_channels + i;
+    const SimWatchdog* watchdog = _FindWatchdog(channel);
+    CHECK(watchdog != NULL);
+    if (watchdog == NULL) {
+      continue;
+    }
+    uint32_t high = watchdog->config.HighThreshold, low = watchdog->config.LowThreshold;
+
+    CHECK_EQ(watchdog->config.WatchdogMode, ADC_ANALOGWATCHDOG_SINGLE_REG);
+    CHECK_EQ(watchdog->config.ITMode, ENABLE);
+    //symmetric around the zero code, within the 12-bit range
+    CHECK_EQ(high - P_ADC_CURRENT_ZERO_CODE, P_ADC_CURRENT_ZERO_CODE - low);
+    CHECK(high <= 4095 && low > 0);
+
+    //the last code inside the window is at most the peak limit, the first one outside is above it (within one code)
+    float code_step = channel->conv_fact_i / 4096.0f;
+    float inside = _KernelCurrent(channel, high), outside = _KernelCurrent(channel, high + 1);
+    CHECK_MSG(inside <= SAFETY_LIMIT_MAX_CURRENT_PEAK && inside > SAFETY_LIMIT_MAX_CURRENT_PEAK - code_step,
+              "channel %u high threshold %u: %.3f A", i, high, inside);
+    CHECK_MSG(outside > SAFETY_LIMIT_MAX_CURRENT_PEAK, "channel %u above high threshold: %.3f A", i, outside);
+    CHECK_NEAR(_KernelCurrent(channel, low), inside, 1e-4f);
+    printf("channel %u: watchdog window %u..%u, %.3f A\n", i, low, high, inside);
+
+    //above the instantaneous RMS limit, so the watchdogs don't preempt the regular batch checks
+    CHECK(inside > safety_limit_current_inst[0]);
+  }
+}
+
+//an out-of-window sample shuts the amp down right in the interrupt, the main loop reports it
+static void _Test_Shutdown() {
+  uint32_t i;
+
+  for (i = 0; i < TEST_CHANNEL_COUNT; i++) {
+    const TestCurrentChannel* channel = test_channels + i;
+    const SimWatchdog* watchdog = _FindWatchdog(channel);
+    if (watchdog == NULL) {
+      continue;
+    }
+    _Setup();
+
+    //in-window extremes: nothing happens
+    CHECK(!_Sim_Convert(channel, watchdog->config.HighThreshold));
+    CHECK(!_Sim_Convert(channel, watchdog->config.LowThreshold));
+    CHECK_EQ(is_shutdown, 0);
+
+    //one sample above (or below) the window: shutdown from the interrupt, status not touched there
+    CHECK(_Sim_Convert(channel, (i & 1) ? watchdog->config.LowThreshold - 1 : watchdog->config.HighThreshold + 1));
+    CHECK_EQ(is_shutdown, 1);
+    CHECK_EQ(safety_shutdown, 1);
+    CHECK_EQ(sim_amp_reset_pin, GPIO_PIN_RESET);
+    CHECK_EQ(safety_err_status, 0);
+    CHECK_EQ(sim_serr_interrupts, 0u);
+
+    //disarmed until the reset: further samples don't interrupt again
+    CHECK(!_Sim_Convert(channel, 4095));
+
+    //main loop: peak current error with the channel, one error interrupt, amp stays off
+    SAFETY_LoopUpdate();
+    CHECK_EQ(safety_err_status, I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IPEAK | channel->err_bit);
+    CHECK_EQ(sim_serr_interrupts, 1u);
+    CHECK_EQ(safety_peak_err_source, 0);
+    CHECK_EQ(is_shutdown, 1);
+    CHECK_EQ(sim_amp_reset_pin, GPIO_PIN_RESET);
+    SAFETY_LoopUpdate();
+    CHECK_EQ(sim_serr_interrupts, 1u);
+    CHECK_EQ(is_shutdown, 1);
+  }
+
+  //watchdogs of both ADCs before the next loop cycle: both sources merged into one report
+  _Setup();
+  CHECK(_Sim_Convert(test_channels + 0, 4095));
+  CHECK(_Sim_Convert(test_channels + 1, 0));
+  SAFETY_LoopUpdate();
+  CHECK_EQ(safety_err_status, I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IPEAK | test_channels[0].err_bit | test_channels[1].err_bit);
+  CHECK_EQ(sim_serr_interrupts, 1u);
+
+  //manual shutdown reset clears the error and re-arms: the amp runs again, and a new peak shuts it down again
+  _Setup();
+  CHECK_EQ(safety_err_status, 0);
+  CHECK(_Sim_Convert(test_channels + 0, 4095));
+  CHECK_EQ(is_shutdown, 1);
+}
+
+//the watchdog interrupts (ADC1/2 and ADC3) preempt the I2C interrupts, which must not delay a shutdown
+static void _Test_Priorities() {
+  ADC_HandleTypeDef msp_adc = { 0 };
+  I2C_HandleTypeDef msp_i2c = { 0 };
+
+  msp_adc.Instance = ADC1;
+  HAL_ADC_MspInit(&msp_adc);
+  msp_adc.Instance = ADC3;
+  HAL_ADC_MspInit(&msp_adc);
+  msp_i2c.Instance = I2C3;
+  HAL_I2C_MspInit(&msp_i2c);
+
+  CHECK(NVIC_GetEnableIRQ(ADC1_2_IRQn));
+  CHECK(NVIC_GetEnableIRQ(ADC3_IRQn));
+  //lower value = higher priority
+  uint32_t i2c_priority = NVIC_GetPriority(I2C3_EV_IRQn);
+  if (NVIC_GetPriority(I2C3_ER_IRQn) < i2c_priority) {
+    i2c_priority = NVIC_GetPriority(I2C3_ER_IRQn);
+  }
+  CHECK_MSG(NVIC_GetPriority(ADC1_2_IRQn) < i2c_priority, "ADC1/2 priority 0x%02X, I2C 0x%02X", NVIC_GetPriority(ADC1_2_IRQn), i2c_priority);
+  CHECK_MSG(NVIC_GetPriority(ADC3_IRQn) < i2c_priority, "ADC3 priority 0x%02X, I2C 0x%02X", NVIC_GetPriority(ADC3_IRQn), i2c_priority);
+}
+
+
+int main() {
+  hadc1.Instance = &sim_adc1;
+  hadc2.Instance = &sim_adc2;
+  hadc3.Instance = &sim_adc3;
+  hadc4.Instance = &sim_adc4;
+  _SAFETY_ResetThresholds();
+
+  _Test_Thresholds();
+  _Test_Shutdown();
+  _Test_Priorities();
+
+#ifdef MAIN_FOUR_CHANNEL
+  return HOST_TestSummary("test_overcurrent (4 channel)");
+#else
+  return HOST_TestSummary("test_overcurrent (2 channel)");
+#endif
+}
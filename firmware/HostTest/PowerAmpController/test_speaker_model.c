@@ -0,0 +1,284 @@
+/*
+ * test_speaker_model.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host test of the speaker thermal model (speaker_model.c): parameter validation, step response against the analytic
+ *  two-time-constant solution, gain reduction curve, and the closed protection loop (model -> controller polling and 0.5dB
+ *  steps -> reduced power) with the controller's woofer/tweeter parameters on sustained overload and music-like power traces.
+ *
+ *  Usage:
+ *    pa_test_speaker_model                             run the tests
+ *    pa_test_speaker_model <trace.csv> [tweeter]       drive the woofer (or tweeter) model with a recorded power trace (one average
+ *                                                      real power value in W per ADC batch per line), with and without the loop
+ */
+
+#include "host_test.h"
+#include "speaker_model.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+//controller loop behaviour (power_amp_interface.cpp, amp_manager.cpp): model output poll period and forwarded reduction step
+#define TEST_POLL_PERIOD 0.2f
+#define TEST_REDUCTION_STEP_DB 0.5f
+
+//controller model parameters (amp_manager.cpp): rth coil, tau coil, rth magnet, tau magnet, max rise
+static const float test_woofer_params[5] = { 0.6f, 10.0f, 0.9f, 600.0f, 150.0f };
+static const float test_tweeter_params[5] = { 1.2f, 5.0f, 1.8f, 400.0f, 150.0f };
+
+
+static uint32_t _Batches(float seconds) {
+  return (uint32_t)lroundf(seconds / SPKM_BATCH_TIME);
+}
+
+static void _SetParams(uint8_t channel, const float* params) {
+  uint8_t i;
+  for (i = 0; i < 5; i++) {
+    CHECK_EQ(SPKM_SetParameter(i, channel, params[i]), HAL_OK);
+  }
+}
+
+static void _Run(uint8_t channel, float power, float seconds) {
+  uint32_t n = _Batches(seconds);
+  while (n-- > 0) {
+    SPKM_ProcessBatch(channel, power);
+  }
+}
+
+
+//defaults: model runs but never limits (infinite max rise)
+static void _Test_Defaults() {
+  SPKM_Init();
+  _Run(0, 500.0f, 60.0f);
+  SPKM_LoopUpdate();
+  CHECK(spkm_temp_rise[0] > 0.0f);
+  CHECK_EQ(spkm_limit_active, 0);
+  CHECK(spkm_gain_reduction_dB[0] == 0.0f);
+}
+
+//parameter writes: channel, index and value validation
+static void _Test_Parameters() {
+  CHECK_EQ(SPKM_SetParameter(0, 4, 1.0f), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(5, 0, 1.0f), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(0, 0, 0.0f), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(0, 0, -1.0f), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(0, 0, NAN), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(0, 0, INFINITY), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(1, 0, SPKM_MAX_TAU * 2.0f), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(3, 0, INFINITY), HAL_ERROR);
+  CHECK_EQ(SPKM_SetParameter(4, 0, INFINITY), HAL_OK);
+  CHECK_EQ(SPKM_SetParameter(2, 3, 2.5f), HAL_OK);
+  CHECK(spkm_rth_magnet[3] == 2.5f);
+}
+
+//constant power: the per-batch update is the exact discretisation of both RC stages, so it follows the analytic solution
+static void _Test_StepResponse() {
+  const float power = 50.0f;
+  const float times[] = { 1.0f, 10.0f, 30.0f, 120.0f, 600.0f };
+  float elapsed = 0.0f;
+  int i;
+
+  SPKM_Init();
+  _SetParams(0, test_woofer_params);
+  for (i = 0; i < (int)(sizeof(times) / sizeof(times[0])); i++) {
+    _Run(0, power, times[i] - elapsed);
+    elapsed = times[i];
+    float t = (float)_Batches(elapsed) * SPKM_BATCH_TIME;
+    float expected = power * test_woofer_params[0] * (1.0f - expf(-t / test_woofer_params[1])) +
+                     power * test_woofer_params[2] * (1.0f - expf(-t / test_woofer_params[3]));
+    CHECK_NEAR(spkm_temp_rise[0], expected, 0.002f * expected + 0.01f);
+  }
+
+  //cooling: the coil stage decays quickly, the magnet stage slowly
+  float magnet_rise = spkm_temp_rise[0] - power * test_woofer_params[0];
+  _Run(0, 0.0f, 60.0f);
+  CHECK_NEAR(spkm_temp_rise[0], magnet_rise * expf(-60.0f / test_woofer_params[3]), 0.2f);
+
+  //other channels untouched
+  CHECK(spkm_temp_rise[1] == 0.0f);
+}
+
+//gain reduction: none up to the knee, proportional to the excess above it, clamped to the limit
+static void _Test_GainReduction() {
+  //fast stages (steady state within seconds): steady rise = 2 * power, max rise 100 -> knee at 80
+  const float fast_params[5] = { 1.0f, 0.5f, 1.0f, 1.0f, 100.0f };
+  const float powers[] = { 35.0f, 45.0f, 50.0f, 200.0f };
+  const float expected_dB[] = { 0.0f, 0.5f * SPKM_GAIN_RED_AT_MAX_DB, SPKM_GAIN_RED_AT_MAX_DB, SPKM_GAIN_RED_LIMIT_DB };
+  int i;
+
+  SPKM_Init();
+  _SetParams(2, fast_params);
+  for (i = 0; i < (int)(sizeof(powers) / sizeof(powers[0])); i++) {
+    _Run(2, powers[i], 20.0f);
+    SPKM_LoopUpdate();
+    CHECK_NEAR(spkm_gain_reduction_dB[2], expected_dB[i], 0.01f);
+    CHECK_EQ(spkm_limit_active, expected_dB[i] < 0.0f ? 1 : 0);
+    CHECK(spkm_gain_reduction_dB[3] == 0.0f);
+  }
+
+  //released once cooled below the knee
+  _Run(2, 0.0f, 20.0f);
+  SPKM_LoopUpdate();
+  CHECK(spkm_gain_reduction_dB[2] == 0.0f);
+  CHECK_EQ(spkm_limit_active, 0);
+}
+
+
+/* --------------------------------------- closed protection loop --------------------------------------- */
+
+typedef float (*TestPowerTrace)(uint32_t batch, void* state);
+
+//sustained sine/noise-like load: constant power
+static float _Trace_Constant(uint32_t batch, void* state) {
+  return *(float*)state;
+}
+
+//music-like load: sections of random loudness with beat transients, average of the given power over the trace
+typedef struct {
+  float average_power;
+  uint32_t seed;
+  uint32_t section_end;
+  float section_level;
+  float beat_batches;
+} TestMusicState;
+
+static float _Trace_Music(uint32_t batch, void* state) {
+  TestMusicState* music = (TestMusicState*)state;
+  if (batch >= music->section_end) {
+    srand(music->seed++);
+    music->section_end = batch + _Batches(4.0f + 8.0f * (float)rand() / RAND_MAX);
+    music->section_level = (float)(rand() % 5) / 2.0f; //0 to 2 times the average
+    music->beat_batches = (float)_Batches(60.0f / (80.0f + 60.0f * (float)rand() / RAND_MAX));
+  }
+  float beat_phase = fmodf((float)batch, music->beat_batches) * SPKM_BATCH_TIME;
+  return music->average_power * music->section_level * (0.7f + 0.9f * expf(-beat_phase / 0.03f));
+}
+
+//run a power trace through the model of channel 0, optionally with the controller loop reducing the gain; returns the max rise
+static float _RunLoop(const float* params, TestPowerTrace trace, void* state, uint32_t batches, bool limiting, float* final_reduction_dB) {
+  const uint32_t poll_batches = _Batches(TEST_POLL_PERIOD);
+  float applied_dB = 0.0f;
+  float max_rise = 0.0f;
+  uint32_t batch;
+
+  SPKM_Init();
+  _SetParams(0, params);
+  for (batch = 0; batch < batches; batch++) {
+    float power = trace(batch, state) * powf(10.0f, applied_dB / 10.0f);
+    SPKM_ProcessBatch(0, power);
+    if (spkm_temp_rise[0] > max_rise) {
+      max_rise = spkm_temp_rise[0];
+    }
+
+    if (batch % poll_batches == 0) {
+      //module main loop update, then controller poll: reduction forwarded in whole steps (floor, so never less reduction than requested)
+      SPKM_LoopUpdate();
+      if (limiting) {
+        applied_dB = floorf(spkm_gain_reduction_dB[0] / TEST_REDUCTION_STEP_DB) * TEST_REDUCTION_STEP_DB;
+      }
+    }
+  }
+
+  if (final_reduction_dB != NULL) {
+    *final_reduction_dB = applied_dB;
+  }
+  return max_rise;
+}
+
+static void _Test_ClosedLoop() {
+  const float* speakers[2] = { test_woofer_params, test_tweeter_params };
+  const float overloads[3] = { 1.5f, 2.0f, 3.0f };
+  int s, o;
+
+  for (s = 0; s < 2; s++) {
+    const float* params = speakers[s];
+    //power that reaches the max rise in steady state
+    float max_power = params[4] / (params[0] + params[2]);
+
+    for (o = 0; o < 3; o++) {
+      float power = max_power * overloads[o];
+      float reduction_dB;
+      float unlimited = _RunLoop(params, _Trace_Constant, &power, _Batches(1800.0f), false, NULL);
+      float limited = _RunLoop(params, _Trace_Constant, &power, _Batches(1800.0f), true, &reduction_dB);
+      printf("%s, %.1fx sustained overload (%.0f W): max rise %.1f K unlimited, %.1f K limited, final reduction %.1f dB\n",
+             s == 0 ? "woofer" : "tweeter", overloads[o], power, unlimited, limited, reduction_dB);
+      CHECK(unlimited > params[4]);
+      CHECK_MSG(limited <= params[4], "%.1f K", limited);
+      CHECK(reduction_dB < 0.0f);
+    }
+
+    //music at the rated average power for an hour: held below the max, without a permanent reduction in quiet sections
+    TestMusicState music = { .average_power = 1.2f * max_power, .seed = 1 + s };
+    float limited = _RunLoop(params, _Trace_Music, &music, _Batches(3600.0f), true, NULL);
+    printf("%s, music at %.0f W average: max rise %.1f K limited\n", s == 0 ? "woofer" : "tweeter", music.average_power, limited);
+    CHECK_MSG(limited <= params[4], "%.1f K", limited);
+  }
+}
+
+
+/* --------------------------------------- recorded traces --------------------------------------- */
+
+static float* trace_values = NULL;
+static uint32_t trace_length = 0;
+
+static float _Trace_Recorded(uint32_t batch, void* state) {
+  return trace_values[batch % trace_length];
+}
+
+//drive the model with a recorded power trace (repeated to at least 30 minutes), print the results; fails if the loop can't hold the max rise
+static int _RunRecordedTrace(const char* path, const float* params) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    perror(path);
+    return 1;
+  }
+
+  uint32_t capacity = 0;
+  char line[64];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    char* end;
+    float value = strtof(line, &end);
+    if (end == line) {
+      continue; //header or empty line
+    }
+    if (trace_length == capacity) {
+      capacity = capacity ? 2 * capacity : 4096;
+      trace_values = realloc(trace_values, capacity * sizeof(float));
+    }
+    trace_values[trace_length++] = fabsf(value);
+  }
+  fclose(file);
+
+  if (trace_length == 0) {
+    fprintf(stderr, "no power values in %s\n", path);
+    return 1;
+  }
+
+  uint32_t batches = trace_length > _Batches(1800.0f) ? trace_length : _Batches(1800.0f);
+  float reduction_dB;
+  float unlimited = _RunLoop(params, _Trace_Recorded, NULL, batches, false, NULL);
+  float limited = _RunLoop(params, _Trace_Recorded, NULL, batches, true, &reduction_dB);
+  printf("%s: %lu batches (%.1f s): max rise %.1f K unlimited, %.1f K limited (max %.1f K), final reduction %.1f dB\n",
+         path, (unsigned long)batches, batches * SPKM_BATCH_TIME, unlimited, limited, params[4], reduction_dB);
+
+  free(trace_values);
+  return limited <= params[4] ? 0 : 1;
+}
+
+
+int main(int argc, char** argv) {
+  if (argc >= 2) {
+    bool tweeter = argc >= 3 && strcmp(argv[2], "tweeter") == 0;
+    return _RunRecordedTrace(argv[1], tweeter ? test_tweeter_params : test_woofer_params);
+  }
+
+  _Test_Defaults();
+  _Test_Parameters();
+  _Test_StepResponse();
+  _Test_GainReduction();
+  _Test_ClosedLoop();
+
+  return HOST_TestSummary("test_speaker_model");
+}
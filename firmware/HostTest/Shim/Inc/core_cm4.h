@@ -0,0 +1,15 @@
+/*
+ * core_cm4.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host build stand-in for the CMSIS core header - found before the real one via the include path order
+ */
+
+#ifndef INC_CORE_CM4_HOST_H_
+#define INC_CORE_CM4_HOST_H_
+
+#include "core_host.h"
+
+#endif /* INC_CORE_CM4_HOST_H_ */
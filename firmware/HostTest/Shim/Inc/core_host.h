@@ -0,0 +1,322 @@
+/*
+ * core_host.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host (x86/Linux) replacement for the CMSIS Cortex-M core headers, so the firmware sources and device/HAL headers compile natively
+ *  Core peripherals are plain variables instead of memory-mapped registers; intrinsics are C equivalents
+ */
+
+#ifndef INC_CORE_HOST_H_
+#define INC_CORE_HOST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__GNUC_PYTHON__) && defined(__cplusplus)
+//C++ with CMSIS-DSP: the device header needs __CLZ declared before use, so take CMSIS-DSP's host intrinsics right away
+#include "dsp/none.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//compiler abstraction (same definitions as the CMSIS-DSP host build, see arm_math_types.h with __GNUC_PYTHON__)
+#ifndef __ASM
+#define __ASM __asm
+#endif
+#ifndef __INLINE
+#define __INLINE inline
+#endif
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE static inline
+#endif
+#ifndef __STATIC_FORCEINLINE
+#define __STATIC_FORCEINLINE static inline __attribute__((always_inline))
+#endif
+#ifndef __NO_RETURN
+#define __NO_RETURN __attribute__((__noreturn__))
+#endif
+#ifndef __USED
+#define __USED __attribute__((used))
+#endif
+#ifndef __WEAK
+#define __WEAK
+#endif
+#ifndef __PACKED
+#define __PACKED __attribute__((packed, aligned(1)))
+#endif
+#ifndef __PACKED_STRUCT
+#define __PACKED_STRUCT struct __attribute__((packed, aligned(1)))
+#endif
+#ifndef __ALIGNED
+#define  __ALIGNED(x) __attribute__((aligned(x)))
+#endif
+#ifndef __RESTRICT
+#define __RESTRICT __restrict
+#endif
+#ifndef __COMPILER_BARRIER
+#define __COMPILER_BARRIER() __asm volatile("":::"memory")
+#endif
+
+#define __UNALIGNED_UINT16_READ(addr) (*(const uint16_t*)(const void*)(addr))
+#define __UNALIGNED_UINT16_WRITE(addr, val) ((void)(*(uint16_t*)(void*)(addr) = (uint16_t)(val)))
+#define __UNALIGNED_UINT32_READ(addr) (*(const uint32_t*)(const void*)(addr))
+#define __UNALIGNED_UINT32_WRITE(addr, val) ((void)(*(uint32_t*)(void*)(addr) = (uint32_t)(val)))
+
+
+//IO definitions
+#ifdef __cplusplus
+#define __I volatile
+#else
+#define __I volatile const
+#endif
+#define __O volatile
+#define __IO volatile
+#define __IM volatile const
+#define __OM volatile
+#define __IOM volatile
+
+
+//interrupt masking: tracked so tests can check for balanced critical sections
+extern volatile uint32_t host_primask;
+extern volatile uint32_t host_irq_disable_count;
+
+__STATIC_FORCEINLINE void __disable_irq(void) { host_primask = 1; host_irq_disable_count++; }
+__STATIC_FORCEINLINE void __enable_irq(void) { host_primask = 0; }
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void) { return host_primask; }
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t primask) { host_primask = primask; }
+
+//barriers and hints
+__STATIC_FORCEINLINE void __NOP(void) {}
+__STATIC_FORCEINLINE void __WFI(void) {}
+__STATIC_FORCEINLINE void __WFE(void) {}
+__STATIC_FORCEINLINE void __SEV(void) {}
+__STATIC_FORCEINLINE void __ISB(void) { __COMPILER_BARRIER(); }
+__STATIC_FORCEINLINE void __DSB(void) { __COMPILER_BARRIER(); }
+__STATIC_FORCEINLINE void __DMB(void) { __COMPILER_BARRIER(); }
+
+//byte order
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t value) { return __builtin_bswap32(value); }
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t value) { return ((value & 0xFF00FF00U) >> 8) | ((value & 0x00FF00FFU) << 8); }
+__STATIC_FORCEINLINE int16_t __REVSH(int16_t value) { return (int16_t)__builtin_bswap16((uint16_t)value); }
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value) {
+  uint32_t result = 0;
+  for (int i = 0; i < 32; i++) {
+    result = (result << 1) | (value & 1U);
+    value >>= 1;
+  }
+  return result;
+}
+
+//exclusive access: single-threaded host, so stores always succeed
+__STATIC_FORCEINLINE uint32_t __LDREXW(volatile uint32_t* addr) { return *addr; }
+__STATIC_FORCEINLINE uint32_t __STREXW(uint32_t value, volatile uint32_t* addr) { *addr = value; return 0; }
+__STATIC_FORCEINLINE uint16_t __LDREXH(volatile uint16_t* addr) { return *addr; }
+__STATIC_FORCEINLINE uint32_t __STREXH(uint16_t value, volatile uint16_t* addr) { *addr = value; return 0; }
+__STATIC_FORCEINLINE void __CLREX(void) {}
+
+//note: __CLZ, __SSAT, __USAT and the SIMD intrinsics come from CMSIS-DSP's host support (dsp/none.h), built with __GNUC_PYTHON__
+#ifndef __GNUC_PYTHON__
+//builds without CMSIS-DSP: __CLZ is still needed by the device header's bit position macros (C++ requires a declaration)
+__STATIC_FORCEINLINE uint8_t __CLZ(uint32_t value) { return value == 0 ? 32 : (uint8_t)__builtin_clz(value); }
+#endif
+
+
+//core peripherals - only the registers that the firmware or HAL headers touch
+typedef struct {
+  __IOM uint32_t ISER[8];
+  __IOM uint32_t ICER[8];
+  __IOM uint32_t ISPR[8];
+  __IOM uint32_t ICPR[8];
+  __IOM uint32_t IABR[8];
+  __IOM uint8_t IP[240];
+  __OM uint32_t STIR;
+} NVIC_Type;
+
+typedef struct {
+  __IM uint32_t CPUID;
+  __IOM uint32_t ICSR;
+  __IOM uint32_t VTOR;
+  __IOM uint32_t AIRCR;
+  __IOM uint32_t SCR;
+  __IOM uint32_t CCR;
+  __IOM uint8_t SHPR[12];
+  __IOM uint32_t SHCSR;
+  __IOM uint32_t CFSR;
+  __IOM uint32_t HFSR;
+  __IOM uint32_t DFSR;
+  __IOM uint32_t MMFAR;
+  __IOM uint32_t BFAR;
+  __IOM uint32_t AFSR;
+  __IOM uint32_t CPACR;
+} SCB_Type;
+
+typedef struct {
+  __IOM uint32_t CTRL;
+  __IOM uint32_t LOAD;
+  __IOM uint32_t VAL;
+  __IM uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+  __IOM uint32_t CTRL;
+  __IOM uint32_t CYCCNT;
+  __IOM uint32_t CPICNT;
+  __IOM uint32_t EXCCNT;
+  __IOM uint32_t SLEEPCNT;
+  __IOM uint32_t LSUCNT;
+  __IOM uint32_t FOLDCNT;
+  __IM uint32_t PCSR;
+  __OM uint32_t LAR;
+  __IM uint32_t LSR;
+} DWT_Type;
+
+typedef struct {
+  __IOM uint32_t DHCSR;
+  __OM uint32_t DCRSR;
+  __IOM uint32_t DCRDR;
+  __IOM uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+  __IM uint32_t TYPE;
+  __IOM uint32_t CTRL;
+  __IOM uint32_t RNR;
+  __IOM uint32_t RBAR;
+  __IOM uint32_t RASR;
+} MPU_Type;
+
+extern NVIC_Type host_nvic;
+extern SCB_Type host_scb;
+extern SysTick_Type host_systick;
+extern DWT_Type host_dwt;
+extern CoreDebug_Type host_coredebug;
+extern MPU_Type host_mpu;
+
+#define NVIC (&host_nvic)
+#define SCB (&host_scb)
+#define SysTick (&host_systick)
+#define DWT (&host_dwt)
+#define CoreDebug (&host_coredebug)
+#define MPU (&host_mpu)
+
+#define SCB_CPUID_REVISION_Pos 0U
+#define SCB_CPUID_REVISION_Msk (0xFUL << SCB_CPUID_REVISION_Pos)
+#define SCB_CPUID_PARTNO_Pos 4U
+#define SCB_CPUID_PARTNO_Msk (0xFFFUL << SCB_CPUID_PARTNO_Pos)
+#define SCB_SCR_SEVONPEND_Pos 4U
+#define SCB_SCR_SEVONPEND_Msk (1UL << SCB_SCR_SEVONPEND_Pos)
+#define SCB_SCR_SLEEPDEEP_Pos 2U
+#define SCB_SCR_SLEEPDEEP_Msk (1UL << SCB_SCR_SLEEPDEEP_Pos)
+#define SCB_SCR_SLEEPONEXIT_Pos 1U
+#define SCB_SCR_SLEEPONEXIT_Msk (1UL << SCB_SCR_SLEEPONEXIT_Pos)
+#define SCB_AIRCR_VECTKEY_Pos 16U
+#define SCB_AIRCR_VECTKEY_Msk (0xFFFFUL << SCB_AIRCR_VECTKEY_Pos)
+#define SCB_AIRCR_PRIGROUP_Pos 8U
+#define SCB_AIRCR_PRIGROUP_Msk (7UL << SCB_AIRCR_PRIGROUP_Pos)
+#define SCB_AIRCR_SYSRESETREQ_Pos 2U
+#define SCB_AIRCR_SYSRESETREQ_Msk (1UL << SCB_AIRCR_SYSRESETREQ_Pos)
+#define SCB_ICSR_PENDSVSET_Pos 28U
+#define SCB_ICSR_PENDSVSET_Msk (1UL << SCB_ICSR_PENDSVSET_Pos)
+
+#define SysTick_CTRL_COUNTFLAG_Pos 16U
+#define SysTick_CTRL_COUNTFLAG_Msk (1UL << SysTick_CTRL_COUNTFLAG_Pos)
+#define SysTick_CTRL_CLKSOURCE_Pos 2U
+#define SysTick_CTRL_CLKSOURCE_Msk (1UL << SysTick_CTRL_CLKSOURCE_Pos)
+#define SysTick_CTRL_TICKINT_Pos 1U
+#define SysTick_CTRL_TICKINT_Msk (1UL << SysTick_CTRL_TICKINT_Pos)
+#define SysTick_CTRL_ENABLE_Pos 0U
+#define SysTick_CTRL_ENABLE_Msk (1UL)
+#define SysTick_LOAD_RELOAD_Pos 0U
+#define SysTick_LOAD_RELOAD_Msk (0xFFFFFFUL)
+
+#define DWT_CTRL_CYCCNTENA_Pos 0U
+#define DWT_CTRL_CYCCNTENA_Msk (1UL)
+#define CoreDebug_DEMCR_TRCENA_Pos 24U
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << CoreDebug_DEMCR_TRCENA_Pos)
+
+#define MPU_CTRL_ENABLE_Pos 0U
+#define MPU_CTRL_ENABLE_Msk (1UL)
+#define MPU_RASR_ENABLE_Pos 0U
+#define MPU_RASR_ENABLE_Msk (1UL)
+#define MPU_RASR_SIZE_Pos 1U
+#define MPU_RASR_SIZE_Msk (0x1FUL << MPU_RASR_SIZE_Pos)
+#define MPU_RASR_SRD_Pos 8U
+#define MPU_RASR_SRD_Msk (0xFFUL << MPU_RASR_SRD_Pos)
+#define MPU_RASR_B_Pos 16U
+#define MPU_RASR_B_Msk (1UL << MPU_RASR_B_Pos)
+#define MPU_RASR_C_Pos 17U
+#define MPU_RASR_C_Msk (1UL << MPU_RASR_C_Pos)
+#define MPU_RASR_S_Pos 18U
+#define MPU_RASR_S_Msk (1UL << MPU_RASR_S_Pos)
+#define MPU_RASR_TEX_Pos 19U
+#define MPU_RASR_TEX_Msk (7UL << MPU_RASR_TEX_Pos)
+#define MPU_RASR_AP_Pos 24U
+#define MPU_RASR_AP_Msk (7UL << MPU_RASR_AP_Pos)
+#define MPU_RASR_XN_Pos 28U
+#define MPU_RASR_XN_Msk (1UL << MPU_RASR_XN_Pos)
+
+
+//NVIC functions: only record the state, interrupts are delivered by the tests calling the handlers/callbacks directly
+#define NVIC_SetPriorityGrouping __NVIC_SetPriorityGrouping
+#define NVIC_GetPriorityGrouping __NVIC_GetPriorityGrouping
+#define NVIC_EnableIRQ __NVIC_EnableIRQ
+#define NVIC_GetEnableIRQ __NVIC_GetEnableIRQ
+#define NVIC_DisableIRQ __NVIC_DisableIRQ
+#define NVIC_GetPendingIRQ __NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ __NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ __NVIC_ClearPendingIRQ
+#define NVIC_SetPriority __NVIC_SetPriority
+#define NVIC_GetPriority __NVIC_GetPriority
+#define NVIC_SystemReset __NVIC_SystemReset
+
+__STATIC_INLINE void __NVIC_SetPriorityGrouping(uint32_t PriorityGroup) { SCB->AIRCR = (PriorityGroup & 7UL) << SCB_AIRCR_PRIGROUP_Pos; }
+__STATIC_INLINE uint32_t __NVIC_GetPriorityGrouping(void) { return (SCB->AIRCR & SCB_AIRCR_PRIGROUP_Msk) >> SCB_AIRCR_PRIGROUP_Pos; }
+__STATIC_INLINE void __NVIC_EnableIRQ(int IRQn) { if (IRQn >= 0) NVIC->ISER[IRQn >> 5] |= 1UL << (IRQn & 0x1F); }
+__STATIC_INLINE uint32_t __NVIC_GetEnableIRQ(int IRQn) { return (IRQn >= 0) ? ((NVIC->ISER[IRQn >> 5] >> (IRQn & 0x1F)) & 1UL) : 0U; }
+__STATIC_INLINE void __NVIC_DisableIRQ(int IRQn) { if (IRQn >= 0) NVIC->ISER[IRQn >> 5] &= ~(1UL << (IRQn & 0x1F)); }
+__STATIC_INLINE uint32_t __NVIC_GetPendingIRQ(int IRQn) { return (IRQn >= 0) ? ((NVIC->ISPR[IRQn >> 5] >> (IRQn & 0x1F)) & 1UL) : 0U; }
+__STATIC_INLINE void __NVIC_SetPendingIRQ(int IRQn) { if (IRQn >= 0) NVIC->ISPR[IRQn >> 5] |= 1UL << (IRQn & 0x1F); }
+__STATIC_INLINE void __NVIC_ClearPendingIRQ(int IRQn) { if (IRQn >= 0) NVIC->ISPR[IRQn >> 5] &= ~(1UL << (IRQn & 0x1F)); }
+__STATIC_INLINE void __NVIC_SetPriority(int IRQn, uint32_t priority) { if (IRQn >= 0) NVIC->IP[IRQn] = (uint8_t)priority; }
+__STATIC_INLINE uint32_t __NVIC_GetPriority(int IRQn) { return (IRQn >= 0) ? NVIC->IP[IRQn] : 0U; }
+__STATIC_INLINE uint32_t NVIC_EncodePriority(uint32_t PriorityGroup, uint32_t PreemptPriority, uint32_t SubPriority) {
+  (void)PriorityGroup;
+  return (PreemptPriority << 4) | SubPriority;
+}
+__STATIC_INLINE void NVIC_DecodePriority(uint32_t Priority, uint32_t PriorityGroup, uint32_t* const pPreemptPriority, uint32_t* const pSubPriority) {
+  (void)PriorityGroup;
+  *pPreemptPriority = Priority >> 4;
+  *pSubPriority = Priority & 0xF;
+}
+void __NVIC_SystemReset(void);
+
+__STATIC_INLINE uint32_t SysTick_Config(uint32_t ticks) {
+  SysTick->LOAD = ticks - 1UL;
+  SysTick->VAL = 0UL;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+  return 0UL;
+}
+
+//cache maintenance: no caches on the host side of things
+__STATIC_INLINE void SCB_EnableICache(void) {}
+__STATIC_INLINE void SCB_DisableICache(void) {}
+__STATIC_INLINE void SCB_EnableDCache(void) {}
+__STATIC_INLINE void SCB_DisableDCache(void) {}
+__STATIC_INLINE void SCB_CleanDCache(void) {}
+__STATIC_INLINE void SCB_InvalidateDCache(void) {}
+__STATIC_INLINE void SCB_CleanInvalidateDCache(void) {}
+__STATIC_INLINE void SCB_CleanDCache_by_Addr(volatile void* addr, int32_t dsize) { (void)addr; (void)dsize; }
+__STATIC_INLINE void SCB_InvalidateDCache_by_Addr(volatile void* addr, int32_t dsize) { (void)addr; (void)dsize; }
+__STATIC_INLINE void SCB_CleanInvalidateDCache_by_Addr(volatile void* addr, int32_t dsize) { (void)addr; (void)dsize; }
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_CORE_HOST_H_ */
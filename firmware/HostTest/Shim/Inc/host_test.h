@@ -0,0 +1,97 @@
+/*
+ * host_test.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Minimal assertion and timing helpers for the host test executables
+ *  Each test executable returns non-zero from main if any check failed, which ctest reports as a failure
+ */
+
+#ifndef INC_HOST_TEST_H_
+#define INC_HOST_TEST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//number of failed checks so far
+extern uint32_t host_test_failures;
+//number of checks so far
+extern uint32_t host_test_checks;
+
+//simulated time in milliseconds, returned by HAL_GetTick
+extern volatile uint32_t host_tick_ms;
+
+//optional function called on every HAL_GetTick, to simulate interrupts that firmware busy-wait loops depend on (e.g. DMA completion)
+extern void (*volatile host_tick_hook)(void);
+
+//optional replacement of HOST_AdvanceTime (and so HAL_Delay), for simulations with their own time base and event scheduling
+extern void (*volatile host_advance_hook)(uint32_t ms);
+
+//advance simulated time (HAL_GetTick) by the given number of milliseconds
+void HOST_AdvanceTime(uint32_t ms);
+
+//print a summary line and return the process exit code
+int HOST_TestSummary(const char* test_name);
+
+//wall-clock time in nanoseconds, for host benchmarks
+static inline uint64_t HOST_GetTimeNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+//check a condition, report file/line and the condition on failure (continues the test)
+#define CHECK(cond) do { \
+  host_test_checks++; \
+  if (!(cond)) { \
+    host_test_failures++; \
+    printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+  } \
+} while (0)
+
+//check a condition, with a printf-style message on failure
+#define CHECK_MSG(cond, ...) do { \
+  host_test_checks++; \
+  if (!(cond)) { \
+    host_test_failures++; \
+    printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+    printf(__VA_ARGS__); \
+    printf("\n"); \
+  } \
+} while (0)
+
+//check two integer values for equality, printing both on failure
+#define CHECK_EQ(a, b) do { \
+  long long _a = (long long)(a), _b = (long long)(b); \
+  host_test_checks++; \
+  if (_a != _b) { \
+    host_test_failures++; \
+    printf("FAIL %s:%d: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+  } \
+} while (0)
+
+//check two floating-point values for equality within the given absolute tolerance
+#define CHECK_NEAR(a, b, tol) do { \
+  double _a = (double)(a), _b = (double)(b); \
+  host_test_checks++; \
+  if (!(fabs(_a - _b) <= (double)(tol))) { \
+    host_test_failures++; \
+    printf("FAIL %s:%d: %s ~= %s (%g vs %g, tol %g)\n", __FILE__, __LINE__, #a, #b, _a, _b, (double)(tol)); \
+  } \
+} while (0)
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_HOST_TEST_H_ */
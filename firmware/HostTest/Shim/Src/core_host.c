@@ -0,0 +1,72 @@
+/*
+ * core_host.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alex
+ *
+ *  Host build core peripheral variables, simulated time base and test bookkeeping
+ */
+
+#include "core_host.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+
+volatile uint32_t host_primask = 0;
+volatile uint32_t host_irq_disable_count = 0;
+
+NVIC_Type host_nvic = { 0 };
+SCB_Type host_scb = { 0 };
+SysTick_Type host_systick = { 0 };
+DWT_Type host_dwt = { 0 };
+CoreDebug_Type host_coredebug = { 0 };
+MPU_Type host_mpu = { 0 };
+
+uint32_t host_test_failures = 0;
+uint32_t host_test_checks = 0;
+
+volatile uint32_t host_tick_ms = 0;
+
+void (*volatile host_tick_hook)(void) = NULL;
+void (*volatile host_advance_hook)(uint32_t ms) = NULL;
+
+
+void __NVIC_SystemReset(void) {
+  printf("* System reset requested\n");
+  exit(2);
+}
+
+
+//HAL time base - identical signatures in all HAL families, so shared here
+uint32_t HAL_GetTick(void) {
+  if (host_tick_hook != NULL) {
+    host_tick_hook();
+  }
+  return host_tick_ms;
+}
+
+void HAL_IncTick(void) {
+  host_tick_ms++;
+}
+
+void HAL_Delay(uint32_t Delay) {
+  HOST_AdvanceTime(Delay);
+}
+
+void HOST_AdvanceTime(uint32_t ms) {
+  if (host_advance_hook != NULL) {
+    host_advance_hook(ms);
+    return;
+  }
+  host_tick_ms += ms;
+}
+
+
+int HOST_TestSummary(const char* test_name) {
+  if (host_test_failures > 0) {
+    printf("%s: %lu of %lu checks FAILED\n", test_name, (unsigned long)host_test_failures, (unsigned long)host_test_checks);
+    return 1;
+  }
+  printf("%s: all %lu checks passed\n", test_name, (unsigned long)host_test_checks);
+  return 0;
+}
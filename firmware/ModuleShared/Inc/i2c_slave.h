@@ -0,0 +1,83 @@
+/*
+ * i2c_slave.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ *
+ *  Generic I2C slave register engine, shared by the module firmwares (single copy in firmware/ModuleShared, linked into each module project as the ModuleShared folder).
+ *  Implements the common register protocol (register address write, then sequential register reads/writes of register size + 1 CRC-8 byte each,
+ *  with address auto-increment), the common interrupt flag/mask/pin logic, and bus error/timeout recovery.
+ *  The module-specific registers are described by a declarative register table (i2c_registers, defined in the module's i2c.c).
+ *  Configuration macros are taken from the module's i2c.h, which includes this header.
+ */
+
+#ifndef INC_I2C_SLAVE_H_
+#define INC_I2C_SLAVE_H_
+
+
+#include "main.h"
+#include <stdbool.h>
+
+
+//register access flags
+#define I2C_REG_READ 0x01
+#define I2C_REG_WRITE 0x02
+#define I2C_REG_RW (I2C_REG_READ | I2C_REG_WRITE)
+
+
+typedef struct _I2C_Register I2C_Register;
+
+//read handler: fills the given buffer (pre-cleared, register size) with the data of the register at the given index within the table entry
+typedef void (*I2C_ReadHandler)(const I2C_Register* reg, uint8_t index, uint8_t* buf);
+//write handler: processes the received, CRC-checked data of the register at the given index within the table entry - invalid data is reported using I2C_ReportError()
+typedef void (*I2C_WriteHandler)(const I2C_Register* reg, uint8_t index, const uint8_t* buf);
+
+//register table entry: block of consecutive registers with the same size, access and handlers
+struct _I2C_Register {
+  uint8_t address;        //address of the first register in the block
+  uint8_t count;          //number of registers in the block
+  uint16_t size;          //size of each register, in bytes
+  uint8_t access;         //access flags
+  const void* data;       //live read data (register at index i starts at data + i * size), or NULL to use the read handler
+  I2C_ReadHandler read;   //read handler, only used if data is NULL
+  I2C_WriteHandler write; //write handler, required for writable registers
+  const void* param;      //handler-specific parameter
+};
+
+//register table entry helpers
+//single register with handlers
+#define I2C_REGISTER(address, size, access, read, write) { (address), 1, (size), (access), NULL, (read), (write), NULL }
+//block of registers with handlers and parameter
+#define I2C_REGISTER_BLOCK(address, count, size, access, read, write, param) { (address), (count), (size), (access), NULL, (read), (write), (param) }
+//block of registers read directly from the given live data, optionally writable through the given handler
+#define I2C_REGISTER_LIVE(address, count, size, access, data, write, param) { (address), (count), (size), (access), (data), NULL, (write), (param) }
+
+
+//register table, defined by the module (in any order, non-overlapping, no register at address 0)
+extern const I2C_Register i2c_registers[];
+extern const uint8_t i2c_register_count;
+
+
+HAL_StatusTypeDef I2C_Init();
+void I2C_TriggerInterrupt(uint8_t interrupt_bit);
+void I2C_LoopUpdate();
+
+void I2C_TimeoutISR();
+
+//functions for use in register handlers
+//report a communication error (invalid write data etc.) to the master
+void I2C_ReportError();
+//get the comm error state since the last call (for the status register), resets it
+bool I2C_GetAndResetError();
+//interrupt enable state (part of the module's control register)
+bool I2C_GetInterruptsEnabled();
+void I2C_SetInterruptsEnabled(bool enabled);
+
+//common interrupt mask and flag register handlers
+void I2C_ReadInterruptMask(const I2C_Register* reg, uint8_t index, uint8_t* buf);
+void I2C_WriteInterruptMask(const I2C_Register* reg, uint8_t index, const uint8_t* buf);
+void I2C_ReadInterruptFlags(const I2C_Register* reg, uint8_t index, uint8_t* buf);
+void I2C_WriteInterruptFlags(const I2C_Register* reg, uint8_t index, const uint8_t* buf);
+
+
+#endif /* INC_I2C_SLAVE_H_ */
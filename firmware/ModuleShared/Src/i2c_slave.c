@@ -0,0 +1,559 @@
+/*
+ * i2c_slave.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ */
+
+#include "i2c.h"
+#include <stdio.h>
+#include <string.h>
+
+
+#define I2C_OWN_ADDRESS_WRITE ((uint8_t)I2C_GET_OWN_ADDRESS1(&I2C_INSTANCE))
+#define I2C_OWN_ADDRESS_READ (I2C_OWN_ADDRESS_WRITE | 0x01)
+
+
+typedef enum {
+  I2C_UNINIT,
+  I2C_IDLE,
+  I2C_WAITING_ADDR,
+  I2C_ADDR_RECEIVED,
+  I2C_WRITE,
+  I2C_READ
+} _I2C_State;
+
+
+//internal state of the I2C system
+static _I2C_State state = I2C_UNINIT;
+//virtual register address to be written/read
+static uint8_t reg_addr = 0;
+//register table entry of the selected register (NULL if invalid), and index of the register within that entry
+static const I2C_Register* reg_entry = NULL;
+static uint8_t reg_index = 0;
+//size of selected virtual register (for reads/writes)
+static uint16_t reg_size = 0;
+//virtual data buffers (read and write)
+static uint8_t __attribute__((aligned(4))) read_buf[I2C_VIRT_BUFFER_SIZE + 1] = { 0 };
+static uint8_t __attribute__((aligned(4))) write_buf[I2C_VIRT_BUFFER_SIZE + 1] = { 0 };
+
+//whether a comm error has been detected since the last status read
+static uint8_t i2c_err_detected = 0;
+
+//timeout for non-idle states in main loop cycles
+static uint8_t non_idle_timeout = 0;
+//sightings of busy peripheral in idle state
+static uint8_t idle_busy_count = 0;
+
+//register lookup map: register table entry index + 1 for each register address, 0 for invalid registers - built from the register table on init
+static uint8_t reg_lookup_map[256] = { 0 };
+
+//configured state
+static uint8_t interrupts_enabled = 0;
+static uint8_t interrupt_mask = 0;
+static uint8_t interrupt_flags = I2C_INT_RESET_Msk;
+
+#ifdef I2C_CRC_POLYNOMIAL
+//I2C CRC data - running CRC state, computed by the hardware CRC unit (CRC-8, polynomial I2C_CRC_POLYNOMIAL, init 0, no reflection)
+static uint8_t _i2c_crc_state = 0;
+#else
+//I2C CRC data
+static const uint8_t _i2c_crc_table[256] = {
+  0x00, 0x7F, 0xFE, 0x81, 0x83, 0xFC, 0x7D, 0x02, 0x79, 0x06, 0x87, 0xF8, 0xFA, 0x85, 0x04, 0x7B,
+  0xF2, 0x8D, 0x0C, 0x73, 0x71, 0x0E, 0x8F, 0xF0, 0x8B, 0xF4, 0x75, 0x0A, 0x08, 0x77, 0xF6, 0x89,
+  0x9B, 0xE4, 0x65, 0x1A, 0x18, 0x67, 0xE6, 0x99, 0xE2, 0x9D, 0x1C, 0x63, 0x61, 0x1E, 0x9F, 0xE0,
+  0x69, 0x16, 0x97, 0xE8, 0xEA, 0x95, 0x14, 0x6B, 0x10, 0x6F, 0xEE, 0x91, 0x93, 0xEC, 0x6D, 0x12,
+  0x49, 0x36, 0xB7, 0xC8, 0xCA, 0xB5, 0x34, 0x4B, 0x30, 0x4F, 0xCE, 0xB1, 0xB3, 0xCC, 0x4D, 0x32,
+  0xBB, 0xC4, 0x45, 0x3A, 0x38, 0x47, 0xC6, 0xB9, 0xC2, 0xBD, 0x3C, 0x43, 0x41, 0x3E, 0xBF, 0xC0,
+  0xD2, 0xAD, 0x2C, 0x53, 0x51, 0x2E, 0xAF, 0xD0, 0xAB, 0xD4, 0x55, 0x2A, 0x28, 0x57, 0xD6, 0xA9,
+  0x20, 0x5F, 0xDE, 0xA1, 0xA3, 0xDC, 0x5D, 0x22, 0x59, 0x26, 0xA7, 0xD8, 0xDA, 0xA5, 0x24, 0x5B,
+  0x92, 0xED, 0x6C, 0x13, 0x11, 0x6E, 0xEF, 0x90, 0xEB, 0x94, 0x15, 0x6A, 0x68, 0x17, 0x96, 0xE9,
+  0x60, 0x1F, 0x9E, 0xE1, 0xE3, 0x9C, 0x1D, 0x62, 0x19, 0x66, 0xE7, 0x98, 0x9A, 0xE5, 0x64, 0x1B,
+  0x09, 0x76, 0xF7, 0x88, 0x8A, 0xF5, 0x74, 0x0B, 0x70, 0x0F, 0x8E, 0xF1, 0xF3, 0x8C, 0x0D, 0x72,
+  0xFB, 0x84, 0x05, 0x7A, 0x78, 0x07, 0x86, 0xF9, 0x82, 0xFD, 0x7C, 0x03, 0x01, 0x7E, 0xFF, 0x80,
+  0xDB, 0xA4, 0x25, 0x5A, 0x58, 0x27, 0xA6, 0xD9, 0xA2, 0xDD, 0x5C, 0x23, 0x21, 0x5E, 0xDF, 0xA0,
+  0x29, 0x56, 0xD7, 0xA8, 0xAA, 0xD5, 0x54, 0x2B, 0x50, 0x2F, 0xAE, 0xD1, 0xD3, 0xAC, 0x2D, 0x52,
+  0x40, 0x3F, 0xBE, 0xC1, 0xC3, 0xBC, 0x3D, 0x42, 0x39, 0x46, 0xC7, 0xB8, 0xBA, 0xC5, 0x44, 0x3B,
+  0xB2, 0xCD, 0x4C, 0x33, 0x31, 0x4E, 0xCF, 0xB0, 0xCB, 0xB4, 0x35, 0x4A, 0x48, 0x37, 0xB6, 0xC9
+};
+static uint8_t _i2c_crc_state = 0;
+#endif
+
+
+static void _I2C_UpdateInterruptPin() {
+  if (((interrupt_flags & I2C_INT_RESET_Msk) != 0) || (interrupts_enabled && (interrupt_flags & interrupt_mask) != 0)) {
+    HAL_GPIO_WritePin(I2C_INT_PORT, I2C_INT_PIN, GPIO_PIN_RESET);
+  } else {
+    HAL_GPIO_WritePin(I2C_INT_PORT, I2C_INT_PIN, GPIO_PIN_SET);
+  }
+}
+
+#ifdef I2C_CRC_POLYNOMIAL
+#ifndef I2C_CRC_UNIT_EMULATED
+//hardware CRC unit access: restart from the given state, feed a word (first byte in the most significant bits) or a single byte, get the result
+//host builds define I2C_CRC_UNIT_EMULATED and provide an emulation of these instead
+static inline void _I2C_CRCUnit_Start(uint8_t crc_state) {
+  CRC->INIT = crc_state;
+  CRC->CR = I2C_CRC_CR_CONFIG | CRC_CR_RESET;
+}
+
+static inline void _I2C_CRCUnit_FeedWord(uint32_t word) {
+  CRC->DR = word;
+}
+
+static inline void _I2C_CRCUnit_FeedByte(uint8_t byte) {
+  *(__IO uint8_t*)&CRC->DR = byte;
+}
+
+static inline uint8_t _I2C_CRCUnit_GetResult() {
+  return (uint8_t)CRC->DR;
+}
+#endif
+
+//calculate CRC, starting with existing _i2c_crc_state - uses the hardware CRC unit, only called from I2C interrupts (all at the same priority)
+static uint8_t _I2C_CRC_Accumulate(const uint8_t* buf, uint16_t length) {
+  //restart CRC calculation from current state
+  _I2C_CRCUnit_Start(_i2c_crc_state);
+
+  //feed full words first, byte-swapped so the first byte in memory is processed first
+  while (length >= 4) {
+    _I2C_CRCUnit_FeedWord(__REV(__UNALIGNED_UINT32_READ(buf)));
+    buf += 4;
+    length -= 4;
+  }
+  //feed remaining bytes individually
+  while (length > 0) {
+    _I2C_CRCUnit_FeedByte(*(buf++));
+    length--;
+  }
+
+  _i2c_crc_state = _I2C_CRCUnit_GetResult();
+  return _i2c_crc_state;
+}
+
+//copy the given data to the destination buffer and calculate its CRC in the same pass, starting with existing _i2c_crc_state
+static uint8_t _I2C_CRC_Copy(uint8_t* dest, const uint8_t* src, uint16_t length) {
+  uint32_t word;
+  uint8_t byte;
+
+  //restart CRC calculation from current state
+  _I2C_CRCUnit_Start(_i2c_crc_state);
+
+  while (length >= 4) {
+    word = __UNALIGNED_UINT32_READ(src);
+    __UNALIGNED_UINT32_WRITE(dest, word);
+    _I2C_CRCUnit_FeedWord(__REV(word));
+    src += 4;
+    dest += 4;
+    length -= 4;
+  }
+  while (length > 0) {
+    byte = *(src++);
+    *(dest++) = byte;
+    _I2C_CRCUnit_FeedByte(byte);
+    length--;
+  }
+
+  _i2c_crc_state = _I2C_CRCUnit_GetResult();
+  return _i2c_crc_state;
+}
+#else
+//calculate CRC, starting with existing _i2c_crc_state
+static uint8_t _I2C_CRC_Accumulate(const uint8_t* buf, uint16_t length) {
+  int i;
+  for (i = 0; i < length; i++) {
+    _i2c_crc_state = _i2c_crc_table[buf[i] ^ _i2c_crc_state];
+  }
+  return _i2c_crc_state;
+}
+
+//copy the given data to the destination buffer and calculate its CRC in the same pass, starting with existing _i2c_crc_state
+static uint8_t _I2C_CRC_Copy(uint8_t* dest, const uint8_t* src, uint16_t length) {
+  int i;
+  uint8_t byte;
+  for (i = 0; i < length; i++) {
+    byte = src[i];
+    dest[i] = byte;
+    _i2c_crc_state = _i2c_crc_table[byte ^ _i2c_crc_state];
+  }
+  return _i2c_crc_state;
+}
+#endif
+
+//build the register lookup map from the register table, checking it against the module's register size definitions
+static HAL_StatusTypeDef _I2C_BuildLookupMap() {
+  static const uint16_t reg_size_map[] = I2C_REG_SIZES;
+  uint16_t i, addr;
+
+  memset(reg_lookup_map, 0, sizeof(reg_lookup_map));
+
+  if (i2c_register_count == 255) {
+    DEBUG_PRINTF("I2C Error: Register table too large\n");
+    return HAL_ERROR;
+  }
+
+  for (i = 0; i < i2c_register_count; i++) {
+    const I2C_Register* reg = i2c_registers + i;
+
+    if (reg->address == 0 || reg->count == 0 || (uint16_t)reg->address + reg->count > 256 || reg->size == 0 || reg->size > I2C_VIRT_BUFFER_SIZE ||
+        ((reg->access & I2C_REG_WRITE) != 0 && reg->write == NULL) || ((reg->access & I2C_REG_READ) != 0 && reg->data == NULL && reg->read == NULL)) {
+      DEBUG_PRINTF("I2C Error: Invalid register table entry at address 0x%02X\n", reg->address);
+      return HAL_ERROR;
+    }
+
+    for (addr = reg->address; addr < (uint16_t)reg->address + reg->count; addr++) {
+      if (reg_lookup_map[addr] != 0 || addr >= sizeof(reg_size_map) / sizeof(reg_size_map[0]) || reg_size_map[addr] != reg->size) {
+        DEBUG_PRINTF("I2C Error: Register table entry for address 0x%02X overlaps or mismatches register definitions\n", addr);
+        return HAL_ERROR;
+      }
+      reg_lookup_map[addr] = (uint8_t)(i + 1);
+    }
+  }
+
+  //all defined registers need to be in the table
+  for (addr = 0; addr < sizeof(reg_size_map) / sizeof(reg_size_map[0]) && addr < 256; addr++) {
+    if (reg_size_map[addr] != 0 && reg_lookup_map[addr] == 0) {
+      DEBUG_PRINTF("I2C Error: Register 0x%02X missing from register table\n", addr);
+      return HAL_ERROR;
+    }
+  }
+
+  return HAL_OK;
+}
+
+//select the register at the given address for the following reads/writes - invalid registers are selected as dummy register 0 with size 1
+static inline void _I2C_SelectRegister(uint8_t address) {
+  uint8_t entry_index = reg_lookup_map[address];
+
+  if (entry_index == 0) {
+    reg_addr = 0;
+    reg_entry = NULL;
+    reg_index = 0;
+    reg_size = 1;
+  } else {
+    reg_addr = address;
+    reg_entry = i2c_registers + (entry_index - 1);
+    reg_index = address - reg_entry->address;
+    reg_size = reg_entry->size;
+  }
+}
+
+/**
+ * called at the start of each register read, prepares the data to be sent, followed by its CRC (continuing from the current CRC state)
+ */
+static void _I2C_PrepareReadData() {
+  if (reg_entry != NULL && (reg_entry->access & I2C_REG_READ) != 0 && reg_entry->data != NULL) {
+    //live data: copy directly from source, calculating the CRC in the same pass
+    _I2C_CRC_Copy(read_buf, (const uint8_t*)reg_entry->data + (uint32_t)reg_index * reg_size, reg_size);
+  } else {
+    memset(read_buf, 0, reg_size);
+    if (reg_entry != NULL && (reg_entry->access & I2C_REG_READ) != 0) {
+      reg_entry->read(reg_entry, reg_index, read_buf);
+    }
+    _I2C_CRC_Accumulate(read_buf, reg_size);
+  }
+
+  read_buf[reg_size] = _i2c_crc_state;
+}
+
+/**
+ * called at the end of each register write, processes the received data
+ */
+static void _I2C_ProcessWriteData() {
+  //DEBUG_PRINTF("I2C write trigger: address 0x%02X; size %u; value 0x%08lX (%f)\n", reg_addr, reg_size, *(uint32_t*)write_buf, *(float*)write_buf);
+
+  if ((reg_entry->access & I2C_REG_WRITE) == 0) {
+    DEBUG_PRINTF("I2C write error: attempted write to non-writable register 0x%02X\n", reg_addr);
+    i2c_err_detected = 1; //attempting to write to read-only register - report error
+    return;
+  }
+
+  reg_entry->write(reg_entry, reg_index, write_buf);
+}
+
+//start sequential slave receive of the given data - larger transfers use DMA (if configured), smaller ones use byte interrupts
+static inline HAL_StatusTypeDef _I2C_SeqReceive(I2C_HandleTypeDef *hi2c, uint8_t* buf, uint16_t size) {
+#ifdef I2C_DMA_MIN_SIZE
+  if (size >= I2C_DMA_MIN_SIZE) {
+    return HAL_I2C_Slave_Seq_Receive_DMA(hi2c, buf, size, I2C_NEXT_FRAME);
+  }
+#endif
+  return HAL_I2C_Slave_Seq_Receive_IT(hi2c, buf, size, I2C_NEXT_FRAME);
+}
+
+//start sequential slave transmit of the given data - larger transfers use DMA (if configured), smaller ones use byte interrupts
+static inline HAL_StatusTypeDef _I2C_SeqTransmit(I2C_HandleTypeDef *hi2c, uint8_t* buf, uint16_t size) {
+#ifdef I2C_DMA_MIN_SIZE
+  if (size >= I2C_DMA_MIN_SIZE) {
+    return HAL_I2C_Slave_Seq_Transmit_DMA(hi2c, buf, size, I2C_NEXT_FRAME);
+  }
+#endif
+  return HAL_I2C_Slave_Seq_Transmit_IT(hi2c, buf, size, I2C_NEXT_FRAME);
+}
+
+static __always_inline void _I2C_ErrorReset() {
+  i2c_err_detected = 1;
+  state = I2C_IDLE;
+  HAL_I2C_EnableListen_IT(&I2C_INSTANCE);
+}
+
+static __always_inline void _I2C_HardwareReset() {
+  __disable_irq();
+  //reset peripheral
+  HAL_I2C_DeInit(&I2C_INSTANCE);
+  I2C_FORCE_RESET();
+  int i;
+  for (i = 0; i < 10; i++) __NOP();
+  I2C_RELEASE_RESET();
+  HAL_I2C_Init(&I2C_INSTANCE);
+  //enable I2C timeouts
+  WRITE_REG(I2C_INSTANCE.Instance->TIMEOUTR, (I2C_SCL_STRETCH_TIMEOUT | I2C_SCL_LOW_TIMEOUT));
+  SET_BIT(I2C_INSTANCE.Instance->TIMEOUTR, (I2C_TIMEOUTR_TEXTEN | I2C_TIMEOUTR_TIMOUTEN));
+  //clear interrupt pin
+  HAL_GPIO_WritePin(I2C_INT_PORT, I2C_INT_PIN, GPIO_PIN_SET);
+  //reset loop counters
+  idle_busy_count = 0;
+  non_idle_timeout = 0;
+  __enable_irq();
+}
+
+
+void HAL_I2C_ListenCpltCallback(I2C_HandleTypeDef *hi2c) {
+  state = I2C_IDLE;
+  HAL_I2C_EnableListen_IT(hi2c);
+}
+
+void HAL_I2C_AddrCallback(I2C_HandleTypeDef *hi2c, uint8_t TransferDirection, uint16_t AddrMatchCode) {
+  if (TransferDirection == I2C_DIRECTION_TRANSMIT) {
+    if (state != I2C_UNINIT) { //write transmission: start with register address, with potential write data afterwards
+      state = I2C_WAITING_ADDR;
+      non_idle_timeout = I2C_NONIDLE_TIMEOUT;
+
+      HAL_I2C_Slave_Seq_Receive_IT(hi2c, &reg_addr, 1, I2C_FIRST_FRAME);
+    } else {
+      DEBUG_PRINTF("I2C Error: Transmit request in invalid state %u\n", state);
+      _I2C_HardwareReset();
+      _I2C_ErrorReset();
+    }
+  } else {
+    if (state == I2C_ADDR_RECEIVED) { //read transmission: only supported after address write
+      state = I2C_READ;
+      non_idle_timeout = I2C_NONIDLE_TIMEOUT;
+
+      //first register read after address: include I2C address and register address bytes in CRC
+      uint8_t read_crc_buf[3] = { I2C_OWN_ADDRESS_WRITE, reg_addr, I2C_OWN_ADDRESS_READ };
+      _i2c_crc_state = 0;
+      _I2C_CRC_Accumulate(read_crc_buf, 3);
+      _I2C_PrepareReadData();
+
+      if (_I2C_SeqTransmit(hi2c, read_buf, reg_size + 1) != HAL_OK) {
+        DEBUG_PRINTF("I2C Error: Read start fail, address 0x%02X\n", reg_addr);
+        _I2C_HardwareReset();
+        _I2C_ErrorReset();
+      }
+    } else {
+      DEBUG_PRINTF("I2C Error: Receive request in invalid state %u\n", state);
+      _I2C_HardwareReset();
+      _I2C_ErrorReset();
+    }
+  }
+}
+
+void HAL_I2C_SlaveTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  //always allow more reads, to avoid I2C bus freezing
+
+  non_idle_timeout = I2C_NONIDLE_TIMEOUT;
+
+  //we're at register 0 (invalid): always continue as invalid - otherwise look at next register to potentially continue with valid read operations
+  _I2C_SelectRegister(reg_addr == 0 ? 0 : reg_addr + 1);
+
+  //subsequent chained register read: only include data itself in CRC
+  _i2c_crc_state = 0;
+  _I2C_PrepareReadData();
+
+  if (_I2C_SeqTransmit(hi2c, read_buf, reg_size + 1) != HAL_OK) {
+    DEBUG_PRINTF("I2C Error: Sequential read start fail, address 0x%02X\n", reg_addr);
+    _I2C_HardwareReset();
+    _I2C_ErrorReset();
+  }
+}
+
+void HAL_I2C_SlaveRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  if (state == I2C_WAITING_ADDR) { //received data is the address
+    state = I2C_ADDR_RECEIVED;
+    non_idle_timeout = I2C_NONIDLE_TIMEOUT;
+
+    uint8_t address = reg_addr;
+    _I2C_SelectRegister(address);
+    if (reg_entry == NULL) { //invalid register address: accept/send dummy bytes
+      DEBUG_PRINTF("I2C Error: Attempted access of invalid address 0x%02X\n", address);
+      i2c_err_detected = 1;
+    }
+
+    //read data is only prepared once a read actually follows - prepare to receive write data immediately
+    if (_I2C_SeqReceive(hi2c, write_buf, reg_size + 1) != HAL_OK) {
+      DEBUG_PRINTF("I2C Error: Write start fail, address 0x%02X\n", reg_addr);
+      _I2C_HardwareReset();
+      _I2C_ErrorReset();
+    }
+  } else if (state == I2C_ADDR_RECEIVED || state == I2C_WRITE) { //received data is the data to be written: process it and prepare to accept more data (always to prevent freeze)
+    _I2C_State prev_state = state;
+    state = I2C_WRITE;
+    non_idle_timeout = I2C_NONIDLE_TIMEOUT;
+
+    if (reg_entry != NULL) { //register valid: calculate and check CRC before processing
+      _i2c_crc_state = 0;
+      if (prev_state == I2C_ADDR_RECEIVED) {
+        //first register after address: include I2C address and register address in CRC
+        uint8_t write_crc_init_buf[2] = { I2C_OWN_ADDRESS_WRITE, reg_addr };
+        _I2C_CRC_Accumulate(write_crc_init_buf, 2);
+      }
+
+      uint8_t crc_check = _I2C_CRC_Accumulate(write_buf, reg_size + 1);
+      if (crc_check == 0) {
+        //good CRC: process data
+        _I2C_ProcessWriteData();
+      } else {
+        //wrong CRC: report error and ignore data
+        DEBUG_PRINTF("I2C CRC mismatch on write of register 0x%02X\n", reg_addr);
+        i2c_err_detected = 1;
+      }
+    }
+
+    //register invalid: continue as invalid - otherwise continue with next register (accepting dummy data if that is invalid)
+    _I2C_SelectRegister(reg_addr == 0 ? 0 : reg_addr + 1);
+
+    if (_I2C_SeqReceive(hi2c, write_buf, reg_size + 1) != HAL_OK) {
+      DEBUG_PRINTF("I2C Error: Sequential write start fail, address 0x%02X\n", reg_addr);
+      _I2C_HardwareReset();
+      _I2C_ErrorReset();
+    }
+  } else { //ignore data received in idle or other states
+    state = I2C_IDLE;
+  }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+  uint32_t error_code = HAL_I2C_GetError(hi2c);
+
+  //if error is not an expected AF: indicate error
+  if (error_code != HAL_I2C_ERROR_AF) {
+    DEBUG_PRINTF("I2C Error: HAL error 0x%02lX\n", error_code);
+    _I2C_HardwareReset();
+    _I2C_ErrorReset();
+  }
+
+  //go back to idle state
+  state = I2C_IDLE;
+}
+
+
+void I2C_TimeoutISR() {
+  DEBUG_PRINTF("I2C Error: Timeout\n");
+  _I2C_HardwareReset();
+  _I2C_ErrorReset();
+}
+
+HAL_StatusTypeDef I2C_Init() {
+  //build and check register lookup
+  ReturnOnError(_I2C_BuildLookupMap());
+
+  //reset interrupt and error state
+  interrupts_enabled = 0;
+  interrupt_mask = 0;
+  interrupt_flags = I2C_INT_RESET_Msk;
+  i2c_err_detected = 0;
+  non_idle_timeout = 0;
+  idle_busy_count = 0;
+
+#if defined(I2C_CRC_POLYNOMIAL) && !defined(I2C_CRC_UNIT_EMULATED)
+  //set up hardware CRC unit for I2C CRC-8
+  __HAL_RCC_CRC_CLK_ENABLE();
+  CRC->POL = I2C_CRC_POLYNOMIAL;
+  CRC->CR = I2C_CRC_CR_CONFIG | CRC_CR_RESET;
+#endif
+
+  //perform hardware reset
+  _I2C_HardwareReset();
+
+  //enable I2C listening
+  ReturnOnError(HAL_I2C_EnableListen_IT(&I2C_INSTANCE));
+
+  //reset internal state
+  state = I2C_IDLE;
+
+  //update interrupt pin for init interrupt
+  _I2C_UpdateInterruptPin();
+
+  return HAL_OK;
+}
+
+void I2C_TriggerInterrupt(uint8_t interrupt_bit) {
+  interrupt_flags |= interrupt_bit; //set flag
+  _I2C_UpdateInterruptPin();
+}
+
+void I2C_LoopUpdate() {
+  if (state == I2C_IDLE && __HAL_I2C_GET_FLAG(&I2C_INSTANCE, I2C_FLAG_BUSY) == SET) { //driver idle but peripheral busy: check timeout
+    if (++idle_busy_count > I2C_PERIPHERAL_BUSY_TIMEOUT) { //peripheral busy for too long, reset
+      DEBUG_PRINTF("I2C Error: Peripheral busy in idle state timeout\n");
+      _I2C_HardwareReset();
+      _I2C_ErrorReset();
+    }
+  } else {
+    idle_busy_count = 0;
+  }
+
+  __disable_irq();
+  if (non_idle_timeout > 0) { //handle non-idle state timeouts
+    if (state == I2C_IDLE || state == I2C_UNINIT) { //reset timeout if idle
+      non_idle_timeout = 0;
+    } else {
+      if (--non_idle_timeout == 0) { //timed out: error
+        __enable_irq();
+        DEBUG_PRINTF("I2C Error: Non-idle state timed out\n");
+        _I2C_HardwareReset();
+        _I2C_ErrorReset();
+      }
+    }
+  }
+  __enable_irq();
+}
+
+
+void I2C_ReportError() {
+  i2c_err_detected = 1;
+}
+
+bool I2C_GetAndResetError() {
+  bool error = i2c_err_detected != 0;
+  i2c_err_detected = 0;
+  return error;
+}
+
+bool I2C_GetInterruptsEnabled() {
+  return interrupts_enabled != 0;
+}
+
+void I2C_SetInterruptsEnabled(bool enabled) {
+  interrupts_enabled = enabled ? 1 : 0;
+  _I2C_UpdateInterruptPin();
+}
+
+void I2C_ReadInterruptMask(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] = interrupt_mask;
+}
+
+void I2C_WriteInterruptMask(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  interrupt_mask = buf[0];
+  _I2C_UpdateInterruptPin();
+}
+
+void I2C_ReadInterruptFlags(const I2C_Register* reg, uint8_t index, uint8_t* buf) {
+  buf[0] = interrupt_flags;
+}
+
+void I2C_WriteInterruptFlags(const I2C_Register* reg, uint8_t index, const uint8_t* buf) {
+  interrupt_flags &= buf[0]; //clear bits received as 0
+  _I2C_UpdateInterruptPin();
+}
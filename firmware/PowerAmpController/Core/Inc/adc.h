@@ -19,6 +19,14 @@
 //4x batch size because the buffer holds two batches of two channels
 #define P_ADC_DMA_BUFFER_SIZE (4 * P_ADC_SAMPLE_BATCH_SIZE)
 
+//raw ADC code corresponding to zero current (mid-scale, equal to the offset of the current channels) - analog watchdog comparisons happen on raw codes before offset
+#define P_ADC_CURRENT_ZERO_CODE 2048
+//ADC channels of the current measurements, monitored by the analog watchdogs: A/B on ADC1, C/D on ADC3
+#define P_ADC_CURRENT_CHANNEL_A ADC_CHANNEL_1
+#define P_ADC_CURRENT_CHANNEL_B ADC_CHANNEL_2
+#define P_ADC_CURRENT_CHANNEL_C ADC_CHANNEL_1
+#define P_ADC_CURRENT_CHANNEL_D ADC_CHANNEL_5
+
 #ifdef MAIN_FOUR_CHANNEL
 //select first channel of each pair - scaled by 0.5 due to Q15 range limits
 #define P_ADC_PROCESSING_VECTOR_AC { 0x4000, 0x0000 }
@@ -31,6 +39,12 @@
 #define P_ADC_CURRENT_PROCESSING_VECTOR { 0x4000, 0x0000 }
 #endif
 
+//uncomment to check the fused processing kernel against the original multi-pass CMSIS-DSP processing on every batch (debug only, slow)
+#undef P_ADC_KERNEL_CHECK
+//#define P_ADC_KERNEL_CHECK
+//maximum allowed deviation of the (fractional) average power in the kernel check, covers rounding of the per-sample products in the reference
+#define P_ADC_KERNEL_CHECK_POWER_TOLERANCE (2.0f / 32768.0f)
+
 //conversion factor between float format and (integer form of) 34.30 fixed-point format
 #define P_ADC_3430_CONV_FACTOR 1073741824.0f
 //divisor for fixed-point to floating-point sum-of-squares averaging (given sum-of-squares in 34.30 format)
@@ -83,6 +97,9 @@ extern float rms_voltage_inst[4];
 extern float rms_current_inst[4];
 extern float avg_real_power_inst[4];
 extern float avg_apparent_power_inst[4];
+//peak absolute voltage and current in the last batch - in V and A
+extern float peak_voltage_inst[4];
+extern float peak_current_inst[4];
 //averaged using EMA: 0s1 = 0.1s time constant, 1s0 = 1.0s time constant
 extern float rms_voltage_0s1[4];
 extern float rms_voltage_1s0[4];
@@ -99,5 +116,10 @@ HAL_StatusTypeDef ADC_Calibrate();
 
 HAL_StatusTypeDef ADC_StartMonitoring();
 
+/**
+ * (re-)enable the current analog watchdog interrupts - each watchdog disables its interrupt when triggered
+ */
+void ADC_ArmCurrentWatchdogs();
+
 
 #endif /* INC_ADC_H_ */
@@ -13,6 +13,10 @@
 #include "i2c_defines_poweramp.h"
 
 
+//register size definitions (checked against the register table on init), and interrupt flag that is always signalled on the interrupt pin
+#define I2C_REG_SIZES I2CDEF_POWERAMP_REG_SIZES
+#define I2C_INT_RESET_Msk I2CDEF_POWERAMP_INT_FLAGS_INT_RESET_Msk
+
 //size of virtual read/write buffers, in bytes - equals maximum virtual register size
 #define I2C_VIRT_BUFFER_SIZE 4
 
@@ -40,6 +44,9 @@
 #define I2C_PERIPHERAL_BUSY_TIMEOUT 20
 #endif
 
+//minimum transfer size (including CRC) for which DMA is used instead of byte interrupts
+#define I2C_DMA_MIN_SIZE 16
+
 //I2C instance to use
 #define I2C_INSTANCE hi2c3
 #define I2C_INT_PORT I2C3_INT_N_GPIO_Port
@@ -48,11 +55,8 @@
 #define I2C_RELEASE_RESET() __HAL_RCC_I2C3_RELEASE_RESET()
 
 
-HAL_StatusTypeDef I2C_Init();
-void I2C_TriggerInterrupt(uint8_t interrupt_bit);
-void I2C_LoopUpdate();
-
-void I2C_TimeoutISR();
+//register engine (after configuration above)
+#include "i2c_slave.h"
 
 
 #endif /* INC_I2C_H_ */
@@ -48,12 +48,21 @@
  *    - 0xB0: SAFETY_STATUS: Status of safety system (1B, bit field, r)
  *    - 0xB1: SERR_SOURCE: Indication of error source (2B, bit field, r)
  *    - 0xB2: SWARN_SOURCE: Indication of warning source (2B, bit field, r)
+ *  * Speaker model registers - parameter writes only permitted during manual shutdown
+ *    - 0xC0-0xC3: SPK_TEMP_[A-D]: Channel A-D modelled voice coil temperature rise above ambient in K (each 4B, float little endian, r)
+ *    - 0xC4-0xC7: SPK_GRED_[A-D]: Channel A-D requested gain reduction in dB, 0 or negative (each 4B, float little endian, r)
+ *    - 0xC8-0xCB: SPK_RTH_COIL_[A-D]: Channel A-D voice coil thermal resistance in K/W (each 4B, float little endian, rw)
+ *    - 0xCC-0xCF: SPK_TAU_COIL_[A-D]: Channel A-D voice coil thermal time constant in s (each 4B, float little endian, rw)
+ *    - 0xD0-0xD3: SPK_RTH_MAG_[A-D]: Channel A-D magnet/frame thermal resistance in K/W (each 4B, float little endian, rw)
+ *    - 0xD4-0xD7: SPK_TAU_MAG_[A-D]: Channel A-D magnet/frame thermal time constant in s (each 4B, float little endian, rw)
+ *    - 0xD8-0xDB: SPK_TMAX_[A-D]: Channel A-D maximum voice coil temperature rise in K, infinity to disable gain reduction (each 4B, float little endian, rw)
  *  * Misc registers
  *    - 0xFF: MODULE_ID: Module ID (1B, hex, r)
  *
  *  Bit field definitions:
  *  * STATUS (0x01, 2B):
  *    - 15: I2CERR: I2C communication error detected since last STATUS read
+ *    - 10: SPK_LIM: speaker model requests gain reduction on any channel
  *    - 9: OTW_DET: likely overtemperature warning detected (based on amp clip/otw pin behaviour)
  *    - 8: CLIP_DET: likely clipping detected (based on amp clip/otw pin behaviour)
  *    - 7: SWARN: safety warning active (any)
@@ -83,7 +92,7 @@
  *    - 1: MAN_SD: manual shutdown active
  *    - 0: SERR_SD: safety shutdown active
  *  * SERR_SOURCE (0xB1, 2B):
- *    - 13-5: MTYPE: source measurement type (one-hot, high to low: IRMS inst/fast/slow, PAVG inst/fast/slow, PAPP inst/fast/slow)
+ *    - 14-5: MTYPE: source measurement type (one-hot, high to low: IPEAK (hardware fast path, errors only), IRMS inst/fast/slow, PAVG inst/fast/slow, PAPP inst/fast/slow)
  *    - 4-0: CHAN: source channel (one-hot, high to low: A,B,C,D,Sum)
  *  * SWARN_SOURCE (0xB2, 2B):
  *    same layout as SERR_SOURCE
@@ -107,8 +116,8 @@
   4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0,\
   4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0,\
   1, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,\
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0,\
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }
 
@@ -136,6 +145,8 @@
 #define I2CDEF_POWERAMP_STATUS_CLIP_DET_Msk (0x1 << I2CDEF_POWERAMP_STATUS_CLIP_DET_Pos)
 #define I2CDEF_POWERAMP_STATUS_OTW_DET_Pos 9
 #define I2CDEF_POWERAMP_STATUS_OTW_DET_Msk (0x1 << I2CDEF_POWERAMP_STATUS_OTW_DET_Pos)
+#define I2CDEF_POWERAMP_STATUS_SPK_LIM_Pos 10
+#define I2CDEF_POWERAMP_STATUS_SPK_LIM_Msk (0x1 << I2CDEF_POWERAMP_STATUS_SPK_LIM_Pos)
 #define I2CDEF_POWERAMP_STATUS_I2CERR_Pos 15
 #define I2CDEF_POWERAMP_STATUS_I2CERR_Msk (0x1 << I2CDEF_POWERAMP_STATUS_I2CERR_Pos)
 
@@ -366,7 +377,8 @@
 #define I2CDEF_POWERAMP_SERR_SOURCE_CHAN_D (0x02 << I2CDEF_POWERAMP_SERR_SOURCE_CHAN_Pos)
 #define I2CDEF_POWERAMP_SERR_SOURCE_CHAN_SUM (0x01 << I2CDEF_POWERAMP_SERR_SOURCE_CHAN_Pos)
 #define I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos 5
-#define I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Msk (0x1FF << I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos)
+#define I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Msk (0x3FF << I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos)
+#define I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IPEAK (0x200 << I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos)
 #define I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IRMS_INST (0x100 << I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos)
 #define I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IRMS_FAST (0x080 << I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos)
 #define I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IRMS_SLOW (0x040 << I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos)
@@ -388,6 +400,7 @@
 #define I2CDEF_POWERAMP_SWARN_SOURCE_CHAN_SUM I2CDEF_POWERAMP_SERR_SOURCE_CHAN_SUM
 #define I2CDEF_POWERAMP_SWARN_SOURCE_MTYPE_Pos I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Pos
 #define I2CDEF_POWERAMP_SWARN_SOURCE_MTYPE_Msk I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_Msk
+#define I2CDEF_POWERAMP_SWARN_SOURCE_MTYPE_IPEAK I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IPEAK
 #define I2CDEF_POWERAMP_SWARN_SOURCE_MTYPE_IRMS_INST I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IRMS_INST
 #define I2CDEF_POWERAMP_SWARN_SOURCE_MTYPE_IRMS_FAST I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IRMS_FAST
 #define I2CDEF_POWERAMP_SWARN_SOURCE_MTYPE_IRMS_SLOW I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IRMS_SLOW
@@ -399,6 +412,43 @@
 #define I2CDEF_POWERAMP_SWARN_SOURCE_MTYPE_PAPP_SLOW I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_PAPP_SLOW
 
 
+//Speaker model registers
+#define I2CDEF_POWERAMP_SPK_TEMP_A 0xC0
+#define I2CDEF_POWERAMP_SPK_TEMP_B 0xC1
+#define I2CDEF_POWERAMP_SPK_TEMP_C 0xC2
+#define I2CDEF_POWERAMP_SPK_TEMP_D 0xC3
+
+#define I2CDEF_POWERAMP_SPK_GRED_A 0xC4
+#define I2CDEF_POWERAMP_SPK_GRED_B 0xC5
+#define I2CDEF_POWERAMP_SPK_GRED_C 0xC6
+#define I2CDEF_POWERAMP_SPK_GRED_D 0xC7
+
+#define I2CDEF_POWERAMP_SPK_RTH_COIL_A 0xC8
+#define I2CDEF_POWERAMP_SPK_RTH_COIL_B 0xC9
+#define I2CDEF_POWERAMP_SPK_RTH_COIL_C 0xCA
+#define I2CDEF_POWERAMP_SPK_RTH_COIL_D 0xCB
+
+#define I2CDEF_POWERAMP_SPK_TAU_COIL_A 0xCC
+#define I2CDEF_POWERAMP_SPK_TAU_COIL_B 0xCD
+#define I2CDEF_POWERAMP_SPK_TAU_COIL_C 0xCE
+#define I2CDEF_POWERAMP_SPK_TAU_COIL_D 0xCF
+
+#define I2CDEF_POWERAMP_SPK_RTH_MAG_A 0xD0
+#define I2CDEF_POWERAMP_SPK_RTH_MAG_B 0xD1
+#define I2CDEF_POWERAMP_SPK_RTH_MAG_C 0xD2
+#define I2CDEF_POWERAMP_SPK_RTH_MAG_D 0xD3
+
+#define I2CDEF_POWERAMP_SPK_TAU_MAG_A 0xD4
+#define I2CDEF_POWERAMP_SPK_TAU_MAG_B 0xD5
+#define I2CDEF_POWERAMP_SPK_TAU_MAG_C 0xD6
+#define I2CDEF_POWERAMP_SPK_TAU_MAG_D 0xD7
+
+#define I2CDEF_POWERAMP_SPK_TMAX_A 0xD8
+#define I2CDEF_POWERAMP_SPK_TMAX_B 0xD9
+#define I2CDEF_POWERAMP_SPK_TMAX_C 0xDA
+#define I2CDEF_POWERAMP_SPK_TMAX_D 0xDB
+
+
 //Misc registers
 #define I2CDEF_POWERAMP_MODULE_ID 0xFF
 #define I2CDEF_POWERAMP_MODULE_ID_VALUE 0xA1
@@ -24,6 +24,10 @@
 #define SAFETY_LIMIT_MAX_APPARENT_POWER_0S1 { INFINITY, INFINITY, INFINITY, INFINITY, INFINITY }
 #define SAFETY_LIMIT_MAX_APPARENT_POWER_1S0 { INFINITY, INFINITY, INFINITY, INFINITY, INFINITY }
 
+//absolute peak current limit per channel, enforced in hardware by the ADC analog watchdogs on every sample (fast path, independent of batch processing)
+//set above the instantaneous RMS limits to leave headroom for regular signal peaks
+#define SAFETY_LIMIT_MAX_CURRENT_PEAK 25.0f
+
 //default value for warning thresholds - warnings disabled by default
 #define SAFETY_NO_WARN { INFINITY, INFINITY, INFINITY, INFINITY, INFINITY }
 
@@ -86,6 +90,12 @@ extern uint16_t safety_warn_status_loop;
  */
 void SAFETY_SetManualShutdown(uint8_t shutdown);
 
+/**
+ * immediate safety shutdown due to a current peak detected by the ADC analog watchdogs - called from ADC interrupt
+ * channel: 0 = A, ..., 3 = D
+ */
+void SAFETY_TriggerPeakCurrentShutdown(uint8_t channel);
+
 /**
  * check instantaneous (last batch) measurements for safety - called after every ADC batch
  */
@@ -0,0 +1,68 @@
+/*
+ * speaker_model.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ *
+ *  Real-time voice coil thermal model of the connected speakers, driven by the measured output power per channel.
+ *  Produces a per-channel gain reduction request once the modelled temperature rise approaches its maximum.
+ */
+
+#ifndef INC_SPEAKER_MODEL_H_
+#define INC_SPEAKER_MODEL_H_
+
+#include "main.h"
+#include <math.h>
+#include "adc.h"
+
+//length of an ADC processing batch in seconds (see adc.h) - model integration step
+#define SPKM_BATCH_TIME (P_ADC_SAMPLE_BATCH_SIZE * 2.0f * (61.5f + 12.5f) / 18000000.0f)
+
+//fraction of the maximum temperature rise at which gain reduction starts
+#define SPKM_LIMIT_KNEE 0.8f
+//gain reduction in dB at the maximum temperature rise - increases proportionally between knee and max (and beyond)
+#define SPKM_GAIN_RED_AT_MAX_DB -6.0f
+//largest gain reduction in dB that will be requested
+#define SPKM_GAIN_RED_LIMIT_DB -20.0f
+
+//default model parameters: model disabled until configured (infinite max temperature rise)
+#define SPKM_DEFAULT_RTH_COIL 1.0f
+#define SPKM_DEFAULT_TAU_COIL 10.0f
+#define SPKM_DEFAULT_RTH_MAGNET 1.0f
+#define SPKM_DEFAULT_TAU_MAGNET 600.0f
+#define SPKM_DEFAULT_MAX_TEMP_RISE INFINITY
+
+//maximum accepted thermal time constant in seconds
+#define SPKM_MAX_TAU 10000.0f
+
+
+//model parameters per channel (A-D), two-time-constant thermal network (coil and magnet/frame stages in series)
+//thermal resistances in K/W, time constants in s, max temperature rise in K - only writable during manual shutdown
+extern float spkm_rth_coil[4];
+extern float spkm_tau_coil[4];
+extern float spkm_rth_magnet[4];
+extern float spkm_tau_magnet[4];
+extern float spkm_max_temp_rise[4];
+
+//DO NOT SET THESE DIRECTLY - READ ONLY
+//modelled voice coil temperature rise above ambient per channel, in K
+extern float spkm_temp_rise[4];
+//requested gain reduction per channel, in dB (0 = no reduction, negative = reduction)
+extern float spkm_gain_reduction_dB[4];
+//1 = gain reduction requested on any channel
+extern uint8_t spkm_limit_active;
+
+
+HAL_StatusTypeDef SPKM_Init();
+
+//update the model parameters of one channel - must be called for every parameter change, to update the derived coefficients
+//param_index: 0 = coil Rth, 1 = coil tau, 2 = magnet Rth, 3 = magnet tau, 4 = max temperature rise
+HAL_StatusTypeDef SPKM_SetParameter(uint8_t param_index, uint8_t channel, float value);
+
+//advance the thermal model of the given channel by one ADC batch with the given average real power (in W) - called from ADC processing
+void SPKM_ProcessBatch(uint8_t channel, float power);
+
+void SPKM_LoopUpdate();
+
+
+#endif /* INC_SPEAKER_MODEL_H_ */
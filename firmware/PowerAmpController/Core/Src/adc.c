@@ -7,8 +7,10 @@
 
 #include "adc.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include "arm_math.h"
 #include "safety.h"
+#include "speaker_model.h"
 
 //raw DMA buffers - with the given DMA configuration, samples end up arranged as {A1, B1, A2, B2, ...} and {C1, D1, C2, D2, ...}, respectively
 static q15_t dma_current_AB[P_ADC_DMA_BUFFER_SIZE];
@@ -16,6 +18,7 @@ static q15_t dma_voltage_AB[P_ADC_DMA_BUFFER_SIZE];
 static q15_t dma_current_CD[P_ADC_DMA_BUFFER_SIZE];
 static q15_t dma_voltage_CD[P_ADC_DMA_BUFFER_SIZE];
 
+#ifdef P_ADC_KERNEL_CHECK
 //matrix representations of the above buffers (two columns, one per channel) - separate matrix for each buffer half, as processing is separate
 static arm_matrix_instance_q15 mat_current_AB_first = {P_ADC_SAMPLE_BATCH_SIZE, 2, dma_current_AB};
 static arm_matrix_instance_q15 mat_current_AB_second = {P_ADC_SAMPLE_BATCH_SIZE, 2, dma_current_AB + (P_ADC_DMA_BUFFER_SIZE / 2)};
@@ -35,6 +38,16 @@ static const q15_t processing_vector_BD[] = P_ADC_PROCESSING_VECTOR_BD;
 static const q15_t processing_vector_current[] = P_ADC_CURRENT_PROCESSING_VECTOR;
 static const q15_t processing_vector_voltage[] = P_ADC_VOLTAGE_PROCESSING_VECTOR;
 #endif
+#endif
+
+//per-batch results of the fused processing kernel for one ADC pair (index 0 = channel A/C, 1 = channel B/D; 2-channel mode only uses index 0)
+typedef struct {
+  q63_t sos_current[2]; //sums of squares of (scaled) current samples, in 34.30 format
+  q63_t sos_voltage[2]; //sums of squares of (scaled) voltage samples, in 34.30 format
+  q63_t sum_power[2]; //sums of instantaneous power (scaled voltage * scaled current), in 34.30 format
+  q31_t peak_current[2]; //peak absolute (scaled) current sample, in Q15 format
+  q31_t peak_voltage[2]; //peak absolute (scaled) voltage sample, in Q15 format
+} _ADC_BatchSums;
 
 //rms voltage and current, average real power, and average apparent power of all channels (A, B, C, D) - in V, A, and W, respectively
 //last batch values ("instantaneous")
@@ -42,6 +55,9 @@ float rms_voltage_inst[4] = { 0 };
 float rms_current_inst[4] = { 0 };
 float avg_real_power_inst[4] = { 0 };
 float avg_apparent_power_inst[4] = { 0 };
+//peak absolute voltage and current of all channels in the last batch - in V and A
+float peak_voltage_inst[4] = { 0 };
+float peak_current_inst[4] = { 0 };
 //averaged using EMA: 0s1 = 0.1s time constant, 1s0 = 1.0s time constant, mos = mean of squares (for calculating rms, not scaled yet)
 static float raw_mos_voltage_0s1[4] = { 0 };
 static float raw_mos_voltage_1s0[4] = { 0 };
@@ -68,7 +84,33 @@ HAL_StatusTypeDef ADC_Calibrate() {
   return HAL_ADCEx_Calibration_Start(&hadc4, ADC_SINGLE_ENDED);
 }
 
+//configure the given analog watchdog of the given ADC to monitor one current channel, triggering outside of +-max_current
+static HAL_StatusTypeDef _ADC_ConfigCurrentWatchdog(ADC_HandleTypeDef* hadc, uint32_t watchdog, uint32_t channel, float max_current, float conv_fact_i) {
+  ADC_AnalogWDGConfTypeDef config = { 0 };
+
+  //convert current to raw code deviation from zero: current = (code - zero) / 4096 * conv_fact_i
+  int32_t delta = (int32_t)(max_current / conv_fact_i * 4096.0f);
+  int32_t high = P_ADC_CURRENT_ZERO_CODE + delta;
+  int32_t low = P_ADC_CURRENT_ZERO_CODE - delta;
+
+  config.WatchdogNumber = watchdog;
+  config.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+  config.Channel = channel;
+  config.ITMode = ENABLE;
+  config.HighThreshold = high > 4095 ? 4095 : (uint32_t)high;
+  config.LowThreshold = low < 0 ? 0 : (uint32_t)low;
+  return HAL_ADC_AnalogWDGConfig(hadc, &config);
+}
+
 HAL_StatusTypeDef ADC_StartMonitoring() {
+  //set up current analog watchdogs (hardware fast path for overcurrent shutdown) - must be done before conversions start
+  ReturnOnError(_ADC_ConfigCurrentWatchdog(&hadc1, ADC_ANALOGWATCHDOG_1, P_ADC_CURRENT_CHANNEL_A, SAFETY_LIMIT_MAX_CURRENT_PEAK, P_ADC_FACTOR_IA));
+  ReturnOnError(_ADC_ConfigCurrentWatchdog(&hadc3, ADC_ANALOGWATCHDOG_1, P_ADC_CURRENT_CHANNEL_C, SAFETY_LIMIT_MAX_CURRENT_PEAK, P_ADC_FACTOR_IC));
+#ifdef MAIN_FOUR_CHANNEL
+  ReturnOnError(_ADC_ConfigCurrentWatchdog(&hadc1, ADC_ANALOGWATCHDOG_2, P_ADC_CURRENT_CHANNEL_B, SAFETY_LIMIT_MAX_CURRENT_PEAK, P_ADC_FACTOR_IB));
+  ReturnOnError(_ADC_ConfigCurrentWatchdog(&hadc3, ADC_ANALOGWATCHDOG_2, P_ADC_CURRENT_CHANNEL_D, SAFETY_LIMIT_MAX_CURRENT_PEAK, P_ADC_FACTOR_ID));
+#endif
+
   //enable dual mode: ADC1, ADC2 (channel A+B current and voltage)
   ReturnOnError(HAL_ADC_Start(&hadc2)); //start slave (ADC2)
   SET_BIT(hadc2.Instance->CFGR, ADC_CFGR_DMAEN); //enable DMA transfer for slave (ADC2)
@@ -85,25 +127,154 @@ HAL_StatusTypeDef ADC_StartMonitoring() {
 }
 
 /**
- * data processing function (DMA to raw data)
- * index: 0 = channels A+B, 1 = channels C+D
- * half: 0 = first half of buffer, 1 = second half of buffer
+ * fused processing kernel: extracts current and voltage samples from the raw DMA data (same scaling as the processing vectors),
+ * and accumulates sums of squares, power sums and peak values in a single pass over the batch
  */
-void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
-  arm_matrix_instance_q15* current_matrix;
-  arm_matrix_instance_q15* voltage_matrix;
+static void _ADC_ProcessBatch(const q15_t* src_current, const q15_t* src_voltage, _ADC_BatchSums* sums) {
+  int i;
+
+#ifdef MAIN_FOUR_CHANNEL
+  q63_t sos_current_1 = 0, sos_current_2 = 0, sos_voltage_1 = 0, sos_voltage_2 = 0, sum_power_1 = 0, sum_power_2 = 0;
+  q31_t peak_current_1 = 0, peak_current_2 = 0, peak_voltage_1 = 0, peak_voltage_2 = 0;
+
+  for (i = 0; i < P_ADC_SAMPLE_BATCH_SIZE; i++) {
+    //load sample pairs {first, second}, halve both channels at once (scaling by 0.5 as in the processing vectors)
+    q31_t current_pair = __SHADD16(read_q15x2_ia(&src_current), 0);
+    q31_t voltage_pair = __SHADD16(read_q15x2_ia(&src_voltage), 0);
+    q31_t current_1 = (q15_t)current_pair;
+    q31_t current_2 = current_pair >> 16;
+    q31_t voltage_1 = (q15_t)voltage_pair;
+    q31_t voltage_2 = voltage_pair >> 16;
+
+    //accumulate squares and products
+    sos_current_1 += current_1 * current_1;
+    sos_current_2 += current_2 * current_2;
+    sos_voltage_1 += voltage_1 * voltage_1;
+    sos_voltage_2 += voltage_2 * voltage_2;
+    sum_power_1 += voltage_1 * current_1;
+    sum_power_2 += voltage_2 * current_2;
+
+    //track peaks
+    current_1 = abs(current_1);
+    current_2 = abs(current_2);
+    voltage_1 = abs(voltage_1);
+    voltage_2 = abs(voltage_2);
+    if (current_1 > peak_current_1) peak_current_1 = current_1;
+    if (current_2 > peak_current_2) peak_current_2 = current_2;
+    if (voltage_1 > peak_voltage_1) peak_voltage_1 = voltage_1;
+    if (voltage_2 > peak_voltage_2) peak_voltage_2 = voltage_2;
+  }
+
+  sums->sos_current[0] = sos_current_1;
+  sums->sos_current[1] = sos_current_2;
+  sums->sos_voltage[0] = sos_voltage_1;
+  sums->sos_voltage[1] = sos_voltage_2;
+  sums->sum_power[0] = sum_power_1;
+  sums->sum_power[1] = sum_power_2;
+  sums->peak_current[0] = peak_current_1;
+  sums->peak_current[1] = peak_current_2;
+  sums->peak_voltage[0] = peak_voltage_1;
+  sums->peak_voltage[1] = peak_voltage_2;
+#else
+  q63_t sos_current = 0, sos_voltage = 0, sum_power = 0;
+  q31_t peak_current = 0, peak_voltage = 0;
+
+  //two samples per iteration, so squares and products can use dual 16-bit MACs
+  for (i = 0; i < P_ADC_SAMPLE_BATCH_SIZE / 2; i++) {
+    //load two sample pairs {first, second} of each buffer
+    q31_t raw_current_a = read_q15x2_ia(&src_current);
+    q31_t raw_current_b = read_q15x2_ia(&src_current);
+    q31_t raw_voltage_a = read_q15x2_ia(&src_voltage);
+    q31_t raw_voltage_b = read_q15x2_ia(&src_voltage);
+
+    //current = first / 2, voltage = (first - second) / 2 - same as the processing vectors
+    //(SMUSD result is returned as unsigned, so it needs a signed cast for an arithmetic shift)
+    q31_t current_a = (q15_t)raw_current_a >> 1;
+    q31_t current_b = (q15_t)raw_current_b >> 1;
+    q31_t voltage_a = (q31_t)__SMUSD(raw_voltage_a, 0x00010001) >> 1;
+    q31_t voltage_b = (q31_t)__SMUSD(raw_voltage_b, 0x00010001) >> 1;
 
-  //intermediate buffers for raw values
+    //pack both samples and accumulate squares and products
+    q31_t current_pair = __PKHBT(current_a, current_b, 16);
+    q31_t voltage_pair = __PKHBT(voltage_a, voltage_b, 16);
+    sos_current = __SMLALD(current_pair, current_pair, sos_current);
+    sos_voltage = __SMLALD(voltage_pair, voltage_pair, sos_voltage);
+    sum_power = __SMLALD(voltage_pair, current_pair, sum_power);
+
+    //track peaks
+    current_a = abs(current_a);
+    current_b = abs(current_b);
+    voltage_a = abs(voltage_a);
+    voltage_b = abs(voltage_b);
+    if (current_a > peak_current) peak_current = current_a;
+    if (current_b > peak_current) peak_current = current_b;
+    if (voltage_a > peak_voltage) peak_voltage = voltage_a;
+    if (voltage_b > peak_voltage) peak_voltage = voltage_b;
+  }
+
+  sums->sos_current[0] = sos_current;
+  sums->sos_voltage[0] = sos_voltage;
+  sums->sum_power[0] = sum_power;
+  sums->peak_current[0] = peak_current;
+  sums->peak_voltage[0] = peak_voltage;
+#endif
+}
+
+#ifdef P_ADC_KERNEL_CHECK
+/**
+ * reference check: runs the original multi-pass CMSIS-DSP processing on the same batch and reports deviations of the fused kernel results
+ */
+static void _ADC_CheckBatch(arm_matrix_instance_q15* current_matrix, arm_matrix_instance_q15* voltage_matrix, const _ADC_BatchSums* sums, uint8_t index) {
   q15_t raw_current[P_ADC_SAMPLE_BATCH_SIZE];
   q15_t raw_voltage[P_ADC_SAMPLE_BATCH_SIZE];
   q15_t raw_power[P_ADC_SAMPLE_BATCH_SIZE];
+  q63_t ref_sos_current, ref_sos_voltage;
+  q15_t ref_avg_power, ref_peak_current, ref_peak_voltage;
+  uint32_t peak_index;
+  int ch;
+
 #ifdef MAIN_FOUR_CHANNEL
-  q15_t raw_current_second[P_ADC_SAMPLE_BATCH_SIZE];
-  q15_t raw_voltage_second[P_ADC_SAMPLE_BATCH_SIZE];
-  q15_t raw_power_second[P_ADC_SAMPLE_BATCH_SIZE];
+  for (ch = 0; ch < 2; ch++) {
+    const q15_t* processing_vector = ch == 0 ? processing_vector_AC : processing_vector_BD;
+    arm_mat_vec_mult_q15(current_matrix, processing_vector, raw_current);
+    arm_mat_vec_mult_q15(voltage_matrix, processing_vector, raw_voltage);
+#else
+  for (ch = 0; ch < 1; ch++) {
+    arm_mat_vec_mult_q15(current_matrix, processing_vector_current, raw_current);
+    arm_mat_vec_mult_q15(voltage_matrix, processing_vector_voltage, raw_voltage);
 #endif
+    arm_mult_q15(raw_voltage, raw_current, raw_power, P_ADC_SAMPLE_BATCH_SIZE);
+    arm_power_q15(raw_current, P_ADC_SAMPLE_BATCH_SIZE, &ref_sos_current);
+    arm_power_q15(raw_voltage, P_ADC_SAMPLE_BATCH_SIZE, &ref_sos_voltage);
+    arm_mean_q15(raw_power, P_ADC_SAMPLE_BATCH_SIZE, &ref_avg_power);
+    arm_absmax_q15(raw_current, P_ADC_SAMPLE_BATCH_SIZE, &ref_peak_current, &peak_index);
+    arm_absmax_q15(raw_voltage, P_ADC_SAMPLE_BATCH_SIZE, &ref_peak_voltage, &peak_index);
 
+    //sums of squares and peaks must match exactly, average power may differ by rounding of the per-sample products in the reference
+    float power_error = fabsf((float)sums->sum_power[ch] / P_ADC_SOS_AVG_DIVISOR - (float)ref_avg_power / 32768.0f);
+    if (sums->sos_current[ch] != ref_sos_current || sums->sos_voltage[ch] != ref_sos_voltage || sums->peak_current[ch] != ref_peak_current ||
+        sums->peak_voltage[ch] != ref_peak_voltage || power_error > P_ADC_KERNEL_CHECK_POWER_TOLERANCE) {
+      DEBUG_PRINTF("ADC kernel mismatch index %u ch %d: sos I %lld/%lld V %lld/%lld, peak I %ld/%d V %ld/%d, power error %g\n", index, ch,
+                   sums->sos_current[ch], ref_sos_current, sums->sos_voltage[ch], ref_sos_voltage, sums->peak_current[ch], ref_peak_current,
+                   sums->peak_voltage[ch], ref_peak_voltage, power_error);
+    }
+  }
+}
+#endif
+
+/**
+ * data processing function (DMA to raw data)
+ * index: 0 = channels A+B, 1 = channels C+D
+ * half: 0 = first half of buffer, 1 = second half of buffer
+ */
+void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
+  const q15_t* src_current;
+  const q15_t* src_voltage;
+  _ADC_BatchSums sums;
+
+#ifdef MAIN_FOUR_CHANNEL
   int i;
+#endif
   uint8_t arr_offset = 2 * index;
 
 /*#ifdef DEBUG
@@ -114,23 +285,14 @@ void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
   uint32_t start_cycle = DWT->CYCCNT;
 #endif*/
 
-  //select matrices based on index and half
+  //select source buffers based on index and half
+  uint32_t buf_offset = half == 0 ? 0 : (P_ADC_DMA_BUFFER_SIZE / 2);
   if (index == 0) {
-    if (half == 0) {
-      current_matrix = &mat_current_AB_first;
-      voltage_matrix = &mat_voltage_AB_first;
-    } else {
-      current_matrix = &mat_current_AB_second;
-      voltage_matrix = &mat_voltage_AB_second;
-    }
+    src_current = dma_current_AB + buf_offset;
+    src_voltage = dma_voltage_AB + buf_offset;
   } else {
-    if (half == 0) {
-      current_matrix = &mat_current_CD_first;
-      voltage_matrix = &mat_voltage_CD_first;
-    } else {
-      current_matrix = &mat_current_CD_second;
-      voltage_matrix = &mat_voltage_CD_second;
-    }
+    src_current = dma_current_CD + buf_offset;
+    src_voltage = dma_voltage_CD + buf_offset;
   }
 
   //select unit conversion factors
@@ -143,32 +305,25 @@ void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
   float conv_fact_p_second = index == 0 ? P_ADC_FACTOR_PB : P_ADC_FACTOR_PD;
 #endif
 
-  //main processing
+  //main processing: single pass over the batch
+  _ADC_ProcessBatch(src_current, src_voltage, &sums);
+
+#ifdef P_ADC_KERNEL_CHECK
+  if (index == 0) {
+    _ADC_CheckBatch(half == 0 ? &mat_current_AB_first : &mat_current_AB_second, half == 0 ? &mat_voltage_AB_first : &mat_voltage_AB_second, &sums, index);
+  } else {
+    _ADC_CheckBatch(half == 0 ? &mat_current_CD_first : &mat_current_CD_second, half == 0 ? &mat_voltage_CD_first : &mat_voltage_CD_second, &sums, index);
+  }
+#endif
+
 #ifdef MAIN_FOUR_CHANNEL
-  //extract currents from matrices
-  arm_mat_vec_mult_q15(current_matrix, processing_vector_AC, raw_current);
-  arm_mat_vec_mult_q15(current_matrix, processing_vector_BD, raw_current_second);
-  //extract voltages from matrices
-  arm_mat_vec_mult_q15(voltage_matrix, processing_vector_AC, raw_voltage);
-  arm_mat_vec_mult_q15(voltage_matrix, processing_vector_BD, raw_voltage_second);
-  //calculate instantaneous power
-  arm_mult_q15(raw_voltage, raw_current, raw_power, P_ADC_SAMPLE_BATCH_SIZE);
-  arm_mult_q15(raw_voltage_second, raw_current_second, raw_power_second, P_ADC_SAMPLE_BATCH_SIZE);
-  //calculate voltage and current sums of squares and average power
-  q63_t raw_sos[4]; //sums of squares: I1, V1, I2, V2; in 34.30 format (see CMSIS-DSP documentation)
-  q15_t raw_avg_powers[2]; //average real powers: 1, 2
-  arm_power_q15(raw_current, P_ADC_SAMPLE_BATCH_SIZE, raw_sos);
-  arm_power_q15(raw_voltage, P_ADC_SAMPLE_BATCH_SIZE, raw_sos + 1);
-  arm_power_q15(raw_current_second, P_ADC_SAMPLE_BATCH_SIZE, raw_sos + 2);
-  arm_power_q15(raw_voltage_second, P_ADC_SAMPLE_BATCH_SIZE, raw_sos + 3);
-  arm_mean_q15(raw_power, P_ADC_SAMPLE_BATCH_SIZE, raw_avg_powers);
-  arm_mean_q15(raw_power_second, P_ADC_SAMPLE_BATCH_SIZE, raw_avg_powers + 1);
-  //convert to floats, sums of squares also get averaged at the same time
+  //convert to floats, sums also get averaged at the same time
   float f_results[6]; //I1, V1, I2, V2, P1, P2
-  for (i = 0; i < 4; i++) {
-      f_results[i] = (float)raw_sos[i] / P_ADC_SOS_AVG_DIVISOR;
+  for (i = 0; i < 2; i++) {
+    f_results[2 * i] = (float)sums.sos_current[i] / P_ADC_SOS_AVG_DIVISOR;
+    f_results[2 * i + 1] = (float)sums.sos_voltage[i] / P_ADC_SOS_AVG_DIVISOR;
+    f_results[4 + i] = (float)sums.sum_power[i] / P_ADC_SOS_AVG_DIVISOR;
   }
-  arm_q15_to_float(raw_avg_powers, f_results + 4, 2);
   //perform batch result calculations
   rms_current_inst[arr_offset] = sqrtf(f_results[0]) * conv_fact_i;
   rms_voltage_inst[arr_offset] = sqrtf(f_results[1]) * conv_fact_v;
@@ -178,6 +333,10 @@ void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
   avg_apparent_power_inst[arr_offset + 1] = sqrtf(f_results[2] * f_results[3]) * conv_fact_p_second;
   avg_real_power_inst[arr_offset] = fabsf(f_results[4]) * conv_fact_p;
   avg_real_power_inst[arr_offset + 1] = fabsf(f_results[5]) * conv_fact_p_second;
+  peak_current_inst[arr_offset] = (float)sums.peak_current[0] / 32768.0f * conv_fact_i;
+  peak_voltage_inst[arr_offset] = (float)sums.peak_voltage[0] / 32768.0f * conv_fact_v;
+  peak_current_inst[arr_offset + 1] = (float)sums.peak_current[1] / 32768.0f * conv_fact_i_second;
+  peak_voltage_inst[arr_offset + 1] = (float)sums.peak_voltage[1] / 32768.0f * conv_fact_v_second;
   //update EMA direct results (means of squares, avg real power)
   raw_mos_current_0s1[arr_offset] = raw_mos_current_0s1[arr_offset] * P_ADC_EMA_0S1_1MALPHA + f_results[0] * P_ADC_EMA_0S1_ALPHA;
   raw_mos_current_1s0[arr_offset] = raw_mos_current_1s0[arr_offset] * P_ADC_EMA_1S0_1MALPHA + f_results[0] * P_ADC_EMA_1S0_ALPHA;
@@ -204,29 +363,22 @@ void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
   rms_voltage_1s0[arr_offset + 1] = sqrtf(raw_mos_voltage_1s0[arr_offset + 1]) * conv_fact_v_second;
   avg_apparent_power_0s1[arr_offset + 1] = sqrtf(raw_mos_current_0s1[arr_offset + 1] * raw_mos_voltage_0s1[arr_offset + 1]) * conv_fact_p_second;
   avg_apparent_power_1s0[arr_offset + 1] = sqrtf(raw_mos_current_1s0[arr_offset + 1] * raw_mos_voltage_1s0[arr_offset + 1]) * conv_fact_p_second;
+  //advance speaker thermal models
+  SPKM_ProcessBatch(arr_offset, fabsf(f_results[4]) * conv_fact_p);
+  SPKM_ProcessBatch(arr_offset + 1, fabsf(f_results[5]) * conv_fact_p_second);
 #else
-  //extract current and differential voltage based on index
-  arm_mat_vec_mult_q15(current_matrix, processing_vector_current, raw_current);
-  arm_mat_vec_mult_q15(voltage_matrix, processing_vector_voltage, raw_voltage);
-  //calculate instantaneous power
-  arm_mult_q15(raw_voltage, raw_current, raw_power, P_ADC_SAMPLE_BATCH_SIZE);
-  //calculate voltage and current sums of squares and average power
-  q63_t raw_sos[2]; //sums of squares: I, V; in 34.30 format (see CMSIS-DSP documentation)
-  q15_t raw_avg_power; //average real powers
-  arm_power_q15(raw_current, P_ADC_SAMPLE_BATCH_SIZE, raw_sos);
-  arm_power_q15(raw_voltage, P_ADC_SAMPLE_BATCH_SIZE, raw_sos + 1);
-  arm_mean_q15(raw_power, P_ADC_SAMPLE_BATCH_SIZE, &raw_avg_power);
-  //convert to floats, sums of squares also get averaged at the same time
+  //convert to floats, sums also get averaged at the same time
   float f_results[3]; //I, V, P
-  for (i = 0; i < 2; i++) {
-      f_results[i] = (float)raw_sos[i] / P_ADC_SOS_AVG_DIVISOR;
-  }
-  arm_q15_to_float(&raw_avg_power, f_results + 2, 1);
+  f_results[0] = (float)sums.sos_current[0] / P_ADC_SOS_AVG_DIVISOR;
+  f_results[1] = (float)sums.sos_voltage[0] / P_ADC_SOS_AVG_DIVISOR;
+  f_results[2] = (float)sums.sum_power[0] / P_ADC_SOS_AVG_DIVISOR;
   //perform batch result calculations
   rms_current_inst[arr_offset] = rms_current_inst[arr_offset + 1] = sqrtf(f_results[0]) * 2.0f;
   rms_voltage_inst[arr_offset] = rms_voltage_inst[arr_offset + 1] = sqrtf(f_results[1]) * 2.0f;
   avg_apparent_power_inst[arr_offset] = avg_apparent_power_inst[arr_offset + 1] = sqrtf(f_results[0] * f_results[1]) * 4.0f;
   avg_real_power_inst[arr_offset] = avg_real_power_inst[arr_offset + 1] = fabsf(f_results[2]) * 4.0f;
+  peak_current_inst[arr_offset] = peak_current_inst[arr_offset + 1] = (float)sums.peak_current[0] / 32768.0f * conv_fact_i;
+  peak_voltage_inst[arr_offset] = peak_voltage_inst[arr_offset + 1] = (float)sums.peak_voltage[0] / 32768.0f * conv_fact_v;
   //update EMA direct results (sums of squares, avg real power)
   raw_mos_current_0s1[arr_offset] = raw_mos_current_0s1[arr_offset + 1] = raw_mos_current_0s1[arr_offset] * P_ADC_EMA_0S1_1MALPHA + f_results[0] * P_ADC_EMA_0S1_ALPHA;
   raw_mos_current_1s0[arr_offset] = raw_mos_current_1s0[arr_offset + 1] = raw_mos_current_1s0[arr_offset] * P_ADC_EMA_1S0_1MALPHA + f_results[0] * P_ADC_EMA_1S0_ALPHA;
@@ -241,6 +393,10 @@ void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
   rms_voltage_1s0[arr_offset] = rms_voltage_1s0[arr_offset + 1] = sqrtf(raw_mos_voltage_1s0[arr_offset]) * conv_fact_v;
   avg_apparent_power_0s1[arr_offset] = avg_apparent_power_0s1[arr_offset + 1] = sqrtf(raw_mos_current_0s1[arr_offset] * raw_mos_voltage_0s1[arr_offset]) * conv_fact_p;
   avg_apparent_power_1s0[arr_offset] = avg_apparent_power_1s0[arr_offset + 1] = sqrtf(raw_mos_current_1s0[arr_offset] * raw_mos_voltage_1s0[arr_offset]) * conv_fact_p;
+  //advance speaker thermal models (both channels of the pair drive the same speaker)
+  float speaker_power = fabsf(f_results[2]) * conv_fact_p;
+  SPKM_ProcessBatch(arr_offset, speaker_power);
+  SPKM_ProcessBatch(arr_offset + 1, speaker_power);
 #endif
 
   SAFETY_CheckADCInstValues();
@@ -254,6 +410,41 @@ void _ADC_ProcessCallback(uint8_t index, uint8_t half) {
 #endif*/
 }
 
+void ADC_ArmCurrentWatchdogs() {
+  __HAL_ADC_CLEAR_FLAG(&hadc1, ADC_FLAG_AWD1);
+  __HAL_ADC_CLEAR_FLAG(&hadc3, ADC_FLAG_AWD1);
+  __HAL_ADC_ENABLE_IT(&hadc1, ADC_IT_AWD1);
+  __HAL_ADC_ENABLE_IT(&hadc3, ADC_IT_AWD1);
+#ifdef MAIN_FOUR_CHANNEL
+  __HAL_ADC_CLEAR_FLAG(&hadc1, ADC_FLAG_AWD2);
+  __HAL_ADC_CLEAR_FLAG(&hadc3, ADC_FLAG_AWD2);
+  __HAL_ADC_ENABLE_IT(&hadc1, ADC_IT_AWD2);
+  __HAL_ADC_ENABLE_IT(&hadc3, ADC_IT_AWD2);
+#endif
+}
+
+//analog watchdog 1: current of channel A or C out of range - shut down immediately, disable interrupt until re-armed
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef* hadc) {
+  __HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD1);
+  if (hadc == &hadc1) {
+    SAFETY_TriggerPeakCurrentShutdown(0);
+  } else if (hadc == &hadc3) {
+    SAFETY_TriggerPeakCurrentShutdown(2);
+  }
+}
+
+#ifdef MAIN_FOUR_CHANNEL
+//analog watchdog 2: current of channel B or D out of range - shut down immediately, disable interrupt until re-armed
+void HAL_ADCEx_LevelOutOfWindow2Callback(ADC_HandleTypeDef* hadc) {
+  __HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD2);
+  if (hadc == &hadc1) {
+    SAFETY_TriggerPeakCurrentShutdown(1);
+  } else if (hadc == &hadc3) {
+    SAFETY_TriggerPeakCurrentShutdown(3);
+  }
+}
+#endif
+
 void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
   if (hadc == &hadc1) {
     _ADC_ProcessCallback(0, 1);
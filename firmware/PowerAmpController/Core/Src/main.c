@@ -26,6 +26,7 @@
 #include "adc.h"
 #include "pvdd_control.h"
 #include "safety.h"
+#include "speaker_model.h"
 #include "i2c.h"
 /* USER CODE END Includes */
 
@@ -57,6 +58,8 @@ DMA_HandleTypeDef hdma_adc4;
 DAC_HandleTypeDef hdac1;
 
 I2C_HandleTypeDef hi2c3;
+DMA_HandleTypeDef hdma_i2c3_tx;
+DMA_HandleTypeDef hdma_i2c3_rx;
 
 IWDG_HandleTypeDef hiwdg;
 
@@ -190,6 +193,11 @@ int main(void)
   HAL_Delay(10);
   _RefreshWatchdogs();
 
+  DEBUG_PRINTF("Initializing speaker model...\n");
+  if (SPKM_Init() != HAL_OK) {
+    Error_Handler();
+  }
+
   DEBUG_PRINTF("Calibrating ADC...\n");
   if (ADC_Calibrate() != HAL_OK) {
     Error_Handler();
@@ -273,6 +281,7 @@ int main(void)
 
     PVDD_LoopUpdate();
     SAFETY_LoopUpdate();
+    SPKM_LoopUpdate();
     I2C_LoopUpdate();
 
     _RefreshWatchdogs();
@@ -838,6 +847,12 @@ static void MX_DMA_Init(void)
   /* DMA1_Channel1_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 4, 0);
   HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+  /* DMA1_Channel2_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+  /* DMA1_Channel3_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
   /* DMA2_Channel1_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA2_Channel1_IRQn, 4, 0);
   HAL_NVIC_EnableIRQ(DMA2_Channel1_IRQn);
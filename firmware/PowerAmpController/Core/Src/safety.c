@@ -60,6 +60,8 @@ uint8_t manual_shutdown = 1;
 uint16_t safety_err_status = 0;
 uint16_t safety_warn_status_inst = 0;
 uint16_t safety_warn_status_loop = 0;
+//error sources of analog watchdog (fast path) shutdowns, set in ADC interrupt and merged into the error status by the main loop
+static volatile uint16_t safety_peak_err_source = 0;
 
 //helper arrays to translate from channel index (0 = A, ..., 3 = D) to corresponding status register bits (as defined in I2C defines)
 static const uint16_t safety_channel_err_bits[] = { I2CDEF_POWERAMP_SERR_SOURCE_CHAN_A, I2CDEF_POWERAMP_SERR_SOURCE_CHAN_B, I2CDEF_POWERAMP_SERR_SOURCE_CHAN_C, I2CDEF_POWERAMP_SERR_SOURCE_CHAN_D };
@@ -276,13 +278,20 @@ void SAFETY_SetManualShutdown(uint8_t shutdown) {
   //just set shutdown variable, leave actual pin updating to main loop
   manual_shutdown = shutdown > 0 ? 1 : 0;
 
-  //when enabling manual shutdown: reset safety shutdown and errors
+  //when enabling manual shutdown: reset safety shutdown and errors, re-arm fast current watchdogs
   if (shutdown > 0) {
     safety_shutdown = 0;
     safety_err_status = 0;
+    ADC_ArmCurrentWatchdogs();
   }
 }
 
+void SAFETY_TriggerPeakCurrentShutdown(uint8_t channel) {
+  //shut down first, status reporting is left to the main loop (I2C state is not safe to modify at this interrupt priority)
+  _SAFETY_TriggerSafetyShutdown();
+  safety_peak_err_source |= I2CDEF_POWERAMP_SERR_SOURCE_MTYPE_IPEAK | safety_channel_err_bits[channel];
+}
+
 /**
  * check instantaneous (last batch) measurements for safety - called after every ADC batch
  */
@@ -435,6 +444,17 @@ HAL_StatusTypeDef SAFETY_Init() {
 }
 
 void SAFETY_LoopUpdate() {
+  //report analog watchdog shutdowns
+  if (safety_peak_err_source != 0) {
+    __disable_irq();
+    uint16_t source = safety_peak_err_source;
+    safety_err_status |= source;
+    safety_peak_err_source = 0;
+    __enable_irq();
+    DEBUG_PRINTF("ERROR: Safety peak current shutdown, source 0x%04X\n", source);
+    I2C_TriggerInterrupt(I2CDEF_POWERAMP_INT_FLAGS_INT_SERR_Msk);
+  }
+
   //start with sanity check before doing anything else
   if (_SAFETY_SanityCheckLimits() != HAL_OK) {
     DEBUG_PRINTF("ERROR: Safety loop - limit sanity check failed\n");
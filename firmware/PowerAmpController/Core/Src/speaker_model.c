@@ -0,0 +1,118 @@
+/*
+ * speaker_model.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Alex
+ */
+
+#include "speaker_model.h"
+#include <stdio.h>
+
+
+float spkm_rth_coil[4] = { SPKM_DEFAULT_RTH_COIL, SPKM_DEFAULT_RTH_COIL, SPKM_DEFAULT_RTH_COIL, SPKM_DEFAULT_RTH_COIL };
+float spkm_tau_coil[4] = { SPKM_DEFAULT_TAU_COIL, SPKM_DEFAULT_TAU_COIL, SPKM_DEFAULT_TAU_COIL, SPKM_DEFAULT_TAU_COIL };
+float spkm_rth_magnet[4] = { SPKM_DEFAULT_RTH_MAGNET, SPKM_DEFAULT_RTH_MAGNET, SPKM_DEFAULT_RTH_MAGNET, SPKM_DEFAULT_RTH_MAGNET };
+float spkm_tau_magnet[4] = { SPKM_DEFAULT_TAU_MAGNET, SPKM_DEFAULT_TAU_MAGNET, SPKM_DEFAULT_TAU_MAGNET, SPKM_DEFAULT_TAU_MAGNET };
+float spkm_max_temp_rise[4] = { SPKM_DEFAULT_MAX_TEMP_RISE, SPKM_DEFAULT_MAX_TEMP_RISE, SPKM_DEFAULT_MAX_TEMP_RISE, SPKM_DEFAULT_MAX_TEMP_RISE };
+
+float spkm_temp_rise[4] = { 0.0f };
+float spkm_gain_reduction_dB[4] = { 0.0f };
+uint8_t spkm_limit_active = 0;
+
+//temperature rise of the individual stages (coil above magnet, magnet above ambient)
+static float spkm_temp_coil[4] = { 0.0f };
+static float spkm_temp_magnet[4] = { 0.0f };
+//per-batch EMA coefficients of the stages: alpha = 1 - e^(-t_batch / tau)
+static float spkm_alpha_coil[4] = { 0.0f };
+static float spkm_alpha_magnet[4] = { 0.0f };
+
+
+static inline float _SPKM_CalculateAlpha(float tau) {
+  return 1.0f - expf(-SPKM_BATCH_TIME / tau);
+}
+
+HAL_StatusTypeDef SPKM_Init() {
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    spkm_temp_coil[i] = 0.0f;
+    spkm_temp_magnet[i] = 0.0f;
+    spkm_temp_rise[i] = 0.0f;
+    spkm_gain_reduction_dB[i] = 0.0f;
+    spkm_alpha_coil[i] = _SPKM_CalculateAlpha(spkm_tau_coil[i]);
+    spkm_alpha_magnet[i] = _SPKM_CalculateAlpha(spkm_tau_magnet[i]);
+  }
+  spkm_limit_active = 0;
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef SPKM_SetParameter(uint8_t param_index, uint8_t channel, float value) {
+  if (channel >= 4 || value <= 0.0f || isnanf(value)) {
+    return HAL_ERROR;
+  }
+
+  switch (param_index) {
+    case 0:
+      if (isinff(value)) return HAL_ERROR;
+      spkm_rth_coil[channel] = value;
+      break;
+    case 1:
+      if (value > SPKM_MAX_TAU) return HAL_ERROR;
+      spkm_tau_coil[channel] = value;
+      spkm_alpha_coil[channel] = _SPKM_CalculateAlpha(value);
+      break;
+    case 2:
+      if (isinff(value)) return HAL_ERROR;
+      spkm_rth_magnet[channel] = value;
+      break;
+    case 3:
+      if (value > SPKM_MAX_TAU) return HAL_ERROR;
+      spkm_tau_magnet[channel] = value;
+      spkm_alpha_magnet[channel] = _SPKM_CalculateAlpha(value);
+      break;
+    case 4:
+      spkm_max_temp_rise[channel] = value; //infinity allowed: disables gain reduction
+      break;
+    default:
+      return HAL_ERROR;
+  }
+
+  return HAL_OK;
+}
+
+void SPKM_ProcessBatch(uint8_t channel, float power) {
+  //first-order update of each stage towards its steady-state temperature rise for the given power
+  spkm_temp_coil[channel] += spkm_alpha_coil[channel] * (power * spkm_rth_coil[channel] - spkm_temp_coil[channel]);
+  spkm_temp_magnet[channel] += spkm_alpha_magnet[channel] * (power * spkm_rth_magnet[channel] - spkm_temp_magnet[channel]);
+  spkm_temp_rise[channel] = spkm_temp_coil[channel] + spkm_temp_magnet[channel];
+}
+
+void SPKM_LoopUpdate() {
+  int i;
+  uint8_t limit_active = 0;
+
+  for (i = 0; i < 4; i++) {
+    float max_rise = spkm_max_temp_rise[i];
+    float knee = max_rise * SPKM_LIMIT_KNEE;
+    float rise = spkm_temp_rise[i];
+
+    if (isinff(max_rise) || rise <= knee) {
+      //below knee (or model disabled): no reduction
+      spkm_gain_reduction_dB[i] = 0.0f;
+    } else {
+      //above knee: reduce gain proportionally to the excess temperature rise, up to the limit
+      float reduction = SPKM_GAIN_RED_AT_MAX_DB * (rise - knee) / (max_rise - knee);
+      if (reduction < SPKM_GAIN_RED_LIMIT_DB) {
+        reduction = SPKM_GAIN_RED_LIMIT_DB;
+      }
+      spkm_gain_reduction_dB[i] = reduction;
+      limit_active = 1;
+    }
+  }
+
+  if (limit_active != spkm_limit_active) {
+    DEBUG_PRINTF("Speaker thermal limit %s\n", limit_active ? "active" : "inactive");
+  }
+  spkm_limit_active = limit_active;
+}